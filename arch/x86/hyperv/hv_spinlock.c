@@ -10,7 +10,10 @@
 
 #define pr_fmt(fmt) "Hyper-V: " fmt
 
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 #include <linux/spinlock.h>
+#include <linux/sched/clock.h>
 
 #include <asm/mshyperv.h>
 #include <asm/paravirt.h>
@@ -18,6 +21,29 @@
 
 static bool __initdata hv_pvspin = true;
 
+/*
+ * hv_qlock_wait() spins for up to hv_qlock_spins iterations before it idles
+ * the vCPU. The budget adapts per CPU: when the vCPU gets kicked soon after
+ * going idle the lock holder was running and a bit more spinning would have
+ * saved the round trip through the hypervisor, so the budget grows. A long
+ * idle hints that the lock holder's vCPU is not running, e.g. preempted by
+ * the host, and spinning would only burn the CPU, so the budget shrinks.
+ */
+#define HV_QLOCK_SPIN_INIT	64
+#define HV_QLOCK_SPIN_MAX	(1U << 14)
+#define HV_QLOCK_SHORT_IDLE_NS	(20 * NSEC_PER_USEC)
+
+struct hv_qlock_stats {
+	u64 waits;		/* Calls to hv_qlock_wait() */
+	u64 spin_hits;		/* Lock state changed while spinning */
+	u64 idles;		/* Idle requests to the hypervisor */
+	u64 short_idles;	/* Idles shorter than HV_QLOCK_SHORT_IDLE_NS */
+	u64 idle_ns;		/* Total time spent idle */
+};
+
+static DEFINE_PER_CPU(struct hv_qlock_stats, hv_qlock_stats);
+static DEFINE_PER_CPU(unsigned int, hv_qlock_spins) = HV_QLOCK_SPIN_INIT;
+
 static void hv_qlock_kick(int cpu)
 {
 	apic->send_IPI(cpu, X86_PLATFORM_IPI_VECTOR);
@@ -25,11 +51,26 @@ static void hv_qlock_kick(int cpu)
 
 static void hv_qlock_wait(u8 *byte, u8 val)
 {
+	unsigned int spins, i;
 	unsigned long flags;
+	u64 start, idle_ns;
 
 	if (in_nmi())
 		return;
 
+	this_cpu_inc(hv_qlock_stats.waits);
+
+	spins = this_cpu_read(hv_qlock_spins);
+	for (i = 0; i < spins; i++) {
+		if (READ_ONCE(*byte) != val) {
+			this_cpu_inc(hv_qlock_stats.spin_hits);
+			this_cpu_write(hv_qlock_spins,
+				       min(spins * 2, HV_QLOCK_SPIN_MAX));
+			return;
+		}
+		cpu_relax();
+	}
+
 	/*
 	 * Reading HV_X64_MSR_GUEST_IDLE MSR tells the hypervisor that the
 	 * vCPU can be put into 'idle' state. This 'idle' state is
@@ -50,9 +91,21 @@ static void hv_qlock_wait(u8 *byte, u8 val)
 	if (READ_ONCE(*byte) == val) {
 		unsigned long msr_val;
 
+		start = local_clock();
 		rdmsrl(HV_X64_MSR_GUEST_IDLE, msr_val);
+		idle_ns = local_clock() - start;
 
 		(void)msr_val;
+
+		this_cpu_inc(hv_qlock_stats.idles);
+		this_cpu_add(hv_qlock_stats.idle_ns, idle_ns);
+		if (idle_ns < HV_QLOCK_SHORT_IDLE_NS) {
+			this_cpu_inc(hv_qlock_stats.short_idles);
+			spins = min(max(spins, 1U) * 2, HV_QLOCK_SPIN_MAX);
+		} else {
+			spins /= 2;
+		}
+		this_cpu_write(hv_qlock_spins, spins);
 	}
 	local_irq_restore(flags);
 }
@@ -84,6 +137,41 @@ void __init hv_init_spinlocks(void)
 	pv_ops.lock.vcpu_is_preempted = PV_CALLEE_SAVE(hv_vcpu_is_preempted);
 }
 
+static int hv_qlock_stats_show(struct seq_file *m, void *v)
+{
+	struct hv_qlock_stats sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct hv_qlock_stats *st = per_cpu_ptr(&hv_qlock_stats, cpu);
+
+		sum.waits += st->waits;
+		sum.spin_hits += st->spin_hits;
+		sum.idles += st->idles;
+		sum.short_idles += st->short_idles;
+		sum.idle_ns += st->idle_ns;
+	}
+
+	seq_printf(m, "waits: %llu\n", sum.waits);
+	seq_printf(m, "spin_hits: %llu\n", sum.spin_hits);
+	seq_printf(m, "idles: %llu\n", sum.idles);
+	seq_printf(m, "short_idles: %llu\n", sum.short_idles);
+	seq_printf(m, "idle_ns: %llu\n", sum.idle_ns);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hv_qlock_stats);
+
+static int __init hv_qlock_debugfs_init(void)
+{
+	if (pv_ops.lock.wait != hv_qlock_wait)
+		return 0;
+
+	debugfs_create_file("hv_spinlock", 0444, arch_debugfs_dir, NULL,
+			    &hv_qlock_stats_fops);
+	return 0;
+}
+late_initcall(hv_qlock_debugfs_init);
+
 static __init int hv_parse_nopvspin(char *arg)
 {
 	hv_pvspin = false;
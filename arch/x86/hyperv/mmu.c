@@ -1,7 +1,9 @@
 #define pr_fmt(fmt)  "Hyper-V: " fmt
 
+#include <linux/debugfs.h>
 #include <linux/hyperv.h>
 #include <linux/log2.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/types.h>
 
@@ -20,6 +22,25 @@
 static u64 hyperv_flush_tlb_others_ex(const struct cpumask *cpus,
 				      const struct flush_tlb_info *info);
 
+struct hv_tlb_flush_stats {
+	u64 hypercalls;		/* Flush hypercalls issued */
+	u64 skipped;		/* Flushes which needed no hypercall at all */
+	u64 full_flushes;	/* Range flushes widened to the whole space */
+	u64 native;		/* Fallbacks to IPI based flushes */
+};
+
+static DEFINE_PER_CPU(struct hv_tlb_flush_stats, hv_tlb_flush_stats);
+
+/*
+ * A CPU in lazy TLB mode checks the mm's tlb_gen when it switches back to
+ * it and flushes then; like native_flush_tlb_multi(), leave such CPUs out
+ * unless page tables are being freed.
+ */
+static bool cpu_is_lazy(int cpu)
+{
+	return per_cpu(cpu_tlbstate_shared.is_lazy, cpu);
+}
+
 /*
  * Fills in gva_list starting from offset. Returns the number of items added.
  */
@@ -60,6 +81,7 @@ static void hyperv_flush_tlb_multi(const struct cpumask *cpus,
 	struct hv_tlb_flush *flush;
 	u64 status;
 	unsigned long flags;
+	bool do_lazy = !info->freed_tables;
 
 	trace_hyperv_mmu_flush_tlb_multi(cpus, info);
 
@@ -112,6 +134,8 @@ static void hyperv_flush_tlb_multi(const struct cpumask *cpus,
 			goto do_ex_hypercall;
 
 		for_each_cpu(cpu, cpus) {
+			if (do_lazy && cpu_is_lazy(cpu))
+				continue;
 			vcpu = hv_cpu_number_to_vp_number(cpu);
 			if (vcpu == VP_INVAL) {
 				local_irq_restore(flags);
@@ -127,6 +151,7 @@ static void hyperv_flush_tlb_multi(const struct cpumask *cpus,
 
 		/* nothing to flush if 'processor_mask' ends up being empty */
 		if (!flush->processor_mask) {
+			this_cpu_inc(hv_tlb_flush_stats.skipped);
 			local_irq_restore(flags);
 			return;
 		}
@@ -138,12 +163,14 @@ static void hyperv_flush_tlb_multi(const struct cpumask *cpus,
 	 */
 	max_gvas = (PAGE_SIZE - sizeof(*flush)) / sizeof(flush->gva_list[0]);
 
+	this_cpu_inc(hv_tlb_flush_stats.hypercalls);
 	if (info->end == TLB_FLUSH_ALL) {
 		flush->flags |= HV_FLUSH_NON_GLOBAL_MAPPINGS_ONLY;
 		status = hv_do_hypercall(HVCALL_FLUSH_VIRTUAL_ADDRESS_SPACE,
 					 flush, NULL);
 	} else if (info->end &&
 		   ((info->end - info->start)/HV_TLB_FLUSH_UNIT) > max_gvas) {
+		this_cpu_inc(hv_tlb_flush_stats.full_flushes);
 		status = hv_do_hypercall(HVCALL_FLUSH_VIRTUAL_ADDRESS_SPACE,
 					 flush, NULL);
 	} else {
@@ -163,6 +190,7 @@ static void hyperv_flush_tlb_multi(const struct cpumask *cpus,
 	if (hv_result_success(status))
 		return;
 do_native:
+	this_cpu_inc(hv_tlb_flush_stats.native);
 	native_flush_tlb_multi(cpus, info);
 }
 
@@ -198,10 +226,22 @@ static u64 hyperv_flush_tlb_others_ex(const struct cpumask *cpus,
 	flush->hv_vp_set.valid_bank_mask = 0;
 
 	flush->hv_vp_set.format = HV_GENERIC_SET_SPARSE_4K;
-	nr_bank = cpumask_to_vpset(&(flush->hv_vp_set), cpus);
+	if (info->freed_tables)
+		nr_bank = cpumask_to_vpset(&(flush->hv_vp_set), cpus);
+	else
+		nr_bank = cpumask_to_vpset_skip(&(flush->hv_vp_set), cpus,
+						cpu_is_lazy);
 	if (nr_bank < 0)
 		return HV_STATUS_INVALID_PARAMETER;
 
+	/* nothing to flush if the VP set ends up being empty */
+	if (nr_bank &&
+	    !memchr_inv(flush->hv_vp_set.bank_contents, 0,
+			nr_bank * sizeof(flush->hv_vp_set.bank_contents[0]))) {
+		this_cpu_inc(hv_tlb_flush_stats.skipped);
+		return HV_STATUS_SUCCESS;
+	}
+
 	/*
 	 * We can flush not more than max_gvas with one hypercall. Flush the
 	 * whole address space if we were asked to do more.
@@ -211,6 +251,7 @@ static u64 hyperv_flush_tlb_others_ex(const struct cpumask *cpus,
 		 sizeof(flush->hv_vp_set.bank_contents[0])) /
 		sizeof(flush->gva_list[0]);
 
+	this_cpu_inc(hv_tlb_flush_stats.hypercalls);
 	if (info->end == TLB_FLUSH_ALL) {
 		flush->flags |= HV_FLUSH_NON_GLOBAL_MAPPINGS_ONLY;
 		status = hv_do_rep_hypercall(
@@ -218,6 +259,7 @@ static u64 hyperv_flush_tlb_others_ex(const struct cpumask *cpus,
 			0, nr_bank, flush, NULL);
 	} else if (info->end &&
 		   ((info->end - info->start)/HV_TLB_FLUSH_UNIT) > max_gvas) {
+		this_cpu_inc(hv_tlb_flush_stats.full_flushes);
 		status = hv_do_rep_hypercall(
 			HVCALL_FLUSH_VIRTUAL_ADDRESS_SPACE_EX,
 			0, nr_bank, flush, NULL);
@@ -241,3 +283,36 @@ void hyperv_setup_mmu_ops(void)
 	pv_ops.mmu.flush_tlb_multi = hyperv_flush_tlb_multi;
 	pv_ops.mmu.tlb_remove_table = tlb_remove_table;
 }
+
+static int hv_tlb_flush_stats_show(struct seq_file *m, void *v)
+{
+	struct hv_tlb_flush_stats sum = {};
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct hv_tlb_flush_stats *st = per_cpu_ptr(&hv_tlb_flush_stats, cpu);
+
+		sum.hypercalls += st->hypercalls;
+		sum.skipped += st->skipped;
+		sum.full_flushes += st->full_flushes;
+		sum.native += st->native;
+	}
+
+	seq_printf(m, "hypercalls: %llu\n", sum.hypercalls);
+	seq_printf(m, "skipped: %llu\n", sum.skipped);
+	seq_printf(m, "full_flushes: %llu\n", sum.full_flushes);
+	seq_printf(m, "native: %llu\n", sum.native);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hv_tlb_flush_stats);
+
+static int __init hv_tlb_flush_debugfs_init(void)
+{
+	if (pv_ops.mmu.flush_tlb_multi != hyperv_flush_tlb_multi)
+		return 0;
+
+	debugfs_create_file("hyperv_tlb_flush", 0444, arch_debugfs_dir, NULL,
+			    &hv_tlb_flush_stats_fops);
+	return 0;
+}
+late_initcall(hv_tlb_flush_debugfs_init);
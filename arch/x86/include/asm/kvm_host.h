@@ -582,6 +582,8 @@ struct kvm_vcpu_hv_stimer {
 	u64 exp_time;
 	struct hv_message msg;
 	bool msg_pending;
+	/* Direct mode expiration already posted from the timer callback */
+	bool direct_posted;
 };
 
 /* Hyper-V synthetic interrupt controller (SynIC)*/
@@ -1247,6 +1249,12 @@ struct kvm_arch {
 
 	u32 notify_window;
 	u32 notify_vmexit_flags;
+
+	/*
+	 * KVM_X86_EAGER_PAGE_SPLIT_*, whether huge pages are split when dirty
+	 * logging is enabled; DEFAULT follows the eager_page_split param.
+	 */
+	u8 eager_page_split;
 	/*
 	 * If exit_on_emulation_error is set, and the in-kernel instruction
 	 * emulator fails to emulate an instruction, allow userspace
@@ -1397,6 +1405,11 @@ struct kvm_vcpu_stat {
 	u64 preemption_other;
 	u64 guest_mode;
 	u64 notify_window_exits;
+	u64 hv_stimer_expirations;
+	u64 hv_stimer_posted;
+	u64 hv_synic_irqs;
+	u64 hv_send_ipi;
+	u64 hv_flush_tlb;
 };
 
 struct x86_instruction_info;
@@ -712,6 +712,19 @@ static const struct uprobe_xol_ops push_xol_ops = {
 	.emulate  = push_emulate_op,
 };
 
+/*
+ * 0f 1f /0: the multi-byte NOPs used for padding and by USDT probe sites.
+ * Any prefixes (including 0x66 for nopw) don't change what it does.
+ */
+static bool insn_is_nopl(struct insn *insn)
+{
+	if (insn->opcode.nbytes != 2 ||
+	    OPCODE1(insn) != 0x0f || OPCODE2(insn) != 0x1f)
+		return false;
+
+	return insn->modrm.nbytes && X86_MODRM_REG(insn->modrm.bytes[0]) == 0;
+}
+
 /* Returns -ENOSYS if branch_xol_ops doesn't handle this insn */
 static int branch_setup_xol_ops(struct arch_uprobe *auprobe, struct insn *insn)
 {
@@ -719,6 +732,16 @@ static int branch_setup_xol_ops(struct arch_uprobe *auprobe, struct insn *insn)
 	insn_byte_t p;
 	int i;
 
+	/* Emulate it as "jmp .+0", which saves the single-step trap. */
+	if (insn_is_nopl(insn)) {
+		auprobe->branch.opc1 = 0x90;
+		auprobe->branch.ilen = insn->length;
+		auprobe->branch.offs = 0;
+
+		auprobe->ops = &branch_xol_ops;
+		return 0;
+	}
+
 	switch (opc1) {
 	case 0xeb:	/* jmp 8 */
 	case 0xe9:	/* jmp 32 */
@@ -475,6 +475,7 @@ static int synic_set_irq(struct kvm_vcpu_hv_synic *synic, u32 sint)
 
 	ret = kvm_irq_delivery_to_apic(vcpu->kvm, vcpu->arch.apic, &irq, NULL);
 	trace_kvm_hv_synic_set_irq(vcpu->vcpu_id, sint, irq.vector, ret);
+	++vcpu->stat.hv_synic_irqs;
 	return ret;
 }
 
@@ -588,9 +589,37 @@ static void stimer_cleanup(struct kvm_vcpu_hv_stimer *stimer)
 	clear_bit(stimer->index,
 		  to_hv_vcpu(vcpu)->stimer_pending_bitmap);
 	stimer->msg_pending = false;
+	stimer->direct_posted = false;
 	stimer->exp_time = 0;
 }
 
+static int stimer_notify_direct(struct kvm_vcpu_hv_stimer *stimer);
+
+/*
+ * A one-shot direct mode timer only needs its vector to be delivered, which
+ * with APICv is a posted interrupt that does not force the vCPU out of the
+ * guest.  The remaining bookkeeping (disabling the timer) is left to the next
+ * time the vCPU processes its requests.  Periodic timers must be re-armed by
+ * the vCPU and keep kicking it.
+ */
+static bool stimer_try_post_direct(struct kvm_vcpu_hv_stimer *stimer)
+{
+	struct kvm_vcpu *vcpu = hv_stimer_to_vcpu(stimer);
+
+	if (!stimer->config.direct_mode || stimer->config.periodic ||
+	    !lapic_in_kernel(vcpu) || !kvm_vcpu_apicv_active(vcpu))
+		return false;
+
+	if (stimer_notify_direct(stimer))
+		return false;
+
+	stimer->direct_posted = true;
+	/* Pairs with test_and_clear_bit() in kvm_hv_process_stimers() */
+	smp_mb__before_atomic();
+	++vcpu->stat.hv_stimer_posted;
+	return true;
+}
+
 static enum hrtimer_restart stimer_timer_callback(struct hrtimer *timer)
 {
 	struct kvm_vcpu_hv_stimer *stimer;
@@ -598,7 +627,7 @@ static enum hrtimer_restart stimer_timer_callback(struct hrtimer *timer)
 	stimer = container_of(timer, struct kvm_vcpu_hv_stimer, timer);
 	trace_kvm_hv_stimer_callback(hv_stimer_to_vcpu(stimer)->vcpu_id,
 				     stimer->index);
-	stimer_mark_pending(stimer, true);
+	stimer_mark_pending(stimer, !stimer_try_post_direct(stimer));
 
 	return HRTIMER_NORESTART;
 }
@@ -828,10 +857,14 @@ static void stimer_expiration(struct kvm_vcpu_hv_stimer *stimer)
 	stimer->msg_pending = true;
 	if (!direct)
 		r = stimer_send_msg(stimer);
+	else if (stimer->direct_posted)
+		r = 0;
 	else
 		r = stimer_notify_direct(stimer);
+	stimer->direct_posted = false;
 	trace_kvm_hv_stimer_expiration(hv_stimer_to_vcpu(stimer)->vcpu_id,
 				       stimer->index, direct, r);
+	++hv_stimer_to_vcpu(stimer)->stat.hv_stimer_expirations;
 	if (!r) {
 		stimer->msg_pending = false;
 		if (!(stimer->config.periodic))
@@ -858,7 +891,8 @@ void kvm_hv_process_stimers(struct kvm_vcpu *vcpu)
 				if (exp_time) {
 					time_now =
 						get_time_ref_counter(vcpu->kvm);
-					if (time_now >= exp_time)
+					if (time_now >= exp_time ||
+					    stimer->direct_posted)
 						stimer_expiration(stimer);
 				}
 
@@ -2295,6 +2329,7 @@ int kvm_hv_hypercall(struct kvm_vcpu *vcpu)
 			ret = HV_STATUS_INVALID_HYPERCALL_INPUT;
 			break;
 		}
+		++vcpu->stat.hv_flush_tlb;
 		ret = kvm_hv_flush_tlb(vcpu, &hc);
 		break;
 	case HVCALL_FLUSH_VIRTUAL_ADDRESS_SPACE:
@@ -2308,6 +2343,7 @@ int kvm_hv_hypercall(struct kvm_vcpu *vcpu)
 			ret = HV_STATUS_INVALID_HYPERCALL_INPUT;
 			break;
 		}
+		++vcpu->stat.hv_flush_tlb;
 		ret = kvm_hv_flush_tlb(vcpu, &hc);
 		break;
 	case HVCALL_SEND_IPI:
@@ -2321,6 +2357,7 @@ int kvm_hv_hypercall(struct kvm_vcpu *vcpu)
 			ret = HV_STATUS_INVALID_HYPERCALL_INPUT;
 			break;
 		}
+		++vcpu->stat.hv_send_ipi;
 		ret = kvm_hv_send_ipi(vcpu, &hc);
 		break;
 	case HVCALL_POST_DEBUG_DATA:
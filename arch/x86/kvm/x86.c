@@ -288,6 +288,11 @@ const struct _kvm_stats_desc kvm_vcpu_stats_desc[] = {
 	STATS_DESC_COUNTER(VCPU, preemption_other),
 	STATS_DESC_ICOUNTER(VCPU, guest_mode),
 	STATS_DESC_COUNTER(VCPU, notify_window_exits),
+	STATS_DESC_COUNTER(VCPU, hv_stimer_expirations),
+	STATS_DESC_COUNTER(VCPU, hv_stimer_posted),
+	STATS_DESC_COUNTER(VCPU, hv_synic_irqs),
+	STATS_DESC_COUNTER(VCPU, hv_send_ipi),
+	STATS_DESC_COUNTER(VCPU, hv_flush_tlb),
 };
 
 const struct kvm_stats_header kvm_vcpu_stats_header = {
@@ -4411,6 +4416,9 @@ int kvm_vm_ioctl_check_extension(struct kvm *kvm, long ext)
 	case KVM_CAP_X86_NOTIFY_VMEXIT:
 		r = kvm_caps.has_notify_vmexit;
 		break;
+	case KVM_CAP_X86_EAGER_PAGE_SPLIT:
+		r = 1;
+		break;
 	default:
 		break;
 	}
@@ -6165,6 +6173,19 @@ int kvm_vm_ioctl_enable_cap(struct kvm *kvm,
 		}
 		mutex_unlock(&kvm->lock);
 		break;
+	case KVM_CAP_X86_EAGER_PAGE_SPLIT:
+		r = -EINVAL;
+		if (cap->args[0] > KVM_X86_EAGER_PAGE_SPLIT_DISABLE)
+			break;
+		/*
+		 * Only consulted when dirty logging is turned on for a memslot
+		 * or a range of it is re-protected, both under slots_lock.
+		 */
+		mutex_lock(&kvm->slots_lock);
+		WRITE_ONCE(kvm->arch.eager_page_split, cap->args[0]);
+		mutex_unlock(&kvm->slots_lock);
+		r = 0;
+		break;
 	default:
 		r = -EINVAL;
 		break;
@@ -12296,7 +12317,7 @@ static void kvm_mmu_slot_apply_flags(struct kvm *kvm,
 		if (kvm_dirty_log_manual_protect_and_init_set(kvm))
 			return;
 
-		if (READ_ONCE(eager_page_split))
+		if (kvm_eager_page_split(kvm))
 			kvm_mmu_slot_try_split_huge_pages(kvm, new, PG_LEVEL_4K);
 
 		if (kvm_x86_ops.cpu_dirty_log_size) {
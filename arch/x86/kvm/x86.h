@@ -371,6 +371,18 @@ static inline bool kvm_notify_vmexit_enabled(struct kvm *kvm)
 	return kvm->arch.notify_vmexit_flags & KVM_X86_NOTIFY_VMEXIT_ENABLED;
 }
 
+static inline bool kvm_eager_page_split(struct kvm *kvm)
+{
+	switch (READ_ONCE(kvm->arch.eager_page_split)) {
+	case KVM_X86_EAGER_PAGE_SPLIT_ENABLE:
+		return true;
+	case KVM_X86_EAGER_PAGE_SPLIT_DISABLE:
+		return false;
+	default:
+		return READ_ONCE(eager_page_split);
+	}
+}
+
 enum kvm_intr_type {
 	/* Values are arbitrary, but must be non-zero. */
 	KVM_HANDLING_IRQ = 1,
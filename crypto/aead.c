@@ -116,6 +116,93 @@ int crypto_aead_decrypt(struct aead_request *req)
 }
 EXPORT_SYMBOL_GPL(crypto_aead_decrypt);
 
+static bool aead_batch_native(struct crypto_aead *aead,
+			      struct aead_request **reqs, unsigned int nreqs,
+			      bool enc)
+{
+	unsigned int i;
+
+	if (nreqs < 2 || (crypto_aead_get_flags(aead) & CRYPTO_TFM_NEED_KEY))
+		return false;
+
+	for (i = 0; i < nreqs; i++) {
+		if (crypto_aead_reqtfm(reqs[i]) != aead)
+			return false;
+		if (!enc && reqs[i]->cryptlen < crypto_aead_authsize(aead))
+			return false;
+	}
+
+	return true;
+}
+
+static void aead_crypt_batch(struct crypto_aead *aead,
+			     struct aead_request **reqs, int *errs,
+			     unsigned int nreqs, bool enc)
+{
+	struct crypto_alg *alg = aead->base.__crt_alg;
+	struct aead_alg *aalg = crypto_aead_alg(aead);
+	void (*batch)(struct aead_request **reqs, int *errs,
+		      unsigned int nreqs);
+	unsigned int cryptlen[CRYPTO_BATCH_MAX];
+	unsigned int i;
+
+	batch = enc ? aalg->encrypt_batch : aalg->decrypt_batch;
+	if (!batch || !aead_batch_native(aead, reqs, nreqs, enc)) {
+		for (i = 0; i < nreqs; i++)
+			errs[i] = enc ? crypto_aead_encrypt(reqs[i]) :
+					crypto_aead_decrypt(reqs[i]);
+		return;
+	}
+
+	/* Requests going asynchronous may be freed before we return. */
+	for (i = 0; i < nreqs; i++) {
+		cryptlen[i] = reqs[i]->cryptlen;
+		crypto_stats_get(alg);
+	}
+
+	batch(reqs, errs, nreqs);
+
+	for (i = 0; i < nreqs; i++) {
+		if (enc)
+			crypto_stats_aead_encrypt(cryptlen[i], alg, errs[i]);
+		else
+			crypto_stats_aead_decrypt(cryptlen[i], alg, errs[i]);
+	}
+}
+
+static int crypto_aead_batch(struct aead_request **reqs, int *errs,
+			     unsigned int nreqs, bool enc)
+{
+	unsigned int i, n;
+
+	for (i = 0; i < nreqs; i += n) {
+		n = min_t(unsigned int, nreqs - i, CRYPTO_BATCH_MAX);
+		aead_crypt_batch(crypto_aead_reqtfm(reqs[i]), reqs + i,
+				 errs + i, n, enc);
+	}
+
+	for (i = 0; i < nreqs; i++) {
+		if (errs[i])
+			return errs[i];
+	}
+
+	return 0;
+}
+
+int crypto_aead_encrypt_batch(struct aead_request **reqs, int *errs,
+			      unsigned int nreqs)
+{
+	return crypto_aead_batch(reqs, errs, nreqs, true);
+}
+EXPORT_SYMBOL_GPL(crypto_aead_encrypt_batch);
+
+int crypto_aead_decrypt_batch(struct aead_request **reqs, int *errs,
+			      unsigned int nreqs)
+{
+	return crypto_aead_batch(reqs, errs, nreqs, false);
+}
+EXPORT_SYMBOL_GPL(crypto_aead_decrypt_batch);
+
 static void crypto_aead_exit_tfm(struct crypto_tfm *tfm)
 {
 	struct crypto_aead *aead = __crypto_aead_cast(tfm);
@@ -382,6 +382,74 @@ int crypto_ahash_digest(struct ahash_request *req)
 }
 EXPORT_SYMBOL_GPL(crypto_ahash_digest);
 
+static bool ahash_batch_native(struct crypto_ahash *tfm,
+			       struct ahash_request **reqs, unsigned int nreqs)
+{
+	unsigned long alignmask = crypto_ahash_alignmask(tfm);
+	unsigned int i;
+
+	if (!tfm->digest_batch || nreqs < 2 ||
+	    (crypto_ahash_get_flags(tfm) & CRYPTO_TFM_NEED_KEY))
+		return false;
+
+	for (i = 0; i < nreqs; i++) {
+		if (crypto_ahash_reqtfm(reqs[i]) != tfm ||
+		    ((unsigned long)reqs[i]->result & alignmask))
+			return false;
+	}
+
+	return true;
+}
+
+static void ahash_digest_batch(struct crypto_ahash *tfm,
+			       struct ahash_request **reqs, int *errs,
+			       unsigned int nreqs)
+{
+	struct crypto_alg *alg = tfm->base.__crt_alg;
+	unsigned int nbytes[CRYPTO_BATCH_MAX];
+	unsigned int i;
+
+	if (!ahash_batch_native(tfm, reqs, nreqs)) {
+		for (i = 0; i < nreqs; i++)
+			errs[i] = crypto_ahash_digest(reqs[i]);
+		return;
+	}
+
+	/* Requests going asynchronous may be freed before we return. */
+	for (i = 0; i < nreqs; i++) {
+		nbytes[i] = reqs[i]->nbytes;
+		crypto_stats_get(alg);
+	}
+
+	tfm->digest_batch(reqs, errs, nreqs);
+
+	for (i = 0; i < nreqs; i++)
+		crypto_stats_ahash_final(nbytes[i], errs[i], alg);
+}
+
+int crypto_ahash_digest_batch(struct ahash_request **reqs, int *errs,
+			      unsigned int nreqs)
+{
+	unsigned int i, n;
+
+	if (!nreqs)
+		return 0;
+
+	for (i = 0; i < nreqs; i += n) {
+		n = min_t(unsigned int, nreqs - i, CRYPTO_BATCH_MAX);
+		ahash_digest_batch(crypto_ahash_reqtfm(reqs[i]), reqs + i,
+				   errs + i, n);
+	}
+
+	for (i = 0; i < nreqs; i++) {
+		if (errs[i])
+			return errs[i];
+	}
+
+	return 0;
+}
+EXPORT_SYMBOL_GPL(crypto_ahash_digest_batch);
+
 static void ahash_def_finup_done2(struct crypto_async_request *req, int err)
 {
 	struct ahash_request *areq = req->data;
@@ -469,6 +537,7 @@ static int crypto_ahash_init_tfm(struct crypto_tfm *tfm)
 	hash->digest = alg->digest;
 	hash->export = alg->export;
 	hash->import = alg->import;
+	hash->digest_batch = alg->digest_batch;
 
 	if (alg->setkey) {
 		hash->setkey = alg->setkey;
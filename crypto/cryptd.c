@@ -31,17 +31,32 @@ static unsigned int cryptd_max_cpu_qlen = 1000;
 module_param(cryptd_max_cpu_qlen, uint, 0);
 MODULE_PARM_DESC(cryptd_max_cpu_qlen, "Set cryptd Max queue depth");
 
+static unsigned int cryptd_steal_qlen = 16;
+module_param(cryptd_steal_qlen, uint, 0644);
+MODULE_PARM_DESC(cryptd_steal_qlen,
+		 "Queue depth above which idle CPUs on the same node steal work (0 = off)");
+
 static struct workqueue_struct *cryptd_wq;
 
 struct cryptd_cpu_queue {
 	struct crypto_queue queue;
 	struct work_struct work;
+	spinlock_t lock;
+	struct cryptd_queue *parent;
+	unsigned long stolen;
+	/* Queued requests of tfms from cryptd_alloc_*(), never stolen. */
+	unsigned int nr_ordered;
+	int cpu;
 };
 
 struct cryptd_queue {
 	/*
-	 * Protected by disabling BH to allow enqueueing from softinterrupt and
-	 * dequeuing from kworker (cryptd_queue_worker()).
+	 * The lock of each per-CPU queue is taken with BH disabled to allow
+	 * enqueueing from softinterrupt and dequeuing from kworker
+	 * (cryptd_queue_worker()), including by workers of other CPUs that
+	 * steal from a backed up queue. Users of cryptd_*_queued() rely on
+	 * their requests completing in order, so a queue holding any of them
+	 * is left to its own worker.
 	 */
 	struct cryptd_cpu_queue __percpu *cpu_queue;
 };
@@ -109,6 +124,9 @@ static int cryptd_init_queue(struct cryptd_queue *queue,
 		cpu_queue = per_cpu_ptr(queue->cpu_queue, cpu);
 		crypto_init_queue(&cpu_queue->queue, max_cpu_qlen);
 		INIT_WORK(&cpu_queue->work, cryptd_queue_worker);
+		spin_lock_init(&cpu_queue->lock);
+		cpu_queue->parent = queue;
+		cpu_queue->cpu = cpu;
 	}
 	pr_info("cryptd: max_cpu_qlen set to %d\n", max_cpu_qlen);
 	return 0;
@@ -126,24 +144,56 @@ static void cryptd_fini_queue(struct cryptd_queue *queue)
 	free_percpu(queue->cpu_queue);
 }
 
+/*
+ * Kick the worker of an idle CPU on the same node as @cpu_queue so that it
+ * steals from the backlog instead of waiting behind the local worker.
+ */
+static void cryptd_kick_idle(struct cryptd_cpu_queue *cpu_queue)
+{
+	const struct cpumask *node_mask = cpumask_of_node(cpu_to_node(cpu_queue->cpu));
+	struct cryptd_cpu_queue *idle;
+	int cpu;
+
+	for_each_cpu_and(cpu, node_mask, cpu_online_mask) {
+		if (cpu == cpu_queue->cpu)
+			continue;
+		idle = per_cpu_ptr(cpu_queue->parent->cpu_queue, cpu);
+		if (!READ_ONCE(idle->queue.qlen) && !work_pending(&idle->work)) {
+			queue_work_on(cpu, cryptd_wq, &idle->work);
+			return;
+		}
+	}
+}
+
 static int cryptd_enqueue_request(struct cryptd_queue *queue,
 				  struct crypto_async_request *request)
 {
 	int err;
 	struct cryptd_cpu_queue *cpu_queue;
+	unsigned int steal_qlen = READ_ONCE(cryptd_steal_qlen);
+	unsigned int qlen, nr_ordered;
 	refcount_t *refcnt;
 
+	refcnt = crypto_tfm_ctx(request->tfm);
+
 	local_bh_disable();
 	cpu_queue = this_cpu_ptr(queue->cpu_queue);
+	spin_lock(&cpu_queue->lock);
 	err = crypto_enqueue_request(&cpu_queue->queue, request);
-
-	refcnt = crypto_tfm_ctx(request->tfm);
+	if (err != -ENOSPC && refcount_read(refcnt))
+		cpu_queue->nr_ordered++;
+	qlen = cpu_queue->queue.qlen;
+	nr_ordered = cpu_queue->nr_ordered;
+	spin_unlock(&cpu_queue->lock);
 
 	if (err == -ENOSPC)
 		goto out;
 
 	queue_work_on(smp_processor_id(), cryptd_wq, &cpu_queue->work);
 
+	if (steal_qlen && qlen > steal_qlen && !nr_ordered)
+		cryptd_kick_idle(cpu_queue);
+
 	if (!refcount_read(refcnt))
 		goto out;
 
@@ -155,31 +205,85 @@ static int cryptd_enqueue_request(struct cryptd_queue *queue,
 	return err;
 }
 
+static struct crypto_async_request *
+cryptd_dequeue(struct cryptd_cpu_queue *cpu_queue,
+	       struct crypto_async_request **backlog, bool steal)
+{
+	struct crypto_async_request *req = NULL;
+
+	*backlog = NULL;
+
+	spin_lock_bh(&cpu_queue->lock);
+	if (steal && cpu_queue->nr_ordered)
+		goto out;
+
+	*backlog = crypto_get_backlog(&cpu_queue->queue);
+	req = crypto_dequeue_request(&cpu_queue->queue);
+	if (req && refcount_read(crypto_tfm_ctx(req->tfm)))
+		cpu_queue->nr_ordered--;
+out:
+	spin_unlock_bh(&cpu_queue->lock);
+
+	return req;
+}
+
+/*
+ * Find the most backed up queue on the node of @cpu_queue whose depth
+ * exceeds the steal threshold and that holds no ordered requests.
+ */
+static struct cryptd_cpu_queue *cryptd_find_victim(struct cryptd_cpu_queue *cpu_queue)
+{
+	const struct cpumask *node_mask = cpumask_of_node(cpu_to_node(cpu_queue->cpu));
+	unsigned int qlen, max_qlen = READ_ONCE(cryptd_steal_qlen);
+	struct cryptd_cpu_queue *victim = NULL, *cur;
+	int cpu;
+
+	if (!max_qlen)
+		return NULL;
+
+	for_each_cpu_and(cpu, node_mask, cpu_online_mask) {
+		if (cpu == cpu_queue->cpu)
+			continue;
+		cur = per_cpu_ptr(cpu_queue->parent->cpu_queue, cpu);
+		qlen = READ_ONCE(cur->queue.qlen);
+		if (qlen > max_qlen && !READ_ONCE(cur->nr_ordered)) {
+			max_qlen = qlen;
+			victim = cur;
+		}
+	}
+
+	return victim;
+}
+
 /* Called in workqueue context, do one real cryption work (via
  * req->complete) and reschedule itself if there are more work to
- * do. */
+ * do. An idle worker steals from a backed up queue on its node. */
 static void cryptd_queue_worker(struct work_struct *work)
 {
-	struct cryptd_cpu_queue *cpu_queue;
+	struct cryptd_cpu_queue *cpu_queue, *victim = NULL;
 	struct crypto_async_request *req, *backlog;
 
 	cpu_queue = container_of(work, struct cryptd_cpu_queue, work);
 	/*
 	 * Only handle one request at a time to avoid hogging crypto workqueue.
 	 */
-	local_bh_disable();
-	backlog = crypto_get_backlog(&cpu_queue->queue);
-	req = crypto_dequeue_request(&cpu_queue->queue);
-	local_bh_enable();
-
-	if (!req)
-		return;
+	req = cryptd_dequeue(cpu_queue, &backlog, false);
+	if (!req) {
+		victim = cryptd_find_victim(cpu_queue);
+		if (!victim)
+			return;
+		req = cryptd_dequeue(victim, &backlog, true);
+		if (!req)
+			return;
+		cpu_queue->stolen++;
+	}
 
 	if (backlog)
 		backlog->complete(backlog, -EINPROGRESS);
 	req->complete(req, 0);
 
-	if (cpu_queue->queue.qlen)
+	if (READ_ONCE(cpu_queue->queue.qlen) ||
+	    (victim && READ_ONCE(victim->queue.qlen) > READ_ONCE(cryptd_steal_qlen)))
 		queue_work(cryptd_wq, &cpu_queue->work);
 }
 
@@ -874,6 +978,34 @@ static int cryptd_create_aead(struct crypto_template *tmpl,
 
 static struct cryptd_queue queue;
 
+/*
+ * Report "cpu qlen stolen" for each online CPU through
+ * /sys/module/cryptd/parameters/cpu_queues.
+ */
+static int cryptd_cpu_queues_get(char *buffer, const struct kernel_param *kp)
+{
+	struct cryptd_cpu_queue *cpu_queue;
+	int cpu, len = 0;
+
+	if (!queue.cpu_queue)
+		return 0;
+
+	for_each_online_cpu(cpu) {
+		cpu_queue = per_cpu_ptr(queue.cpu_queue, cpu);
+		len += scnprintf(buffer + len, PAGE_SIZE - len, "%d %u %lu\n",
+				 cpu, READ_ONCE(cpu_queue->queue.qlen),
+				 READ_ONCE(cpu_queue->stolen));
+	}
+
+	return len;
+}
+
+static const struct kernel_param_ops cryptd_cpu_queues_ops = {
+	.get = cryptd_cpu_queues_get,
+};
+module_param_cb(cpu_queues, &cryptd_cpu_queues_ops, NULL, 0444);
+MODULE_PARM_DESC(cpu_queues, "Per-CPU queue depth and stolen request count");
+
 static int cryptd_create(struct crypto_template *tmpl, struct rtattr **tb)
 {
 	struct crypto_attr_type *algt;
@@ -8,14 +8,63 @@
  */
 
 #include <linux/err.h>
+#include <linux/debugfs.h>
 #include <linux/delay.h>
 #include <linux/device.h>
+#include <linux/ktime.h>
+#include <linux/seq_file.h>
 #include <crypto/engine.h>
 #include <uapi/linux/sched/types.h>
 #include "internal.h"
 
 #define CRYPTO_ENGINE_MAX_QLEN 10
 
+static struct dentry *crypto_engine_debugfs_root;
+
+/*
+ * Engines that advertise a queue depth or support retry keep several
+ * requests in flight instead of tracking a single current request.
+ */
+static inline bool crypto_engine_pipelined(struct crypto_engine *engine)
+{
+	return engine->retry_support || engine->qdepth > 1;
+}
+
+static inline bool crypto_engine_full(struct crypto_engine *engine)
+{
+	return engine->qdepth && engine->inflight >= engine->qdepth;
+}
+
+static void crypto_engine_inflight_add(struct crypto_engine *engine,
+				       int delta)
+{
+	u64 now = ktime_get_ns();
+
+	lockdep_assert_held(&engine->queue_lock);
+
+	engine->stats.inflight_ns += (u64)engine->inflight *
+				     (now - engine->stats.last_ns);
+	engine->stats.last_ns = now;
+	engine->inflight += delta;
+
+	if (delta > 0) {
+		engine->stats.dispatched++;
+		if (engine->inflight > engine->stats.max_inflight)
+			engine->stats.max_inflight = engine->inflight;
+	}
+}
+
+/* A dispatched request failed before reaching the hardware. */
+static void crypto_engine_request_done(struct crypto_engine *engine)
+{
+	unsigned long flags;
+
+	spin_lock_irqsave(&engine->queue_lock, flags);
+	crypto_engine_inflight_add(engine, -1);
+	engine->stats.completed++;
+	spin_unlock_irqrestore(&engine->queue_lock, flags);
+}
+
 /**
  * crypto_finalize_request - finalize one request if the request is done
  * @engine: the hardware engine
@@ -30,21 +79,25 @@ static void crypto_finalize_request(struct crypto_engine *engine,
 	int ret;
 	struct crypto_engine_ctx *enginectx;
 
+	spin_lock_irqsave(&engine->queue_lock, flags);
 	/*
 	 * If hardware cannot enqueue more requests
 	 * and retry mechanism is not supported
 	 * make sure we are completing the current request
 	 */
-	if (!engine->retry_support) {
-		spin_lock_irqsave(&engine->queue_lock, flags);
+	if (!crypto_engine_pipelined(engine)) {
 		if (engine->cur_req == req) {
 			finalize_req = true;
 			engine->cur_req = NULL;
 		}
-		spin_unlock_irqrestore(&engine->queue_lock, flags);
 	}
+	if (finalize_req || crypto_engine_pipelined(engine)) {
+		crypto_engine_inflight_add(engine, -1);
+		engine->stats.completed++;
+	}
+	spin_unlock_irqrestore(&engine->queue_lock, flags);
 
-	if (finalize_req || engine->retry_support) {
+	if (finalize_req || crypto_engine_pipelined(engine)) {
 		enginectx = crypto_tfm_ctx(req->tfm);
 		if (enginectx->op.prepare_request &&
 		    enginectx->op.unprepare_request) {
@@ -80,7 +133,7 @@ static void crypto_pump_requests(struct crypto_engine *engine,
 	spin_lock_irqsave(&engine->queue_lock, flags);
 
 	/* Make sure we are not already running a request */
-	if (!engine->retry_support && engine->cur_req)
+	if (!crypto_engine_pipelined(engine) && engine->cur_req)
 		goto out;
 
 	/* If another context is idling then defer */
@@ -115,6 +168,10 @@ static void crypto_pump_requests(struct crypto_engine *engine,
 	}
 
 start_request:
+	/* Leave the rest queued while the hardware queue is full */
+	if (crypto_engine_full(engine))
+		goto out;
+
 	/* Get the fist request from the engine queue to handle */
 	backlog = crypto_get_backlog(&engine->queue);
 	async_req = crypto_dequeue_request(&engine->queue);
@@ -126,8 +183,9 @@ static void crypto_pump_requests(struct crypto_engine *engine,
 	 * keep track of the request we are processing now.
 	 * We'll need it on completion (crypto_finalize_request).
 	 */
-	if (!engine->retry_support)
+	if (!crypto_engine_pipelined(engine))
 		engine->cur_req = async_req;
+	crypto_engine_inflight_add(engine, 1);
 
 	if (backlog)
 		backlog->complete(backlog, -EINPROGRESS);
@@ -173,7 +231,7 @@ static void crypto_pump_requests(struct crypto_engine *engine,
 		 * regardless of backlog flag.
 		 * Otherwise, unprepare and complete the request.
 		 */
-		if (!engine->retry_support ||
+		if (!crypto_engine_pipelined(engine) ||
 		    (ret != -ENOSPC)) {
 			dev_err(engine->dev,
 				"Failed to do one request from queue: %d\n",
@@ -193,6 +251,8 @@ static void crypto_pump_requests(struct crypto_engine *engine,
 					"failed to unprepare request\n");
 		}
 		spin_lock_irqsave(&engine->queue_lock, flags);
+		crypto_engine_inflight_add(engine, -1);
+		engine->stats.requeued++;
 		/*
 		 * If hardware was unable to execute request, enqueue it
 		 * back in front of crypto-engine queue, to keep the order
@@ -214,11 +274,19 @@ static void crypto_pump_requests(struct crypto_engine *engine,
 	}
 
 req_err_2:
+	if (!crypto_engine_pipelined(engine)) {
+		/* Nothing will finalize it, let the next request in. */
+		spin_lock_irqsave(&engine->queue_lock, flags);
+		engine->cur_req = NULL;
+		spin_unlock_irqrestore(&engine->queue_lock, flags);
+		kthread_queue_work(engine->kworker, &engine->pump_requests);
+	}
+	crypto_engine_request_done(engine);
 	async_req->complete(async_req, ret);
 
 retry:
-	/* If retry mechanism is supported, send new requests to engine */
-	if (engine->retry_support) {
+	/* If several requests may be in flight, send new ones to engine */
+	if (crypto_engine_pipelined(engine)) {
 		spin_lock_irqsave(&engine->queue_lock, flags);
 		goto start_request;
 	}
@@ -424,6 +492,37 @@ void crypto_finalize_skcipher_request(struct crypto_engine *engine,
 }
 EXPORT_SYMBOL_GPL(crypto_finalize_skcipher_request);
 
+/**
+ * crypto_engine_set_qdepth - advertise the hardware queue depth
+ * @engine: the hardware engine
+ * @qdepth: maximum number of requests the hardware can process at once
+ *
+ * With a @qdepth above one the engine keeps up to @qdepth requests in
+ * flight: the request pump calls do_one_request() for queued requests
+ * until that many are outstanding, and each finalize call lets it submit
+ * another one. do_one_request() may return -ENOSPC to have a request put
+ * back at the head of the queue. For engines created with retry support
+ * @qdepth bounds the otherwise unlimited number of requests in flight.
+ *
+ * Must be called before crypto_engine_start().
+ * Return 0 on success, else on fail.
+ */
+int crypto_engine_set_qdepth(struct crypto_engine *engine, unsigned int qdepth)
+{
+	unsigned long flags;
+	int ret = 0;
+
+	spin_lock_irqsave(&engine->queue_lock, flags);
+	if (engine->running || engine->busy)
+		ret = -EBUSY;
+	else
+		engine->qdepth = qdepth;
+	spin_unlock_irqrestore(&engine->queue_lock, flags);
+
+	return ret;
+}
+EXPORT_SYMBOL_GPL(crypto_engine_set_qdepth);
+
 /**
  * crypto_engine_start - start the hardware engine
  * @engine: the hardware engine need to be started
@@ -488,6 +587,38 @@ int crypto_engine_stop(struct crypto_engine *engine)
 }
 EXPORT_SYMBOL_GPL(crypto_engine_stop);
 
+static int crypto_engine_stats_show(struct seq_file *s, void *unused)
+{
+	struct crypto_engine *engine = s->private;
+	struct crypto_engine_stats stats;
+	unsigned int inflight, queued;
+	unsigned long flags;
+	u64 avg_ns = 0;
+
+	spin_lock_irqsave(&engine->queue_lock, flags);
+	/* Bring the latency integral up to date. */
+	crypto_engine_inflight_add(engine, 0);
+	stats = engine->stats;
+	inflight = engine->inflight;
+	queued = crypto_queue_len(&engine->queue);
+	spin_unlock_irqrestore(&engine->queue_lock, flags);
+
+	if (stats.completed)
+		avg_ns = div64_u64(stats.inflight_ns, stats.completed);
+
+	seq_printf(s, "qdepth: %u\n", engine->qdepth);
+	seq_printf(s, "queued: %u\n", queued);
+	seq_printf(s, "inflight: %u\n", inflight);
+	seq_printf(s, "max_inflight: %u\n", stats.max_inflight);
+	seq_printf(s, "dispatched: %llu\n", stats.dispatched);
+	seq_printf(s, "completed: %llu\n", stats.completed);
+	seq_printf(s, "requeued: %llu\n", stats.requeued);
+	seq_printf(s, "avg_latency_ns: %llu\n", avg_ns);
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(crypto_engine_stats);
+
 /**
  * crypto_engine_alloc_init_and_set - allocate crypto hardware engine structure
  * and initialize it by setting the maximum number of entries in the software
@@ -538,6 +669,7 @@ struct crypto_engine *crypto_engine_alloc_init_and_set(struct device *dev,
 
 	crypto_init_queue(&engine->queue, qlen);
 	spin_lock_init(&engine->queue_lock);
+	engine->stats.last_ns = ktime_get_ns();
 
 	engine->kworker = kthread_create_worker(0, "%s", engine->name);
 	if (IS_ERR(engine->kworker)) {
@@ -551,6 +683,11 @@ struct crypto_engine *crypto_engine_alloc_init_and_set(struct device *dev,
 		sched_set_fifo(engine->kworker->task);
 	}
 
+	engine->debugfs = debugfs_create_dir(engine->name,
+					     crypto_engine_debugfs_root);
+	debugfs_create_file("stats", 0444, engine->debugfs, engine,
+			    &crypto_engine_stats_fops);
+
 	return engine;
 }
 EXPORT_SYMBOL_GPL(crypto_engine_alloc_init_and_set);
@@ -585,11 +722,26 @@ int crypto_engine_exit(struct crypto_engine *engine)
 	if (ret)
 		return ret;
 
+	debugfs_remove_recursive(engine->debugfs);
 	kthread_destroy_worker(engine->kworker);
 
 	return 0;
 }
 EXPORT_SYMBOL_GPL(crypto_engine_exit);
 
+static int __init crypto_engine_init(void)
+{
+	crypto_engine_debugfs_root = debugfs_create_dir("crypto_engine", NULL);
+	return 0;
+}
+
+static void __exit crypto_engine_fini(void)
+{
+	debugfs_remove_recursive(crypto_engine_debugfs_root);
+}
+
+subsys_initcall(crypto_engine_init);
+module_exit(crypto_engine_fini);
+
 MODULE_LICENSE("GPL");
 MODULE_DESCRIPTION("Crypto hardware engine framework");
@@ -168,20 +168,46 @@ static int pcrypt_aead_decrypt(struct aead_request *req)
 	return err;
 }
 
+/*
+ * Spread the serialization callbacks of the tfms round-robin over the
+ * online CPUs of the node the tfm is set up on, so that the serial work
+ * runs next to the parallel work queued from that node. Fall back to all
+ * online CPUs if the node has none.
+ */
+static unsigned int pcrypt_pick_cb_cpu(struct pcrypt_instance_ctx *ictx)
+{
+	const struct cpumask *node_mask = cpumask_of_node(numa_node_id());
+	unsigned int count, cpu_index, weight = 0;
+	int cpu;
+
+	count = (unsigned int)atomic_inc_return(&ictx->tfm_count);
+
+	for_each_cpu_and(cpu, node_mask, cpu_online_mask)
+		weight++;
+
+	if (weight) {
+		cpu_index = count % weight;
+		for_each_cpu_and(cpu, node_mask, cpu_online_mask)
+			if (!cpu_index--)
+				return cpu;
+	}
+
+	cpu_index = count % cpumask_weight(cpu_online_mask);
+	cpu = cpumask_first(cpu_online_mask);
+	while (cpu_index--)
+		cpu = cpumask_next(cpu, cpu_online_mask);
+
+	return cpu;
+}
+
 static int pcrypt_aead_init_tfm(struct crypto_aead *tfm)
 {
-	int cpu, cpu_index;
 	struct aead_instance *inst = aead_alg_instance(tfm);
 	struct pcrypt_instance_ctx *ictx = aead_instance_ctx(inst);
 	struct pcrypt_aead_ctx *ctx = crypto_aead_ctx(tfm);
 	struct crypto_aead *cipher;
 
-	cpu_index = (unsigned int)atomic_inc_return(&ictx->tfm_count) %
-		    cpumask_weight(cpu_online_mask);
-
-	ctx->cb_cpu = cpumask_first(cpu_online_mask);
-	for (cpu = 0; cpu < cpu_index; cpu++)
-		ctx->cb_cpu = cpumask_next(ctx->cb_cpu, cpu_online_mask);
+	ctx->cb_cpu = pcrypt_pick_cb_cpu(ictx);
 
 	cipher = crypto_spawn_aead(&ictx->spawn);
 
@@ -33,6 +33,7 @@
 #include <linux/debugfs.h>
 #include <linux/cpuhotplug.h>
 #include <linux/part_stat.h>
+#include <linux/workqueue.h>
 
 #include "zram_drv.h"
 
@@ -51,6 +52,13 @@ static unsigned int num_devices = 1;
  */
 static size_t huge_class_size;
 
+/*
+ * Large write bios are cut into batches of ZRAM_WRITE_BATCH pages which
+ * are compressed in parallel on zram_write_wq.
+ */
+#define ZRAM_WRITE_BATCH	8
+static struct workqueue_struct *zram_write_wq;
+
 static const struct block_device_operations zram_devops;
 static const struct block_device_operations zram_wb_devops;
 
@@ -59,18 +67,47 @@ static int zram_bvec_read(struct zram *zram, struct bio_vec *bvec,
 				u32 index, int offset, struct bio *bio);
 
 
+/*
+ * The slot lock doubles as the write side of a sequence count for
+ * zram_read_same_lockless(): ZRAM_LOCK is the odd state and the upper
+ * half of the flags is bumped on unlock. The barriers order the slot
+ * updates between the two, as raw_write_seqcount_begin()/end() do.
+ */
+static inline void zram_slot_write_begin(struct zram *zram, u32 index)
+{
+#ifdef ZRAM_SEQ_SHIFT
+	/* Pairs with the second smp_rmb() in zram_read_same_lockless() */
+	smp_wmb();
+#endif
+}
+
+static inline void zram_slot_write_end(struct zram *zram, u32 index)
+{
+#ifdef ZRAM_SEQ_SHIFT
+	/* Pairs with the first smp_rmb() in zram_read_same_lockless() */
+	smp_wmb();
+	WRITE_ONCE(zram->table[index].flags,
+		   zram->table[index].flags + (1UL << ZRAM_SEQ_SHIFT));
+#endif
+}
+
 static int zram_slot_trylock(struct zram *zram, u32 index)
 {
-	return bit_spin_trylock(ZRAM_LOCK, &zram->table[index].flags);
+	if (!bit_spin_trylock(ZRAM_LOCK, &zram->table[index].flags))
+		return 0;
+	zram_slot_write_begin(zram, index);
+	return 1;
 }
 
 static void zram_slot_lock(struct zram *zram, u32 index)
 {
 	bit_spin_lock(ZRAM_LOCK, &zram->table[index].flags);
+	zram_slot_write_begin(zram, index);
 }
 
 static void zram_slot_unlock(struct zram *zram, u32 index)
 {
+	zram_slot_write_end(zram, index);
 	bit_spin_unlock(ZRAM_LOCK, &zram->table[index].flags);
 }
 
@@ -137,6 +174,16 @@ static void zram_set_obj_size(struct zram *zram,
 	zram->table[index].flags = (flags << ZRAM_FLAG_SHIFT) | size;
 }
 
+/* The compression backend which produced the object stored at @index */
+static inline struct zcomp *zram_slot_comp(struct zram *zram, u32 index)
+{
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram_test_flag(zram, index, ZRAM_RECOMP))
+		return zram->recomp;
+#endif
+	return zram->comp;
+}
+
 static inline bool zram_allocated(struct zram *zram, u32 index)
 {
 	return zram_get_obj_size(zram, index) ||
@@ -641,6 +688,7 @@ static int read_from_bdev_async(struct zram *zram, struct bio_vec *bvec,
 #define PAGE_WRITEBACK 0
 #define HUGE_WRITEBACK (1<<0)
 #define IDLE_WRITEBACK (1<<1)
+#define INCOMPRESSIBLE_WRITEBACK (1<<2)
 
 
 static ssize_t writeback_store(struct device *dev,
@@ -662,6 +710,8 @@ static ssize_t writeback_store(struct device *dev,
 		mode = HUGE_WRITEBACK;
 	else if (sysfs_streq(buf, "huge_idle"))
 		mode = IDLE_WRITEBACK | HUGE_WRITEBACK;
+	else if (sysfs_streq(buf, "incompressible"))
+		mode = INCOMPRESSIBLE_WRITEBACK;
 	else {
 		if (strncmp(buf, PAGE_WB_SIG, sizeof(PAGE_WB_SIG) - 1))
 			return -EINVAL;
@@ -729,6 +779,9 @@ static ssize_t writeback_store(struct device *dev,
 		if (mode & HUGE_WRITEBACK &&
 			  !zram_test_flag(zram, index, ZRAM_HUGE))
 			goto next;
+		if (mode & INCOMPRESSIBLE_WRITEBACK &&
+			  !zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+			goto next;
 		/*
 		 * Clearing ZRAM_UNDER_WB is duty of caller.
 		 * IOW, zram_free_page never clear it.
@@ -929,13 +982,16 @@ static ssize_t read_block_state(struct file *file, char __user *buf,
 
 		ts = ktime_to_timespec64(zram->table[index].ac_time);
 		copied = snprintf(kbuf + written, count,
-			"%12zd %12lld.%06lu %c%c%c%c\n",
+			"%12zd %12lld.%06lu %c%c%c%c%c%c\n",
 			index, (s64)ts.tv_sec,
 			ts.tv_nsec / NSEC_PER_USEC,
 			zram_test_flag(zram, index, ZRAM_SAME) ? 's' : '.',
 			zram_test_flag(zram, index, ZRAM_WB) ? 'w' : '.',
 			zram_test_flag(zram, index, ZRAM_HUGE) ? 'h' : '.',
-			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.');
+			zram_test_flag(zram, index, ZRAM_IDLE) ? 'i' : '.',
+			zram_test_flag(zram, index, ZRAM_RECOMP) ? 'r' : '.',
+			zram_test_flag(zram, index,
+				       ZRAM_INCOMPRESSIBLE) ? 'n' : '.');
 
 		if (count <= copied) {
 			zram_slot_unlock(zram, index);
@@ -1050,6 +1106,213 @@ static ssize_t comp_algorithm_store(struct device *dev,
 	return len;
 }
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static ssize_t recomp_algorithm_show(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	size_t sz;
+	struct zram *zram = dev_to_zram(dev);
+
+	down_read(&zram->init_lock);
+	sz = zcomp_available_show(zram->recomp_algorithm, buf);
+	up_read(&zram->init_lock);
+
+	return sz;
+}
+
+static ssize_t recomp_algorithm_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	char compressor[ARRAY_SIZE(zram->recomp_algorithm)];
+	size_t sz;
+
+	strlcpy(compressor, buf, sizeof(compressor));
+	/* ignore trailing newline */
+	sz = strlen(compressor);
+	if (sz > 0 && compressor[sz - 1] == '\n')
+		compressor[sz - 1] = 0x00;
+
+	if (!zcomp_available_algorithm(compressor))
+		return -EINVAL;
+
+	down_write(&zram->init_lock);
+	if (init_done(zram)) {
+		up_write(&zram->init_lock);
+		pr_info("Can't change algorithm for initialized device\n");
+		return -EBUSY;
+	}
+
+	strcpy(zram->recomp_algorithm, compressor);
+	up_write(&zram->init_lock);
+	return len;
+}
+
+#define HUGE_RECOMP (1<<0)
+#define IDLE_RECOMP (1<<1)
+
+/*
+ * Recompress the object at @index with the secondary algorithm. @page is
+ * a scratch page. Called with the slot locked.
+ */
+static int zram_recompress(struct zram *zram, u32 index, struct page *page)
+{
+	unsigned long handle_old, handle_new;
+	unsigned int size_old, size_new;
+	struct zcomp_strm *zstrm;
+	bool idle;
+	void *src, *dst;
+	int ret;
+
+	handle_old = zram_get_handle(zram, index);
+	size_old = zram_get_obj_size(zram, index);
+
+	src = zs_map_object(zram->mem_pool, handle_old, ZS_MM_RO);
+	dst = kmap_atomic(page);
+	if (size_old == PAGE_SIZE) {
+		memcpy(dst, src, PAGE_SIZE);
+		ret = 0;
+	} else {
+		zstrm = zcomp_stream_get(zram->comp);
+		ret = zcomp_decompress(zstrm, src, size_old, dst);
+		zcomp_stream_put(zram->comp);
+	}
+	kunmap_atomic(dst);
+	zs_unmap_object(zram->mem_pool, handle_old);
+	if (ret)
+		return ret;
+
+	zstrm = zcomp_stream_get(zram->recomp);
+	src = kmap_atomic(page);
+	ret = zcomp_compress(zstrm, src, &size_new);
+	kunmap_atomic(src);
+	if (ret) {
+		zcomp_stream_put(zram->recomp);
+		return ret;
+	}
+
+	/*
+	 * Not worth keeping if it doesn't shrink the object. Remember that
+	 * so the page is neither tried again nor kept out of writeback.
+	 */
+	if (size_new >= size_old || size_new >= huge_class_size) {
+		zcomp_stream_put(zram->recomp);
+		zram_set_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+		return 0;
+	}
+
+	/* The slot is locked so we must not enter direct reclaim here */
+	handle_new = zs_malloc(zram->mem_pool, size_new,
+			__GFP_KSWAPD_RECLAIM |
+			__GFP_NOWARN |
+			__GFP_HIGHMEM |
+			__GFP_MOVABLE);
+	if (!handle_new) {
+		zcomp_stream_put(zram->recomp);
+		return -ENOMEM;
+	}
+
+	dst = zs_map_object(zram->mem_pool, handle_new, ZS_MM_WO);
+	memcpy(dst, zstrm->buffer, size_new);
+	zs_unmap_object(zram->mem_pool, handle_new);
+	zcomp_stream_put(zram->recomp);
+
+	/* zram_free_page() resets IDLE and the access time, keep both */
+	idle = zram_test_flag(zram, index, ZRAM_IDLE);
+#ifdef CONFIG_ZRAM_MEMORY_TRACKING
+	{
+		ktime_t ac_time = zram->table[index].ac_time;
+
+		zram_free_page(zram, index);
+		zram->table[index].ac_time = ac_time;
+	}
+#else
+	zram_free_page(zram, index);
+#endif
+	zram_set_handle(zram, index, handle_new);
+	zram_set_obj_size(zram, index, size_new);
+	zram_set_flag(zram, index, ZRAM_RECOMP);
+	if (idle)
+		zram_set_flag(zram, index, ZRAM_IDLE);
+
+	atomic64_add(size_new, &zram->stats.compr_data_size);
+	atomic64_inc(&zram->stats.pages_stored);
+	atomic64_inc(&zram->stats.recomp_pages);
+	atomic64_add(size_new, &zram->stats.recomp_data_size);
+	atomic64_add(size_old - size_new, &zram->stats.recomp_saved);
+	return 0;
+}
+
+static ssize_t recompress_store(struct device *dev,
+		struct device_attribute *attr, const char *buf, size_t len)
+{
+	struct zram *zram = dev_to_zram(dev);
+	unsigned long nr_pages = zram->disksize >> PAGE_SHIFT;
+	unsigned long index;
+	struct page *page;
+	ssize_t ret = len;
+	int mode;
+
+	if (sysfs_streq(buf, "idle"))
+		mode = IDLE_RECOMP;
+	else if (sysfs_streq(buf, "huge"))
+		mode = HUGE_RECOMP;
+	else if (sysfs_streq(buf, "huge_idle"))
+		mode = IDLE_RECOMP | HUGE_RECOMP;
+	else
+		return -EINVAL;
+
+	down_read(&zram->init_lock);
+	if (!init_done(zram) || !zram->recomp) {
+		ret = -EINVAL;
+		goto release_init_lock;
+	}
+
+	page = alloc_page(GFP_KERNEL);
+	if (!page) {
+		ret = -ENOMEM;
+		goto release_init_lock;
+	}
+
+	for (index = 0; index < nr_pages; index++) {
+		int err;
+
+		zram_slot_lock(zram, index);
+		if (!zram_allocated(zram, index))
+			goto next;
+
+		if (zram_test_flag(zram, index, ZRAM_WB) ||
+				zram_test_flag(zram, index, ZRAM_SAME) ||
+				zram_test_flag(zram, index, ZRAM_UNDER_WB) ||
+				zram_test_flag(zram, index, ZRAM_RECOMP) ||
+				zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+			goto next;
+
+		if (mode & IDLE_RECOMP &&
+			  !zram_test_flag(zram, index, ZRAM_IDLE))
+			goto next;
+		if (mode & HUGE_RECOMP &&
+			  !zram_test_flag(zram, index, ZRAM_HUGE))
+			goto next;
+
+		err = zram_recompress(zram, index, page);
+		if (err) {
+			/* Return last error, but keep going */
+			ret = err;
+		}
+next:
+		zram_slot_unlock(zram, index);
+		cond_resched();
+	}
+
+	__free_page(page);
+release_init_lock:
+	up_read(&zram->init_lock);
+
+	return ret;
+}
+#endif
+
 static ssize_t compact_store(struct device *dev,
 		struct device_attribute *attr, const char *buf, size_t len)
 {
@@ -1106,7 +1369,7 @@ static ssize_t mm_stat_show(struct device *dev,
 	max_used = atomic_long_read(&zram->stats.max_used_pages);
 
 	ret = scnprintf(buf, PAGE_SIZE,
-			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu\n",
+			"%8llu %8llu %8llu %8lu %8ld %8llu %8lu %8llu %8llu %8llu %8llu %8llu\n",
 			orig_size << PAGE_SHIFT,
 			(u64)atomic64_read(&zram->stats.compr_data_size),
 			mem_used << PAGE_SHIFT,
@@ -1115,7 +1378,10 @@ static ssize_t mm_stat_show(struct device *dev,
 			(u64)atomic64_read(&zram->stats.same_pages),
 			atomic_long_read(&pool_stats.pages_compacted),
 			(u64)atomic64_read(&zram->stats.huge_pages),
-			(u64)atomic64_read(&zram->stats.huge_pages_since));
+			(u64)atomic64_read(&zram->stats.huge_pages_since),
+			(u64)atomic64_read(&zram->stats.recomp_pages),
+			(u64)atomic64_read(&zram->stats.recomp_data_size),
+			(u64)atomic64_read(&zram->stats.recomp_saved));
 	up_read(&zram->init_lock);
 
 	return ret;
@@ -1213,6 +1479,16 @@ static void zram_free_page(struct zram *zram, size_t index)
 	if (zram_test_flag(zram, index, ZRAM_IDLE))
 		zram_clear_flag(zram, index, ZRAM_IDLE);
 
+	if (zram_test_flag(zram, index, ZRAM_INCOMPRESSIBLE))
+		zram_clear_flag(zram, index, ZRAM_INCOMPRESSIBLE);
+
+	if (zram_test_flag(zram, index, ZRAM_RECOMP)) {
+		zram_clear_flag(zram, index, ZRAM_RECOMP);
+		atomic64_dec(&zram->stats.recomp_pages);
+		atomic64_sub(zram_get_obj_size(zram, index),
+				&zram->stats.recomp_data_size);
+	}
+
 	if (zram_test_flag(zram, index, ZRAM_HUGE)) {
 		zram_clear_flag(zram, index, ZRAM_HUGE);
 		atomic64_dec(&zram->stats.huge_pages);
@@ -1247,7 +1523,47 @@ static void zram_free_page(struct zram *zram, size_t index)
 	zram_set_handle(zram, index, 0);
 	zram_set_obj_size(zram, index, 0);
 	WARN_ON_ONCE(zram->table[index].flags &
-		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB));
+		~(1UL << ZRAM_LOCK | 1UL << ZRAM_UNDER_WB | ZRAM_SEQ_MASK));
+}
+
+/*
+ * Read a slot which holds no compressed object, i.e. a same filled page
+ * or nothing at all, without taking the slot lock: sample the flags,
+ * read the element and check that no update happened in between.
+ * Returns false if the slot has to be read under the lock.
+ */
+static bool zram_read_same_lockless(struct zram *zram, struct page *page,
+				    u32 index)
+{
+#ifdef ZRAM_SEQ_SHIFT
+	struct zram_table_entry *entry = &zram->table[index];
+	unsigned long flags, value;
+	void *mem;
+
+	flags = READ_ONCE(entry->flags);
+	if (flags & (BIT(ZRAM_LOCK) | BIT(ZRAM_WB)))
+		return false;
+
+	/* Pairs with the smp_wmb() in zram_slot_write_end() */
+	smp_rmb();
+	value = READ_ONCE(entry->element);
+	if (!(flags & BIT(ZRAM_SAME))) {
+		if (value)
+			return false;
+	}
+
+	/* Pairs with the smp_wmb() in zram_slot_write_begin() */
+	smp_rmb();
+	if (READ_ONCE(entry->flags) != flags)
+		return false;
+
+	mem = kmap_atomic(page);
+	zram_fill_page(mem, PAGE_SIZE, value);
+	kunmap_atomic(mem);
+	return true;
+#else
+	return false;
+#endif
 }
 
 static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
@@ -1257,8 +1573,12 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 	unsigned long handle;
 	unsigned int size;
 	void *src, *dst;
+	struct zcomp *comp;
 	int ret;
 
+	if (zram_read_same_lockless(zram, page, index))
+		return 0;
+
 	zram_slot_lock(zram, index);
 	if (zram_test_flag(zram, index, ZRAM_WB)) {
 		struct bio_vec bvec;
@@ -1287,9 +1607,10 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 	}
 
 	size = zram_get_obj_size(zram, index);
+	comp = zram_slot_comp(zram, index);
 
 	if (size != PAGE_SIZE)
-		zstrm = zcomp_stream_get(zram->comp);
+		zstrm = zcomp_stream_get(comp);
 
 	src = zs_map_object(zram->mem_pool, handle, ZS_MM_RO);
 	if (size == PAGE_SIZE) {
@@ -1301,7 +1622,7 @@ static int __zram_bvec_read(struct zram *zram, struct page *page, u32 index,
 		dst = kmap_atomic(page);
 		ret = zcomp_decompress(zstrm, src, size, dst);
 		kunmap_atomic(dst);
-		zcomp_stream_put(zram->comp);
+		zcomp_stream_put(comp);
 	}
 	zs_unmap_object(zram->mem_pool, handle);
 	zram_slot_unlock(zram, index);
@@ -1536,9 +1857,17 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 		ret = zram_bvec_write(zram, bvec, index, offset, bio);
 	}
 
-	zram_slot_lock(zram, index);
-	zram_accessed(zram, index);
-	zram_slot_unlock(zram, index);
+	/*
+	 * Without access time tracking the only thing to update is the idle
+	 * flag, so don't bounce the slot lock for slots which aren't idle.
+	 * Racing with mark_idle() just makes the access look older.
+	 */
+	if (IS_ENABLED(CONFIG_ZRAM_MEMORY_TRACKING) ||
+	    data_race(zram_test_flag(zram, index, ZRAM_IDLE))) {
+		zram_slot_lock(zram, index);
+		zram_accessed(zram, index);
+		zram_slot_unlock(zram, index);
+	}
 
 	if (unlikely(ret < 0)) {
 		if (!op_is_write(op))
@@ -1550,30 +1879,14 @@ static int zram_bvec_rw(struct zram *zram, struct bio_vec *bvec, u32 index,
 	return ret;
 }
 
-static void __zram_make_request(struct zram *zram, struct bio *bio)
+/* Process the part of @bio described by @start, beginning at @index */
+static void zram_bio_rw_iter(struct zram *zram, struct bio *bio,
+			     struct bvec_iter start, u32 index, int offset)
 {
-	int offset;
-	u32 index;
 	struct bio_vec bvec;
 	struct bvec_iter iter;
-	unsigned long start_time;
-
-	index = bio->bi_iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
-	offset = (bio->bi_iter.bi_sector &
-		  (SECTORS_PER_PAGE - 1)) << SECTOR_SHIFT;
-
-	switch (bio_op(bio)) {
-	case REQ_OP_DISCARD:
-	case REQ_OP_WRITE_ZEROES:
-		zram_bio_discard(zram, index, offset, bio);
-		bio_endio(bio);
-		return;
-	default:
-		break;
-	}
 
-	start_time = bio_start_io_acct(bio);
-	bio_for_each_segment(bvec, bio, iter) {
+	__bio_for_each_segment(bvec, bio, iter, start) {
 		struct bio_vec bv = bvec;
 		unsigned int unwritten = bvec.bv_len;
 
@@ -1582,7 +1895,7 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 							unwritten);
 			if (zram_bvec_rw(zram, &bv, index, offset,
 					 bio_op(bio), bio) < 0) {
-				bio->bi_status = BLK_STS_IOERR;
+				WRITE_ONCE(bio->bi_status, BLK_STS_IOERR);
 				break;
 			}
 
@@ -1592,6 +1905,124 @@ static void __zram_make_request(struct zram *zram, struct bio *bio)
 			update_position(&index, &offset, &bv);
 		} while (unwritten);
 	}
+}
+
+struct zram_write_batch {
+	struct work_struct work;
+	struct zram_write_ctx *ctx;
+	struct bvec_iter iter;
+	u32 index;
+};
+
+struct zram_write_ctx {
+	struct zram *zram;
+	struct bio *bio;
+	unsigned long start_time;
+	atomic_t pending;
+	struct zram_write_batch batches[];
+};
+
+static void zram_write_batch_done(struct zram_write_ctx *ctx)
+{
+	struct bio *bio = ctx->bio;
+
+	if (!atomic_dec_and_test(&ctx->pending))
+		return;
+
+	bio_end_io_acct(bio, ctx->start_time);
+	bio_endio(bio);
+	kfree(ctx);
+}
+
+static void zram_write_batch_work(struct work_struct *work)
+{
+	struct zram_write_batch *batch =
+		container_of(work, struct zram_write_batch, work);
+	struct zram_write_ctx *ctx = batch->ctx;
+
+	zram_bio_rw_iter(ctx->zram, ctx->bio, batch->iter, batch->index, 0);
+	zram_write_batch_done(ctx);
+}
+
+/*
+ * Compress a large page aligned write bio in parallel: the bio is cut
+ * into batches of ZRAM_WRITE_BATCH pages, all but the first of which are
+ * handed to zram_write_wq, and completed by whoever finishes last.
+ * The submitter works on the first batch itself so that it is not just
+ * waiting. Returns false if the bio should be processed inline.
+ */
+static bool zram_write_parallel(struct zram *zram, struct bio *bio, u32 index)
+{
+	unsigned int batch_bytes = ZRAM_WRITE_BATCH << PAGE_SHIFT;
+	unsigned int nr, i;
+	struct zram_write_ctx *ctx;
+	struct bvec_iter iter;
+
+	if (!zram_write_wq || bio->bi_iter.bi_size < 2 * batch_bytes)
+		return false;
+
+	nr = DIV_ROUND_UP(bio->bi_iter.bi_size, batch_bytes);
+	ctx = kmalloc(struct_size(ctx, batches, nr), GFP_NOIO | __GFP_NOWARN);
+	if (!ctx)
+		return false;
+
+	ctx->zram = zram;
+	ctx->bio = bio;
+	ctx->start_time = bio_start_io_acct(bio);
+	atomic_set(&ctx->pending, nr);
+
+	iter = bio->bi_iter;
+	for (i = 0; i < nr; i++) {
+		struct zram_write_batch *batch = &ctx->batches[i];
+
+		batch->ctx = ctx;
+		batch->index = index + i * ZRAM_WRITE_BATCH;
+		batch->iter = iter;
+		batch->iter.bi_size = min(iter.bi_size, batch_bytes);
+		bvec_iter_advance(bio->bi_io_vec, &iter, batch->iter.bi_size);
+	}
+
+	for (i = 1; i < nr; i++) {
+		INIT_WORK(&ctx->batches[i].work, zram_write_batch_work);
+		queue_work(zram_write_wq, &ctx->batches[i].work);
+	}
+
+	zram_bio_rw_iter(zram, bio, ctx->batches[0].iter,
+			 ctx->batches[0].index, 0);
+	zram_write_batch_done(ctx);
+	return true;
+}
+
+static void __zram_make_request(struct zram *zram, struct bio *bio)
+{
+	int offset;
+	u32 index;
+	unsigned long start_time;
+
+	index = bio->bi_iter.bi_sector >> SECTORS_PER_PAGE_SHIFT;
+	offset = (bio->bi_iter.bi_sector &
+		  (SECTORS_PER_PAGE - 1)) << SECTOR_SHIFT;
+
+	switch (bio_op(bio)) {
+	case REQ_OP_DISCARD:
+	case REQ_OP_WRITE_ZEROES:
+		zram_bio_discard(zram, index, offset, bio);
+		bio_endio(bio);
+		return;
+	case REQ_OP_WRITE:
+		/*
+		 * Batches must start on a page boundary so that no two
+		 * batches touch the same slot.
+		 */
+		if (!offset && zram_write_parallel(zram, bio, index))
+			return;
+		break;
+	default:
+		break;
+	}
+
+	start_time = bio_start_io_acct(bio);
+	zram_bio_rw_iter(zram, bio, bio->bi_iter, index, offset);
 	bio_end_io_acct(bio, start_time);
 	bio_endio(bio);
 }
@@ -1703,6 +2134,10 @@ static void zram_reset_device(struct zram *zram)
 	disksize = zram->disksize;
 	zram->disksize = 0;
 
+	/* Nothing may still be compressing into the pool we are freeing */
+	if (zram_write_wq)
+		flush_workqueue(zram_write_wq);
+
 	set_capacity_and_notify(zram->disk, 0);
 	part_stat_set_all(zram->disk->part0, 0);
 
@@ -1710,6 +2145,12 @@ static void zram_reset_device(struct zram *zram)
 	zram_meta_free(zram, disksize);
 	memset(&zram->stats, 0, sizeof(zram->stats));
 	zcomp_destroy(comp);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recomp) {
+		zcomp_destroy(zram->recomp);
+		zram->recomp = NULL;
+	}
+#endif
 	reset_bdev(zram);
 
 	up_write(&zram->init_lock);
@@ -1748,6 +2189,21 @@ static ssize_t disksize_store(struct device *dev,
 		goto out_free_meta;
 	}
 
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	if (zram->recomp_algorithm[0]) {
+		struct zcomp *recomp = zcomp_create(zram->recomp_algorithm);
+
+		if (IS_ERR(recomp)) {
+			pr_err("Cannot initialise %s compressing backend\n",
+					zram->recomp_algorithm);
+			err = PTR_ERR(recomp);
+			zcomp_destroy(comp);
+			goto out_free_meta;
+		}
+		zram->recomp = recomp;
+	}
+#endif
+
 	zram->comp = comp;
 	zram->disksize = disksize;
 	set_capacity_and_notify(zram->disk, zram->disksize >> SECTOR_SHIFT);
@@ -1843,6 +2299,10 @@ static DEVICE_ATTR_WO(mem_used_max);
 static DEVICE_ATTR_WO(idle);
 static DEVICE_ATTR_RW(max_comp_streams);
 static DEVICE_ATTR_RW(comp_algorithm);
+#ifdef CONFIG_ZRAM_MULTI_COMP
+static DEVICE_ATTR_RW(recomp_algorithm);
+static DEVICE_ATTR_WO(recompress);
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 static DEVICE_ATTR_RW(backing_dev);
 static DEVICE_ATTR_WO(writeback);
@@ -1860,6 +2320,10 @@ static struct attribute *zram_disk_attrs[] = {
 	&dev_attr_idle.attr,
 	&dev_attr_max_comp_streams.attr,
 	&dev_attr_comp_algorithm.attr,
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	&dev_attr_recomp_algorithm.attr,
+	&dev_attr_recompress.attr,
+#endif
 #ifdef CONFIG_ZRAM_WRITEBACK
 	&dev_attr_backing_dev.attr,
 	&dev_attr_writeback.attr,
@@ -2096,6 +2560,8 @@ static void destroy_devices(void)
 	idr_destroy(&zram_index_idr);
 	unregister_blkdev(zram_major, "zram");
 	cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+	if (zram_write_wq)
+		destroy_workqueue(zram_write_wq);
 }
 
 static int __init zram_init(void)
@@ -2114,12 +2580,24 @@ static int __init zram_init(void)
 		return ret;
 	}
 
+	/*
+	 * zram is commonly used as swap, so the batch workers must be able
+	 * to make progress under memory pressure. Without the workqueue
+	 * writes are simply processed inline.
+	 */
+	zram_write_wq = alloc_workqueue("zram_write",
+					WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!zram_write_wq)
+		pr_warn("Unable to allocate write workqueue\n");
+
 	zram_debugfs_create();
 	zram_major = register_blkdev(0, "zram");
 	if (zram_major <= 0) {
 		pr_err("Unable to get major number\n");
 		class_unregister(&zram_control_class);
 		cpuhp_remove_multi_state(CPUHP_ZCOMP_PREPARE);
+		if (zram_write_wq)
+			destroy_workqueue(zram_write_wq);
 		return -EBUSY;
 	}
 
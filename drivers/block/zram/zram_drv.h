@@ -41,6 +41,18 @@
  */
 #define ZRAM_FLAG_SHIFT 24
 
+#ifdef CONFIG_64BIT
+/*
+ * On 64bit the upper half of table.flags counts slot updates: it is
+ * bumped on every zram_slot_unlock(), which lets readers of slots
+ * without a compressed object skip the slot lock and validate instead.
+ */
+#define ZRAM_SEQ_SHIFT 32
+#define ZRAM_SEQ_MASK	(~0UL << ZRAM_SEQ_SHIFT)
+#else
+#define ZRAM_SEQ_MASK	0UL
+#endif
+
 /* Flags for zram pages (table[page_no].flags) */
 enum zram_pageflags {
 	/* zram slot is locked */
@@ -50,6 +62,8 @@ enum zram_pageflags {
 	ZRAM_UNDER_WB,	/* page is under writeback */
 	ZRAM_HUGE,	/* Incompressible page */
 	ZRAM_IDLE,	/* not accessed page since last idle marking */
+	ZRAM_RECOMP,	/* page was recompressed with the secondary algorithm */
+	ZRAM_INCOMPRESSIBLE, /* secondary algorithm could not shrink the page */
 
 	__NR_ZRAM_PAGEFLAGS,
 };
@@ -82,6 +96,9 @@ struct zram_stats {
 	atomic64_t pages_stored;	/* no. of pages currently stored */
 	atomic_long_t max_used_pages;	/* no. of maximum pages stored */
 	atomic64_t miss_free;		/* no. of missed free */
+	atomic64_t recomp_pages;	/* no. of pages stored recompressed */
+	atomic64_t recomp_data_size;	/* compressed size of those pages */
+	atomic64_t recomp_saved;	/* bytes saved by recompression */
 #ifdef	CONFIG_ZRAM_WRITEBACK
 	atomic64_t bd_count;		/* no. of pages in backing device */
 	atomic64_t bd_reads;		/* no. of reads from backing device */
@@ -108,6 +125,10 @@ struct zram {
 	 */
 	u64 disksize;	/* bytes */
 	char compressor[CRYPTO_MAX_ALG_NAME];
+#ifdef CONFIG_ZRAM_MULTI_COMP
+	struct zcomp *recomp;
+	char recomp_algorithm[CRYPTO_MAX_ALG_NAME];
+#endif
 	/*
 	 * zram is claimed so open request will be failed
 	 */
@@ -103,10 +103,34 @@ static bool dma_fence_array_enable_signaling(struct dma_fence *fence)
 static bool dma_fence_array_signaled(struct dma_fence *fence)
 {
 	struct dma_fence_array *array = to_dma_fence_array(fence);
+	int num_pending;
+	unsigned int i;
 
-	if (atomic_read(&array->num_pending) > 0)
+	/*
+	 * Read num_pending before testing the enable_signal bit, so that a
+	 * concurrent dma_fence_array_enable_signaling() can't make us see a
+	 * partially decremented counter. Pairs with atomic_dec_and_test() in
+	 * dma_fence_array_enable_signaling().
+	 */
+	num_pending = atomic_read_acquire(&array->num_pending);
+	if (test_bit(DMA_FENCE_FLAG_ENABLE_SIGNAL_BIT, &array->base.flags)) {
+		if (num_pending <= 0)
+			goto signal;
 		return false;
+	}
+
+	/*
+	 * Without signaling enabled no callbacks are installed on the
+	 * component fences, poll them instead of arming one callback per
+	 * fence just to answer the query.
+	 */
+	for (i = 0; i < array->num_fences; ++i) {
+		if (dma_fence_is_signaled(array->fences[i]) && !--num_pending)
+			goto signal;
+	}
+	return false;
 
+signal:
 	dma_fence_array_clear_pending_error(array);
 	return true;
 }
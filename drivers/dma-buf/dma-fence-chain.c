@@ -28,17 +28,66 @@ static struct dma_fence *dma_fence_chain_get_prev(struct dma_fence_chain *chain)
 	return prev;
 }
 
+/*
+ * Maximum number of signaled nodes unlinked from a chain with one update of
+ * the prev pointer.
+ */
+#define DMA_FENCE_CHAIN_GC_BATCH	64
+
+/**
+ * dma_fence_chain_node_signaled - check whether a chain link is signaled
+ * @fence: chain node or the plain fence at the end of a chain
+ *
+ * Returns true if the fence contained in @fence has signaled, i.e. the link
+ * can be garbage collected.
+ */
+static bool dma_fence_chain_node_signaled(struct dma_fence *fence)
+{
+	return dma_fence_is_signaled(dma_fence_chain_contained(fence));
+}
+
+/**
+ * dma_fence_chain_skip_signaled - find the end of a run of signaled links
+ * @prev: a signaled chain link
+ *
+ * Returns a reference to the first link after @prev which is not signaled,
+ * or NULL if the rest of the chain is signaled. At most
+ * DMA_FENCE_CHAIN_GC_BATCH links are skipped, the remainder is left to the
+ * next walk.
+ */
+static struct dma_fence *dma_fence_chain_skip_signaled(struct dma_fence *prev)
+{
+	struct dma_fence *replacement, *next;
+	struct dma_fence_chain *chain;
+	unsigned int count = 0;
+
+	chain = to_dma_fence_chain(prev);
+	if (!chain)
+		return NULL;
+
+	replacement = dma_fence_chain_get_prev(chain);
+	while (replacement && ++count < DMA_FENCE_CHAIN_GC_BATCH &&
+	       dma_fence_chain_node_signaled(replacement)) {
+		chain = to_dma_fence_chain(replacement);
+		next = chain ? dma_fence_chain_get_prev(chain) : NULL;
+		dma_fence_put(replacement);
+		replacement = next;
+	}
+
+	return replacement;
+}
+
 /**
  * dma_fence_chain_walk - chain walking function
  * @fence: current chain node
  *
  * Walk the chain to the next node. Returns the next fence or NULL if we are at
  * the end of the chain. Garbage collects chain nodes which are already
- * signaled.
+ * signaled, unlinking whole runs of them at once.
  */
 struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
 {
-	struct dma_fence_chain *chain, *prev_chain;
+	struct dma_fence_chain *chain;
 	struct dma_fence *prev, *replacement, *tmp;
 
 	chain = to_dma_fence_chain(fence);
@@ -49,18 +98,10 @@ struct dma_fence *dma_fence_chain_walk(struct dma_fence *fence)
 
 	while ((prev = dma_fence_chain_get_prev(chain))) {
 
-		prev_chain = to_dma_fence_chain(prev);
-		if (prev_chain) {
-			if (!dma_fence_is_signaled(prev_chain->fence))
-				break;
-
-			replacement = dma_fence_chain_get_prev(prev_chain);
-		} else {
-			if (!dma_fence_is_signaled(prev))
-				break;
+		if (!dma_fence_chain_node_signaled(prev))
+			break;
 
-			replacement = NULL;
-		}
+		replacement = dma_fence_chain_skip_signaled(prev);
 
 		tmp = unrcu_pointer(cmpxchg(&chain->prev, RCU_INITIALIZER(prev),
 					     RCU_INITIALIZER(replacement)));
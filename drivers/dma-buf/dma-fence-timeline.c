@@ -0,0 +1,182 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * fence-timeline: compact timeline of fences signaled by seqno
+ *
+ * A timeline is a single monotonic 64-bit value. Its points are fences that
+ * are signaled once the value reaches their seqno, so signaling all points
+ * up to a seqno is a single store plus the wakeup of actual waiters.
+ */
+
+#include <linux/dma-fence-timeline.h>
+#include <linux/slab.h>
+
+static const char *dma_fence_timeline_get_driver_name(struct dma_fence *fence)
+{
+	return "dma_fence_timeline";
+}
+
+static const char *dma_fence_timeline_get_timeline_name(struct dma_fence *fence)
+{
+	return to_dma_fence_timeline_point(fence)->timeline->name;
+}
+
+static bool dma_fence_timeline_point_signaled(struct dma_fence *fence)
+{
+	struct dma_fence_timeline *tl = to_dma_fence_timeline_point(fence)->timeline;
+
+	return fence->seqno <= dma_fence_timeline_value(tl);
+}
+
+static bool dma_fence_timeline_enable_signaling(struct dma_fence *fence)
+{
+	struct dma_fence_timeline_point *pt = to_dma_fence_timeline_point(fence);
+	struct dma_fence_timeline *tl = pt->timeline;
+	struct dma_fence_timeline_point *pos;
+
+	/* Called with tl->lock held, the lock of every point. */
+	if (fence->seqno <= tl->value)
+		return false;
+
+	/* Points are mostly created in order, search from the tail. */
+	list_for_each_entry_reverse(pos, &tl->pending, link) {
+		if (pos->base.seqno <= fence->seqno)
+			break;
+	}
+	list_add(&pt->link, &pos->link);
+
+	return true;
+}
+
+static void dma_fence_timeline_release_tl(struct kref *kref)
+{
+	struct dma_fence_timeline *tl =
+		container_of(kref, struct dma_fence_timeline, refcount);
+
+	kfree(tl);
+}
+
+static void dma_fence_timeline_point_release(struct dma_fence *fence)
+{
+	struct dma_fence_timeline_point *pt = to_dma_fence_timeline_point(fence);
+	struct dma_fence_timeline *tl = pt->timeline;
+	unsigned long flags;
+
+	if (!list_empty(&pt->link)) {
+		spin_lock_irqsave(&tl->lock, flags);
+		list_del(&pt->link);
+		spin_unlock_irqrestore(&tl->lock, flags);
+	}
+
+	kref_put(&tl->refcount, dma_fence_timeline_release_tl);
+	dma_fence_free(fence);
+}
+
+const struct dma_fence_ops dma_fence_timeline_point_ops = {
+	.use_64bit_seqno = true,
+	.get_driver_name = dma_fence_timeline_get_driver_name,
+	.get_timeline_name = dma_fence_timeline_get_timeline_name,
+	.enable_signaling = dma_fence_timeline_enable_signaling,
+	.signaled = dma_fence_timeline_point_signaled,
+	.release = dma_fence_timeline_point_release,
+};
+EXPORT_SYMBOL(dma_fence_timeline_point_ops);
+
+/**
+ * dma_fence_timeline_create - create a new timeline
+ * @name: name of the timeline, used for debugging
+ *
+ * Allocates a timeline with a fresh fence context and a value of zero.
+ * Returns the timeline, or NULL on allocation failure. The reference
+ * returned must be dropped with dma_fence_timeline_put().
+ */
+struct dma_fence_timeline *dma_fence_timeline_create(const char *name)
+{
+	struct dma_fence_timeline *tl;
+
+	tl = kzalloc(sizeof(*tl), GFP_KERNEL);
+	if (!tl)
+		return NULL;
+
+	kref_init(&tl->refcount);
+	spin_lock_init(&tl->lock);
+	INIT_LIST_HEAD(&tl->pending);
+	tl->context = dma_fence_context_alloc(1);
+	strscpy(tl->name, name, sizeof(tl->name));
+
+	return tl;
+}
+EXPORT_SYMBOL(dma_fence_timeline_create);
+
+/**
+ * dma_fence_timeline_put - drop a timeline reference
+ * @tl: the timeline
+ *
+ * The timeline is freed once the creator's reference and all points are
+ * gone. Points left unsignaled stay unsignaled.
+ */
+void dma_fence_timeline_put(struct dma_fence_timeline *tl)
+{
+	if (tl)
+		kref_put(&tl->refcount, dma_fence_timeline_release_tl);
+}
+EXPORT_SYMBOL(dma_fence_timeline_put);
+
+/**
+ * dma_fence_timeline_point - create a fence for a point on the timeline
+ * @tl: the timeline
+ * @seqno: the point, signaled once the timeline reaches it
+ *
+ * Returns a new fence, already signaled if @seqno has been reached, or NULL
+ * on allocation failure. The point holds a reference on @tl.
+ */
+struct dma_fence *dma_fence_timeline_point(struct dma_fence_timeline *tl,
+					   u64 seqno)
+{
+	struct dma_fence_timeline_point *pt;
+
+	pt = kmalloc(sizeof(*pt), GFP_KERNEL);
+	if (!pt)
+		return NULL;
+
+	kref_get(&tl->refcount);
+	pt->timeline = tl;
+	INIT_LIST_HEAD(&pt->link);
+	dma_fence_init(&pt->base, &dma_fence_timeline_point_ops, &tl->lock,
+		       tl->context, seqno);
+
+	return &pt->base;
+}
+EXPORT_SYMBOL(dma_fence_timeline_point);
+
+/**
+ * dma_fence_timeline_signal - signal all points up to a seqno
+ * @tl: the timeline
+ * @seqno: the new value of the timeline
+ *
+ * Advances the timeline to @seqno. Every point up to @seqno is signaled from
+ * then on; only points with signaling enabled, i.e. with waiters or
+ * callbacks, are visited to run their callbacks. The timeline never moves
+ * backwards, a smaller @seqno is ignored.
+ */
+void dma_fence_timeline_signal(struct dma_fence_timeline *tl, u64 seqno)
+{
+	struct dma_fence_timeline_point *pt, *next;
+	unsigned long flags;
+
+	spin_lock_irqsave(&tl->lock, flags);
+	if (seqno <= tl->value)
+		goto out;
+
+	WRITE_ONCE(tl->value, seqno);
+
+	list_for_each_entry_safe(pt, next, &tl->pending, link) {
+		if (pt->base.seqno > seqno)
+			break;
+
+		list_del_init(&pt->link);
+		dma_fence_signal_locked(&pt->base);
+	}
+out:
+	spin_unlock_irqrestore(&tl->lock, flags);
+}
+EXPORT_SYMBOL(dma_fence_timeline_signal);
@@ -135,6 +135,8 @@ void dma_resv_init(struct dma_resv *obj)
 	ww_mutex_init(&obj->lock, &reservation_ww_class);
 
 	RCU_INIT_POINTER(obj->fences, NULL);
+	atomic64_set(&obj->gen, 0);
+	atomic64_set(&obj->signaled, -1);
 }
 EXPORT_SYMBOL(dma_resv_init);
 
@@ -159,6 +161,52 @@ static inline struct dma_resv_list *dma_resv_fences_list(struct dma_resv *obj)
 	return rcu_dereference_check(obj->fences, dma_resv_held(obj));
 }
 
+/*
+ * Bracket every change which can make the object busy again, so that
+ * lockless readers never cache a result computed while the fences changed.
+ */
+static inline void dma_resv_gen_begin(struct dma_resv *obj)
+{
+	dma_resv_assert_held(obj);
+	atomic64_inc(&obj->gen);
+	smp_mb__after_atomic();
+}
+
+static inline void dma_resv_gen_end(struct dma_resv *obj)
+{
+	smp_mb__before_atomic();
+	atomic64_inc(&obj->gen);
+}
+
+/* Stable generation to cache a result against, or -1 during a change. */
+static inline s64 dma_resv_gen_read(struct dma_resv *obj)
+{
+	s64 gen = atomic64_read(&obj->gen);
+
+	smp_rmb();
+	return gen & 1 ? -1 : gen;
+}
+
+/* Check the cached "all signaled" summary for @usage. */
+static inline bool dma_resv_signaled_cached(struct dma_resv *obj,
+					    enum dma_resv_usage usage)
+{
+	s64 signaled = atomic64_read(&obj->signaled);
+	s64 gen = dma_resv_gen_read(obj);
+
+	return gen >= 0 && signaled >= 0 && (signaled >> 2) == gen &&
+	       (signaled & 3) >= usage;
+}
+
+/* Remember that all fences up to @usage were signaled in generation @gen. */
+static inline void dma_resv_signaled_store(struct dma_resv *obj, s64 gen,
+					   enum dma_resv_usage usage)
+{
+	smp_rmb();
+	if (gen >= 0 && atomic64_read(&obj->gen) == gen)
+		atomic64_set(&obj->signaled, (gen << 2) | usage);
+}
+
 /**
  * dma_resv_reserve_fences - Reserve space to add fences to a dma_resv object.
  * @obj: reservation object
@@ -288,6 +336,8 @@ void dma_resv_add_fence(struct dma_resv *obj, struct dma_fence *fence,
 	 */
 	WARN_ON(dma_fence_is_container(fence));
 
+	dma_resv_gen_begin(obj);
+
 	fobj = dma_resv_fences_list(obj);
 	count = fobj->num_fences;
 
@@ -299,7 +349,7 @@ void dma_resv_add_fence(struct dma_resv *obj, struct dma_fence *fence,
 		    dma_fence_is_signaled(old)) {
 			dma_resv_list_set(fobj, i, fence, usage);
 			dma_fence_put(old);
-			return;
+			goto out;
 		}
 	}
 
@@ -309,6 +359,8 @@ void dma_resv_add_fence(struct dma_resv *obj, struct dma_fence *fence,
 	dma_resv_list_set(fobj, i, fence, usage);
 	/* pointer update must be visible before we extend the num_fences */
 	smp_store_mb(fobj->num_fences, count);
+out:
+	dma_resv_gen_end(obj);
 }
 EXPORT_SYMBOL(dma_resv_add_fence);
 
@@ -335,6 +387,7 @@ void dma_resv_replace_fences(struct dma_resv *obj, uint64_t context,
 
 	dma_resv_assert_held(obj);
 
+	dma_resv_gen_begin(obj);
 	list = dma_resv_fences_list(obj);
 	for (i = 0; list && i < list->num_fences; ++i) {
 		struct dma_fence *old;
@@ -346,6 +399,7 @@ void dma_resv_replace_fences(struct dma_resv *obj, uint64_t context,
 		dma_resv_list_set(list, i, replacement, usage);
 		dma_fence_put(old);
 	}
+	dma_resv_gen_end(obj);
 }
 EXPORT_SYMBOL(dma_resv_replace_fences);
 
@@ -405,6 +459,16 @@ static void dma_resv_iter_walk_unlocked(struct dma_resv_iter *cursor)
  */
 struct dma_fence *dma_resv_iter_first_unlocked(struct dma_resv_iter *cursor)
 {
+	/* Nothing to return if everything is known to be signaled. */
+	if (dma_resv_signaled_cached(cursor->obj, cursor->usage)) {
+		cursor->index = 0;
+		cursor->num_fences = 0;
+		cursor->fences = NULL;
+		cursor->fence = NULL;
+		cursor->is_restarted = true;
+		return NULL;
+	}
+
 	rcu_read_lock();
 	do {
 		dma_resv_iter_restart_unlocked(cursor);
@@ -534,7 +598,9 @@ int dma_resv_copy_fences(struct dma_resv *dst, struct dma_resv *src)
 	}
 	dma_resv_iter_end(&cursor);
 
+	dma_resv_gen_begin(dst);
 	list = rcu_replace_pointer(dst->fences, list, dma_resv_held(dst));
+	dma_resv_gen_end(dst);
 	dma_resv_list_free(list);
 	return 0;
 }
@@ -688,6 +754,9 @@ EXPORT_SYMBOL_GPL(dma_resv_wait_timeout);
  * Callers are not required to hold specific locks, but maybe hold
  * dma_resv_lock() already.
  *
+ * A positive result is cached until the next fence is added, so polling an
+ * idle object does not walk the fences again.
+ *
  * RETURNS
  *
  * True if all fences signaled, else false.
@@ -696,6 +765,12 @@ bool dma_resv_test_signaled(struct dma_resv *obj, enum dma_resv_usage usage)
 {
 	struct dma_resv_iter cursor;
 	struct dma_fence *fence;
+	s64 gen;
+
+	if (dma_resv_signaled_cached(obj, usage))
+		return true;
+
+	gen = dma_resv_gen_read(obj);
 
 	dma_resv_iter_begin(&cursor, obj, usage);
 	dma_resv_for_each_fence_unlocked(&cursor, fence) {
@@ -703,6 +778,8 @@ bool dma_resv_test_signaled(struct dma_resv *obj, enum dma_resv_usage usage)
 		return false;
 	}
 	dma_resv_iter_end(&cursor);
+
+	dma_resv_signaled_store(obj, gen, usage);
 	return true;
 }
 EXPORT_SYMBOL_GPL(dma_resv_test_signaled);
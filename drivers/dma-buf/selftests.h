@@ -12,5 +12,6 @@
 selftest(sanitycheck, __sanitycheck__) /* keep first (igt selfcheck) */
 selftest(dma_fence, dma_fence)
 selftest(dma_fence_chain, dma_fence_chain)
+selftest(dma_fence_timeline, dma_fence_timeline)
 selftest(dma_fence_unwrap, dma_fence_unwrap)
 selftest(dma_resv, dma_resv)
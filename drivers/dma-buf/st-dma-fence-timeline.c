@@ -0,0 +1,231 @@
+// SPDX-License-Identifier: MIT
+
+#include <linux/dma-fence.h>
+#include <linux/dma-fence-chain.h>
+#include <linux/dma-fence-timeline.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/slab.h>
+
+#include "selftest.h"
+
+#define TIMELINE_SZ (4 << 10)
+
+static int sanitycheck(void *arg)
+{
+	struct dma_fence_timeline *tl;
+	struct dma_fence *f;
+	int err = 0;
+
+	tl = dma_fence_timeline_create("sanity");
+	if (!tl)
+		return -ENOMEM;
+
+	f = dma_fence_timeline_point(tl, 1);
+	if (!f) {
+		err = -ENOMEM;
+		goto out;
+	}
+
+	dma_fence_timeline_signal(tl, 1);
+	if (!dma_fence_is_signaled(f)) {
+		pr_err("point not signaled by the timeline\n");
+		err = -EINVAL;
+	}
+
+	dma_fence_put(f);
+out:
+	dma_fence_timeline_put(tl);
+	return err;
+}
+
+struct timeline_points {
+	struct dma_fence_timeline *tl;
+	struct dma_fence **points;
+	unsigned int count;
+};
+
+static int timeline_points_init(struct timeline_points *tp, unsigned int count)
+{
+	unsigned int i;
+
+	tp->tl = dma_fence_timeline_create("selftest");
+	if (!tp->tl)
+		return -ENOMEM;
+
+	tp->points = kvmalloc_array(count, sizeof(*tp->points),
+				    GFP_KERNEL | __GFP_ZERO);
+	if (!tp->points) {
+		dma_fence_timeline_put(tp->tl);
+		return -ENOMEM;
+	}
+
+	tp->count = count;
+	for (i = 0; i < count; i++) {
+		tp->points[i] = dma_fence_timeline_point(tp->tl, i + 1);
+		if (!tp->points[i])
+			return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void timeline_points_fini(struct timeline_points *tp)
+{
+	unsigned int i;
+
+	if (!tp->points)
+		return;
+
+	for (i = 0; i < tp->count; i++)
+		dma_fence_put(tp->points[i]);
+	kvfree(tp->points);
+	dma_fence_timeline_put(tp->tl);
+}
+
+static int signal_range(void *arg)
+{
+	struct timeline_points tp = {};
+	unsigned int i;
+	int err;
+
+	err = timeline_points_init(&tp, TIMELINE_SZ);
+	if (err)
+		goto out;
+
+	dma_fence_timeline_signal(tp.tl, TIMELINE_SZ / 2);
+
+	for (i = 0; i < tp.count; i++) {
+		bool expect = i < TIMELINE_SZ / 2;
+
+		if (dma_fence_is_signaled(tp.points[i]) != expect) {
+			pr_err("point %u signaled=%d, expected %d\n",
+			       i + 1, !expect, expect);
+			err = -EINVAL;
+			break;
+		}
+	}
+
+	/* The timeline never moves backwards. */
+	dma_fence_timeline_signal(tp.tl, 1);
+	if (dma_fence_timeline_value(tp.tl) != TIMELINE_SZ / 2) {
+		pr_err("timeline moved backwards\n");
+		err = -EINVAL;
+	}
+
+out:
+	timeline_points_fini(&tp);
+	return err;
+}
+
+struct point_cb {
+	struct dma_fence_cb cb;
+	unsigned int *count;
+};
+
+static void point_cb_func(struct dma_fence *f, struct dma_fence_cb *cb)
+{
+	(*container_of(cb, struct point_cb, cb)->count)++;
+}
+
+static int signal_callbacks(void *arg)
+{
+	struct timeline_points tp = {};
+	struct point_cb *cbs;
+	unsigned int i, count = 0;
+	int err;
+
+	cbs = kvmalloc_array(TIMELINE_SZ, sizeof(*cbs), GFP_KERNEL);
+	if (!cbs)
+		return -ENOMEM;
+
+	err = timeline_points_init(&tp, TIMELINE_SZ);
+	if (err)
+		goto out;
+
+	/* Enable signaling in reverse order to exercise the sorted insert. */
+	for (i = tp.count; i--; ) {
+		cbs[i].count = &count;
+		if (dma_fence_add_callback(tp.points[i], &cbs[i].cb,
+					   point_cb_func)) {
+			pr_err("point %u already signaled\n", i + 1);
+			err = -EINVAL;
+			goto out;
+		}
+	}
+
+	for (i = 1; i <= tp.count; i++) {
+		dma_fence_timeline_signal(tp.tl, i);
+		if (count != i) {
+			pr_err("%u callbacks ran after signaling %u\n",
+			       count, i);
+			err = -EINVAL;
+			break;
+		}
+	}
+
+	if (!list_empty(&tp.tl->pending)) {
+		pr_err("signaled points left pending\n");
+		err = -EINVAL;
+	}
+
+out:
+	if (tp.points)
+		dma_fence_timeline_signal(tp.tl, TIMELINE_SZ);
+	timeline_points_fini(&tp);
+	kvfree(cbs);
+	return err;
+}
+
+static int chain_gc(void *arg)
+{
+	struct timeline_points tp = {};
+	struct dma_fence *tail = NULL, *f;
+	struct dma_fence_chain *chain;
+	unsigned int i, links = 0;
+	int err;
+
+	err = timeline_points_init(&tp, TIMELINE_SZ);
+	if (err)
+		goto out;
+
+	for (i = 0; i < tp.count; i++) {
+		chain = dma_fence_chain_alloc();
+		if (!chain) {
+			err = -ENOMEM;
+			goto out;
+		}
+
+		dma_fence_chain_init(chain, tail,
+				     dma_fence_get(tp.points[i]), i + 1);
+		tail = &chain->base;
+	}
+
+	dma_fence_timeline_signal(tp.tl, TIMELINE_SZ - 1);
+
+	/* A single walk must unlink everything signaled behind the tail. */
+	dma_fence_chain_for_each(f, tail)
+		links++;
+
+	if (links != 1 || rcu_access_pointer(to_dma_fence_chain(tail)->prev)) {
+		pr_err("walk visited %u links, expected 1\n", links);
+		err = -EINVAL;
+	}
+
+out:
+	dma_fence_put(tail);
+	timeline_points_fini(&tp);
+	return err;
+}
+
+int dma_fence_timeline(void)
+{
+	static const struct subtest tests[] = {
+		SUBTEST(sanitycheck),
+		SUBTEST(signal_range),
+		SUBTEST(signal_callbacks),
+		SUBTEST(chain_gc),
+	};
+
+	return subtests(tests, NULL);
+}
@@ -102,6 +102,68 @@ static int test_signaling(void *arg)
 	return r;
 }
 
+static int test_signaled_cache(void *arg)
+{
+	enum dma_resv_usage usage = (unsigned long)arg;
+	struct dma_fence *f1, *f2;
+	struct dma_resv resv;
+	int r;
+
+	f1 = alloc_fence();
+	if (!f1)
+		return -ENOMEM;
+
+	f2 = alloc_fence();
+	if (!f2) {
+		dma_fence_put(f1);
+		return -ENOMEM;
+	}
+
+	dma_resv_init(&resv);
+	r = dma_resv_lock(&resv, NULL);
+	if (r) {
+		pr_err("Resv locking failed\n");
+		goto err_free;
+	}
+
+	r = dma_resv_reserve_fences(&resv, 2);
+	if (r) {
+		pr_err("Resv shared slot allocation failed\n");
+		goto err_unlock;
+	}
+
+	dma_resv_add_fence(&resv, f1, usage);
+	dma_fence_signal(f1);
+	if (!dma_resv_test_signaled(&resv, usage) ||
+	    !dma_resv_test_signaled(&resv, usage)) {
+		pr_err("Resv not reporting signaled\n");
+		r = -EINVAL;
+		goto err_unlock;
+	}
+
+	/* Adding a fence must invalidate the cached result. */
+	dma_resv_add_fence(&resv, f2, usage);
+	if (dma_resv_test_signaled(&resv, usage)) {
+		pr_err("Resv reporting stale signaled state\n");
+		r = -EINVAL;
+		goto err_unlock;
+	}
+
+	dma_fence_signal(f2);
+	if (!dma_resv_test_signaled(&resv, usage)) {
+		pr_err("Resv not reporting signaled\n");
+		r = -EINVAL;
+	}
+err_unlock:
+	dma_resv_unlock(&resv);
+err_free:
+	dma_resv_fini(&resv);
+	dma_fence_signal(f2);
+	dma_fence_put(f2);
+	dma_fence_put(f1);
+	return r;
+}
+
 static int test_for_each(void *arg)
 {
 	enum dma_resv_usage usage = (unsigned long)arg;
@@ -288,6 +350,7 @@ int dma_resv(void)
 	static const struct subtest tests[] = {
 		SUBTEST(sanitycheck),
 		SUBTEST(test_signaling),
+		SUBTEST(test_signaled_cache),
 		SUBTEST(test_for_each),
 		SUBTEST(test_for_each_unlocked),
 		SUBTEST(test_get_fences),
@@ -8,6 +8,11 @@
 
 #define VMBUS_MAX_PACKET_SIZE 0x4000
 
+/* Max rectangles per SYNTHVID_DIRT message */
+#define HYPERV_DIRT_MAX_RECTS 16
+/* Min interval between two SYNTHVID_DIRT messages, about one frame */
+#define HYPERV_DIRT_INTERVAL (HZ / 60)
+
 struct hyperv_drm_device {
 	/* drm */
 	struct drm_device dev;
@@ -31,6 +36,13 @@ struct hyperv_drm_device {
 	u32 mmio_megabytes;
 	bool dirt_needed;
 
+	/* damage held back until the next dirt_work run */
+	spinlock_t dirt_lock;
+	struct drm_rect dirt_rects[HYPERV_DIRT_MAX_RECTS];
+	unsigned int dirt_count;
+	unsigned long dirt_sent;
+	struct delayed_work dirt_work;
+
 	u8 init_buf[VMBUS_MAX_PACKET_SIZE];
 	u8 recv_buf[VMBUS_MAX_PACKET_SIZE];
 
@@ -47,7 +59,8 @@ int hyperv_update_vram_location(struct hv_device *hdev, phys_addr_t vram_pp);
 int hyperv_update_situation(struct hv_device *hdev, u8 active, u32 bpp,
 			    u32 w, u32 h, u32 pitch);
 int hyperv_hide_hw_ptr(struct hv_device *hdev);
-int hyperv_update_dirt(struct hv_device *hdev, struct drm_rect *rect);
+int hyperv_update_dirt(struct hv_device *hdev, const struct drm_rect *rects,
+		       unsigned int count);
 int hyperv_connect_vsp(struct hv_device *hdev);
 
 #endif
@@ -176,6 +176,7 @@ static int hyperv_vmbus_remove(struct hv_device *hdev)
 
 	drm_dev_unplug(dev);
 	drm_atomic_helper_shutdown(dev);
+	cancel_delayed_work_sync(&hv->dirt_work);
 	vmbus_close(hdev->channel);
 	hv_set_drvdata(hdev, NULL);
 
@@ -187,12 +188,14 @@ static int hyperv_vmbus_remove(struct hv_device *hdev)
 static int hyperv_vmbus_suspend(struct hv_device *hdev)
 {
 	struct drm_device *dev = hv_get_drvdata(hdev);
+	struct hyperv_drm_device *hv = to_hv(dev);
 	int ret;
 
 	ret = drm_mode_config_helper_suspend(dev);
 	if (ret)
 		return ret;
 
+	cancel_delayed_work_sync(&hv->dirt_work);
 	vmbus_close(hdev->channel);
 
 	return 0;
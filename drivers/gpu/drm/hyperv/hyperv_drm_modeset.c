@@ -132,18 +132,112 @@ static int hyperv_pipe_check(struct drm_simple_display_pipe *pipe,
 	return 0;
 }
 
+static u64 hyperv_rect_area(const struct drm_rect *r)
+{
+	return (u64)drm_rect_width(r) * drm_rect_height(r);
+}
+
+/*
+ * Add a damage clip to the pending dirt rectangles. A clip is merged into
+ * a rectangle it overlaps or touches as long as the merged rectangle isn't
+ * larger than the two of them; when all the slots are taken, everything is
+ * collapsed into a single bounding rectangle.
+ */
+static void hyperv_dirt_add(struct hyperv_drm_device *hv,
+			    const struct drm_rect *clip)
+{
+	struct drm_rect *rects = hv->dirt_rects;
+	struct drm_rect u;
+	unsigned int i;
+
+	for (i = 0; i < hv->dirt_count; i++) {
+		u.x1 = min(rects[i].x1, clip->x1);
+		u.y1 = min(rects[i].y1, clip->y1);
+		u.x2 = max(rects[i].x2, clip->x2);
+		u.y2 = max(rects[i].y2, clip->y2);
+		if (hyperv_rect_area(&u) <=
+		    hyperv_rect_area(&rects[i]) + hyperv_rect_area(clip)) {
+			rects[i] = u;
+			return;
+		}
+	}
+
+	if (hv->dirt_count < HYPERV_DIRT_MAX_RECTS) {
+		rects[hv->dirt_count++] = *clip;
+		return;
+	}
+
+	u = *clip;
+	for (i = 0; i < hv->dirt_count; i++) {
+		u.x1 = min(rects[i].x1, u.x1);
+		u.y1 = min(rects[i].y1, u.y1);
+		u.x2 = max(rects[i].x2, u.x2);
+		u.y2 = max(rects[i].y2, u.y2);
+	}
+	rects[0] = u;
+	hv->dirt_count = 1;
+}
+
+/* Send the pending dirt rectangles to the host. */
+static void hyperv_dirt_flush(struct hyperv_drm_device *hv)
+{
+	struct drm_rect rects[HYPERV_DIRT_MAX_RECTS];
+	unsigned int count;
+
+	spin_lock(&hv->dirt_lock);
+	count = hv->dirt_count;
+	memcpy(rects, hv->dirt_rects, count * sizeof(rects[0]));
+	hv->dirt_count = 0;
+	hv->dirt_sent = jiffies;
+	spin_unlock(&hv->dirt_lock);
+
+	hyperv_update_dirt(hv->hdev, rects, count);
+}
+
+static void hyperv_dirt_work(struct work_struct *work)
+{
+	struct hyperv_drm_device *hv = container_of(to_delayed_work(work),
+						    struct hyperv_drm_device,
+						    dirt_work);
+
+	hyperv_dirt_flush(hv);
+}
+
 static void hyperv_pipe_update(struct drm_simple_display_pipe *pipe,
 			       struct drm_plane_state *old_state)
 {
 	struct hyperv_drm_device *hv = to_hv(pipe->crtc.dev);
 	struct drm_plane_state *state = pipe->plane.state;
 	struct drm_shadow_plane_state *shadow_plane_state = to_drm_shadow_plane_state(state);
-	struct drm_rect rect;
-
-	if (drm_atomic_helper_damage_merged(old_state, state, &rect)) {
-		hyperv_blit_to_vram_rect(state->fb, &shadow_plane_state->data[0], &rect);
-		hyperv_update_dirt(hv->hdev, &rect);
+	struct drm_atomic_helper_damage_iter iter;
+	unsigned long delay = 0;
+	struct drm_rect clip;
+	bool damaged = false;
+
+	/*
+	 * Copy only the damaged clips rather than their bounding box; the
+	 * host is told about them at most once per HYPERV_DIRT_INTERVAL, so
+	 * that the updates of fast clients coalesce into one message.
+	 */
+	drm_atomic_helper_damage_iter_init(&iter, old_state, state);
+	drm_atomic_for_each_plane_damage(&iter, &clip) {
+		hyperv_blit_to_vram_rect(state->fb, &shadow_plane_state->data[0], &clip);
+
+		spin_lock(&hv->dirt_lock);
+		hyperv_dirt_add(hv, &clip);
+		spin_unlock(&hv->dirt_lock);
+		damaged = true;
 	}
+
+	if (!damaged)
+		return;
+
+	spin_lock(&hv->dirt_lock);
+	if (time_before(jiffies, hv->dirt_sent + HYPERV_DIRT_INTERVAL))
+		delay = hv->dirt_sent + HYPERV_DIRT_INTERVAL - jiffies;
+	spin_unlock(&hv->dirt_lock);
+
+	schedule_delayed_work(&hv->dirt_work, delay);
 }
 
 static const struct drm_simple_display_pipe_funcs hyperv_pipe_funcs = {
@@ -221,6 +315,9 @@ int hyperv_mode_config_init(struct hyperv_drm_device *hv)
 
 	dev->mode_config.funcs = &hyperv_mode_config_funcs;
 
+	spin_lock_init(&hv->dirt_lock);
+	INIT_DELAYED_WORK(&hv->dirt_work, hyperv_dirt_work);
+
 	ret = hyperv_conn_init(hv);
 	if (ret) {
 		drm_err(dev, "Failed to initialized connector.\n");
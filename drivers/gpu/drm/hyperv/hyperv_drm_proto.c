@@ -146,7 +146,7 @@ struct rect {
 struct synthvid_dirt {
 	u8 video_output;
 	u8 dirt_count;
-	struct rect rect[1];
+	struct rect rect[HYPERV_DIRT_MAX_RECTS];
 } __packed;
 
 #define SYNTHVID_EDID_BLOCK_SIZE	128
@@ -348,25 +348,33 @@ int hyperv_hide_hw_ptr(struct hv_device *hdev)
 	return 0;
 }
 
-int hyperv_update_dirt(struct hv_device *hdev, struct drm_rect *rect)
+int hyperv_update_dirt(struct hv_device *hdev, const struct drm_rect *rects,
+		       unsigned int count)
 {
 	struct hyperv_drm_device *hv = hv_get_drvdata(hdev);
 	struct synthvid_msg msg;
+	unsigned int i;
 
-	if (!hv->dirt_needed)
+	if (!hv->dirt_needed || !count)
 		return 0;
 
+	if (WARN_ON(count > HYPERV_DIRT_MAX_RECTS))
+		count = HYPERV_DIRT_MAX_RECTS;
+
 	memset(&msg, 0, sizeof(struct synthvid_msg));
 
 	msg.vid_hdr.type = SYNTHVID_DIRT;
 	msg.vid_hdr.size = sizeof(struct synthvid_msg_hdr) +
-		sizeof(struct synthvid_dirt);
+		offsetof(struct synthvid_dirt, rect) +
+		count * sizeof(struct rect);
 	msg.dirt.video_output = 0;
-	msg.dirt.dirt_count = 1;
-	msg.dirt.rect[0].x1 = rect->x1;
-	msg.dirt.rect[0].y1 = rect->y1;
-	msg.dirt.rect[0].x2 = rect->x2;
-	msg.dirt.rect[0].y2 = rect->y2;
+	msg.dirt.dirt_count = count;
+	for (i = 0; i < count; i++) {
+		msg.dirt.rect[i].x1 = rects[i].x1;
+		msg.dirt.rect[i].y1 = rects[i].y1;
+		msg.dirt.rect[i].x2 = rects[i].x2;
+		msg.dirt.rect[i].y2 = rects[i].y2;
+	}
 
 	hyperv_sendpacket(hdev, &msg);
 
@@ -774,10 +774,14 @@ static bool drm_sched_ready(struct drm_gpu_scheduler *sched)
  *
  * @sched: scheduler instance
  *
+ * Called on every submission that makes an entity runnable. When the
+ * scheduler thread is already busy it will re-check the run queues before
+ * sleeping, so skip the wait queue lock in that case. The barrier in
+ * wq_has_sleeper() pairs with the one in prepare_to_wait_event().
  */
 void drm_sched_wakeup(struct drm_gpu_scheduler *sched)
 {
-	if (drm_sched_ready(sched))
+	if (drm_sched_ready(sched) && wq_has_sleeper(&sched->wake_up_worker))
 		wake_up_interruptible(&sched->wake_up_worker);
 }
 
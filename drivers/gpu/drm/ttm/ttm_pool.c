@@ -62,6 +62,16 @@ static unsigned long page_pool_size;
 MODULE_PARM_DESC(page_pool_size, "Number of pages in the WC/UC/DMA pool");
 module_param(page_pool_size, ulong, 0644);
 
+/* Order of the huge pages kept ready for NUMA bound pools */
+#define TTM_POOL_HUGE_ORDER	min_t(unsigned int, PMD_SHIFT - PAGE_SHIFT, \
+				      MAX_ORDER - 1)
+
+static unsigned int huge_pool_reserve = 4;
+
+MODULE_PARM_DESC(huge_pool_reserve,
+		 "Number of huge pages refilled in the background for NUMA bound device pools");
+module_param(huge_pool_reserve, uint, 0644);
+
 static atomic_long_t allocated_pages;
 
 static struct ttm_pool_type global_write_combined[MAX_ORDER];
@@ -92,7 +102,7 @@ static struct page *ttm_pool_alloc_page(struct ttm_pool *pool, gfp_t gfp_flags,
 			__GFP_KSWAPD_RECLAIM;
 
 	if (!pool->use_dma_alloc) {
-		p = alloc_pages(gfp_flags, order);
+		p = alloc_pages_node(pool->nid, gfp_flags, order);
 		if (p)
 			p->private = order;
 		return p;
@@ -253,6 +263,21 @@ static struct page *ttm_pool_type_take(struct ttm_pool_type *pt)
 	return p;
 }
 
+/* Count the number of pages available in a pool_type */
+static unsigned int ttm_pool_type_count(struct ttm_pool_type *pt)
+{
+	unsigned int count = 0;
+	struct page *p;
+
+	spin_lock(&pt->lock);
+	/* Only used for debugfs and small refills, the overhead doesn't matter */
+	list_for_each_entry(p, &pt->pages, lru)
+		++count;
+	spin_unlock(&pt->lock);
+
+	return count;
+}
+
 /* Initialize and add a pool type to the global shrinker list */
 static void ttm_pool_type_init(struct ttm_pool_type *pt, struct ttm_pool *pool,
 			       enum ttm_caching caching, unsigned int order)
@@ -281,12 +306,18 @@ static void ttm_pool_type_fini(struct ttm_pool_type *pt)
 		ttm_pool_free_page(pt->pool, pt->caching, pt->order, p);
 }
 
+/* True if the pool has its own pool types instead of the global ones */
+static bool ttm_pool_uses_types(struct ttm_pool *pool)
+{
+	return pool->use_dma_alloc || pool->nid != NUMA_NO_NODE;
+}
+
 /* Return the pool_type to use for the given caching and order */
 static struct ttm_pool_type *ttm_pool_select_type(struct ttm_pool *pool,
 						  enum ttm_caching caching,
 						  unsigned int order)
 {
-	if (pool->use_dma_alloc)
+	if (ttm_pool_uses_types(pool))
 		return &pool->caching[caching].orders[order];
 
 #ifdef CONFIG_X86
@@ -344,6 +375,39 @@ static unsigned int ttm_pool_page_order(struct ttm_pool *pool, struct page *p)
 	return p->private;
 }
 
+/* Keep a few node local huge pages ready, compacting memory if needed */
+static void ttm_pool_refill_work(struct work_struct *work)
+{
+	struct ttm_pool *pool = container_of(work, typeof(*pool), refill_work);
+	unsigned int order = TTM_POOL_HUGE_ORDER;
+	struct ttm_pool_type *pt;
+	gfp_t gfp_flags;
+	struct page *p;
+
+	pt = &pool->caching[ttm_cached].orders[order];
+	gfp_flags = (pool->use_dma32 ? GFP_USER | GFP_DMA32 : GFP_HIGHUSER) |
+		__GFP_THISNODE | __GFP_RETRY_MAYFAIL | __GFP_NOWARN;
+
+	while (ttm_pool_type_count(pt) < READ_ONCE(huge_pool_reserve)) {
+		p = alloc_pages_node(pool->nid, gfp_flags, order);
+		if (!p)
+			break;
+
+		p->private = order;
+		ttm_pool_type_give(pt, p);
+		cond_resched();
+	}
+}
+
+/* Huge pages are only kept in reserve for NUMA bound pools */
+static bool ttm_pool_wants_refill(struct ttm_pool *pool,
+				  enum ttm_caching caching, unsigned int order)
+{
+	return !pool->use_dma_alloc && pool->nid != NUMA_NO_NODE &&
+	       caching == ttm_cached && order == TTM_POOL_HUGE_ORDER &&
+	       READ_ONCE(huge_pool_reserve);
+}
+
 /**
  * ttm_pool_alloc - Fill a ttm_tt object
  *
@@ -365,6 +429,7 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 	struct page **pages = tt->pages;
 	gfp_t gfp_flags = GFP_USER;
 	unsigned int i, order;
+	bool refill = false;
 	struct page *p;
 	int r;
 
@@ -390,6 +455,8 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 
 		pt = ttm_pool_select_type(pool, tt->caching, order);
 		p = pt ? ttm_pool_type_take(pt) : NULL;
+		if (ttm_pool_wants_refill(pool, tt->caching, order))
+			refill = true;
 		if (p) {
 			apply_caching = true;
 		} else {
@@ -430,6 +497,9 @@ int ttm_pool_alloc(struct ttm_pool *pool, struct ttm_tt *tt,
 	if (r)
 		goto error_free_all;
 
+	if (refill)
+		queue_work_node(pool->nid, system_unbound_wq, &pool->refill_work);
+
 	return 0;
 
 error_free_page:
@@ -492,7 +562,8 @@ EXPORT_SYMBOL(ttm_pool_free);
  * @use_dma_alloc: true if coherent DMA alloc should be used
  * @use_dma32: true if GFP_DMA32 should be used
  *
- * Initialize the pool and its pool types.
+ * Initialize the pool and its pool types. On NUMA systems pages are taken
+ * from the node of @dev and the pool keeps its own, node local, pool types.
  */
 void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
 		   bool use_dma_alloc, bool use_dma32)
@@ -502,10 +573,14 @@ void ttm_pool_init(struct ttm_pool *pool, struct device *dev,
 	WARN_ON(!dev && use_dma_alloc);
 
 	pool->dev = dev;
+	pool->nid = NUMA_NO_NODE;
+	if (dev && num_online_nodes() > 1)
+		pool->nid = dev_to_node(dev);
 	pool->use_dma_alloc = use_dma_alloc;
 	pool->use_dma32 = use_dma32;
+	INIT_WORK(&pool->refill_work, ttm_pool_refill_work);
 
-	if (use_dma_alloc) {
+	if (ttm_pool_uses_types(pool)) {
 		for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i)
 			for (j = 0; j < MAX_ORDER; ++j)
 				ttm_pool_type_init(&pool->caching[i].orders[j],
@@ -525,7 +600,9 @@ void ttm_pool_fini(struct ttm_pool *pool)
 {
 	unsigned int i, j;
 
-	if (pool->use_dma_alloc) {
+	cancel_work_sync(&pool->refill_work);
+
+	if (ttm_pool_uses_types(pool)) {
 		for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i)
 			for (j = 0; j < MAX_ORDER; ++j)
 				ttm_pool_type_fini(&pool->caching[i].orders[j]);
@@ -560,21 +637,6 @@ static unsigned long ttm_pool_shrinker_count(struct shrinker *shrink,
 }
 
 #ifdef CONFIG_DEBUG_FS
-/* Count the number of pages available in a pool_type */
-static unsigned int ttm_pool_type_count(struct ttm_pool_type *pt)
-{
-	unsigned int count = 0;
-	struct page *p;
-
-	spin_lock(&pt->lock);
-	/* Only used for debugfs, the overhead doesn't matter */
-	list_for_each_entry(p, &pt->pages, lru)
-		++count;
-	spin_unlock(&pt->lock);
-
-	return count;
-}
-
 /* Print a nice header for the order */
 static void ttm_pool_debugfs_header(struct seq_file *m)
 {
@@ -638,7 +700,7 @@ int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m)
 {
 	unsigned int i;
 
-	if (!pool->use_dma_alloc) {
+	if (!ttm_pool_uses_types(pool)) {
 		seq_puts(m, "unused\n");
 		return 0;
 	}
@@ -647,7 +709,10 @@ int ttm_pool_debugfs(struct ttm_pool *pool, struct seq_file *m)
 
 	spin_lock(&shrinker_lock);
 	for (i = 0; i < TTM_NUM_CACHING_TYPES; ++i) {
-		seq_puts(m, "DMA ");
+		if (pool->use_dma_alloc)
+			seq_puts(m, "DMA ");
+		else
+			seq_printf(m, "N%d ", pool->nid);
 		switch (i) {
 		case ttm_cached:
 			seq_puts(m, "\t:");
@@ -58,6 +58,9 @@
 #define MAX_CAPSET_ID 63
 #define MAX_RINGS 64
 
+/* host fence completions retired per fence driver lock acquisition */
+#define VIRTIO_GPU_FENCE_BATCH 16
+
 struct virtio_gpu_object_params {
 	unsigned long size;
 	bool dumb;
@@ -444,6 +447,9 @@ void virtio_gpu_fence_emit(struct virtio_gpu_device *vgdev,
 			  struct virtio_gpu_fence *fence);
 void virtio_gpu_fence_event_process(struct virtio_gpu_device *vdev,
 				    u64 fence_id);
+void virtio_gpu_fence_event_process_batch(struct virtio_gpu_device *vgdev,
+					  const u64 *fence_ids,
+					  unsigned int count);
 
 /* virtgpu_object.c */
 void virtio_gpu_cleanup_object(struct virtio_gpu_object *bo);
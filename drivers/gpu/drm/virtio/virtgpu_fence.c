@@ -124,52 +124,85 @@ void virtio_gpu_fence_emit(struct virtio_gpu_device *vgdev,
 	}
 }
 
-void virtio_gpu_fence_event_process(struct virtio_gpu_device *vgdev,
-				    u64 fence_id)
+static void virtio_gpu_fence_signal_locked(struct virtio_gpu_device *vgdev,
+					   struct virtio_gpu_fence *fence)
+{
+	dma_fence_signal_locked(&fence->f);
+	if (fence->e) {
+		drm_send_event(vgdev->ddev, &fence->e->base);
+		fence->e = NULL;
+	}
+
+	list_del(&fence->node);
+	dma_fence_put(&fence->f);
+}
+
+static void virtio_gpu_fence_process_one(struct virtio_gpu_device *vgdev,
+					 u64 fence_id)
 {
 	struct virtio_gpu_fence_driver *drv = &vgdev->fence_drv;
-	struct virtio_gpu_fence *signaled, *curr, *tmp;
-	unsigned long irq_flags;
+	struct virtio_gpu_fence *signaled = NULL, *curr, *tmp;
 
-	spin_lock_irqsave(&drv->lock, irq_flags);
-	atomic64_set(&vgdev->fence_drv.last_fence_id, fence_id);
-	list_for_each_entry_safe(curr, tmp, &drv->fences, node) {
-		if (fence_id != curr->fence_id)
-			continue;
+	/*
+	 * Fences are added to the list in emission order, so everything the
+	 * host retired along with @fence_id sits in front of it.
+	 */
+	list_for_each_entry(curr, &drv->fences, node) {
+		if (curr->fence_id == fence_id) {
+			signaled = curr;
+			break;
+		}
+	}
+	if (!signaled)
+		return;
 
-		signaled = curr;
+	/*
+	 * Signal any fences with a strictly smaller sequence number
+	 * than the current signaled fence.
+	 */
+	list_for_each_entry_safe(curr, tmp, &drv->fences, node) {
+		if (curr == signaled)
+			break;
 
-		/*
-		 * Signal any fences with a strictly smaller sequence number
-		 * than the current signaled fence.
-		 */
-		list_for_each_entry_safe(curr, tmp, &drv->fences, node) {
-			/* dma-fence contexts must match */
-			if (signaled->f.context != curr->f.context)
-				continue;
+		/* dma-fence contexts must match */
+		if (signaled->f.context != curr->f.context)
+			continue;
 
-			if (!dma_fence_is_later(&signaled->f, &curr->f))
-				continue;
+		virtio_gpu_fence_signal_locked(vgdev, curr);
+	}
 
-			dma_fence_signal_locked(&curr->f);
-			if (curr->e) {
-				drm_send_event(vgdev->ddev, &curr->e->base);
-				curr->e = NULL;
-			}
+	virtio_gpu_fence_signal_locked(vgdev, signaled);
+}
 
-			list_del(&curr->node);
-			dma_fence_put(&curr->f);
-		}
+/**
+ * virtio_gpu_fence_event_process_batch - retire a batch of host fences
+ * @vgdev: virtio-gpu device
+ * @fence_ids: fence ids reported by the host, in response order
+ * @count: number of entries in @fence_ids
+ *
+ * Signals every fence in @fence_ids together with all earlier fences on
+ * the same context, taking the fence driver lock only once for the batch.
+ */
+void virtio_gpu_fence_event_process_batch(struct virtio_gpu_device *vgdev,
+					  const u64 *fence_ids,
+					  unsigned int count)
+{
+	struct virtio_gpu_fence_driver *drv = &vgdev->fence_drv;
+	unsigned long irq_flags;
+	unsigned int i;
 
-		dma_fence_signal_locked(&signaled->f);
-		if (signaled->e) {
-			drm_send_event(vgdev->ddev, &signaled->e->base);
-			signaled->e = NULL;
-		}
+	if (!count)
+		return;
 
-		list_del(&signaled->node);
-		dma_fence_put(&signaled->f);
-		break;
-	}
+	spin_lock_irqsave(&drv->lock, irq_flags);
+	atomic64_set(&vgdev->fence_drv.last_fence_id, fence_ids[count - 1]);
+	for (i = 0; i < count; i++)
+		virtio_gpu_fence_process_one(vgdev, fence_ids[i]);
 	spin_unlock_irqrestore(&drv->lock, irq_flags);
 }
+
+void virtio_gpu_fence_event_process(struct virtio_gpu_device *vgdev,
+				    u64 fence_id)
+{
+	virtio_gpu_fence_event_process_batch(vgdev, &fence_id, 1);
+}
@@ -199,7 +199,8 @@ void virtio_gpu_dequeue_ctrl_func(struct work_struct *work)
 	struct list_head reclaim_list;
 	struct virtio_gpu_vbuffer *entry, *tmp;
 	struct virtio_gpu_ctrl_hdr *resp;
-	u64 fence_id;
+	u64 fence_ids[VIRTIO_GPU_FENCE_BATCH];
+	unsigned int nr_fences = 0;
 
 	INIT_LIST_HEAD(&reclaim_list);
 	spin_lock(&vgdev->ctrlq.qlock);
@@ -226,12 +227,18 @@ void virtio_gpu_dequeue_ctrl_func(struct work_struct *work)
 				DRM_DEBUG("response 0x%x\n", le32_to_cpu(resp->type));
 		}
 		if (resp->flags & cpu_to_le32(VIRTIO_GPU_FLAG_FENCE)) {
-			fence_id = le64_to_cpu(resp->fence_id);
-			virtio_gpu_fence_event_process(vgdev, fence_id);
+			fence_ids[nr_fences++] = le64_to_cpu(resp->fence_id);
+			if (nr_fences == ARRAY_SIZE(fence_ids)) {
+				virtio_gpu_fence_event_process_batch(vgdev,
+								     fence_ids,
+								     nr_fences);
+				nr_fences = 0;
+			}
 		}
 		if (entry->resp_cb)
 			entry->resp_cb(vgdev, entry);
 	}
+	virtio_gpu_fence_event_process_batch(vgdev, fence_ids, nr_fences);
 	wake_up(&vgdev->ctrlq.ack_queue);
 
 	list_for_each_entry_safe(entry, tmp, &reclaim_list, list) {
@@ -1093,6 +1093,60 @@ int vmbus_sendpacket(struct vmbus_channel *channel, void *buffer,
 }
 EXPORT_SYMBOL(vmbus_sendpacket);
 
+/**
+ * vmbus_sendpacket_batch() - Send several packets on the given channel
+ * @channel: Pointer to vmbus_channel structure
+ * @pkts: Packets to send
+ * @count: Number of packets
+ *
+ * Sends the packets like vmbus_sendpacket_getid(), but takes the ring lock
+ * once, publishes the ring write index once and signals the host at most
+ * once for the whole batch.
+ *
+ * Returns the number of packets sent, which is less than @count if the ring
+ * buffer filled up. The trans_id of each packet sent is set. Returns a
+ * negative error if no packet was sent.
+ */
+int vmbus_sendpacket_batch(struct vmbus_channel *channel,
+			   struct vmbus_batch_packet *pkts, u32 count)
+{
+	static u64 aligned_data;
+	struct vmbus_batch_packet *pkt;
+	u32 packetlen;
+	u32 packetlen_aligned;
+	u32 i;
+
+	if (count == 0)
+		return 0;
+
+	for (i = 0; i < count; i++) {
+		pkt = &pkts[i];
+		packetlen = sizeof(struct vmpacket_descriptor) + pkt->bufferlen;
+		packetlen_aligned = ALIGN(packetlen, sizeof(u64));
+
+		/* Setup the descriptor */
+		pkt->desc.type = pkt->type;
+		pkt->desc.flags = pkt->flags;
+		/* in 8-bytes granularity */
+		pkt->desc.offset8 = sizeof(struct vmpacket_descriptor) >> 3;
+		pkt->desc.len8 = (u16)(packetlen_aligned >> 3);
+		/* will be updated in hv_ringbuffer_write_batch() */
+		pkt->desc.trans_id = VMBUS_RQST_ERROR;
+
+		pkt->kv[0].iov_base = &pkt->desc;
+		pkt->kv[0].iov_len = sizeof(struct vmpacket_descriptor);
+		pkt->kv[1].iov_base = pkt->buffer;
+		pkt->kv[1].iov_len = pkt->bufferlen;
+		/* The padding is never written, only copied to the ring */
+		pkt->kv[2].iov_base = &aligned_data;
+		pkt->kv[2].iov_len = (packetlen_aligned - packetlen);
+		pkt->kv_count = pkt->bufferlen != 0 ? 3 : 1;
+	}
+
+	return hv_ringbuffer_write_batch(channel, pkts, count);
+}
+EXPORT_SYMBOL_GPL(vmbus_sendpacket_batch);
+
 /*
  * vmbus_sendpacket_pagebuffer - Send a range of single-page buffer
  * packets using a GPADL Direct packet type. This interface allows you
@@ -348,6 +348,13 @@ static struct vmbus_channel *alloc_channel(void)
 	if (!channel)
 		return NULL;
 
+	channel->stats = alloc_percpu_gfp(struct vmbus_channel_stats,
+					  GFP_ATOMIC);
+	if (!channel->stats) {
+		kfree(channel);
+		return NULL;
+	}
+
 	spin_lock_init(&channel->sched_lock);
 	init_completion(&channel->rescind_event);
 
@@ -489,6 +496,33 @@ void vmbus_free_channels(void)
 	}
 }
 
+/*
+ * Report the time it took for the devices of the initial offers to be added
+ * once the last of them is, and all offers have been delivered.
+ */
+static void vmbus_check_devices_ready(void)
+{
+	ktime_t requested = vmbus_connection.offers_requested;
+
+	if (!READ_ONCE(vmbus_connection.offers_delivered) ||
+	    atomic_read(&vmbus_connection.nr_primary_adds_pending))
+		return;
+
+	if (atomic_xchg(&vmbus_connection.devices_ready_reported, 1))
+		return;
+
+	WRITE_ONCE(vmbus_connection.devices_ready, ktime_get());
+	pr_info("offers delivered in %lld ms, devices ready in %lld ms\n",
+		ktime_ms_delta(vmbus_connection.offers_delivered, requested),
+		ktime_ms_delta(vmbus_connection.devices_ready, requested));
+}
+
+static void vmbus_primary_add_done(void)
+{
+	if (atomic_dec_and_test(&vmbus_connection.nr_primary_adds_pending))
+		vmbus_check_devices_ready();
+}
+
 /* Note: the function can run concurrently for primary/sub channels. */
 static void vmbus_add_channel_work(struct work_struct *work)
 {
@@ -544,6 +578,7 @@ static void vmbus_add_channel_work(struct work_struct *work)
 	}
 
 	newchannel->probe_done = true;
+	vmbus_primary_add_done();
 	return;
 
 err_deq_chan:
@@ -568,6 +603,25 @@ static void vmbus_add_channel_work(struct work_struct *work)
 	vmbus_release_relid(newchannel->offermsg.child_relid);
 
 	free_channel(newchannel);
+	if (!primary_channel)
+		vmbus_primary_add_done();
+}
+
+/*
+ * Synthetic NICs are named in the order they are probed, and so are the disks
+ * behind storvsc and IDE controllers, so keep adding them one after the other;
+ * all other devices can be added in parallel.
+ */
+static bool vmbus_add_channel_ordered(struct vmbus_channel *channel)
+{
+	switch (channel->device_id) {
+	case HV_NIC:
+	case HV_SCSI:
+	case HV_IDE:
+		return true;
+	default:
+		return false;
+	}
 }
 
 /*
@@ -624,6 +678,13 @@ static void vmbus_process_offer(struct vmbus_channel *newchannel)
 	if (is_hvsock_channel(newchannel) || is_sub_channel(newchannel))
 		atomic_inc(&vmbus_connection.nr_chan_close_on_suspend);
 
+	/*
+	 * Account for the primary channel to be added before all offers can
+	 * be reported as delivered, which is only handled after this offer.
+	 */
+	if (fnew)
+		atomic_inc(&vmbus_connection.nr_primary_adds_pending);
+
 	/*
 	 * Now that we have acquired the channel_mutex,
 	 * we can release the potentially racing rescind thread.
@@ -644,6 +705,7 @@ static void vmbus_process_offer(struct vmbus_channel *newchannel)
 			 * Don't call free_channel(), because newchannel->kobj
 			 * is not initialized yet.
 			 */
+			free_percpu(newchannel->stats);
 			kfree(newchannel);
 			WARN_ON_ONCE(1);
 			return;
@@ -681,8 +743,12 @@ static void vmbus_process_offer(struct vmbus_channel *newchannel)
 	 * sub-channels.
 	 */
 	INIT_WORK(&newchannel->add_channel_work, vmbus_add_channel_work);
-	wq = fnew ? vmbus_connection.handle_primary_chan_wq :
-		    vmbus_connection.handle_sub_chan_wq;
+	if (!fnew)
+		wq = vmbus_connection.handle_sub_chan_wq;
+	else if (vmbus_add_channel_ordered(newchannel))
+		wq = vmbus_connection.handle_primary_chan_wq;
+	else
+		wq = vmbus_connection.handle_primary_chan_par_wq;
 	queue_work(wq, &newchannel->add_channel_work);
 }
 
@@ -1271,11 +1337,17 @@ EXPORT_SYMBOL_GPL(vmbus_hvsock_device_unregister);
  * vmbus_onoffers_delivered -
  * This is invoked when all offers have been delivered.
  *
- * Nothing to do here.
+ * Being a blocking handler, this runs after the preceding offers have
+ * been processed, so only the adding of their channels may be pending.
  */
 static void vmbus_onoffers_delivered(
 			struct vmbus_channel_message_header *hdr)
 {
+	WRITE_ONCE(vmbus_connection.offers_delivered, ktime_get());
+
+	/* Pairs with atomic_dec_and_test() in vmbus_primary_add_done(). */
+	smp_mb();
+	vmbus_check_devices_ready();
 }
 
 /*
@@ -1569,6 +1641,11 @@ int vmbus_request_offers(void)
 
 	msg->msgtype = CHANNELMSG_REQUESTOFFERS;
 
+	vmbus_connection.offers_requested = ktime_get();
+	WRITE_ONCE(vmbus_connection.offers_delivered, 0);
+	WRITE_ONCE(vmbus_connection.devices_ready, 0);
+	atomic_set(&vmbus_connection.devices_ready_reported, 0);
+
 	ret = vmbus_post_msg(msg, sizeof(struct vmbus_channel_message_header),
 			     true);
 
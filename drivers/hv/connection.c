@@ -178,6 +178,13 @@ int vmbus_connect(void)
 		goto cleanup;
 	}
 
+	vmbus_connection.handle_primary_chan_par_wq =
+		alloc_workqueue("hv_pri_chan_par", WQ_UNBOUND | WQ_MEM_RECLAIM, 0);
+	if (!vmbus_connection.handle_primary_chan_par_wq) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+
 	vmbus_connection.handle_sub_chan_wq =
 		create_workqueue("hv_sub_chan");
 	if (!vmbus_connection.handle_sub_chan_wq) {
@@ -354,6 +361,9 @@ void vmbus_disconnect(void)
 	if (vmbus_connection.handle_sub_chan_wq)
 		destroy_workqueue(vmbus_connection.handle_sub_chan_wq);
 
+	if (vmbus_connection.handle_primary_chan_par_wq)
+		destroy_workqueue(vmbus_connection.handle_primary_chan_par_wq);
+
 	if (vmbus_connection.handle_primary_chan_wq)
 		destroy_workqueue(vmbus_connection.handle_primary_chan_wq);
 
@@ -403,6 +413,36 @@ struct vmbus_channel *relid2channel(u32 relid)
 	return READ_ONCE(vmbus_connection.channels[relid]);
 }
 
+/*
+ * vmbus_chan_poll - Poll the inbound ring of a busy batched channel
+ *
+ * Called with the host interrupts masked after the channel callback
+ * emptied the inbound ring. Returns true if new packets arrived within
+ * channel->poll_usecs. Otherwise the channel is marked idle, so that the
+ * next round goes back to interrupt mode right away.
+ */
+static bool vmbus_chan_poll(struct vmbus_channel *channel)
+{
+	u32 usecs = READ_ONCE(channel->poll_usecs);
+	u64 deadline;
+
+	if (!usecs || !channel->poll_active)
+		return false;
+
+	deadline = ktime_get_ns() + (u64)usecs * NSEC_PER_USEC;
+	do {
+		if (hv_get_bytes_to_read(&channel->inbound)) {
+			++channel->poll_hits;
+			return true;
+		}
+		cpu_relax();
+	} while (ktime_get_ns() < deadline);
+
+	channel->poll_active = false;
+	++channel->poll_misses;
+	return false;
+}
+
 /*
  * vmbus_on_event - Process a channel event notification
  *
@@ -416,6 +456,9 @@ struct vmbus_channel *relid2channel(u32 relid)
  *    available to read. In this case we repeat the process.
  *    If this tasklet has been running for a long time
  *    then reschedule ourselves.
+ * 4. If polling is enabled for the channel and the channel was found busy
+ *    (packets arrived while the host signaling was being enabled), keep
+ *    the host signaling disabled and poll the ring before step 3.
  */
 void vmbus_on_event(unsigned long data)
 {
@@ -436,14 +479,20 @@ void vmbus_on_event(unsigned long data)
 		if (unlikely(callback_fn == NULL))
 			return;
 
+		this_cpu_inc(channel->stats->callbacks);
 		(*callback_fn)(channel->channel_callback_context);
 
 		if (channel->callback_mode != HV_CALL_BATCHED)
 			return;
 
+		if (vmbus_chan_poll(channel))
+			continue;
+
 		if (likely(hv_end_read(&channel->inbound) == 0))
 			return;
 
+		/* More packets arrived while enabling the host signaling */
+		channel->poll_active = true;
 		hv_begin_read(&channel->inbound);
 	} while (likely(time_before(jiffies, time_limit)));
 
@@ -528,7 +577,7 @@ void vmbus_set_event(struct vmbus_channel *channel)
 	if (!channel->is_dedicated_interrupt)
 		vmbus_send_interrupt(child_relid);
 
-	++channel->sig_events;
+	this_cpu_inc(channel->stats->sig_events);
 
 	if (hv_isolation_type_snp())
 		hv_ghcb_hypercall(HVCALL_SIGNAL_EVENT, &channel->sig_event,
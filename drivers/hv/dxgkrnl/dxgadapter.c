@@ -236,7 +236,10 @@ void dxgadapter_release_lock_exclusive(struct dxgadapter *adapter)
 
 int dxgadapter_acquire_lock_shared(struct dxgadapter *adapter)
 {
+	u64 start = dxgstats_start();
+
 	down_read(&adapter->core_lock);
+	dxgstats_lock_done(DXGSTATS_LOCK_ADAPTER, start);
 	if (adapter->adapter_state == DXGADAPTER_STATE_ACTIVE)
 		return 0;
 	dxgadapter_release_lock_shared(adapter);
@@ -461,7 +464,10 @@ void dxgdevice_release_context_list_lock(struct dxgdevice *device)
 
 void dxgdevice_acquire_alloc_list_lock(struct dxgdevice *device)
 {
+	u64 start = dxgstats_start();
+
 	down_write(&device->alloc_list_lock);
+	dxgstats_lock_done(DXGSTATS_LOCK_ALLOC_LIST, start);
 }
 
 void dxgdevice_release_alloc_list_lock(struct dxgdevice *device)
@@ -471,7 +477,10 @@ void dxgdevice_release_alloc_list_lock(struct dxgdevice *device)
 
 void dxgdevice_acquire_alloc_list_lock_shared(struct dxgdevice *device)
 {
+	u64 start = dxgstats_start();
+
 	down_read(&device->alloc_list_lock);
+	dxgstats_lock_done(DXGSTATS_LOCK_ALLOC_LIST, start);
 }
 
 void dxgdevice_release_alloc_list_lock_shared(struct dxgdevice *device)
@@ -724,7 +733,7 @@ void dxgdevice_release(struct kref *refcount)
 	struct dxgdevice *device;
 
 	device = container_of(refcount, struct dxgdevice, device_kref);
-	vfree(device);
+	kvfree_rcu(device, rcu);
 }
 
 void dxgdevice_add_paging_queue(struct dxgdevice *device,
@@ -835,7 +844,7 @@ void dxgcontext_release(struct kref *refcount)
 	struct dxgcontext *context;
 
 	context = container_of(refcount, struct dxgcontext, context_kref);
-	vfree(context);
+	kvfree_rcu(context, rcu);
 }
 
 int dxgcontext_add_hwqueue(struct dxgcontext *context,
@@ -991,7 +1000,7 @@ void dxgpagingqueue_destroy(struct dxgpagingqueue *pqueue)
 	hmgrtable_unlock(&process->handle_table, DXGLOCK_EXCL);
 	if (pqueue->device)
 		dxgdevice_remove_paging_queue(pqueue);
-	vfree(pqueue);
+	kvfree_rcu(pqueue, rcu);
 }
 
 struct dxgprocess_adapter *dxgprocess_adapter_create(struct dxgprocess *process,
@@ -1371,5 +1380,5 @@ void dxghwqueue_release(struct kref *refcount)
 	struct dxghwqueue *hwqueue;
 
 	hwqueue = container_of(refcount, struct dxghwqueue, hwqueue_kref);
-	vfree(hwqueue);
+	kvfree_rcu(hwqueue, rcu);
 }
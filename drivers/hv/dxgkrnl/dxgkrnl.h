@@ -26,6 +26,7 @@
 #include <linux/miscdevice.h>
 #include <linux/pci.h>
 #include <linux/hyperv.h>
+#include <linux/workqueue.h>
 
 struct dxgprocess;
 struct dxgadapter;
@@ -75,6 +76,12 @@ enum dxgobjectstate {
 	DXGOBJECTSTATE_DESTROYED,
 };
 
+/*
+ * The maximum number of VM bus sub-channels, which are opened for a primary
+ * channel when the host offers them.
+ */
+#define DXG_MAX_SUB_CHANNELS	16
+
 struct dxgvmbuschannel {
 	struct vmbus_channel	*channel;
 	struct hv_device	*hdev;
@@ -83,11 +90,42 @@ struct dxgvmbuschannel {
 	struct list_head	packet_list_head;
 	struct kmem_cache	*packet_cache;
 	atomic64_t		packet_request_id;
+	/*
+	 * Sub-channels of the primary channel. The packet cache is shared
+	 * with the primary channel.
+	 * num_sub_channels is written under sub_channel_mutex and read
+	 * locklessly by the message senders. Once the first process message
+	 * is sent, sub_channels_sealed is set and later offers are ignored,
+	 * so that the channel of a process never changes.
+	 */
+	struct mutex		sub_channel_mutex;
+	int			num_sub_channels;
+	bool			sub_channels_sealed;
+	struct dxgvmbuschannel	*sub_channels[DXG_MAX_SUB_CHANNELS];
 };
 
 int dxgvmbuschannel_init(struct dxgvmbuschannel *ch, struct hv_device *hdev);
 void dxgvmbuschannel_destroy(struct dxgvmbuschannel *ch);
 void dxgvmbuschannel_receive(void *ctx);
+int dxgvmb_init_msg_caches(void);
+void dxgvmb_destroy_msg_caches(void);
+void dxgvmb_debugfs_init(struct dentry *dir);
+
+/*
+ * Latency statistics in debugfs
+ */
+enum dxgstats_lock {
+	DXGSTATS_LOCK_ADAPTER,
+	DXGSTATS_LOCK_ALLOC_LIST,
+	DXGSTATS_LOCK_COUNT
+};
+
+int dxgstats_init(struct dentry *dir);
+void dxgstats_destroy(void);
+u64 dxgstats_start(void);
+void dxgstats_ioctl_done(unsigned int code, u64 start);
+void dxgstats_vmbus_done(u32 command_type, u64 start);
+void dxgstats_lock_done(enum dxgstats_lock lock, u64 start);
 
 struct dxgpagingqueue {
 	struct dxgdevice	*device;
@@ -97,6 +135,8 @@ struct dxgpagingqueue {
 	struct d3dkmthandle	handle;
 	struct d3dkmthandle	syncobj_handle;
 	void			*mapped_address;
+	/* The object is looked up in the handle table without the lock */
+	struct rcu_head		rcu;
 };
 
 /*
@@ -306,6 +346,9 @@ struct dxgglobal {
 	bool			global_channel_initialized;
 	bool			async_msg_enabled;
 	bool			map_guest_pages_enabled;
+
+	/* The driver debugfs directory */
+	struct dentry		*debugfs_dir;
 };
 
 extern struct dxgglobal		*dxgglobal;
@@ -355,6 +398,47 @@ void dxgprocess_adapter_remove_device(struct dxgdevice *device);
 void dxgprocess_adapter_stop(struct dxgprocess_adapter *adapter_info);
 void dxgprocess_adapter_destroy(struct dxgprocess_adapter *adapter_info);
 
+/*
+ * Commands, which the caller does not wait for, are not sent to the host one
+ * by one when the defer_gpu_va_updates module parameter is set. These are
+ * update GPU VA operations with do_not_wait, completed by signalling a sync
+ * object. Consecutive commands of the same type and with the same parameters
+ * are merged into a single asynchronous VM bus message. The message is sent
+ * before any other message of the process, when it is full or after
+ * DXG_DEFERRED_MSG_DELAY jiffies, whichever comes first.
+ */
+#define DXG_DEFERRED_MSG_DELAY	1
+
+struct dxgdeferredmsg {
+	struct mutex		lock;
+	struct delayed_work	flush_work;
+	/* DXG_MAX_VM_BUS_PACKET_SIZE buffer for the pending message */
+	void			*buffer;
+	/* Total size of the pending message */
+	u32			size;
+	/* Number of pending operations. Zero when there is no pending message */
+	u32			count;
+	/* enum dxgkvmb_commandtype of the pending message */
+	u32			command_type;
+	struct winluid		vgpu_luid;
+};
+
+/* Residency statistics of a process, exposed in debugfs */
+enum dxgresidency_stat {
+	DXGRES_MAKE_RESIDENT,
+	DXGRES_MAKE_RESIDENT_ALLOCS,
+	DXGRES_MAKE_RESIDENT_PENDING,
+	DXGRES_EVICT,
+	DXGRES_EVICT_ALLOCS,
+	DXGRES_BYTES_TO_TRIM,
+	DXGRES_OFFER,
+	DXGRES_OFFER_ALLOCS,
+	DXGRES_RECLAIM,
+	DXGRES_RECLAIM_ALLOCS,
+	DXGRES_SET_PRIORITY,
+	DXGRES_COUNT
+};
+
 /*
  * The structure represents a process, which opened the /dev/dxg device.
  * A corresponding object is created on the host.
@@ -386,8 +470,24 @@ struct dxgprocess {
 
 	/* List of opened adapters (dxgprocess_adapter) */
 	struct list_head	process_adapter_list_head;
+	/*
+	 * Reusable buffer for large VM bus messages (private driver data,
+	 * escape payloads). It is allocated on first use and owned by the
+	 * message, which holds msg_buffer_mutex.
+	 */
+	struct mutex		msg_buffer_mutex;
+	void			*msg_buffer;
+	struct dxgdeferredmsg	deferred_msg;
+	atomic64_t		residency_stats[DXGRES_COUNT];
 };
 
+static inline void dxgprocess_residency_add(struct dxgprocess *process,
+					    enum dxgresidency_stat stat,
+					    u64 value)
+{
+	atomic64_add(value, &process->residency_stats[stat]);
+}
+
 struct dxgprocess *dxgprocess_create(void);
 void dxgprocess_destroy(struct dxgprocess *process);
 void dxgprocess_release(struct kref *refcount);
@@ -508,6 +608,8 @@ struct dxgdevice {
 	enum d3dkmt_deviceexecution_state execution_state;
 	int			execution_state_counter;
 	u32			handle_valid;
+	/* The object is looked up in the handle table without the lock */
+	struct rcu_head		rcu;
 };
 
 struct dxgdevice *dxgdevice_create(struct dxgadapter *a, struct dxgprocess *p);
@@ -552,6 +654,8 @@ struct dxgcontext {
 	struct kref		context_kref;
 	struct d3dkmthandle	handle;
 	struct d3dkmthandle	device_handle;
+	/* The object is looked up in the handle table without the lock */
+	struct rcu_head		rcu;
 };
 
 struct dxgcontext *dxgcontext_create(struct dxgdevice *dev);
@@ -578,6 +682,8 @@ struct dxghwqueue {
 	struct d3dkmthandle	handle;
 	struct d3dkmthandle	device_handle;
 	void			*progress_fence_mapped_address;
+	/* The object is looked up in the handle table without the lock */
+	struct rcu_head		rcu;
 };
 
 struct dxghwqueue *dxghwqueue_create(struct dxgcontext *ctx);
@@ -806,6 +912,9 @@ int dxgvmb_send_reserve_gpu_va(struct dxgprocess *pr,
 			       struct d3dddi_reservegpuvirtualaddress *args);
 int dxgvmb_send_free_gpu_va(struct dxgprocess *pr, struct dxgadapter *adapter,
 			    struct d3dkmt_freegpuvirtualaddress *args);
+void dxgvmb_deferred_msg_init(struct dxgprocess *process);
+void dxgvmb_deferred_msg_destroy(struct dxgprocess *process);
+void dxgvmb_flush_deferred_msg(struct dxgprocess *process);
 int dxgvmb_send_update_gpu_va(struct dxgprocess *pr, struct dxgadapter *adapter,
 			      struct d3dkmt_updategpuvirtualaddress *args);
 int dxgvmb_send_create_sync_object(struct dxgprocess *pr,
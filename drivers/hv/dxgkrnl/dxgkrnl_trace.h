@@ -0,0 +1,86 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+
+/*
+ * Copyright (c) 2019, Microsoft Corporation.
+ *
+ * Dxgkrnl Graphics Driver
+ * Trace points
+ *
+ */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM dxgkrnl
+
+#if !defined(_DXGKRNL_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define _DXGKRNL_TRACE_H
+
+#include <linux/tracepoint.h>
+
+TRACE_EVENT(dxgk_ioctl_enter,
+	    TP_PROTO(unsigned int code),
+	    TP_ARGS(code),
+	    TP_STRUCT__entry(
+		    __field(unsigned int, code)
+		    ),
+	    TP_fast_assign(
+		    __entry->code = code;
+		    ),
+	    TP_printk("code=0x%x", __entry->code)
+	);
+
+TRACE_EVENT(dxgk_ioctl_exit,
+	    TP_PROTO(unsigned int code, int ret),
+	    TP_ARGS(code, ret),
+	    TP_STRUCT__entry(
+		    __field(unsigned int, code)
+		    __field(int, ret)
+		    ),
+	    TP_fast_assign(
+		    __entry->code = code;
+		    __entry->ret = ret;
+		    ),
+	    TP_printk("code=0x%x ret=%d", __entry->code, __entry->ret)
+	);
+
+TRACE_EVENT(dxgvmb_send_sync_msg,
+	    TP_PROTO(u32 command_type, bool global, u32 size),
+	    TP_ARGS(command_type, global, size),
+	    TP_STRUCT__entry(
+		    __field(u32, command_type)
+		    __field(bool, global)
+		    __field(u32, size)
+		    ),
+	    TP_fast_assign(
+		    __entry->command_type = command_type;
+		    __entry->global = global;
+		    __entry->size = size;
+		    ),
+	    TP_printk("command=%u global=%d size=%u",
+		      __entry->command_type, __entry->global, __entry->size)
+	);
+
+TRACE_EVENT(dxgvmb_sync_msg_done,
+	    TP_PROTO(u32 command_type, bool global, int ret),
+	    TP_ARGS(command_type, global, ret),
+	    TP_STRUCT__entry(
+		    __field(u32, command_type)
+		    __field(bool, global)
+		    __field(int, ret)
+		    ),
+	    TP_fast_assign(
+		    __entry->command_type = command_type;
+		    __entry->global = global;
+		    __entry->ret = ret;
+		    ),
+	    TP_printk("command=%u global=%d ret=%d",
+		      __entry->command_type, __entry->global, __entry->ret)
+	);
+
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE dxgkrnl_trace
+#endif /* _DXGKRNL_TRACE_H */
+
+/* This part must be outside protection */
+#include <trace/define_trace.h>
@@ -15,6 +15,7 @@
 #include <linux/eventfd.h>
 #include <linux/hyperv.h>
 #include <linux/pci.h>
+#include <linux/debugfs.h>
 
 #include "dxgkrnl.h"
 
@@ -871,6 +872,18 @@ static int dxgglobal_create(void)
 	spin_lock_init(&dxgglobal->host_event_list_mutex);
 	atomic64_set(&dxgglobal->host_event_id, 1);
 
+	ret = dxgvmb_init_msg_caches();
+	if (ret) {
+		vfree(dxgglobal);
+		dxgglobal = NULL;
+		return ret;
+	}
+
+	dxgglobal->debugfs_dir = debugfs_create_dir("dxgkrnl", NULL);
+	dxgvmb_debugfs_init(dxgglobal->debugfs_dir);
+	if (dxgstats_init(dxgglobal->debugfs_dir))
+		pr_err("failed to initialize latency statistics");
+
 	pr_debug("dxgglobal_init end\n");
 	pr_debug("dxgglobal_init end\n");
 	return ret;
@@ -889,6 +902,10 @@ static void dxgglobal_destroy(void)
 		if (dxgglobal->pci_registered)
 			pci_unregister_driver(&dxg_pci_drv);
 
+		debugfs_remove_recursive(dxgglobal->debugfs_dir);
+		dxgstats_destroy();
+		dxgvmb_destroy_msg_caches();
+
 		vfree(dxgglobal);
 		dxgglobal = NULL;
 	}
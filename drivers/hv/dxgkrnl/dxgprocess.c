@@ -31,6 +31,8 @@ struct dxgprocess *dxgprocess_create(void)
 		process->process = current;
 		process->pid = current->pid;
 		process->tgid = current->tgid;
+		mutex_init(&process->msg_buffer_mutex);
+		dxgvmb_deferred_msg_init(process);
 		ret = dxgvmb_send_create_process(process);
 		if (ret < 0) {
 			pr_debug("send_create_process failed\n");
@@ -63,6 +65,10 @@ void dxgprocess_destroy(struct dxgprocess *process)
 	struct dxgprocess_adapter *entry;
 	struct dxgprocess_adapter *tmp;
 
+	/* Deferred messages must reach the host before the objects are gone */
+	dxgvmb_flush_deferred_msg(process);
+	cancel_delayed_work_sync(&process->deferred_msg.flush_work);
+
 	/* Destroy all adapter state */
 	dxgglobal_acquire_process_adapter_lock();
 	list_for_each_entry_safe(entry, tmp,
@@ -119,6 +125,9 @@ void dxgprocess_release(struct kref *refcount)
 
 	if (process->host_handle.v)
 		dxgvmb_send_destroy_process(process->host_handle);
+	if (process->msg_buffer)
+		vfree(process->msg_buffer);
+	dxgvmb_deferred_msg_destroy(process);
 	vfree(process);
 }
 
@@ -258,6 +267,55 @@ struct dxgadapter *dxgprocess_adapter_by_handle(struct dxgprocess *process,
 	return adapter;
 }
 
+/*
+ * Lockless lookup of the device object. Returns NULL when the lookup races
+ * with a handle table modification or when the handle is invalid. In this
+ * case the caller retries the lookup under the handle table lock.
+ */
+static struct dxgdevice *
+dxgprocess_device_by_object_handle_rcu(struct dxgprocess *process,
+				       enum hmgrentry_type t,
+				       struct d3dkmthandle handle)
+{
+	struct dxgdevice *device = NULL;
+	struct d3dkmthandle device_handle = {};
+	void *obj;
+
+	rcu_read_lock();
+	obj = hmgrtable_get_object_by_type_rcu(&process->handle_table, t,
+					       handle);
+	if (obj == NULL)
+		goto cleanup;
+
+	switch (t) {
+	case HMGRENTRY_TYPE_DXGDEVICE:
+		device = obj;
+		break;
+	case HMGRENTRY_TYPE_DXGCONTEXT:
+		device_handle = ((struct dxgcontext *)obj)->device_handle;
+		break;
+	case HMGRENTRY_TYPE_DXGPAGINGQUEUE:
+		device_handle = ((struct dxgpagingqueue *)obj)->device_handle;
+		break;
+	case HMGRENTRY_TYPE_DXGHWQUEUE:
+		device_handle = ((struct dxghwqueue *)obj)->device_handle;
+		break;
+	default:
+		goto cleanup;
+	}
+	if (device == NULL)
+		device = hmgrtable_get_object_by_type_rcu(&process->handle_table,
+						HMGRENTRY_TYPE_DXGDEVICE,
+						device_handle);
+	if (device)
+		if (kref_get_unless_zero(&device->device_kref) == 0)
+			device = NULL;
+
+cleanup:
+	rcu_read_unlock();
+	return device;
+}
+
 struct dxgdevice *dxgprocess_device_by_object_handle(struct dxgprocess *process,
 						     enum hmgrentry_type t,
 						     struct d3dkmthandle handle)
@@ -265,6 +323,10 @@ struct dxgdevice *dxgprocess_device_by_object_handle(struct dxgprocess *process,
 	struct dxgdevice *device = NULL;
 	void *obj;
 
+	device = dxgprocess_device_by_object_handle_rcu(process, t, handle);
+	if (device)
+		return device;
+
 	hmgrtable_lock(&process->handle_table, DXGLOCK_SHARED);
 	obj = hmgrtable_get_object_by_type(&process->handle_table, t, handle);
 	if (obj) {
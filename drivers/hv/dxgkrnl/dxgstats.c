@@ -0,0 +1,268 @@
+// SPDX-License-Identifier: GPL-2.0
+
+/*
+ * Copyright (c) 2019, Microsoft Corporation.
+ *
+ * Dxgkrnl Graphics Driver
+ * Latency statistics and trace points
+ *
+ */
+
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/mm.h>
+#include <linux/ktime.h>
+
+#include "dxgkrnl.h"
+#include "dxgvmbus.h"
+
+#define CREATE_TRACE_POINTS
+#include "dxgkrnl_trace.h"
+
+#undef pr_fmt
+#define pr_fmt(fmt)	"dxgk: " fmt
+
+/*
+ * Latencies are collected in log2 buckets of nanoseconds. Bucket N counts
+ * latencies in [2^(N-1), 2^N) ns. The last bucket counts everything above.
+ */
+#define DXGSTATS_BUCKETS	32
+
+/*
+ * Per adapter VM bus commands are followed by the global VM bus commands in
+ * the VM bus histogram table. The last entry counts commands of any other
+ * type.
+ */
+#define DXGSTATS_VMBUS_GLOBAL_COMMANDS	(DXGK_VMBCOMMAND_INVALID_VM_TO_HOST - \
+					 DXGK_VMBCOMMAND_VM_TO_HOST_FIRST)
+#define DXGSTATS_VMBUS_OTHER		(DXGK_VMBCOMMAND_INVALID + \
+					 DXGSTATS_VMBUS_GLOBAL_COMMANDS)
+#define DXGSTATS_VMBUS_COMMANDS		(DXGSTATS_VMBUS_OTHER + 1)
+
+struct dxglatencyhist {
+	u64	count[DXGSTATS_BUCKETS];
+};
+
+struct dxgstats {
+	struct dxglatencyhist	ioctl[LX_IO_MAX + 1];
+	struct dxglatencyhist	vmbus[DXGSTATS_VMBUS_COMMANDS];
+	struct dxglatencyhist	lock[DXGSTATS_LOCK_COUNT];
+};
+
+/*
+ * One struct dxgstats per possible CPU, indexed by the CPU number. At about
+ * 40KB it is above what alloc_percpu() can provide, so every CPU gets its
+ * own block allocated on its node instead. All users run in process
+ * context, so disabling preemption is enough to update the local block.
+ */
+static struct dxgstats **dxgstats;
+
+/* Collecting is disabled by default. It is enabled through debugfs. */
+static bool dxgstats_enabled;
+
+static const char * const lock_names[DXGSTATS_LOCK_COUNT] = {
+	[DXGSTATS_LOCK_ADAPTER]		= "adapter_core_lock",
+	[DXGSTATS_LOCK_ALLOC_LIST]	= "alloc_list_lock",
+};
+
+static const char * const residency_names[DXGRES_COUNT] = {
+	[DXGRES_MAKE_RESIDENT]		= "make_resident",
+	[DXGRES_MAKE_RESIDENT_ALLOCS]	= "make_resident_allocs",
+	[DXGRES_MAKE_RESIDENT_PENDING]	= "make_resident_pending",
+	[DXGRES_EVICT]			= "evict",
+	[DXGRES_EVICT_ALLOCS]		= "evict_allocs",
+	[DXGRES_BYTES_TO_TRIM]		= "bytes_to_trim",
+	[DXGRES_OFFER]			= "offer",
+	[DXGRES_OFFER_ALLOCS]		= "offer_allocs",
+	[DXGRES_RECLAIM]		= "reclaim",
+	[DXGRES_RECLAIM_ALLOCS]		= "reclaim_allocs",
+	[DXGRES_SET_PRIORITY]		= "set_priority",
+};
+
+/*
+ * Returns the start timestamp of a measured interval or 0 when statistics
+ * are not collected.
+ */
+u64 dxgstats_start(void)
+{
+	if (!READ_ONCE(dxgstats_enabled) || dxgstats == NULL)
+		return 0;
+	return ktime_get_ns();
+}
+
+static int dxgstats_bucket(u64 start)
+{
+	return min_t(int, fls64(ktime_get_ns() - start), DXGSTATS_BUCKETS - 1);
+}
+
+void dxgstats_ioctl_done(unsigned int code, u64 start)
+{
+	if (start == 0 || code > LX_IO_MAX)
+		return;
+	dxgstats[get_cpu()]->ioctl[code].count[dxgstats_bucket(start)]++;
+	put_cpu();
+}
+
+/*
+ * Commands are classified by their type, because with asynchronous messages
+ * enabled per adapter commands are sent on the global channel as well.
+ */
+void dxgstats_vmbus_done(u32 command_type, u64 start)
+{
+	u32 index;
+
+	if (start == 0)
+		return;
+	if (command_type < DXGK_VMBCOMMAND_INVALID)
+		index = command_type;
+	else if (command_type >= DXGK_VMBCOMMAND_VM_TO_HOST_FIRST &&
+		 command_type < DXGK_VMBCOMMAND_INVALID_VM_TO_HOST)
+		index = DXGK_VMBCOMMAND_INVALID + command_type -
+			DXGK_VMBCOMMAND_VM_TO_HOST_FIRST;
+	else
+		index = DXGSTATS_VMBUS_OTHER;
+	dxgstats[get_cpu()]->vmbus[index].count[dxgstats_bucket(start)]++;
+	put_cpu();
+}
+
+void dxgstats_lock_done(enum dxgstats_lock lock, u64 start)
+{
+	if (start == 0)
+		return;
+	dxgstats[get_cpu()]->lock[lock].count[dxgstats_bucket(start)]++;
+	put_cpu();
+}
+
+/* Prints non empty buckets of a histogram as "<name> <ns> <count>" */
+static void dxgstats_show_hist(struct seq_file *m, const char *name,
+			       size_t offset)
+{
+	struct dxglatencyhist *hist;
+	u64 count;
+	int cpu;
+	int i;
+
+	for (i = 0; i < DXGSTATS_BUCKETS; i++) {
+		count = 0;
+		for_each_possible_cpu(cpu) {
+			hist = (void *)dxgstats[cpu] + offset;
+			count += hist->count[i];
+		}
+		if (count)
+			seq_printf(m, "%s %llu %llu\n", name,
+				   i ? 1ULL << (i - 1) : 0ULL, count);
+	}
+}
+
+static int ioctl_latency_show(struct seq_file *m, void *unused)
+{
+	char name[8];
+	int i;
+
+	for (i = 0; i <= LX_IO_MAX; i++) {
+		snprintf(name, sizeof(name), "0x%02x", i);
+		dxgstats_show_hist(m, name,
+				   offsetof(struct dxgstats, ioctl[i]));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(ioctl_latency);
+
+static int vmbus_latency_show(struct seq_file *m, void *unused)
+{
+	char name[8];
+	int i;
+
+	for (i = 0; i < DXGSTATS_VMBUS_COMMANDS; i++) {
+		if (i < DXGK_VMBCOMMAND_INVALID)
+			snprintf(name, sizeof(name), "%d", i);
+		else if (i == DXGSTATS_VMBUS_OTHER)
+			snprintf(name, sizeof(name), "other");
+		else
+			snprintf(name, sizeof(name), "%d",
+				 DXGK_VMBCOMMAND_VM_TO_HOST_FIRST + i -
+				 DXGK_VMBCOMMAND_INVALID);
+		dxgstats_show_hist(m, name,
+				   offsetof(struct dxgstats, vmbus[i]));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(vmbus_latency);
+
+static int lock_latency_show(struct seq_file *m, void *unused)
+{
+	int i;
+
+	for (i = 0; i < DXGSTATS_LOCK_COUNT; i++)
+		dxgstats_show_hist(m, lock_names[i],
+				   offsetof(struct dxgstats, lock[i]));
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(lock_latency);
+
+/* Prints non zero counters of every process as "<tgid> <name> <value>" */
+static int residency_show(struct seq_file *m, void *unused)
+{
+	struct dxgprocess *process;
+	u64 value;
+	int i;
+
+	mutex_lock(&dxgglobal->plistmutex);
+	list_for_each_entry(process, &dxgglobal->plisthead, plistentry) {
+		for (i = 0; i < DXGRES_COUNT; i++) {
+			value = atomic64_read(&process->residency_stats[i]);
+			if (value)
+				seq_printf(m, "%d %s %llu\n", process->tgid,
+					   residency_names[i], value);
+		}
+	}
+	mutex_unlock(&dxgglobal->plistmutex);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(residency);
+
+static void dxgstats_free(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		kvfree(dxgstats[cpu]);
+	kfree(dxgstats);
+	dxgstats = NULL;
+}
+
+int dxgstats_init(struct dentry *dir)
+{
+	int cpu;
+
+	dxgstats = kcalloc(nr_cpu_ids, sizeof(*dxgstats), GFP_KERNEL);
+	if (dxgstats == NULL)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		dxgstats[cpu] = kvzalloc_node(sizeof(struct dxgstats),
+					      GFP_KERNEL, cpu_to_node(cpu));
+		if (dxgstats[cpu] == NULL) {
+			dxgstats_free();
+			return -ENOMEM;
+		}
+	}
+
+	debugfs_create_bool("latency_enabled", 0644, dir, &dxgstats_enabled);
+	debugfs_create_file("ioctl_latency", 0444, dir, NULL,
+			    &ioctl_latency_fops);
+	debugfs_create_file("vmbus_latency", 0444, dir, NULL,
+			    &vmbus_latency_fops);
+	debugfs_create_file("lock_latency", 0444, dir, NULL,
+			    &lock_latency_fops);
+	debugfs_create_file("residency", 0444, dir, NULL, &residency_fops);
+	return 0;
+}
+
+void dxgstats_destroy(void)
+{
+	WRITE_ONCE(dxgstats_enabled, false);
+	if (dxgstats)
+		dxgstats_free();
+}
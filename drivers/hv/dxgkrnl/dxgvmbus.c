@@ -19,14 +19,29 @@
 #include <linux/mman.h>
 #include <linux/delay.h>
 #include <linux/pagemap.h>
+#include <linux/hash.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/moduleparam.h>
 #include "dxgkrnl.h"
 #include "dxgvmbus.h"
+#include "dxgkrnl_trace.h"
 
 #undef pr_fmt
 #define pr_fmt(fmt)	"dxgk: " fmt
 
 #define RING_BUFSIZE (256 * 1024)
 
+/*
+ * The host does not advertise that it accepts UPDATEGPUVIRTUALADDRESS as an
+ * asynchronous message, nor one with operations merged from several calls.
+ * Deferring the updates is therefore opt-in.
+ */
+static bool defer_gpu_va_updates;
+module_param(defer_gpu_va_updates, bool, 0644);
+MODULE_PARM_DESC(defer_gpu_va_updates,
+		 "Merge non-waiting GPU VA updates into asynchronous messages");
+
 /*
  * The structure is used to track VM bus packets, waiting for completion.
  */
@@ -49,6 +64,34 @@ struct dxgvmb_ext_header {
 
 #define VMBUSMESSAGEONSTACK	64
 
+/*
+ * Messages, which do not fit on the stack, are allocated from slab caches
+ * with power of 2 sizes from VMBUSMESSAGECACHEMIN to VMBUSMESSAGECACHEMAX
+ * bytes. This covers most of dxgkvmb_command_* messages.
+ */
+#define VMBUSMESSAGECACHEMIN	128
+#define VMBUSMESSAGECACHEMAX	4096
+#define VMBUSMESSAGECACHES	6
+
+/*
+ * Messages bigger than VMBUSMESSAGECACHEMAX are built in the process message
+ * buffer to avoid vzalloc() on every call with large private driver data.
+ */
+#define VMBUSMESSAGEPROCESSBUFSIZE	(DXG_MAX_VM_BUS_PACKET_SIZE + \
+					 sizeof(struct dxgvmb_ext_header))
+
+static struct kmem_cache *msg_cache[VMBUSMESSAGECACHES];
+
+/* Message allocation statistics, exposed in debugfs */
+struct dxgvmbusmsg_stats {
+	u64	on_stack;
+	u64	cache[VMBUSMESSAGECACHES];
+	u64	process_buffer;
+	u64	vzalloc;
+};
+
+static DEFINE_PER_CPU(struct dxgvmbusmsg_stats, msg_stats);
+
 struct dxgvmbusmsg {
 /* Points to the allocated buffer */
 	struct dxgvmb_ext_header	*hdr;
@@ -77,20 +120,124 @@ struct dxgvmbusmsgres {
 	void				*res;
 };
 
+/*
+ * Selects the channel to send a process message on. When the host offered
+ * sub-channels, processes are spread across the primary channel and the
+ * sub-channels. All messages of a process go to the same channel, so the
+ * order of asynchronous messages is preserved.
+ * The first process message seals the set of sub-channels, so the count
+ * used for the mapping is final from then on.
+ */
+static struct dxgvmbuschannel *
+dxgvmbuschannel_select(struct dxgvmbuschannel *ch, struct dxgprocess *process)
+{
+	int count;
+	u32 index;
+
+	if (process == NULL)
+		return ch;
+	if (unlikely(!smp_load_acquire(&ch->sub_channels_sealed))) {
+		mutex_lock(&ch->sub_channel_mutex);
+		smp_store_release(&ch->sub_channels_sealed, true);
+		mutex_unlock(&ch->sub_channel_mutex);
+	}
+	count = smp_load_acquire(&ch->num_sub_channels);
+	if (count == 0)
+		return ch;
+	index = hash_ptr(process, 32) % (count + 1);
+	if (index == 0)
+		return ch;
+	return ch->sub_channels[index - 1];
+}
+
+/* Returns the message cache index for the size or -1 */
+static int msg_cache_index(u32 size)
+{
+	if (size > VMBUSMESSAGECACHEMAX)
+		return -1;
+	if (size <= VMBUSMESSAGECACHEMIN)
+		return 0;
+	return order_base_2(size) - order_base_2(VMBUSMESSAGECACHEMIN);
+}
+
+/*
+ * Returns the process message buffer when it is not used by another message.
+ * The caller must zero the used part of the buffer.
+ */
+static void *get_process_msg_buffer(struct dxgprocess *process, u32 size)
+{
+	if (process == NULL || size > VMBUSMESSAGEPROCESSBUFSIZE)
+		return NULL;
+	if (!mutex_trylock(&process->msg_buffer_mutex))
+		return NULL;
+	if (process->msg_buffer == NULL) {
+		process->msg_buffer = vmalloc(VMBUSMESSAGEPROCESSBUFSIZE);
+		if (process->msg_buffer == NULL) {
+			mutex_unlock(&process->msg_buffer_mutex);
+			return NULL;
+		}
+	}
+	return process->msg_buffer;
+}
+
+/*
+ * Allocates a zeroed message buffer. The buffer must be freed by
+ * free_message_buffer() with the same process and size.
+ */
+static void *alloc_message_buffer(struct dxgprocess *process, u32 size)
+{
+	int index = msg_cache_index(size);
+	void *buf;
+
+	if (index >= 0) {
+		buf = kmem_cache_zalloc(msg_cache[index], GFP_KERNEL);
+		if (buf)
+			this_cpu_inc(msg_stats.cache[index]);
+		return buf;
+	}
+
+	buf = get_process_msg_buffer(process, size);
+	if (buf) {
+		this_cpu_inc(msg_stats.process_buffer);
+		memset(buf, 0, size);
+		return buf;
+	}
+
+	this_cpu_inc(msg_stats.vzalloc);
+	return vzalloc(size);
+}
+
+static void free_message_buffer(struct dxgprocess *process, void *buf,
+				u32 size)
+{
+	int index = msg_cache_index(size);
+
+	if (index >= 0)
+		kmem_cache_free(msg_cache[index], buf);
+	else if (process && buf == process->msg_buffer)
+		mutex_unlock(&process->msg_buffer_mutex);
+	else
+		vfree(buf);
+}
+
 static int init_message(struct dxgvmbusmsg *msg, struct dxgadapter *adapter,
 			struct dxgprocess *process, u32 size)
 {
 	bool use_ext_header = dxgglobal->vmbus_ver >=
 			      DXGK_VMBUS_INTERFACE_VERSION;
 
+	/* Send the deferred message of the process first to keep the order */
+	if (process)
+		dxgvmb_flush_deferred_msg(process);
 	if (use_ext_header)
 		size += sizeof(struct dxgvmb_ext_header);
 	msg->size = size;
 	if (size <= VMBUSMESSAGEONSTACK) {
 		msg->hdr = (void *)msg->msg_on_stack;
 		memset(msg->hdr, 0, size);
+		this_cpu_inc(msg_stats.on_stack);
 	} else {
-		msg->hdr = vzalloc(size);
+		msg->hdr = alloc_message_buffer(process, size);
 		if (msg->hdr == NULL)
 			return -ENOMEM;
 	}
@@ -103,9 +250,11 @@ static int init_message(struct dxgvmbusmsg *msg, struct dxgadapter *adapter,
 		msg->msg = (char *)msg->hdr;
 	}
 	if (adapter && !dxgglobal->async_msg_enabled)
-		msg->channel = &adapter->channel;
+		msg->channel = dxgvmbuschannel_select(&adapter->channel,
+						      process);
 	else
-		msg->channel = &dxgglobal->channel;
+		msg->channel = dxgvmbuschannel_select(&dxgglobal->channel,
+						      process);
 	return 0;
 }
 
@@ -118,12 +267,14 @@ static int init_message_res(struct dxgvmbusmsgres *msg,
 	bool use_ext_header = dxgglobal->vmbus_ver >=
 			      DXGK_VMBUS_INTERFACE_VERSION;
 
+	if (process)
+		dxgvmb_flush_deferred_msg(process);
 	if (use_ext_header)
 		size += sizeof(struct dxgvmb_ext_header);
 	msg->size = size;
 	msg->res_size += (result_size + 7) & ~7;
 	size += msg->res_size;
-	msg->hdr = vzalloc(size);
+	msg->hdr = alloc_message_buffer(process, size);
 	if (msg->hdr == NULL) {
 		pr_err("Failed to allocate VM bus message: %d", size);
 		return -ENOMEM;
@@ -137,16 +288,87 @@ static int init_message_res(struct dxgvmbusmsgres *msg,
 	}
 	msg->res = (char *)msg->hdr + msg->size;
 	if (dxgglobal->async_msg_enabled)
-		msg->channel = &dxgglobal->channel;
+		msg->channel = dxgvmbuschannel_select(&dxgglobal->channel,
+						      process);
 	else
-		msg->channel = &adapter->channel;
+		msg->channel = dxgvmbuschannel_select(&adapter->channel,
+						      process);
 	return 0;
 }
 
 static void free_message(struct dxgvmbusmsg *msg, struct dxgprocess *process)
 {
 	if (msg->hdr && (char *)msg->hdr != msg->msg_on_stack)
-		vfree(msg->hdr);
+		free_message_buffer(process, msg->hdr, msg->size);
+}
+
+static void free_message_res(struct dxgvmbusmsgres *msg,
+			     struct dxgprocess *process)
+{
+	if (msg->hdr)
+		free_message_buffer(process, msg->hdr,
+				    msg->size + msg->res_size);
+}
+
+int dxgvmb_init_msg_caches(void)
+{
+	char name[32];
+	int i;
+
+	for (i = 0; i < VMBUSMESSAGECACHES; i++) {
+		snprintf(name, sizeof(name), "dxgk_msg_%d",
+			 VMBUSMESSAGECACHEMIN << i);
+		msg_cache[i] = kmem_cache_create(name,
+						 VMBUSMESSAGECACHEMIN << i,
+						 0, 0, NULL);
+		if (msg_cache[i] == NULL) {
+			pr_err("failed to create message cache %s", name);
+			dxgvmb_destroy_msg_caches();
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+void dxgvmb_destroy_msg_caches(void)
+{
+	int i;
+
+	for (i = 0; i < VMBUSMESSAGECACHES; i++) {
+		kmem_cache_destroy(msg_cache[i]);
+		msg_cache[i] = NULL;
+	}
+}
+
+static int msg_stats_show(struct seq_file *m, void *unused)
+{
+	struct dxgvmbusmsg_stats total = { };
+	struct dxgvmbusmsg_stats *stats;
+	int cpu;
+	int i;
+
+	for_each_possible_cpu(cpu) {
+		stats = per_cpu_ptr(&msg_stats, cpu);
+		total.on_stack += stats->on_stack;
+		for (i = 0; i < VMBUSMESSAGECACHES; i++)
+			total.cache[i] += stats->cache[i];
+		total.process_buffer += stats->process_buffer;
+		total.vzalloc += stats->vzalloc;
+	}
+
+	seq_printf(m, "on_stack: %llu\n", total.on_stack);
+	for (i = 0; i < VMBUSMESSAGECACHES; i++)
+		seq_printf(m, "cache_%d: %llu\n", VMBUSMESSAGECACHEMIN << i,
+			   total.cache[i]);
+	seq_printf(m, "process_buffer: %llu\n", total.process_buffer);
+	seq_printf(m, "vzalloc: %llu\n", total.vzalloc);
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(msg_stats);
+
+void dxgvmb_debugfs_init(struct dentry *dir)
+{
+	debugfs_create_file("msg_stats", 0444, dir, NULL, &msg_stats_fops);
 }
 
 /*
@@ -223,6 +445,57 @@ int ntstatus2int(struct ntstatus status)
 	}
 }
 
+/*
+ * Called by the VM bus driver when the host offers a sub-channel for the
+ * primary channel.
+ */
+static void dxgvmbuschannel_sc_create(struct vmbus_channel *new_sc)
+{
+	struct vmbus_channel *primary = new_sc->primary_channel;
+	struct dxgvmbuschannel *ch = primary->channel_callback_context;
+	struct dxgvmbuschannel *sc = NULL;
+	int ret;
+
+	mutex_lock(&ch->sub_channel_mutex);
+
+	if (ch->sub_channels_sealed ||
+	    ch->num_sub_channels >= DXG_MAX_SUB_CHANNELS) {
+		pr_debug("ignoring sub-channel %d",
+			 new_sc->offermsg.offer.sub_channel_index);
+		goto cleanup;
+	}
+
+	sc = vzalloc(sizeof(*sc));
+	if (sc == NULL)
+		goto cleanup;
+
+	sc->hdev = ch->hdev;
+	sc->adapter = ch->adapter;
+	spin_lock_init(&sc->packet_list_mutex);
+	INIT_LIST_HEAD(&sc->packet_list_head);
+	atomic64_set(&sc->packet_request_id, 0);
+	sc->packet_cache = ch->packet_cache;
+
+	new_sc->max_pkt_size = DXG_MAX_VM_BUS_PACKET_SIZE;
+	ret = vmbus_open(new_sc, RING_BUFSIZE, RING_BUFSIZE,
+			 NULL, 0, dxgvmbuschannel_receive, sc);
+	if (ret) {
+		pr_err("vmbus_open sub-channel failed: %d", ret);
+		vfree(sc);
+		goto cleanup;
+	}
+
+	sc->channel = new_sc;
+	ch->sub_channels[ch->num_sub_channels] = sc;
+	/* Publish the initialized sub-channel to the message senders */
+	smp_store_release(&ch->num_sub_channels, ch->num_sub_channels + 1);
+	pr_debug("sub-channel %d opened on cpu %d",
+		 new_sc->offermsg.offer.sub_channel_index, new_sc->target_cpu);
+
+cleanup:
+	mutex_unlock(&ch->sub_channel_mutex);
+}
+
 int dxgvmbuschannel_init(struct dxgvmbuschannel *ch, struct hv_device *hdev)
 {
 	int ret;
@@ -231,6 +504,9 @@ int dxgvmbuschannel_init(struct dxgvmbuschannel *ch, struct hv_device *hdev)
 	spin_lock_init(&ch->packet_list_mutex);
 	INIT_LIST_HEAD(&ch->packet_list_head);
 	atomic64_set(&ch->packet_request_id, 0);
+	mutex_init(&ch->sub_channel_mutex);
+	ch->num_sub_channels = 0;
+	ch->sub_channels_sealed = false;
 
 	ch->packet_cache = kmem_cache_create("DXGK packet cache",
 					     sizeof(struct dxgvmbuspacket), 0,
@@ -250,6 +526,7 @@ int dxgvmbuschannel_init(struct dxgvmbuschannel *ch, struct hv_device *hdev)
 	}
 
 	ch->channel = hdev->channel;
+	vmbus_set_sc_create_callback(ch->channel, dxgvmbuschannel_sc_create);
 
 cleanup:
 
@@ -258,13 +535,30 @@ int dxgvmbuschannel_init(struct dxgvmbuschannel *ch, struct hv_device *hdev)
 
 void dxgvmbuschannel_destroy(struct dxgvmbuschannel *ch)
 {
+	struct dxgvmbuschannel *sc[DXG_MAX_SUB_CHANNELS];
+	int count;
+	int i;
+
+	if (ch->channel)
+		vmbus_set_sc_create_callback(ch->channel, NULL);
+
+	mutex_lock(&ch->sub_channel_mutex);
+	count = ch->num_sub_channels;
+	memcpy(sc, ch->sub_channels, sizeof(sc[0]) * count);
+	WRITE_ONCE(ch->num_sub_channels, 0);
+	mutex_unlock(&ch->sub_channel_mutex);
+
 	kmem_cache_destroy(ch->packet_cache);
 	ch->packet_cache = NULL;
 
+	/* vmbus_close() closes the sub-channels of the primary channel */
 	if (ch->channel) {
 		vmbus_close(ch->channel);
 		ch->channel = NULL;
 	}
+
+	for (i = 0; i < count; i++)
+		vfree(sc[i]);
 }
 
 static void command_vm_to_host_init1(struct dxgkvmb_command_vm_to_host *command,
@@ -402,6 +696,22 @@ void dxgvmbuschannel_receive(void *ctx)
 	}
 }
 
+/*
+ * Returns the command type of a message, which might start with the
+ * extended header.
+ */
+static u32 get_command_type(void *command)
+{
+	struct dxgvmb_ext_header *hdr = command;
+	struct dxgkvmb_command_vgpu_to_host *cmd;
+
+	if (dxgglobal->vmbus_ver >= DXGK_VMBUS_INTERFACE_VERSION)
+		cmd = (void *)((char *)command + hdr->command_offset);
+	else
+		cmd = command;
+	return cmd->command_type;
+}
+
 int dxgvmb_send_sync_msg(struct dxgvmbuschannel *channel,
 			 void *command,
 			 u32 cmd_size,
@@ -412,6 +722,9 @@ int dxgvmb_send_sync_msg(struct dxgvmbuschannel *channel,
 	struct dxgvmbuspacket *packet = NULL;
 	struct dxgkvmb_command_vm_to_host *cmd1;
 	struct dxgkvmb_command_vgpu_to_host *cmd2;
+	u32 command_type;
+	bool global;
+	u64 start;
 
 	if (cmd_size > DXG_MAX_VM_BUS_PACKET_SIZE ||
 	    result_size > DXG_MAX_VM_BUS_PACKET_SIZE) {
@@ -425,6 +738,11 @@ int dxgvmb_send_sync_msg(struct dxgvmbuschannel *channel,
 		return -ENOMEM;
 	}
 
+	command_type = get_command_type(command);
+	global = command_type >= DXGK_VMBCOMMAND_VM_TO_HOST_FIRST;
+	trace_dxgvmb_send_sync_msg(command_type, global, cmd_size);
+	start = dxgstats_start();
+
 	if (channel->adapter == NULL) {
 		cmd1 = command;
 		pr_debug("send_sync_msg global: %d %p %d %d",
@@ -472,6 +790,8 @@ int dxgvmb_send_sync_msg(struct dxgvmbuschannel *channel,
 
 cleanup:
 
+	dxgstats_vmbus_done(command_type, start);
+	trace_dxgvmb_sync_msg_done(command_type, global, ret);
 	kmem_cache_free(channel->packet_cache, packet);
 	if (ret < 0)
 		pr_debug("%s failed: %x", __func__, ret);
@@ -1997,7 +2317,7 @@ int dxgvmb_send_query_alloc_residency(struct dxgprocess *process,
 	}
 
 cleanup:
-	free_message((struct dxgvmbusmsg *)&msg, process);
+	free_message_res(&msg, process);
 	if (ret)
 		pr_debug("err: %s %d", __func__, ret);
 	return ret;
@@ -2224,7 +2544,7 @@ int dxgvmb_send_open_resource(struct dxgprocess *process,
 		alloc_handles[i] = handles[i];
 
 cleanup:
-	free_message((struct dxgvmbusmsg *)&msg, process);
+	free_message_res(&msg, process);
 	if (ret)
 		pr_debug("err: %s %d", __func__, ret);
 	return ret;
@@ -2309,7 +2629,7 @@ int dxgvmb_send_get_stdalloc_data(struct dxgdevice *device,
 
 cleanup:
 
-	free_message((struct dxgvmbusmsg *)&msg, device->process);
+	free_message_res(&msg, device->process);
 	if (ret)
 		pr_debug("err: %s %d", __func__, ret);
 	return ret;
@@ -2561,6 +2881,201 @@ int dxgvmb_send_free_gpu_va(struct dxgprocess *process,
 	return ret;
 }
 
+static void *deferred_msg_command(struct dxgdeferredmsg *q)
+{
+	if (dxgglobal->vmbus_ver >= DXGK_VMBUS_INTERFACE_VERSION)
+		return q->buffer + sizeof(struct dxgvmb_ext_header);
+	return q->buffer;
+}
+
+static void __dxgvmb_flush_deferred_msg(struct dxgprocess *process)
+{
+	struct dxgdeferredmsg *q = &process->deferred_msg;
+	struct dxgvmbuschannel *channel;
+	int ret;
+
+	if (q->count == 0)
+		return;
+
+	channel = dxgvmbuschannel_select(&dxgglobal->channel, process);
+	ret = dxgvmb_send_async_msg(channel, q->buffer, q->size);
+	if (ret < 0)
+		pr_err("failed to send deferred message %d (%d items): %d",
+		       q->command_type, q->count, ret);
+	WRITE_ONCE(q->count, 0);
+}
+
+void dxgvmb_flush_deferred_msg(struct dxgprocess *process)
+{
+	struct dxgdeferredmsg *q = &process->deferred_msg;
+
+	if (READ_ONCE(q->count) == 0)
+		return;
+
+	mutex_lock(&q->lock);
+	__dxgvmb_flush_deferred_msg(process);
+	mutex_unlock(&q->lock);
+}
+
+static void dxgvmb_flush_deferred_msg_work(struct work_struct *work)
+{
+	struct dxgdeferredmsg *q = container_of(to_delayed_work(work),
+						struct dxgdeferredmsg,
+						flush_work);
+
+	dxgvmb_flush_deferred_msg(container_of(q, struct dxgprocess,
+					       deferred_msg));
+}
+
+void dxgvmb_deferred_msg_init(struct dxgprocess *process)
+{
+	mutex_init(&process->deferred_msg.lock);
+	INIT_DELAYED_WORK(&process->deferred_msg.flush_work,
+			  dxgvmb_flush_deferred_msg_work);
+}
+
+void dxgvmb_deferred_msg_destroy(struct dxgprocess *process)
+{
+	vfree(process->deferred_msg.buffer);
+	process->deferred_msg.buffer = NULL;
+}
+
+/*
+ * Returns the command of the pending message, which new items of the given
+ * type and size can be appended to. The pending message is sent first when
+ * the items do not fit in or the message has a different type or adapter.
+ * The caller checks the command specific fields and holds the queue lock.
+ * Returns NULL when the message buffer can not be allocated.
+ */
+static void *deferred_msg_get(struct dxgprocess *process,
+			      struct dxgadapter *adapter,
+			      enum dxgkvmb_commandtype type,
+			      u32 items_size)
+{
+	struct dxgdeferredmsg *q = &process->deferred_msg;
+
+	if (q->buffer == NULL) {
+		q->buffer = vmalloc(DXG_MAX_VM_BUS_PACKET_SIZE);
+		if (q->buffer == NULL)
+			return NULL;
+	}
+
+	if (q->count &&
+	    (q->command_type != type ||
+	     q->size + items_size > DXG_MAX_VM_BUS_PACKET_SIZE ||
+	     memcmp(&q->vgpu_luid, &adapter->host_vgpu_luid,
+		    sizeof(q->vgpu_luid))))
+		__dxgvmb_flush_deferred_msg(process);
+
+	return deferred_msg_command(q);
+}
+
+/* Starts a new pending message with the command header of cmd_size bytes */
+static void deferred_msg_begin(struct dxgprocess *process,
+			       struct dxgadapter *adapter,
+			       enum dxgkvmb_commandtype type,
+			       u32 cmd_size)
+{
+	struct dxgdeferredmsg *q = &process->deferred_msg;
+	struct dxgkvmb_command_vgpu_to_host *command;
+	struct dxgvmb_ext_header *ext;
+
+	q->size = cmd_size;
+	if (dxgglobal->vmbus_ver >= DXGK_VMBUS_INTERFACE_VERSION) {
+		ext = q->buffer;
+		memset(ext, 0, sizeof(*ext));
+		ext->command_offset = sizeof(*ext);
+		ext->vgpu_luid = adapter->host_vgpu_luid;
+		q->size += sizeof(*ext);
+	}
+	command = deferred_msg_command(q);
+	memset(command, 0, cmd_size);
+	command_vgpu_to_host_init2(command, type, process->host_handle);
+	command->async_msg = 1;
+	q->command_type = type;
+	q->vgpu_luid = adapter->host_vgpu_luid;
+}
+
+/*
+ * Accounts the appended items. The message is sent when no other item fits
+ * in, otherwise the flush work is scheduled.
+ */
+static void deferred_msg_commit(struct dxgprocess *process, u32 count,
+				u32 items_size, u32 item_size)
+{
+	struct dxgdeferredmsg *q = &process->deferred_msg;
+
+	q->size += items_size;
+	WRITE_ONCE(q->count, q->count + count);
+
+	if (q->size + item_size > DXG_MAX_VM_BUS_PACKET_SIZE)
+		__dxgvmb_flush_deferred_msg(process);
+	else
+		schedule_delayed_work(&q->flush_work, DXG_DEFERRED_MSG_DELAY);
+}
+
+/*
+ * Appends the operations to the pending update GPU VA message of the process.
+ * The operations can be merged when everything except the operations is the
+ * same and the fence value does not go backwards. The host signals the sync
+ * object once, with the last fence value, which completes all merged
+ * updates.
+ */
+static int dxgvmb_queue_update_gpu_va(struct dxgprocess *process,
+				      struct dxgadapter *adapter,
+				      struct d3dkmt_updategpuvirtualaddress
+				      *args, u32 op_size)
+{
+	struct dxgdeferredmsg *q = &process->deferred_msg;
+	struct dxgkvmb_command_updategpuvirtualaddress *command;
+	int ret = 0;
+
+	mutex_lock(&q->lock);
+
+	command = deferred_msg_get(process, adapter,
+				   DXGK_VMBCOMMAND_UPDATEGPUVIRTUALADDRESS,
+				   op_size);
+	if (command == NULL) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+	if (q->count &&
+	    (command->device.v != args->device.v ||
+	     command->context.v != args->context.v ||
+	     command->fence_object.v != args->fence_object.v ||
+	     command->flags != args->flags.value ||
+	     command->fence_value > args->fence_value))
+		__dxgvmb_flush_deferred_msg(process);
+
+	if (q->count == 0) {
+		deferred_msg_begin(process, adapter,
+				   DXGK_VMBCOMMAND_UPDATEGPUVIRTUALADDRESS,
+				   sizeof(*command) -
+				   sizeof(command->operations[0]));
+		command->device = args->device;
+		command->context = args->context;
+		command->fence_object = args->fence_object;
+		command->flags = args->flags.value;
+	}
+
+	ret = copy_from_user(&command->operations[command->num_operations],
+			     args->operations, op_size);
+	if (ret) {
+		pr_err("%s failed to copy operations", __func__);
+		ret = -EINVAL;
+		goto cleanup;
+	}
+
+	command->num_operations += args->num_operations;
+	command->fence_value = args->fence_value;
+	deferred_msg_commit(process, args->num_operations, op_size,
+			    sizeof(command->operations[0]));
+
+cleanup:
+	mutex_unlock(&q->lock);
+	return ret;
+}
+
 int dxgvmb_send_update_gpu_va(struct dxgprocess *process,
 			      struct dxgadapter *adapter,
 			      struct d3dkmt_updategpuvirtualaddress *args)
@@ -2583,6 +3098,21 @@ int dxgvmb_send_update_gpu_va(struct dxgprocess *process,
 
 	op_size = args->num_operations *
 	    sizeof(struct d3dddi_updategpuvirtualaddress_operation);
+
+	/*
+	 * The caller does not wait for the result, which is reported by
+	 * signalling the sync object, so the update can be deferred.
+	 */
+	if (READ_ONCE(defer_gpu_va_updates) &&
+	    dxgglobal->async_msg_enabled && args->flags.do_not_wait &&
+	    args->fence_object.v &&
+	    op_size <= DXG_MAX_VM_BUS_PACKET_SIZE -
+		       sizeof(struct dxgvmb_ext_header) - sizeof(*command)) {
+		ret = dxgvmb_queue_update_gpu_va(process, adapter, args,
+						 op_size);
+		goto cleanup;
+	}
+
 	cmd_size = sizeof(struct dxgkvmb_command_updategpuvirtualaddress) +
 	    op_size - sizeof(args->operations[0]);
 
@@ -3230,7 +3760,7 @@ int dxgvmb_send_get_allocation_priority(struct dxgprocess *process,
 	}
 
 cleanup:
-	free_message((struct dxgvmbusmsg *)&msg, process);
+	free_message_res(&msg, process);
 	if (ret)
 		pr_debug("err: %s %d", __func__, ret);
 	return ret;
@@ -3415,7 +3945,7 @@ int dxgvmb_send_reclaim_allocations(struct dxgprocess *process,
 	}
 
 cleanup:
-	free_message((struct dxgvmbusmsg *)&msg, process);
+	free_message_res(&msg, process);
 	if (ret)
 		pr_debug("err: %s %d", __func__, ret);
 	return ret;
@@ -3781,7 +4311,7 @@ int dxgvmb_send_query_statistics(struct dxgprocess *process,
 	ret = ntstatus2int(result->status);
 
 cleanup:
-	free_message((struct dxgvmbusmsg *)&msg, process);
+	free_message_res(&msg, process);
 	if (ret)
 		pr_debug("err: %s %d", __func__, ret);
 	return ret;
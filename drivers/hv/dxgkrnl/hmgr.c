@@ -14,6 +14,7 @@
 #include <linux/kernel.h>
 #include <linux/mutex.h>
 #include <linux/rwsem.h>
+#include <linux/rcupdate.h>
 
 #include "misc.h"
 #include "dxgkrnl.h"
@@ -50,6 +51,12 @@ const struct d3dkmthandle zerohandle;
 
 /*
  * Handle entry
+ *
+ * The type, unique, instance and destroyed bits share one 32-bit word, so
+ * lockless readers can take a consistent snapshot of the entry state.
+ * Writers order the object pointer update before the state update when a
+ * handle becomes valid, and the state update before the free list indices
+ * update when a handle is freed.
  */
 struct hmgrentry {
 	union {
@@ -59,10 +66,15 @@ struct hmgrentry {
 			u32 next_free_index;
 		};
 	};
-	u32 type:HMGRENTRY_TYPE_BITS + 1;
-	u32 unique:HMGRHANDLE_UNIQUE_BITS;
-	u32 instance:HMGRHANDLE_INSTANCE_BITS;
-	u32 destroyed:1;
+	union {
+		struct {
+			u32 type:HMGRENTRY_TYPE_BITS + 1;
+			u32 unique:HMGRHANDLE_UNIQUE_BITS;
+			u32 instance:HMGRHANDLE_INSTANCE_BITS;
+			u32 destroyed:1;
+		};
+		u32 state;
+	};
 };
 
 #define HMGRTABLE_SIZE_INCREMENT	1024
@@ -82,6 +94,23 @@ static u32 get_index(struct d3dkmthandle h)
 	return (h.v & HMGRHANDLE_INDEX_MASK) >> HMGRHANDLE_INDEX_SHIFT;
 }
 
+/*
+ * Publishes the new entry state. Stores to the object pointer, done before
+ * the call, become visible to lockless readers before the new state.
+ */
+static void set_entry_state(struct hmgrentry *entry, u32 type, u32 unique,
+			    u32 instance, bool destroyed)
+{
+	struct hmgrentry new_state = { };
+
+	new_state.type = type;
+	new_state.unique = unique;
+	new_state.instance = instance;
+	new_state.destroyed = destroyed;
+	smp_wmb();
+	WRITE_ONCE(entry->state, new_state.state);
+}
+
 static bool is_handle_valid(struct hmgrtable *table, struct d3dkmthandle h,
 			    bool ignore_destroyed, enum hmgrentry_type t)
 {
@@ -163,6 +192,7 @@ static bool expand_table(struct hmgrtable *table, u32 NumEntries)
 {
 	u32 new_table_size;
 	struct hmgrentry *new_entry;
+	struct hmgrentry *old_entry;
 	u32 table_index;
 	u32 new_free_count;
 	u32 prev_free_index;
@@ -204,20 +234,17 @@ static bool expand_table(struct hmgrtable *table, u32 NumEntries)
 	if (table->entry_table) {
 		memcpy(new_entry, table->entry_table,
 		       table->table_size * sizeof(struct hmgrentry));
-		vfree(table->entry_table);
 	} else {
 		table->free_handle_list_head = 0;
 	}
 
-	table->entry_table = new_entry;
-
 	/* Initialize new table entries and add to the free list */
 	table_index = table->table_size;
 
 	prev_free_index = table->free_handle_list_tail;
 
 	while (table_index < new_table_size) {
-		struct hmgrentry *entry = &table->entry_table[table_index];
+		struct hmgrentry *entry = &new_entry[table_index];
 
 		entry->prev_free_index = prev_free_index;
 		entry->next_free_index = table_index + 1;
@@ -229,9 +256,18 @@ static bool expand_table(struct hmgrtable *table, u32 NumEntries)
 		table_index++;
 	}
 
-	table->entry_table[table_index - 1].next_free_index =
+	new_entry[table_index - 1].next_free_index =
 	    (u32) HMGRTABLE_INVALID_INDEX;
 
+	/*
+	 * Lockless readers might still use the old table. It is freed after
+	 * an RCU grace period.
+	 */
+	old_entry = table->entry_table;
+	rcu_assign_pointer(table->entry_table, new_entry);
+	if (old_entry)
+		kvfree_rcu(old_entry);
+
 	if (table->free_count != 0) {
 		/* Link the current free list with the new entries */
 		struct hmgrentry *entry;
@@ -243,7 +279,8 @@ static bool expand_table(struct hmgrtable *table, u32 NumEntries)
 	if (table->free_handle_list_head == HMGRTABLE_INVALID_INDEX)
 		table->free_handle_list_head = table->table_size;
 
-	table->table_size = new_table_size;
+	/* Pairs with smp_load_acquire() in hmgrtable_get_object_by_type_rcu */
+	smp_store_release(&table->table_size, new_table_size);
 	table->free_count = new_free_count;
 
 	return true;
@@ -330,9 +367,8 @@ struct d3dkmthandle hmgrtable_alloc_handle(struct hmgrtable *table,
 	unique = table->entry_table[index].unique;
 
 	table->entry_table[index].object = object;
-	table->entry_table[index].type = type;
-	table->entry_table[index].instance = 0;
-	table->entry_table[index].destroyed = !make_valid;
+	set_entry_state(&table->entry_table[index], type, unique, 0,
+			!make_valid);
 	table->free_count--;
 	DXGKRNL_ASSERT(table->free_count <= table->table_size);
 
@@ -414,10 +450,7 @@ int hmgrtable_assign_handle(struct hmgrtable *table, void *object,
 	entry->prev_free_index = HMGRTABLE_INVALID_INDEX;
 	entry->next_free_index = HMGRTABLE_INVALID_INDEX;
 	entry->object = object;
-	entry->type = type;
-	entry->instance = 0;
-	entry->unique = unique;
-	entry->destroyed = false;
+	set_entry_state(entry, type, unique, 0, false);
 
 	table->free_count--;
 	DXGKRNL_ASSERT(table->free_count <= table->table_size);
@@ -449,13 +482,14 @@ void hmgrtable_free_handle(struct hmgrtable *table, enum hmgrentry_type t,
 	if (is_handle_valid(table, h, true, t)) {
 		DXGKRNL_ASSERT(table->free_count < table->table_size);
 		entry = &table->entry_table[i];
-		entry->unique = 1;
-		entry->type = HMGRENTRY_TYPE_FREE;
-		entry->destroyed = 0;
-		if (entry->unique != HMGRHANDLE_UNIQUE_MAX)
-			entry->unique += 1;
-		else
-			entry->unique = 1;
+		set_entry_state(entry, HMGRENTRY_TYPE_FREE,
+				entry->unique != HMGRHANDLE_UNIQUE_MAX ?
+				entry->unique + 1 : 1, 0, false);
+		/*
+		 * The free list indices overlap the object pointer. Lockless
+		 * readers must see the entry as free before they change.
+		 */
+		smp_wmb();
 
 		table->free_count++;
 		DXGKRNL_ASSERT(table->free_count <= table->table_size);
@@ -509,6 +543,48 @@ void *hmgrtable_get_object_by_type(struct hmgrtable *table,
 	return table->entry_table[get_index(h)].object;
 }
 
+/*
+ * Lockless version of hmgrtable_get_object_by_type().
+ * The caller must be in an RCU read-side critical section. The returned
+ * object is guaranteed to be valid only until rcu_read_unlock(), so the
+ * caller needs to take a reference on the object to use it after that.
+ * The failures are not reported, because the caller is expected to retry
+ * the lookup using the locked path.
+ */
+void *hmgrtable_get_object_by_type_rcu(struct hmgrtable *table,
+				       enum hmgrentry_type type,
+				       struct d3dkmthandle h)
+{
+	u32 index = get_index(h);
+	struct hmgrentry *entry_table;
+	struct hmgrentry *entry;
+	struct hmgrentry state;
+	void *object;
+
+	RCU_LOCKDEP_WARN(!rcu_read_lock_held(),
+			 "hmgr lookup outside of RCU read-side section");
+
+	/* Pairs with smp_store_release() in expand_table */
+	if (index >= smp_load_acquire(&table->table_size))
+		return NULL;
+
+	entry_table = rcu_dereference(table->entry_table);
+	entry = &entry_table[index];
+
+	state.state = READ_ONCE(entry->state);
+	smp_rmb();
+	object = READ_ONCE(entry->object);
+	smp_rmb();
+	if (READ_ONCE(entry->state) != state.state)
+		return NULL;
+
+	if (state.type == HMGRENTRY_TYPE_FREE || state.type != type ||
+	    state.unique != get_unique(h) || state.destroyed)
+		return NULL;
+
+	return object;
+}
+
 void *hmgrtable_get_entry_object(struct hmgrtable *table, u32 index)
 {
 	DXGKRNL_ASSERT(index < table->table_size);
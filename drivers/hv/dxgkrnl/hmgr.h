@@ -30,10 +30,17 @@ struct hmgrentry;
  *   HMGRTABLE_MIN_FREE_ENTRIES number of handles.
  *   Handles are allocated from the start of the list and free handles are
  *   inserted after the tail of the list.
+ *   The table is modified under table_lock held exclusively. Lookups could be
+ *   done under table_lock held shared or, by using
+ *   hmgrtable_get_object_by_type_rcu(), under rcu_read_lock(). The entry
+ *   array is replaced by expand_table() and the old array is freed after an
+ *   RCU grace period. Objects, which are looked up locklessly, must also be
+ *   freed after an RCU grace period.
  *
  */
 struct hmgrtable {
 	struct dxgprocess	*process;
+	/* Published with RCU for lockless lookups */
 	struct hmgrentry	*entry_table;
 	u32			free_handle_list_head;
 	u32			free_handle_list_tail;
@@ -97,6 +104,9 @@ enum hmgrentry_type hmgrtable_get_object_type(struct hmgrtable *tbl,
 void *hmgrtable_get_object(struct hmgrtable *tbl, struct d3dkmthandle h);
 void *hmgrtable_get_object_by_type(struct hmgrtable *tbl, enum hmgrentry_type t,
 				   struct d3dkmthandle h);
+void *hmgrtable_get_object_by_type_rcu(struct hmgrtable *tbl,
+				       enum hmgrentry_type t,
+				       struct d3dkmthandle h);
 void *hmgrtable_get_object_ignore_destroyed(struct hmgrtable *tbl,
 					    struct d3dkmthandle h,
 					    enum hmgrentry_type t);
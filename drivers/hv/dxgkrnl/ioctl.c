@@ -19,6 +19,7 @@
 
 #include "dxgkrnl.h"
 #include "dxgvmbus.h"
+#include "dxgkrnl_trace.h"
 
 #undef pr_fmt
 #define pr_fmt(fmt)	"dxgk: " fmt
@@ -30,6 +31,14 @@ struct ioctl_desc {
 };
 static struct ioctl_desc ioctls[LX_IO_MAX + 1];
 
+/*
+ * CPU waits for monitored fences, whose values are mapped to the process,
+ * poll the fence values for up to DXG_CPU_WAIT_POLL_NS before sending the
+ * wait to the host.
+ */
+#define DXG_CPU_WAIT_POLL_NS		(20 * NSEC_PER_USEC)
+#define DXG_CPU_WAIT_POLL_MAX_OBJECTS	8
+
 static int dxgsyncobj_release(struct inode *inode, struct file *file)
 {
 	struct dxgsharedsyncobject *syncobj = file->private_data;
@@ -2045,6 +2054,15 @@ dxgk_make_resident(struct dxgprocess *process, void *__user inargs)
 		goto cleanup;
 	}
 
+	dxgprocess_residency_add(process, DXGRES_MAKE_RESIDENT, 1);
+	dxgprocess_residency_add(process, DXGRES_MAKE_RESIDENT_ALLOCS,
+				 args.alloc_count);
+	if (ret == STATUS_PENDING)
+		dxgprocess_residency_add(process, DXGRES_MAKE_RESIDENT_PENDING,
+					 1);
+	dxgprocess_residency_add(process, DXGRES_BYTES_TO_TRIM,
+				 args.num_bytes_to_trim);
+
 	ret2 = copy_to_user(&input->paging_fence_value,
 			    &args.paging_fence_value, sizeof(u64));
 	if (ret2) {
@@ -2114,6 +2132,12 @@ dxgk_evict(struct dxgprocess *process, void *__user inargs)
 	if (ret < 0)
 		goto cleanup;
 
+	dxgprocess_residency_add(process, DXGRES_EVICT, 1);
+	dxgprocess_residency_add(process, DXGRES_EVICT_ALLOCS,
+				 args.alloc_count);
+	dxgprocess_residency_add(process, DXGRES_BYTES_TO_TRIM,
+				 args.num_bytes_to_trim);
+
 	ret = copy_to_user(&input->num_bytes_to_trim,
 			   &args.num_bytes_to_trim, sizeof(u64));
 	if (ret) {
@@ -2174,6 +2198,11 @@ dxgk_offer_allocations(struct dxgprocess *process, void *__user inargs)
 	}
 
 	ret = dxgvmb_send_offer_allocations(process, adapter, &args);
+	if (ret == 0) {
+		dxgprocess_residency_add(process, DXGRES_OFFER, 1);
+		dxgprocess_residency_add(process, DXGRES_OFFER_ALLOCS,
+					 args.allocation_count);
+	}
 
 cleanup:
 
@@ -2234,6 +2263,11 @@ dxgk_reclaim_allocations(struct dxgprocess *process, void *__user inargs)
 	ret = dxgvmb_send_reclaim_allocations(process, adapter,
 					      device->handle, &args,
 					      &in_args->paging_fence_value);
+	if (ret >= 0) {
+		dxgprocess_residency_add(process, DXGRES_RECLAIM, 1);
+		dxgprocess_residency_add(process, DXGRES_RECLAIM_ALLOCS,
+					 args.allocation_count);
+	}
 
 cleanup:
 
@@ -3460,6 +3494,66 @@ dxgk_wait_sync_object(struct dxgprocess *process, void *__user inargs)
 	return ret;
 }
 
+/*
+ * Returns true when the wait condition is satisfied by the mapped fence values
+ * within the polling interval.
+ */
+static bool
+dxgk_poll_sync_objects_cpu(struct dxgprocess *process,
+			   struct d3dkmt_waitforsynchronizationobjectfromcpu
+			   *args)
+{
+	struct d3dkmthandle handles[DXG_CPU_WAIT_POLL_MAX_OBJECTS];
+	u64 fence_values[DXG_CPU_WAIT_POLL_MAX_OBJECTS];
+	u64 __user *fence_va[DXG_CPU_WAIT_POLL_MAX_OBJECTS];
+	struct dxgsyncobject *syncobj;
+	u32 count = args->object_count;
+	u32 signaled;
+	u64 deadline;
+	u64 value;
+	u32 i;
+
+	if (count > DXG_CPU_WAIT_POLL_MAX_OBJECTS)
+		return false;
+	if (copy_from_user(handles, args->objects, sizeof(handles[0]) * count))
+		return false;
+	if (copy_from_user(fence_values, args->fence_values,
+			   sizeof(fence_values[0]) * count))
+		return false;
+
+	hmgrtable_lock(&process->handle_table, DXGLOCK_SHARED);
+	for (i = 0; i < count; i++) {
+		syncobj = hmgrtable_get_object_by_type(&process->handle_table,
+						HMGRENTRY_TYPE_DXGSYNCOBJECT,
+						handles[i]);
+		if (syncobj == NULL || !syncobj->monitored_fence ||
+		    syncobj->mapped_address == NULL ||
+		    syncobj->device_handle.v != args->device.v)
+			break;
+		fence_va[i] = (u64 __user *)syncobj->mapped_address;
+	}
+	hmgrtable_unlock(&process->handle_table, DXGLOCK_SHARED);
+	if (i < count)
+		return false;
+
+	deadline = ktime_get_ns() + DXG_CPU_WAIT_POLL_NS;
+	do {
+		signaled = 0;
+		for (i = 0; i < count; i++) {
+			/* The mapping could be destroyed by another thread */
+			if (get_user(value, fence_va[i]))
+				return false;
+			if (value >= fence_values[i])
+				signaled++;
+		}
+		if (signaled == count || (signaled && args->flags.wait_any))
+			return true;
+		cpu_relax();
+	} while (ktime_get_ns() < deadline && !need_resched());
+
+	return false;
+}
+
 static int
 dxgk_wait_sync_object_cpu(struct dxgprocess *process, void *__user inargs)
 {
@@ -3487,6 +3581,12 @@ dxgk_wait_sync_object_cpu(struct dxgprocess *process, void *__user inargs)
 		goto cleanup;
 	}
 
+	if (args.async_event == 0 &&
+	    dxgk_poll_sync_objects_cpu(process, &args)) {
+		ret = 0;
+		goto cleanup;
+	}
+
 	if (args.async_event) {
 		async_host_event = vzalloc(sizeof(*async_host_event));
 		if (async_host_event == NULL) {
@@ -4016,6 +4116,8 @@ dxgk_set_allocation_priority(struct dxgprocess *process, void *__user inargs)
 		goto cleanup;
 	}
 	ret = dxgvmb_send_set_allocation_priority(process, adapter, &args);
+	if (ret == 0)
+		dxgprocess_residency_add(process, DXGRES_SET_PRIORITY, 1);
 cleanup:
 	if (adapter)
 		dxgadapter_release_lock_shared(adapter);
@@ -5191,6 +5293,94 @@ dxgk_share_object_with_host(struct dxgprocess *process, void *__user inargs)
 	return ret;
 }
 
+/*
+ * Processes a vector of submit/signal/wait operations in a single ioctl.
+ * When the host supports asynchronous messages, every operation is posted
+ * to the global channel without waiting for a completion, so the packets are
+ * pipelined in the ring buffer and the host is interrupted only when the ring
+ * transitions from empty. Processing stops at the first failed operation and
+ * the number of successfully processed operations is returned in
+ * completed_count.
+ */
+static int
+dxgk_submit_batch(struct dxgprocess *process, void *__user inargs)
+{
+	struct d3dkmt_submitbatch args;
+	struct d3dkmt_submitbatch *__user user_args = inargs;
+	struct d3dkmt_batchoperation *operations = NULL;
+	u32 completed_count = 0;
+	int ret;
+	int ret2;
+	u32 i;
+
+	ret = copy_from_user(&args, inargs, sizeof(args));
+	if (ret) {
+		pr_err("%s failed to copy input args", __func__);
+		ret = -EINVAL;
+		goto cleanup;
+	}
+
+	if (args.operation_count == 0 ||
+	    args.operation_count > D3DKMT_SUBMITBATCH_MAX) {
+		pr_err("invalid number of batch operations: %d",
+			args.operation_count);
+		ret = -EINVAL;
+		goto cleanup;
+	}
+
+	operations = vzalloc(sizeof(*operations) * args.operation_count);
+	if (operations == NULL) {
+		ret = -ENOMEM;
+		goto cleanup;
+	}
+	ret = copy_from_user(operations, args.operations,
+			     sizeof(*operations) * args.operation_count);
+	if (ret) {
+		pr_err("%s failed to copy operations", __func__);
+		ret = -EINVAL;
+		goto cleanup;
+	}
+
+	for (i = 0; i < args.operation_count; i++) {
+		switch (operations[i].type) {
+		case _D3DKMT_BATCH_SUBMITCOMMAND:
+			ret = dxgk_submit_command(process, operations[i].args);
+			break;
+		case _D3DKMT_BATCH_SIGNALSYNCOBJECTFROMGPU:
+			ret = dxgk_signal_sync_object_gpu(process,
+							  operations[i].args);
+			break;
+		case _D3DKMT_BATCH_WAITFORSYNCOBJECTFROMGPU:
+			ret = dxgk_wait_sync_object_gpu(process,
+							operations[i].args);
+			break;
+		default:
+			pr_err("invalid batch operation type: %d",
+				operations[i].type);
+			ret = -EINVAL;
+			break;
+		}
+		if (ret < 0)
+			break;
+		completed_count++;
+	}
+
+	ret2 = copy_to_user(&user_args->completed_count, &completed_count,
+			    sizeof(completed_count));
+	if (ret2) {
+		pr_err("%s failed to copy completed count", __func__);
+		ret = -EINVAL;
+	}
+
+cleanup:
+
+	if (operations)
+		vfree(operations);
+
+	pr_debug("ioctl:%s %s %d", errorstr(ret), __func__, ret);
+	return ret;
+}
+
 /*
  * IOCTL processing
  * The driver IOCTLs return
@@ -5204,6 +5394,7 @@ static int dxgk_ioctl(struct file *f, unsigned int p1, unsigned long p2)
 	int code = _IOC_NR(p1);
 	int status;
 	struct dxgprocess *process;
+	u64 start;
 
 	if (code < 1 || code > LX_IO_MAX) {
 		pr_err("bad ioctl %x %x %x %x",
@@ -5225,7 +5416,11 @@ static int dxgk_ioctl(struct file *f, unsigned int p1, unsigned long p2)
 			   process->tgid, current->tgid);
 		return -ENOTTY;
 	}
+	trace_dxgk_ioctl_enter(code);
+	start = dxgstats_start();
 	status = ioctls[code].ioctl_callback(process, (void *__user)p2);
+	dxgstats_ioctl_done(code, start);
+	trace_dxgk_ioctl_exit(code, status);
 	return status;
 }
 
@@ -5365,4 +5560,6 @@ void init_ioctls(void)
 		  LX_DXQUERYSTATISTICS);
 	SET_IOCTL(/*0x44 */ dxgk_share_object_with_host,
 		  LX_DXSHAREOBJECTWITHHOST);
+	SET_IOCTL(/*0x45 */ dxgk_submit_batch,
+		  LX_DXSUBMITBATCH);
 }
@@ -23,6 +23,8 @@
 #include <linux/notifier.h>
 #include <linux/percpu_counter.h>
 #include <linux/page_reporting.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
 
 #include <linux/hyperv.h>
 #include <asm/hyperv-tlfs.h>
@@ -479,6 +481,16 @@ MODULE_PARM_DESC(hot_add, "If set attempt memory hot_add");
 
 module_param(pressure_report_delay, uint, (S_IRUGO | S_IWUSR));
 MODULE_PARM_DESC(pressure_report_delay, "Delay in secs in reporting pressure");
+
+static uint page_reporting_order;
+module_param(page_reporting_order, uint, 0444);
+MODULE_PARM_DESC(page_reporting_order,
+		 "Order of free page blocks reported to host (0: pageblock order)");
+
+static uint page_reporting_rate;
+module_param(page_reporting_rate, uint, (S_IRUGO | S_IWUSR));
+MODULE_PARM_DESC(page_reporting_rate,
+		 "Max MB/s of free memory reported to host (0: unlimited)");
 static atomic_t trans_id = ATOMIC_INIT(0);
 
 static int dm_ring_size = VMBUS_RING_SIZE(16 * 1024);
@@ -501,6 +513,8 @@ static __u8 recv_buffer[HV_HYP_PAGE_SIZE];
 static __u8 balloon_up_send_buffer[HV_HYP_PAGE_SIZE];
 #define PAGES_IN_2M (2 * 1024 * 1024 / PAGE_SIZE)
 #define HA_CHUNK (128 * 1024 * 1024 / PAGE_SIZE)
+/* Number of HA_CHUNKs hot added with a single add_memory() call */
+#define HA_BULK_CHUNKS 8
 
 struct hv_dynmem_device {
 	struct hv_device *dev;
@@ -567,6 +581,19 @@ struct hv_dynmem_device {
 	__u32 version;
 
 	struct page_reporting_dev_info pr_dev_info;
+
+	/*
+	 * Free page reporting statistics and the state of the
+	 * page_reporting_rate limiter. Only the page reporting worker
+	 * updates them.
+	 */
+	u64 pr_bytes_reported;
+	u64 pr_hints;
+	u64 pr_throttled_ms;
+	unsigned long pr_window_start;
+	u64 pr_window_bytes;
+
+	struct dentry *debugfs_dir;
 };
 
 static struct hv_dynmem_device dm_device;
@@ -592,6 +619,24 @@ static inline bool has_pfn_is_backed(struct hv_hotadd_state *has,
 	return true;
 }
 
+/* Check if all the pages in [pfn, pfn + nr_pages) are backed. */
+static bool has_pfn_range_is_backed(struct hv_hotadd_state *has,
+				    unsigned long pfn, unsigned long nr_pages)
+{
+	struct hv_hotadd_gap *gap;
+
+	if ((pfn < has->covered_start_pfn) ||
+	    (pfn + nr_pages > has->covered_end_pfn))
+		return false;
+
+	list_for_each_entry(gap, &has->gap_list, list) {
+		if ((pfn < gap->end_pfn) && (pfn + nr_pages > gap->start_pfn))
+			return false;
+	}
+
+	return true;
+}
+
 static unsigned long hv_page_offline_check(unsigned long start_pfn,
 					   unsigned long nr_pages)
 {
@@ -688,14 +733,52 @@ static void hv_page_online_one(struct hv_hotadd_state *has, struct page *pg)
 	dm_device.num_pages_onlined++;
 }
 
+/*
+ * Online a naturally aligned, fully backed block of 2^order pages with a
+ * single call into the page allocator.
+ */
+static void hv_page_online_block(struct page *pg, unsigned int order)
+{
+	unsigned long i;
+
+	for (i = 0; i < (1UL << order); i++) {
+		if (PageOffline(pg + i))
+			__ClearPageOffline(pg + i);
+	}
+
+	generic_online_page(pg, order);
+
+	lockdep_assert_held(&dm_device.ha_lock);
+	dm_device.num_pages_onlined += 1UL << order;
+}
+
 static void hv_bring_pgs_online(struct hv_hotadd_state *has,
 				unsigned long start_pfn, unsigned long size)
 {
-	int i;
+	unsigned long pfn = start_pfn, end_pfn = start_pfn + size;
+	unsigned int order;
 
 	pr_debug("Online %lu pages starting at pfn 0x%lx\n", size, start_pfn);
-	for (i = 0; i < size; i++)
-		hv_page_online_one(has, pfn_to_page(start_pfn + i));
+	while (pfn < end_pfn) {
+		/*
+		 * Hand the largest aligned block, which is backed as a whole,
+		 * to the page allocator at once; fall back to single pages
+		 * around the gaps and the end of the covered range.
+		 */
+		order = pfn ? min_t(unsigned int, MAX_ORDER - 1, __ffs(pfn)) :
+			      MAX_ORDER - 1;
+		while (order &&
+		       ((pfn + (1UL << order) > end_pfn) ||
+			!has_pfn_range_is_backed(has, pfn, 1UL << order)))
+			order--;
+
+		if (order)
+			hv_page_online_block(pfn_to_page(pfn), order);
+		else
+			hv_page_online_one(has, pfn_to_page(pfn));
+
+		pfn += 1UL << order;
+	}
 }
 
 static void hv_mem_hot_add(unsigned long start, unsigned long size,
@@ -703,21 +786,34 @@ static void hv_mem_hot_add(unsigned long start, unsigned long size,
 				struct hv_hotadd_state *has)
 {
 	int ret = 0;
-	int i, nid;
-	unsigned long start_pfn;
+	int nid;
+	unsigned long start_pfn = start;
+	unsigned long end_pfn = start + size;
+	unsigned long chunk_pfn;
 	unsigned long processed_pfn;
 	unsigned long total_pfn = pfn_count;
 	unsigned long flags;
 
-	for (i = 0; i < (size/HA_CHUNK); i++) {
-		start_pfn = start + (i * HA_CHUNK);
+	for (; start_pfn < end_pfn; start_pfn += chunk_pfn) {
+		/*
+		 * Add up to HA_BULK_CHUNKS chunks at once as long as they sit
+		 * on the same node; every add_memory() call has to take the
+		 * global hotplug locks and create the memory block devices.
+		 */
+		chunk_pfn = min(end_pfn - start_pfn,
+				(unsigned long)HA_BULK_CHUNKS * HA_CHUNK);
+		nid = memory_add_physaddr_to_nid(PFN_PHYS(start_pfn));
+		if (chunk_pfn > HA_CHUNK &&
+		    memory_add_physaddr_to_nid(PFN_PHYS(start_pfn + chunk_pfn - 1))
+		    != nid)
+			chunk_pfn = HA_CHUNK;
 
 		spin_lock_irqsave(&dm_device.ha_lock, flags);
-		has->ha_end_pfn +=  HA_CHUNK;
+		has->ha_end_pfn +=  chunk_pfn;
 
-		if (total_pfn > HA_CHUNK) {
-			processed_pfn = HA_CHUNK;
-			total_pfn -= HA_CHUNK;
+		if (total_pfn > chunk_pfn) {
+			processed_pfn = chunk_pfn;
+			total_pfn -= chunk_pfn;
 		} else {
 			processed_pfn = total_pfn;
 			total_pfn = 0;
@@ -728,9 +824,8 @@ static void hv_mem_hot_add(unsigned long start, unsigned long size,
 
 		reinit_completion(&dm_device.ol_waitevent);
 
-		nid = memory_add_physaddr_to_nid(PFN_PHYS(start_pfn));
 		ret = add_memory(nid, PFN_PHYS((start_pfn)),
-				(HA_CHUNK << PAGE_SHIFT), MHP_MERGE_RESOURCE);
+				(chunk_pfn << PAGE_SHIFT), MHP_MERGE_RESOURCE);
 
 		if (ret) {
 			pr_err("hot_add memory failed error is %d\n", ret);
@@ -745,7 +840,7 @@ static void hv_mem_hot_add(unsigned long start, unsigned long size,
 				do_hot_add = false;
 			}
 			spin_lock_irqsave(&dm_device.ha_lock, flags);
-			has->ha_end_pfn -= HA_CHUNK;
+			has->ha_end_pfn -= chunk_pfn;
 			has->covered_end_pfn -=  processed_pfn;
 			spin_unlock_irqrestore(&dm_device.ha_lock, flags);
 			break;
@@ -1580,17 +1675,57 @@ static void balloon_onchannelcallback(void *context)
 /* Hyper-V only supports reporting 2MB pages or higher */
 #define HV_MIN_PAGE_REPORTING_ORDER	9
 #define HV_MIN_PAGE_REPORTING_LEN (HV_HYP_PAGE_SIZE << HV_MIN_PAGE_REPORTING_ORDER)
+#define HV_1G_PAGE_REPORTING_ORDER	18
+#define HV_1G_PAGE_REPORTING_LEN (HV_HYP_PAGE_SIZE << HV_1G_PAGE_REPORTING_ORDER)
+
+/*
+ * Enforce page_reporting_rate. The report callback runs from the page
+ * reporting worker with the zone lock dropped, so sleeping here only
+ * delays further reporting and doesn't hold up the allocator.
+ */
+static void hv_page_report_throttle(u64 bytes)
+{
+	u64 budget = (u64)READ_ONCE(page_reporting_rate) << 20;
+	unsigned long end;
+
+	if (!budget)
+		return;
+
+	if (time_after_eq(jiffies, dm_device.pr_window_start + HZ)) {
+		dm_device.pr_window_start = jiffies;
+		dm_device.pr_window_bytes = 0;
+	}
+
+	dm_device.pr_window_bytes += bytes;
+	if (dm_device.pr_window_bytes <= budget)
+		return;
+
+	end = dm_device.pr_window_start + HZ;
+	if (time_before(jiffies, end)) {
+		dm_device.pr_throttled_ms += jiffies_to_msecs(end - jiffies);
+		schedule_timeout_interruptible(end - jiffies);
+	}
+
+	dm_device.pr_window_start = jiffies;
+	dm_device.pr_window_bytes = bytes;
+}
+
 static int hv_free_page_report(struct page_reporting_dev_info *pr_dev_info,
 		    struct scatterlist *sgl, unsigned int nents)
 {
 	unsigned long flags;
 	struct hv_memory_hint *hint;
 	int i;
-	u64 status;
+	u64 status, bytes = 0;
 	struct scatterlist *sg;
 
 	WARN_ON_ONCE(nents > HV_MEMORY_HINT_MAX_GPA_PAGE_RANGES);
 	WARN_ON_ONCE(sgl->length < HV_MIN_PAGE_REPORTING_LEN);
+
+	for_each_sg(sgl, sg, nents, i)
+		bytes += sg->length;
+	hv_page_report_throttle(bytes);
+
 	local_irq_save(flags);
 	hint = *(struct hv_memory_hint **)this_cpu_ptr(hyperv_pcpu_input_arg);
 	if (!hint) {
@@ -1602,16 +1737,26 @@ static int hv_free_page_report(struct page_reporting_dev_info *pr_dev_info,
 	hint->reserved = 0;
 	for_each_sg(sgl, sg, nents, i) {
 		union hv_gpa_page_range *range;
+		u64 hvpfn = page_to_hvpfn(sg_page(sg));
 
 		range = &hint->ranges[i];
 		range->address_space = 0;
 		/* page reporting only reports 2MB pages or higher */
 		range->page.largepage = 1;
-		range->page.additional_pages =
-			(sg->length / HV_MIN_PAGE_REPORTING_LEN) - 1;
-		range->page_size = HV_GPA_PAGE_RANGE_PAGE_SIZE_2MB;
-		range->base_large_pfn =
-			page_to_hvpfn(sg_page(sg)) >> HV_MIN_PAGE_REPORTING_ORDER;
+		if (IS_ALIGNED(hvpfn, 1UL << HV_1G_PAGE_REPORTING_ORDER) &&
+		    IS_ALIGNED(sg->length, HV_1G_PAGE_REPORTING_LEN)) {
+			range->page.additional_pages =
+				(sg->length / HV_1G_PAGE_REPORTING_LEN) - 1;
+			range->page_size = HV_GPA_PAGE_RANGE_PAGE_SIZE_1GB;
+			range->base_large_pfn =
+				hvpfn >> HV_1G_PAGE_REPORTING_ORDER;
+		} else {
+			range->page.additional_pages =
+				(sg->length / HV_MIN_PAGE_REPORTING_LEN) - 1;
+			range->page_size = HV_GPA_PAGE_RANGE_PAGE_SIZE_2MB;
+			range->base_large_pfn =
+				hvpfn >> HV_MIN_PAGE_REPORTING_ORDER;
+		}
 	}
 
 	status = hv_do_rep_hypercall(HV_EXT_CALL_MEMORY_HEAT_HINT, nents, 0,
@@ -1623,6 +1768,9 @@ static int hv_free_page_report(struct page_reporting_dev_info *pr_dev_info,
 		return -EINVAL;
 	}
 
+	dm_device.pr_bytes_reported += bytes;
+	dm_device.pr_hints++;
+
 	return 0;
 }
 
@@ -1642,6 +1790,16 @@ static void enable_page_reporting(void)
 	}
 
 	BUILD_BUG_ON(PAGE_REPORTING_CAPACITY > HV_MEMORY_HINT_MAX_GPA_PAGE_RANGES);
+	if (page_reporting_order) {
+		/*
+		 * Reporting larger blocks means fewer, bigger hypercalls, but
+		 * the buddy allocator can't hand out more than MAX_ORDER - 1.
+		 */
+		page_reporting_order = clamp_t(uint, page_reporting_order,
+					       HV_MIN_PAGE_REPORTING_ORDER,
+					       MAX_ORDER - 1);
+		dm_device.pr_dev_info.order = page_reporting_order;
+	}
 	dm_device.pr_dev_info.report = hv_free_page_report;
 	ret = page_reporting_register(&dm_device.pr_dev_info);
 	if (ret < 0) {
@@ -1807,6 +1965,50 @@ static int balloon_connect_vsp(struct hv_device *dev)
 	return ret;
 }
 
+#ifdef CONFIG_DEBUG_FS
+static int hv_balloon_debug_show(struct seq_file *f, void *offset)
+{
+	struct hv_dynmem_device *dm = f->private;
+
+	seq_printf(f, "%-22s: %u\n", "pages_ballooned", dm->num_pages_ballooned);
+	seq_printf(f, "%-22s: %u\n", "pages_added", dm->num_pages_added);
+	seq_printf(f, "%-22s: %u\n", "pages_onlined", dm->num_pages_onlined);
+	seq_printf(f, "%-22s: %u\n", "reporting_order",
+		   !dm->pr_dev_info.report ? 0 :
+		   dm->pr_dev_info.order ?: pageblock_order);
+	seq_printf(f, "%-22s: %llu\n", "reported_bytes",
+		   READ_ONCE(dm->pr_bytes_reported));
+	seq_printf(f, "%-22s: %llu\n", "report_hypercalls",
+		   READ_ONCE(dm->pr_hints));
+	seq_printf(f, "%-22s: %llu\n", "report_throttled_ms",
+		   READ_ONCE(dm->pr_throttled_ms));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(hv_balloon_debug);
+
+static void hv_balloon_debugfs_init(struct hv_dynmem_device *dm)
+{
+	dm->debugfs_dir = debugfs_create_dir("hv-balloon", NULL);
+	debugfs_create_file("stats", 0444, dm->debugfs_dir, dm,
+			    &hv_balloon_debug_fops);
+}
+
+static void hv_balloon_debugfs_exit(struct hv_dynmem_device *dm)
+{
+	debugfs_remove_recursive(dm->debugfs_dir);
+	dm->debugfs_dir = NULL;
+}
+#else
+static inline void hv_balloon_debugfs_init(struct hv_dynmem_device *dm)
+{
+}
+
+static inline void hv_balloon_debugfs_exit(struct hv_dynmem_device *dm)
+{
+}
+#endif
+
 static int balloon_probe(struct hv_device *dev,
 			 const struct hv_vmbus_device_id *dev_id)
 {
@@ -1854,6 +2056,8 @@ static int balloon_probe(struct hv_device *dev,
 		goto probe_error;
 	}
 
+	hv_balloon_debugfs_init(&dm_device);
+
 	return 0;
 
 probe_error:
@@ -1879,6 +2083,8 @@ static int balloon_remove(struct hv_device *dev)
 	if (dm->num_pages_ballooned != 0)
 		pr_warn("Ballooned pages: %d\n", dm->num_pages_ballooned);
 
+	hv_balloon_debugfs_exit(dm);
+
 	cancel_work_sync(&dm->balloon_wrk.wrk);
 	cancel_work_sync(&dm->ha_wrk.wrk);
 
@@ -13,6 +13,8 @@
 #include <linux/workqueue.h>
 #include <linux/hyperv.h>
 #include <linux/sched.h>
+#include <linux/mm.h>
+#include <linux/vmalloc.h>
 #include <asm/hyperv-tlfs.h>
 
 #include "hyperv_vmbus.h"
@@ -67,6 +69,16 @@ static struct hvutil_transport *hvt;
  */
 static int dm_reg_value;
 
+/*
+ * Ring shared with a FCOPY_VERSION_2 daemon.  It is allocated on the first
+ * such registration and kept until the driver goes away, as the daemon may
+ * still have it mapped.  fcopy_ring_head is our copy of ring->head, which
+ * userspace can write to.
+ */
+#define FCOPY_RING_BYTES	PAGE_ALIGN(sizeof(struct hv_fcopy_ring))
+static struct hv_fcopy_ring *fcopy_ring;
+static u32 fcopy_ring_head;
+
 static void fcopy_poll_wrapper(void *channel)
 {
 	/* Transaction is finished, reset the state here to avoid races. */
@@ -106,6 +118,23 @@ static int fcopy_handle_handshake(u32 version)
 			return -EFAULT;
 		dm_reg_value = version;
 		break;
+	case FCOPY_VERSION_2:
+		/* Same as above, but data fragments go through the ring */
+		if (!fcopy_ring) {
+			fcopy_ring = vmalloc_user(FCOPY_RING_BYTES);
+			if (!fcopy_ring)
+				return -ENOMEM;
+		}
+		fcopy_ring->head = fcopy_ring->tail = 0;
+		fcopy_ring->error = 0;
+		fcopy_ring_head = 0;
+
+		our_ver = FCOPY_VERSION_2;
+		if (hvutil_transport_send(hvt, &our_ver, sizeof(our_ver),
+		    fcopy_register_done))
+			return -EFAULT;
+		dm_reg_value = version;
+		break;
 	default:
 		/*
 		 * For now we will fail the registration.
@@ -183,6 +212,52 @@ static void fcopy_send_data(struct work_struct *dummy)
 	kfree(smsg_out);
 }
 
+/*
+ * Hand a WRITE_TO_FILE fragment to a streaming daemon through the ring and
+ * acknowledge it right away, so that the host can send the next fragment
+ * while the daemon is still writing this one.  Returns false if the ring is
+ * full; the fragment then goes the request/response way, which doubles as
+ * back-pressure since the daemon drains the ring before handling it.
+ */
+static bool fcopy_stream_fragment(struct hv_fcopy_hdr *fcopy_msg)
+{
+	struct hv_fcopy_ring *ring = fcopy_ring;
+	int error;
+
+	if (fcopy_ring_head - smp_load_acquire(&ring->tail) >= FCOPY_RING_SLOTS)
+		return false;
+
+	/* Once a write failed, have the host abort the copy. */
+	error = READ_ONCE(ring->error);
+	if (!error) {
+		memcpy(&ring->slots[fcopy_ring_head % FCOPY_RING_SLOTS],
+		       fcopy_msg, sizeof(struct hv_do_fcopy));
+		fcopy_ring_head++;
+		smp_store_release(&ring->head, fcopy_ring_head);
+		wake_up_interruptible(&hvt->outmsg_q);
+	}
+
+	fcopy_respond_to_host(error);
+	return true;
+}
+
+static bool fcopy_on_poll(void)
+{
+	return dm_reg_value == FCOPY_VERSION_2 &&
+	       READ_ONCE(fcopy_ring->tail) != fcopy_ring_head;
+}
+
+static int fcopy_on_mmap(struct vm_area_struct *vma)
+{
+	if (dm_reg_value != FCOPY_VERSION_2 || !fcopy_ring)
+		return -ENODEV;
+
+	if (vma->vm_pgoff || vma->vm_end - vma->vm_start > FCOPY_RING_BYTES)
+		return -EINVAL;
+
+	return remap_vmalloc_range(vma, fcopy_ring, 0);
+}
+
 /*
  * Send a response back to the host.
  */
@@ -287,6 +362,12 @@ void hv_fcopy_onchannelcallback(void *context)
 			fcopy_respond_to_host(HV_E_FAIL);
 			return;
 		}
+
+		if (fcopy_msg->operation == WRITE_TO_FILE &&
+		    dm_reg_value == FCOPY_VERSION_2 &&
+		    fcopy_stream_fragment(fcopy_msg))
+			return;
+
 		fcopy_transaction.state = HVUTIL_HOSTMSG_RECEIVED;
 
 		/*
@@ -364,6 +445,9 @@ int hv_fcopy_init(struct hv_util_service *srv)
 	if (!hvt)
 		return -EFAULT;
 
+	hvt->on_mmap = fcopy_on_mmap;
+	hvt->on_poll = fcopy_on_poll;
+
 	return 0;
 }
 
@@ -424,4 +508,5 @@ void hv_fcopy_deinit(void)
 	hv_fcopy_cancel_work();
 
 	hvutil_transport_destroy(hvt);
+	vfree(fcopy_ring);
 }
@@ -12,6 +12,9 @@
 #include <linux/connector.h>
 #include <linux/workqueue.h>
 #include <linux/hyperv.h>
+#include <linux/fs.h>
+#include <linux/major.h>
+#include <linux/moduleparam.h>
 #include <asm/hyperv-tlfs.h>
 
 #include "hyperv_vmbus.h"
@@ -79,6 +82,42 @@ static void vss_handle_request(struct work_struct *dummy);
 static DECLARE_DELAYED_WORK(vss_timeout_work, vss_timeout_func);
 static DECLARE_WORK(vss_handle_request_work, vss_handle_request);
 
+/*
+ * Kernel-assisted freeze: instead of having the daemon FIFREEZE one mount
+ * after the other, freeze all eligible filesystems in parallel here, which
+ * keeps the window in which applications see a frozen filesystem short.
+ */
+static bool vss_kernel_freeze;
+module_param(vss_kernel_freeze, bool, 0644);
+MODULE_PARM_DESC(vss_kernel_freeze,
+		 "Freeze filesystems in the kernel, in parallel, instead of in the VSS daemon. "
+		 "While set, FREEZE, THAW and HOT_BACKUP are no longer passed to a running daemon, "
+		 "so its freeze hooks are not run");
+
+/*
+ * Only superblocks of these types are frozen. They are looked up through the
+ * exported iterate_supers_type(); a type which is not registered yet causes
+ * its module to be requested.
+ */
+static char vss_kernel_freeze_fs[128] = "ext4,xfs,btrfs";
+module_param_string(vss_kernel_freeze_fs, vss_kernel_freeze_fs,
+		    sizeof(vss_kernel_freeze_fs), 0644);
+MODULE_PARM_DESC(vss_kernel_freeze_fs,
+		 "Comma separated filesystem types frozen with vss_kernel_freeze");
+
+struct vss_frozen_sb {
+	struct list_head list;
+	struct super_block *sb;
+	struct work_struct work;
+	s64 latency_us;		/* time freeze_super() took */
+	int error;
+	bool frozen;		/* by us, so we have to thaw it */
+};
+
+/* Filesystems of the snapshot in progress, only touched from vss_handle_request() */
+static LIST_HEAD(vss_frozen_sbs);
+static ktime_t vss_freeze_start;
+
 static void vss_poll_wrapper(void *channel)
 {
 	/* Transaction is finished, reset the state here to avoid races. */
@@ -207,6 +246,194 @@ static void vss_send_op(void)
 	kfree(vss_msg);
 }
 
+/*
+ * Skip the same filesystems as the daemon does: read-only ones, vfat, and
+ * those on loop devices, whose backing file may live on a filesystem that's
+ * being frozen at the same time.
+ */
+static bool vss_sb_eligible(struct super_block *sb)
+{
+	if (!sb->s_bdev || sb_rdonly(sb))
+		return false;
+
+	if (MAJOR(sb->s_dev) == LOOP_MAJOR || !strcmp(sb->s_type->name, "vfat"))
+		return false;
+
+	return sb->s_op->freeze_fs || sb->s_op->freeze_super;
+}
+
+static void vss_collect_sb(struct super_block *sb, void *arg)
+{
+	struct vss_frozen_sb *fsb;
+
+	if (!vss_sb_eligible(sb))
+		return;
+
+	fsb = kzalloc(sizeof(*fsb), GFP_KERNEL);
+	if (!fsb) {
+		*(int *)arg = -ENOMEM;
+		return;
+	}
+
+	/* Pin it; we are called with s_umount held, so it can't go away. */
+	if (!atomic_inc_not_zero(&sb->s_active)) {
+		kfree(fsb);
+		return;
+	}
+
+	fsb->sb = sb;
+	list_add_tail(&fsb->list, &vss_frozen_sbs);
+}
+
+static void vss_freeze_work(struct work_struct *work)
+{
+	struct vss_frozen_sb *fsb = container_of(work, struct vss_frozen_sb, work);
+	struct super_block *sb = fsb->sb;
+	ktime_t start = ktime_get();
+
+	if (sb->s_op->freeze_super)
+		fsb->error = sb->s_op->freeze_super(sb);
+	else
+		fsb->error = freeze_super(sb);
+
+	fsb->latency_us = ktime_us_delta(ktime_get(), start);
+}
+
+/*
+ * Thaw what we froze, and report how long each filesystem took to freeze
+ * and how long they have been frozen: this isn't logged while frozen, as
+ * that might get the log writer stuck.
+ */
+static void vss_thaw_all(void)
+{
+	struct vss_frozen_sb *fsb, *tmp;
+	struct super_block *sb;
+	s64 frozen_us = ktime_us_delta(ktime_get(), vss_freeze_start);
+	int nr = 0, error;
+
+	list_for_each_entry_safe(fsb, tmp, &vss_frozen_sbs, list) {
+		sb = fsb->sb;
+
+		if (fsb->frozen) {
+			if (sb->s_op->thaw_super)
+				error = sb->s_op->thaw_super(sb);
+			else
+				error = thaw_super(sb);
+			if (error)
+				pr_warn("VSS: failed to thaw %s: %d\n",
+					sb->s_id, error);
+
+			pr_info("VSS: %s (%s) took %lld us to freeze\n",
+				sb->s_id, sb->s_type->name, fsb->latency_us);
+			nr++;
+		}
+
+		deactivate_super(sb);
+		list_del(&fsb->list);
+		kfree(fsb);
+	}
+
+	if (nr)
+		pr_info("VSS: %d filesystems thawed after %lld us\n",
+			nr, frozen_us);
+}
+
+static int vss_collect_all(void)
+{
+	struct file_system_type *type;
+	char *names, *p, *name;
+	int ret = 0;
+
+	kernel_param_lock(THIS_MODULE);
+	names = kstrdup(vss_kernel_freeze_fs, GFP_KERNEL);
+	kernel_param_unlock(THIS_MODULE);
+	if (!names)
+		return -ENOMEM;
+
+	p = names;
+	while ((name = strsep(&p, ",")) != NULL) {
+		name = strim(name);
+		if (!*name)
+			continue;
+
+		type = get_fs_type(name);
+		if (!type)
+			continue;
+		iterate_supers_type(type, vss_collect_sb, &ret);
+		module_put(type->owner);	/* put_filesystem() isn't exported */
+	}
+
+	kfree(names);
+	return ret;
+}
+
+static int vss_freeze_all(void)
+{
+	struct vss_frozen_sb *fsb;
+	s64 slowest = 0;
+	int ret;
+
+	/* The host doesn't send FREEZE twice, but don't leak a snapshot. */
+	vss_thaw_all();
+
+	vss_freeze_start = ktime_get();
+	ret = vss_collect_all();
+
+	list_for_each_entry(fsb, &vss_frozen_sbs, list) {
+		INIT_WORK(&fsb->work, vss_freeze_work);
+		queue_work(system_unbound_wq, &fsb->work);
+	}
+
+	list_for_each_entry(fsb, &vss_frozen_sbs, list) {
+		flush_work(&fsb->work);
+
+		/* Frozen by somebody else; that's as good for the snapshot. */
+		if (fsb->error == -EBUSY)
+			continue;
+
+		if (fsb->error) {
+			pr_err("VSS: failed to freeze %s: %d\n",
+			       fsb->sb->s_id, fsb->error);
+			ret = fsb->error;
+			continue;
+		}
+
+		fsb->frozen = true;
+		slowest = max(slowest, fsb->latency_us);
+	}
+
+	if (ret) {
+		vss_thaw_all();
+		return ret;
+	}
+
+	pr_debug("VSS: filesystems frozen in %lld us, slowest %lld us\n",
+		 ktime_us_delta(ktime_get(), vss_freeze_start), slowest);
+	return 0;
+}
+
+static void vss_handle_kernel_op(void)
+{
+	struct hv_vss_msg *vss_msg = vss_transaction.msg;
+	int error = 0;
+
+	switch (vss_msg->vss_hdr.operation) {
+	case VSS_OP_FREEZE:
+		if (vss_freeze_all())
+			error = HV_E_FAIL;
+		break;
+	case VSS_OP_THAW:
+		vss_thaw_all();
+		break;
+	case VSS_OP_HOT_BACKUP:
+		vss_msg->vss_cf.flags = VSS_HBU_NO_AUTO_RECOVERY;
+		break;
+	}
+
+	vss_respond_to_host(error);
+	hv_poll_channel(vss_transaction.recv_channel, vss_poll_wrapper);
+}
+
 static void vss_handle_request(struct work_struct *dummy)
 {
 	switch (vss_transaction.msg->vss_hdr.operation) {
@@ -220,6 +447,12 @@ static void vss_handle_request(struct work_struct *dummy)
 	case VSS_OP_THAW:
 	case VSS_OP_FREEZE:
 	case VSS_OP_HOT_BACKUP:
+		/* Also thaw in the kernel if the parameter was just cleared. */
+		if (READ_ONCE(vss_kernel_freeze) || !list_empty(&vss_frozen_sbs)) {
+			vss_handle_kernel_op();
+			return;
+		}
+
 		if (vss_transaction.state < HVUTIL_READY) {
 			/* Userspace is not registered yet */
 			pr_debug("VSS: Not ready for request.\n");
@@ -427,6 +660,7 @@ int hv_vss_pre_suspend(void)
 
 	/* Cancel any possible pending work. */
 	hv_vss_cancel_work();
+	vss_thaw_all();
 
 	/* We don't care about the return value. */
 	hvutil_transport_send(hvt, vss_msg, sizeof(*vss_msg), NULL);
@@ -453,6 +687,7 @@ void hv_vss_deinit(void)
 	vss_transaction.state = HVUTIL_DEVICE_DYING;
 
 	hv_vss_cancel_work();
+	vss_thaw_all();
 
 	hvutil_transport_destroy(hvt);
 }
@@ -32,6 +32,10 @@ static ssize_t hvt_op_read(struct file *file, char __user *buf,
 
 	hvt = container_of(file->f_op, struct hvutil_transport, fops);
 
+	if ((file->f_flags & O_NONBLOCK) && hvt->outmsg_len <= 0 &&
+	    hvt->mode == HVUTIL_TRANSPORT_CHARDEV)
+		return -EAGAIN;
+
 	if (wait_event_interruptible(hvt->outmsg_q, hvt->outmsg_len > 0 ||
 				     hvt->mode != HVUTIL_TRANSPORT_CHARDEV))
 		return -EINTR;
@@ -105,12 +109,24 @@ static __poll_t hvt_op_poll(struct file *file, poll_table *wait)
 	if (hvt->mode == HVUTIL_TRANSPORT_DESTROY)
 		return EPOLLERR | EPOLLHUP;
 
-	if (hvt->outmsg_len > 0)
+	if (hvt->outmsg_len > 0 || (hvt->on_poll && hvt->on_poll()))
 		return EPOLLIN | EPOLLRDNORM;
 
 	return 0;
 }
 
+static int hvt_op_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	struct hvutil_transport *hvt;
+
+	hvt = container_of(file->f_op, struct hvutil_transport, fops);
+
+	if (!hvt->on_mmap)
+		return -ENODEV;
+
+	return hvt->on_mmap(vma);
+}
+
 static int hvt_op_open(struct inode *inode, struct file *file)
 {
 	struct hvutil_transport *hvt;
@@ -288,6 +304,7 @@ struct hvutil_transport *hvutil_transport_init(const char *name,
 	hvt->fops.read = hvt_op_read;
 	hvt->fops.write = hvt_op_write;
 	hvt->fops.poll = hvt_op_poll;
+	hvt->fops.mmap = hvt_op_mmap;
 	hvt->fops.open = hvt_op_open;
 	hvt->fops.release = hvt_op_release;
 
@@ -27,6 +27,8 @@ struct hvutil_transport {
 	int (*on_msg)(void *, int);         /* callback on new user message */
 	void (*on_reset)(void);             /* callback when userspace drops */
 	void (*on_read)(void);              /* callback on message read */
+	int (*on_mmap)(struct vm_area_struct *); /* optional, maps shared data */
+	bool (*on_poll)(void);              /* optional, shared data readable */
 	u8 *outmsg;                         /* message to the userspace */
 	int outmsg_len;                     /* its length */
 	wait_queue_head_t outmsg_q;         /* poll/read wait queue */
@@ -183,6 +183,9 @@ int hv_ringbuffer_write(struct vmbus_channel *channel,
 			const struct kvec *kv_list, u32 kv_count,
 			u64 requestid, u64 *trans_id);
 
+int hv_ringbuffer_write_batch(struct vmbus_channel *channel,
+			      struct vmbus_batch_packet *pkts, u32 count);
+
 int hv_ringbuffer_read(struct vmbus_channel *channel,
 		       void *buffer, u32 buflen, u32 *buffer_actual_len,
 		       u64 *requestid, bool raw);
@@ -256,12 +259,26 @@ struct vmbus_connection {
 	/*
 	 * An offer message is handled first on the work_queue, and then
 	 * is further handled on handle_primary_chan_wq or
-	 * handle_sub_chan_wq.
+	 * handle_sub_chan_wq.  Primary channels whose devices don't depend
+	 * on probe order (see vmbus_add_channel_ordered()) are instead added
+	 * on the unbound handle_primary_chan_par_wq, in parallel.
 	 */
 	struct workqueue_struct *work_queue;
 	struct workqueue_struct *handle_primary_chan_wq;
+	struct workqueue_struct *handle_primary_chan_par_wq;
 	struct workqueue_struct *handle_sub_chan_wq;
 
+	/*
+	 * Time from requesting the offers to CHANNELMSG_ALLOFFERS_DELIVERED,
+	 * and to the last primary channel of those offers being added to the
+	 * bus: /sys/bus/vmbus/offers_delivered_ms and devices_ready_ms.
+	 */
+	ktime_t offers_requested;
+	ktime_t offers_delivered;
+	ktime_t devices_ready;
+	atomic_t nr_primary_adds_pending;
+	atomic_t devices_ready_reported;
+
 	/*
 	 * The number of sub-channels and hv_sock channels that should be
 	 * cleaned up upon suspend: sub-channels will be re-created upon
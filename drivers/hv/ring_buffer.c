@@ -93,13 +93,6 @@ hv_get_ring_buffersize(const struct hv_ring_buffer_info *ring_info)
 	return ring_info->ring_datasize;
 }
 
-/* Get the read and write indices as u64 of the specified ring buffer. */
-static inline u64
-hv_get_ring_bufferindices(struct hv_ring_buffer_info *ring_info)
-{
-	return (u64)ring_info->ring_buffer->write_index << 32;
-}
-
 /*
  * Helper routine to copy from source to ring buffer.
  * Assume there is enough room. Handles wrap-around in dest case only!!
@@ -280,38 +273,37 @@ void hv_ringbuffer_cleanup(struct hv_ring_buffer_info *ring_info)
 	ring_info->pkt_buffer_size = 0;
 }
 
-/* Write to the ring buffer. */
-int hv_ringbuffer_write(struct vmbus_channel *channel,
-			const struct kvec *kv_list, u32 kv_count,
-			u64 requestid, u64 *trans_id)
+/*
+ * Copy one packet to the outbound ring at *write_location. Called with the
+ * ring lock held. *bytes_avail is the free space for the packets of this
+ * write. On success, *write_location and *bytes_avail are advanced past the
+ * packet and *rqst_id is the allocated request ID or VMBUS_NO_RQSTOR.
+ */
+static int hv_ringbuffer_put_packet(struct vmbus_channel *channel,
+				    const struct kvec *kv_list, u32 kv_count,
+				    u64 requestid, u64 *trans_id, u64 *rqst_id,
+				    u32 *write_location, u32 *bytes_avail)
 {
 	int i;
-	u32 bytes_avail_towrite;
 	u32 totalbytes_towrite = sizeof(u64);
 	u32 next_write_location;
 	u32 old_write;
 	u64 prev_indices;
-	unsigned long flags;
 	struct hv_ring_buffer_info *outring_info = &channel->outbound;
 	struct vmpacket_descriptor *desc = kv_list[0].iov_base;
-	u64 __trans_id, rqst_id = VMBUS_NO_RQSTOR;
+	u64 __trans_id;
 
-	if (channel->rescind)
-		return -ENODEV;
+	*rqst_id = VMBUS_NO_RQSTOR;
 
 	for (i = 0; i < kv_count; i++)
 		totalbytes_towrite += kv_list[i].iov_len;
 
-	spin_lock_irqsave(&outring_info->ring_lock, flags);
-
-	bytes_avail_towrite = hv_get_bytes_to_write(outring_info);
-
 	/*
 	 * If there is only room for the packet, assume it is full.
 	 * Otherwise, the next time around, we think the ring buffer
 	 * is empty since the read index == write index.
 	 */
-	if (bytes_avail_towrite <= totalbytes_towrite) {
+	if (*bytes_avail <= totalbytes_towrite) {
 		++channel->out_full_total;
 
 		if (!channel->out_full_flag) {
@@ -319,14 +311,13 @@ int hv_ringbuffer_write(struct vmbus_channel *channel,
 			channel->out_full_flag = true;
 		}
 
-		spin_unlock_irqrestore(&outring_info->ring_lock, flags);
 		return -EAGAIN;
 	}
 
 	channel->out_full_flag = false;
 
 	/* Write to the ring buffer */
-	next_write_location = hv_get_next_write_location(outring_info);
+	next_write_location = *write_location;
 
 	old_write = next_write_location;
 
@@ -345,15 +336,16 @@ int hv_ringbuffer_write(struct vmbus_channel *channel,
 
 	if (desc->flags == VMBUS_DATA_PACKET_FLAG_COMPLETION_REQUESTED) {
 		if (channel->next_request_id_callback != NULL) {
-			rqst_id = channel->next_request_id_callback(channel, requestid);
-			if (rqst_id == VMBUS_RQST_ERROR) {
-				spin_unlock_irqrestore(&outring_info->ring_lock, flags);
+			*rqst_id = channel->next_request_id_callback(channel,
+								     requestid);
+			if (*rqst_id == VMBUS_RQST_ERROR) {
+				*rqst_id = VMBUS_NO_RQSTOR;
 				return -EAGAIN;
 			}
 		}
 	}
 	desc = hv_get_ring_buffer(outring_info) + old_write;
-	__trans_id = (rqst_id == VMBUS_NO_RQSTOR) ? requestid : rqst_id;
+	__trans_id = (*rqst_id == VMBUS_NO_RQSTOR) ? requestid : *rqst_id;
 	/*
 	 * Ensure the compiler doesn't generate code that reads the value of
 	 * the transaction ID from the ring buffer, which is shared with the
@@ -364,13 +356,60 @@ int hv_ringbuffer_write(struct vmbus_channel *channel,
 		*trans_id = __trans_id;
 
 	/* Set previous packet start */
-	prev_indices = hv_get_ring_bufferindices(outring_info);
+	prev_indices = (u64)old_write << 32;
 
 	next_write_location = hv_copyto_ringbuffer(outring_info,
 					     next_write_location,
 					     &prev_indices,
 					     sizeof(u64));
 
+	*write_location = next_write_location;
+	*bytes_avail -= totalbytes_towrite;
+	return 0;
+}
+
+/* Reclaim the request ID of a packet, written to a rescinded channel */
+static void hv_ringbuffer_reclaim_rqst_id(struct vmbus_channel *channel,
+					  u64 rqst_id)
+{
+	if (rqst_id != VMBUS_NO_RQSTOR) {
+		/* Reclaim request ID to avoid leak of IDs */
+		if (channel->request_addr_callback != NULL)
+			channel->request_addr_callback(channel, rqst_id);
+	}
+}
+
+/* Write to the ring buffer. */
+int hv_ringbuffer_write(struct vmbus_channel *channel,
+			const struct kvec *kv_list, u32 kv_count,
+			u64 requestid, u64 *trans_id)
+{
+	u32 bytes_avail_towrite;
+	u32 next_write_location;
+	u32 old_write;
+	unsigned long flags;
+	struct hv_ring_buffer_info *outring_info = &channel->outbound;
+	u64 rqst_id;
+	int ret;
+
+	if (channel->rescind)
+		return -ENODEV;
+
+	spin_lock_irqsave(&outring_info->ring_lock, flags);
+
+	bytes_avail_towrite = hv_get_bytes_to_write(outring_info);
+	next_write_location = hv_get_next_write_location(outring_info);
+	old_write = next_write_location;
+
+	ret = hv_ringbuffer_put_packet(channel, kv_list, kv_count, requestid,
+				       trans_id, &rqst_id,
+				       &next_write_location,
+				       &bytes_avail_towrite);
+	if (ret) {
+		spin_unlock_irqrestore(&outring_info->ring_lock, flags);
+		return ret;
+	}
+
 	/* Issue a full memory barrier before updating the write index */
 	virt_mb();
 
@@ -383,17 +422,77 @@ int hv_ringbuffer_write(struct vmbus_channel *channel,
 	hv_signal_on_write(old_write, channel);
 
 	if (channel->rescind) {
-		if (rqst_id != VMBUS_NO_RQSTOR) {
-			/* Reclaim request ID to avoid leak of IDs */
-			if (channel->request_addr_callback != NULL)
-				channel->request_addr_callback(channel, rqst_id);
-		}
+		hv_ringbuffer_reclaim_rqst_id(channel, rqst_id);
 		return -ENODEV;
 	}
 
 	return 0;
 }
 
+/*
+ * Write a batch of packets to the ring buffer. The packets are copied under
+ * one acquisition of the ring lock, the write index is published once and
+ * the host is signaled at most once for the whole batch.
+ *
+ * Returns the number of packets written, which is less than @count if the
+ * ring buffer filled up, or a negative error if no packet was written.
+ */
+int hv_ringbuffer_write_batch(struct vmbus_channel *channel,
+			      struct vmbus_batch_packet *pkts, u32 count)
+{
+	u32 bytes_avail_towrite;
+	u32 next_write_location;
+	u32 old_write;
+	unsigned long flags;
+	struct hv_ring_buffer_info *outring_info = &channel->outbound;
+	int ret = 0;
+	u32 i;
+
+	if (channel->rescind)
+		return -ENODEV;
+
+	spin_lock_irqsave(&outring_info->ring_lock, flags);
+
+	bytes_avail_towrite = hv_get_bytes_to_write(outring_info);
+	next_write_location = hv_get_next_write_location(outring_info);
+	old_write = next_write_location;
+
+	for (i = 0; i < count; i++) {
+		ret = hv_ringbuffer_put_packet(channel, pkts[i].kv,
+					       pkts[i].kv_count,
+					       pkts[i].requestid,
+					       &pkts[i].trans_id,
+					       &pkts[i].rqst_id,
+					       &next_write_location,
+					       &bytes_avail_towrite);
+		if (ret)
+			break;
+	}
+
+	if (i == 0) {
+		spin_unlock_irqrestore(&outring_info->ring_lock, flags);
+		return ret;
+	}
+
+	/* Issue a full memory barrier before updating the write index */
+	virt_mb();
+
+	/* Now, update the write location */
+	hv_set_next_write_location(outring_info, next_write_location);
+
+	spin_unlock_irqrestore(&outring_info->ring_lock, flags);
+
+	hv_signal_on_write(old_write, channel);
+
+	if (channel->rescind) {
+		while (i--)
+			hv_ringbuffer_reclaim_rqst_id(channel, pkts[i].rqst_id);
+		return -ENODEV;
+	}
+
+	return i;
+}
+
 int hv_ringbuffer_read(struct vmbus_channel *channel,
 		       void *buffer, u32 buflen, u32 *buffer_actual_len,
 		       u64 *requestid, bool raw)
@@ -536,6 +635,8 @@ __hv_pkt_iter_next(struct vmbus_channel *channel,
 	u32 dsize = rbi->ring_datasize;
 
 	hv_debug_delay_test(channel, MESSAGE_DELAY);
+	this_cpu_inc(channel->stats->packets_read);
+
 	/* bump offset to next potential packet */
 	rbi->priv_read_index += packetlen + VMBUS_PKT_TRAILER;
 	if (rbi->priv_read_index >= dsize)
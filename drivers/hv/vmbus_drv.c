@@ -671,8 +671,41 @@ static ssize_t hibernation_show(struct bus_type *bus, char *buf)
 
 static BUS_ATTR_RO(hibernation);
 
+/*
+ * Set up the attributes for /sys/bus/vmbus/{offers_delivered,devices_ready}_ms:
+ * milliseconds from requesting the channel offers until all of them were
+ * delivered, and until the devices of all primary channels were added to
+ * the bus; -1 if not there yet.
+ */
+static ssize_t vmbus_offers_time_show(char *buf, ktime_t t)
+{
+	if (!t)
+		return sysfs_emit(buf, "-1\n");
+
+	return sysfs_emit(buf, "%lld\n",
+			  ktime_ms_delta(t, vmbus_connection.offers_requested));
+}
+
+static ssize_t offers_delivered_ms_show(struct bus_type *bus, char *buf)
+{
+	return vmbus_offers_time_show(buf,
+			READ_ONCE(vmbus_connection.offers_delivered));
+}
+
+static BUS_ATTR_RO(offers_delivered_ms);
+
+static ssize_t devices_ready_ms_show(struct bus_type *bus, char *buf)
+{
+	return vmbus_offers_time_show(buf,
+			READ_ONCE(vmbus_connection.devices_ready));
+}
+
+static BUS_ATTR_RO(devices_ready_ms);
+
 static struct attribute *vmbus_bus_attrs[] = {
 	&bus_attr_hibernation.attr,
+	&bus_attr_offers_delivered_ms.attr,
+	&bus_attr_devices_ready_ms.attr,
 	NULL,
 };
 static const struct attribute_group vmbus_bus_group = {
@@ -1066,9 +1099,18 @@ static void vmbus_onmessage_work(struct work_struct *work)
 	kfree(ctx);
 }
 
-void vmbus_on_msg_dpc(unsigned long data)
+/*
+ * Maximum number of messages handled in one vmbus_on_msg_dpc() run, as long
+ * as the hypervisor keeps delivering them into the message slot.
+ */
+#define VMBUS_MSG_DPC_BATCH	32
+
+/*
+ * Handle the message in the SynIC message slot, if any.  Returns false if
+ * there was none, or if it has to be left in the slot for the next run.
+ */
+static bool vmbus_handle_msg(struct hv_per_cpu_context *hv_cpu)
 {
-	struct hv_per_cpu_context *hv_cpu = (void *)data;
 	void *page_addr = hv_cpu->synic_message_page;
 	struct hv_message msg_copy, *msg = (struct hv_message *)page_addr +
 				  VMBUS_MESSAGE_SINT;
@@ -1097,7 +1139,7 @@ void vmbus_on_msg_dpc(unsigned long data)
 	message_type = msg_copy.header.message_type;
 	if (message_type == HVMSG_NONE)
 		/* no msg */
-		return;
+		return false;
 
 	hdr = (struct vmbus_channel_message_header *)msg_copy.u.payload;
 	msgtype = hdr->msgtype;
@@ -1128,7 +1170,7 @@ void vmbus_on_msg_dpc(unsigned long data)
 	if (entry->handler_type	== VMHT_BLOCKING) {
 		ctx = kmalloc(struct_size(ctx, msg.payload, payload_size), GFP_ATOMIC);
 		if (ctx == NULL)
-			return;
+			return false;
 
 		INIT_WORK(&ctx->work, vmbus_onmessage_work);
 		memcpy(&ctx->msg, &msg_copy, sizeof(msg->header) + payload_size);
@@ -1197,6 +1239,23 @@ void vmbus_on_msg_dpc(unsigned long data)
 
 msg_handled:
 	vmbus_signal_eom(msg, message_type);
+	return true;
+}
+
+/*
+ * Signaling EOM makes the hypervisor deliver the next pending message right
+ * away, so keep handling messages rather than taking an interrupt and a
+ * tasklet run for each one; during boot or device hot-add there are lots of
+ * channel offers queued up.
+ */
+void vmbus_on_msg_dpc(unsigned long data)
+{
+	struct hv_per_cpu_context *hv_cpu = (void *)data;
+	int i;
+
+	for (i = 0; i < VMBUS_MSG_DPC_BATCH; i++)
+		if (!vmbus_handle_msg(hv_cpu))
+			break;
 }
 
 #ifdef CONFIG_PM_SLEEP
@@ -1271,7 +1330,7 @@ static void vmbus_chan_sched(struct hv_per_cpu_context *hv_cpu)
 			continue;
 
 		/*
-		 * Pairs with the kfree_rcu() in vmbus_chan_release().
+		 * Pairs with the call_rcu() in vmbus_chan_release().
 		 * Guarantees that the channel data structure doesn't
 		 * get freed while the channel pointer below is being
 		 * dereferenced.
@@ -1301,10 +1360,11 @@ static void vmbus_chan_sched(struct hv_per_cpu_context *hv_cpu)
 
 		trace_vmbus_chan_sched(channel);
 
-		++channel->interrupts;
+		this_cpu_inc(channel->stats->interrupts);
 
 		switch (channel->callback_mode) {
 		case HV_CALL_ISR:
+			this_cpu_inc(channel->stats->callbacks);
 			(*callback_fn)(channel->channel_callback_context);
 			break;
 
@@ -1622,6 +1682,15 @@ void vmbus_driver_unregister(struct hv_driver *hv_driver)
 EXPORT_SYMBOL_GPL(vmbus_driver_unregister);
 
 
+static void vmbus_chan_free_rcu(struct rcu_head *rcu)
+{
+	struct vmbus_channel *channel
+		= container_of(rcu, struct vmbus_channel, rcu);
+
+	free_percpu(channel->stats);
+	kfree(channel);
+}
+
 /*
  * Called when last reference to channel is gone.
  */
@@ -1630,7 +1699,7 @@ static void vmbus_chan_release(struct kobject *kobj)
 	struct vmbus_channel *channel
 		= container_of(kobj, struct vmbus_channel, kobj);
 
-	kfree_rcu(channel, rcu);
+	call_rcu(&channel->rcu, vmbus_chan_free_rcu);
 }
 
 struct vmbus_chan_attribute {
@@ -1877,17 +1946,30 @@ static ssize_t channel_latency_show(struct vmbus_channel *channel,
 }
 static VMBUS_CHAN_ATTR(latency, 0444, channel_latency_show, NULL);
 
-static ssize_t channel_interrupts_show(struct vmbus_channel *channel, char *buf)
+static u64 channel_stat_sum(struct vmbus_channel *channel, size_t offset)
 {
-	return sprintf(buf, "%llu\n", channel->interrupts);
-}
-static VMBUS_CHAN_ATTR(interrupts, 0444, channel_interrupts_show, NULL);
+	u64 sum = 0;
+	int cpu;
 
-static ssize_t channel_events_show(struct vmbus_channel *channel, char *buf)
-{
-	return sprintf(buf, "%llu\n", channel->sig_events);
+	for_each_possible_cpu(cpu)
+		sum += *(u64 *)((void *)per_cpu_ptr(channel->stats, cpu) +
+				offset);
+	return sum;
 }
-static VMBUS_CHAN_ATTR(events, 0444, channel_events_show, NULL);
+
+#define VMBUS_CHAN_STAT_ATTR(_name, _field)				\
+static ssize_t channel_##_name##_show(struct vmbus_channel *channel,	\
+				      char *buf)			\
+{									\
+	return sprintf(buf, "%llu\n", channel_stat_sum(channel,		\
+		       offsetof(struct vmbus_channel_stats, _field)));	\
+}									\
+static VMBUS_CHAN_ATTR(_name, 0444, channel_##_name##_show, NULL)
+
+VMBUS_CHAN_STAT_ATTR(interrupts, interrupts);
+VMBUS_CHAN_STAT_ATTR(events, sig_events);
+VMBUS_CHAN_STAT_ATTR(callbacks, callbacks);
+VMBUS_CHAN_STAT_ATTR(packets_read, packets_read);
 
 static ssize_t channel_intr_in_full_show(struct vmbus_channel *channel,
 					 char *buf)
@@ -1921,6 +2003,74 @@ static ssize_t channel_out_full_total_show(struct vmbus_channel *channel,
 }
 static VMBUS_CHAN_ATTR(out_full_total, 0444, channel_out_full_total_show, NULL);
 
+static ssize_t channel_poll_usecs_show(struct vmbus_channel *channel,
+				       char *buf)
+{
+	return sprintf(buf, "%u\n", READ_ONCE(channel->poll_usecs));
+}
+
+static ssize_t channel_poll_usecs_store(struct vmbus_channel *channel,
+					const char *buf, size_t count)
+{
+	u32 usecs;
+
+	if (kstrtou32(buf, 0, &usecs))
+		return -EINVAL;
+	if (usecs > HV_MAX_POLL_USECS)
+		return -EINVAL;
+
+	set_channel_poll_usecs(channel, usecs);
+	return count;
+}
+static VMBUS_CHAN_ATTR(poll_usecs, 0644, channel_poll_usecs_show,
+		       channel_poll_usecs_store);
+
+static ssize_t channel_poll_hits_show(struct vmbus_channel *channel, char *buf)
+{
+	return sprintf(buf, "%llu\n", channel->poll_hits);
+}
+static VMBUS_CHAN_ATTR(poll_hits, 0444, channel_poll_hits_show, NULL);
+
+static ssize_t channel_poll_misses_show(struct vmbus_channel *channel,
+					char *buf)
+{
+	return sprintf(buf, "%llu\n", channel->poll_misses);
+}
+static VMBUS_CHAN_ATTR(poll_misses, 0444, channel_poll_misses_show, NULL);
+
+static ssize_t channel_ring_size_show(struct vmbus_channel *channel,
+				      char *buf)
+{
+	return sprintf(buf, "%u\n", channel->outbound.ring_size);
+}
+
+static ssize_t channel_ring_size_store(struct vmbus_channel *channel,
+				       const char *buf, size_t count)
+{
+	u32 ring_size;
+	int ret;
+
+	if (kstrtou32(buf, 0, &ring_size))
+		return -EINVAL;
+	if (!ring_size || !PAGE_ALIGNED(ring_size))
+		return -EINVAL;
+
+	/*
+	 * The host has no message to resize an open channel's rings, so the
+	 * owning driver has to close the channel and reopen it on a new GPADL.
+	 */
+	if (!channel->resize_ring_callback)
+		return -EOPNOTSUPP;
+
+	if (ring_size == channel->outbound.ring_size)
+		return count;
+
+	ret = channel->resize_ring_callback(channel, ring_size);
+	return ret ? ret : count;
+}
+static VMBUS_CHAN_ATTR(ring_size, 0644, channel_ring_size_show,
+		       channel_ring_size_store);
+
 static ssize_t subchannel_monitor_id_show(struct vmbus_channel *channel,
 					  char *buf)
 {
@@ -1946,10 +2096,16 @@ static struct attribute *vmbus_chan_attrs[] = {
 	&chan_attr_latency.attr,
 	&chan_attr_interrupts.attr,
 	&chan_attr_events.attr,
+	&chan_attr_callbacks.attr,
+	&chan_attr_packets_read.attr,
 	&chan_attr_intr_in_full.attr,
 	&chan_attr_intr_out_empty.attr,
 	&chan_attr_out_full_first.attr,
 	&chan_attr_out_full_total.attr,
+	&chan_attr_poll_usecs.attr,
+	&chan_attr_poll_hits.attr,
+	&chan_attr_poll_misses.attr,
+	&chan_attr_ring_size.attr,
 	&chan_attr_monitor_id.attr,
 	&chan_attr_subchannel_id.attr,
 	NULL
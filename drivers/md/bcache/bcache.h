@@ -543,7 +543,7 @@ struct cache_set {
 	/* For the btree cache */
 	struct shrinker		shrink;
 
-	/* For the btree cache and anything allocation related */
+	/* For anything allocation related */
 	struct mutex		bucket_lock;
 
 	/* log2(bucket_size), in sectors */
@@ -578,6 +578,13 @@ struct cache_set {
 	struct list_head	btree_cache_freeable;
 	struct list_head	btree_cache_freed;
 
+	/*
+	 * Protects the lists above, btree_cache_used and insertions into and
+	 * removals from bucket_hash, so that btree node cache misses don't
+	 * serialize against bucket allocation.  Nests inside bucket_lock.
+	 */
+	struct mutex		btree_cache_lock;
+
 	/* Number of elements in btree_cache + btree_cache_freeable lists */
 	unsigned int		btree_cache_used;
 
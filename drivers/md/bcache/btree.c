@@ -589,7 +589,7 @@ static int mca_reap(struct btree *b, unsigned int min_order, bool flush)
 	struct closure cl;
 
 	closure_init_stack(&cl);
-	lockdep_assert_held(&b->c->bucket_lock);
+	lockdep_assert_held(&b->c->btree_cache_lock);
 
 	if (!down_write_trylock(&b->lock))
 		return -ENOMEM;
@@ -660,8 +660,8 @@ static unsigned long bch_mca_scan(struct shrinker *shrink,
 
 	/* Return -1 if we can't do anything right now */
 	if (sc->gfp_mask & __GFP_IO)
-		mutex_lock(&c->bucket_lock);
-	else if (!mutex_trylock(&c->bucket_lock))
+		mutex_lock(&c->btree_cache_lock);
+	else if (!mutex_trylock(&c->btree_cache_lock))
 		return -1;
 
 	/*
@@ -706,7 +706,7 @@ static unsigned long bch_mca_scan(struct shrinker *shrink,
 		i++;
 	}
 out:
-	mutex_unlock(&c->bucket_lock);
+	mutex_unlock(&c->btree_cache_lock);
 	return freed * c->btree_pages;
 }
 
@@ -734,7 +734,7 @@ void bch_btree_cache_free(struct cache_set *c)
 	if (c->shrink.list.next)
 		unregister_shrinker(&c->shrink);
 
-	mutex_lock(&c->bucket_lock);
+	mutex_lock(&c->btree_cache_lock);
 
 #ifdef CONFIG_BCACHE_DEBUG
 	if (c->verify_data)
@@ -769,7 +769,7 @@ void bch_btree_cache_free(struct cache_set *c)
 		kfree(b);
 	}
 
-	mutex_unlock(&c->bucket_lock);
+	mutex_unlock(&c->btree_cache_lock);
 }
 
 int bch_btree_cache_alloc(struct cache_set *c)
@@ -902,7 +902,7 @@ static struct btree *mca_alloc(struct cache_set *c, struct btree_op *op,
 
 	BUG_ON(current->bio_list);
 
-	lockdep_assert_held(&c->bucket_lock);
+	lockdep_assert_held(&c->btree_cache_lock);
 
 	if (mca_find(c, k))
 		return NULL;
@@ -990,9 +990,9 @@ struct btree *bch_btree_node_get(struct cache_set *c, struct btree_op *op,
 		if (current->bio_list)
 			return ERR_PTR(-EAGAIN);
 
-		mutex_lock(&c->bucket_lock);
+		mutex_lock(&c->btree_cache_lock);
 		b = mca_alloc(c, op, k, level);
-		mutex_unlock(&c->bucket_lock);
+		mutex_unlock(&c->btree_cache_lock);
 
 		if (!b)
 			goto retry;
@@ -1036,9 +1036,9 @@ static void btree_node_prefetch(struct btree *parent, struct bkey *k)
 {
 	struct btree *b;
 
-	mutex_lock(&parent->c->bucket_lock);
+	mutex_lock(&parent->c->btree_cache_lock);
 	b = mca_alloc(parent->c, NULL, k, parent->level - 1);
-	mutex_unlock(&parent->c->bucket_lock);
+	mutex_unlock(&parent->c->btree_cache_lock);
 
 	if (!IS_ERR_OR_NULL(b)) {
 		b->parent = parent;
@@ -1081,7 +1081,9 @@ static void btree_node_free(struct btree *b)
 
 	mutex_lock(&b->c->bucket_lock);
 	bch_bucket_free(b->c, &b->key);
+	mutex_lock(&b->c->btree_cache_lock);
 	mca_bucket_free(b);
+	mutex_unlock(&b->c->btree_cache_lock);
 	mutex_unlock(&b->c->bucket_lock);
 }
 
@@ -1100,7 +1102,9 @@ struct btree *__bch_btree_node_alloc(struct cache_set *c, struct btree_op *op,
 	bkey_put(c, &k.key);
 	SET_KEY_SIZE(&k.key, c->btree_pages * PAGE_SECTORS);
 
+	mutex_lock(&c->btree_cache_lock);
 	b = mca_alloc(c, op, &k.key, level);
+	mutex_unlock(&c->btree_cache_lock);
 	if (IS_ERR(b))
 		goto err_free;
 
@@ -2481,9 +2485,9 @@ void bch_btree_set_root(struct btree *b)
 	for (i = 0; i < KEY_PTRS(&b->key); i++)
 		BUG_ON(PTR_BUCKET(b->c, &b->key, i)->prio != BTREE_PRIO);
 
-	mutex_lock(&b->c->bucket_lock);
+	mutex_lock(&b->c->btree_cache_lock);
 	list_del_init(&b->list);
-	mutex_unlock(&b->c->bucket_lock);
+	mutex_unlock(&b->c->btree_cache_lock);
 
 	b->c->root = b;
 
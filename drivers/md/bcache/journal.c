@@ -450,7 +450,7 @@ static void btree_flush_write(struct cache_set *c)
 	atomic_long_inc(&c->flush_write);
 	memset(btree_nodes, 0, sizeof(btree_nodes));
 
-	mutex_lock(&c->bucket_lock);
+	mutex_lock(&c->btree_cache_lock);
 	list_for_each_entry_safe_reverse(b, t, &c->btree_cache, list) {
 		/*
 		 * It is safe to get now_fifo_front_p without holding
@@ -515,7 +515,7 @@ static void btree_flush_write(struct cache_set *c)
 
 		btree_nodes[nr++] = b;
 		/*
-		 * To avoid holding c->bucket_lock too long time,
+		 * To avoid holding c->btree_cache_lock too long time,
 		 * only scan for BTREE_FLUSH_NR matched btree nodes
 		 * at most. If there are more btree nodes reference
 		 * the oldest journal entry, try to flush them next
@@ -524,7 +524,7 @@ static void btree_flush_write(struct cache_set *c)
 		if (nr == BTREE_FLUSH_NR)
 			break;
 	}
-	mutex_unlock(&c->bucket_lock);
+	mutex_unlock(&c->btree_cache_lock);
 
 	for (i = 0; i < nr; i++) {
 		b = btree_nodes[i];
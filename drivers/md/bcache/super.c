@@ -1895,6 +1895,7 @@ struct cache_set *bch_cache_set_alloc(struct cache_sb *sb)
 
 	sema_init(&c->sb_write_mutex, 1);
 	mutex_init(&c->bucket_lock);
+	mutex_init(&c->btree_cache_lock);
 	init_waitqueue_head(&c->btree_cache_wait);
 	spin_lock_init(&c->btree_cannibalize_lock);
 	init_waitqueue_head(&c->bucket_wait);
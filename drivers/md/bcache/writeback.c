@@ -440,6 +440,21 @@ static void read_dirty_submit(struct closure *cl)
 	continue_at(cl, write_dirty, io->dc->writeback_write_wq);
 }
 
+/*
+ * Keys come out of the keybuf sorted, so a key that starts at or shortly
+ * after the end of the previous one can go in the same pass: contiguous
+ * keys are merged by the backing device's queue, and short forward seeks are
+ * still cheap when issued together.
+ */
+static bool writeback_keys_close(struct bkey *prev, struct bkey *next)
+{
+	if (KEY_INODE(prev) != KEY_INODE(next))
+		return false;
+
+	return KEY_START(next) >= KEY_OFFSET(prev) &&
+	       KEY_START(next) - KEY_OFFSET(prev) <= MAX_WRITEBACK_GAP_IN_PASS;
+}
+
 static void read_dirty(struct cached_dev *dc)
 {
 	unsigned int delay = 0;
@@ -448,7 +463,9 @@ static void read_dirty(struct cached_dev *dc)
 	int nk, i;
 	struct dirty_io *io;
 	struct closure cl;
+	struct blk_plug plug;
 	uint16_t sequence = 0;
+	size_t max_size;
 
 	BUG_ON(!llist_empty(&dc->writeback_ordering_wait.list));
 	atomic_set(&dc->writeback_sequence_next, sequence);
@@ -467,6 +484,14 @@ static void read_dirty(struct cached_dev *dc)
 		size = 0;
 		nk = 0;
 
+		/*
+		 * When the whole cache set is idle the rate limit is out of
+		 * the way, so use bigger passes to flush at the backing
+		 * device's bandwidth.
+		 */
+		max_size = atomic_read(&dc->disk.c->at_max_writeback_rate) ?
+			   MAX_WRITESIZE_IN_IDLE_PASS : MAX_WRITESIZE_IN_PASS;
+
 		do {
 			BUG_ON(ptr_stale(dc->disk.c, &next->key, 0));
 
@@ -481,27 +506,28 @@ static void read_dirty(struct cached_dev *dc)
 			 * If the current operation is very large, don't
 			 * further combine operations.
 			 */
-			if (size >= MAX_WRITESIZE_IN_PASS)
+			if (size >= max_size)
 				break;
 
 			/*
 			 * Operations are only eligible to be combined
-			 * if they are contiguous.
-			 *
-			 * TODO: add a heuristic willing to fire a
-			 * certain amount of non-contiguous IO per pass,
-			 * so that we can benefit from backing device
-			 * command queueing.
+			 * if they are contiguous or close enough ahead
+			 * of each other on the same backing device.
 			 */
-			if ((nk != 0) && bkey_cmp(&keys[nk-1]->key,
-						&START_KEY(&next->key)))
+			if ((nk != 0) && !writeback_keys_close(&keys[nk-1]->key,
+							      &next->key))
 				break;
 
 			size += KEY_SIZE(&next->key);
 			keys[nk++] = next;
 		} while ((next = bch_keybuf_next(&dc->writeback_keys)));
 
-		/* Now we have gathered a set of 1..5 keys to write back. */
+		/*
+		 * Now we have gathered a set of 1..MAX_WRITEBACKS_IN_PASS
+		 * keys to write back.  Plug so that reads of adjacent keys
+		 * reach the cache device merged.
+		 */
+		blk_start_plug(&plug);
 		for (i = 0; i < nk; i++) {
 			w = keys[i];
 
@@ -535,6 +561,7 @@ static void read_dirty(struct cached_dev *dc)
 			 */
 			closure_call(&io->cl, read_dirty_submit, NULL, &cl);
 		}
+		blk_finish_plug(&plug);
 
 		delay = writeback_delay(dc, size);
 
@@ -550,6 +577,7 @@ static void read_dirty(struct cached_dev *dc)
 err_free:
 		kfree(w->private);
 err:
+		blk_finish_plug(&plug);
 		bch_keybuf_del(&dc->writeback_keys, w);
 	}
 
@@ -8,8 +8,12 @@
 #define CUTOFF_WRITEBACK_MAX		70
 #define CUTOFF_WRITEBACK_SYNC_MAX	90
 
-#define MAX_WRITEBACKS_IN_PASS  5
-#define MAX_WRITESIZE_IN_PASS   5000	/* *512b */
+#define MAX_WRITEBACKS_IN_PASS  32
+#define MAX_WRITESIZE_IN_PASS   8192	/* *512b */
+/* Pass size limit while the cache set is idle and at max writeback rate */
+#define MAX_WRITESIZE_IN_IDLE_PASS	32768	/* *512b */
+/* Largest forward seek between two keys written back in the same pass */
+#define MAX_WRITEBACK_GAP_IN_PASS	2048	/* *512b */
 
 #define WRITEBACK_RATE_UPDATE_SECS_MAX		60
 #define WRITEBACK_RATE_UPDATE_SECS_DEFAULT	5
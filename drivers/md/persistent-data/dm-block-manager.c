@@ -609,6 +609,16 @@ int dm_bm_flush(struct dm_block_manager *bm)
 }
 EXPORT_SYMBOL_GPL(dm_bm_flush);
 
+int dm_bm_flush_async(struct dm_block_manager *bm)
+{
+	if (dm_bm_is_read_only(bm))
+		return -EPERM;
+
+	dm_bufio_write_dirty_buffers_async(bm->bufio);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(dm_bm_flush_async);
+
 void dm_bm_prefetch(struct dm_block_manager *bm, dm_block_t b)
 {
 	dm_bufio_prefetch(bm->bufio, b, 1);
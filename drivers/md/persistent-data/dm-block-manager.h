@@ -107,6 +107,15 @@ void dm_bm_unlock(struct dm_block *b);
  */
 int dm_bm_flush(struct dm_block_manager *bm);
 
+/*
+ * Starts writing out all dirty blocks without waiting for the I/O.  Blocks
+ * that are locked or changed afterwards stay dirty, a later dm_bm_flush()
+ * writes them again and waits for everything.
+ *
+ * This method may block in the allocation of bios.
+ */
+int dm_bm_flush_async(struct dm_block_manager *bm);
+
 /*
  * Request data is prefetched into the cache.
  */
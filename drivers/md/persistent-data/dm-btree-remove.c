@@ -746,7 +746,16 @@ int dm_btree_remove_leaves(struct dm_btree_info *info, dm_block_t root,
 {
 	int r;
 
+	*new_root = root;
 	*nr_removed = 0;
+
+	/*
+	 * Every pass of remove_one() walks down from the root, get the
+	 * whole range in core up front rather than a node at a time. This
+	 * is only a hint, remove_one() reports any real error itself.
+	 */
+	dm_btree_prefetch_range(info, root, first_key, end_key);
+
 	do {
 		r = remove_one(info, root, first_key, end_key, &root, nr_removed);
 		if (!r)
@@ -496,6 +496,112 @@ int dm_btree_lookup_next(struct dm_btree_info *info, dm_block_t root,
 
 EXPORT_SYMBOL_GPL(dm_btree_lookup_next);
 
+/*
+ * Upper bound on the number of nodes per level prefetch_range() will
+ * issue I/O for.
+ */
+#define MAX_PREFETCH_NODES 64
+
+/*
+ * Breadth first walk of the bottom level tree rooted at @root, issuing
+ * prefetches for every node that can hold a key in [key, end_key) one
+ * level at a time.  All the nodes of a level are in flight together, so a
+ * cold range costs roughly one device round trip per level rather than one
+ * per node.
+ */
+static int prefetch_range(struct dm_btree_info *info, dm_block_t root,
+			  uint64_t key, uint64_t end_key)
+{
+	struct dm_block_manager *bm = dm_tm_get_bm(info->tm);
+	dm_block_t *buf, *cur, *next, *tmp;
+	unsigned nr_cur = 1, nr_next, i;
+	int r = 0;
+
+	buf = kmalloc_array(2 * MAX_PREFETCH_NODES, sizeof(*buf), GFP_NOIO);
+	if (!buf)
+		return -ENOMEM;
+	cur = buf;
+	next = buf + MAX_PREFETCH_NODES;
+	cur[0] = root;
+
+	while (nr_cur) {
+		for (i = 0; i < nr_cur; i++)
+			dm_bm_prefetch(bm, cur[i]);
+
+		nr_next = 0;
+		for (i = 0; i < nr_cur; i++) {
+			struct dm_block *node;
+			struct btree_node *n;
+			uint32_t nr_entries;
+			int lo, hi, j;
+
+			r = bn_read_lock(info, cur[i], &node);
+			if (r)
+				goto out;
+
+			n = dm_block_data(node);
+			nr_entries = le32_to_cpu(n->header.nr_entries);
+			if (!(le32_to_cpu(n->header.flags) & INTERNAL_NODE) ||
+			    !nr_entries) {
+				dm_tm_unlock(info->tm, node);
+				continue;
+			}
+
+			lo = max(lower_bound(n, key), 0);
+			hi = clamp(lower_bound(n, end_key - 1), 0,
+				   (int) nr_entries - 1);
+			for (j = lo; j <= hi && nr_next < MAX_PREFETCH_NODES; j++)
+				next[nr_next++] = value64(n, j);
+
+			dm_tm_unlock(info->tm, node);
+		}
+
+		tmp = cur;
+		cur = next;
+		next = tmp;
+		nr_cur = nr_next;
+	}
+out:
+	kfree(buf);
+	return r;
+}
+
+int dm_btree_prefetch_range(struct dm_btree_info *info, dm_block_t root,
+			    uint64_t *keys, uint64_t end_key)
+{
+	unsigned level;
+	int r = 0;
+	uint64_t rkey;
+	__le64 internal_value_le;
+	struct ro_spine spine;
+
+	if (end_key <= keys[info->levels - 1])
+		return 0;
+
+	init_ro_spine(&spine, info);
+	for (level = 0; level < info->levels - 1u; level++) {
+		r = btree_lookup_raw(&spine, root, keys[level],
+				     lower_bound, &rkey,
+				     &internal_value_le, sizeof(uint64_t));
+		if (r)
+			goto out;
+
+		if (rkey != keys[level]) {
+			r = -ENODATA;
+			goto out;
+		}
+
+		root = le64_to_cpu(internal_value_le);
+	}
+	exit_ro_spine(&spine);
+
+	return prefetch_range(info, root, keys[level], end_key);
+out:
+	exit_ro_spine(&spine);
+	return r;
+}
+EXPORT_SYMBOL_GPL(dm_btree_prefetch_range);
+
 /*----------------------------------------------------------------*/
 
 /*
@@ -116,6 +116,17 @@ int dm_btree_lookup(struct dm_btree_info *info, dm_block_t root,
 int dm_btree_lookup_next(struct dm_btree_info *info, dm_block_t root,
 			 uint64_t *keys, uint64_t *rkey, void *value_le);
 
+/*
+ * Start reading in every node of the bottom level tree that may hold a key
+ * in the range [keys, keys2), where keys2 is keys with the final key replaced
+ * with 'end_key'.  Nodes are read a level at a time with all I/O for a level
+ * in flight together, so that subsequent lookups, range walks or removals
+ * over the range find the metadata in core.  Returns -ENODATA if the upper
+ * level keys are not present.
+ */
+int dm_btree_prefetch_range(struct dm_btree_info *info, dm_block_t root,
+			    uint64_t *keys, uint64_t end_key);
+
 /*
  * Insertion (or overwrite an existing value).  O(ln(n))
  */
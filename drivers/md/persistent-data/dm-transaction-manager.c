@@ -211,6 +211,15 @@ int dm_tm_pre_commit(struct dm_transaction_manager *tm)
 	if (tm->is_clone)
 		return -EWOULDBLOCK;
 
+	/*
+	 * Get the btree blocks going while the space maps are committed,
+	 * the flush below then only has to write what that dirtied and
+	 * wait.
+	 */
+	r = dm_bm_flush_async(tm->bm);
+	if (r < 0)
+		return r;
+
 	r = dm_sm_commit(tm->sm);
 	if (r < 0)
 		return r;
@@ -165,6 +165,7 @@ struct hv_netvsc_packet {
 	u32 total_bytes;
 	u32 send_buf_index;
 	u32 total_data_buflen;
+	u8 dma_range_cnt;
 	struct hv_dma_range *dma_range;
 };
 
@@ -177,6 +178,7 @@ struct netvsc_device_info {
 	u32  recv_sections;
 	u32  send_section_size;
 	u32  recv_section_size;
+	u32  ring_bytes;
 
 	struct bpf_prog *bprog;
 
@@ -216,6 +218,7 @@ struct ndis_offload_params;
 struct netvsc_device;
 struct netvsc_channel;
 struct net_device_context;
+struct xsk_buff_pool;
 
 extern u32 netvsc_ring_bytes;
 
@@ -250,6 +253,11 @@ int netvsc_vf_setxdp(struct net_device *vf_netdev, struct bpf_prog *prog);
 int netvsc_bpf(struct net_device *dev, struct netdev_bpf *bpf);
 int netvsc_ndoxdp_xmit(struct net_device *ndev, int n,
 		       struct xdp_frame **frames, u32 flags);
+int netvsc_xsk_attach(struct net_device *ndev, struct netvsc_channel *nvchan,
+		      u16 qid);
+bool netvsc_xsk_xmit(struct net_device *ndev, struct netvsc_channel *nvchan,
+		     int budget);
+int netvsc_xsk_wakeup(struct net_device *ndev, u32 qid, u32 flags);
 
 int rndis_set_subchannel(struct net_device *ndev,
 			 struct netvsc_device *nvdev,
@@ -1057,6 +1065,9 @@ struct net_device_context {
 
 	/* Used to temporarily save the config info across hibernation */
 	struct netvsc_device_info *saved_netvsc_dev_info;
+
+	/* AF_XDP zero-copy pools, kept across netvsc_device re-creation */
+	struct xsk_buff_pool *xsk_pools[VRSS_CHANNEL_MAX];
 };
 
 /* Azure hosts don't support non-TCP port numbers in hashing for fragmented
@@ -1124,6 +1135,10 @@ struct netvsc_channel {
 	struct xdp_rxq_info xdp_rxq;
 	bool xdp_flush;
 
+	/* AF_XDP zero-copy receive/transmit, see netvsc_bpf.c */
+	struct xsk_buff_pool __rcu *xsk_pool;
+	struct xdp_rxq_info xsk_rxq;
+
 	struct netvsc_stats_tx tx_stats;
 	struct netvsc_stats_rx rx_stats;
 };
@@ -1154,6 +1169,9 @@ struct netvsc_device {
 	u32 send_section_size;
 	unsigned long *send_section_map;
 
+	/* Size of each direction of every channel's VMBus ring */
+	u32 ring_bytes;
+
 	/* Used for NetVSP initialization protocol */
 	struct completion channel_init_wait;
 	struct nvsp_message channel_init_pkt;
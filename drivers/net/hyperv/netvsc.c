@@ -169,6 +169,8 @@ static void free_netvsc_device(struct rcu_head *head)
 
 	for (i = 0; i < VRSS_CHANNEL_MAX; i++) {
 		xdp_rxq_info_unreg(&nvdev->chan_table[i].xdp_rxq);
+		if (xdp_rxq_info_is_reg(&nvdev->chan_table[i].xsk_rxq))
+			xdp_rxq_info_unreg(&nvdev->chan_table[i].xsk_rxq);
 		kfree(nvdev->chan_table[i].recv_buf);
 		vfree(nvdev->chan_table[i].mrc.slots);
 	}
@@ -933,11 +935,29 @@ static void netvsc_send_completion(struct net_device *ndev,
 	}
 }
 
-static u32 netvsc_get_next_send_section(struct netvsc_device *net_device)
+static u32 netvsc_get_next_send_section(struct netvsc_device *net_device,
+					u16 q_idx)
 {
 	unsigned long *map_addr = net_device->send_section_map;
+	u32 num_chn = READ_ONCE(net_device->num_chn);
+	u32 chunk, end;
 	unsigned int i;
 
+	/* Each channel first searches its own share of the sections, made of
+	 * whole bitmap words, so that the queues don't keep hitting the same
+	 * words. A channel whose share is used up borrows from the others.
+	 */
+	chunk = num_chn ? net_device->send_section_cnt / num_chn : 0;
+	chunk = round_down(chunk, BITS_PER_LONG);
+	if (chunk && q_idx < num_chn) {
+		i = q_idx * chunk;
+		end = i + chunk;
+		for_each_clear_bit_from(i, map_addr, end) {
+			if (sync_test_and_set_bit(i, map_addr) == 0)
+				return i;
+		}
+	}
+
 	for_each_clear_bit(i, map_addr, net_device->send_section_cnt) {
 		if (sync_test_and_set_bit(i, map_addr) == 0)
 			return i;
@@ -987,9 +1007,6 @@ static void netvsc_copy_to_send_buf(struct netvsc_device *net_device,
 void netvsc_dma_unmap(struct hv_device *hv_dev,
 		      struct hv_netvsc_packet *packet)
 {
-	u32 page_count = packet->cp_partial ?
-		packet->page_buf_cnt - packet->rmsg_pgcnt :
-		packet->page_buf_cnt;
 	int i;
 
 	if (!hv_is_isolation_supported())
@@ -998,7 +1015,7 @@ void netvsc_dma_unmap(struct hv_device *hv_dev,
 	if (!packet->dma_range)
 		return;
 
-	for (i = 0; i < page_count; i++)
+	for (i = 0; i < packet->dma_range_cnt; i++)
 		dma_unmap_single(&hv_dev->device, packet->dma_range[i].dma,
 				 packet->dma_range[i].mapping_size,
 				 DMA_TO_DEVICE);
@@ -1020,9 +1037,14 @@ void netvsc_dma_unmap(struct hv_device *hv_dev,
  * entries in the page buffer array are not necessarily full
  * pages of data.  Each entry in the array has a separate offset and
  * len that may be non-zero, even for entries in the middle of the
- * array.  And the entries are not physically contiguous.  So each
- * entry must be individually mapped rather than as a contiguous unit.
+ * array.  And the entries are not necessarily physically contiguous.
  * So not use dma_map_sg() here.
+ *
+ * Runs of entries which continue the data in the physically following
+ * page (skb heads and compound page frags) are mapped with a single
+ * dma_map_single() call, i.e. a single swiotlb slot search, instead of
+ * one per page. As the device's min_align_mask preserves the offset in
+ * the page, the bounce buffer pages of a run are consecutive as well.
  */
 static int netvsc_dma_map(struct hv_device *hv_dev,
 			  struct hv_netvsc_packet *packet,
@@ -1031,39 +1053,59 @@ static int netvsc_dma_map(struct hv_device *hv_dev,
 	u32 page_count =  packet->cp_partial ?
 		packet->page_buf_cnt - packet->rmsg_pgcnt :
 		packet->page_buf_cnt;
+	size_t max_len = dma_max_mapping_size(&hv_dev->device);
 	dma_addr_t dma;
-	int i;
+	int i, j, k, n = 0;
 
+	packet->dma_range_cnt = 0;
 	if (!hv_is_isolation_supported())
 		return 0;
 
 	packet->dma_range = kcalloc(page_count,
 				    sizeof(*packet->dma_range),
-				    GFP_KERNEL);
+				    GFP_ATOMIC);
 	if (!packet->dma_range)
 		return -ENOMEM;
 
-	for (i = 0; i < page_count; i++) {
+	for (i = 0; i < page_count; i = j) {
 		char *src = phys_to_virt((pb[i].pfn << HV_HYP_PAGE_SHIFT)
 					 + pb[i].offset);
 		u32 len = pb[i].len;
 
+		for (j = i + 1; j < page_count; j++) {
+			if (pb[j - 1].offset + pb[j - 1].len != HV_HYP_PAGE_SIZE ||
+			    pb[j].offset || pb[j].pfn != pb[j - 1].pfn + 1 ||
+			    len + pb[j].len > max_len)
+				break;
+			len += pb[j].len;
+		}
+
 		dma = dma_map_single(&hv_dev->device, src, len,
 				     DMA_TO_DEVICE);
-		if (dma_mapping_error(&hv_dev->device, dma)) {
-			kfree(packet->dma_range);
-			return -ENOMEM;
-		}
+		if (dma_mapping_error(&hv_dev->device, dma))
+			goto unmap;
 
 		/* pb[].offset and pb[].len are not changed during dma mapping
 		 * and so not reassign.
 		 */
-		packet->dma_range[i].dma = dma;
-		packet->dma_range[i].mapping_size = len;
-		pb[i].pfn = dma >> HV_HYP_PAGE_SHIFT;
+		packet->dma_range[n].dma = dma;
+		packet->dma_range[n].mapping_size = len;
+		n++;
+		for (k = i; k < j; k++)
+			pb[k].pfn = (dma >> HV_HYP_PAGE_SHIFT) + (k - i);
 	}
 
+	packet->dma_range_cnt = n;
 	return 0;
+
+unmap:
+	while (n--)
+		dma_unmap_single(&hv_dev->device, packet->dma_range[n].dma,
+				 packet->dma_range[n].mapping_size,
+				 DMA_TO_DEVICE);
+	kfree(packet->dma_range);
+	packet->dma_range = NULL;
+	return -ENOMEM;
 }
 
 static inline int netvsc_send_pkt(
@@ -1246,7 +1288,8 @@ int netvsc_send(struct net_device *ndev,
 
 	} else if (pktlen + net_device->pkt_align <
 		   net_device->send_section_size) {
-		section_index = netvsc_get_next_send_section(net_device);
+		section_index = netvsc_get_next_send_section(net_device,
+							     packet->q_idx);
 		if (unlikely(section_index == NETVSC_INVALID_INDEX)) {
 			++ndev_ctx->eth_stats.tx_send_full;
 		} else {
@@ -1682,6 +1725,11 @@ int netvsc_poll(struct napi_struct *napi, int budget)
 	if (nvchan->xdp_flush)
 		xdp_do_flush();
 
+	/* Keep polling while the AF_XDP TX ring has more to send */
+	if (rcu_access_pointer(nvchan->xsk_pool) &&
+	    netvsc_xsk_xmit(ndev, nvchan, budget))
+		work_done = budget;
+
 	/* Send any pending receive completions */
 	ret = send_recv_completions(ndev, net_device, nvchan);
 
@@ -1742,6 +1790,8 @@ struct netvsc_device *netvsc_device_add(struct hv_device *device,
 	for (i = 0; i < VRSS_SEND_TAB_SIZE; i++)
 		net_device_ctx->tx_table[i] = 0;
 
+	net_device->ring_bytes = device_info->ring_bytes;
+
 	/* Because the device uses NAPI, all the interrupt batching and
 	 * control is done via Net softirq, not the channel handling
 	 */
@@ -1776,6 +1826,13 @@ struct netvsc_device *netvsc_device_add(struct hv_device *device,
 			netdev_err(ndev, "xdp reg_mem_model fail: %d\n", ret);
 			goto cleanup2;
 		}
+
+		ret = netvsc_xsk_attach(ndev, nvchan, i);
+
+		if (ret) {
+			netdev_err(ndev, "xsk pool attach fail: %d\n", ret);
+			goto cleanup2;
+		}
 	}
 
 	/* Enable NAPI handler before init callbacks */
@@ -1785,11 +1842,12 @@ struct netvsc_device *netvsc_device_add(struct hv_device *device,
 	/* Open the channel */
 	device->channel->next_request_id_callback = vmbus_next_request_id;
 	device->channel->request_addr_callback = vmbus_request_addr;
-	device->channel->rqstor_size = netvsc_rqstor_size(netvsc_ring_bytes);
+	device->channel->rqstor_size =
+		netvsc_rqstor_size(net_device->ring_bytes);
 	device->channel->max_pkt_size = NETVSC_MAX_PKT_SIZE;
 
-	ret = vmbus_open(device->channel, netvsc_ring_bytes,
-			 netvsc_ring_bytes,  NULL, 0,
+	ret = vmbus_open(device->channel, net_device->ring_bytes,
+			 net_device->ring_bytes,  NULL, 0,
 			 netvsc_channel_cb, net_device->chan_table);
 
 	if (ret != 0) {
@@ -15,15 +15,111 @@
 #include <linux/bpf_trace.h>
 #include <linux/kernel.h>
 #include <net/xdp.h>
+#include <net/xdp_sock_drv.h>
 
 #include <linux/mutex.h>
 #include <linux/rtnetlink.h>
 
 #include "hyperv_net.h"
 
+/* Run the XDP program on a frame copied straight into an AF_XDP buffer. The
+ * host writes the frames into the receive buffer shared with it, so that
+ * copy can't be avoided, but XDP_REDIRECT to the socket bound on this queue
+ * then needs no further copy. On XDP_PASS and XDP_TX the frame is moved to
+ * a page in @xdp, as netvsc_run_xdp() would have left it.
+ */
+static u32 netvsc_run_xdp_xsk(struct net_device *ndev,
+			      struct netvsc_channel *nvchan,
+			      struct xsk_buff_pool *pool,
+			      struct bpf_prog *prog, struct xdp_buff *xdp)
+{
+	struct netvsc_stats_rx *rx_stats = &nvchan->rx_stats;
+	void *data = nvchan->rsc.data[0];
+	u32 len = nvchan->rsc.len[0];
+	struct xdp_buff *xsk_xdp;
+	struct page *page;
+	u32 act;
+
+	if (len > xsk_pool_get_rx_frame_size(pool))
+		return XDP_DROP;
+
+	xsk_xdp = xsk_buff_alloc(pool);
+	if (!xsk_xdp) {
+		/* The fill ring is empty, ask the user to refill it */
+		if (xsk_uses_need_wakeup(pool))
+			xsk_set_rx_need_wakeup(pool);
+		return XDP_DROP;
+	}
+
+	if (xsk_uses_need_wakeup(pool))
+		xsk_clear_rx_need_wakeup(pool);
+
+	xsk_xdp->data_end = xsk_xdp->data + len;
+	memcpy(xsk_xdp->data, data, len);
+
+	act = bpf_prog_run_xdp(prog, xsk_xdp);
+
+	switch (act) {
+	case XDP_PASS:
+	case XDP_TX:
+		len = xsk_xdp->data_end - xsk_xdp->data;
+		if (NETVSC_XDP_HDRM + netvsc_xdp_fraglen(len) > PAGE_SIZE) {
+			act = XDP_DROP;
+			break;
+		}
+
+		page = alloc_page(GFP_ATOMIC);
+		if (!page) {
+			act = XDP_DROP;
+			break;
+		}
+
+		xdp_init_buff(xdp, PAGE_SIZE, &nvchan->xdp_rxq);
+		xdp_prepare_buff(xdp, page_address(page), NETVSC_XDP_HDRM, len,
+				 false);
+		memcpy(xdp->data, xsk_xdp->data, len);
+		break;
+
+	case XDP_DROP:
+		break;
+
+	case XDP_REDIRECT:
+		if (!xdp_do_redirect(ndev, xsk_xdp, prog)) {
+			nvchan->xdp_flush = true;
+
+			u64_stats_update_begin(&rx_stats->syncp);
+
+			rx_stats->xdp_redirect++;
+			rx_stats->packets++;
+			rx_stats->bytes += nvchan->rsc.pktlen;
+
+			u64_stats_update_end(&rx_stats->syncp);
+
+			return act;
+		}
+
+		u64_stats_update_begin(&rx_stats->syncp);
+		rx_stats->xdp_drop++;
+		u64_stats_update_end(&rx_stats->syncp);
+
+		fallthrough;
+
+	case XDP_ABORTED:
+		trace_xdp_exception(ndev, prog, act);
+		break;
+
+	default:
+		bpf_warn_invalid_xdp_action(ndev, prog, act);
+	}
+
+	xsk_buff_free(xsk_xdp);
+	return act;
+}
+
 u32 netvsc_run_xdp(struct net_device *ndev, struct netvsc_channel *nvchan,
 		   struct xdp_buff *xdp)
 {
+	struct xsk_buff_pool *pool;
 	struct netvsc_stats_rx *rx_stats = &nvchan->rx_stats;
 	void *data = nvchan->rsc.data[0];
 	u32 len = nvchan->rsc.len[0];
@@ -46,6 +142,12 @@ u32 netvsc_run_xdp(struct net_device *ndev, struct netvsc_channel *nvchan,
 		goto out;
 	}
 
+	pool = rcu_dereference(nvchan->xsk_pool);
+	if (pool) {
+		act = netvsc_run_xdp_xsk(ndev, nvchan, pool, prog, xdp);
+		goto out;
+	}
+
 	/* allocate page buffer for data */
 	page = alloc_page(GFP_ATOMIC);
 	if (!page) {
@@ -191,6 +293,97 @@ int netvsc_vf_setxdp(struct net_device *vf_netdev, struct bpf_prog *prog)
 	return ret;
 }
 
+/* Start using @pool for the channel @qid of a (re-)created netvsc_device */
+int netvsc_xsk_attach(struct net_device *ndev, struct netvsc_channel *nvchan,
+		      u16 qid)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(ndev);
+	struct xsk_buff_pool *pool = ndev_ctx->xsk_pools[qid];
+	int ret;
+
+	if (!pool)
+		return 0;
+
+	ret = xdp_rxq_info_reg(&nvchan->xsk_rxq, ndev, qid, 0);
+	if (ret)
+		return ret;
+
+	ret = xdp_rxq_info_reg_mem_model(&nvchan->xsk_rxq,
+					 MEM_TYPE_XSK_BUFF_POOL, NULL);
+	if (ret) {
+		xdp_rxq_info_unreg(&nvchan->xsk_rxq);
+		return ret;
+	}
+
+	xsk_pool_set_rxq_info(pool, &nvchan->xsk_rxq);
+	rcu_assign_pointer(nvchan->xsk_pool, pool);
+	return 0;
+}
+
+static void netvsc_xsk_detach(struct netvsc_channel *nvchan)
+{
+	if (!rtnl_dereference(nvchan->xsk_pool))
+		return;
+
+	RCU_INIT_POINTER(nvchan->xsk_pool, NULL);
+
+	/* Wait for NAPI to stop using the pool */
+	synchronize_net();
+
+	xdp_rxq_info_unreg(&nvchan->xsk_rxq);
+}
+
+static int netvsc_xsk_setup_pool(struct net_device *dev,
+				 struct netvsc_device *nvdev,
+				 struct xsk_buff_pool *pool, u16 qid)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(dev);
+	struct device *dma_dev = &ndev_ctx->device_ctx->device;
+	struct xsk_buff_pool *old_pool;
+	int ret;
+
+	if (qid >= VRSS_CHANNEL_MAX)
+		return -EINVAL;
+
+	old_pool = ndev_ctx->xsk_pools[qid];
+
+	if (!pool) {
+		if (!old_pool)
+			return 0;
+
+		if (nvdev)
+			netvsc_xsk_detach(&nvdev->chan_table[qid]);
+
+		ndev_ctx->xsk_pools[qid] = NULL;
+		xsk_pool_dma_unmap(old_pool, DMA_ATTR_SKIP_CPU_SYNC);
+		return 0;
+	}
+
+	if (!nvdev || nvdev->destroy)
+		return -ENODEV;
+
+	if (qid >= nvdev->num_chn)
+		return -EINVAL;
+
+	if (old_pool)
+		return -EBUSY;
+
+	/* The CPU fills the buffers, the mapping is never used by a device */
+	ret = xsk_pool_dma_map(pool, dma_dev, DMA_ATTR_SKIP_CPU_SYNC);
+	if (ret)
+		return ret;
+
+	ndev_ctx->xsk_pools[qid] = pool;
+
+	ret = netvsc_xsk_attach(dev, &nvdev->chan_table[qid], qid);
+	if (ret) {
+		ndev_ctx->xsk_pools[qid] = NULL;
+		xsk_pool_dma_unmap(pool, DMA_ATTR_SKIP_CPU_SYNC);
+	}
+
+	return ret;
+}
+
 int netvsc_bpf(struct net_device *dev, struct netdev_bpf *bpf)
 {
 	struct net_device_context *ndevctx = netdev_priv(dev);
@@ -199,6 +392,11 @@ int netvsc_bpf(struct net_device *dev, struct netdev_bpf *bpf)
 	struct netlink_ext_ack *extack = bpf->extack;
 	int ret;
 
+	/* The pool must be released even if the device has gone */
+	if (bpf->command == XDP_SETUP_XSK_POOL)
+		return netvsc_xsk_setup_pool(dev, nvdev, bpf->xsk.pool,
+					     bpf->xsk.queue_id);
+
 	if (!nvdev || nvdev->destroy) {
 		return -ENODEV;
 	}
@@ -290,3 +488,97 @@ int netvsc_ndoxdp_xmit(struct net_device *ndev, int n,
 
 	return count;
 }
+
+/* Send the frames queued on the AF_XDP TX ring of the channel. The frames are
+ * copied as they are sent, so they complete right away. Returns true if the
+ * budget ran out before the TX ring was drained.
+ */
+bool netvsc_xsk_xmit(struct net_device *ndev, struct netvsc_channel *nvchan,
+		     int budget)
+{
+	u16 q_idx = nvchan->channel->offermsg.offer.sub_channel_index;
+	struct netvsc_stats_tx *tx_stats = &nvchan->tx_stats;
+	struct xsk_buff_pool *pool;
+	struct xdp_desc desc;
+	struct sk_buff *skb;
+	int sent = 0;
+
+	rcu_read_lock();
+	pool = rcu_dereference(nvchan->xsk_pool);
+	if (!pool)
+		goto out;
+
+	while (sent < budget && xsk_tx_peek_desc(pool, &desc)) {
+		sent++;
+
+		if (unlikely(desc.len < ETH_HLEN))
+			continue;
+
+		skb = napi_alloc_skb(&nvchan->napi, desc.len);
+		if (unlikely(!skb)) {
+			ndev->stats.tx_dropped++;
+			continue;
+		}
+
+		skb_put_data(skb, xsk_buff_raw_get_data(pool, desc.addr),
+			     desc.len);
+		skb->protocol = eth_type_trans(skb, ndev);
+
+		netvsc_get_hash(skb, netdev_priv(ndev));
+		skb_record_rx_queue(skb, q_idx);
+		netvsc_xdp_xmit(skb, ndev);
+	}
+
+	if (sent) {
+		xsk_tx_release(pool);
+		xsk_tx_completed(pool, sent);
+
+		u64_stats_update_begin(&tx_stats->syncp);
+		tx_stats->xdp_xmit += sent;
+		u64_stats_update_end(&tx_stats->syncp);
+	}
+
+	/* NAPI polls again while the budget runs out, so only ask for a
+	 * wakeup once the TX ring is drained.
+	 */
+	if (xsk_uses_need_wakeup(pool) && sent < budget)
+		xsk_set_tx_need_wakeup(pool);
+out:
+	rcu_read_unlock();
+	return sent == budget;
+}
+
+int netvsc_xsk_wakeup(struct net_device *ndev, u32 qid, u32 flags)
+{
+	struct net_device_context *ndev_ctx = netdev_priv(ndev);
+	struct netvsc_channel *nvchan;
+	struct netvsc_device *nvdev;
+	int ret = 0;
+
+	rcu_read_lock();
+	nvdev = rcu_dereference(ndev_ctx->nvdev);
+	if (!nvdev || nvdev->destroy) {
+		ret = -ENETDOWN;
+		goto out;
+	}
+
+	if (qid >= nvdev->num_chn) {
+		ret = -EINVAL;
+		goto out;
+	}
+
+	nvchan = &nvdev->chan_table[qid];
+	if (!rcu_access_pointer(nvchan->xsk_pool)) {
+		ret = -ENXIO;
+		goto out;
+	}
+
+	/* Both the RX refill and the TX ring are handled by netvsc_poll() */
+	if (napi_schedule_prep(&nvchan->napi)) {
+		hv_begin_read(&nvchan->channel->inbound);
+		__napi_schedule(&nvchan->napi);
+	}
+out:
+	rcu_read_unlock();
+	return ret;
+}
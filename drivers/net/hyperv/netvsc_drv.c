@@ -778,6 +778,83 @@ static void netvsc_comp_ipcsum(struct sk_buff *skb)
 	iph->check = ip_fast_csum(iph, iph->ihl);
 }
 
+/* Received packets longer than NETVSC_RX_COPYBREAK, i.e. jumbo frames and
+ * RSC coalesced segments, get NETVSC_RX_HDR_LEN bytes in the linear area and
+ * the rest in page fragments, instead of one large linear buffer.
+ */
+#define NETVSC_RX_COPYBREAK	2048
+#define NETVSC_RX_HDR_LEN	256
+
+/* Copy the RSC fragments of a large packet into order-0 pages. This avoids
+ * high order allocations for the skb head, and lets GRO merge the resulting
+ * skbs by moving their page fragments instead of chaining them on frag_list.
+ * Returns NULL if the packet needs more than MAX_SKB_FRAGS pages, or on
+ * allocation failure.
+ */
+static struct sk_buff *netvsc_alloc_frag_skb(struct napi_struct *napi,
+					     const struct nvsc_rsc *rsc)
+{
+	u32 hlen = min_t(u32, rsc->len[0], NETVSC_RX_HDR_LEN);
+	struct page *page = NULL;
+	struct sk_buff *skb;
+	u32 page_off = 0;
+	u32 len, copy, i;
+	const char *src;
+
+	skb = napi_alloc_skb(napi, NETVSC_RX_HDR_LEN);
+	if (!skb)
+		return NULL;
+
+	skb_put_data(skb, rsc->data[0], hlen);
+
+	for (i = 0; i < rsc->cnt; i++) {
+		src = rsc->data[i];
+		len = rsc->len[i];
+		if (i == 0) {
+			src += hlen;
+			len -= hlen;
+		}
+
+		while (len) {
+			if (!page) {
+				if (skb_shinfo(skb)->nr_frags == MAX_SKB_FRAGS)
+					goto err;
+
+				page = dev_alloc_page();
+				if (!page)
+					goto err;
+
+				page_off = 0;
+			}
+
+			copy = min_t(u32, len, PAGE_SIZE - page_off);
+			memcpy(page_address(page) + page_off, src, copy);
+
+			if (page_off == 0)
+				skb_add_rx_frag(skb, skb_shinfo(skb)->nr_frags,
+						page, 0, copy, PAGE_SIZE);
+			else
+				skb_coalesce_rx_frag(skb,
+						     skb_shinfo(skb)->nr_frags - 1,
+						     copy, 0);
+
+			page_off += copy;
+			src += copy;
+			len -= copy;
+
+			if (page_off == PAGE_SIZE)
+				page = NULL;
+		}
+	}
+
+	return skb;
+
+err:
+	/* The pages already added are released with the skb */
+	dev_kfree_skb_any(skb);
+	return NULL;
+}
+
 static struct sk_buff *netvsc_alloc_recv_skb(struct net_device *net,
 					     struct netvsc_channel *nvchan,
 					     struct xdp_buff *xdp)
@@ -808,17 +885,24 @@ static struct sk_buff *netvsc_alloc_recv_skb(struct net_device *net,
 		skb_put(skb, xlen);
 		skb->dev = napi->dev;
 	} else {
-		skb = napi_alloc_skb(napi, nvchan->rsc.pktlen);
-
-		if (!skb)
-			return NULL;
+		skb = NULL;
+		if (nvchan->rsc.pktlen > NETVSC_RX_COPYBREAK)
+			skb = netvsc_alloc_frag_skb(napi, &nvchan->rsc);
 
-		/* Copy to skb. This copy is needed here since the memory
-		 * pointed by hv_netvsc_packet cannot be deallocated.
-		 */
-		for (i = 0; i < nvchan->rsc.cnt; i++)
-			skb_put_data(skb, nvchan->rsc.data[i],
-				     nvchan->rsc.len[i]);
+		if (!skb) {
+			skb = napi_alloc_skb(napi, nvchan->rsc.pktlen);
+
+			if (!skb)
+				return NULL;
+
+			/* Copy to skb. This copy is needed here since the
+			 * memory pointed by hv_netvsc_packet cannot be
+			 * deallocated.
+			 */
+			for (i = 0; i < nvchan->rsc.cnt; i++)
+				skb_put_data(skb, nvchan->rsc.data[i],
+					     nvchan->rsc.len[i]);
+		}
 	}
 
 	skb->protocol = eth_type_trans(skb, net);
@@ -973,6 +1057,7 @@ struct netvsc_device_info *netvsc_devinfo_get(struct netvsc_device *nvdev)
 		dev_info->send_section_size = nvdev->send_section_size;
 		dev_info->recv_sections = nvdev->recv_section_cnt;
 		dev_info->recv_section_size = nvdev->recv_section_size;
+		dev_info->ring_bytes = nvdev->ring_bytes;
 
 		memcpy(dev_info->rss_key, nvdev->extension->rss_key,
 		       NETVSC_HASH_KEYLEN);
@@ -988,6 +1073,7 @@ struct netvsc_device_info *netvsc_devinfo_get(struct netvsc_device *nvdev)
 		dev_info->send_section_size = NETVSC_SEND_SECTION_SIZE;
 		dev_info->recv_sections = NETVSC_DEFAULT_RX;
 		dev_info->recv_section_size = NETVSC_RECV_SECTION_SIZE;
+		dev_info->ring_bytes = netvsc_ring_bytes;
 	}
 
 	return dev_info;
@@ -1898,6 +1984,76 @@ static int netvsc_set_ringparam(struct net_device *ndev,
 	return ret;
 }
 
+/* Invoked through the "ring_size" sysfs attribute of the primary channel,
+ * the only channel the callback is installed on; writes to a sub-channel's
+ * attribute fail with -EOPNOTSUPP.  The size is kept in the netvsc device
+ * and netvsc_attach() opens the sub-channels with it as well.
+ */
+static int netvsc_resize_ring(struct vmbus_channel *channel, u32 ring_size)
+{
+	struct hv_device *hdev = channel->device_obj;
+	struct netvsc_device_info *device_info;
+	struct net_device_context *ndevctx;
+	struct netvsc_device *nvdev;
+	struct net_device *ndev;
+	u32 orig;
+	int ret;
+
+	if (ring_size < RING_SIZE_MIN * PAGE_SIZE)
+		return -EINVAL;
+
+	/* Don't block on RTNL here: channel teardown drains sysfs writers
+	 * while RTNL may already be held.
+	 */
+	if (!rtnl_trylock())
+		return restart_syscall();
+
+	ndev = hv_get_drvdata(hdev);
+	if (!ndev || !channel->resize_ring_callback) {
+		ret = -ENODEV;
+		goto unlock;
+	}
+
+	ndevctx = netdev_priv(ndev);
+	nvdev = rtnl_dereference(ndevctx->nvdev);
+	if (!nvdev || nvdev->destroy) {
+		ret = -ENODEV;
+		goto unlock;
+	}
+
+	orig = nvdev->ring_bytes;
+	if (ring_size == orig) {
+		ret = 0;
+		goto unlock;
+	}
+
+	device_info = netvsc_devinfo_get(nvdev);
+	if (!device_info) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+	device_info->ring_bytes = ring_size;
+
+	ret = netvsc_detach(ndev, nvdev);
+	if (ret)
+		goto out;
+
+	ret = netvsc_attach(ndev, device_info);
+	if (ret) {
+		device_info->ring_bytes = orig;
+
+		if (netvsc_attach(ndev, device_info))
+			netdev_err(ndev, "restoring ring size failed");
+	}
+
+out:
+	netvsc_devinfo_put(device_info);
+unlock:
+	rtnl_unlock();
+	return ret;
+}
+
 static netdev_features_t netvsc_fix_features(struct net_device *ndev,
 					     netdev_features_t features)
 {
@@ -2029,6 +2185,7 @@ static const struct net_device_ops device_ops = {
 	.ndo_get_stats64 =		netvsc_get_stats64,
 	.ndo_bpf =			netvsc_bpf,
 	.ndo_xdp_xmit =			netvsc_ndoxdp_xmit,
+	.ndo_xsk_wakeup =		netvsc_xsk_wakeup,
 };
 
 /*
@@ -2476,6 +2633,7 @@ static int netvsc_probe(struct hv_device *dev,
 			   net_device_ctx->msg_enable);
 
 	hv_set_drvdata(dev, net);
+	dev->channel->resize_ring_callback = netvsc_resize_ring;
 
 	INIT_DELAYED_WORK(&net_device_ctx->dwork, netvsc_link_change);
 
@@ -2569,6 +2727,7 @@ static int netvsc_probe(struct hv_device *dev,
 devinfo_failed:
 	free_percpu(net_device_ctx->vf_stats);
 no_stats:
+	dev->channel->resize_ring_callback = NULL;
 	hv_set_drvdata(dev, NULL);
 	free_netdev(net);
 no_net:
@@ -2611,6 +2770,7 @@ static int netvsc_remove(struct hv_device *dev)
 
 	unregister_netdevice(net);
 	list_del(&ndev_ctx->list);
+	dev->channel->resize_ring_callback = NULL;
 
 	rtnl_unlock();
 
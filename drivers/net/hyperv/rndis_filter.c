@@ -1261,11 +1261,11 @@ static void netvsc_sc_open(struct vmbus_channel *new_sc)
 
 	new_sc->next_request_id_callback = vmbus_next_request_id;
 	new_sc->request_addr_callback = vmbus_request_addr;
-	new_sc->rqstor_size = netvsc_rqstor_size(netvsc_ring_bytes);
+	new_sc->rqstor_size = netvsc_rqstor_size(nvscdev->ring_bytes);
 	new_sc->max_pkt_size = NETVSC_MAX_PKT_SIZE;
 
-	ret = vmbus_open(new_sc, netvsc_ring_bytes,
-			 netvsc_ring_bytes, NULL, 0,
+	ret = vmbus_open(new_sc, nvscdev->ring_bytes,
+			 nvscdev->ring_bytes, NULL, 0,
 			 netvsc_channel_cb, nvchan);
 	if (ret == 0)
 		napi_enable(&nvchan->napi);
@@ -150,6 +150,7 @@ struct nvmet_port {
 	int				inline_data_size;
 	const struct nvmet_fabrics_ops	*tr_ops;
 	bool				pi_enable;
+	int				poll_threads;
 };
 
 static inline struct nvmet_port *to_nvmet_port(struct config_item *item)
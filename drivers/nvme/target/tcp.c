@@ -13,6 +13,10 @@
 #include <net/tcp.h>
 #include <linux/inet.h>
 #include <linux/llist.h>
+#include <linux/kthread.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <net/busy_poll.h>
 #include <crypto/hash.h>
 
 #include "nvmet.h"
@@ -43,6 +47,12 @@ MODULE_PARM_DESC(idle_poll_period_usecs,
 #define NVMET_TCP_SEND_BUDGET		8
 #define NVMET_TCP_IO_WORK_BUDGET	64
 
+/*
+ * How long a polling thread keeps spinning over its queues without finding
+ * any work before it goes to sleep and waits for a socket callback.
+ */
+#define NVMET_TCP_POLL_IDLE_USECS	1000
+
 enum nvmet_tcp_send_state {
 	NVMET_TCP_SEND_DATA_PDU,
 	NVMET_TCP_SEND_DATA,
@@ -131,6 +141,10 @@ struct nvmet_tcp_queue {
 
 	unsigned long           poll_end;
 
+	/* set when the queue is driven by a port polling thread */
+	struct nvmet_tcp_poller	*poller;
+	struct list_head	poll_entry;
+
 	spinlock_t		state_lock;
 	enum nvmet_tcp_queue_state state;
 
@@ -150,12 +164,49 @@ struct nvmet_tcp_queue {
 	void (*write_space)(struct sock *);
 };
 
+struct nvmet_tcp_poll_stats {
+	u64			loops;
+	u64			idle_sleeps;
+	u64			wakeups;
+	u64			wakeup_ns;
+	u64			busy_poll_ns;
+	u64			recv_ops;
+	u64			recv_ns;
+	u64			send_ops;
+	u64			send_ns;
+};
+
+enum {
+	NVMET_TCP_POLLER_KICKED = 0,
+};
+
+/*
+ * A polling thread services several queues of a port directly, spinning over
+ * their sockets (and the NAPI contexts behind them) instead of bouncing every
+ * socket callback through nvmet_tcp_wq.
+ */
+struct nvmet_tcp_poller {
+	struct task_struct	*task;
+	spinlock_t		lock;	/* protects queues */
+	struct list_head	queues;
+	int			nr_queues;
+	struct nvmet_tcp_queue	*cur;
+	wait_queue_head_t	wait;
+	unsigned long		flags;
+	u64			kick_time;
+	struct nvmet_tcp_poll_stats stats;
+};
+
 struct nvmet_tcp_port {
 	struct socket		*sock;
 	struct work_struct	accept_work;
 	struct nvmet_port	*nport;
 	struct sockaddr_storage addr;
 	void (*data_ready)(struct sock *);
+
+	int			nr_pollers;
+	struct nvmet_tcp_poller	*pollers;
+	struct dentry		*debugfs;
 };
 
 static DEFINE_IDA(nvmet_tcp_queue_ida);
@@ -163,6 +214,7 @@ static LIST_HEAD(nvmet_tcp_queue_list);
 static DEFINE_MUTEX(nvmet_tcp_queue_mutex);
 
 static struct workqueue_struct *nvmet_tcp_wq;
+static struct dentry *nvmet_tcp_debugfs;
 static const struct nvmet_fabrics_ops nvmet_tcp_ops;
 static void nvmet_tcp_free_cmd(struct nvmet_tcp_cmd *c);
 static void nvmet_tcp_finish_cmd(struct nvmet_tcp_cmd *cmd);
@@ -236,6 +288,23 @@ static inline int queue_cpu(struct nvmet_tcp_queue *queue)
 	return queue->sock->sk->sk_incoming_cpu;
 }
 
+static void nvmet_tcp_poller_kick(struct nvmet_tcp_poller *poller)
+{
+	if (!test_and_set_bit(NVMET_TCP_POLLER_KICKED, &poller->flags)) {
+		WRITE_ONCE(poller->kick_time, ktime_get_ns());
+		wake_up(&poller->wait);
+	}
+}
+
+/* Make sure the queue gets serviced, by its polling thread or io_work */
+static inline void nvmet_tcp_schedule_io(struct nvmet_tcp_queue *queue)
+{
+	if (queue->poller)
+		nvmet_tcp_poller_kick(queue->poller);
+	else
+		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+}
+
 static inline u8 nvmet_tcp_hdgst_len(struct nvmet_tcp_queue *queue)
 {
 	return queue->hdr_digest ? NVME_TCP_DIGEST_LENGTH : 0;
@@ -349,6 +418,13 @@ static void nvmet_tcp_map_pdu_iovec(struct nvmet_tcp_cmd *cmd)
 
 	iov_iter_kvec(&cmd->recv_msg.msg_iter, READ, cmd->iov,
 		cmd->nr_mapped, cmd->pdu_len);
+
+	/*
+	 * The data digest is accumulated as the payload lands in the
+	 * command pages, see nvmet_tcp_recv_ddgst_update().
+	 */
+	if (cmd->queue->data_digest)
+		crypto_ahash_init(cmd->queue->rcv_hash);
 }
 
 static void nvmet_tcp_fatal_error(struct nvmet_tcp_queue *queue)
@@ -413,19 +489,37 @@ static void nvmet_tcp_send_ddgst(struct ahash_request *hash,
 	crypto_ahash_digest(hash);
 }
 
-static void nvmet_tcp_recv_ddgst(struct ahash_request *hash,
-		struct nvmet_tcp_cmd *cmd)
+/*
+ * Feed the @len bytes of PDU payload that were just received at PDU offset
+ * @off into the running data digest, while they are still cache hot, instead
+ * of walking the whole payload again once the PDU is complete.
+ */
+static void nvmet_tcp_recv_ddgst_update(struct ahash_request *hash,
+		struct nvmet_tcp_cmd *cmd, u32 off, u32 len)
 {
 	struct scatterlist sg;
-	struct kvec *iov;
-	int i;
+	struct kvec *iov = cmd->iov;
+
+	while (off >= iov->iov_len) {
+		off -= iov->iov_len;
+		iov++;
+	}
+
+	while (len) {
+		u32 n = min_t(u32, len, iov->iov_len - off);
 
-	crypto_ahash_init(hash);
-	for (i = 0, iov = cmd->iov; i < cmd->nr_mapped; i++, iov++) {
-		sg_init_one(&sg, iov->iov_base, iov->iov_len);
-		ahash_request_set_crypt(hash, &sg, NULL, iov->iov_len);
+		sg_init_one(&sg, iov->iov_base + off, n);
+		ahash_request_set_crypt(hash, &sg, NULL, n);
 		crypto_ahash_update(hash);
+		len -= n;
+		off = 0;
+		iov++;
 	}
+}
+
+static void nvmet_tcp_recv_ddgst(struct ahash_request *hash,
+		struct nvmet_tcp_cmd *cmd)
+{
 	ahash_request_set_crypt(hash, NULL, (void *)&cmd->exp_ddgst, 0);
 	crypto_ahash_final(hash);
 }
@@ -546,6 +640,22 @@ static struct nvmet_tcp_cmd *nvmet_tcp_fetch_cmd(struct nvmet_tcp_queue *queue)
 	return queue->snd_cmd;
 }
 
+/*
+ * Whether another PDU will follow in this send batch, so the current one can
+ * be sent with MSG_MORE and coalesced with it.  Completions that were queued
+ * since the batch started are pulled in so that responses for back-to-back
+ * commands share segments rather than each forcing a push.
+ */
+static bool nvmet_tcp_more_to_send(struct nvmet_tcp_queue *queue,
+		bool last_in_batch)
+{
+	if (last_in_batch)
+		return false;
+	if (!queue->send_list_len && !llist_empty(&queue->resp_list))
+		nvmet_tcp_process_resp_list(queue);
+	return queue->send_list_len;
+}
+
 static void nvmet_tcp_queue_response(struct nvmet_req *req)
 {
 	struct nvmet_tcp_cmd *cmd =
@@ -570,7 +680,7 @@ static void nvmet_tcp_queue_response(struct nvmet_req *req)
 	}
 
 	llist_add(&cmd->lentry, &queue->resp_list);
-	queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &cmd->queue->io_work);
+	nvmet_tcp_schedule_io(queue);
 }
 
 static void nvmet_tcp_execute_request(struct nvmet_tcp_cmd *cmd)
@@ -614,7 +724,7 @@ static int nvmet_try_send_data(struct nvmet_tcp_cmd *cmd, bool last_in_batch)
 		u32 left = cmd->cur_sg->length - cmd->offset;
 		int flags = MSG_DONTWAIT;
 
-		if ((!last_in_batch && cmd->queue->send_list_len) ||
+		if (nvmet_tcp_more_to_send(queue, last_in_batch) ||
 		    cmd->wbytes_done + left < cmd->req.transfer_len ||
 		    queue->data_digest || !queue->nvme_sq.sqhd_disabled)
 			flags |= MSG_MORE | MSG_SENDPAGE_NOTLAST;
@@ -661,7 +771,7 @@ static int nvmet_try_send_response(struct nvmet_tcp_cmd *cmd,
 	int flags = MSG_DONTWAIT;
 	int ret;
 
-	if (!last_in_batch && cmd->queue->send_list_len)
+	if (nvmet_tcp_more_to_send(cmd->queue, last_in_batch))
 		flags |= MSG_MORE | MSG_SENDPAGE_NOTLAST;
 	else
 		flags |= MSG_EOR;
@@ -689,7 +799,7 @@ static int nvmet_try_send_r2t(struct nvmet_tcp_cmd *cmd, bool last_in_batch)
 	int flags = MSG_DONTWAIT;
 	int ret;
 
-	if (!last_in_batch && cmd->queue->send_list_len)
+	if (nvmet_tcp_more_to_send(cmd->queue, last_in_batch))
 		flags |= MSG_MORE | MSG_SENDPAGE_NOTLAST;
 	else
 		flags |= MSG_EOR;
@@ -719,7 +829,7 @@ static int nvmet_try_send_ddgst(struct nvmet_tcp_cmd *cmd, bool last_in_batch)
 	};
 	int ret;
 
-	if (!last_in_batch && cmd->queue->send_list_len)
+	if (nvmet_tcp_more_to_send(cmd->queue, last_in_batch))
 		msg.msg_flags |= MSG_MORE;
 	else
 		msg.msg_flags |= MSG_EOR;
@@ -1154,6 +1264,9 @@ static int nvmet_tcp_try_recv_data(struct nvmet_tcp_queue *queue)
 		if (ret <= 0)
 			return ret;
 
+		if (queue->data_digest)
+			nvmet_tcp_recv_ddgst_update(queue->rcv_hash, cmd,
+					cmd->pdu_recv, ret);
 		cmd->pdu_recv += ret;
 		cmd->rbytes_done += ret;
 	}
@@ -1248,8 +1361,15 @@ static int nvmet_tcp_try_recv_one(struct nvmet_tcp_queue *queue)
 static int nvmet_tcp_try_recv(struct nvmet_tcp_queue *queue,
 		int budget, int *recvs)
 {
+	struct blk_plug plug;
 	int i, ret = 0;
 
+	/*
+	 * Commands received in one budget are executed back to back, hold a
+	 * plug across them so that the bios the bdev and file backends build
+	 * per command are handed to the driver as one batch.
+	 */
+	blk_start_plug(&plug);
 	for (i = 0; i < budget; i++) {
 		ret = nvmet_tcp_try_recv_one(queue);
 		if (unlikely(ret < 0)) {
@@ -1261,6 +1381,7 @@ static int nvmet_tcp_try_recv(struct nvmet_tcp_queue *queue,
 		(*recvs)++;
 	}
 done:
+	blk_finish_plug(&plug);
 	return ret;
 }
 
@@ -1323,6 +1444,132 @@ static void nvmet_tcp_io_work(struct work_struct *w)
 		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
 }
 
+static bool nvmet_tcp_poll_queue(struct nvmet_tcp_poller *poller,
+		struct nvmet_tcp_queue *queue)
+{
+	struct nvmet_tcp_poll_stats *stats = &poller->stats;
+	int ret, recvs = 0, sends = 0;
+	bool pending = false;
+	u64 t0, t1, t2, t3;
+
+	t0 = ktime_get_ns();
+	sk_busy_loop(queue->sock->sk, true);
+	t1 = ktime_get_ns();
+
+	ret = nvmet_tcp_try_recv(queue, NVMET_TCP_RECV_BUDGET, &recvs);
+	if (ret > 0)
+		pending = true;
+	t2 = ktime_get_ns();
+
+	if (ret >= 0) {
+		ret = nvmet_tcp_try_send(queue, NVMET_TCP_SEND_BUDGET, &sends);
+		if (ret > 0)
+			pending = true;
+	}
+	t3 = ktime_get_ns();
+
+	stats->busy_poll_ns += t1 - t0;
+	stats->recv_ns += t2 - t1;
+	stats->recv_ops += recvs;
+	stats->send_ns += t3 - t2;
+	stats->send_ops += sends;
+	return pending;
+}
+
+static int nvmet_tcp_poll_thread(void *data)
+{
+	struct nvmet_tcp_poller *poller = data;
+	unsigned long idle_usecs = idle_poll_period_usecs ?:
+					NVMET_TCP_POLL_IDLE_USECS;
+	unsigned long idle_end = jiffies + usecs_to_jiffies(idle_usecs);
+	struct nvmet_tcp_queue *queue;
+
+	while (!kthread_should_stop()) {
+		bool pending = false;
+		int i, nr;
+
+		if (test_and_clear_bit(NVMET_TCP_POLLER_KICKED,
+				       &poller->flags)) {
+			poller->stats.wakeups++;
+			poller->stats.wakeup_ns +=
+				ktime_get_ns() - READ_ONCE(poller->kick_time);
+		}
+
+		/*
+		 * Processing a queue may sleep (e.g. a connect flushes
+		 * nvmet_wq), so the list lock is only held to pick the next
+		 * queue; ->cur keeps nvmet_tcp_poller_detach() waiting until
+		 * we are done with it.
+		 */
+		nr = READ_ONCE(poller->nr_queues);
+		for (i = 0; i < nr; i++) {
+			spin_lock(&poller->lock);
+			queue = list_first_entry_or_null(&poller->queues,
+					struct nvmet_tcp_queue, poll_entry);
+			if (queue) {
+				list_move_tail(&queue->poll_entry,
+					       &poller->queues);
+				poller->cur = queue;
+			}
+			spin_unlock(&poller->lock);
+			if (!queue)
+				break;
+
+			pending |= nvmet_tcp_poll_queue(poller, queue);
+			smp_store_release(&poller->cur, NULL);
+			wake_up_var(&poller->cur);
+		}
+		poller->stats.loops++;
+
+		if (pending)
+			idle_end = jiffies + usecs_to_jiffies(idle_usecs);
+		if (pending || time_before(jiffies, idle_end)) {
+			cond_resched();
+			continue;
+		}
+
+		poller->stats.idle_sleeps++;
+		wait_event_interruptible(poller->wait,
+			test_bit(NVMET_TCP_POLLER_KICKED, &poller->flags) ||
+			kthread_should_stop());
+		idle_end = jiffies + usecs_to_jiffies(idle_usecs);
+	}
+
+	return 0;
+}
+
+static void nvmet_tcp_poller_attach(struct nvmet_tcp_queue *queue)
+{
+	struct nvmet_tcp_poller *poller = queue->poller;
+
+	spin_lock(&poller->lock);
+	list_add_tail(&queue->poll_entry, &poller->queues);
+	poller->nr_queues++;
+	spin_unlock(&poller->lock);
+	nvmet_tcp_poller_kick(poller);
+}
+
+/* Once this returns the polling thread no longer touches the queue */
+static void nvmet_tcp_poller_detach(struct nvmet_tcp_queue *queue)
+{
+	struct nvmet_tcp_poller *poller = queue->poller;
+
+	spin_lock(&poller->lock);
+	if (!list_empty(&queue->poll_entry)) {
+		list_del_init(&queue->poll_entry);
+		poller->nr_queues--;
+	}
+	spin_unlock(&poller->lock);
+	wait_var_event(&poller->cur, smp_load_acquire(&poller->cur) != queue);
+}
+
+static void nvmet_tcp_stop_io(struct nvmet_tcp_queue *queue)
+{
+	if (queue->poller)
+		nvmet_tcp_poller_detach(queue);
+	cancel_work_sync(&queue->io_work);
+}
+
 static int nvmet_tcp_alloc_cmd(struct nvmet_tcp_queue *queue,
 		struct nvmet_tcp_cmd *c)
 {
@@ -1462,7 +1709,7 @@ static void nvmet_tcp_release_queue_work(struct work_struct *w)
 	mutex_unlock(&nvmet_tcp_queue_mutex);
 
 	nvmet_tcp_restore_socket_callbacks(queue);
-	cancel_work_sync(&queue->io_work);
+	nvmet_tcp_stop_io(queue);
 	/* stop accepting incoming data */
 	queue->rcv_state = NVMET_TCP_RECV_ERR;
 
@@ -1487,7 +1734,7 @@ static void nvmet_tcp_data_ready(struct sock *sk)
 	read_lock_bh(&sk->sk_callback_lock);
 	queue = sk->sk_user_data;
 	if (likely(queue))
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		nvmet_tcp_schedule_io(queue);
 	read_unlock_bh(&sk->sk_callback_lock);
 }
 
@@ -1507,7 +1754,7 @@ static void nvmet_tcp_write_space(struct sock *sk)
 
 	if (sk_stream_is_writeable(sk)) {
 		clear_bit(SOCK_NOSPACE, &sk->sk_socket->flags);
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		nvmet_tcp_schedule_io(queue);
 	}
 out:
 	read_unlock_bh(&sk->sk_callback_lock);
@@ -1585,7 +1832,15 @@ static int nvmet_tcp_set_queue_sock(struct nvmet_tcp_queue *queue)
 		sock->sk->sk_write_space = nvmet_tcp_write_space;
 		if (idle_poll_period_usecs)
 			nvmet_tcp_arm_queue_deadline(queue);
-		queue_work_on(queue_cpu(queue), nvmet_tcp_wq, &queue->io_work);
+		/*
+		 * Attaching here, under sk_callback_lock, orders it before
+		 * any release triggered through nvmet_tcp_state_change().
+		 */
+		if (queue->poller)
+			nvmet_tcp_poller_attach(queue);
+		else
+			queue_work_on(queue_cpu(queue), nvmet_tcp_wq,
+				      &queue->io_work);
 	}
 	write_unlock_bh(&sock->sk->sk_callback_lock);
 
@@ -1612,6 +1867,7 @@ static int nvmet_tcp_alloc_queue(struct nvmet_tcp_port *port,
 	INIT_LIST_HEAD(&queue->free_list);
 	init_llist_head(&queue->resp_list);
 	INIT_LIST_HEAD(&queue->resp_send_list);
+	INIT_LIST_HEAD(&queue->poll_entry);
 
 	queue->idx = ida_alloc(&nvmet_tcp_queue_ida, GFP_KERNEL);
 	if (queue->idx < 0) {
@@ -1619,6 +1875,9 @@ static int nvmet_tcp_alloc_queue(struct nvmet_tcp_port *port,
 		goto out_free_queue;
 	}
 
+	if (port->nr_pollers)
+		queue->poller = &port->pollers[queue->idx % port->nr_pollers];
+
 	ret = nvmet_tcp_alloc_cmd(queue, &queue->connect);
 	if (ret)
 		goto out_ida_remove;
@@ -1689,6 +1948,78 @@ static void nvmet_tcp_listen_data_ready(struct sock *sk)
 	read_unlock_bh(&sk->sk_callback_lock);
 }
 
+static int nvmet_tcp_poll_stats_show(struct seq_file *m, void *unused)
+{
+	struct nvmet_tcp_port *port = m->private;
+	int i;
+
+	seq_puts(m, "thread loops idle_sleeps wakeups wakeup_ns busy_poll_ns recv_ops recv_ns send_ops send_ns\n");
+	for (i = 0; i < port->nr_pollers; i++) {
+		struct nvmet_tcp_poll_stats *st = &port->pollers[i].stats;
+
+		seq_printf(m, "%d %llu %llu %llu %llu %llu %llu %llu %llu %llu\n",
+			i, READ_ONCE(st->loops), READ_ONCE(st->idle_sleeps),
+			READ_ONCE(st->wakeups), READ_ONCE(st->wakeup_ns),
+			READ_ONCE(st->busy_poll_ns), READ_ONCE(st->recv_ops),
+			READ_ONCE(st->recv_ns), READ_ONCE(st->send_ops),
+			READ_ONCE(st->send_ns));
+	}
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(nvmet_tcp_poll_stats);
+
+static int nvmet_tcp_start_pollers(struct nvmet_tcp_port *port)
+{
+	u16 portid = le16_to_cpu(port->nport->disc_addr.portid);
+	int nr = min_t(int, port->nport->poll_threads, num_online_cpus());
+	char name[16];
+	int i, ret;
+
+	port->pollers = kcalloc(nr, sizeof(*port->pollers), GFP_KERNEL);
+	if (!port->pollers)
+		return -ENOMEM;
+
+	for (i = 0; i < nr; i++) {
+		struct nvmet_tcp_poller *poller = &port->pollers[i];
+
+		spin_lock_init(&poller->lock);
+		INIT_LIST_HEAD(&poller->queues);
+		init_waitqueue_head(&poller->wait);
+		poller->task = kthread_run(nvmet_tcp_poll_thread, poller,
+				"nvmet_tcp_poll/%u:%d", portid, i);
+		if (IS_ERR(poller->task)) {
+			ret = PTR_ERR(poller->task);
+			goto out_stop;
+		}
+	}
+	port->nr_pollers = nr;
+
+	snprintf(name, sizeof(name), "port%u", portid);
+	port->debugfs = debugfs_create_file(name, 0444, nvmet_tcp_debugfs,
+			port, &nvmet_tcp_poll_stats_fops);
+	return 0;
+
+out_stop:
+	while (--i >= 0)
+		kthread_stop(port->pollers[i].task);
+	kfree(port->pollers);
+	port->pollers = NULL;
+	return ret;
+}
+
+static void nvmet_tcp_stop_pollers(struct nvmet_tcp_port *port)
+{
+	int i;
+
+	debugfs_remove(port->debugfs);
+	for (i = 0; i < port->nr_pollers; i++) {
+		WARN_ON_ONCE(!list_empty(&port->pollers[i].queues));
+		kthread_stop(port->pollers[i].task);
+	}
+	kfree(port->pollers);
+	port->nr_pollers = 0;
+}
+
 static int nvmet_tcp_add_port(struct nvmet_port *nport)
 {
 	struct nvmet_tcp_port *port;
@@ -1726,11 +2057,19 @@ static int nvmet_tcp_add_port(struct nvmet_port *nport)
 	if (port->nport->inline_data_size < 0)
 		port->nport->inline_data_size = NVMET_TCP_DEF_INLINE_DATA_SIZE;
 
+	if (nport->poll_threads > 0) {
+		ret = nvmet_tcp_start_pollers(port);
+		if (ret) {
+			pr_err("failed to start polling threads %d\n", ret);
+			goto err_port;
+		}
+	}
+
 	ret = sock_create(port->addr.ss_family, SOCK_STREAM,
 				IPPROTO_TCP, &port->sock);
 	if (ret) {
 		pr_err("failed to create a socket\n");
-		goto err_port;
+		goto err_pollers;
 	}
 
 	port->sock->sk->sk_user_data = port;
@@ -1762,6 +2101,9 @@ static int nvmet_tcp_add_port(struct nvmet_port *nport)
 
 err_sock:
 	sock_release(port->sock);
+err_pollers:
+	if (port->nr_pollers)
+		nvmet_tcp_stop_pollers(port);
 err_port:
 	kfree(port);
 	return ret;
@@ -1793,6 +2135,12 @@ static void nvmet_tcp_remove_port(struct nvmet_port *nport)
 	 */
 	nvmet_tcp_destroy_port_queues(port);
 
+	if (port->nr_pollers) {
+		/* the queues detach from their pollers on release */
+		flush_workqueue(nvmet_wq);
+		nvmet_tcp_stop_pollers(port);
+	}
+
 	sock_release(port->sock);
 	kfree(port);
 }
@@ -1860,12 +2208,15 @@ static int __init nvmet_tcp_init(void)
 	if (!nvmet_tcp_wq)
 		return -ENOMEM;
 
+	nvmet_tcp_debugfs = debugfs_create_dir("nvmet_tcp", NULL);
+
 	ret = nvmet_register_transport(&nvmet_tcp_ops);
 	if (ret)
 		goto err;
 
 	return 0;
 err:
+	debugfs_remove_recursive(nvmet_tcp_debugfs);
 	destroy_workqueue(nvmet_tcp_wq);
 	return ret;
 }
@@ -1883,6 +2234,7 @@ static void __exit nvmet_tcp_exit(void)
 	mutex_unlock(&nvmet_tcp_queue_mutex);
 	flush_workqueue(nvmet_wq);
 
+	debugfs_remove_recursive(nvmet_tcp_debugfs);
 	destroy_workqueue(nvmet_tcp_wq);
 }
 
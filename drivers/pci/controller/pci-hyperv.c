@@ -280,6 +280,20 @@ struct tran_int_desc {
 	u64	address;
 } __packed;
 
+/*
+ * Per-MSI state kept in irq_data->chip_data. The host's descriptor comes
+ * first, so the chip data can be used as a struct tran_int_desc.
+ */
+struct hv_msi_int_desc {
+	struct tran_int_desc int_desc;
+	/*
+	 * Target CPU and vector of the last successful retarget hypercall,
+	 * retarget_cpu is -1 if the host's state isn't known.
+	 */
+	int retarget_cpu;
+	unsigned int retarget_vector;
+};
+
 /*
  * A generic message format for virtual PCI.
  * Specific message formats are defined later in the file.
@@ -640,6 +654,7 @@ static void hv_arch_irq_unmask(struct irq_data *data)
 {
 	struct msi_desc *msi_desc = irq_data_get_msi_desc(data);
 	struct hv_retarget_device_interrupt *params;
+	struct hv_msi_int_desc *msi_int;
 	struct tran_int_desc *int_desc;
 	struct hv_pcibus_device *hbus;
 	struct cpumask *dest;
@@ -647,8 +662,9 @@ static void hv_arch_irq_unmask(struct irq_data *data)
 	struct pci_bus *pbus;
 	struct pci_dev *pdev;
 	unsigned long flags;
+	unsigned int vector;
 	u32 var_size = 0;
-	int cpu, nr_bank;
+	int cpu, nr_bank, target_cpu = -1;
 	u64 res;
 
 	dest = irq_data_get_effective_affinity_mask(data);
@@ -656,9 +672,29 @@ static void hv_arch_irq_unmask(struct irq_data *data)
 	pbus = pdev->bus;
 	hbus = container_of(pbus->sysdata, struct hv_pcibus_device, sysdata);
 	int_desc = data->chip_data;
+	msi_int = container_of(int_desc, struct hv_msi_int_desc, int_desc);
+	vector = hv_msi_get_int_vector(data);
+
+	/*
+	 * The x86 vector domain targets a single CPU. Unmasking an interrupt
+	 * whose CPU and vector didn't change since the last retarget, e.g.
+	 * after a lazy disable_irq()/enable_irq() cycle or a driver's MSI-X
+	 * mask/unmask, needn't bother the hypervisor again.
+	 */
+	cpu = cpumask_first_and(dest, cpu_online_mask);
+	if (cpu < nr_cpu_ids &&
+	    cpumask_next_and(cpu, dest, cpu_online_mask) >= nr_cpu_ids)
+		target_cpu = cpu;
 
 	spin_lock_irqsave(&hbus->retarget_msi_interrupt_lock, flags);
 
+	if (target_cpu >= 0 && msi_int->retarget_cpu == target_cpu &&
+	    msi_int->retarget_vector == vector) {
+		spin_unlock_irqrestore(&hbus->retarget_msi_interrupt_lock,
+				       flags);
+		return;
+	}
+
 	params = &hbus->retarget_msi_interrupt_params;
 	memset(params, 0, sizeof(*params));
 	params->partition_id = HV_PARTITION_ID_SELF;
@@ -670,7 +706,7 @@ static void hv_arch_irq_unmask(struct irq_data *data)
 			   (hbus->hdev->dev_instance.b[7] << 8) |
 			   (hbus->hdev->dev_instance.b[6] & 0xf8) |
 			   PCI_FUNC(pdev->devfn);
-	params->int_target.vector = hv_msi_get_int_vector(data);
+	params->int_target.vector = vector;
 
 	/*
 	 * Honoring apic->delivery_mode set to APIC_DELIVERY_MODE_FIXED by
@@ -721,6 +757,12 @@ static void hv_arch_irq_unmask(struct irq_data *data)
 			      params, NULL);
 
 exit_unlock:
+	if (hv_result_success(res)) {
+		msi_int->retarget_cpu = target_cpu;
+		msi_int->retarget_vector = vector;
+	} else {
+		msi_int->retarget_cpu = -1;
+	}
 	spin_unlock_irqrestore(&hbus->retarget_msi_interrupt_lock, flags);
 
 	/*
@@ -1633,16 +1675,26 @@ static u32 hv_compose_msi_req_v1(
 
 /*
  * Create MSI w/ dummy vCPU set targeting just one vCPU, overwritten
- * by subsequent retarget in hv_irq_unmask().
+ * by subsequent retarget in hv_irq_unmask(). Prefer a vCPU on the
+ * device's vNUMA node if the affinity allows for one.
  */
-static int hv_compose_msi_req_get_cpu(struct cpumask *affinity)
+static int hv_compose_msi_req_get_cpu(struct cpumask *affinity, int node)
 {
+	int cpu;
+
+	if (node != NUMA_NO_NODE) {
+		for_each_cpu_and(cpu, affinity, cpumask_of_node(node)) {
+			if (cpu_online(cpu))
+				return cpu;
+		}
+	}
+
 	return cpumask_first_and(affinity, cpu_online_mask);
 }
 
 static u32 hv_compose_msi_req_v2(
 	struct pci_create_interrupt2 *int_pkt, struct cpumask *affinity,
-	u32 slot, u8 vector, u8 vector_count)
+	int node, u32 slot, u8 vector, u8 vector_count)
 {
 	int cpu;
 
@@ -1651,7 +1703,7 @@ static u32 hv_compose_msi_req_v2(
 	int_pkt->int_desc.vector = vector;
 	int_pkt->int_desc.vector_count = vector_count;
 	int_pkt->int_desc.delivery_mode = DELIVERY_MODE;
-	cpu = hv_compose_msi_req_get_cpu(affinity);
+	cpu = hv_compose_msi_req_get_cpu(affinity, node);
 	int_pkt->int_desc.processor_array[0] =
 		hv_cpu_number_to_vp_number(cpu);
 	int_pkt->int_desc.processor_count = 1;
@@ -1661,7 +1713,7 @@ static u32 hv_compose_msi_req_v2(
 
 static u32 hv_compose_msi_req_v3(
 	struct pci_create_interrupt3 *int_pkt, struct cpumask *affinity,
-	u32 slot, u32 vector, u8 vector_count)
+	int node, u32 slot, u32 vector, u8 vector_count)
 {
 	int cpu;
 
@@ -1671,7 +1723,7 @@ static u32 hv_compose_msi_req_v3(
 	int_pkt->int_desc.reserved = 0;
 	int_pkt->int_desc.vector_count = vector_count;
 	int_pkt->int_desc.delivery_mode = DELIVERY_MODE;
-	cpu = hv_compose_msi_req_get_cpu(affinity);
+	cpu = hv_compose_msi_req_get_cpu(affinity, node);
 	int_pkt->int_desc.processor_array[0] =
 		hv_cpu_number_to_vp_number(cpu);
 	int_pkt->int_desc.processor_count = 1;
@@ -1699,6 +1751,7 @@ static void hv_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 	struct pci_dev *pdev;
 	struct cpumask *dest;
 	struct compose_comp_ctxt comp;
+	struct hv_msi_int_desc *msi_int;
 	struct tran_int_desc *int_desc;
 	struct msi_desc *msi_desc;
 	u8 vector, vector_count;
@@ -1733,9 +1786,11 @@ static void hv_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 	if (!hpdev)
 		goto return_null_message;
 
-	int_desc = kzalloc(sizeof(*int_desc), GFP_ATOMIC);
-	if (!int_desc)
+	msi_int = kzalloc(sizeof(*msi_int), GFP_ATOMIC);
+	if (!msi_int)
 		goto drop_reference;
+	msi_int->retarget_cpu = -1;
+	int_desc = &msi_int->int_desc;
 
 	if (!msi_desc->pci.msi_attrib.is_msix && msi_desc->nvec_used > 1) {
 		/*
@@ -1784,7 +1839,7 @@ static void hv_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 	case PCI_PROTOCOL_VERSION_1_2:
 	case PCI_PROTOCOL_VERSION_1_3:
 		size = hv_compose_msi_req_v2(&ctxt.int_pkts.v2,
-					dest,
+					dest, dev_to_node(&pdev->dev),
 					hpdev->desc.win_slot.slot,
 					vector,
 					vector_count);
@@ -1792,7 +1847,7 @@ static void hv_compose_msi_msg(struct irq_data *data, struct msi_msg *msg)
 
 	case PCI_PROTOCOL_VERSION_1_4:
 		size = hv_compose_msi_req_v3(&ctxt.int_pkts.v3,
-					dest,
+					dest, dev_to_node(&pdev->dev),
 					hpdev->desc.win_slot.slot,
 					vector,
 					vector_count);
@@ -3849,6 +3904,15 @@ static int hv_pci_restore_msi_msg(struct pci_dev *pdev, void *arg)
 			break;
 		}
 
+		/* The host lost the interrupt targets; retarget on unmask. */
+		if (irq_data->chip_data) {
+			struct hv_msi_int_desc *msi_int =
+				container_of((struct tran_int_desc *)irq_data->chip_data,
+					     struct hv_msi_int_desc, int_desc);
+
+			msi_int->retarget_cpu = -1;
+		}
+
 		hv_compose_msi_msg(irq_data, &entry->msg);
 	}
 	msi_unlock_descs(&pdev->dev);
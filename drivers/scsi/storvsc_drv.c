@@ -21,6 +21,7 @@
 #include <linux/device.h>
 #include <linux/hyperv.h>
 #include <linux/blkdev.h>
+#include <linux/blk-mq.h>
 #include <linux/dma-mapping.h>
 
 #include <scsi/scsi.h>
@@ -333,6 +334,11 @@ MODULE_PARM_DESC(storvsc_max_hw_queues, "Maximum number of hardware queues");
 module_param(storvsc_vcpus_per_sub_channel, int, S_IRUGO);
 MODULE_PARM_DESC(storvsc_vcpus_per_sub_channel, "Ratio of VCPUs to subchannels");
 
+static unsigned int storvsc_poll_queues;
+module_param(storvsc_poll_queues, uint, 0444);
+MODULE_PARM_DESC(storvsc_poll_queues,
+		 "Number of polled hardware queues (0 - 8), each backed by a sub-channel");
+
 static int ring_avail_percent_lowater = 10;
 module_param(ring_avail_percent_lowater, int, S_IRUGO);
 MODULE_PARM_DESC(ring_avail_percent_lowater,
@@ -349,6 +355,8 @@ static struct scsi_transport_template *fc_transport_template;
 
 static struct scsi_host_template scsi_driver;
 static void storvsc_on_channel_callback(void *context);
+static int storvsc_reap_channel(struct vmbus_channel *channel);
+static void storvsc_on_poll_channel_callback(void *context);
 
 #define STORVSC_MAX_LUNS_PER_TARGET			255
 #define STORVSC_MAX_TARGETS				2
@@ -362,6 +370,8 @@ static void storvsc_on_channel_callback(void *context);
 #define STORVSC_IDE_MAX_TARGETS				1
 #define STORVSC_IDE_MAX_CHANNELS			1
 
+#define STORVSC_MAX_POLL_QUEUES				8
+
 /*
  * Upper bound on the size of a storvsc packet.
  */
@@ -384,6 +394,16 @@ struct storvsc_cmd_request {
 };
 
 
+/*
+ * A sub-channel dedicated to a polled hardware queue. Host interrupts are
+ * masked on it, completions are reaped by storvsc_mq_poll().
+ */
+struct storvsc_poll_chn {
+	struct vmbus_channel *channel;
+	/* Serializes reaping the channel */
+	spinlock_t lock;
+};
+
 /* A storvsc device is a device object that contains a vmbus channel */
 struct storvsc_device {
 	struct hv_device *device;
@@ -422,6 +442,11 @@ struct storvsc_device {
 	 * and storvsc_change_target_cpu().
 	 */
 	spinlock_t lock;
+	/*
+	 * Sub-channels of the polled hardware queues, set once opened.
+	 */
+	struct storvsc_poll_chn poll_chns[STORVSC_MAX_POLL_QUEUES];
+	unsigned int num_poll_reserved;
 	/* Used for vsc/vsp channel reset process */
 	struct storvsc_cmd_request init_request;
 	struct storvsc_cmd_request reset_request;
@@ -614,6 +639,10 @@ static void storvsc_change_target_cpu(struct vmbus_channel *channel, u32 old,
 	list_for_each_entry(cur_chn, &device->channel->sc_list, sc_list) {
 		if (cur_chn == channel)
 			continue;
+		/* Poll sub-channels are not in stor_chns[] */
+		if (cur_chn->onchannel_callback ==
+		    storvsc_on_poll_channel_callback)
+			continue;
 		if (cur_chn->target_cpu == old) {
 			old_is_alloced = true;
 			goto old_is_alloced;
@@ -656,12 +685,61 @@ static u64 storvsc_next_request_id(struct vmbus_channel *channel, u64 rqst_addr)
 	return (u64)blk_mq_unique_tag(scsi_cmd_to_rq(request->cmd)) + 1;
 }
 
+static void storvsc_on_poll_channel_callback(void *context)
+{
+	struct storvsc_poll_chn *pchn = context;
+
+	/*
+	 * Only reached if the host signalled before the interrupts got
+	 * masked. If a poller holds the lock, it reaps the packets.
+	 */
+	if (spin_trylock(&pchn->lock)) {
+		storvsc_reap_channel(pchn->channel);
+		spin_unlock(&pchn->lock);
+	}
+}
+
+static void handle_poll_sc_creation(struct storvsc_device *stor_device,
+				    struct storvsc_poll_chn *pchn,
+				    struct vmbus_channel *new_sc)
+{
+	struct device *dev = &stor_device->device->device;
+	struct vmstorage_channel_properties props;
+	int ret;
+
+	memset(&props, 0, sizeof(struct vmstorage_channel_properties));
+
+	/* Run the callback from the tasklet without re-enabling interrupts */
+	set_channel_read_mode(new_sc, HV_CALL_DIRECT);
+
+	ret = vmbus_open(new_sc,
+			 storvsc_ringbuffer_size,
+			 storvsc_ringbuffer_size,
+			 (void *)&props,
+			 sizeof(struct vmstorage_channel_properties),
+			 storvsc_on_poll_channel_callback, pchn);
+
+	/* The polled queue falls back to the interrupt driven channels. */
+	if (ret != 0) {
+		dev_err(dev, "Failed to open poll sub-channel: err=%d\n", ret);
+		return;
+	}
+
+	/* Keep the host from interrupting us for this channel */
+	hv_begin_read(&new_sc->inbound);
+
+	/* Pairs with smp_load_acquire() in storvsc_get_poll_chn() */
+	smp_store_release(&pchn->channel, new_sc);
+}
+
 static void handle_sc_creation(struct vmbus_channel *new_sc)
 {
 	struct hv_device *device = new_sc->primary_channel->device_obj;
 	struct device *dev = &device->device;
 	struct storvsc_device *stor_device;
 	struct vmstorage_channel_properties props;
+	struct storvsc_poll_chn *pchn = NULL;
+	unsigned long flags;
 	int ret;
 
 	stor_device = get_out_stor_device(device);
@@ -673,6 +751,17 @@ static void handle_sc_creation(struct vmbus_channel *new_sc)
 
 	new_sc->next_request_id_callback = storvsc_next_request_id;
 
+	/* The first sub-channels offered back the polled hardware queues */
+	spin_lock_irqsave(&stor_device->lock, flags);
+	if (stor_device->num_poll_reserved < storvsc_poll_queues)
+		pchn = &stor_device->poll_chns[stor_device->num_poll_reserved++];
+	spin_unlock_irqrestore(&stor_device->lock, flags);
+
+	if (pchn) {
+		handle_poll_sc_creation(stor_device, pchn, new_sc);
+		return;
+	}
+
 	ret = vmbus_open(new_sc,
 			 storvsc_ringbuffer_size,
 			 storvsc_ringbuffer_size,
@@ -709,7 +798,8 @@ static void  handle_multichannel_storage(struct hv_device *device, int max_chns)
 	 * should not be created. The primary channel is already created
 	 * and assigned to one CPU, so check against # CPUs - 1.
 	 */
-	num_sc = min((int)(num_online_cpus() - 1), max_chns);
+	num_sc = min((int)(num_online_cpus() - 1 + storvsc_poll_queues),
+		     max_chns);
 	if (!num_sc)
 		return;
 
@@ -1197,13 +1287,14 @@ static void storvsc_on_receive(struct storvsc_device *stor_device,
 	}
 }
 
-static void storvsc_on_channel_callback(void *context)
+/* Returns the number of packets processed */
+static int storvsc_reap_channel(struct vmbus_channel *channel)
 {
-	struct vmbus_channel *channel = (struct vmbus_channel *)context;
 	const struct vmpacket_descriptor *desc;
 	struct hv_device *device;
 	struct storvsc_device *stor_device;
 	struct Scsi_Host *shost;
+	int found = 0;
 
 	if (channel->primary_channel != NULL)
 		device = channel->primary_channel->device_obj;
@@ -1212,7 +1303,7 @@ static void storvsc_on_channel_callback(void *context)
 
 	stor_device = get_in_stor_device(device);
 	if (!stor_device)
-		return;
+		return 0;
 
 	shost = stor_device->host;
 
@@ -1224,6 +1315,8 @@ static void storvsc_on_channel_callback(void *context)
 		u32 minlen = rqst_id ? sizeof(struct vstor_packet) :
 			sizeof(enum vstor_packet_operation);
 
+		found++;
+
 		if (pktlen < minlen) {
 			dev_err(&device->device,
 				"Invalid pkt: id=%llu, len=%u, minlen=%u\n",
@@ -1281,6 +1374,13 @@ static void storvsc_on_channel_callback(void *context)
 		       sizeof(struct vstor_packet));
 		complete(&request->wait_event);
 	}
+
+	return found;
+}
+
+static void storvsc_on_channel_callback(void *context)
+{
+	storvsc_reap_channel((struct vmbus_channel *)context);
 }
 
 static int storvsc_connect_to_vsp(struct hv_device *device, u32 ring_size,
@@ -1345,6 +1445,26 @@ static int storvsc_dev_remove(struct hv_device *device)
 	return 0;
 }
 
+/*
+ * Is the channel completing on @tgt_cpu local to the submitting CPU @q_num?
+ * It must be on the same NUMA node and, with @llc, share the last level cache.
+ */
+static bool storvsc_chn_is_local(u16 q_num, int tgt_cpu,
+				 const struct cpumask *node_mask, bool llc)
+{
+	if (!cpumask_test_cpu(tgt_cpu, node_mask))
+		return false;
+	if (!llc)
+		return true;
+
+#ifdef CONFIG_X86
+	return get_llc_id(q_num) == get_llc_id(tgt_cpu);
+#else
+	/* No exported LLC topology, the node is as local as it gets */
+	return true;
+#endif
+}
+
 static struct vmbus_channel *get_og_chn(struct storvsc_device *stor_device,
 					u16 q_num)
 {
@@ -1352,6 +1472,7 @@ static struct vmbus_channel *get_og_chn(struct storvsc_device *stor_device,
 	u16 hash_qnum;
 	const struct cpumask *node_mask;
 	int num_channels, tgt_cpu;
+	bool llc = true;
 
 	if (stor_device->num_sc == 0) {
 		stor_device->stor_chns[q_num] = stor_device->device->channel;
@@ -1363,17 +1484,23 @@ static struct vmbus_channel *get_og_chn(struct storvsc_device *stor_device,
 	 * initiated I/O on a processor/hw-q that does not
 	 * currently have a designated channel. Fix this.
 	 * The strategy is simple:
-	 * I. Ensure NUMA locality
+	 * I. Ensure NUMA locality, preferring channels completing on CPUs
+	 *    that share the last level cache with the submitting CPU
 	 * II. Distribute evenly (best effort)
 	 */
 
 	node_mask = cpumask_of_node(cpu_to_node(q_num));
 
+again:
 	num_channels = 0;
 	for_each_cpu(tgt_cpu, &stor_device->alloced_cpus) {
-		if (cpumask_test_cpu(tgt_cpu, node_mask))
+		if (storvsc_chn_is_local(q_num, tgt_cpu, node_mask, llc))
 			num_channels++;
 	}
+	if (num_channels == 0 && llc) {
+		llc = false;
+		goto again;
+	}
 	if (num_channels == 0) {
 		stor_device->stor_chns[q_num] = stor_device->device->channel;
 		return stor_device->device->channel;
@@ -1384,7 +1511,7 @@ static struct vmbus_channel *get_og_chn(struct storvsc_device *stor_device,
 		hash_qnum -= num_channels;
 
 	for_each_cpu(tgt_cpu, &stor_device->alloced_cpus) {
-		if (!cpumask_test_cpu(tgt_cpu, node_mask))
+		if (!storvsc_chn_is_local(q_num, tgt_cpu, node_mask, llc))
 			continue;
 		if (slot == hash_qnum)
 			break;
@@ -1397,6 +1524,51 @@ static struct vmbus_channel *get_og_chn(struct storvsc_device *stor_device,
 }
 
 
+/*
+ * Look for a channel, other than the one of the submitting CPU @q_num, that
+ * is local to it and has room in its ring.
+ */
+static struct vmbus_channel *
+storvsc_find_local_chn(struct storvsc_device *stor_device, u16 q_num,
+		       const struct cpumask *node_mask, bool llc)
+{
+	struct vmbus_channel *channel;
+	int tgt_cpu;
+
+	for_each_cpu_wrap(tgt_cpu, &stor_device->alloced_cpus, q_num + 1) {
+		if (tgt_cpu == q_num)
+			continue;
+		if (!storvsc_chn_is_local(q_num, tgt_cpu, node_mask, llc))
+			continue;
+		channel = READ_ONCE(stor_device->stor_chns[tgt_cpu]);
+		if (channel == NULL)
+			continue;
+		if (hv_get_avail_to_write_percent(&channel->outbound)
+				> ring_avail_percent_lowater)
+			return channel;
+	}
+
+	return NULL;
+}
+
+/* Returns the poll sub-channel of a request on a polled hardware queue */
+static struct vmbus_channel *
+storvsc_get_poll_chn(struct storvsc_device *stor_device, struct request *rq)
+{
+	struct Scsi_Host *shost = stor_device->host;
+	unsigned int idx;
+
+	if (rq->mq_hctx->type != HCTX_TYPE_POLL)
+		return NULL;
+
+	idx = rq->mq_hctx->queue_num -
+	      shost->tag_set.map[HCTX_TYPE_POLL].queue_offset;
+	if (idx >= STORVSC_MAX_POLL_QUEUES)
+		return NULL;
+
+	return smp_load_acquire(&stor_device->poll_chns[idx].channel);
+}
+
 static int storvsc_do_io(struct hv_device *device,
 			 struct storvsc_cmd_request *request, u16 q_num)
 {
@@ -1416,6 +1588,16 @@ static int storvsc_do_io(struct hv_device *device,
 
 
 	request->device  = device;
+
+	/*
+	 * Requests on a polled hardware queue go to its poll sub-channel, if
+	 * the host offered one, otherwise to the interrupt driven channels.
+	 */
+	outgoing_channel = storvsc_get_poll_chn(stor_device,
+						scsi_cmd_to_rq(request->cmd));
+	if (outgoing_channel)
+		goto found_channel;
+
 	/*
 	 * Select an appropriate channel to send the request out.
 	 */
@@ -1425,25 +1607,20 @@ static int storvsc_do_io(struct hv_device *device,
 		if (outgoing_channel->target_cpu == q_num) {
 			/*
 			 * Ideally, we want to pick a different channel if
-			 * available on the same NUMA node.
+			 * available on the same NUMA node, first one that
+			 * completes on a CPU sharing our last level cache.
 			 */
 			node_mask = cpumask_of_node(cpu_to_node(q_num));
-			for_each_cpu_wrap(tgt_cpu,
-				 &stor_device->alloced_cpus, q_num + 1) {
-				if (!cpumask_test_cpu(tgt_cpu, node_mask))
-					continue;
-				if (tgt_cpu == q_num)
-					continue;
-				channel = READ_ONCE(
-					stor_device->stor_chns[tgt_cpu]);
-				if (channel == NULL)
-					continue;
-				if (hv_get_avail_to_write_percent(
-							&channel->outbound)
-						> ring_avail_percent_lowater) {
-					outgoing_channel = channel;
-					goto found_channel;
-				}
+			channel = storvsc_find_local_chn(stor_device, q_num,
+							 node_mask, true);
+			if (!channel)
+				channel = storvsc_find_local_chn(stor_device,
+								 q_num,
+								 node_mask,
+								 false);
+			if (channel) {
+				outgoing_channel = channel;
+				goto found_channel;
 			}
 
 			/*
@@ -1830,12 +2007,74 @@ static int storvsc_queuecommand(struct Scsi_Host *host, struct scsi_cmnd *scmnd)
 	return ret;
 }
 
+static int storvsc_map_queues(struct Scsi_Host *shost)
+{
+	struct blk_mq_queue_map *map;
+	int i, qoff;
+
+	if (shost->nr_maps == 1)
+		return blk_mq_map_queues(&shost->tag_set.map[HCTX_TYPE_DEFAULT]);
+
+	for (i = 0, qoff = 0; i < shost->nr_maps; i++) {
+		map = &shost->tag_set.map[i];
+
+		map->nr_queues = 0;
+		if (i == HCTX_TYPE_DEFAULT)
+			map->nr_queues = shost->nr_hw_queues -
+					 storvsc_poll_queues;
+		else if (i == HCTX_TYPE_POLL)
+			map->nr_queues = storvsc_poll_queues;
+
+		if (!map->nr_queues)
+			continue;
+
+		map->queue_offset = qoff;
+		blk_mq_map_queues(map);
+
+		qoff += map->nr_queues;
+	}
+
+	return 0;
+}
+
+static int storvsc_mq_poll(struct Scsi_Host *shost, unsigned int queue_num)
+{
+	struct hv_host_device *host_dev = shost_priv(shost);
+	struct storvsc_device *stor_device;
+	struct storvsc_poll_chn *pchn;
+	unsigned int idx;
+	int found;
+
+	stor_device = get_in_stor_device(host_dev->dev);
+	if (!stor_device)
+		return 0;
+
+	idx = queue_num - shost->tag_set.map[HCTX_TYPE_POLL].queue_offset;
+	if (idx >= STORVSC_MAX_POLL_QUEUES)
+		return 0;
+
+	/* Without a poll sub-channel, the completions come by interrupt */
+	pchn = &stor_device->poll_chns[idx];
+	if (!smp_load_acquire(&pchn->channel))
+		return 0;
+
+	if (!spin_trylock_bh(&pchn->lock))
+		return 0;
+
+	found = storvsc_reap_channel(pchn->channel);
+	spin_unlock_bh(&pchn->lock);
+
+	return found;
+}
+
 static struct scsi_host_template scsi_driver = {
 	.module	=		THIS_MODULE,
 	.name =			"storvsc_host_t",
 	.cmd_size =             sizeof(struct storvsc_cmd_request),
 	.bios_param =		storvsc_get_chs,
 	.queuecommand =		storvsc_queuecommand,
+	.map_queues =		storvsc_map_queues,
+	.mq_poll =		storvsc_mq_poll,
 	.eh_host_reset_handler =	storvsc_host_reset_handler,
 	.proc_name =		"storvsc_host",
 	.eh_timed_out =		storvsc_eh_timed_out,
@@ -1896,6 +2135,7 @@ static int storvsc_probe(struct hv_device *device,
 	struct storvsc_device *stor_device;
 	int max_sub_channels = 0;
 	u32 max_xfer_bytes;
+	int i;
 
 	/*
 	 * We support sub-channels for storage on SCSI and FC controllers.
@@ -1934,6 +2174,8 @@ static int storvsc_probe(struct hv_device *device,
 	stor_device->device = device;
 	stor_device->host = host;
 	spin_lock_init(&stor_device->lock);
+	for (i = 0; i < STORVSC_MAX_POLL_QUEUES; i++)
+		spin_lock_init(&stor_device->poll_chns[i].lock);
 	hv_set_drvdata(device, stor_device);
 	dma_set_min_align_mask(&device->device, HV_HYP_PAGE_SIZE - 1);
 
@@ -2005,6 +2247,12 @@ static int storvsc_probe(struct hv_device *device,
 			host->nr_hw_queues = storvsc_max_hw_queues;
 		else
 			host->nr_hw_queues = num_present_cpus;
+
+		/* The polled queues come on top of the default ones */
+		if (storvsc_poll_queues) {
+			host->nr_hw_queues += storvsc_poll_queues;
+			host->nr_maps = HCTX_TYPE_POLL + 1;
+		}
 	}
 
 	/*
@@ -2109,6 +2357,7 @@ static int storvsc_suspend(struct hv_device *hv_dev)
 	struct storvsc_device *stor_device = hv_get_drvdata(hv_dev);
 	struct Scsi_Host *host = stor_device->host;
 	struct hv_host_device *host_dev = shost_priv(host);
+	int i;
 
 	storvsc_wait_to_drain(stor_device);
 
@@ -2121,6 +2370,11 @@ static int storvsc_suspend(struct hv_device *hv_dev)
 
 	cpumask_clear(&stor_device->alloced_cpus);
 
+	/* The sub-channels are offered again on resume */
+	for (i = 0; i < STORVSC_MAX_POLL_QUEUES; i++)
+		stor_device->poll_chns[i].channel = NULL;
+	stor_device->num_poll_reserved = 0;
+
 	return 0;
 }
 
@@ -2162,6 +2416,9 @@ static int __init storvsc_drv_init(void)
 	 * the ring buffer indices) by the max request size (which is
 	 * vmbus_channel_packet_multipage_buffer + struct vstor_packet + u64)
 	 */
+	if (storvsc_poll_queues > STORVSC_MAX_POLL_QUEUES)
+		storvsc_poll_queues = STORVSC_MAX_POLL_QUEUES;
+
 	max_outstanding_req_per_channel =
 		((storvsc_ringbuffer_size - PAGE_SIZE) /
 		ALIGN(MAX_MULTIPAGE_BUFFER_PACKET +
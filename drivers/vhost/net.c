@@ -372,13 +372,17 @@ static void vhost_zerocopy_signal_used(struct vhost_net *net,
 		} else
 			break;
 	}
+	if (!j)
+		return;
+
+	/* The completed range may wrap; publish it all, then notify once. */
 	while (j) {
 		add = min(UIO_MAXIOV - nvq->done_idx, j);
-		vhost_add_used_and_signal_n(vq->dev, vq,
-					    &vq->heads[nvq->done_idx], add);
+		vhost_add_used_n(vq, &vq->heads[nvq->done_idx], add);
 		nvq->done_idx = (nvq->done_idx + add) % UIO_MAXIOV;
 		j -= add;
 	}
+	vhost_signal(vq->dev, vq);
 }
 
 static void vhost_zerocopy_callback(struct sk_buff *skb,
@@ -544,7 +548,7 @@ static void vhost_net_busy_poll(struct vhost_net *net,
 	endtime = busy_clock() + busyloop_timeout;
 
 	while (vhost_can_busy_poll(endtime)) {
-		if (vhost_has_work(&net->dev)) {
+		if (vhost_vq_has_work(poll_rx ? rvq : tvq)) {
 			*busyloop_intr = true;
 			break;
 		}
@@ -873,6 +877,7 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 	struct vhost_net_ubuf_ref *ubufs;
 	struct ubuf_info *ubuf;
 	bool zcopy_used;
+	bool copied = false;
 	int sent_pkts = 0;
 
 	do {
@@ -948,12 +953,18 @@ static void handle_tx_zerocopy(struct vhost_net *net, struct socket *sock)
 		} else if (unlikely(err != len))
 			pr_debug("Truncated TX packet: "
 				 " len %d != %zd\n", err, len);
-		if (!zcopy_used)
-			vhost_add_used_and_signal(&net->dev, vq, head, 0);
-		else
+		if (!zcopy_used) {
+			vhost_add_used(vq, head, 0);
+			copied = true;
+		} else {
 			vhost_zerocopy_signal_used(net, vq);
+		}
 		vhost_net_tx_packet(net);
 	} while (likely(!vhost_exceeds_weight(vq, ++sent_pkts, total_len)));
+
+	/* One notification covers all the copied packets of this pass */
+	if (copied)
+		vhost_signal(&net->dev, vq);
 }
 
 /* Expects to be always run from workqueue - which acts as
@@ -1340,8 +1351,10 @@ static int vhost_net_open(struct inode *inode, struct file *f)
 		       VHOST_NET_PKT_WEIGHT, VHOST_NET_WEIGHT, true,
 		       NULL);
 
-	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev);
-	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_TX, handle_tx_net, EPOLLOUT, dev,
+			&n->vqs[VHOST_NET_VQ_TX].vq);
+	vhost_poll_init(n->poll + VHOST_NET_VQ_RX, handle_rx_net, EPOLLIN, dev,
+			&n->vqs[VHOST_NET_VQ_RX].vq);
 
 	f->private_data = n;
 	n->page_frag.page = NULL;
@@ -1726,6 +1739,8 @@ static long vhost_net_ioctl(struct file *f, unsigned int ioctl,
 	default:
 		mutex_lock(&n->dev.mutex);
 		r = vhost_dev_ioctl(&n->dev, ioctl, argp);
+		if (r == -ENOIOCTLCMD)
+			r = vhost_worker_ioctl(&n->dev, ioctl, argp);
 		if (r == -ENOIOCTLCMD)
 			r = vhost_vring_ioctl(&n->dev, ioctl, argp);
 		else
@@ -76,6 +76,7 @@ struct vring_desc_state_packed {
 	struct vring_packed_desc *indir_desc; /* Indirect descriptor, if any. */
 	u16 num;			/* Descriptor list length. */
 	u16 last;			/* The last desc state in a list. */
+	u32 in_len;			/* Device-writable length (in-order). */
 };
 
 struct vring_desc_extra {
@@ -94,6 +95,12 @@ struct vring_virtqueue {
 	/* Is DMA API used? */
 	bool use_dma_api;
 
+	/* Has the driver mapped the buffers itself? */
+	bool premapped;
+
+	/* Host uses buffers in the order they were made available */
+	bool in_order;
+
 	/* Can we use weak barriers? */
 	bool weak_barriers;
 
@@ -169,6 +176,15 @@ struct vring_virtqueue {
 			 */
 			u16 event_flags_shadow;
 
+			/*
+			 * With VIRTIO_F_IN_ORDER the device may return a batch
+			 * of buffers through a single used descriptor carrying
+			 * the id of the last one; buffers are handed out of the
+			 * batch up to batch_last_id (vring.num when idle).
+			 */
+			u16 batch_last_id;
+			u32 batch_last_len;
+
 			/* Per-descriptor state. */
 			struct vring_desc_state_packed *desc_state;
 			struct vring_desc_extra *desc_extra;
@@ -329,6 +345,9 @@ static dma_addr_t vring_map_one_sg(const struct vring_virtqueue *vq,
 				   struct scatterlist *sg,
 				   enum dma_data_direction direction)
 {
+	if (vq->premapped)
+		return sg_dma_address(sg);
+
 	if (!vq->use_dma_api)
 		return (dma_addr_t)sg_phys(sg);
 
@@ -372,7 +391,7 @@ static void vring_unmap_one_split_indirect(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = virtio16_to_cpu(vq->vq.vdev, desc->flags);
@@ -401,7 +420,7 @@ static unsigned int vring_unmap_one_split(const struct vring_virtqueue *vq,
 				 extra[i].len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra[i].addr,
 			       extra[i].len,
@@ -989,7 +1008,7 @@ static void vring_unmap_extra_packed(const struct vring_virtqueue *vq,
 				 extra->addr, extra->len,
 				 (flags & VRING_DESC_F_WRITE) ?
 				 DMA_FROM_DEVICE : DMA_TO_DEVICE);
-	} else {
+	} else if (!vq->premapped) {
 		dma_unmap_page(vring_dma_dev(vq),
 			       extra->addr, extra->len,
 			       (flags & VRING_DESC_F_WRITE) ?
@@ -1002,7 +1021,7 @@ static void vring_unmap_desc_packed(const struct vring_virtqueue *vq,
 {
 	u16 flags;
 
-	if (!vq->use_dma_api)
+	if (!vq->use_dma_api || vq->premapped)
 		return;
 
 	flags = le16_to_cpu(desc->flags);
@@ -1043,6 +1062,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	struct scatterlist *sg;
 	unsigned int i, n, err_idx;
 	u16 head, id;
+	u32 in_len;
 	dma_addr_t addr;
 
 	head = vq->packed.next_avail_idx;
@@ -1058,7 +1078,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	}
 
 	i = 0;
-	id = vq->free_head;
+	in_len = 0;
+	id = vq->in_order ? head : vq->free_head;
 	BUG_ON(id == vq->packed.vring.num);
 
 	for (n = 0; n < out_sgs + in_sgs; n++) {
@@ -1072,6 +1093,8 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 						0 : VRING_DESC_F_WRITE);
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
+			if (n >= out_sgs)
+				in_len += sg->length;
 			i++;
 		}
 	}
@@ -1125,6 +1148,7 @@ static int virtqueue_add_indirect_packed(struct vring_virtqueue *vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = desc;
 	vq->packed.desc_state[id].last = id;
+	vq->packed.desc_state[id].in_len = in_len;
 
 	vq->num_added += 1;
 
@@ -1160,6 +1184,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	unsigned int i, n, c, descs_used, err_idx;
 	__le16 head_flags, flags;
 	u16 head, id, prev, curr, avail_used_flags;
+	u32 in_len = 0;
 	int err;
 
 	START_USE(vq);
@@ -1203,7 +1228,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 		return -ENOSPC;
 	}
 
-	id = vq->free_head;
+	id = vq->in_order ? head : vq->free_head;
 	BUG_ON(id == vq->packed.vring.num);
 
 	curr = id;
@@ -1226,6 +1251,8 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 			desc[i].addr = cpu_to_le64(addr);
 			desc[i].len = cpu_to_le32(sg->length);
 			desc[i].id = cpu_to_le16(id);
+			if (n >= out_sgs)
+				in_len += sg->length;
 
 			if (unlikely(vq->use_dma_api)) {
 				vq->packed.desc_extra[curr].addr = addr;
@@ -1260,6 +1287,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 	vq->packed.desc_state[id].data = data;
 	vq->packed.desc_state[id].indir_desc = ctx;
 	vq->packed.desc_state[id].last = prev;
+	vq->packed.desc_state[id].in_len = in_len;
 
 	/*
 	 * A driver MUST NOT make the first descriptor in the list
@@ -1278,7 +1306,7 @@ static inline int virtqueue_add_packed(struct virtqueue *_vq,
 unmap_release:
 	err_idx = i;
 	i = head;
-	curr = vq->free_head;
+	curr = id;
 
 	vq->packed.avail_used_flags = avail_used_flags;
 
@@ -1357,8 +1385,10 @@ static void detach_buf_packed(struct vring_virtqueue *vq,
 	/* Clear data ptr. */
 	state->data = NULL;
 
-	vq->packed.desc_extra[state->last].next = vq->free_head;
-	vq->free_head = id;
+	if (!vq->in_order) {
+		vq->packed.desc_extra[state->last].next = vq->free_head;
+		vq->free_head = id;
+	}
 	vq->vq.num_free += state->num;
 
 	if (unlikely(vq->use_dma_api)) {
@@ -1406,6 +1436,10 @@ static inline bool is_used_desc_packed(const struct vring_virtqueue *vq,
 
 static inline bool more_used_packed(const struct vring_virtqueue *vq)
 {
+	/* The rest of an in-order batch is already known to be used. */
+	if (vq->packed.batch_last_id != vq->packed.vring.num)
+		return true;
+
 	return is_used_desc_packed(vq, vq->last_used_idx,
 			vq->packed.used_wrap_counter);
 }
@@ -1435,8 +1469,35 @@ static void *virtqueue_get_buf_ctx_packed(struct virtqueue *_vq,
 	virtio_rmb(vq->weak_barriers);
 
 	last_used = vq->last_used_idx;
-	id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
-	*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+	if (vq->in_order) {
+		/*
+		 * The device may write a single used descriptor for a batch
+		 * of buffers, carrying the id and length of the last one.
+		 * Every buffer before it in the ring is complete as well and
+		 * is handed back with the length it was posted with.
+		 */
+		if (vq->packed.batch_last_id == vq->packed.vring.num) {
+			id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+			if (unlikely(id >= vq->packed.vring.num)) {
+				BAD_RING(vq, "id %u out of range\n", id);
+				return NULL;
+			}
+			vq->packed.batch_last_id = id;
+			vq->packed.batch_last_len =
+				le32_to_cpu(vq->packed.vring.desc[last_used].len);
+		}
+
+		id = last_used;
+		if (id == vq->packed.batch_last_id) {
+			*len = vq->packed.batch_last_len;
+			vq->packed.batch_last_id = vq->packed.vring.num;
+		} else {
+			*len = vq->packed.desc_state[id].in_len;
+		}
+	} else {
+		id = le16_to_cpu(vq->packed.vring.desc[last_used].id);
+		*len = le32_to_cpu(vq->packed.vring.desc[last_used].len);
+	}
 
 	if (unlikely(id >= vq->packed.vring.num)) {
 		BAD_RING(vq, "id %u out of range\n", id);
@@ -1528,6 +1589,9 @@ static bool virtqueue_poll_packed(struct virtqueue *_vq, u16 off_wrap)
 	bool wrap_counter;
 	u16 used_idx;
 
+	if (vq->packed.batch_last_id != vq->packed.vring.num)
+		return true;
+
 	wrap_counter = off_wrap >> VRING_PACKED_EVENT_F_WRAP_CTR;
 	used_idx = off_wrap & ~(1 << VRING_PACKED_EVENT_F_WRAP_CTR);
 
@@ -1582,9 +1646,7 @@ static bool virtqueue_enable_cb_delayed_packed(struct virtqueue *_vq)
 	 */
 	virtio_mb(vq->weak_barriers);
 
-	if (is_used_desc_packed(vq,
-				vq->last_used_idx,
-				vq->packed.used_wrap_counter)) {
+	if (more_used_packed(vq)) {
 		END_USE(vq);
 		return false;
 	}
@@ -1694,6 +1756,8 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->num_added = 0;
 	vq->packed_ring = true;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
+	vq->in_order = virtio_has_feature(vdev, VIRTIO_F_IN_ORDER);
 #ifdef DEBUG
 	vq->in_use = false;
 	vq->last_add_time_valid = false;
@@ -1723,6 +1787,7 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	vq->packed.used_wrap_counter = 1;
 	vq->packed.event_flags_shadow = 0;
 	vq->packed.avail_used_flags = 1 << VRING_PACKED_DESC_F_AVAIL;
+	vq->packed.batch_last_id = num;
 
 	vq->packed.desc_state = kmalloc_array(num,
 			sizeof(struct vring_desc_state_packed),
@@ -1740,6 +1805,13 @@ static struct virtqueue *vring_create_virtqueue_packed(
 	if (!vq->packed.desc_extra)
 		goto err_desc_extra;
 
+	/*
+	 * In order, buffer ids are ring positions, so the extra state is
+	 * walked around the ring instead of through a free list.
+	 */
+	if (vq->in_order)
+		vq->packed.desc_extra[num - 1].next = 0;
+
 	/* No callback?  Tell other side not to bother us. */
 	if (!callback) {
 		vq->packed.event_flags_shadow = VRING_PACKED_EVENT_FLAG_DISABLE;
@@ -2185,6 +2257,8 @@ struct virtqueue *__vring_new_virtqueue(unsigned int index,
 	vq->event_triggered = false;
 	vq->num_added = 0;
 	vq->use_dma_api = vring_use_dma_api(vdev);
+	vq->premapped = false;
+	vq->in_order = false;
 #ifdef DEBUG
 	vq->in_use = false;
 	vq->last_add_time_valid = false;
@@ -2347,6 +2421,11 @@ void vring_transport_features(struct virtio_device *vdev)
 			break;
 		case VIRTIO_F_ORDER_PLATFORM:
 			break;
+		case VIRTIO_F_IN_ORDER:
+			/* Only the packed ring makes use of it. */
+			if (!__virtio_test_bit(vdev, VIRTIO_F_RING_PACKED))
+				__virtio_clear_bit(vdev, i);
+			break;
 		default:
 			/* We don't understand this bit. */
 			__virtio_clear_bit(vdev, i);
@@ -2371,6 +2450,53 @@ unsigned int virtqueue_get_vring_size(struct virtqueue *_vq)
 }
 EXPORT_SYMBOL_GPL(virtqueue_get_vring_size);
 
+/**
+ * virtqueue_set_dma_premapped - let the driver own the DMA mappings
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Once set, the scatterlists passed to virtqueue_add_*() must already
+ * carry their DMA address in sg_dma_address(), mapped against
+ * virtqueue_dma_dev(), and the ring no longer unmaps them on completion.
+ * Drivers that recycle buffers can then keep them mapped across uses.
+ *
+ * Must be called while no buffers are outstanding.
+ *
+ * Returns zero, -EINVAL if the virtqueue does not use the DMA API, or
+ * -EBUSY if buffers have already been added.
+ */
+int virtqueue_set_dma_premapped(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+	int err = 0;
+
+	START_USE(vq);
+
+	if (!vq->use_dma_api)
+		err = -EINVAL;
+	else if (vq->vq.num_free != virtqueue_get_vring_size(_vq))
+		err = -EBUSY;
+	else
+		vq->premapped = true;
+
+	END_USE(vq);
+	return err;
+}
+EXPORT_SYMBOL_GPL(virtqueue_set_dma_premapped);
+
+/**
+ * virtqueue_dma_dev - get the device to map premapped buffers against
+ * @_vq: the struct virtqueue we're talking about.
+ *
+ * Returns NULL if the virtqueue does not use the DMA API.
+ */
+struct device *virtqueue_dma_dev(struct virtqueue *_vq)
+{
+	struct vring_virtqueue *vq = to_vvq(_vq);
+
+	return vq->use_dma_api ? vring_dma_dev(vq) : NULL;
+}
+EXPORT_SYMBOL_GPL(virtqueue_dma_dev);
+
 bool virtqueue_is_broken(struct virtqueue *_vq)
 {
 	struct vring_virtqueue *vq = to_vvq(_vq);
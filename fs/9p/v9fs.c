@@ -46,6 +46,8 @@ enum {
 	Opt_access, Opt_posixacl,
 	/* Lock timeout option */
 	Opt_locktimeout,
+	/* Attribute and negative dentry cache lifetimes */
+	Opt_actimeo, Opt_negtimeo,
 	/* Error token */
 	Opt_err
 };
@@ -66,6 +68,8 @@ static const match_table_t tokens = {
 	{Opt_access, "access=%s"},
 	{Opt_posixacl, "posixacl"},
 	{Opt_locktimeout, "locktimeout=%u"},
+	{Opt_actimeo, "actimeo=%u"},
+	{Opt_negtimeo, "negtimeo=%u"},
 	{Opt_err, NULL}
 };
 
@@ -147,6 +151,11 @@ int v9fs_show_options(struct seq_file *m, struct dentry *root)
 	if (v9ses->flags & V9FS_POSIX_ACL)
 		seq_puts(m, ",posixacl");
 
+	if (v9ses->attr_timeo)
+		seq_printf(m, ",actimeo=%lu", v9ses->attr_timeo / HZ);
+	if (v9ses->neg_timeo)
+		seq_printf(m, ",negtimeo=%lu", v9ses->neg_timeo / HZ);
+
 	return p9_show_client_options(m, v9ses->clnt);
 }
 
@@ -175,6 +184,8 @@ static int v9fs_parse_options(struct v9fs_session_info *v9ses, char *opts)
 	v9ses->cachetag = NULL;
 #endif
 	v9ses->session_lock_timeout = P9_LOCK_TIMEOUT;
+	v9ses->attr_timeo = 0;
+	v9ses->neg_timeo = 0;
 
 	if (!opts)
 		return 0;
@@ -367,6 +378,27 @@ static int v9fs_parse_options(struct v9fs_session_info *v9ses, char *opts)
 			v9ses->session_lock_timeout = (long)option * HZ;
 			break;
 
+		case Opt_actimeo:
+		case Opt_negtimeo:
+			r = match_int(&args[0], &option);
+			if (r < 0) {
+				p9_debug(P9_DEBUG_ERROR,
+					 "integer field, but no integer?\n");
+				ret = r;
+				continue;
+			}
+			if (option < 0) {
+				p9_debug(P9_DEBUG_ERROR,
+					 "cache timeouts must not be negative.\n");
+				ret = -EINVAL;
+				continue;
+			}
+			if (token == Opt_actimeo)
+				v9ses->attr_timeo = (unsigned long)option * HZ;
+			else
+				v9ses->neg_timeo = (unsigned long)option * HZ;
+			break;
+
 		default:
 			continue;
 		}
@@ -73,6 +73,8 @@ enum p9_cache_modes {
  * @uid: if %V9FS_ACCESS_SINGLE, the numeric uid which mounted the hierarchy
  * @clnt: reference to 9P network client instantiated for this session
  * @slist: reference to list of registered 9p sessions
+ * @attr_timeo: how long inode attributes are trusted without a refresh
+ * @neg_timeo: how long a failed lookup is trusted
  *
  * This structure holds state for each session instance established during
  * a sys_mount() .
@@ -103,6 +105,9 @@ struct v9fs_session_info {
 	struct list_head slist; /* list of sessions registered with v9fs */
 	struct rw_semaphore rename_sem;
 	long session_lock_timeout; /* retry interval for blocking locks */
+	unsigned long attr_timeo; /* attribute cache lifetime, in jiffies */
+	unsigned long neg_timeo; /* negative dentry lifetime, in jiffies */
+	struct netfs_mount_stats netfs_stats; /* read statistics */
 };
 
 /* cache_validity flags */
@@ -112,6 +117,7 @@ struct v9fs_inode {
 	struct netfs_inode netfs; /* Netfslib context and vfs inode */
 	struct p9_qid qid;
 	unsigned int cache_validity;
+	unsigned long attr_time; /* jiffies of the last attribute update */
 	struct p9_fid *writeback_fid;
 	struct mutex v_mutex;
 };
@@ -165,6 +171,9 @@ extern const struct netfs_request_ops v9fs_req_ops;
 extern struct inode *v9fs_inode_from_fid_dotl(struct v9fs_session_info *v9ses,
 					      struct p9_fid *fid,
 					      struct super_block *sb, int new);
+extern struct inode *v9fs_inode_from_stat_dotl(struct super_block *sb,
+					       struct p9_stat_dotl *st,
+					       int new);
 
 /* other default globals */
 #define V9FS_PORT	564
@@ -172,6 +181,8 @@ extern struct inode *v9fs_inode_from_fid_dotl(struct v9fs_session_info *v9ses,
 #define V9FS_DEFANAME	""
 #define V9FS_DEFUID	KUIDT_INIT(-2)
 #define V9FS_DEFGID	KGIDT_INIT(-2)
+/* number of read RPCs readahead keeps in flight per file */
+#define V9FS_READ_INFLIGHT	4
 
 static inline struct v9fs_session_info *v9fs_inode2v9ses(struct inode *inode)
 {
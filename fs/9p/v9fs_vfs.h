@@ -36,6 +36,7 @@ extern const struct file_operations v9fs_dir_operations;
 extern const struct file_operations v9fs_dir_operations_dotl;
 extern const struct dentry_operations v9fs_dentry_operations;
 extern const struct dentry_operations v9fs_cached_dentry_operations;
+extern const struct dentry_operations v9fs_ttl_dentry_operations;
 extern const struct file_operations v9fs_cached_file_operations;
 extern const struct file_operations v9fs_cached_file_operations_dotl;
 extern const struct file_operations v9fs_mmap_file_operations;
@@ -74,6 +75,20 @@ static inline void v9fs_invalidate_inode_attr(struct inode *inode)
 	v9inode->cache_validity |= V9FS_INO_INVALID_ATTR;
 }
 
+/*
+ * With actimeo= the attributes last fetched from the server are used for
+ * attr_timeo jiffies before going back to the server.
+ */
+static inline bool v9fs_inode_attr_fresh(struct inode *inode)
+{
+	struct v9fs_session_info *v9ses = v9fs_inode2v9ses(inode);
+	struct v9fs_inode *v9inode = V9FS_I(inode);
+
+	return v9ses->attr_timeo &&
+	       !(v9inode->cache_validity & V9FS_INO_INVALID_ATTR) &&
+	       time_before(jiffies, v9inode->attr_time + v9ses->attr_timeo);
+}
+
 int v9fs_open_to_dotl_flags(int flags);
 
 static inline void v9fs_i_size_write(struct inode *inode, loff_t i_size)
@@ -27,9 +27,91 @@
 #include "cache.h"
 #include "fid.h"
 
+/* Largest read payload a single RPC on @fid can carry */
+static size_t v9fs_fid_rsize(struct p9_fid *fid)
+{
+	unsigned int rsize = fid->clnt->msize - P9_IOHDRSZ;
+
+	if (fid->iounit && fid->iounit < rsize)
+		rsize = fid->iounit;
+	return rsize;
+}
+
+/**
+ * struct v9fs_read_async - an asynchronous read in flight
+ * @work: completes the read in process context
+ * @subreq: the netfs subrequest being read
+ * @req: the 9P request, once it has completed
+ */
+struct v9fs_read_async {
+	struct work_struct work;
+	struct netfs_io_subrequest *subreq;
+	struct p9_req_t *req;
+};
+
+static void v9fs_read_async_work(struct work_struct *work)
+{
+	struct v9fs_read_async *ra =
+		container_of(work, struct v9fs_read_async, work);
+	struct netfs_io_subrequest *subreq = ra->subreq;
+	struct netfs_io_request *rreq = subreq->rreq;
+	struct p9_fid *fid = rreq->netfs_priv;
+	struct iov_iter to;
+	loff_t pos = subreq->start + subreq->transferred;
+	size_t len = subreq->len   - subreq->transferred;
+	int total, err;
+
+	iov_iter_xarray(&to, READ, &rreq->mapping->i_pages, pos, len);
+
+	total = p9_client_read_async_end(fid, ra->req, &to, &err);
+	kfree(ra);
+
+	/* a short reply need not mean EOF, fetch the rest synchronously */
+	if (!err && total && iov_iter_count(&to))
+		total += p9_client_read(fid, pos + total, &to, &err);
+
+	__set_bit(NETFS_SREQ_CLEAR_TAIL, &subreq->flags);
+
+	netfs_subreq_terminated(subreq, err ?: total, false);
+}
+
+/* Called from the transport's receive path, may be in interrupt context */
+static void v9fs_read_async_done(struct p9_req_t *req, void *priv)
+{
+	struct v9fs_read_async *ra = priv;
+
+	ra->req = req;
+	queue_work(system_unbound_wq, &ra->work);
+}
+
+static bool v9fs_issue_read_async(struct netfs_io_subrequest *subreq,
+				  loff_t pos, size_t len)
+{
+	struct p9_fid *fid = subreq->rreq->netfs_priv;
+	struct v9fs_read_async *ra;
+
+	ra = kmalloc(sizeof(*ra), GFP_NOFS);
+	if (!ra)
+		return false;
+
+	INIT_WORK(&ra->work, v9fs_read_async_work);
+	ra->subreq = subreq;
+	ra->req = NULL;
+
+	if (p9_client_read_async(fid, pos, len, v9fs_read_async_done, ra)) {
+		kfree(ra);
+		return false;
+	}
+	return true;
+}
+
 /**
  * v9fs_issue_read - Issue a read from 9P
  * @subreq: The read to make
+ *
+ * Subrequests are clamped to a single RPC by v9fs_clamp_length() and are
+ * sent without waiting for the reply, so that netfs can keep several of
+ * them in flight.  Fall back to a synchronous read if that fails.
  */
 static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
 {
@@ -40,6 +122,9 @@ static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
 	size_t len = subreq->len   - subreq->transferred;
 	int total, err;
 
+	if (len <= v9fs_fid_rsize(fid) && v9fs_issue_read_async(subreq, pos, len))
+		return;
+
 	iov_iter_xarray(&to, READ, &rreq->mapping->i_pages, pos, len);
 
 	total = p9_client_read(fid, pos, &to, &err);
@@ -51,6 +136,18 @@ static void v9fs_issue_read(struct netfs_io_subrequest *subreq)
 	netfs_subreq_terminated(subreq, err ?: total, false);
 }
 
+/**
+ * v9fs_clamp_length - Limit a read to what fits in one RPC
+ * @subreq: The read to clamp
+ */
+static bool v9fs_clamp_length(struct netfs_io_subrequest *subreq)
+{
+	struct p9_fid *fid = subreq->rreq->netfs_priv;
+
+	subreq->len = min_t(size_t, subreq->len, v9fs_fid_rsize(fid));
+	return true;
+}
+
 /**
  * v9fs_init_request - Initialise a read request
  * @rreq: The read request
@@ -109,6 +206,7 @@ const struct netfs_request_ops v9fs_req_ops = {
 	.free_request		= v9fs_free_request,
 	.begin_cache_operation	= v9fs_begin_cache_operation,
 	.issue_read		= v9fs_issue_read,
+	.clamp_length		= v9fs_clamp_length,
 };
 
 /**
@@ -32,15 +32,34 @@
  */
 static int v9fs_cached_dentry_delete(const struct dentry *dentry)
 {
+	struct v9fs_session_info *v9ses = dentry->d_sb->s_fs_info;
+
 	p9_debug(P9_DEBUG_VFS, " dentry: %pd (%p)\n",
 		 dentry, dentry);
 
-	/* Don't cache negative dentries */
+	/* Only cache negative dentries if asked to with negtimeo= */
 	if (d_really_is_negative(dentry))
-		return 1;
+		return !v9ses->neg_timeo;
 	return 0;
 }
 
+/**
+ * v9fs_ttl_dentry_delete - called when dentry refcount equals 0
+ * @dentry:  dentry in question
+ *
+ * Without a cache mode, dentries are only kept around for as long as
+ * their attributes (actimeo=) or their negative lookup (negtimeo=) are
+ * trusted.
+ */
+static int v9fs_ttl_dentry_delete(const struct dentry *dentry)
+{
+	struct v9fs_session_info *v9ses = dentry->d_sb->s_fs_info;
+
+	if (d_really_is_negative(dentry))
+		return !v9ses->neg_timeo;
+	return !v9ses->attr_timeo;
+}
+
 /**
  * v9fs_dentry_release - called when dentry is going to be freed
  * @dentry:  dentry that is being release
@@ -58,6 +77,19 @@ static void v9fs_dentry_release(struct dentry *dentry)
 	dentry->d_fsdata = NULL;
 }
 
+/*
+ * A negative dentry is trusted for negtimeo= after the lookup that failed,
+ * but never for a create or rename target, which must see the server.
+ */
+static int v9fs_negative_revalidate(struct dentry *dentry, unsigned int flags)
+{
+	struct v9fs_session_info *v9ses = v9fs_dentry2v9ses(dentry);
+
+	if (flags & (LOOKUP_CREATE | LOOKUP_RENAME_TARGET))
+		return 0;
+	return time_before(jiffies, dentry->d_time + v9ses->neg_timeo);
+}
+
 static int v9fs_lookup_revalidate(struct dentry *dentry, unsigned int flags)
 {
 	struct p9_fid *fid;
@@ -68,8 +100,11 @@ static int v9fs_lookup_revalidate(struct dentry *dentry, unsigned int flags)
 		return -ECHILD;
 
 	inode = d_inode(dentry);
-	if (!inode)
+	if (!inode) {
+		if (v9fs_dentry2v9ses(dentry)->neg_timeo)
+			return v9fs_negative_revalidate(dentry, flags);
 		goto out_valid;
+	}
 
 	v9inode = V9FS_I(inode);
 	if (v9inode->cache_validity & V9FS_INO_INVALID_ATTR) {
@@ -96,6 +131,25 @@ static int v9fs_lookup_revalidate(struct dentry *dentry, unsigned int flags)
 	return 1;
 }
 
+static int v9fs_ttl_revalidate(struct dentry *dentry, unsigned int flags)
+{
+	struct v9fs_session_info *v9ses = v9fs_dentry2v9ses(dentry);
+	struct inode *inode = d_inode_rcu(dentry);
+
+	if (!inode)
+		return v9fs_negative_revalidate(dentry, flags);
+
+	/* without actimeo= keep the old behaviour of trusting dentries in use */
+	if (!v9ses->attr_timeo || v9fs_inode_attr_fresh(inode))
+		return 1;
+
+	if (flags & LOOKUP_RCU)
+		return -ECHILD;
+
+	v9fs_invalidate_inode_attr(inode);
+	return v9fs_lookup_revalidate(dentry, flags);
+}
+
 const struct dentry_operations v9fs_cached_dentry_operations = {
 	.d_revalidate = v9fs_lookup_revalidate,
 	.d_weak_revalidate = v9fs_lookup_revalidate,
@@ -103,6 +157,13 @@ const struct dentry_operations v9fs_cached_dentry_operations = {
 	.d_release = v9fs_dentry_release,
 };
 
+const struct dentry_operations v9fs_ttl_dentry_operations = {
+	.d_revalidate = v9fs_ttl_revalidate,
+	.d_weak_revalidate = v9fs_ttl_revalidate,
+	.d_delete = v9fs_ttl_dentry_delete,
+	.d_release = v9fs_dentry_release,
+};
+
 const struct dentry_operations v9fs_dentry_operations = {
 	.d_delete = always_delete_dentry,
 	.d_release = v9fs_dentry_release,
@@ -29,6 +29,7 @@
  * struct p9_rdir - readdir accounting
  * @head: start offset of current dirread buffer
  * @tail: end offset of current dirread buffer
+ * @plus: the buffer holds Rreaddirplus entries
  * @buf: dirread buffer
  *
  * private structure for keeping track of readdir
@@ -38,6 +39,7 @@
 struct p9_rdir {
 	int head;
 	int tail;
+	bool plus;
 	uint8_t buf[];
 };
 
@@ -140,6 +142,78 @@ static int v9fs_dir_readdir(struct file *file, struct dir_context *ctx)
 	}
 }
 
+static bool v9fs_dir_cached(struct v9fs_session_info *v9ses)
+{
+	return v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE;
+}
+
+/*
+ * Priming the dcache from readdirplus only pays off when dentries stick
+ * around, and inodes can't be set up without a fid on posixacl mounts.
+ */
+static bool v9fs_dir_want_plus(struct v9fs_session_info *v9ses)
+{
+	if ((v9ses->flags & V9FS_ACL_MASK) == V9FS_POSIX_ACL)
+		return false;
+	return v9fs_dir_cached(v9ses) || v9ses->attr_timeo;
+}
+
+/**
+ * v9fs_dir_prime - instantiate a dentry from a readdirplus entry
+ * @parent: directory being read
+ * @dirent: the entry
+ * @st: attributes of the entry
+ *
+ * Existing dentries get their attributes refreshed, missing ones are
+ * created without a fid so that a later lookup or stat of the entry does
+ * not need to go to the server.
+ */
+static void v9fs_dir_prime(struct dentry *parent, struct p9_dirent *dirent,
+			   struct p9_stat_dotl *st)
+{
+	DECLARE_WAIT_QUEUE_HEAD_ONSTACK(wq);
+	struct v9fs_session_info *v9ses = v9fs_dentry2v9ses(parent);
+	struct qstr name = QSTR_INIT(dirent->d_name, strlen(dirent->d_name));
+	struct dentry *dentry, *alias;
+	struct inode *inode;
+
+	if ((st->st_result_mask & P9_STATS_BASIC) != P9_STATS_BASIC)
+		return;
+	if (name.len > NAME_MAX || (name.name[0] == '.' &&
+	    (name.len == 1 || (name.len == 2 && name.name[1] == '.'))))
+		return;
+	name.hash = full_name_hash(parent, name.name, name.len);
+
+	dentry = d_lookup(parent, &name);
+	if (!dentry) {
+		dentry = d_alloc_parallel(parent, &name, &wq);
+		if (IS_ERR(dentry))
+			return;
+	}
+
+	if (!d_in_lookup(dentry)) {
+		inode = d_inode(dentry);
+		if (!inode)
+			/* a stale negative dentry, see negtimeo= */
+			d_invalidate(dentry);
+		else if (V9FS_I(inode)->qid.path == st->qid.path &&
+			 !inode_wrong_type(inode, st->st_mode))
+			v9fs_stat2inode_dotl(st, inode,
+					     v9fs_dir_cached(v9ses) ?
+					     V9FS_STAT2INODE_KEEP_ISIZE : 0);
+		dput(dentry);
+		return;
+	}
+
+	inode = v9fs_inode_from_stat_dotl(parent->d_sb, st,
+					  !v9fs_dir_cached(v9ses));
+	alias = d_splice_alias(inode, dentry);
+	d_lookup_done(dentry);
+	if (alias && !IS_ERR(alias))
+		dput(alias);
+	dput(dentry);
+}
+
 /**
  * v9fs_dir_readdir_dotl - iterate through a directory
  * @file: opened file structure
@@ -153,9 +227,12 @@ static int v9fs_dir_readdir_dotl(struct file *file, struct dir_context *ctx)
 	int buflen;
 	struct p9_rdir *rdir;
 	struct p9_dirent curdirent;
+	struct p9_stat_dotl st;
+	bool want_plus;
 
 	p9_debug(P9_DEBUG_VFS, "name %pD\n", file);
 	fid = file->private_data;
+	want_plus = v9fs_dir_want_plus(v9fs_inode2v9ses(file_inode(file)));
 
 	buflen = fid->clnt->msize - P9_READDIRHDRSZ;
 
@@ -165,8 +242,16 @@ static int v9fs_dir_readdir_dotl(struct file *file, struct dir_context *ctx)
 
 	while (1) {
 		if (rdir->tail == rdir->head) {
-			err = p9_client_readdir(fid, rdir->buf, buflen,
-						ctx->pos);
+			err = -EOPNOTSUPP;
+			if (want_plus)
+				err = p9_client_readdirplus(fid, rdir->buf,
+							    buflen, ctx->pos,
+							    P9_STATS_BASIC |
+							    P9_STATS_GEN);
+			rdir->plus = err != -EOPNOTSUPP;
+			if (!rdir->plus)
+				err = p9_client_readdir(fid, rdir->buf, buflen,
+							ctx->pos);
 			if (err <= 0)
 				return err;
 
@@ -176,9 +261,16 @@ static int v9fs_dir_readdir_dotl(struct file *file, struct dir_context *ctx)
 
 		while (rdir->head < rdir->tail) {
 
-			err = p9dirent_read(fid->clnt, rdir->buf + rdir->head,
-					    rdir->tail - rdir->head,
-					    &curdirent);
+			if (rdir->plus)
+				err = p9dirent_read_plus(fid->clnt,
+							 rdir->buf + rdir->head,
+							 rdir->tail - rdir->head,
+							 &curdirent, &st);
+			else
+				err = p9dirent_read(fid->clnt,
+						    rdir->buf + rdir->head,
+						    rdir->tail - rdir->head,
+						    &curdirent);
 			if (err < 0) {
 				p9_debug(P9_DEBUG_VFS, "returned %d\n", err);
 				return -EIO;
@@ -190,6 +282,10 @@ static int v9fs_dir_readdir_dotl(struct file *file, struct dir_context *ctx)
 				      curdirent.d_type))
 				return 0;
 
+			if (rdir->plus)
+				v9fs_dir_prime(file->f_path.dentry,
+					       &curdirent, &st);
+
 			ctx->pos = curdirent.d_off;
 			rdir->head += err;
 		}
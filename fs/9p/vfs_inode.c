@@ -226,6 +226,7 @@ v9fs_blank_wstat(struct p9_wstat *wstat)
  */
 struct inode *v9fs_alloc_inode(struct super_block *sb)
 {
+	struct v9fs_session_info *v9ses = sb->s_fs_info;
 	struct v9fs_inode *v9inode;
 
 	v9inode = alloc_inode_sb(sb, v9fs_inode_cache, GFP_KERNEL);
@@ -233,6 +234,8 @@ struct inode *v9fs_alloc_inode(struct super_block *sb)
 		return NULL;
 	v9inode->writeback_fid = NULL;
 	v9inode->cache_validity = 0;
+	/* not fresh until the attributes have been fetched */
+	v9inode->attr_time = jiffies - v9ses->attr_timeo - 1;
 	mutex_init(&v9inode->v_mutex);
 	return &v9inode->netfs.inode;
 }
@@ -254,6 +257,7 @@ static void v9fs_set_netfs_context(struct inode *inode)
 {
 	struct v9fs_inode *v9inode = V9FS_I(inode);
 	netfs_inode_init(&v9inode->netfs, &v9fs_req_ops);
+	v9inode->netfs.stats = &v9fs_inode2v9ses(inode)->netfs_stats;
 }
 
 int v9fs_init_inode(struct v9fs_session_info *v9ses,
@@ -786,9 +790,11 @@ struct dentry *v9fs_vfs_lookup(struct inode *dir, struct dentry *dentry,
 	name = dentry->d_name.name;
 	fid = p9_client_walk(dfid, 1, &name, 1);
 	p9_client_clunk(dfid);
-	if (fid == ERR_PTR(-ENOENT))
+	if (fid == ERR_PTR(-ENOENT)) {
 		inode = NULL;
-	else if (IS_ERR(fid))
+		/* start the negative dentry lifetime, see negtimeo= */
+		dentry->d_time = jiffies;
+	} else if (IS_ERR(fid))
 		inode = ERR_CAST(fid);
 	else if (v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE)
 		inode = v9fs_get_inode_from_fid(v9ses, fid, dir->i_sb);
@@ -1051,7 +1057,8 @@ v9fs_vfs_getattr(struct user_namespace *mnt_userns, const struct path *path,
 
 	p9_debug(P9_DEBUG_VFS, "dentry: %p\n", dentry);
 	v9ses = v9fs_dentry2v9ses(dentry);
-	if (v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE) {
+	if (v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE ||
+	    v9fs_inode_attr_fresh(d_inode(dentry))) {
 		generic_fillattr(&init_user_ns, d_inode(dentry), stat);
 		return 0;
 	}
@@ -1209,6 +1216,7 @@ v9fs_stat2inode(struct p9_wstat *stat, struct inode *inode,
 	/* not real number of blocks, but 512 byte ones ... */
 	inode->i_blocks = (stat->length + 512 - 1) >> 9;
 	v9inode->cache_validity &= ~V9FS_INO_INVALID_ATTR;
+	v9inode->attr_time = jiffies;
 }
 
 /**
@@ -143,6 +143,21 @@ static struct inode *v9fs_qid_iget_dotl(struct super_block *sb,
 
 }
 
+/**
+ * v9fs_inode_from_stat_dotl - get an inode from attributes already at hand
+ * @sb: superblock the inode belongs to
+ * @st: attributes of the inode, e.g. from Rreaddirplus
+ * @new: whether to always allocate a new inode
+ *
+ * There is no fid to fetch ACLs with, so this must not be used on
+ * posixacl mounts.
+ */
+struct inode *v9fs_inode_from_stat_dotl(struct super_block *sb,
+					struct p9_stat_dotl *st, int new)
+{
+	return v9fs_qid_iget_dotl(sb, &st->qid, NULL, st, new);
+}
+
 struct inode *
 v9fs_inode_from_fid_dotl(struct v9fs_session_info *v9ses, struct p9_fid *fid,
 			 struct super_block *sb, int new)
@@ -476,7 +491,8 @@ v9fs_vfs_getattr_dotl(struct user_namespace *mnt_userns,
 
 	p9_debug(P9_DEBUG_VFS, "dentry: %p\n", dentry);
 	v9ses = v9fs_dentry2v9ses(dentry);
-	if (v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE) {
+	if (v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE ||
+	    v9fs_inode_attr_fresh(d_inode(dentry))) {
 		generic_fillattr(&init_user_ns, d_inode(dentry), stat);
 		return 0;
 	}
@@ -699,6 +715,7 @@ v9fs_stat2inode_dotl(struct p9_stat_dotl *stat, struct inode *inode,
 	 * because the inode structure does not have fields for them.
 	 */
 	v9inode->cache_validity &= ~V9FS_INO_INVALID_ATTR;
+	v9inode->attr_time = jiffies;
 }
 
 static int
@@ -81,7 +81,9 @@ v9fs_fill_super(struct super_block *sb, struct v9fs_session_info *v9ses,
 		sb->s_bdi->ra_pages = 0;
 		sb->s_bdi->io_pages = 0;
 	} else {
-		sb->s_bdi->ra_pages = v9ses->maxdata >> PAGE_SHIFT;
+		/* let readahead cover several RPCs so they run in parallel */
+		sb->s_bdi->ra_pages = (V9FS_READ_INFLIGHT *
+				       (unsigned long)v9ses->maxdata) >> PAGE_SHIFT;
 		sb->s_bdi->io_pages = v9ses->maxdata >> PAGE_SHIFT;
 	}
 
@@ -140,6 +142,8 @@ static struct dentry *v9fs_mount(struct file_system_type *fs_type, int flags,
 
 	if (v9ses->cache == CACHE_LOOSE || v9ses->cache == CACHE_FSCACHE)
 		sb->s_d_op = &v9fs_cached_dentry_operations;
+	else if (v9ses->attr_timeo || v9ses->neg_timeo)
+		sb->s_d_op = &v9fs_ttl_dentry_operations;
 	else
 		sb->s_d_op = &v9fs_dentry_operations;
 
@@ -338,12 +342,21 @@ static int v9fs_write_inode_dotl(struct inode *inode,
 	return 0;
 }
 
+static int v9fs_show_stats(struct seq_file *m, struct dentry *root)
+{
+	struct v9fs_session_info *v9ses = root->d_sb->s_fs_info;
+
+	netfs_mount_stats_show(m, &v9ses->netfs_stats);
+	return 0;
+}
+
 static const struct super_operations v9fs_super_ops = {
 	.alloc_inode = v9fs_alloc_inode,
 	.free_inode = v9fs_free_inode,
 	.statfs = simple_statfs,
 	.evict_inode = v9fs_evict_inode,
 	.show_options = v9fs_show_options,
+	.show_stats = v9fs_show_stats,
 	.umount_begin = v9fs_umount_begin,
 	.write_inode = v9fs_write_inode,
 };
@@ -355,6 +368,7 @@ static const struct super_operations v9fs_super_ops_dotl = {
 	.drop_inode = v9fs_drop_inode,
 	.evict_inode = v9fs_evict_inode,
 	.show_options = v9fs_show_options,
+	.show_stats = v9fs_show_stats,
 	.umount_begin = v9fs_umount_begin,
 	.write_inode = v9fs_write_inode_dotl,
 };
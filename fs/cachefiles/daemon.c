@@ -19,6 +19,7 @@
 #include <linux/ctype.h>
 #include <linux/string.h>
 #include <linux/fs_struct.h>
+#include <linux/io_uring.h>
 #include "internal.h"
 
 static int cachefiles_daemon_open(struct inode *, struct file *);
@@ -27,6 +28,7 @@ static ssize_t cachefiles_daemon_read(struct file *, char __user *, size_t,
 				      loff_t *);
 static ssize_t cachefiles_daemon_write(struct file *, const char __user *,
 				       size_t, loff_t *);
+static int cachefiles_daemon_uring_cmd(struct io_uring_cmd *, unsigned int);
 static __poll_t cachefiles_daemon_poll(struct file *,
 					   struct poll_table_struct *);
 static int cachefiles_daemon_frun(struct cachefiles_cache *, char *);
@@ -53,6 +55,7 @@ const struct file_operations cachefiles_daemon_fops = {
 	.read		= cachefiles_daemon_read,
 	.write		= cachefiles_daemon_write,
 	.poll		= cachefiles_daemon_poll,
+	.uring_cmd	= cachefiles_daemon_uring_cmd,
 	.llseek		= noop_llseek,
 };
 
@@ -157,7 +160,7 @@ static void cachefiles_flush_reqs(struct cachefiles_cache *cache)
 	xa_lock(xa);
 	xa_for_each(xa, index, req) {
 		req->error = -EIO;
-		complete(&req->done);
+		cachefiles_req_done(req);
 	}
 	xa_unlock(xa);
 
@@ -269,6 +272,20 @@ static ssize_t cachefiles_daemon_read(struct file *file, char __user *_buffer,
 		return cachefiles_do_daemon_read(cache, _buffer, buflen);
 }
 
+/*
+ * Fetch on-demand requests through io_uring
+ */
+static int cachefiles_daemon_uring_cmd(struct io_uring_cmd *ioucmd,
+				       unsigned int issue_flags)
+{
+	struct cachefiles_cache *cache = ioucmd->file->private_data;
+
+	if (!cachefiles_in_ondemand_mode(cache))
+		return -EOPNOTSUPP;
+
+	return cachefiles_ondemand_daemon_uring_cmd(cache, ioucmd, issue_flags);
+}
+
 /*
  * Take a command from cachefilesd, parse it and act on it.
  */
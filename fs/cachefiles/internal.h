@@ -124,12 +124,31 @@ static inline bool cachefiles_in_ondemand_mode(struct cachefiles_cache *cache)
 struct cachefiles_req {
 	struct cachefiles_object *object;
 	struct completion done;
+	/*
+	 * READ requests merged into this one before it was read by the daemon,
+	 * or the link into such a list for a merged request.
+	 */
+	struct list_head merged;
 	int error;
 	struct cachefiles_msg msg;
 };
 
 #define CACHEFILES_REQ_NEW	XA_MARK_1
 
+/*
+ * Complete an on-demand request together with the requests merged into it.
+ */
+static inline void cachefiles_req_done(struct cachefiles_req *req)
+{
+	struct cachefiles_req *m, *tmp;
+
+	list_for_each_entry_safe(m, tmp, &req->merged, merged) {
+		m->error = req->error;
+		complete(&m->done);
+	}
+	complete(&req->done);
+}
+
 #include <trace/events/cachefiles.h>
 
 static inline
@@ -295,6 +314,10 @@ extern void cachefiles_ondemand_clean_object(struct cachefiles_object *object);
 extern int cachefiles_ondemand_read(struct cachefiles_object *object,
 				    loff_t pos, size_t len);
 
+extern int cachefiles_ondemand_daemon_uring_cmd(struct cachefiles_cache *cache,
+						struct io_uring_cmd *ioucmd,
+						unsigned int issue_flags);
+
 #else
 static inline ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
 					char __user *_buffer, size_t buflen)
@@ -316,6 +339,13 @@ static inline int cachefiles_ondemand_read(struct cachefiles_object *object,
 {
 	return -EOPNOTSUPP;
 }
+
+static inline int cachefiles_ondemand_daemon_uring_cmd(struct cachefiles_cache *cache,
+						       struct io_uring_cmd *ioucmd,
+						       unsigned int issue_flags)
+{
+	return -EOPNOTSUPP;
+}
 #endif
 
 /*
@@ -2,8 +2,15 @@
 #include <linux/fdtable.h>
 #include <linux/anon_inodes.h>
 #include <linux/uio.h>
+#include <linux/io_uring.h>
 #include "internal.h"
 
+/* upper bound of the range a merged READ request may cover */
+#define CACHEFILES_ONDEMAND_MERGE_MAX	SZ_1M
+
+/* number of ids copied in at a time for a batched READ completion */
+#define CACHEFILES_CREAD_BATCH		64
+
 static int cachefiles_ondemand_fd_release(struct inode *inode,
 					  struct file *file)
 {
@@ -23,7 +30,7 @@ static int cachefiles_ondemand_fd_release(struct inode *inode,
 	xas_for_each(&xas, req, ULONG_MAX) {
 		if (req->msg.opcode == CACHEFILES_OP_READ) {
 			req->error = -EIO;
-			complete(&req->done);
+			cachefiles_req_done(req);
 			xas_store(&xas, NULL);
 		}
 	}
@@ -76,28 +83,96 @@ static loff_t cachefiles_ondemand_fd_llseek(struct file *filp, loff_t pos,
 	return vfs_llseek(file, pos, whence);
 }
 
+static int cachefiles_ondemand_cread(struct cachefiles_object *object,
+				     unsigned long id)
+{
+	struct cachefiles_cache *cache = object->volume->cache;
+	struct cachefiles_req *req;
+
+	req = xa_erase(&cache->reqs, id);
+	if (!req)
+		return -EINVAL;
+
+	trace_cachefiles_ondemand_cread(object, id);
+	cachefiles_req_done(req);
+	return 0;
+}
+
+static int cachefiles_ondemand_cread_batch(struct cachefiles_object *object,
+					   u64 uids, u32 nr)
+{
+	u32 __user *p = u64_to_user_ptr(uids);
+	u32 ids[CACHEFILES_CREAD_BATCH];
+	unsigned int i, n;
+	int ret = 0;
+
+	while (nr) {
+		n = min_t(u32, nr, ARRAY_SIZE(ids));
+		if (copy_from_user(ids, p, n * sizeof(*ids)))
+			return -EFAULT;
+
+		for (i = 0; i < n; i++)
+			if (cachefiles_ondemand_cread(object, ids[i]))
+				ret = -EINVAL;
+
+		p += n;
+		nr -= n;
+	}
+
+	return ret;
+}
+
 static long cachefiles_ondemand_fd_ioctl(struct file *filp, unsigned int ioctl,
 					 unsigned long arg)
 {
 	struct cachefiles_object *object = filp->private_data;
 	struct cachefiles_cache *cache = object->volume->cache;
-	struct cachefiles_req *req;
-	unsigned long id;
+	struct cachefiles_cread_batch batch;
 
-	if (ioctl != CACHEFILES_IOC_READ_COMPLETE)
+	if (ioctl != CACHEFILES_IOC_READ_COMPLETE &&
+	    ioctl != CACHEFILES_IOC_READ_COMPLETE_BATCH)
 		return -EINVAL;
 
 	if (!test_bit(CACHEFILES_ONDEMAND_MODE, &cache->flags))
 		return -EOPNOTSUPP;
 
-	id = arg;
-	req = xa_erase(&cache->reqs, id);
-	if (!req)
+	if (ioctl == CACHEFILES_IOC_READ_COMPLETE)
+		return cachefiles_ondemand_cread(object, arg);
+
+	if (copy_from_user(&batch, (void __user *)arg, sizeof(batch)))
+		return -EFAULT;
+	if (batch.__reserved)
 		return -EINVAL;
 
-	trace_cachefiles_ondemand_cread(object, id);
-	complete(&req->done);
-	return 0;
+	return cachefiles_ondemand_cread_batch(object, batch.ids, batch.nr);
+}
+
+/*
+ * READ request completion through io_uring, which saves the daemon one
+ * syscall per completion.  The payload lives in the SQE command area.
+ */
+static int cachefiles_ondemand_fd_uring_cmd(struct io_uring_cmd *ioucmd,
+					    unsigned int issue_flags)
+{
+	struct cachefiles_object *object = ioucmd->file->private_data;
+	struct cachefiles_cache *cache = object->volume->cache;
+	const struct cachefiles_cread_batch *batch = ioucmd->cmd;
+
+	if (!test_bit(CACHEFILES_ONDEMAND_MODE, &cache->flags))
+		return -EOPNOTSUPP;
+
+	switch (ioucmd->cmd_op) {
+	case CACHEFILES_IOC_READ_COMPLETE:
+		return cachefiles_ondemand_cread(object,
+				READ_ONCE(*(const u32 *)ioucmd->cmd));
+	case CACHEFILES_IOC_READ_COMPLETE_BATCH:
+		if (READ_ONCE(batch->__reserved))
+			return -EINVAL;
+		return cachefiles_ondemand_cread_batch(object,
+				READ_ONCE(batch->ids), READ_ONCE(batch->nr));
+	default:
+		return -EINVAL;
+	}
 }
 
 static const struct file_operations cachefiles_ondemand_fd_fops = {
@@ -106,6 +181,7 @@ static const struct file_operations cachefiles_ondemand_fd_fops = {
 	.write_iter	= cachefiles_ondemand_fd_write_iter,
 	.llseek		= cachefiles_ondemand_fd_llseek,
 	.unlocked_ioctl	= cachefiles_ondemand_fd_ioctl,
+	.uring_cmd	= cachefiles_ondemand_fd_uring_cmd,
 };
 
 /*
@@ -172,7 +248,7 @@ int cachefiles_ondemand_copen(struct cachefiles_cache *cache, char *args)
 	trace_cachefiles_ondemand_copen(req->object, id, size);
 
 out:
-	complete(&req->done);
+	cachefiles_req_done(req);
 	return ret;
 }
 
@@ -229,22 +305,31 @@ static int cachefiles_ondemand_get_fd(struct cachefiles_req *req)
 	return ret;
 }
 
-ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
-					char __user *_buffer, size_t buflen)
+/*
+ * Hand one new request to the daemon.  With @reads_only set, only READ
+ * requests are considered; that is how a batch is filled up after the first
+ * message.  The search starts at *@start, which is advanced past the request
+ * that was found.
+ */
+static ssize_t __cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
+		char __user *_buffer, size_t buflen, unsigned long *start,
+		bool reads_only)
 {
 	struct cachefiles_req *req;
 	struct cachefiles_msg *msg;
 	unsigned long id = 0;
 	size_t n;
 	int ret = 0;
-	XA_STATE(xas, &cache->reqs, 0);
+	XA_STATE(xas, &cache->reqs, *start);
 
 	/*
 	 * Search for a request that has not ever been processed, to prevent
 	 * requests from being processed repeatedly.
 	 */
 	xa_lock(&cache->reqs);
-	req = xas_find_marked(&xas, UINT_MAX, CACHEFILES_REQ_NEW);
+	xas_for_each_marked(&xas, req, UINT_MAX, CACHEFILES_REQ_NEW)
+		if (!reads_only || req->msg.opcode == CACHEFILES_OP_READ)
+			break;
 	if (!req) {
 		xa_unlock(&cache->reqs);
 		return 0;
@@ -263,6 +348,7 @@ ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
 
 	id = xas.xa_index;
 	msg->msg_id = id;
+	*start = id + 1;
 
 	if (msg->opcode == CACHEFILES_OP_OPEN) {
 		ret = cachefiles_ondemand_get_fd(req);
@@ -289,10 +375,124 @@ ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
 error:
 	xa_erase(&cache->reqs, id);
 	req->error = ret;
-	complete(&req->done);
+	cachefiles_req_done(req);
 	return ret;
 }
 
+/*
+ * Read requests, packing as many further READ requests as fit into the
+ * buffer after the first message if @batch is set.
+ */
+static ssize_t cachefiles_ondemand_read_reqs(struct cachefiles_cache *cache,
+		char __user *_buffer, size_t buflen, bool batch)
+{
+	unsigned long start = 0;
+	ssize_t n, copied;
+
+	copied = __cachefiles_ondemand_daemon_read(cache, _buffer, buflen,
+						   &start, false);
+	if (copied <= 0 || !batch)
+		return copied;
+
+	while (copied + sizeof(struct cachefiles_msg) +
+	       sizeof(struct cachefiles_read) <= buflen) {
+		n = __cachefiles_ondemand_daemon_read(cache, _buffer + copied,
+				buflen - copied, &start, true);
+		if (n <= 0)
+			break;
+		copied += n;
+	}
+
+	return copied;
+}
+
+ssize_t cachefiles_ondemand_daemon_read(struct cachefiles_cache *cache,
+					char __user *_buffer, size_t buflen)
+{
+	return cachefiles_ondemand_read_reqs(cache, _buffer, buflen, false);
+}
+
+/*
+ * Fetch requests through io_uring.  The command is retried from io-wq when
+ * there is nothing to read yet, where it sleeps until a request is enqueued;
+ * cancellation of the ring interrupts that sleep.
+ */
+int cachefiles_ondemand_daemon_uring_cmd(struct cachefiles_cache *cache,
+					 struct io_uring_cmd *ioucmd,
+					 unsigned int issue_flags)
+{
+	const struct cachefiles_uring_read *cmd = ioucmd->cmd;
+	char __user *buf = u64_to_user_ptr(READ_ONCE(cmd->buf));
+	size_t len = READ_ONCE(cmd->len);
+	u32 flags = READ_ONCE(cmd->flags);
+	ssize_t ret;
+
+	if (ioucmd->cmd_op != CACHEFILES_URING_CMD_READ)
+		return -EINVAL;
+	if (flags & ~CACHEFILES_URING_READ_BATCH)
+		return -EINVAL;
+
+	if (!test_bit(CACHEFILES_READY, &cache->flags))
+		return 0;
+
+	for (;;) {
+		ret = cachefiles_ondemand_read_reqs(cache, buf, len,
+				flags & CACHEFILES_URING_READ_BATCH);
+		if (ret)
+			return ret;
+
+		if (issue_flags & IO_URING_F_NONBLOCK)
+			return -EAGAIN;
+
+		if (wait_event_interruptible(cache->daemon_pollwq,
+				xa_marked(&cache->reqs, CACHEFILES_REQ_NEW) ||
+				test_bit(CACHEFILES_DEAD, &cache->flags)))
+			return -EINTR;
+
+		if (test_bit(CACHEFILES_DEAD, &cache->flags))
+			return -EIO;
+	}
+}
+
+/*
+ * Merge a READ request into a pending one for the same object that the daemon
+ * hasn't picked up yet, if their ranges are adjacent.  The caller then only
+ * waits for the completion of the request it was merged into.
+ *
+ * Must be called with the xarray lock held.
+ */
+static bool cachefiles_ondemand_merge_read(struct cachefiles_cache *cache,
+					   struct cachefiles_req *req)
+{
+	struct cachefiles_read *load = (void *)req->msg.data, *pload;
+	struct cachefiles_req *prev;
+	XA_STATE(xas, &cache->reqs, 0);
+
+	xas_for_each_marked(&xas, prev, UINT_MAX, CACHEFILES_REQ_NEW) {
+		if (prev->object != req->object ||
+		    prev->msg.opcode != CACHEFILES_OP_READ)
+			continue;
+
+		pload = (void *)prev->msg.data;
+		if (pload->len + load->len > CACHEFILES_ONDEMAND_MERGE_MAX)
+			continue;
+
+		if (pload->off + pload->len == load->off) {
+			pload->len += load->len;
+		} else if (load->off + load->len == pload->off) {
+			pload->off = load->off;
+			pload->len += load->len;
+		} else {
+			continue;
+		}
+
+		list_add_tail(&req->merged, &prev->merged);
+		return true;
+	}
+
+	return false;
+}
+
 typedef int (*init_req_fn)(struct cachefiles_req *req, void *private);
 
 static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
@@ -304,6 +504,7 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 	struct cachefiles_cache *cache = object->volume->cache;
 	struct cachefiles_req *req;
 	XA_STATE(xas, &cache->reqs, 0);
+	bool merged = false;
 	int ret;
 
 	if (!test_bit(CACHEFILES_ONDEMAND_MODE, &cache->flags))
@@ -318,6 +519,7 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 
 	req->object = object;
 	init_completion(&req->done);
+	INIT_LIST_HEAD(&req->merged);
 	req->msg.opcode = opcode;
 	req->msg.len = sizeof(struct cachefiles_msg) + data_len;
 
@@ -359,6 +561,13 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 			goto out;
 		}
 
+		if (opcode == CACHEFILES_OP_READ &&
+		    cachefiles_ondemand_merge_read(cache, req)) {
+			merged = true;
+			xas_unlock(&xas);
+			continue;
+		}
+
 		xas.xa_index = 0;
 		xas_find_marked(&xas, UINT_MAX, XA_FREE_MARK);
 		if (xas.xa_node == XAS_RESTART)
@@ -373,7 +582,8 @@ static int cachefiles_ondemand_send_req(struct cachefiles_object *object,
 	if (ret)
 		goto out;
 
-	wake_up_all(&cache->daemon_pollwq);
+	if (!merged)
+		wake_up_all(&cache->daemon_pollwq);
 	wait_for_completion(&req->done);
 	ret = req->error;
 out:
@@ -408,10 +408,93 @@ static void erofs_fscache_readahead(struct readahead_control *rac)
 	} while (ret > 0 && ((done += ret) < len));
 }
 
+/*
+ * Batch a contiguous run of metadata folios into a single request, so that
+ * the daemon sees one on-demand READ for the whole range instead of one per
+ * folio.  Fall back to per-folio reads if the range crosses a device.
+ */
+static void erofs_fscache_meta_readahead(struct readahead_control *rac)
+{
+	struct super_block *sb = rac->mapping->host->i_sb;
+	struct netfs_io_request *rreq;
+	loff_t start = readahead_pos(rac);
+	size_t len = readahead_length(rac);
+	struct erofs_map_dev mdev, mend;
+	struct folio *folio;
+
+	if (!len)
+		return;
+
+	mdev = (struct erofs_map_dev) {
+		.m_deviceid = 0,
+		.m_pa = start,
+	};
+	mend = (struct erofs_map_dev) {
+		.m_deviceid = 0,
+		.m_pa = start + len - 1,
+	};
+	if (erofs_map_dev(sb, &mdev) || erofs_map_dev(sb, &mend) ||
+	    mdev.m_fscache != mend.m_fscache ||
+	    mend.m_pa - mdev.m_pa != len - 1)
+		goto fallback;
+
+	rreq = erofs_fscache_alloc_request(rac->mapping, start, len);
+	if (IS_ERR(rreq))
+		goto fallback;
+
+	/*
+	 * Drop the ref of folios here. Unlock them in
+	 * rreq_unlock_folios() when rreq complete.
+	 */
+	erofs_fscache_advance_folios(rac, len, false);
+	erofs_fscache_read_folios_async(mdev.m_fscache->cookie, rreq,
+					mdev.m_pa);
+	return;
+fallback:
+	while ((folio = readahead_folio(rac)))
+		erofs_fscache_meta_read_folio(NULL, folio);
+}
+
 static const struct address_space_operations erofs_fscache_meta_aops = {
 	.read_folio = erofs_fscache_meta_read_folio,
+	.readahead = erofs_fscache_meta_readahead,
 };
 
+/*
+ * Populate the cache for the byte range [@pos, @pos + @len) of the primary
+ * blob ahead of use.  Reads are issued asynchronously through the metadata
+ * mapping; folios already cached are skipped.
+ */
+int erofs_fscache_prefetch(struct erofs_sb_info *sbi, erofs_off_t pos,
+			   erofs_off_t len)
+{
+	struct erofs_fscache *ctx = sbi->s_fscache;
+	struct address_space *mapping;
+	pgoff_t index, end;
+
+	if (!ctx || !ctx->inode)
+		return -EOPNOTSUPP;
+	if (!len)
+		return 0;
+
+	mapping = ctx->inode->i_mapping;
+	index = pos >> PAGE_SHIFT;
+	end = (pos + len - 1) >> PAGE_SHIFT;
+
+	while (index <= end) {
+		unsigned long nr = min_t(unsigned long, end - index + 1,
+					 SZ_1M >> PAGE_SHIFT);
+		DEFINE_READAHEAD(ractl, NULL, NULL, mapping, index);
+
+		page_cache_ra_unbounded(&ractl, nr, 0);
+		index += nr;
+		if (fatal_signal_pending(current))
+			return -EINTR;
+		cond_resched();
+	}
+	return 0;
+}
+
 const struct address_space_operations erofs_fscache_access_aops = {
 	.read_folio = erofs_fscache_read_folio,
 	.readahead = erofs_fscache_readahead,
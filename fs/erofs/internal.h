@@ -615,6 +615,9 @@ int erofs_fscache_register_cookie(struct super_block *sb,
 				  char *name, bool need_inode);
 void erofs_fscache_unregister_cookie(struct erofs_fscache **fscache);
 
+int erofs_fscache_prefetch(struct erofs_sb_info *sbi, erofs_off_t pos,
+			   erofs_off_t len);
+
 extern const struct address_space_operations erofs_fscache_access_aops;
 #else
 static inline int erofs_fscache_register_fs(struct super_block *sb)
@@ -633,6 +636,12 @@ static inline int erofs_fscache_register_cookie(struct super_block *sb,
 static inline void erofs_fscache_unregister_cookie(struct erofs_fscache **fscache)
 {
 }
+
+static inline int erofs_fscache_prefetch(struct erofs_sb_info *sbi,
+					 erofs_off_t pos, erofs_off_t len)
+{
+	return -EOPNOTSUPP;
+}
 #endif
 
 #define EFSCORRUPTED    EUCLEAN         /* Filesystem is corrupted */
@@ -12,6 +12,7 @@ enum {
 	attr_feature,
 	attr_pointer_ui,
 	attr_pointer_bool,
+	attr_prefetch,
 };
 
 enum {
@@ -58,10 +59,16 @@ static struct erofs_attr erofs_attr_##_name = {			\
 #ifdef CONFIG_EROFS_FS_ZIP
 EROFS_ATTR_RW_UI(sync_decompress, erofs_mount_opts);
 #endif
+#ifdef CONFIG_EROFS_FS_ONDEMAND
+EROFS_ATTR_FUNC(prefetch, 0200);
+#endif
 
 static struct attribute *erofs_attrs[] = {
 #ifdef CONFIG_EROFS_FS_ZIP
 	ATTR_LIST(sync_decompress),
+#endif
+#ifdef CONFIG_EROFS_FS_ONDEMAND
+	ATTR_LIST(prefetch),
 #endif
 	NULL,
 };
@@ -159,6 +166,17 @@ static ssize_t erofs_attr_store(struct kobject *kobj, struct attribute *attr,
 			return -EINVAL;
 		*(bool *)ptr = !!t;
 		return len;
+	case attr_prefetch: {
+		unsigned long long pos, count;
+
+		/* "<offset> <length>" in bytes of the primary blob */
+		if (sscanf(buf, "%llu %llu", &pos, &count) != 2)
+			return -EINVAL;
+		if (pos + count < pos)
+			return -ERANGE;
+		ret = erofs_fscache_prefetch(sbi, pos, count);
+		return ret ? ret : len;
+	}
 	}
 	return 0;
 }
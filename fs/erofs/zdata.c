@@ -994,8 +994,48 @@ static int z_erofs_decompress_pcluster(struct super_block *sb,
 	return err;
 }
 
+struct z_erofs_decompress_job {
+	struct work_struct work;
+	struct super_block *sb;
+	struct z_erofs_pcluster *pcl;
+};
+
+static void z_erofs_decompress_job_work(struct work_struct *work)
+{
+	struct z_erofs_decompress_job *job =
+		container_of(work, struct z_erofs_decompress_job, work);
+	struct page *pagepool = NULL;
+
+	z_erofs_decompress_pcluster(job->sb, job->pcl, &pagepool);
+	erofs_workgroup_put(&job->pcl->obj);
+	erofs_release_pages(&pagepool);
+	kfree(job);
+}
+
+/*
+ * pclusters are independent of each other, so instead of decompressing a
+ * whole I/O worth of them one after another, hand them to the workqueue
+ * to be decompressed in parallel.  Returns false if @pcl should rather be
+ * decompressed by the caller.
+ */
+static bool z_erofs_decompress_fanout(struct super_block *sb,
+				      struct z_erofs_pcluster *pcl)
+{
+	struct z_erofs_decompress_job *job;
+
+	job = kmalloc(sizeof(*job), GFP_NOFS | __GFP_NOWARN);
+	if (!job)
+		return false;
+
+	INIT_WORK(&job->work, z_erofs_decompress_job_work);
+	job->sb = sb;
+	job->pcl = pcl;
+	queue_work(z_erofs_workqueue, &job->work);
+	return true;
+}
+
 static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
-				     struct page **pagepool)
+				     struct page **pagepool, bool fanout)
 {
 	z_erofs_next_pcluster_t owned = io->head;
 
@@ -1011,6 +1051,15 @@ static void z_erofs_decompress_queue(const struct z_erofs_decompressqueue *io,
 		pcl = container_of(owned, struct z_erofs_pcluster, next);
 		owned = READ_ONCE(pcl->next);
 
+		/*
+		 * The chain is built by prepending, so the last pcluster is
+		 * the first one requested, i.e. the one a sync reader is
+		 * waiting for.  Always decompress that one here.
+		 */
+		if (fanout && owned != Z_EROFS_PCLUSTER_TAIL_CLOSED &&
+		    z_erofs_decompress_fanout(io->sb, pcl))
+			continue;
+
 		z_erofs_decompress_pcluster(io->sb, pcl, pagepool);
 		erofs_workgroup_put(&pcl->obj);
 	}
@@ -1023,7 +1072,7 @@ static void z_erofs_decompressqueue_work(struct work_struct *work)
 	struct page *pagepool = NULL;
 
 	DBG_BUGON(bgq->head == Z_EROFS_PCLUSTER_TAIL_CLOSED);
-	z_erofs_decompress_queue(bgq, &pagepool);
+	z_erofs_decompress_queue(bgq, &pagepool, true);
 
 	erofs_release_pages(&pagepool);
 	kvfree(bgq);
@@ -1380,7 +1429,7 @@ static void z_erofs_runqueue(struct super_block *sb,
 	z_erofs_submit_queue(sb, f, pagepool, io, &force_fg);
 
 	/* handle bypass queue (no i/o pclusters) immediately */
-	z_erofs_decompress_queue(&io[JQ_BYPASS], pagepool);
+	z_erofs_decompress_queue(&io[JQ_BYPASS], pagepool, false);
 
 	if (!force_fg)
 		return;
@@ -1389,7 +1438,7 @@ static void z_erofs_runqueue(struct super_block *sb,
 	wait_for_completion_io(&io[JQ_SUBMIT].u.done);
 
 	/* handle synchronous decompress queue in the caller context */
-	z_erofs_decompress_queue(&io[JQ_SUBMIT], pagepool);
+	z_erofs_decompress_queue(&io[JQ_SUBMIT], pagepool, true);
 }
 
 /*
@@ -57,6 +57,12 @@ struct fuse_dax_mapping {
 
 	/* reference count when the mapping is used by dax iomap. */
 	refcount_t refcnt;
+
+	/*
+	 * Set whenever iomap hands out this mapping and cleared by reclaim.
+	 * Ranges used since the last reclaim pass get a second chance.
+	 */
+	bool accessed;
 };
 
 /* Per-inode dax map */
@@ -296,6 +302,7 @@ static void dmap_reinit_add_to_free_pool(struct fuse_conn_dax *fcd,
 		 dmap->length);
 	__dmap_remove_busy_list(fcd, dmap);
 	dmap->inode = NULL;
+	dmap->accessed = false;
 	dmap->itn.start = dmap->itn.last = 0;
 	__dmap_add_to_free_pool(fcd, dmap);
 }
@@ -412,6 +419,8 @@ static void fuse_fill_iomap(struct inode *inode, loff_t pos, loff_t length,
 		if (flags & IOMAP_FAULT)
 			iomap->length = ALIGN(len, PAGE_SIZE);
 		iomap->type = IOMAP_MAPPED;
+		if (!READ_ONCE(dmap->accessed))
+			WRITE_ONCE(dmap->accessed, true);
 		/*
 		 * increace refcnt so that reclaim code knows this dmap is in
 		 * use. This assumes fi->dax->sem mutex is held either
@@ -918,13 +927,14 @@ static int reclaim_one_dmap_locked(struct inode *inode,
 	return 0;
 }
 
-/* Find first mapped dmap for an inode and return file offset. Caller needs
- * to hold fi->dax->sem lock either shared or exclusive.
+/* Find first unused dmap for an inode, preferring one that has not been
+ * accessed since the last reclaim pass. Caller needs to hold fi->dax->sem
+ * lock either shared or exclusive.
  */
 static struct fuse_dax_mapping *inode_lookup_first_dmap(struct inode *inode)
 {
 	struct fuse_inode *fi = get_fuse_inode(inode);
-	struct fuse_dax_mapping *dmap;
+	struct fuse_dax_mapping *dmap, *first = NULL;
 	struct interval_tree_node *node;
 
 	for (node = interval_tree_iter_first(&fi->dax->tree, 0, -1); node;
@@ -934,10 +944,13 @@ static struct fuse_dax_mapping *inode_lookup_first_dmap(struct inode *inode)
 		if (refcount_read(&dmap->refcnt) > 1)
 			continue;
 
-		return dmap;
+		if (!READ_ONCE(dmap->accessed))
+			return dmap;
+		if (!first)
+			first = dmap;
 	}
 
-	return NULL;
+	return first;
 }
 
 /*
@@ -1008,6 +1021,7 @@ inode_inline_reclaim_one_dmap(struct fuse_conn_dax *fcd, struct inode *inode,
 	/* Clean up dmap. Do not add back to free list */
 	dmap_remove_busy_list(fcd, dmap);
 	dmap->inode = NULL;
+	dmap->accessed = false;
 	dmap->itn.start = dmap->itn.last = 0;
 
 	pr_debug("fuse: %s: inline reclaimed memory range. inode=%p, window_offset=0x%llx, length=0x%llx\n",
@@ -1138,10 +1152,14 @@ static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 {
 	struct fuse_dax_mapping *dmap, *pos, *temp;
 	int ret, nr_freed = 0;
-	unsigned long start_idx = 0, end_idx = 0;
+	unsigned long start_idx = 0, end_idx = 0, nr_scan;
 	struct inode *inode = NULL;
 
-	/* Pick first busy range and free it for now*/
+	/*
+	 * Busy ranges are kept in a clock: walk from the head, give ranges
+	 * that were accessed since the last pass a second chance by clearing
+	 * the bit and moving them to the tail, and free the first idle one.
+	 */
 	while (1) {
 		if (nr_freed >= nr_to_free)
 			break;
@@ -1154,12 +1172,24 @@ static int try_to_free_dmap_chunks(struct fuse_conn_dax *fcd,
 			return 0;
 		}
 
+		/* Ranges moved to the tail can be visited once more */
+		nr_scan = 2 * fcd->nr_busy_ranges;
 		list_for_each_entry_safe(pos, temp, &fcd->busy_ranges,
 						busy_list) {
+			if (!nr_scan--)
+				break;
+
 			/* skip this range if it's in use. */
 			if (refcount_read(&pos->refcnt) > 1)
 				continue;
 
+			if (READ_ONCE(pos->accessed)) {
+				WRITE_ONCE(pos->accessed, false);
+				list_move_tail(&pos->busy_list,
+					       &fcd->busy_ranges);
+				continue;
+			}
+
 			inode = igrab(pos->inode);
 			/*
 			 * This inode is going away. That will free
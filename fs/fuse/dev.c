@@ -21,6 +21,8 @@
 #include <linux/swap.h>
 #include <linux/splice.h>
 #include <linux/sched.h>
+#include <linux/sched/task.h>
+#include <linux/io_uring.h>
 
 MODULE_ALIAS_MISCDEV(FUSE_MINOR);
 MODULE_ALIAS("devname:fuse");
@@ -204,12 +206,19 @@ static unsigned int fuse_req_hash(u64 unique)
 	return hash_long(unique & ~FUSE_INT_REQ_BIT, FUSE_PQ_HASH_BITS);
 }
 
+#ifdef CONFIG_FUSE_IO_URING
+static void fuse_uring_wake(struct fuse_iqueue *fiq);
+#else
+static inline void fuse_uring_wake(struct fuse_iqueue *fiq) {}
+#endif
+
 /**
- * A new request is available, wake fiq->waitq
+ * A new request is available, wake fiq->waitq and one io_uring reader
  */
 static void fuse_dev_wake_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
+	fuse_uring_wake(fiq);
 	wake_up(&fiq->waitq);
 	kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 	spin_unlock(&fiq->lock);
@@ -1189,6 +1198,26 @@ __releases(fiq->lock)
 		return fuse_read_batch_forget(fiq, cs, nbytes);
 }
 
+/*
+ * Require sane minimum read buffer - that has capacity for fixed part
+ * of any request header + negotiated max_write room for data.
+ *
+ * Historically libfuse reserves 4K for fixed header room, but e.g.
+ * GlusterFS reserves only 80 bytes
+ *
+ *	= `sizeof(fuse_in_header) + sizeof(fuse_write_in)`
+ *
+ * which is the absolute minimum any sane filesystem should be using
+ * for header room.
+ */
+static bool fuse_read_buffer_ok(struct fuse_conn *fc, size_t nbytes)
+{
+	return nbytes >= max_t(size_t, FUSE_MIN_READ_BUFFER,
+			       sizeof(struct fuse_in_header) +
+			       sizeof(struct fuse_write_in) +
+			       fc->max_write);
+}
+
 /*
  * Read a single request into the userspace filesystem's buffer.  This
  * function waits until a request is available, then removes it from
@@ -1198,7 +1227,7 @@ __releases(fiq->lock)
  * fuse_request_end().  Otherwise add it to the processing list, and set
  * the 'sent' flag.
  */
-static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
+static ssize_t fuse_dev_do_read(struct fuse_dev *fud, bool nonblock,
 				struct fuse_copy_state *cs, size_t nbytes)
 {
 	ssize_t err;
@@ -1210,22 +1239,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 	unsigned reqsize;
 	unsigned int hash;
 
-	/*
-	 * Require sane minimum read buffer - that has capacity for fixed part
-	 * of any request header + negotiated max_write room for data.
-	 *
-	 * Historically libfuse reserves 4K for fixed header room, but e.g.
-	 * GlusterFS reserves only 80 bytes
-	 *
-	 *	= `sizeof(fuse_in_header) + sizeof(fuse_write_in)`
-	 *
-	 * which is the absolute minimum any sane filesystem should be using
-	 * for header room.
-	 */
-	if (nbytes < max_t(size_t, FUSE_MIN_READ_BUFFER,
-			   sizeof(struct fuse_in_header) +
-			   sizeof(struct fuse_write_in) +
-			   fc->max_write))
+	if (!fuse_read_buffer_ok(fc, nbytes))
 		return -EINVAL;
 
  restart:
@@ -1235,7 +1249,7 @@ static ssize_t fuse_dev_do_read(struct fuse_dev *fud, struct file *file,
 			break;
 		spin_unlock(&fiq->lock);
 
-		if (file->f_flags & O_NONBLOCK)
+		if (nonblock)
 			return -EAGAIN;
 		err = wait_event_interruptible_exclusive(fiq->waitq,
 				!fiq->connected || request_pending(fiq));
@@ -1361,7 +1375,8 @@ static ssize_t fuse_dev_read(struct kiocb *iocb, struct iov_iter *to)
 
 	fuse_copy_init(&cs, 1, to);
 
-	return fuse_dev_do_read(fud, file, &cs, iov_iter_count(to));
+	return fuse_dev_do_read(fud, file->f_flags & O_NONBLOCK, &cs,
+				iov_iter_count(to));
 }
 
 static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
@@ -1385,7 +1400,7 @@ static ssize_t fuse_dev_splice_read(struct file *in, loff_t *ppos,
 	fuse_copy_init(&cs, 1, NULL);
 	cs.pipebufs = bufs;
 	cs.pipe = pipe;
-	ret = fuse_dev_do_read(fud, in, &cs, len);
+	ret = fuse_dev_do_read(fud, in->f_flags & O_NONBLOCK, &cs, len);
 	if (ret < 0)
 		goto out;
 
@@ -2051,6 +2066,209 @@ static ssize_t fuse_dev_splice_write(struct pipe_inode_info *pipe,
 	return ret;
 }
 
+#ifdef CONFIG_FUSE_IO_URING
+/*
+ * A FUSE_URING_CMD_* command that was accepted is parked on fiq->uring_idle
+ * until a request is queued.  The request is then copied into the command's
+ * buffer from task work, in the context of the submitter, and the command is
+ * completed with the request's length.
+ */
+struct fuse_uring_pdu {
+	struct io_uring_cmd *next;
+	void __user *buf;
+	struct task_struct *task;
+	u32 len;
+};
+
+#define FUSE_URING_MONITOR_DELAY	HZ
+
+static struct fuse_uring_pdu *fuse_uring_pdu(struct io_uring_cmd *cmd)
+{
+	BUILD_BUG_ON(sizeof(struct fuse_uring_pdu) > sizeof(cmd->pdu));
+	return (struct fuse_uring_pdu *) cmd->pdu;
+}
+
+static void fuse_uring_done(struct io_uring_cmd *cmd, ssize_t ret)
+{
+	put_task_struct(fuse_uring_pdu(cmd)->task);
+	io_uring_cmd_done(cmd, ret, 0);
+}
+
+static void fuse_uring_deliver(struct io_uring_cmd *cmd);
+
+/* Called with fiq->lock held */
+static void fuse_uring_wake(struct fuse_iqueue *fiq)
+{
+	struct io_uring_cmd *cmd = fiq->uring_idle;
+
+	if (cmd) {
+		fiq->uring_idle = fuse_uring_pdu(cmd)->next;
+		io_uring_cmd_complete_in_task(cmd, fuse_uring_deliver);
+	}
+}
+
+/* Called with fiq->lock held */
+static void fuse_uring_wake_all(struct fuse_iqueue *fiq)
+{
+	while (fiq->uring_idle)
+		fuse_uring_wake(fiq);
+}
+
+static int fuse_uring_park(struct fuse_iqueue *fiq, struct io_uring_cmd *cmd)
+{
+	spin_lock(&fiq->lock);
+	if (!fiq->connected) {
+		spin_unlock(&fiq->lock);
+		return -ENODEV;
+	}
+	fuse_uring_pdu(cmd)->next = fiq->uring_idle;
+	fiq->uring_idle = cmd;
+	if (request_pending(fiq))
+		fuse_uring_wake(fiq);
+	spin_unlock(&fiq->lock);
+
+	queue_delayed_work(system_wq, &fiq->uring_monitor,
+			   FUSE_URING_MONITOR_DELAY);
+	return 0;
+}
+
+static void fuse_uring_deliver(struct io_uring_cmd *cmd)
+{
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	struct iovec iov;
+	ssize_t ret;
+
+	/* Not running in the submitter, its buffer may be gone */
+	if (current->flags & (PF_EXITING | PF_KTHREAD)) {
+		fuse_uring_done(cmd, -ECANCELED);
+		return;
+	}
+
+	ret = import_single_range(READ, pdu->buf, pdu->len, &iov, &iter);
+	if (!ret) {
+		fuse_copy_init(&cs, 1, &iter);
+		ret = fuse_dev_do_read(fud, true, &cs, pdu->len);
+		/* Somebody else got there first, wait for the next request */
+		if (ret == -EAGAIN) {
+			ret = fuse_uring_park(&fud->fc->iq, cmd);
+			if (!ret)
+				return;
+		}
+	}
+	fuse_uring_done(cmd, ret);
+}
+
+/*
+ * io_uring cannot cancel a parked command, and the ring of an exiting
+ * server waits for all of them.  Complete the ones whose submitter is on its
+ * way out instead of holding up its exit.
+ */
+static void fuse_uring_monitor(struct work_struct *work)
+{
+	struct fuse_iqueue *fiq = container_of(to_delayed_work(work),
+					       struct fuse_iqueue,
+					       uring_monitor);
+	struct io_uring_cmd **pos, *cmd;
+	bool parked;
+
+	spin_lock(&fiq->lock);
+	pos = &fiq->uring_idle;
+	while ((cmd = *pos)) {
+		struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+
+		if (pdu->task->flags & PF_EXITING) {
+			*pos = pdu->next;
+			io_uring_cmd_complete_in_task(cmd, fuse_uring_deliver);
+		} else {
+			pos = &pdu->next;
+		}
+	}
+	parked = fiq->uring_idle;
+	spin_unlock(&fiq->lock);
+
+	if (parked)
+		queue_delayed_work(system_wq, &fiq->uring_monitor,
+				   FUSE_URING_MONITOR_DELAY);
+}
+
+void fuse_uring_init(struct fuse_iqueue *fiq)
+{
+	INIT_DELAYED_WORK(&fiq->uring_monitor, fuse_uring_monitor);
+}
+
+void fuse_uring_stop(struct fuse_iqueue *fiq)
+{
+	cancel_delayed_work_sync(&fiq->uring_monitor);
+}
+
+static int fuse_dev_uring_cmd(struct io_uring_cmd *cmd,
+			      unsigned int issue_flags)
+{
+	const struct fuse_uring_cmd_req *creq = cmd->cmd;
+	struct fuse_uring_pdu *pdu = fuse_uring_pdu(cmd);
+	struct fuse_dev *fud = fuse_get_dev(cmd->file);
+	struct fuse_copy_state cs;
+	struct iov_iter iter;
+	struct iovec iov;
+	void __user *buf;
+	u32 buf_len, commit_len;
+	ssize_t ret;
+
+	if (!fud)
+		return -EPERM;
+
+	/* struct fuse_uring_cmd_req does not fit into a 64 byte SQE */
+	if (!(issue_flags & IO_URING_F_SQE128))
+		return -EINVAL;
+
+	buf = u64_to_user_ptr(READ_ONCE(creq->buf));
+	buf_len = READ_ONCE(creq->buf_len);
+	commit_len = READ_ONCE(creq->commit_len);
+	if (READ_ONCE(creq->flags))
+		return -EINVAL;
+
+	if (!fuse_read_buffer_ok(fud->fc, buf_len))
+		return -EINVAL;
+
+	switch (cmd->cmd_op) {
+	case FUSE_URING_CMD_COMMIT_AND_FETCH:
+		if (!commit_len)
+			break;
+		if (commit_len > buf_len)
+			return -EINVAL;
+		ret = import_single_range(WRITE, buf, commit_len, &iov, &iter);
+		if (ret)
+			return ret;
+		fuse_copy_init(&cs, 0, &iter);
+		ret = fuse_dev_do_write(fud, &cs, commit_len);
+		if (ret < 0)
+			return ret;
+		break;
+	case FUSE_URING_CMD_FETCH:
+		if (commit_len)
+			return -EINVAL;
+		break;
+	default:
+		return -EOPNOTSUPP;
+	}
+
+	pdu->buf = buf;
+	pdu->len = buf_len;
+	pdu->task = get_task_struct(current);
+	ret = fuse_uring_park(&fud->fc->iq, cmd);
+	if (ret) {
+		put_task_struct(pdu->task);
+		return ret;
+	}
+	return -EIOCBQUEUED;
+}
+#else
+static inline void fuse_uring_wake_all(struct fuse_iqueue *fiq) {}
+#endif
+
 static __poll_t fuse_dev_poll(struct file *file, poll_table *wait)
 {
 	__poll_t mask = EPOLLOUT | EPOLLWRNORM;
@@ -2171,6 +2389,7 @@ void fuse_abort_conn(struct fuse_conn *fc)
 		while (forget_pending(fiq))
 			kfree(fuse_dequeue_forget(fiq, 1, NULL));
 		wake_up_all(&fiq->waitq);
+		fuse_uring_wake_all(fiq);
 		spin_unlock(&fiq->lock);
 		kill_fasync(&fiq->fasync, SIGIO, POLL_IN);
 		end_polls(fc);
@@ -2300,6 +2519,9 @@ const struct file_operations fuse_dev_operations = {
 	.fasync		= fuse_dev_fasync,
 	.unlocked_ioctl = fuse_dev_ioctl,
 	.compat_ioctl   = compat_ptr_ioctl,
+#ifdef CONFIG_FUSE_IO_URING
+	.uring_cmd	= fuse_dev_uring_cmd,
+#endif
 };
 EXPORT_SYMBOL_GPL(fuse_dev_operations);
 
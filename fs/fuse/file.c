@@ -1626,13 +1626,18 @@ static ssize_t fuse_file_write_iter(struct kiocb *iocb, struct iov_iter *from)
 static void fuse_writepage_free(struct fuse_writepage_args *wpa)
 {
 	struct fuse_args_pages *ap = &wpa->ia.ap;
+	bool nocopy = get_fuse_conn(wpa->inode)->writeback_nocopy;
 	int i;
 
 	if (wpa->bucket)
 		fuse_sync_bucket_dec(wpa->bucket);
 
-	for (i = 0; i < ap->num_pages; i++)
-		__free_page(ap->pages[i]);
+	for (i = 0; i < ap->num_pages; i++) {
+		if (nocopy)
+			put_page(ap->pages[i]);
+		else
+			__free_page(ap->pages[i]);
+	}
 
 	if (wpa->ia.ff)
 		fuse_file_put(wpa->ia.ff, false, false);
@@ -1648,11 +1653,15 @@ static void fuse_writepage_finish(struct fuse_mount *fm,
 	struct inode *inode = wpa->inode;
 	struct fuse_inode *fi = get_fuse_inode(inode);
 	struct backing_dev_info *bdi = inode_to_bdi(inode);
+	bool nocopy = get_fuse_conn(inode)->writeback_nocopy;
 	int i;
 
 	for (i = 0; i < ap->num_pages; i++) {
 		dec_wb_stat(&bdi->wb, WB_WRITEBACK);
-		dec_node_page_state(ap->pages[i], NR_WRITEBACK_TEMP);
+		if (nocopy)
+			end_page_writeback(ap->pages[i]);
+		else
+			dec_node_page_state(ap->pages[i], NR_WRITEBACK_TEMP);
 		wb_writeout_inc(&bdi->wb);
 	}
 	wake_up(&fi->page_waitq);
@@ -1915,6 +1924,37 @@ static void fuse_writepage_add_to_bucket(struct fuse_conn *fc,
 	rcu_read_unlock();
 }
 
+/*
+ * Get the page to send for a page under writeback.  Normally this is a
+ * temporary copy, so that writeback of the page cache page can end right away
+ * and reclaim never waits for the server.  A privileged server may ask for
+ * the page cache page itself, which then stays under writeback until the
+ * server has replied.
+ */
+static struct page *fuse_writepage_get_page(struct fuse_conn *fc,
+					    struct page *page)
+{
+	struct page *tmp_page;
+
+	if (fc->writeback_nocopy) {
+		get_page(page);
+		return page;
+	}
+
+	tmp_page = alloc_page(GFP_NOFS | __GFP_HIGHMEM);
+	if (tmp_page)
+		copy_highpage(tmp_page, page);
+	return tmp_page;
+}
+
+static void fuse_writepage_put_page(struct fuse_conn *fc, struct page *page)
+{
+	if (fc->writeback_nocopy)
+		put_page(page);
+	else
+		__free_page(page);
+}
+
 static int fuse_writepage_locked(struct page *page)
 {
 	struct address_space *mapping = page->mapping;
@@ -1933,7 +1973,7 @@ static int fuse_writepage_locked(struct page *page)
 		goto err;
 	ap = &wpa->ia.ap;
 
-	tmp_page = alloc_page(GFP_NOFS | __GFP_HIGHMEM);
+	tmp_page = fuse_writepage_get_page(fc, page);
 	if (!tmp_page)
 		goto err_free;
 
@@ -1945,7 +1985,6 @@ static int fuse_writepage_locked(struct page *page)
 	fuse_writepage_add_to_bucket(fc, wpa);
 	fuse_write_args_fill(&wpa->ia, wpa->ia.ff, page_offset(page), 0);
 
-	copy_highpage(tmp_page, page);
 	wpa->ia.write.in.write_flags |= FUSE_WRITE_CACHE;
 	wpa->next = NULL;
 	ap->args.in_pages = true;
@@ -1957,7 +1996,8 @@ static int fuse_writepage_locked(struct page *page)
 	wpa->inode = inode;
 
 	inc_wb_stat(&inode_to_bdi(inode)->wb, WB_WRITEBACK);
-	inc_node_page_state(tmp_page, NR_WRITEBACK_TEMP);
+	if (!fc->writeback_nocopy)
+		inc_node_page_state(tmp_page, NR_WRITEBACK_TEMP);
 
 	spin_lock(&fi->lock);
 	tree_insert(&fi->writepages, wpa);
@@ -1965,12 +2005,13 @@ static int fuse_writepage_locked(struct page *page)
 	fuse_flush_writepages(inode);
 	spin_unlock(&fi->lock);
 
-	end_page_writeback(page);
+	if (!fc->writeback_nocopy)
+		end_page_writeback(page);
 
 	return 0;
 
 err_nofile:
-	__free_page(tmp_page);
+	fuse_writepage_put_page(fc, tmp_page);
 err_free:
 	kfree(wpa);
 err:
@@ -2055,6 +2096,10 @@ static void fuse_writepages_send(struct fuse_fill_wb_data *data)
 	fuse_flush_writepages(inode);
 	spin_unlock(&fi->lock);
 
+	/* Without a copy the pages stay under writeback until the reply */
+	if (get_fuse_conn(inode)->writeback_nocopy)
+		return;
+
 	for (i = 0; i < num_pages; i++)
 		end_page_writeback(data->orig_pages[i]);
 }
@@ -2174,7 +2219,7 @@ static int fuse_writepages_fill(struct page *page,
 	}
 
 	err = -ENOMEM;
-	tmp_page = alloc_page(GFP_NOFS | __GFP_HIGHMEM);
+	tmp_page = fuse_writepage_get_page(fc, page);
 	if (!tmp_page)
 		goto out_unlock;
 
@@ -2195,7 +2240,7 @@ static int fuse_writepages_fill(struct page *page,
 		err = -ENOMEM;
 		wpa = fuse_writepage_args_alloc();
 		if (!wpa) {
-			__free_page(tmp_page);
+			fuse_writepage_put_page(fc, tmp_page);
 			goto out_unlock;
 		}
 		fuse_writepage_add_to_bucket(fc, wpa);
@@ -2213,14 +2258,14 @@ static int fuse_writepages_fill(struct page *page,
 	}
 	set_page_writeback(page);
 
-	copy_highpage(tmp_page, page);
 	ap->pages[ap->num_pages] = tmp_page;
 	ap->descs[ap->num_pages].offset = 0;
 	ap->descs[ap->num_pages].length = PAGE_SIZE;
 	data->orig_pages[ap->num_pages] = page;
 
 	inc_wb_stat(&inode_to_bdi(inode)->wb, WB_WRITEBACK);
-	inc_node_page_state(tmp_page, NR_WRITEBACK_TEMP);
+	if (!fc->writeback_nocopy)
+		inc_node_page_state(tmp_page, NR_WRITEBACK_TEMP);
 
 	err = 0;
 	if (data->wpa) {
@@ -2234,6 +2279,12 @@ static int fuse_writepages_fill(struct page *page,
 	} else if (fuse_writepage_add(wpa, page)) {
 		data->wpa = wpa;
 	} else {
+		/*
+		 * Without a copy a page stays under writeback for as long as
+		 * its request is on fi->writepages, so write_cache_pages()
+		 * never gives us one that is still in flight.
+		 */
+		WARN_ON_ONCE(fc->writeback_nocopy);
 		end_page_writeback(page);
 	}
 out_unlock:
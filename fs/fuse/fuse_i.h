@@ -167,6 +167,8 @@ enum {
 	FUSE_I_SIZE_UNSTABLE,
 	/* Bad inode */
 	FUSE_I_BAD,
+	/** A LOOKUP revalidating a dentry of this inode is in flight */
+	FUSE_I_REVALIDATING,
 };
 
 struct fuse_conn;
@@ -448,6 +450,14 @@ struct fuse_iqueue {
 
 	/** Device-specific state */
 	void *priv;
+
+#ifdef CONFIG_FUSE_IO_URING
+	/** io_uring commands waiting for a request to read */
+	struct io_uring_cmd *uring_idle;
+
+	/** Cancels waiting io_uring commands of exiting submitters */
+	struct delayed_work uring_monitor;
+#endif
 };
 
 #define FUSE_PQ_HASH_BITS 8
@@ -784,6 +794,9 @@ struct fuse_conn {
 	/* Does the filesystem support per inode DAX? */
 	unsigned int inode_dax:1;
 
+	/* Send page cache pages for writeback instead of temporary copies */
+	unsigned int writeback_nocopy:1;
+
 	/** The number of requests waiting for completion */
 	atomic_t num_waiting;
 
@@ -1084,6 +1097,14 @@ void fuse_request_end(struct fuse_req *req);
 
 /* Abort all requests */
 void fuse_abort_conn(struct fuse_conn *fc);
+
+#ifdef CONFIG_FUSE_IO_URING
+void fuse_uring_init(struct fuse_iqueue *fiq);
+void fuse_uring_stop(struct fuse_iqueue *fiq);
+#else
+static inline void fuse_uring_init(struct fuse_iqueue *fiq) {}
+static inline void fuse_uring_stop(struct fuse_iqueue *fiq) {}
+#endif
 void fuse_wait_aborted(struct fuse_conn *fc);
 
 /**
@@ -793,6 +793,7 @@ static void fuse_iqueue_init(struct fuse_iqueue *fiq,
 	fiq->connected = 1;
 	fiq->ops = ops;
 	fiq->priv = priv;
+	fuse_uring_init(fiq);
 }
 
 static void fuse_pqueue_init(struct fuse_pqueue *fpq)
@@ -850,6 +851,7 @@ void fuse_conn_put(struct fuse_conn *fc)
 
 		if (IS_ENABLED(CONFIG_FUSE_DAX))
 			fuse_dax_conn_free(fc);
+		fuse_uring_stop(fiq);
 		if (fiq->ops->release)
 			fiq->ops->release(fiq);
 		put_pid_ns(fc->pid_ns);
@@ -1189,6 +1191,13 @@ static void process_init_reply(struct fuse_mount *fm, struct fuse_args *args,
 				fc->setxattr_ext = 1;
 			if (flags & FUSE_SECURITY_CTX)
 				fc->init_security = 1;
+			/*
+			 * Page cache pages stay under writeback until the
+			 * server replies, only trust a privileged one with that
+			 */
+			if (flags & FUSE_WRITEBACK_NOCOPY &&
+			    capable(CAP_SYS_ADMIN))
+				fc->writeback_nocopy = 1;
 		} else {
 			ra_pages = fc->max_read / PAGE_SIZE;
 			fc->no_lock = 1;
@@ -1234,7 +1243,7 @@ void fuse_send_init(struct fuse_mount *fm)
 		FUSE_ABORT_ERROR | FUSE_MAX_PAGES | FUSE_CACHE_SYMLINKS |
 		FUSE_NO_OPENDIR_SUPPORT | FUSE_EXPLICIT_INVAL_DATA |
 		FUSE_HANDLE_KILLPRIV_V2 | FUSE_SETXATTR_EXT | FUSE_INIT_EXT |
-		FUSE_SECURITY_CTX;
+		FUSE_SECURITY_CTX | FUSE_WRITEBACK_NOCOPY;
 #ifdef CONFIG_FUSE_DAX
 	if (fm->fc->dax)
 		flags |= FUSE_MAP_ALIGNMENT;
@@ -61,6 +61,7 @@ struct virtio_fs {
 	struct virtio_fs_vq *vqs;
 	unsigned int nvqs;               /* number of virtqueues */
 	unsigned int num_request_queues; /* number of request queues */
+	unsigned int *mq_map;            /* CPU to request queue mapping */
 	struct dax_device *dax_dev;
 
 	/* DAX memory window where file contents are mapped */
@@ -166,6 +167,7 @@ static void release_virtio_fs_obj(struct kref *ref)
 	struct virtio_fs *vfs = container_of(ref, struct virtio_fs, refcount);
 
 	kfree(vfs->vqs);
+	kfree(vfs->mq_map);
 	kfree(vfs);
 }
 
@@ -679,6 +681,32 @@ static void virtio_fs_init_vq(struct virtio_fs_vq *fsvq, char *name,
 	}
 }
 
+/*
+ * Send requests from each CPU to the request queue whose interrupt is
+ * affine to it, so that they also complete on that CPU.  CPUs the
+ * transport gives no affinity for are spread over the queues.
+ */
+static void virtio_fs_map_queues(struct virtio_device *vdev,
+				 struct virtio_fs *fs)
+{
+	const struct cpumask *mask;
+	unsigned int cpu, q;
+
+	for_each_possible_cpu(cpu)
+		fs->mq_map[cpu] = cpu % fs->num_request_queues;
+
+	if (!vdev->config->get_vq_affinity)
+		return;
+
+	for (q = 0; q < fs->num_request_queues; q++) {
+		mask = vdev->config->get_vq_affinity(vdev, VQ_REQUEST + q);
+		if (!mask)
+			continue;
+		for_each_cpu(cpu, mask)
+			fs->mq_map[cpu] = q;
+	}
+}
+
 /* Initialize virtqueues */
 static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 			       struct virtio_fs *fs)
@@ -688,17 +716,29 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 	const char **names;
 	unsigned int i;
 	int ret = 0;
+	/* Spread the request queue interrupts, but not the hiprio one */
+	struct irq_affinity desc = { .pre_vectors = VQ_REQUEST };
 
 	virtio_cread_le(vdev, struct virtio_fs_config, num_request_queues,
 			&fs->num_request_queues);
 	if (fs->num_request_queues == 0)
 		return -EINVAL;
 
+	/* More queues than CPUs can't be used */
+	fs->num_request_queues = min_t(unsigned int, fs->num_request_queues,
+				       nr_cpu_ids);
+
 	fs->nvqs = VQ_REQUEST + fs->num_request_queues;
 	fs->vqs = kcalloc(fs->nvqs, sizeof(fs->vqs[VQ_HIPRIO]), GFP_KERNEL);
 	if (!fs->vqs)
 		return -ENOMEM;
 
+	fs->mq_map = kcalloc(nr_cpu_ids, sizeof(*fs->mq_map), GFP_KERNEL);
+	if (!fs->mq_map) {
+		kfree(fs->vqs);
+		return -ENOMEM;
+	}
+
 	vqs = kmalloc_array(fs->nvqs, sizeof(vqs[VQ_HIPRIO]), GFP_KERNEL);
 	callbacks = kmalloc_array(fs->nvqs, sizeof(callbacks[VQ_HIPRIO]),
 					GFP_KERNEL);
@@ -723,20 +763,23 @@ static int virtio_fs_setup_vqs(struct virtio_device *vdev,
 		names[i] = fs->vqs[i].name;
 	}
 
-	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, NULL);
+	ret = virtio_find_vqs(vdev, fs->nvqs, vqs, callbacks, names, &desc);
 	if (ret < 0)
 		goto out;
 
 	for (i = 0; i < fs->nvqs; i++)
 		fs->vqs[i].vq = vqs[i];
 
+	virtio_fs_map_queues(vdev, fs);
 	virtio_fs_start_all_queues(fs);
 out:
 	kfree(names);
 	kfree(callbacks);
 	kfree(vqs);
-	if (ret)
+	if (ret) {
 		kfree(fs->vqs);
+		kfree(fs->mq_map);
+	}
 	return ret;
 }
 
@@ -876,8 +919,6 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	if (ret < 0)
 		goto out;
 
-	/* TODO vq affinity */
-
 	ret = virtio_fs_setup_dax(vdev, fs);
 	if (ret < 0)
 		goto out_vqs;
@@ -897,6 +938,7 @@ static int virtio_fs_probe(struct virtio_device *vdev)
 	virtio_reset_device(vdev);
 	virtio_fs_cleanup_vqs(vdev, fs);
 	kfree(fs->vqs);
+	kfree(fs->mq_map);
 
 out:
 	vdev->priv = NULL;
@@ -1224,7 +1266,7 @@ static int virtio_fs_enqueue_req(struct virtio_fs_vq *fsvq,
 static void virtio_fs_wake_pending_and_unlock(struct fuse_iqueue *fiq)
 __releases(fiq->lock)
 {
-	unsigned int queue_id = VQ_REQUEST; /* TODO multiqueue */
+	unsigned int queue_id;
 	struct virtio_fs *fs;
 	struct fuse_req *req;
 	struct virtio_fs_vq *fsvq;
@@ -1238,6 +1280,7 @@ __releases(fiq->lock)
 	spin_unlock(&fiq->lock);
 
 	fs = fiq->priv;
+	queue_id = VQ_REQUEST + fs->mq_map[raw_smp_processor_id()];
 
 	pr_debug("%s: opcode %u unique %#llx nodeid %#llx in.len %u out.len %u\n",
 		  __func__, req->in.h.opcode, req->in.h.unique,
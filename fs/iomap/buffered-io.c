@@ -12,6 +12,7 @@
 #include <linux/buffer_head.h>
 #include <linux/dax.h>
 #include <linux/writeback.h>
+#include <linux/backing-dev.h>
 #include <linux/list_sort.h>
 #include <linux/swap.h>
 #include <linux/bio.h>
@@ -23,6 +24,13 @@
 
 #define IOEND_BATCH_SIZE	4096
 
+/* Largest folio the buffered write path will allocate */
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+#define IOMAP_MAX_WRITE_ORDER	HPAGE_PMD_ORDER
+#else
+#define IOMAP_MAX_WRITE_ORDER	8
+#endif
+
 /*
  * Structure allocated for each folio when block size < folio size
  * to track sub-folio uptodate status and I/O completions.
@@ -566,13 +574,71 @@ static int iomap_write_begin_inline(const struct iomap_iter *iter,
 	return iomap_read_inline_data(iter, folio);
 }
 
+/*
+ * Try to add a new large folio covering as much of [pos, pos + len) as the
+ * index alignment allows.  Returns NULL if nothing suitable could be added,
+ * in which case the caller falls back to the regular lookup.
+ */
+static struct folio *iomap_alloc_large_folio(struct address_space *mapping,
+		loff_t pos, size_t len)
+{
+	pgoff_t index = pos >> PAGE_SHIFT;
+	gfp_t gfp = mapping_gfp_mask(mapping) & ~__GFP_FS;
+	unsigned int order;
+	struct folio *folio;
+	int err;
+
+	if (mapping_can_writeback(mapping))
+		gfp |= __GFP_WRITE;
+
+	order = min_t(unsigned int, IOMAP_MAX_WRITE_ORDER,
+		      ilog2((offset_in_page(pos) + len) >> PAGE_SHIFT));
+	if (index & ((1UL << order) - 1))
+		order = __ffs(index);
+
+	for (; order > 1; order--) {
+		folio = filemap_alloc_folio(gfp | __GFP_NORETRY | __GFP_NOWARN,
+					    order);
+		if (!folio)
+			continue;
+		err = filemap_add_folio(mapping, folio, index, gfp);
+		if (!err)
+			return folio;
+		folio_put(folio);
+		/* something is already cached in this range */
+		if (err == -EEXIST)
+			break;
+	}
+	return NULL;
+}
+
+static struct folio *iomap_get_folio(const struct iomap_iter *iter,
+		loff_t pos, size_t len)
+{
+	struct address_space *mapping = iter->inode->i_mapping;
+	unsigned fgp = FGP_LOCK | FGP_WRITE | FGP_STABLE | FGP_NOFS;
+	struct folio *folio;
+
+	if (mapping_large_folio_support(mapping) &&
+	    offset_in_page(pos) + len > PAGE_SIZE) {
+		folio = __filemap_get_folio(mapping, pos >> PAGE_SHIFT, fgp, 0);
+		if (folio)
+			return folio;
+		folio = iomap_alloc_large_folio(mapping, pos, len);
+		if (folio)
+			return folio;
+	}
+
+	return __filemap_get_folio(mapping, pos >> PAGE_SHIFT, fgp | FGP_CREAT,
+			mapping_gfp_mask(mapping));
+}
+
 static int iomap_write_begin(const struct iomap_iter *iter, loff_t pos,
 		size_t len, struct folio **foliop)
 {
 	const struct iomap_page_ops *page_ops = iter->iomap.page_ops;
 	const struct iomap *srcmap = iomap_iter_srcmap(iter);
 	struct folio *folio;
-	unsigned fgp = FGP_LOCK | FGP_WRITE | FGP_CREAT | FGP_STABLE | FGP_NOFS;
 	int status = 0;
 
 	BUG_ON(pos + len > iter->iomap.offset + iter->iomap.length);
@@ -591,8 +657,7 @@ static int iomap_write_begin(const struct iomap_iter *iter, loff_t pos,
 			return status;
 	}
 
-	folio = __filemap_get_folio(iter->inode->i_mapping, pos >> PAGE_SHIFT,
-			fgp, mapping_gfp_mask(iter->inode->i_mapping));
+	folio = iomap_get_folio(iter, pos, len);
 	if (!folio) {
 		status = -ENOMEM;
 		goto out_no_page;
@@ -709,19 +774,23 @@ static size_t iomap_write_end(struct iomap_iter *iter, loff_t pos, size_t len,
 static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 {
 	loff_t length = iomap_length(iter);
+	size_t chunk = PAGE_SIZE;
 	loff_t pos = iter->pos;
 	ssize_t written = 0;
 	long status = 0;
 
+	if (mapping_large_folio_support(iter->inode->i_mapping))
+		chunk = PAGE_SIZE << IOMAP_MAX_WRITE_ORDER;
+
 	do {
 		struct folio *folio;
 		struct page *page;
-		unsigned long offset;	/* Offset into pagecache page */
-		unsigned long bytes;	/* Bytes to write to page */
+		unsigned long offset;	/* Offset into pagecache folio */
+		unsigned long bytes;	/* Bytes to write to folio */
 		size_t copied;		/* Bytes copied from user */
 
-		offset = offset_in_page(pos);
-		bytes = min_t(unsigned long, PAGE_SIZE - offset,
+		offset = pos & (chunk - 1);
+		bytes = min_t(unsigned long, chunk - offset,
 						iov_iter_count(i));
 again:
 		if (bytes > length)
@@ -742,11 +811,16 @@ static loff_t iomap_write_iter(struct iomap_iter *iter, struct iov_iter *i)
 		if (unlikely(status))
 			break;
 
+		offset = offset_in_folio(folio, pos);
+		if (bytes > folio_size(folio) - offset)
+			bytes = folio_size(folio) - offset;
+
 		page = folio_file_page(folio, pos >> PAGE_SHIFT);
 		if (mapping_writably_mapped(iter->inode->i_mapping))
-			flush_dcache_page(page);
+			flush_dcache_folio(folio);
 
-		copied = copy_page_from_iter_atomic(page, offset, bytes, i);
+		copied = copy_page_from_iter_atomic(page, offset_in_page(pos),
+						    bytes, i);
 
 		status = iomap_write_end(iter, pos, bytes, copied, folio);
 
@@ -20,6 +20,7 @@
  * Private flags for iomap_dio, must not overlap with the public ones in
  * iomap.h:
  */
+#define IOMAP_DIO_CALLER_COMP	(1 << 27)
 #define IOMAP_DIO_WRITE_FUA	(1 << 28)
 #define IOMAP_DIO_NEED_SYNC	(1 << 29)
 #define IOMAP_DIO_WRITE		(1 << 30)
@@ -47,10 +48,29 @@ struct iomap_dio {
 		/* used for aio completion: */
 		struct {
 			struct work_struct	work;
+			struct list_head	entry;
+			struct list_head	batch;	/* followers, if leader */
+			unsigned int		cpu;
 		} aio;
 	};
 };
 
+/*
+ * Async write completions that need the workqueue are gathered per CPU: the
+ * first one queues its work item and becomes the leader of an open batch,
+ * completions for the same super block that arrive before the work runs are
+ * chained to the leader instead of being queued separately.
+ */
+#define IOMAP_DIO_BATCH_MAX	64
+
+struct iomap_dio_batch {
+	raw_spinlock_t		lock;
+	struct iomap_dio	*leader;
+	unsigned int		nr;
+};
+
+static DEFINE_PER_CPU(struct iomap_dio_batch, iomap_dio_batches);
+
 static struct bio *iomap_dio_alloc_bio(const struct iomap_iter *iter,
 		struct iomap_dio *dio, unsigned short nr_vecs, unsigned int opf)
 {
@@ -144,6 +164,67 @@ static void iomap_dio_complete_work(struct work_struct *work)
 	iocb->ki_complete(iocb, iomap_dio_complete(dio));
 }
 
+static ssize_t iomap_dio_deferred_complete(void *data)
+{
+	return iomap_dio_complete(data);
+}
+
+static inline struct inode *iomap_dio_inode(struct iomap_dio *dio)
+{
+	return file_inode(dio->iocb->ki_filp);
+}
+
+static void iomap_dio_complete_batch(struct work_struct *work)
+{
+	struct iomap_dio *dio = container_of(work, struct iomap_dio, aio.work);
+	struct iomap_dio_batch *batch =
+		per_cpu_ptr(&iomap_dio_batches, dio->aio.cpu);
+	struct iomap_dio *next;
+	LIST_HEAD(list);
+
+	raw_spin_lock_irq(&batch->lock);
+	if (batch->leader == dio)
+		batch->leader = NULL;
+	list_splice_init(&dio->aio.batch, &list);
+	raw_spin_unlock_irq(&batch->lock);
+
+	list_add(&dio->aio.entry, &list);
+
+	list_for_each_entry_safe(dio, next, &list, aio.entry) {
+		struct kiocb *iocb = dio->iocb;
+
+		iocb->ki_complete(iocb, iomap_dio_complete(dio));
+	}
+}
+
+static void iomap_dio_queue_complete(struct iomap_dio *dio)
+{
+	struct super_block *sb = iomap_dio_inode(dio)->i_sb;
+	struct iomap_dio_batch *batch;
+	struct iomap_dio *leader;
+	unsigned long flags;
+
+	local_irq_save(flags);
+	batch = this_cpu_ptr(&iomap_dio_batches);
+	raw_spin_lock(&batch->lock);
+	leader = batch->leader;
+	if (leader && iomap_dio_inode(leader)->i_sb == sb) {
+		list_add_tail(&dio->aio.entry, &leader->aio.batch);
+		if (++batch->nr >= IOMAP_DIO_BATCH_MAX)
+			batch->leader = NULL;
+		raw_spin_unlock_irqrestore(&batch->lock, flags);
+		return;
+	}
+	INIT_LIST_HEAD(&dio->aio.batch);
+	dio->aio.cpu = smp_processor_id();
+	batch->leader = dio;
+	batch->nr = 1;
+	raw_spin_unlock_irqrestore(&batch->lock, flags);
+
+	INIT_WORK(&dio->aio.work, iomap_dio_complete_batch);
+	queue_work(sb->s_dio_done_wq, &dio->aio.work);
+}
+
 /*
  * Set an error in the dio if none is set yet.  We have to use cmpxchg
  * as the submission context and the completion context(s) can race to
@@ -167,12 +248,21 @@ void iomap_dio_bio_end_io(struct bio *bio)
 			struct task_struct *waiter = dio->submit.waiter;
 			WRITE_ONCE(dio->submit.waiter, NULL);
 			blk_wake_io_task(waiter);
-		} else if (dio->flags & IOMAP_DIO_WRITE) {
-			struct inode *inode = file_inode(dio->iocb->ki_filp);
+		} else if (dio->flags & IOMAP_DIO_CALLER_COMP) {
+			struct kiocb *iocb = dio->iocb;
 
+			/*
+			 * The issuer set IOCB_DIO_CALLER_COMP, so its
+			 * ->ki_complete will see ->dio_complete and run it
+			 * from task context.  The result passed here is
+			 * ignored, the real one comes from ->dio_complete.
+			 */
+			iocb->private = dio;
+			iocb->dio_complete = iomap_dio_deferred_complete;
+			iocb->ki_complete(iocb, 0);
+		} else if (dio->flags & IOMAP_DIO_WRITE) {
 			WRITE_ONCE(dio->iocb->private, NULL);
-			INIT_WORK(&dio->aio.work, iomap_dio_complete_work);
-			queue_work(inode->i_sb->s_dio_done_wq, &dio->aio.work);
+			iomap_dio_queue_complete(dio);
 		} else {
 			WRITE_ONCE(dio->iocb->private, NULL);
 			iomap_dio_complete_work(&dio->aio.work);
@@ -297,6 +387,17 @@ static loff_t iomap_dio_bio_iter(const struct iomap_iter *iter,
 	    ((dio->flags & IOMAP_DIO_WRITE) && pos >= i_size_read(inode)))
 		dio->iocb->ki_flags &= ~IOCB_HIPRI;
 
+	/*
+	 * Completion can only be handed to the issuer for pure overwrites
+	 * that need no extent conversion, COW remapping, size update or
+	 * cache flush once the data is on disk.
+	 */
+	if (need_zeroout || (dio->flags & IOMAP_DIO_COW) ||
+	    ((dio->flags & IOMAP_DIO_NEED_SYNC) && !use_fua) ||
+	    ((dio->flags & IOMAP_DIO_WRITE) &&
+	     pos + length > i_size_read(inode)))
+		dio->flags &= ~IOMAP_DIO_CALLER_COMP;
+
 	if (need_zeroout) {
 		/* zero out from the start of the block to the write offset */
 		pad = pos & (fs_block_size - 1);
@@ -539,6 +640,14 @@ __iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 		iomi.flags |= IOMAP_WRITE;
 		dio->flags |= IOMAP_DIO_WRITE;
 
+		/*
+		 * Let an issuer that can run the completion from its own task
+		 * context do so, which avoids the workqueue bounce.  This is
+		 * cleared again when the write needs completion work.
+		 */
+		if (iocb->ki_flags & IOCB_DIO_CALLER_COMP)
+			dio->flags |= IOMAP_DIO_CALLER_COMP;
+
 		if (iocb->ki_flags & IOCB_NOWAIT) {
 			if (filemap_range_has_page(mapping, iomi.pos, end)) {
 				ret = -EAGAIN;
@@ -693,3 +802,13 @@ iomap_dio_rw(struct kiocb *iocb, struct iov_iter *iter,
 	return iomap_dio_complete(dio);
 }
 EXPORT_SYMBOL_GPL(iomap_dio_rw);
+
+static int __init iomap_dio_init(void)
+{
+	int cpu;
+
+	for_each_possible_cpu(cpu)
+		raw_spin_lock_init(&per_cpu(iomap_dio_batches, cpu).lock);
+	return 0;
+}
+fs_initcall(iomap_dio_init);
@@ -103,9 +103,30 @@ static void netfs_cache_expand_readahead(struct netfs_io_request *rreq,
 		cres->ops->expand_readahead(cres, _start, _len, i_size);
 }
 
+/*
+ * Grow a small readahead window forward into an aligned block of
+ * ra_min_size, so that the windows which would follow it are read as part of
+ * this request in larger subrequests rather than one request each.
+ */
+static void netfs_rreq_coalesce(struct netfs_io_request *rreq)
+{
+	struct netfs_inode *ctx = netfs_inode(rreq->inode);
+	unsigned int min_size = ctx->ra_min_size ?: READ_ONCE(netfs_ra_min_size);
+	loff_t end = rreq->start + rreq->len;
+	loff_t limit = round_up(rreq->i_size, PAGE_SIZE);
+
+	if (!min_size || rreq->len >= min_size || end >= limit)
+		return;
+
+	end = min(round_up(end, min_size), limit);
+	rreq->len = end - rreq->start;
+}
+
 static void netfs_rreq_expand(struct netfs_io_request *rreq,
 			      struct readahead_control *ractl)
 {
+	size_t old_len = readahead_length(ractl);
+
 	/* Give the cache a chance to change the request parameters.  The
 	 * resultant request must contain the original region.
 	 */
@@ -117,6 +138,8 @@ static void netfs_rreq_expand(struct netfs_io_request *rreq,
 	if (rreq->netfs_ops->expand_readahead)
 		rreq->netfs_ops->expand_readahead(rreq);
 
+	netfs_rreq_coalesce(rreq);
+
 	/* Expand the request if the cache wants it to start earlier.  Note
 	 * that the expansion may get further extended if the VM wishes to
 	 * insert THPs and the preferred start and/or end wind up in the middle
@@ -132,6 +155,10 @@ static void netfs_rreq_expand(struct netfs_io_request *rreq,
 		rreq->start  = readahead_pos(ractl);
 		rreq->len = readahead_length(ractl);
 
+		if (rreq->len > old_len)
+			netfs_mount_stat_add(netfs_inode(rreq->inode),
+					     ra_coalesced, rreq->len - old_len);
+
 		trace_netfs_read(rreq, readahead_pos(ractl), readahead_length(ractl),
 				 netfs_read_trace_expanded);
 	}
@@ -29,6 +29,8 @@ int netfs_begin_read(struct netfs_io_request *rreq, bool sync);
  * main.c
  */
 extern unsigned int netfs_debug;
+extern unsigned int netfs_max_reads_in_flight;
+extern unsigned int netfs_ra_min_size;
 
 /*
  * objects.c
@@ -83,11 +85,20 @@ static inline void netfs_stat_d(atomic_t *stat)
 	atomic_dec(stat);
 }
 
+#define netfs_mount_stat_add(ctx, member, n)					\
+do {										\
+	if ((ctx)->stats)							\
+		atomic_long_add((n), &(ctx)->stats->member);			\
+} while (0)
+
 #else
 #define netfs_stat(x) do {} while(0)
 #define netfs_stat_d(x) do {} while(0)
+#define netfs_mount_stat_add(ctx, member, n) do {} while(0)
 #endif
 
+#define netfs_mount_stat(ctx, member) netfs_mount_stat_add(ctx, member, 1)
+
 /*
  * Miscellaneous functions.
  */
@@ -88,9 +88,32 @@ static void netfs_read_from_server(struct netfs_io_request *rreq,
 				   struct netfs_io_subrequest *subreq)
 {
 	netfs_stat(&netfs_n_rh_download);
+	atomic_inc(&netfs_inode(rreq->inode)->reads_in_flight);
 	rreq->netfs_ops->issue_read(subreq);
 }
 
+static unsigned int netfs_max_reads(struct netfs_inode *ctx)
+{
+	return ctx->max_reads_in_flight ?: READ_ONCE(netfs_max_reads_in_flight);
+}
+
+/*
+ * Wait for the number of server reads in flight on the inode to drop below
+ * the limit before issuing another one.
+ */
+static void netfs_throttle_read(struct netfs_io_request *rreq)
+{
+	struct netfs_inode *ctx = netfs_inode(rreq->inode);
+	unsigned int max = netfs_max_reads(ctx);
+
+	if (!max || atomic_read(&ctx->reads_in_flight) < max)
+		return;
+
+	netfs_mount_stat(ctx, throttled);
+	wait_var_event(&ctx->reads_in_flight,
+		       atomic_read(&ctx->reads_in_flight) < max);
+}
+
 /*
  * Release those waiting.
  */
@@ -246,6 +269,7 @@ static void netfs_rreq_short_read(struct netfs_io_request *rreq,
 	__set_bit(NETFS_SREQ_SEEK_DATA_READ, &subreq->flags);
 
 	netfs_stat(&netfs_n_rh_short_read);
+	netfs_mount_stat(netfs_inode(rreq->inode), short_reads);
 	trace_netfs_sreq(subreq, netfs_sreq_trace_resubmit_short);
 
 	netfs_get_subrequest(subreq, netfs_sreq_trace_get_short_read);
@@ -394,6 +418,7 @@ void netfs_subreq_terminated(struct netfs_io_subrequest *subreq,
 			     bool was_async)
 {
 	struct netfs_io_request *rreq = subreq->rreq;
+	struct netfs_inode *ctx = netfs_inode(rreq->inode);
 	int u;
 
 	_enter("[%u]{%llx,%lx},%zd",
@@ -403,9 +428,15 @@ void netfs_subreq_terminated(struct netfs_io_subrequest *subreq,
 	switch (subreq->source) {
 	case NETFS_READ_FROM_CACHE:
 		netfs_stat(&netfs_n_rh_read_done);
+		if (transferred_or_error > 0)
+			netfs_mount_stat_add(ctx, cache_bytes, transferred_or_error);
 		break;
 	case NETFS_DOWNLOAD_FROM_SERVER:
 		netfs_stat(&netfs_n_rh_download_done);
+		if (transferred_or_error > 0)
+			netfs_mount_stat_add(ctx, download_bytes, transferred_or_error);
+		if (atomic_dec_return(&ctx->reads_in_flight) < netfs_max_reads(ctx))
+			wake_up_var(&ctx->reads_in_flight);
 		break;
 	default:
 		break;
@@ -550,6 +581,7 @@ static bool netfs_rreq_submit_slice(struct netfs_io_request *rreq,
 	subreq->debug_index	= (*_debug_index)++;
 	subreq->start		= rreq->start + rreq->submitted;
 	subreq->len		= rreq->len   - rreq->submitted;
+	netfs_mount_stat(netfs_inode(rreq->inode), sreqs);
 
 	_debug("slice %llx,%zx,%zx", subreq->start, subreq->len, rreq->submitted);
 	list_add_tail(&subreq->rreq_link, &rreq->subrequests);
@@ -576,6 +608,7 @@ static bool netfs_rreq_submit_slice(struct netfs_io_request *rreq,
 		netfs_fill_with_zeroes(rreq, subreq);
 		break;
 	case NETFS_DOWNLOAD_FROM_SERVER:
+		netfs_throttle_read(rreq);
 		netfs_read_from_server(rreq, subreq);
 		break;
 	case NETFS_READ_FROM_CACHE:
@@ -613,6 +646,7 @@ int netfs_begin_read(struct netfs_io_request *rreq, bool sync)
 	}
 
 	INIT_WORK(&rreq->work, netfs_rreq_work);
+	netfs_mount_stat(netfs_inode(rreq->inode), rreqs);
 
 	if (sync)
 		netfs_get_request(rreq, netfs_rreq_trace_get_hold);
@@ -7,6 +7,8 @@
 
 #include <linux/module.h>
 #include <linux/export.h>
+#include <linux/log2.h>
+#include <linux/sizes.h>
 #include "internal.h"
 #define CREATE_TRACE_POINTS
 #include <trace/events/netfs.h>
@@ -18,3 +20,39 @@ MODULE_LICENSE("GPL");
 unsigned netfs_debug;
 module_param_named(debug, netfs_debug, uint, S_IWUSR | S_IRUGO);
 MODULE_PARM_DESC(netfs_debug, "Netfs support debugging mask");
+
+unsigned int netfs_max_reads_in_flight;
+module_param_named(max_reads_in_flight, netfs_max_reads_in_flight, uint, 0644);
+MODULE_PARM_DESC(max_reads_in_flight,
+		 "Default limit on server reads in flight per inode (0 = unlimited)");
+
+unsigned int netfs_ra_min_size;
+
+static int netfs_ra_min_kb_set(const char *val, const struct kernel_param *kp)
+{
+	unsigned int kb;
+	int ret;
+
+	ret = kstrtouint(val, 0, &kb);
+	if (ret)
+		return ret;
+	if (kb > SZ_64K)
+		return -EINVAL;
+
+	/* Windows are aligned to it, so keep it a power of two */
+	WRITE_ONCE(netfs_ra_min_size, kb ? rounddown_pow_of_two(kb) * SZ_1K : 0);
+	return 0;
+}
+
+static int netfs_ra_min_kb_get(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%u\n", READ_ONCE(netfs_ra_min_size) / SZ_1K);
+}
+
+static const struct kernel_param_ops netfs_ra_min_kb_ops = {
+	.set	= netfs_ra_min_kb_set,
+	.get	= netfs_ra_min_kb_get,
+};
+module_param_cb(readahead_min_kb, &netfs_ra_min_kb_ops, NULL, 0644);
+MODULE_PARM_DESC(readahead_min_kb,
+		 "Default size readahead windows are coalesced up to (0 = off)");
@@ -56,3 +56,24 @@ void netfs_stats_show(struct seq_file *m)
 		   atomic_read(&netfs_n_rh_write_failed));
 }
 EXPORT_SYMBOL(netfs_stats_show);
+
+/**
+ * netfs_mount_stats_show - Show the read statistics of a mount
+ * @m: The seq_file to write to
+ * @stats: The statistics of the mount
+ *
+ * Intended for use from a filesystem's ->show_stats() super operation, which
+ * makes the statistics appear in /proc/<pid>/mountstats.
+ */
+void netfs_mount_stats_show(struct seq_file *m, struct netfs_mount_stats *stats)
+{
+	seq_printf(m, "\tnetfs: rr=%lu sr=%lu dl=%lu cr=%lu sh=%lu th=%lu ra=%lu\n",
+		   atomic_long_read(&stats->rreqs),
+		   atomic_long_read(&stats->sreqs),
+		   atomic_long_read(&stats->download_bytes),
+		   atomic_long_read(&stats->cache_bytes),
+		   atomic_long_read(&stats->short_reads),
+		   atomic_long_read(&stats->throttled),
+		   atomic_long_read(&stats->ra_coalesced));
+}
+EXPORT_SYMBOL(netfs_mount_stats_show);
@@ -469,11 +469,12 @@ static inline struct path *fanotify_event_path(struct fanotify_event *event)
 }
 
 /*
- * Use 128 size hash table to speed up events merge.
+ * Use a hash table to speed up events merge.  The size is taken from
+ * /proc/sys/fs/fanotify/merge_hash_bits when the group is created.
  */
-#define FANOTIFY_HTABLE_BITS	(7)
-#define FANOTIFY_HTABLE_SIZE	(1 << FANOTIFY_HTABLE_BITS)
-#define FANOTIFY_HTABLE_MASK	(FANOTIFY_HTABLE_SIZE - 1)
+#define FANOTIFY_DEFAULT_HTABLE_BITS	(7)
+#define FANOTIFY_MIN_HTABLE_BITS	(1)
+#define FANOTIFY_MAX_HTABLE_BITS	(16)
 
 /*
  * Permission events and overflow event do not get merged - don't hash them.
@@ -488,7 +489,8 @@ static inline unsigned int fanotify_event_hash_bucket(
 						struct fsnotify_group *group,
 						struct fanotify_event *event)
 {
-	return event->hash & FANOTIFY_HTABLE_MASK;
+	return event->hash &
+		((1U << group->fanotify_data.merge_hash_bits) - 1);
 }
 
 static inline unsigned int fanotify_mark_user_flags(struct fsnotify_mark *mark)
@@ -51,6 +51,7 @@
 
 /* configurable via /proc/sys/fs/fanotify/ */
 static int fanotify_max_queued_events __read_mostly;
+static int fanotify_merge_hash_bits __read_mostly = FANOTIFY_DEFAULT_HTABLE_BITS;
 
 #ifdef CONFIG_SYSCTL
 
@@ -58,6 +59,8 @@ static int fanotify_max_queued_events __read_mostly;
 
 static long ft_zero = 0;
 static long ft_int_max = INT_MAX;
+static int ft_hash_bits_min = FANOTIFY_MIN_HTABLE_BITS;
+static int ft_hash_bits_max = FANOTIFY_MAX_HTABLE_BITS;
 
 static struct ctl_table fanotify_table[] = {
 	{
@@ -86,6 +89,15 @@ static struct ctl_table fanotify_table[] = {
 		.proc_handler	= proc_dointvec_minmax,
 		.extra1		= SYSCTL_ZERO
 	},
+	{
+		.procname	= "merge_hash_bits",
+		.data		= &fanotify_merge_hash_bits,
+		.maxlen		= sizeof(int),
+		.mode		= 0644,
+		.proc_handler	= proc_dointvec_minmax,
+		.extra1		= &ft_hash_bits_min,
+		.extra2		= &ft_hash_bits_max,
+	},
 	{ }
 };
 
@@ -1287,16 +1299,16 @@ static struct fsnotify_event *fanotify_alloc_overflow_event(void)
 	return &oevent->fse;
 }
 
-static struct hlist_head *fanotify_alloc_merge_hash(void)
+static struct hlist_head *fanotify_alloc_merge_hash(unsigned int bits)
 {
 	struct hlist_head *hash;
 
-	hash = kmalloc(sizeof(struct hlist_head) << FANOTIFY_HTABLE_BITS,
-		       GFP_KERNEL_ACCOUNT);
+	hash = kvmalloc_array(1U << bits, sizeof(struct hlist_head),
+			      GFP_KERNEL_ACCOUNT);
 	if (!hash)
 		return NULL;
 
-	__hash_init(hash, FANOTIFY_HTABLE_SIZE);
+	__hash_init(hash, 1U << bits);
 
 	return hash;
 }
@@ -1402,7 +1414,9 @@ SYSCALL_DEFINE2(fanotify_init, unsigned int, flags, unsigned int, event_f_flags)
 	group->fanotify_data.flags = flags | internal_flags;
 	group->memcg = get_mem_cgroup_from_mm(current->mm);
 
-	group->fanotify_data.merge_hash = fanotify_alloc_merge_hash();
+	group->fanotify_data.merge_hash_bits = READ_ONCE(fanotify_merge_hash_bits);
+	group->fanotify_data.merge_hash =
+		fanotify_alloc_merge_hash(group->fanotify_data.merge_hash_bits);
 	if (!group->fanotify_data.merge_hash) {
 		fd = -ENOMEM;
 		goto out_destroy_group;
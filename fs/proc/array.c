@@ -91,6 +91,7 @@
 #include <linux/user_namespace.h>
 #include <linux/fs_struct.h>
 #include <linux/kthread.h>
+#include <linux/proc_task_stat.h>
 
 #include <asm/processor.h>
 #include "internal.h"
@@ -657,6 +658,121 @@ int proc_tgid_stat(struct seq_file *m, struct pid_namespace *ns,
 	return do_task_stat(m, ns, pid, task, 1);
 }
 
+/*
+ * Fill the requested @mask groups of a /proc/task_stat record for the thread
+ * group led by @task, with the same values /proc/<pid>/stat and status show.
+ * Everything that needs the sighand lock is gathered under one acquisition.
+ * PROC_TASK_STAT_IO is left to the caller.
+ */
+void proc_task_stat_fill(struct proc_task_stat *st, struct pid_namespace *ns,
+			 struct user_namespace *user_ns,
+			 struct task_struct *task, u64 mask)
+{
+	unsigned long flags;
+
+	if (mask & PROC_TASK_STAT_BASIC) {
+		if (task->flags & PF_WQ_WORKER)
+			wq_worker_comm(st->comm, sizeof(st->comm), task);
+		else if (task->flags & PF_KTHREAD)
+			get_kthread_comm(st->comm, sizeof(st->comm), task);
+		else
+			__get_task_comm(st->comm, sizeof(st->comm), task);
+
+		st->state = *get_task_state(task);
+		st->flags = task->flags;
+		st->prio = task_prio(task);
+		st->nice = task_nice(task);
+		st->policy = task->policy;
+		st->rt_priority = task->rt_priority;
+		st->processor = task_cpu(task);
+		st->start_time_ns =
+			timens_add_boottime_ns(task->start_boottime);
+		st->mask |= PROC_TASK_STAT_BASIC;
+	}
+
+	if ((mask & (PROC_TASK_STAT_BASIC | PROC_TASK_STAT_CPU |
+		     PROC_TASK_STAT_FAULTS | PROC_TASK_STAT_MEM)) &&
+	    lock_task_sighand(task, &flags)) {
+		struct signal_struct *sig = task->signal;
+
+		if (mask & PROC_TASK_STAT_BASIC) {
+			if (sig->tty)
+				st->tty_nr = new_encode_dev(tty_devnum(sig->tty));
+			st->num_threads = get_nr_threads(task);
+			st->sid = task_session_nr_ns(task, ns);
+			st->ppid = task_tgid_nr_ns(task->real_parent, ns);
+			st->pgid = task_pgrp_nr_ns(task, ns);
+		}
+
+		if (mask & PROC_TASK_STAT_CPU) {
+			struct task_struct *t = task;
+			u64 gtime = sig->gtime;
+
+			do {
+				gtime += task_gtime(t);
+			} while_each_thread(task, t);
+
+			thread_group_cputime_adjusted(task, &st->utime,
+						      &st->stime);
+			st->cutime = sig->cutime;
+			st->cstime = sig->cstime;
+			st->gtime = gtime;
+			st->cgtime = sig->cgtime;
+			st->mask |= PROC_TASK_STAT_CPU;
+		}
+
+		if (mask & PROC_TASK_STAT_FAULTS) {
+			struct task_struct *t = task;
+			unsigned long min_flt = sig->min_flt;
+			unsigned long maj_flt = sig->maj_flt;
+
+			do {
+				min_flt += t->min_flt;
+				maj_flt += t->maj_flt;
+			} while_each_thread(task, t);
+
+			st->min_flt = min_flt;
+			st->maj_flt = maj_flt;
+			st->cmin_flt = sig->cmin_flt;
+			st->cmaj_flt = sig->cmaj_flt;
+			st->mask |= PROC_TASK_STAT_FAULTS;
+		}
+
+		if (mask & PROC_TASK_STAT_MEM)
+			st->rsslim = READ_ONCE(sig->rlim[RLIMIT_RSS].rlim_cur);
+
+		unlock_task_sighand(task, &flags);
+	}
+
+	if (mask & PROC_TASK_STAT_MEM) {
+		struct mm_struct *mm = get_task_mm(task);
+
+		if (mm) {
+			st->vsize = task_vsize(mm);
+			st->rss = get_mm_rss(mm) << PAGE_SHIFT;
+			mmput(mm);
+		}
+		st->mask |= PROC_TASK_STAT_MEM;
+	}
+
+	if (mask & PROC_TASK_STAT_CREDS) {
+		const struct cred *cred;
+
+		rcu_read_lock();
+		cred = __task_cred(task);
+		st->uid = from_kuid_munged(user_ns, cred->uid);
+		st->euid = from_kuid_munged(user_ns, cred->euid);
+		st->suid = from_kuid_munged(user_ns, cred->suid);
+		st->fsuid = from_kuid_munged(user_ns, cred->fsuid);
+		st->gid = from_kgid_munged(user_ns, cred->gid);
+		st->egid = from_kgid_munged(user_ns, cred->egid);
+		st->sgid = from_kgid_munged(user_ns, cred->sgid);
+		st->fsgid = from_kgid_munged(user_ns, cred->fsgid);
+		rcu_read_unlock();
+		st->mask |= PROC_TASK_STAT_CREDS;
+	}
+}
+
 int proc_pid_statm(struct seq_file *m, struct pid_namespace *ns,
 			struct pid *pid, struct task_struct *task)
 {
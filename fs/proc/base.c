@@ -96,6 +96,7 @@
 #include <linux/time_namespace.h>
 #include <linux/resctrl.h>
 #include <linux/cn_proc.h>
+#include <linux/proc_task_stat.h>
 #include <trace/events/oom.h>
 #include "internal.h"
 #include "fd.h"
@@ -2946,9 +2947,9 @@ static const struct file_operations proc_coredump_filter_operations = {
 #endif
 
 #ifdef CONFIG_TASK_IO_ACCOUNTING
-static int do_io_accounting(struct task_struct *task, struct seq_file *m, int whole)
+static int task_io_accounting_collect(struct task_struct *task,
+				      struct task_io_accounting *acct, int whole)
 {
-	struct task_io_accounting acct = task->ioac;
 	unsigned long flags;
 	int result;
 
@@ -2961,15 +2962,32 @@ static int do_io_accounting(struct task_struct *task, struct seq_file *m, int wh
 		goto out_unlock;
 	}
 
+	*acct = task->ioac;
 	if (whole && lock_task_sighand(task, &flags)) {
 		struct task_struct *t = task;
 
-		task_io_accounting_add(&acct, &task->signal->ioac);
+		task_io_accounting_add(acct, &task->signal->ioac);
 		while_each_thread(task, t)
-			task_io_accounting_add(&acct, &t->ioac);
+			task_io_accounting_add(acct, &t->ioac);
 
 		unlock_task_sighand(task, &flags);
 	}
+	result = 0;
+
+out_unlock:
+	up_read(&task->signal->exec_update_lock);
+	return result;
+}
+
+static int do_io_accounting(struct task_struct *task, struct seq_file *m, int whole)
+{
+	struct task_io_accounting acct;
+	int result;
+
+	result = task_io_accounting_collect(task, &acct, whole);
+	if (result)
+		return result;
+
 	seq_printf(m,
 		   "rchar: %llu\n"
 		   "wchar: %llu\n"
@@ -2985,11 +3003,7 @@ static int do_io_accounting(struct task_struct *task, struct seq_file *m, int wh
 		   (unsigned long long)acct.read_bytes,
 		   (unsigned long long)acct.write_bytes,
 		   (unsigned long long)acct.cancelled_write_bytes);
-	result = 0;
-
-out_unlock:
-	up_read(&task->signal->exec_update_lock);
-	return result;
+	return 0;
 }
 
 static int proc_tid_io_accounting(struct seq_file *m, struct pid_namespace *ns,
@@ -3239,6 +3253,7 @@ static const struct pid_entry tgid_base_stuff[] = {
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
 	REG("smaps",      S_IRUGO, proc_pid_smaps_operations),
 	REG("smaps_rollup", S_IRUGO, proc_pid_smaps_rollup_operations),
+	REG("smaps_rollup_fast", S_IRUGO, proc_pid_smaps_rollup_fast_operations),
 	REG("pagemap",    S_IRUSR, proc_pagemap_operations),
 #endif
 #ifdef CONFIG_SECURITY
@@ -3502,6 +3517,147 @@ int proc_pid_readdir(struct file *file, struct dir_context *ctx)
 	return 0;
 }
 
+/*
+ * /proc/task_stat: fixed layout records for many thread groups per read(2),
+ * see include/uapi/linux/proc_task_stat.h.
+ */
+static int proc_task_stat_open(struct inode *inode, struct file *file)
+{
+	u64 *mask;
+
+	mask = kmalloc(sizeof(*mask), GFP_KERNEL);
+	if (!mask)
+		return -ENOMEM;
+
+	*mask = PROC_TASK_STAT_BASIC;
+	file->private_data = mask;
+	return 0;
+}
+
+static int proc_task_stat_release(struct inode *inode, struct file *file)
+{
+	kfree(file->private_data);
+	return 0;
+}
+
+static long proc_task_stat_ioctl(struct file *file, unsigned int cmd,
+				 unsigned long arg)
+{
+	struct proc_task_stat_query query;
+	u64 *mask = file->private_data;
+
+	if (cmd != PROC_TASK_STAT_IOC_QUERY)
+		return -ENOTTY;
+	if (copy_from_user(&query, (void __user *)arg, sizeof(query)))
+		return -EFAULT;
+	if (query.version != PROC_TASK_STAT_VERSION || query.reserved ||
+	    (query.mask & ~PROC_TASK_STAT_ALL))
+		return -EINVAL;
+
+	WRITE_ONCE(*mask, query.mask);
+	return 0;
+}
+
+static int proc_task_stat_one(struct proc_task_stat *st,
+			      struct pid_namespace *ns,
+			      struct user_namespace *user_ns,
+			      struct task_struct *task, u64 mask)
+{
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+	struct task_io_accounting acct;
+	int ret;
+#endif
+
+	proc_task_stat_fill(st, ns, user_ns, task, mask);
+
+#ifdef CONFIG_TASK_IO_ACCOUNTING
+	if (!(mask & PROC_TASK_STAT_IO))
+		return 0;
+
+	/* like /proc/<pid>/io, only report groups we could ptrace */
+	ret = task_io_accounting_collect(task, &acct, 1);
+	if (ret == -EACCES)
+		return 0;
+	if (ret)
+		return ret;
+
+	st->rchar = acct.rchar;
+	st->wchar = acct.wchar;
+	st->syscr = acct.syscr;
+	st->syscw = acct.syscw;
+	st->read_bytes = acct.read_bytes;
+	st->write_bytes = acct.write_bytes;
+	st->cancelled_write_bytes = acct.cancelled_write_bytes;
+	st->mask |= PROC_TASK_STAT_IO;
+#endif
+	return 0;
+}
+
+static ssize_t proc_task_stat_read(struct file *file, char __user *buf,
+				   size_t count, loff_t *ppos)
+{
+	struct super_block *sb = file_inode(file)->i_sb;
+	struct proc_fs_info *fs_info = proc_sb_info(sb);
+	struct pid_namespace *ns = proc_pid_ns(sb);
+	u64 mask = READ_ONCE(*(u64 *)file->private_data);
+	struct proc_task_stat *st;
+	struct tgid_iter iter;
+	size_t copied = 0;
+	int ret = 0;
+
+	if (count < sizeof(*st))
+		return -EINVAL;
+	if (*ppos < 0 || *ppos >= PID_MAX_LIMIT)
+		return 0;
+
+	st = kmalloc(sizeof(*st), GFP_KERNEL);
+	if (!st)
+		return -ENOMEM;
+
+	iter.tgid = *ppos;
+	iter.task = NULL;
+	while (count - copied >= sizeof(*st)) {
+		iter = next_tgid(ns, iter);
+		if (!iter.task) {
+			*ppos = PID_MAX_LIMIT;
+			break;
+		}
+
+		cond_resched();
+		if (has_pid_permissions(fs_info, iter.task, HIDEPID_INVISIBLE)) {
+			memset(st, 0, sizeof(*st));
+			st->size = sizeof(*st);
+			st->pid = iter.tgid;
+			ret = proc_task_stat_one(st, ns, file->f_cred->user_ns,
+						 iter.task, mask);
+			if (!ret && copy_to_user(buf + copied, st, sizeof(*st)))
+				ret = -EFAULT;
+			if (ret)
+				break;
+			copied += sizeof(*st);
+		}
+
+		iter.tgid += 1;
+		*ppos = iter.tgid;
+	}
+	if (iter.task)
+		put_task_struct(iter.task);
+
+	kfree(st);
+	return copied ? copied : ret;
+}
+
+const struct proc_ops proc_task_stat_ops = {
+	.proc_open	= proc_task_stat_open,
+	.proc_release	= proc_task_stat_release,
+	.proc_read	= proc_task_stat_read,
+	.proc_ioctl	= proc_task_stat_ioctl,
+#ifdef CONFIG_COMPAT
+	.proc_compat_ioctl = compat_ptr_ioctl,
+#endif
+	.proc_lseek	= default_llseek,
+};
+
 /*
  * proc_tid_comm_permission is a special permission function exclusively
  * used for the node /proc/<pid>/task/<tid>/comm.
@@ -3585,6 +3741,7 @@ static const struct pid_entry tid_base_stuff[] = {
 	REG("clear_refs", S_IWUSR, proc_clear_refs_operations),
 	REG("smaps",     S_IRUGO, proc_pid_smaps_operations),
 	REG("smaps_rollup", S_IRUGO, proc_pid_smaps_rollup_operations),
+	REG("smaps_rollup_fast", S_IRUGO, proc_pid_smaps_rollup_fast_operations),
 	REG("pagemap",    S_IRUSR, proc_pagemap_operations),
 #endif
 #ifdef CONFIG_SECURITY
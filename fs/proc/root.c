@@ -289,6 +289,7 @@ void __init proc_root_init(void)
 	proc_self_init();
 	proc_thread_self_init();
 	proc_symlink("mounts", NULL, "self/mounts");
+	proc_create("task_stat", 0444, NULL, &proc_task_stat_ops);
 
 	proc_net_init();
 	proc_mkdir("fs", NULL);
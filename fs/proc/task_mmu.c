@@ -983,6 +983,112 @@ static int show_smaps_rollup(struct seq_file *m, void *v)
 	release_task_mempolicy(priv);
 	mmap_read_unlock(mm);
 
+out_put_mm:
+	mmput(mm);
+out_put_task:
+	put_task_struct(priv->task);
+	priv->task = NULL;
+
+	return ret;
+}
+
+/*
+ * smaps_rollup_fast: the resident and swap sizes come from the mm counters
+ * that are kept up to date at fault and unmap time, so reading them costs
+ * neither a page table walk nor mmap_lock. Pss can only be known by looking
+ * at every mapped page; it is estimated from a sample of roughly
+ * SMAPS_FAST_SAMPLES PMD sized ranges spread evenly over the address space,
+ * scaled by the ratio of the resident size to the sampled resident size.
+ * The walk drops mmap_lock whenever a writer is waiting for it.
+ */
+#define SMAPS_FAST_SAMPLES	1024
+
+static u64 smaps_fast_scale(u64 val, unsigned long rss, unsigned long sampled)
+{
+	if (!sampled || sampled >= rss)
+		return val;
+	return mul_u64_u64_div_u64(val, rss, sampled);
+}
+
+static int show_smaps_rollup_fast(struct seq_file *m, void *v)
+{
+	struct proc_maps_private *priv = m->private;
+	struct mem_size_stats mss;
+	struct mm_struct *mm = priv->mm;
+	struct vm_area_struct *vma;
+	unsigned long anon, file, shmem, swap, rss;
+	unsigned long stride, chunk = 0;
+	int ret = 0;
+	MA_STATE(mas, &mm->mm_mt, 0, 0);
+
+	priv->task = get_proc_task(priv->inode);
+	if (!priv->task)
+		return -ESRCH;
+
+	if (!mm || !mmget_not_zero(mm)) {
+		ret = -ESRCH;
+		goto out_put_task;
+	}
+
+	anon = get_mm_counter(mm, MM_ANONPAGES) << PAGE_SHIFT;
+	file = get_mm_counter(mm, MM_FILEPAGES) << PAGE_SHIFT;
+	shmem = get_mm_counter(mm, MM_SHMEMPAGES) << PAGE_SHIFT;
+	swap = get_mm_counter(mm, MM_SWAPENTS) << PAGE_SHIFT;
+	rss = anon + file + shmem;
+
+	memset(&mss, 0, sizeof(mss));
+	stride = max(1UL, (READ_ONCE(mm->total_vm) >> (PMD_SHIFT - PAGE_SHIFT)) /
+		     SMAPS_FAST_SAMPLES);
+
+	ret = mmap_read_lock_killable(mm);
+	if (ret)
+		goto out_put_mm;
+
+	hold_task_mempolicy(priv);
+	mas_for_each(&mas, vma, ULONG_MAX) {
+		unsigned long addr, end;
+
+		for (addr = vma->vm_start; addr < vma->vm_end; addr = end) {
+			end = pmd_addr_end(addr, vma->vm_end);
+			if (chunk++ % stride)
+				continue;
+			walk_page_range(mm, addr, end, &smaps_walk_ops, &mss);
+		}
+
+		/*
+		 * Release mmap_lock temporarily if someone wants to
+		 * access it for write request. This is an estimate, so
+		 * just carry on from wherever the tree is after relocking.
+		 */
+		if (mmap_lock_is_contended(mm)) {
+			mas_pause(&mas);
+			mmap_read_unlock(mm);
+			ret = mmap_read_lock_killable(mm);
+			if (ret) {
+				release_task_mempolicy(priv);
+				goto out_put_mm;
+			}
+		}
+	}
+	release_task_mempolicy(priv);
+	mmap_read_unlock(mm);
+
+	SEQ_PUT_DEC("Rss:            ", rss);
+	SEQ_PUT_DEC(" kB\nRss_Anon:       ", anon);
+	SEQ_PUT_DEC(" kB\nRss_File:       ", file);
+	SEQ_PUT_DEC(" kB\nRss_Shmem:      ", shmem);
+	SEQ_PUT_DEC(" kB\nSwap:           ", swap);
+	SEQ_PUT_DEC(" kB\nPss:            ",
+		smaps_fast_scale(mss.pss, rss, mss.resident) >> PSS_SHIFT);
+	SEQ_PUT_DEC(" kB\nPss_Anon:       ",
+		smaps_fast_scale(mss.pss_anon, rss, mss.resident) >> PSS_SHIFT);
+	SEQ_PUT_DEC(" kB\nPss_File:       ",
+		smaps_fast_scale(mss.pss_file, rss, mss.resident) >> PSS_SHIFT);
+	SEQ_PUT_DEC(" kB\nPss_Shmem:      ",
+		smaps_fast_scale(mss.pss_shmem, rss, mss.resident) >> PSS_SHIFT);
+	SEQ_PUT_DEC(" kB\nRss_Sampled:    ", mss.resident);
+	seq_puts(m, " kB\n");
+
 out_put_mm:
 	mmput(mm);
 out_put_task:
@@ -1005,7 +1111,8 @@ static int pid_smaps_open(struct inode *inode, struct file *file)
 	return do_maps_open(inode, file, &proc_pid_smaps_op);
 }
 
-static int smaps_rollup_open(struct inode *inode, struct file *file)
+static int __smaps_rollup_open(struct inode *inode, struct file *file,
+			       int (*show)(struct seq_file *, void *))
 {
 	int ret;
 	struct proc_maps_private *priv;
@@ -1014,7 +1121,7 @@ static int smaps_rollup_open(struct inode *inode, struct file *file)
 	if (!priv)
 		return -ENOMEM;
 
-	ret = single_open(file, show_smaps_rollup, priv);
+	ret = single_open(file, show, priv);
 	if (ret)
 		goto out_free;
 
@@ -1034,6 +1141,16 @@ static int smaps_rollup_open(struct inode *inode, struct file *file)
 	return ret;
 }
 
+static int smaps_rollup_open(struct inode *inode, struct file *file)
+{
+	return __smaps_rollup_open(inode, file, show_smaps_rollup);
+}
+
+static int smaps_rollup_fast_open(struct inode *inode, struct file *file)
+{
+	return __smaps_rollup_open(inode, file, show_smaps_rollup_fast);
+}
+
 static int smaps_rollup_release(struct inode *inode, struct file *file)
 {
 	struct seq_file *seq = file->private_data;
@@ -1060,6 +1177,13 @@ const struct file_operations proc_pid_smaps_rollup_operations = {
 	.release	= smaps_rollup_release,
 };
 
+const struct file_operations proc_pid_smaps_rollup_fast_operations = {
+	.open		= smaps_rollup_fast_open,
+	.read		= seq_read,
+	.llseek		= seq_lseek,
+	.release	= smaps_rollup_release,
+};
+
 enum clear_refs_types {
 	CLEAR_REFS_ALL = 1,
 	CLEAR_REFS_ANON,
@@ -81,19 +81,23 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 			}
 
 			/*
-			 * At least one unused cache entry.  A simple
-			 * round-robin strategy is used to choose the entry to
-			 * be evicted from the cache.
+			 * At least one unused cache entry.  Evict the least
+			 * recently used one, so that blocks shared by many
+			 * readers (e.g. fragments of small files) survive a
+			 * stream of one-off lookups.
 			 */
-			i = cache->next_blk;
+			i = -1;
 			for (n = 0; n < cache->entries; n++) {
-				if (cache->entry[i].refcount == 0)
-					break;
-				i = (i + 1) % cache->entries;
+				if (cache->entry[n].refcount)
+					continue;
+				if (i < 0 || time_before(cache->entry[n].last_use,
+						cache->entry[i].last_use))
+					i = n;
 			}
 
-			cache->next_blk = (i + 1) % cache->entries;
+			cache->misses++;
 			entry = &cache->entry[i];
+			entry->last_use = ++cache->clock;
 
 			/*
 			 * Initialise chosen cache entry, and fill it in from
@@ -141,6 +145,8 @@ struct squashfs_cache_entry *squashfs_cache_get(struct super_block *sb,
 		if (entry->refcount == 0)
 			cache->unused--;
 		entry->refcount++;
+		entry->last_use = ++cache->clock;
+		cache->hits++;
 
 		/*
 		 * If the entry is currently being filled in by another process
@@ -238,7 +244,6 @@ struct squashfs_cache *squashfs_cache_init(char *name, int entries,
 	}
 
 	cache->curr_blk = 0;
-	cache->next_blk = 0;
 	cache->unused = entries;
 	cache->entries = entries;
 	cache->block_size = block_size;
@@ -34,6 +34,7 @@
 #include <linux/string.h>
 #include <linux/pagemap.h>
 #include <linux/mutex.h>
+#include <linux/workqueue.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -532,6 +533,81 @@ static int squashfs_readahead_fragment(struct page **page,
 	return buffer->error;
 }
 
+/*
+ * One datablock of a readahead window. The pages are locked and
+ * referenced, and are released once the block has been decompressed
+ * into them.
+ */
+struct squashfs_readahead_block {
+	struct work_struct work;
+	struct super_block *sb;
+	u64 block;
+	int bsize;
+	unsigned int expected;
+	pgoff_t file_end;
+	unsigned int nr_pages;
+	struct page *pages[];
+};
+
+/*
+ * Decompress one datablock into its locked pages and release them.
+ */
+static void squashfs_readahead_pages(struct super_block *sb,
+	struct page **pages, unsigned int nr_pages, u64 block, int bsize,
+	unsigned int expected, pgoff_t file_end)
+{
+	struct squashfs_page_actor *actor;
+	int i, res = -ENOMEM;
+
+	actor = squashfs_page_actor_init_special(sb->s_fs_info, pages,
+						 nr_pages, expected);
+	if (actor) {
+		res = squashfs_read_data(sb, block, bsize, NULL, actor);
+		kfree(actor);
+	}
+
+	if (res == expected) {
+		int bytes;
+
+		/* Last page (if present) may have trailing bytes not filled */
+		bytes = res % PAGE_SIZE;
+		if (pages[nr_pages - 1]->index == file_end && bytes)
+			memzero_page(pages[nr_pages - 1], bytes,
+				     PAGE_SIZE - bytes);
+
+		for (i = 0; i < nr_pages; i++) {
+			flush_dcache_page(pages[i]);
+			SetPageUptodate(pages[i]);
+		}
+	}
+
+	for (i = 0; i < nr_pages; i++) {
+		unlock_page(pages[i]);
+		put_page(pages[i]);
+	}
+}
+
+static void squashfs_readahead_block_read(struct squashfs_readahead_block *rb)
+{
+	squashfs_readahead_pages(rb->sb, rb->pages, rb->nr_pages, rb->block,
+				 rb->bsize, rb->expected, rb->file_end);
+	kfree(rb);
+}
+
+static void squashfs_readahead_block_work(struct work_struct *work)
+{
+	squashfs_readahead_block_read(container_of(work,
+			struct squashfs_readahead_block, work));
+}
+
+/*
+ * Readahead windows usually span several datablocks. Each of them is
+ * read and decompressed independently, so all but the first are handed
+ * to workers and decompressed in parallel, while the first one, which
+ * the reader is most likely waiting for, is done by the caller once the
+ * others are on their way. Readers of the remaining pages simply wait
+ * for the page locks as with any asynchronous readahead.
+ */
 static void squashfs_readahead(struct readahead_control *ractl)
 {
 	struct inode *inode = ractl->mapping->host;
@@ -540,11 +616,11 @@ static void squashfs_readahead(struct readahead_control *ractl)
 	unsigned short shift = msblk->block_log - PAGE_SHIFT;
 	loff_t start = readahead_pos(ractl) & ~mask;
 	size_t len = readahead_length(ractl) + readahead_pos(ractl) - start;
-	struct squashfs_page_actor *actor;
 	unsigned int nr_pages = 0;
 	struct page **pages;
 	int i, file_end = i_size_read(inode) >> msblk->block_log;
 	unsigned int max_pages = 1UL << shift;
+	struct squashfs_readahead_block *first = NULL;
 
 	readahead_expand(ractl, start, (len | mask) + 1);
 
@@ -553,6 +629,7 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		return;
 
 	for (;;) {
+		struct squashfs_readahead_block *rb;
 		pgoff_t index;
 		int res, bsize;
 		u64 block = 0;
@@ -586,37 +663,34 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		if (bsize == 0)
 			goto skip_pages;
 
-		actor = squashfs_page_actor_init_special(msblk, pages, nr_pages,
-							 expected);
-		if (!actor)
-			goto skip_pages;
-
-		res = squashfs_read_data(inode->i_sb, block, bsize, NULL, actor);
-
-		kfree(actor);
-
-		if (res == expected) {
-			int bytes;
+		rb = kmalloc(struct_size(rb, pages, nr_pages), GFP_KERNEL);
+		if (!rb) {
+			squashfs_readahead_pages(inode->i_sb, pages, nr_pages,
+						 block, bsize, expected,
+						 file_end);
+			continue;
+		}
 
-			/* Last page (if present) may have trailing bytes not filled */
-			bytes = res % PAGE_SIZE;
-			if (pages[nr_pages - 1]->index == file_end && bytes)
-				memzero_page(pages[nr_pages - 1], bytes,
-					     PAGE_SIZE - bytes);
+		rb->sb = inode->i_sb;
+		rb->block = block;
+		rb->bsize = bsize;
+		rb->expected = expected;
+		rb->file_end = file_end;
+		rb->nr_pages = nr_pages;
+		memcpy(rb->pages, pages, nr_pages * sizeof(*pages));
 
-			for (i = 0; i < nr_pages; i++) {
-				flush_dcache_page(pages[i]);
-				SetPageUptodate(pages[i]);
-			}
+		if (!first) {
+			first = rb;
+			continue;
 		}
 
-		for (i = 0; i < nr_pages; i++) {
-			unlock_page(pages[i]);
-			put_page(pages[i]);
-		}
+		INIT_WORK(&rb->work, squashfs_readahead_block_work);
+		queue_work(system_unbound_wq, &rb->work);
 	}
 
 	kfree(pages);
+	if (first)
+		squashfs_readahead_block_read(first);
 	return;
 
 skip_pages:
@@ -625,6 +699,8 @@ static void squashfs_readahead(struct readahead_control *ractl)
 		put_page(pages[i]);
 	}
 	kfree(pages);
+	if (first)
+		squashfs_readahead_block_read(first);
 }
 
 const struct address_space_operations squashfs_aops = {
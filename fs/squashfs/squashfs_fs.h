@@ -11,6 +11,8 @@
  */
 
 #define SQUASHFS_CACHED_FRAGMENTS	CONFIG_SQUASHFS_FRAGMENT_CACHE_SIZE
+/* upper bound for the fragment_cache= mount option */
+#define SQUASHFS_MAX_CACHED_FRAGMENTS	256
 #define SQUASHFS_MAJOR			4
 #define SQUASHFS_MINOR			0
 #define SQUASHFS_START			0
@@ -10,13 +10,18 @@
  * squashfs_fs_sb.h
  */
 
+#include <linux/kobject.h>
+#include <linux/completion.h>
+
 #include "squashfs_fs.h"
 
 struct squashfs_cache {
 	char			*name;
 	int			entries;
 	int			curr_blk;
-	int			next_blk;
+	unsigned long		clock;
+	unsigned long		hits;
+	unsigned long		misses;
 	int			num_waiters;
 	int			unused;
 	int			block_size;
@@ -30,6 +35,7 @@ struct squashfs_cache_entry {
 	u64			block;
 	int			length;
 	int			refcount;
+	unsigned long		last_use;
 	u64			next_index;
 	int			pending;
 	int			error;
@@ -66,5 +72,8 @@ struct squashfs_sb_info {
 	int					xattr_ids;
 	unsigned int				ids;
 	bool					panic_on_errors;
+	u64					fragment_cache_size;
+	struct kobject				kobj;
+	struct completion			kobj_unregister;
 };
 #endif
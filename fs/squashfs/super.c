@@ -47,10 +47,12 @@ enum Opt_errors {
 
 enum squashfs_param {
 	Opt_errors,
+	Opt_fragment_cache,
 };
 
 struct squashfs_mount_opts {
 	enum Opt_errors errors;
+	u64 fragment_cache;
 };
 
 static const struct constant_table squashfs_param_errors[] = {
@@ -61,6 +63,7 @@ static const struct constant_table squashfs_param_errors[] = {
 
 static const struct fs_parameter_spec squashfs_fs_parameters[] = {
 	fsparam_enum("errors", Opt_errors, squashfs_param_errors),
+	fsparam_string("fragment_cache", Opt_fragment_cache),
 	{}
 };
 
@@ -68,6 +71,7 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 {
 	struct squashfs_mount_opts *opts = fc->fs_private;
 	struct fs_parse_result result;
+	char *end;
 	int opt;
 
 	opt = fs_parse(fc, squashfs_fs_parameters, param, &result);
@@ -78,6 +82,11 @@ static int squashfs_parse_param(struct fs_context *fc, struct fs_parameter *para
 	case Opt_errors:
 		opts->errors = result.uint_32;
 		break;
+	case Opt_fragment_cache:
+		opts->fragment_cache = memparse(param->string, &end);
+		if (*end)
+			return invalfc(fc, "Bad fragment_cache size");
+		break;
 	default:
 		return -EINVAL;
 	}
@@ -113,6 +122,21 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(
 }
 
 
+/*
+ * The fragment cache holds SQUASHFS_CACHED_FRAGMENTS blocks unless the
+ * fragment_cache= mount option gives it a memory budget.
+ */
+static int squashfs_fragment_cache_entries(struct squashfs_sb_info *msblk)
+{
+	u64 entries;
+
+	if (!msblk->fragment_cache_size)
+		return SQUASHFS_CACHED_FRAGMENTS;
+
+	entries = div_u64(msblk->fragment_cache_size, msblk->block_size);
+	return clamp_t(u64, entries, 1, SQUASHFS_MAX_CACHED_FRAGMENTS);
+}
+
 static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 {
 	struct squashfs_mount_opts *opts = fc->fs_private;
@@ -135,6 +159,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 	msblk = sb->s_fs_info;
 
 	msblk->panic_on_errors = (opts->errors == Opt_errors_panic);
+	msblk->fragment_cache_size = opts->fragment_cache;
 
 	msblk->devblksize = sb_min_blocksize(sb, SQUASHFS_DEVBLK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
@@ -321,7 +346,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto check_directory_table;
 
 	msblk->fragment_cache = squashfs_cache_init("fragment",
-		SQUASHFS_CACHED_FRAGMENTS, msblk->block_size);
+		squashfs_fragment_cache_entries(msblk), msblk->block_size);
 	if (msblk->fragment_cache == NULL) {
 		err = -ENOMEM;
 		goto failed_mount;
@@ -351,6 +376,10 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 		goto insanity;
 	}
 
+	err = squashfs_sysfs_register(sb);
+	if (err)
+		goto failed_mount;
+
 	/* allocate root */
 	root = new_inode(sb);
 	if (!root) {
@@ -380,6 +409,7 @@ static int squashfs_fill_super(struct super_block *sb, struct fs_context *fc)
 insanity:
 	errorf(fc, "squashfs image failed sanity check");
 failed_mount:
+	squashfs_sysfs_unregister(sb);
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
@@ -435,6 +465,9 @@ static int squashfs_show_options(struct seq_file *s, struct dentry *root)
 	else
 		seq_puts(s, ",errors=continue");
 
+	if (msblk->fragment_cache_size)
+		seq_printf(s, ",fragment_cache=%llu", msblk->fragment_cache_size);
+
 	return 0;
 }
 
@@ -475,6 +508,7 @@ static void squashfs_put_super(struct super_block *sb)
 {
 	if (sb->s_fs_info) {
 		struct squashfs_sb_info *sbi = sb->s_fs_info;
+		squashfs_sysfs_unregister(sb);
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
@@ -529,8 +563,15 @@ static int __init init_squashfs_fs(void)
 	if (err)
 		return err;
 
+	err = squashfs_sysfs_init();
+	if (err) {
+		destroy_inodecache();
+		return err;
+	}
+
 	err = register_filesystem(&squashfs_fs_type);
 	if (err) {
+		squashfs_sysfs_exit();
 		destroy_inodecache();
 		return err;
 	}
@@ -544,6 +585,7 @@ static int __init init_squashfs_fs(void)
 static void __exit exit_squashfs_fs(void)
 {
 	unregister_filesystem(&squashfs_fs_type);
+	squashfs_sysfs_exit();
 	destroy_inodecache();
 }
 
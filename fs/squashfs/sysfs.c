@@ -0,0 +1,145 @@
+// SPDX-License-Identifier: GPL-2.0-or-later
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * sysfs.c
+ */
+
+/*
+ * Per mount statistics of the decompressed block caches, exported as
+ * /sys/fs/squashfs/<dev>/{metadata,fragment,data}_cache.  Each file reads
+ * as "entries hits misses".
+ */
+
+#include <linux/fs.h>
+#include <linux/kobject.h>
+#include <linux/sysfs.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs.h"
+
+static struct kset *squashfs_kset;
+
+struct squashfs_attr {
+	struct attribute attr;
+	ssize_t (*show)(struct squashfs_sb_info *, char *);
+};
+
+static ssize_t squashfs_cache_stat_show(struct squashfs_cache *cache,
+	char *buf)
+{
+	unsigned long hits = 0, misses = 0;
+	int entries = 0;
+
+	if (cache) {
+		spin_lock(&cache->lock);
+		entries = cache->entries;
+		hits = cache->hits;
+		misses = cache->misses;
+		spin_unlock(&cache->lock);
+	}
+
+	return sysfs_emit(buf, "%8d %8lu %8lu\n", entries, hits, misses);
+}
+
+static ssize_t metadata_cache_show(struct squashfs_sb_info *msblk, char *buf)
+{
+	return squashfs_cache_stat_show(msblk->block_cache, buf);
+}
+
+static ssize_t fragment_cache_show(struct squashfs_sb_info *msblk, char *buf)
+{
+	return squashfs_cache_stat_show(msblk->fragment_cache, buf);
+}
+
+static ssize_t data_cache_show(struct squashfs_sb_info *msblk, char *buf)
+{
+	return squashfs_cache_stat_show(msblk->read_page, buf);
+}
+
+#define SQUASHFS_ATTR_RO(_name) \
+	static struct squashfs_attr squashfs_attr_##_name = __ATTR_RO(_name)
+
+SQUASHFS_ATTR_RO(metadata_cache);
+SQUASHFS_ATTR_RO(fragment_cache);
+SQUASHFS_ATTR_RO(data_cache);
+
+static struct attribute *squashfs_attrs[] = {
+	&squashfs_attr_metadata_cache.attr,
+	&squashfs_attr_fragment_cache.attr,
+	&squashfs_attr_data_cache.attr,
+	NULL,
+};
+ATTRIBUTE_GROUPS(squashfs);
+
+static ssize_t squashfs_attr_show(struct kobject *kobj,
+	struct attribute *attr, char *buf)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+	struct squashfs_attr *sa = container_of(attr, struct squashfs_attr,
+		attr);
+
+	return sa->show(msblk, buf);
+}
+
+static const struct sysfs_ops squashfs_sysfs_ops = {
+	.show	= squashfs_attr_show,
+};
+
+static void squashfs_sb_release(struct kobject *kobj)
+{
+	struct squashfs_sb_info *msblk = container_of(kobj,
+		struct squashfs_sb_info, kobj);
+
+	complete(&msblk->kobj_unregister);
+}
+
+static struct kobj_type squashfs_sb_ktype = {
+	.default_groups	= squashfs_groups,
+	.sysfs_ops	= &squashfs_sysfs_ops,
+	.release	= squashfs_sb_release,
+};
+
+int squashfs_sysfs_register(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+	int err;
+
+	init_completion(&msblk->kobj_unregister);
+	err = kobject_init_and_add(&msblk->kobj, &squashfs_sb_ktype,
+		&squashfs_kset->kobj, "%s", sb->s_id);
+	if (err) {
+		kobject_put(&msblk->kobj);
+		wait_for_completion(&msblk->kobj_unregister);
+	}
+
+	return err;
+}
+
+void squashfs_sysfs_unregister(struct super_block *sb)
+{
+	struct squashfs_sb_info *msblk = sb->s_fs_info;
+
+	if (!msblk->kobj.state_in_sysfs)
+		return;
+
+	kobject_del(&msblk->kobj);
+	kobject_put(&msblk->kobj);
+	wait_for_completion(&msblk->kobj_unregister);
+}
+
+int __init squashfs_sysfs_init(void)
+{
+	squashfs_kset = kset_create_and_add("squashfs", NULL, fs_kobj);
+
+	return squashfs_kset ? 0 : -ENOMEM;
+}
+
+void squashfs_sysfs_exit(void)
+{
+	kset_unregister(squashfs_kset);
+}
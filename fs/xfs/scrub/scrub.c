@@ -4,6 +4,7 @@
  * Author: Darrick J. Wong <darrick.wong@oracle.com>
  */
 #include "xfs.h"
+#include <linux/ioprio.h>
 #include "xfs_fs.h"
 #include "xfs_shared.h"
 #include "xfs_format.h"
@@ -566,3 +567,166 @@ xfs_scrub_metadata(
 	}
 	return error;
 }
+
+/* Minimum rest between vector items for idle I/O priority callers. */
+#define XCHK_IDLE_REST_US	1000
+
+/*
+ * Start reading the headers of an AG that a vector is about to scrub so
+ * that the first scrubber does not have to wait for them with the AG
+ * locked.
+ */
+static void
+xchk_ag_readahead(
+	struct xfs_mount	*mp,
+	xfs_agnumber_t		agno)
+{
+	xfs_buf_readahead(mp->m_ddev_targp,
+			XFS_AG_DADDR(mp, agno, XFS_AGF_DADDR(mp)),
+			XFS_FSS_TO_BB(mp, 1), &xfs_agf_buf_ops);
+	xfs_buf_readahead(mp->m_ddev_targp,
+			XFS_AG_DADDR(mp, agno, XFS_AGI_DADDR(mp)),
+			XFS_FSS_TO_BB(mp, 1), &xfs_agi_buf_ops);
+	xfs_buf_readahead(mp->m_ddev_targp,
+			XFS_AG_DADDR(mp, agno, XFS_AGFL_DADDR(mp)),
+			XFS_FSS_TO_BB(mp, 1), &xfs_agfl_buf_ops);
+}
+
+/*
+ * Decide if there have been any scrub failures up to this point in the
+ * vector since the last barrier.
+ */
+static int
+xchk_scrubv_check_barrier(
+	struct xfs_scrub_vec		*vectors,
+	struct xfs_scrub_vec		*stop_vec)
+{
+	struct xfs_scrub_vec		*v;
+	__u32				failmask;
+
+	failmask = stop_vec->sv_flags & XFS_SCRUB_FLAGS_OUT;
+
+	for (v = stop_vec - 1; v >= vectors; v--) {
+		if (v->sv_type == XFS_SCRUB_TYPE_BARRIER)
+			break;
+		if (v->sv_ret || (v->sv_flags & failmask))
+			return -ECANCELED;
+	}
+	return 0;
+}
+
+/* Sleep between vector items so that foreground I/O can make progress. */
+static int
+xchk_scrubv_rest(
+	unsigned int			rest_us)
+{
+	if (IOPRIO_PRIO_CLASS(get_current_ioprio()) == IOPRIO_CLASS_IDLE)
+		rest_us = max_t(unsigned int, rest_us, XCHK_IDLE_REST_US);
+
+	if (rest_us) {
+		ktime_t			expires;
+
+		expires = ktime_add_us(ktime_get(), rest_us);
+		set_current_state(TASK_KILLABLE);
+		schedule_hrtimeout(&expires, HRTIMER_MODE_ABS);
+	} else {
+		cond_resched();
+	}
+
+	if (fatal_signal_pending(current))
+		return -EINTR;
+	return 0;
+}
+
+/* Scrub a vector of metadata types against one object. */
+int
+xfs_ioc_scrubv_metadata(
+	struct file			*file,
+	void				__user *arg)
+{
+	struct xfs_scrub_vec_head	__user *uhead = arg;
+	struct xfs_mount		*mp = XFS_I(file_inode(file))->i_mount;
+	struct xfs_scrub_vec_head	head;
+	struct xfs_scrub_vec		*vectors;
+	struct xfs_scrub_vec		__user *uvectors;
+	struct xfs_scrub_vec		*v;
+	size_t				vec_bytes;
+	bool				want_ra = false;
+	unsigned int			i;
+	int				error = 0;
+
+	if (!capable(CAP_SYS_ADMIN))
+		return -EPERM;
+	if (copy_from_user(&head, uhead, sizeof(head)))
+		return -EFAULT;
+	if (head.svh_reserved)
+		return -EINVAL;
+	if (head.svh_flags & ~XFS_SCRUB_VEC_FLAGS_ALL)
+		return -EINVAL;
+	if (head.svh_nr == 0)
+		return 0;
+
+	vec_bytes = array_size(head.svh_nr, sizeof(struct xfs_scrub_vec));
+	if (vec_bytes > PAGE_SIZE)
+		return -ENOMEM;
+
+	uvectors = u64_to_user_ptr(head.svh_vectors);
+	vectors = memdup_user(uvectors, vec_bytes);
+	if (IS_ERR(vectors))
+		return PTR_ERR(vectors);
+
+	for (i = 0, v = vectors; i < head.svh_nr; i++, v++) {
+		if (v->sv_reserved) {
+			error = -EINVAL;
+			goto out_free;
+		}
+		if (v->sv_type == XFS_SCRUB_TYPE_BARRIER) {
+			if (v->sv_flags & ~XFS_SCRUB_FLAGS_OUT) {
+				error = -EINVAL;
+				goto out_free;
+			}
+			continue;
+		}
+		if (v->sv_type < XFS_SCRUB_TYPE_NR &&
+		    meta_scrub_ops[v->sv_type].type == ST_PERAG)
+			want_ra = true;
+	}
+
+	if (want_ra && head.svh_agno < mp->m_sb.sb_agcount)
+		xchk_ag_readahead(mp, head.svh_agno);
+
+	/* Run all the scrubbers. */
+	for (i = 0, v = vectors; i < head.svh_nr; i++, v++) {
+		struct xfs_scrub_metadata	sm = {
+			.sm_type		= v->sv_type,
+			.sm_flags		= v->sv_flags,
+			.sm_ino			= head.svh_ino,
+			.sm_gen			= head.svh_gen,
+			.sm_agno		= head.svh_agno,
+		};
+
+		if (v->sv_type == XFS_SCRUB_TYPE_BARRIER) {
+			v->sv_ret = xchk_scrubv_check_barrier(vectors, v);
+			if (v->sv_ret)
+				break;
+			continue;
+		}
+
+		v->sv_ret = xfs_scrub_metadata(file, &sm);
+		v->sv_flags = sm.sm_flags;
+
+		if (i + 1 < head.svh_nr) {
+			error = xchk_scrubv_rest(head.svh_rest_us);
+			if (error)
+				goto out_free;
+		}
+	}
+
+	if (copy_to_user(uvectors, vectors, vec_bytes) ||
+	    copy_to_user(uhead, &head, sizeof(head)))
+		error = -EFAULT;
+
+out_free:
+	kfree(vectors);
+	return error;
+}
@@ -210,10 +210,9 @@ static inline int hv_cpu_number_to_vp_number(int cpu_number)
 
 static inline int __cpumask_to_vpset(struct hv_vpset *vpset,
 				    const struct cpumask *cpus,
-				    bool exclude_self)
+				    bool (*skip)(int cpu))
 {
 	int cpu, vcpu, vcpu_bank, vcpu_offset, nr_bank = 1;
-	int this_cpu = smp_processor_id();
 
 	/* valid_bank_mask can represent up to 64 banks */
 	if (hv_max_vp_index / 64 >= 64)
@@ -231,7 +230,7 @@ static inline int __cpumask_to_vpset(struct hv_vpset *vpset,
 	 * Some banks may end up being empty but this is acceptable.
 	 */
 	for_each_cpu(cpu, cpus) {
-		if (exclude_self && cpu == this_cpu)
+		if (skip && skip(cpu))
 			continue;
 		vcpu = hv_cpu_number_to_vp_number(cpu);
 		if (vcpu == VP_INVAL)
@@ -250,14 +249,27 @@ static inline int __cpumask_to_vpset(struct hv_vpset *vpset,
 static inline int cpumask_to_vpset(struct hv_vpset *vpset,
 				    const struct cpumask *cpus)
 {
-	return __cpumask_to_vpset(vpset, cpus, false);
+	return __cpumask_to_vpset(vpset, cpus, NULL);
+}
+
+static inline bool hv_cpu_is_self(int cpu)
+{
+	return cpu == smp_processor_id();
 }
 
 static inline int cpumask_to_vpset_noself(struct hv_vpset *vpset,
 				    const struct cpumask *cpus)
 {
 	WARN_ON_ONCE(preemptible());
-	return __cpumask_to_vpset(vpset, cpus, true);
+	return __cpumask_to_vpset(vpset, cpus, hv_cpu_is_self);
+}
+
+/* Like cpumask_to_vpset(), but leaves out the CPUs for which skip() is true */
+static inline int cpumask_to_vpset_skip(struct hv_vpset *vpset,
+				    const struct cpumask *cpus,
+				    bool (*skip)(int cpu))
+{
+	return __cpumask_to_vpset(vpset, cpus, skip);
 }
 
 void hyperv_report_panic(struct pt_regs *regs, long err, bool in_die);
@@ -118,6 +118,13 @@ struct aead_request {
  * @setkey: see struct skcipher_alg
  * @encrypt: see struct skcipher_alg
  * @decrypt: see struct skcipher_alg
+ * @encrypt_batch: Optional. Perform @encrypt on up to CRYPTO_BATCH_MAX
+ *		   independent requests of the same transformation object at
+ *		   once, storing the result of each request in the matching
+ *		   entry of the error array. Requests that go asynchronous are
+ *		   completed through their own callbacks.
+ * @decrypt_batch: Optional. Batched counterpart of @decrypt, see
+ *		   @encrypt_batch.
  * @ivsize: see struct skcipher_alg
  * @chunksize: see struct skcipher_alg
  * @init: Initialize the cryptographic transformation object. This function
@@ -133,7 +140,8 @@ struct aead_request {
  *	  @init.
  * @base: Definition of a generic crypto cipher algorithm.
  *
- * All fields except @ivsize is mandatory and must be filled.
+ * All fields except @ivsize, @encrypt_batch and @decrypt_batch are
+ * mandatory and must be filled.
  */
 struct aead_alg {
 	int (*setkey)(struct crypto_aead *tfm, const u8 *key,
@@ -141,6 +149,10 @@ struct aead_alg {
 	int (*setauthsize)(struct crypto_aead *tfm, unsigned int authsize);
 	int (*encrypt)(struct aead_request *req);
 	int (*decrypt)(struct aead_request *req);
+	void (*encrypt_batch)(struct aead_request **reqs, int *errs,
+			      unsigned int nreqs);
+	void (*decrypt_batch)(struct aead_request **reqs, int *errs,
+			      unsigned int nreqs);
 	int (*init)(struct crypto_aead *tfm);
 	void (*exit)(struct crypto_aead *tfm);
 
@@ -368,6 +380,42 @@ int crypto_aead_encrypt(struct aead_request *req);
  */
 int crypto_aead_decrypt(struct aead_request *req);
 
+/**
+ * crypto_aead_encrypt_batch() - encrypt many independent requests
+ * @reqs: array of aead_request handles, all allocated for the same
+ *	  transformation object
+ * @errs: array receiving the result of each request
+ * @nreqs: number of entries in @reqs and @errs
+ *
+ * Equivalent to calling crypto_aead_encrypt() on every request in turn and
+ * storing the return values in @errs, but lets algorithms that implement
+ * batching interleave several requests, e.g. one per packet. Algorithms
+ * without native support are driven through a serial loop.
+ *
+ * Return: 0 if every request completed successfully and synchronously,
+ *	   otherwise the first non-zero entry of @errs
+ */
+int crypto_aead_encrypt_batch(struct aead_request **reqs, int *errs,
+			      unsigned int nreqs);
+
+/**
+ * crypto_aead_decrypt_batch() - decrypt many independent requests
+ * @reqs: array of aead_request handles, all allocated for the same
+ *	  transformation object
+ * @errs: array receiving the result of each request
+ * @nreqs: number of entries in @reqs and @errs
+ *
+ * Batched counterpart of crypto_aead_decrypt(), see
+ * crypto_aead_encrypt_batch(). An authentication failure of one request
+ * is reported as -EBADMSG in its entry of @errs and does not affect the
+ * others.
+ *
+ * Return: 0 if every request completed successfully and synchronously,
+ *	   otherwise the first non-zero entry of @errs
+ */
+int crypto_aead_decrypt_batch(struct aead_request **reqs, int *errs,
+			      unsigned int nreqs);
+
 /**
  * DOC: Asynchronous AEAD Request Handle
  *
@@ -21,8 +21,30 @@
 #include <crypto/kpp.h>
 
 struct device;
+struct dentry;
 
 #define ENGINE_NAME_LEN	30
+
+/*
+ * struct crypto_engine_stats - crypto engine statistics
+ * @dispatched: requests handed to the driver
+ * @completed: requests finalized or failed after dispatch
+ * @requeued: requests the hardware rejected with -ENOSPC and that were
+ * put back at the head of the queue
+ * @max_inflight: highest number of requests in flight at once
+ * @inflight_ns: time integral of the number of requests in flight; divided
+ * by @completed it gives the mean dispatch-to-completion latency
+ * @last_ns: time of the last change of the in-flight count
+ */
+struct crypto_engine_stats {
+	u64			dispatched;
+	u64			completed;
+	u64			requeued;
+	unsigned int		max_inflight;
+	u64			inflight_ns;
+	u64			last_ns;
+};
+
 /*
  * struct crypto_engine - crypto hardware engine
  * @name: the engine name
@@ -44,6 +66,12 @@ struct device;
  * hardware by issuing this call
  * @do_batch_requests: execute a batch of requests. Depends on multiple
  * requests support.
+ * @qdepth: maximum number of requests the hardware can have in flight, as
+ * set by crypto_engine_set_qdepth(); 0 means one request at a time, or no
+ * limit with @retry_support
+ * @inflight: number of requests currently handed to the driver
+ * @stats: dispatch and latency statistics, protected by @queue_lock
+ * @debugfs: debugfs directory of the engine
  * @kworker: kthread worker struct for request pump
  * @pump_requests: work struct for scheduling work to the request pump
  * @priv_data: the engine private data
@@ -68,6 +96,10 @@ struct crypto_engine {
 	int (*unprepare_crypt_hardware)(struct crypto_engine *engine);
 	int (*do_batch_requests)(struct crypto_engine *engine);
 
+	unsigned int		qdepth;
+	unsigned int		inflight;
+	struct crypto_engine_stats stats;
+	struct dentry		*debugfs;
 
 	struct kthread_worker           *kworker;
 	struct kthread_work             pump_requests;
@@ -115,6 +147,7 @@ void crypto_finalize_kpp_request(struct crypto_engine *engine,
 				 struct kpp_request *req, int err);
 void crypto_finalize_skcipher_request(struct crypto_engine *engine,
 				      struct skcipher_request *req, int err);
+int crypto_engine_set_qdepth(struct crypto_engine *engine, unsigned int qdepth);
 int crypto_engine_start(struct crypto_engine *engine);
 int crypto_engine_stop(struct crypto_engine *engine);
 struct crypto_engine *crypto_engine_alloc_init(struct device *dev, bool rt);
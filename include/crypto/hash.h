@@ -118,6 +118,13 @@ struct ahash_request {
  *	    data so the transformation can continue from this point onward. No
  *	    data processing happens at this point. Driver must not use
  *	    req->result.
+ * @digest_batch: **[optional]** Perform @digest on up to CRYPTO_BATCH_MAX
+ *		  independent requests of the same transformation object at
+ *		  once, allowing SIMD implementations to interleave them. The
+ *		  result of each request is stored in the matching entry of
+ *		  the error array, with the same meaning as the return value
+ *		  of @digest. Every request must still be completed exactly
+ *		  once through its own callback when it goes asynchronous.
  * @init_tfm: Initialize the cryptographic transformation object.
  *	      This function is called only once at the instantiation
  *	      time, right after the transformation context was
@@ -141,6 +148,8 @@ struct ahash_alg {
 	int (*import)(struct ahash_request *req, const void *in);
 	int (*setkey)(struct crypto_ahash *tfm, const u8 *key,
 		      unsigned int keylen);
+	void (*digest_batch)(struct ahash_request **reqs, int *errs,
+			     unsigned int nreqs);
 	int (*init_tfm)(struct crypto_ahash *tfm);
 	void (*exit_tfm)(struct crypto_ahash *tfm);
 
@@ -231,6 +240,8 @@ struct crypto_ahash {
 	int (*import)(struct ahash_request *req, const void *in);
 	int (*setkey)(struct crypto_ahash *tfm, const u8 *key,
 		      unsigned int keylen);
+	void (*digest_batch)(struct ahash_request **reqs, int *errs,
+			     unsigned int nreqs);
 
 	unsigned int reqsize;
 	struct crypto_tfm base;
@@ -477,6 +488,25 @@ int crypto_ahash_final(struct ahash_request *req);
  */
 int crypto_ahash_digest(struct ahash_request *req);
 
+/**
+ * crypto_ahash_digest_batch() - calculate message digests for many requests
+ * @reqs: array of independent ahash_request handles, all allocated for the
+ *	  same transformation object
+ * @errs: array receiving the result of each request
+ * @nreqs: number of entries in @reqs and @errs
+ *
+ * Equivalent to calling crypto_ahash_digest() on every request in turn and
+ * storing the return values in @errs, but lets algorithms that implement
+ * batching process several messages in parallel. Algorithms without native
+ * support are driven through a serial loop. Requests that return
+ * -EINPROGRESS or -EBUSY complete through their own callbacks.
+ *
+ * Return: 0 if every request was successfully calculated synchronously,
+ *	   otherwise the first non-zero entry of @errs
+ */
+int crypto_ahash_digest_batch(struct ahash_request **reqs, int *errs,
+			      unsigned int nreqs);
+
 /**
  * crypto_ahash_export() - extract current message digest state
  * @req: reference to the ahash_request handle whose state is exported
@@ -29,6 +29,7 @@
 #include <linux/mmzone.h>
 #include <linux/llist.h>
 #include <linux/spinlock.h>
+#include <linux/workqueue.h>
 #include <drm/ttm/ttm_caching.h>
 
 struct device;
@@ -61,16 +62,22 @@ struct ttm_pool_type {
  * struct ttm_pool - Pool for all caching and orders
  *
  * @dev: the device we allocate pages for
+ * @nid: NUMA node to allocate pages from, NUMA_NO_NODE for any
  * @use_dma_alloc: if coherent DMA allocations should be used
  * @use_dma32: if GFP_DMA32 should be used
- * @caching: pools for each caching/order
+ * @refill_work: background refill of huge pages for the per node pool
+ * @caching: pools for each caching/order, used with coherent DMA
+ * allocations or when the pool is bound to a NUMA node
  */
 struct ttm_pool {
 	struct device *dev;
+	int nid;
 
 	bool use_dma_alloc;
 	bool use_dma32;
 
+	struct work_struct refill_work;
+
 	struct {
 		struct ttm_pool_type orders[MAX_ORDER];
 	} caching[TTM_NUM_CACHING_TYPES];
@@ -342,6 +342,8 @@ struct bpf_verifier_state_list {
 	struct bpf_verifier_state state;
 	struct bpf_verifier_state_list *next;
 	int miss_cnt, hit_cnt;
+	/* hash of the state parts that have to match exactly */
+	u32 shape;
 };
 
 /* Possible states for alu_state member. */
@@ -497,6 +499,11 @@ struct bpf_verifier_env {
 	u32 peak_states;
 	/* longest register parentage chain walked for liveness marking */
 	u32 longest_mark_read_walk;
+	/* number of explored states looked at in is_state_visited() and how
+	 * many of them were skipped because their shape hash differed
+	 */
+	u32 states_checked;
+	u32 states_shape_miss;
 	bpfptr_t fd_array;
 
 	/* bit mask to keep track of whether a register has been accessed
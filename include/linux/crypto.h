@@ -156,6 +156,12 @@
  */
 #define CRYPTO_MAX_ALG_NAME		128
 
+/*
+ * Maximum number of requests handed to an algorithm's batch operation in a
+ * single call. Larger batches are split by the API.
+ */
+#define CRYPTO_BATCH_MAX		16
+
 /*
  * The macro CRYPTO_MINALIGN_ATTR (along with the void * type in the actual
  * declaration) is used to ensure that the crypto_tfm context structure is
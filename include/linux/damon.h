@@ -88,6 +88,12 @@ struct damon_target {
  * @DAMOS_NOHUGEPAGE:	Call ``madvise()`` for the region with MADV_NOHUGEPAGE.
  * @DAMOS_LRU_PRIO:	Prioritize the region on its LRU lists.
  * @DAMOS_LRU_DEPRIO:	Deprioritize the region on its LRU lists.
+ * @DAMOS_COLLAPSE:	Ask for the PMD-aligned parts of the region to be backed
+ *			with huge pages.
+ * @DAMOS_MIGRATE_HOT:	Migrate the region's pages to &damos->target_nid,
+ *			prioritizing hotter regions.
+ * @DAMOS_MIGRATE_COLD:	Migrate the region's pages to &damos->target_nid,
+ *			prioritizing colder regions.
  * @DAMOS_STAT:		Do nothing but count the stat.
  * @NR_DAMOS_ACTIONS:	Total number of DAMOS actions
  */
@@ -99,6 +105,9 @@ enum damos_action {
 	DAMOS_NOHUGEPAGE,
 	DAMOS_LRU_PRIO,
 	DAMOS_LRU_DEPRIO,
+	DAMOS_COLLAPSE,
+	DAMOS_MIGRATE_HOT,
+	DAMOS_MIGRATE_COLD,
 	DAMOS_STAT,		/* Do nothing but only record the stat */
 	NR_DAMOS_ACTIONS,
 };
@@ -226,6 +235,7 @@ struct damos_stat {
  * @action:		&damo_action to be applied to the target regions.
  * @quota:		Control the aggressiveness of this scheme.
  * @wmarks:		Watermarks for automated (in)activation of this scheme.
+ * @target_nid:		Destination node of the migration actions.
  * @stat:		Statistics of this scheme.
  * @list:		List head for siblings.
  *
@@ -257,6 +267,7 @@ struct damos {
 	enum damos_action action;
 	struct damos_quota quota;
 	struct damos_watermarks wmarks;
+	int target_nid;
 	struct damos_stat stat;
 	struct list_head list;
 };
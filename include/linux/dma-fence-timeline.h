@@ -0,0 +1,81 @@
+/* SPDX-License-Identifier: GPL-2.0-only */
+/*
+ * fence-timeline: compact timeline of fences signaled by seqno
+ */
+
+#ifndef __LINUX_DMA_FENCE_TIMELINE_H
+#define __LINUX_DMA_FENCE_TIMELINE_H
+
+#include <linux/dma-fence.h>
+#include <linux/kref.h>
+#include <linux/list.h>
+#include <linux/spinlock.h>
+
+/**
+ * struct dma_fence_timeline - a timeline signaled by a single seqno
+ * @refcount: reference count, one per point plus the creator's
+ * @lock: fence lock shared by all points, protects @pending
+ * @context: fence context of all points on the timeline
+ * @value: last signaled seqno, every point up to it is signaled
+ * @pending: points with signaling enabled, sorted by seqno
+ * @name: timeline name reported through dma_fence_ops
+ *
+ * Unlike a dma_fence_chain of individual fences, checking whether a point
+ * of the timeline is signaled is a comparison against @value. Signaling
+ * only has to visit the points somebody is actually waiting on, so points
+ * that are merely created and queried cost nothing on signal.
+ */
+struct dma_fence_timeline {
+	struct kref refcount;
+	spinlock_t lock;
+	u64 context;
+	u64 value;
+	struct list_head pending;
+	char name[32];
+};
+
+/**
+ * struct dma_fence_timeline_point - a point on a dma_fence_timeline
+ * @base: fence base class
+ * @timeline: the timeline the point belongs to
+ * @link: entry in the pending list of @timeline
+ */
+struct dma_fence_timeline_point {
+	struct dma_fence base;
+	struct dma_fence_timeline *timeline;
+	struct list_head link;
+};
+
+extern const struct dma_fence_ops dma_fence_timeline_point_ops;
+
+/**
+ * to_dma_fence_timeline_point - cast a fence to a dma_fence_timeline_point
+ * @fence: fence to cast
+ *
+ * Returns NULL if the fence is not a timeline point, or the point otherwise.
+ */
+static inline struct dma_fence_timeline_point *
+to_dma_fence_timeline_point(struct dma_fence *fence)
+{
+	if (!fence || fence->ops != &dma_fence_timeline_point_ops)
+		return NULL;
+
+	return container_of(fence, struct dma_fence_timeline_point, base);
+}
+
+/**
+ * dma_fence_timeline_value - return the last signaled seqno of a timeline
+ * @tl: the timeline
+ */
+static inline u64 dma_fence_timeline_value(struct dma_fence_timeline *tl)
+{
+	return READ_ONCE(tl->value);
+}
+
+struct dma_fence_timeline *dma_fence_timeline_create(const char *name);
+void dma_fence_timeline_put(struct dma_fence_timeline *tl);
+struct dma_fence *dma_fence_timeline_point(struct dma_fence_timeline *tl,
+					   u64 seqno);
+void dma_fence_timeline_signal(struct dma_fence_timeline *tl, u64 seqno);
+
+#endif /* __LINUX_DMA_FENCE_TIMELINE_H */
@@ -166,6 +166,25 @@ struct dma_resv {
 	 * reserved by calling dma_resv_reserve_fences().
 	 */
 	struct dma_resv_list __rcu *fences;
+
+	/**
+	 * @gen:
+	 *
+	 * Generation of the fence list. Incremented to an odd value before and
+	 * to an even value after every change that can add an unsignaled
+	 * fence, always under @lock.
+	 */
+	atomic64_t gen;
+
+	/**
+	 * @signaled:
+	 *
+	 * Cached result of dma_resv_test_signaled(): an even @gen shifted left
+	 * by two, ORed with the highest &enum dma_resv_usage for which all
+	 * fences were found signaled in that generation. Fences never become
+	 * unsignaled again, so the summary holds until @gen changes.
+	 */
+	atomic64_t signaled;
 };
 
 /**
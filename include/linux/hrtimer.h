@@ -195,6 +195,9 @@ enum  hrtimer_base_type {
  * @nr_retries:		Total number of hrtimer interrupt retries
  * @nr_hangs:		Total number of hrtimer interrupt hangs
  * @max_hang_time:	Maximum time spent in hrtimer_interrupt
+ * @nr_coalesced:	Total number of timers expired ahead of their hard
+ *			expiry by another timer's event, i.e. an upper bound
+ *			of the events that slack saved
  * @softirq_expiry_lock: Lock which is taken while softirq based hrtimer are
  *			 expired
  * @timer_waiters:	A hrtimer_cancel() invocation waits for the timer
@@ -225,6 +228,7 @@ struct hrtimer_cpu_base {
 	unsigned short			nr_retries;
 	unsigned short			nr_hangs;
 	unsigned int			max_hang_time;
+	unsigned long			nr_coalesced;
 #endif
 #ifdef CONFIG_PREEMPT_RT
 	spinlock_t			softirq_expiry_lock;
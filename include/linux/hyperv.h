@@ -24,6 +24,7 @@
 #include <linux/mod_devicetable.h>
 #include <linux/interrupt.h>
 #include <linux/reciprocal_div.h>
+#include <linux/uio.h>
 #include <asm/hyperv-tlfs.h>
 
 #define MAX_PAGE_BUFFER_COUNT				32
@@ -712,6 +713,18 @@ enum vmbus_channel_state {
 	CHANNEL_OPENED_STATE,
 };
 
+/*
+ * Cumulative channel counters. They are kept per CPU, so the hot paths
+ * can update them without atomics or cache line bouncing; the sysfs
+ * attributes report the sum over all CPUs.
+ */
+struct vmbus_channel_stats {
+	u64 interrupts;		/* Host to Guest interrupts */
+	u64 callbacks;		/* Runs of onchannel_callback */
+	u64 packets_read;	/* Packets consumed from the inbound ring */
+	u64 sig_events;		/* Guest to Host events */
+};
+
 /*
  * Represents each channel msg on the vmbus connection This is a
  * variable-size data structure depending on the msg type itself
@@ -845,8 +858,7 @@ struct vmbus_channel {
 	struct vmbus_close_msg close_msg;
 
 	/* Statistics */
-	u64	interrupts;	/* Host to Guest interrupts */
-	u64	sig_events;	/* Guest to Host events */
+	struct vmbus_channel_stats __percpu *stats;
 
 	/*
 	 * Guest to host interrupts caused by the outbound ring buffer changing
@@ -869,6 +881,14 @@ struct vmbus_channel {
 	void (*change_target_cpu_callback)(struct vmbus_channel *channel,
 			u32 old, u32 new);
 
+	/*
+	 * Set by drivers that can tear down and reopen the channel with a
+	 * ring of a different size; invoked from the "ring_size" channel
+	 * attribute.  The size is in bytes and covers each direction.
+	 */
+	int (*resize_ring_callback)(struct vmbus_channel *channel,
+				    u32 ring_size);
+
 	/*
 	 * Synchronize channel scheduling and channel removal; see the inline
 	 * comments in vmbus_chan_sched() and vmbus_reset_channel_cb().
@@ -1033,6 +1053,20 @@ struct vmbus_channel {
 	u32 fuzz_testing_interrupt_delay;
 	u32 fuzz_testing_message_delay;
 
+	/*
+	 * Adaptive polling of HV_CALL_BATCHED channels. When the channel is
+	 * busy, vmbus_on_event() keeps the host interrupts masked and polls
+	 * the inbound ring for up to poll_usecs after the callback emptied
+	 * it. The channel goes back to interrupt mode when a poll times out.
+	 * Polling is disabled when poll_usecs is 0 (default).
+	 */
+	u32 poll_usecs;
+	bool poll_active;
+	/* Polls, which found new packets */
+	u64 poll_hits;
+	/* Polls, which timed out and re-enabled the host interrupts */
+	u64 poll_misses;
+
 	/* callback to generate a request ID from a request address */
 	u64 (*next_request_id_callback)(struct vmbus_channel *channel, u64 rqst_addr);
 	/* callback to retrieve a request address from a request ID */
@@ -1089,6 +1123,14 @@ static inline void set_channel_read_mode(struct vmbus_channel *c,
 	c->callback_mode = mode;
 }
 
+/* Maximum adaptive polling interval of a channel in microseconds */
+#define HV_MAX_POLL_USECS	1000
+
+static inline void set_channel_poll_usecs(struct vmbus_channel *c, u32 usecs)
+{
+	WRITE_ONCE(c->poll_usecs, min_t(u32, usecs, HV_MAX_POLL_USECS));
+}
+
 static inline void set_per_channel_state(struct vmbus_channel *c, void *s)
 {
 	c->per_channel_state = s;
@@ -1203,6 +1245,32 @@ extern int vmbus_sendpacket(struct vmbus_channel *channel,
 				  enum vmbus_packet_type type,
 				  u32 flags);
 
+/*
+ * A packet of a batch, sent by vmbus_sendpacket_batch(). The caller fills in
+ * the buffer, the request ID, the type and the flags. The remaining fields
+ * are used by the VMBus driver.
+ */
+struct vmbus_batch_packet {
+	void *buffer;
+	u32 bufferlen;
+	u64 requestid;
+	enum vmbus_packet_type type;
+	u32 flags;
+
+	/* Transaction ID of the packet in the ring, set when it is sent */
+	u64 trans_id;
+
+	/* Private to the VMBus driver */
+	u64 rqst_id;
+	struct vmpacket_descriptor desc;
+	struct kvec kv[3];
+	u32 kv_count;
+};
+
+extern int vmbus_sendpacket_batch(struct vmbus_channel *channel,
+				  struct vmbus_batch_packet *pkts,
+				  u32 count);
+
 extern int vmbus_sendpacket_pagebuffer(struct vmbus_channel *channel,
 					    struct hv_page_buffer pagebuffers[],
 					    u32 pagecount,
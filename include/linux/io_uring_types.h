@@ -152,6 +152,14 @@ struct io_submit_state {
 	struct blk_plug		plug;
 };
 
+/* per-opcode counters, see IORING_REGISTER_OP_STATS */
+struct io_op_stats {
+	atomic_long_t		issued_inline;
+	atomic_long_t		punted_iowq;
+	atomic_long_t		poll_armed;
+	atomic_long_t		eagain;
+};
+
 struct io_ev_fd {
 	struct eventfd_ctx	*cq_ev_fd;
 	unsigned int		eventfd_async: 1;
@@ -277,6 +285,9 @@ struct io_ring_ctx {
 
 	struct io_restriction		restrictions;
 	struct task_struct		*submitter_task;
+	/* MSG_RING CQEs queued by other rings, flushed by submitter_task */
+	struct llist_head		msg_llist;
+	struct callback_head		msg_work;
 
 	/* slow path rsrc auxilary data, used by update/register */
 	struct io_rsrc_node		*rsrc_backup_node;
@@ -314,8 +325,15 @@ struct io_ring_ctx {
 
 	struct list_head		defer_list;
 	unsigned			sq_thread_idle;
+	/* SQPOLL batches per pass, and IORING_SQPOLL_ADAPTIVE_IDLE opt-in */
+	unsigned			sq_weight;
+	bool				sq_adaptive_idle;
 	/* protected by ->completion_lock */
 	unsigned			evfd_last_cq_tail;
+	/* pending futex waits, protected by ->uring_lock */
+	struct hlist_head		futex_list;
+	/* IORING_OP_LAST entries, only allocated once stats are enabled */
+	struct io_op_stats		*op_stats;
 };
 
 enum {
@@ -371,6 +371,10 @@ struct kvm_vcpu {
 	struct kvm_vcpu_stat stat;
 	char stats_id[KVM_STATS_NAME_SIZE];
 	struct kvm_dirty_ring dirty_ring;
+#ifdef CONFIG_KVM_MMIO
+	/* Private coalesced MMIO/PIO ring, see KVM_CAP_COALESCED_MMIO_PERCPU */
+	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
+#endif
 
 	/*
 	 * The most recently used memslot by this vCPU and the slots generation
@@ -719,7 +723,7 @@ struct kvm {
 
 	/* For management / invalidation of gfn_to_pfn_caches */
 	spinlock_t gpc_lock;
-	struct list_head gpc_list;
+	struct rb_root_cached gpc_tree;
 
 	/*
 	 * created_vcpus is protected by kvm->lock, and is incremented
@@ -750,6 +754,9 @@ struct kvm {
 	struct kvm_coalesced_mmio_ring *coalesced_mmio_ring;
 	spinlock_t ring_lock;
 	struct list_head coalesced_zones;
+	bool coalesced_mmio_percpu;
+	u32 coalesced_mmio_watermark;
+	struct eventfd_ctx *coalesced_mmio_eventfd;
 #endif
 
 	struct mutex irq_lock;
@@ -19,6 +19,7 @@ struct kvm_memslots;
 enum kvm_mr_change;
 
 #include <linux/bits.h>
+#include <linux/interval_tree.h>
 #include <linux/mutex.h>
 #include <linux/types.h>
 #include <linux/spinlock_types.h>
@@ -68,7 +69,8 @@ struct gfn_to_pfn_cache {
 	unsigned long uhva;
 	struct kvm_memory_slot *memslot;
 	struct kvm_vcpu *vcpu;
-	struct list_head list;
+	/* Keyed by uhva in kvm->gpc_tree while uhva is valid */
+	struct interval_tree_node hva_node;
 	rwlock_t lock;
 	struct mutex refresh_lock;
 	void *khva;
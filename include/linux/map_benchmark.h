@@ -15,6 +15,10 @@
 #define DMA_MAP_TO_DEVICE       1
 #define DMA_MAP_FROM_DEVICE     2
 
+#define DMA_MAP_SINGLE_MODE     0 /* dma_map_single() of one buffer */
+#define DMA_MAP_SG_MODE         1 /* dma_map_sgtable() of a scatterlist */
+#define DMA_MAP_MODE_MAX        DMA_MAP_SG_MODE
+
 struct map_benchmark {
 	__u64 avg_map_100ns; /* average map latency in 100ns */
 	__u64 map_stddev; /* standard deviation of map latency */
@@ -27,5 +31,14 @@ struct map_benchmark {
 	__u32 dma_dir; /* DMA data direction */
 	__u32 dma_trans_ns; /* time for DMA transmission in ns */
 	__u32 granule;  /* how many PAGE_SIZE will do map/unmap once a time */
+	__u32 map_mode; /* DMA_MAP_SINGLE_MODE or DMA_MAP_SG_MODE */
+	__u32 nents; /* sg mode: entries the granule is split into, 0 = granule */
+	__u32 reserved; /* must be zero */
+	__u64 map_p50_100ns; /* map latency percentiles in 100ns */
+	__u64 map_p90_100ns;
+	__u64 map_p99_100ns;
+	__u64 unmap_p50_100ns; /* as above */
+	__u64 unmap_p90_100ns;
+	__u64 unmap_p99_100ns;
 };
 #endif /* _KERNEL_DMA_BENCHMARK_H */
@@ -324,6 +324,8 @@ void *mtree_erase(struct maple_tree *mt, unsigned long index);
 
 void mtree_destroy(struct maple_tree *mt);
 void __mt_destroy(struct maple_tree *mt);
+int mtree_dup(struct maple_tree *mt, struct maple_tree *new, gfp_t gfp);
+int __mt_dup(struct maple_tree *mt, struct maple_tree *new, gfp_t gfp);
 
 /**
  * mtree_empty() - Determine if a tree has any present entries.
@@ -637,6 +637,10 @@ struct mm_struct {
 		atomic_t tlb_flush_batched;
 #endif
 		struct uprobes_state uprobes_state;
+#ifdef CONFIG_FUTEX
+		/* Private futex hash, see PR_FUTEX_HASH */
+		struct futex_private_hash *futex_phash;
+#endif
 #ifdef CONFIG_PREEMPT_RT
 		struct rcu_head delayed_drop;
 #endif
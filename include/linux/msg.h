@@ -3,11 +3,15 @@
 #define _LINUX_MSG_H
 
 #include <linux/list.h>
+#include <linux/llist.h>
 #include <uapi/linux/msg.h>
 
 /* one msg_msg structure for each message */
 struct msg_msg {
-	struct list_head m_list;
+	union {
+		struct list_head m_list;
+		struct llist_node m_cache;	/* spare mqueue buffer */
+	};
 	long m_type;
 	size_t m_ts;		/* message text size */
 	struct msg_msgseg *next;
@@ -118,6 +118,20 @@ enum netfs_io_source {
 typedef void (*netfs_io_terminated_t)(void *priv, ssize_t transferred_or_error,
 				      bool was_async);
 
+/*
+ * Per-mount read statistics, shown with netfs_mount_stats_show().  The netfs
+ * embeds this in its superblock info and points netfs_inode::stats at it.
+ */
+struct netfs_mount_stats {
+	atomic_long_t		rreqs;		/* Read requests */
+	atomic_long_t		sreqs;		/* Subrequests */
+	atomic_long_t		download_bytes;	/* Bytes read from the server */
+	atomic_long_t		cache_bytes;	/* Bytes read from the cache */
+	atomic_long_t		short_reads;	/* Short reads resubmitted */
+	atomic_long_t		throttled;	/* Reads delayed by max_reads_in_flight */
+	atomic_long_t		ra_coalesced;	/* Bytes added to readahead windows */
+};
+
 /*
  * Per-inode context.  This wraps the VFS inode.
  */
@@ -128,6 +142,10 @@ struct netfs_inode {
 	struct fscache_cookie	*cache;
 #endif
 	loff_t			remote_i_size;	/* Size of the remote file */
+	struct netfs_mount_stats *stats;	/* Per-mount stats (or NULL) */
+	atomic_t		reads_in_flight; /* Server reads outstanding */
+	unsigned int		max_reads_in_flight; /* Limit on the above (0 = default) */
+	unsigned int		ra_min_size;	/* Coalesce readahead up to this (0 = default) */
 };
 
 /*
@@ -288,6 +306,14 @@ void netfs_get_subrequest(struct netfs_io_subrequest *subreq,
 void netfs_put_subrequest(struct netfs_io_subrequest *subreq,
 			  bool was_async, enum netfs_sreq_ref_trace what);
 void netfs_stats_show(struct seq_file *);
+#ifdef CONFIG_NETFS_STATS
+void netfs_mount_stats_show(struct seq_file *, struct netfs_mount_stats *);
+#else
+static inline void netfs_mount_stats_show(struct seq_file *m,
+					  struct netfs_mount_stats *stats)
+{
+}
+#endif
 
 /**
  * netfs_inode - Get the netfs inode context from the inode
@@ -317,6 +343,10 @@ static inline void netfs_inode_init(struct netfs_inode *ctx,
 #if IS_ENABLED(CONFIG_FSCACHE)
 	ctx->cache = NULL;
 #endif
+	ctx->stats = NULL;
+	atomic_set(&ctx->reads_in_flight, 0);
+	ctx->max_reads_in_flight = 0;
+	ctx->ra_min_size = 0;
 }
 
 /**
@@ -0,0 +1,48 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef _LINUX_RBIAS_RWSEM_H
+#define _LINUX_RBIAS_RWSEM_H
+
+#include <linux/rwsem.h>
+#include <linux/types.h>
+
+/*
+ * Reader biased rw_semaphore (BRAVO).
+ *
+ * While the bias is on, readers do not touch the rwsem at all but publish
+ * themselves in a slot of a global, hashed table of visible readers, so
+ * read-mostly locks stop bouncing the count cache line between CPUs. A
+ * writer takes the underlying rwsem, revokes the bias and waits for the
+ * visible readers to drain; the bias is then inhibited for a multiple of
+ * that revocation time before a reader may turn it back on.
+ *
+ * Sits between rw_semaphore and percpu_rw_semaphore: readers scale almost
+ * like the latter while a writer costs a scan of the table instead of an
+ * RCU grace period. Read locks must be released by the task that took
+ * them (no *_non_owner()).
+ */
+struct rbias_rw_semaphore {
+	struct rw_semaphore	rwsem;
+	bool			rbias;
+	u64			inhibit_until;
+};
+
+#define __RBIAS_RWSEM_INITIALIZER(name)					\
+	{ .rwsem = __RWSEM_INITIALIZER(name.rwsem) }
+
+#define DECLARE_RBIAS_RWSEM(name)					\
+	struct rbias_rw_semaphore name = __RBIAS_RWSEM_INITIALIZER(name)
+
+#define init_rbias_rwsem(sem)						\
+do {									\
+	init_rwsem(&(sem)->rwsem);					\
+	(sem)->rbias = false;						\
+	(sem)->inhibit_until = 0;					\
+} while (0)
+
+extern void rbias_down_read(struct rbias_rw_semaphore *sem);
+extern int rbias_down_read_trylock(struct rbias_rw_semaphore *sem);
+extern void rbias_up_read(struct rbias_rw_semaphore *sem);
+extern void rbias_down_write(struct rbias_rw_semaphore *sem);
+extern void rbias_up_write(struct rbias_rw_semaphore *sem);
+
+#endif /* _LINUX_RBIAS_RWSEM_H */
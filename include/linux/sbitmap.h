@@ -65,6 +65,12 @@ struct sbitmap {
 	 */
 	bool round_robin;
 
+	/**
+	 * @numa: Split the words into one range per NUMA node, and start
+	 * searching in the range of the local node.
+	 */
+	bool numa;
+
 	/**
 	 * @map: Allocated bitmap.
 	 */
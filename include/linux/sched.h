@@ -524,6 +524,7 @@ struct sched_statistics {
 	u64				nr_wakeups_remote;
 	u64				nr_wakeups_affine;
 	u64				nr_wakeups_affine_attempts;
+	u64				nr_wakeups_pair_affine;
 	u64				nr_wakeups_passive;
 	u64				nr_wakeups_idle;
 
@@ -723,6 +724,16 @@ struct kmap_ctrl {
 #endif
 };
 
+/* Pending sampled contention, see kernel/locking/lock_contention.c */
+struct lock_contention_frame {
+	void				*lock;
+	unsigned long			callsite;
+	u64				start;
+	pid_t				holder;
+	unsigned int			flags;
+	unsigned int			gen;
+};
+
 struct task_struct {
 #ifdef CONFIG_THREAD_INFO_IN_TASK
 	/*
@@ -754,6 +765,8 @@ struct task_struct {
 	int				on_cpu;
 	struct __call_single_node	wake_entry;
 	unsigned int			wakee_flips;
+	/* consecutive wakeups of last_wakee, decayed with wakee_flips */
+	unsigned int			wakee_repeats;
 	unsigned long			wakee_flip_decay_ts;
 	struct task_struct		*last_wakee;
 
@@ -773,6 +786,7 @@ struct task_struct {
 	int				static_prio;
 	int				normal_prio;
 	unsigned int			rt_priority;
+	int				latency_nice;
 
 	struct sched_entity		se;
 	struct sched_rt_entity		rt;
@@ -1157,6 +1171,10 @@ struct task_struct {
 	struct held_lock		held_locks[MAX_LOCK_DEPTH];
 #endif
 
+#ifdef CONFIG_LOCK_CONTENTION_SAMPLER
+	struct lock_contention_frame	lock_contention;
+#endif
+
 #if defined(CONFIG_UBSAN) && !defined(CONFIG_UBSAN_TRAP)
 	unsigned int			in_ubsan;
 #endif
@@ -2,6 +2,7 @@
 #ifndef _LINUX_SORT_H
 #define _LINUX_SORT_H
 
+#include <linux/gfp.h>
 #include <linux/types.h>
 
 void sort_r(void *base, size_t num, size_t size,
@@ -13,4 +14,10 @@ void sort(void *base, size_t num, size_t size,
 	  cmp_func_t cmp_func,
 	  swap_func_t swap_func);
 
+int sort_radix(void *base, size_t num, size_t size, size_t key_offset,
+	       size_t key_size, gfp_t gfp);
+
+void sort_parallel(void *base, size_t num, size_t size, cmp_func_t cmp_func,
+		   gfp_t gfp);
+
 #endif
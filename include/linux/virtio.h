@@ -82,6 +82,9 @@ void *virtqueue_detach_unused_buf(struct virtqueue *vq);
 
 unsigned int virtqueue_get_vring_size(struct virtqueue *vq);
 
+int virtqueue_set_dma_premapped(struct virtqueue *vq);
+struct device *virtqueue_dma_dev(struct virtqueue *vq);
+
 bool virtqueue_is_broken(struct virtqueue *vq);
 
 const struct vring *virtqueue_get_vring(struct virtqueue *vq);
@@ -124,6 +124,18 @@ struct rcu_work {
 	struct workqueue_struct *wq;
 };
 
+/*
+ * Affinity scopes of unbound workqueues.  CPUs are grouped into pods
+ * according to the scope and work items queued from a CPU are executed by
+ * workers confined to the CPU's pod.
+ */
+enum wq_affn_scope {
+	WQ_AFFN_NUMA,			/* one pod per NUMA node */
+	WQ_AFFN_CACHE,			/* one pod per last level cache */
+
+	WQ_AFFN_NR_TYPES,
+};
+
 /**
  * struct workqueue_attrs - A struct for workqueue attributes.
  *
@@ -148,6 +160,15 @@ struct workqueue_attrs {
 	 * doesn't participate in pool hash calculations or equality comparisons.
 	 */
 	bool no_numa;
+
+	/**
+	 * @affn_scope: affinity scope used to group CPUs into pods
+	 *
+	 * Like ``no_numa``, this only affects how pools are selected and isn't
+	 * part of the pool hash or equality comparisons.  ``no_numa`` set
+	 * disables pod affinity regardless of the scope.
+	 */
+	enum wq_affn_scope affn_scope;
 };
 
 static inline struct delayed_work *to_delayed_work(struct work_struct *work)
@@ -710,5 +731,6 @@ int workqueue_offline_cpu(unsigned int cpu);
 
 void __init workqueue_init_early(void);
 void __init workqueue_init(void);
+void __init workqueue_init_topology(void);
 
 #endif
@@ -352,6 +352,12 @@ void *xa_store(struct xarray *, unsigned long index, void *entry, gfp_t);
 void *xa_erase(struct xarray *, unsigned long index);
 void *xa_store_range(struct xarray *, unsigned long first, unsigned long last,
 			void *entry, gfp_t);
+int xa_store_bulk(struct xarray *, unsigned long first, void **entries,
+			unsigned int n, gfp_t);
+int xa_store_many(struct xarray *, const unsigned long *indices,
+			void **entries, unsigned int n, gfp_t);
+unsigned int xa_load_bulk(struct xarray *, const unsigned long *indices,
+			void **entries, unsigned int n);
 bool xa_get_mark(struct xarray *, unsigned long index, xa_mark_t);
 void xa_set_mark(struct xarray *, unsigned long index, xa_mark_t);
 void xa_clear_mark(struct xarray *, unsigned long index, xa_mark_t);
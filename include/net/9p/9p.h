@@ -70,6 +70,8 @@ void _p9_debug(enum p9_debug_flags level, const char *func,
  * @P9_RLCREATE: response with file access information for 9P2000.L
  * @P9_TRENAME: rename request
  * @P9_RRENAME: rename response
+ * @P9_TREADDIRPLUS: read directory entries along with their attributes
+ * @P9_RREADDIRPLUS: response with directory entries and attributes
  * @P9_TMKDIR: create a directory request
  * @P9_RMKDIR: create a directory response
  * @P9_TVERSION: version handshake request
@@ -137,6 +139,8 @@ enum p9_msg_t {
 	P9_RXATTRCREATE,
 	P9_TREADDIR = 40,
 	P9_RREADDIR,
+	P9_TREADDIRPLUS = 42,
+	P9_RREADDIRPLUS,
 	P9_TFSYNC = 50,
 	P9_RFSYNC,
 	P9_TLOCK = 52,
@@ -11,10 +11,14 @@
 
 #include <linux/utsname.h>
 #include <linux/idr.h>
+#include <linux/sbitmap.h>
 
 /* Number of requests per row */
 #define P9_ROW_MAXTAG 255
 
+/* Maximum number of requests in flight per client */
+#define P9_MAX_TAGS 1024
+
 /** enum p9_proto_versions - 9P protocol versions
  * @p9_proto_legacy: 9P Legacy mode, pre-9P2000.u
  * @p9_proto_2000u: 9P2000.u extension
@@ -64,6 +68,15 @@ enum p9_req_status_t {
 	REQ_STATUS_ERROR,
 };
 
+struct p9_req_t;
+
+/*
+ * Completion callback of an asynchronous request.  Called by p9_client_cb()
+ * from the transport's receive path, possibly in interrupt context, so it
+ * must not sleep.
+ */
+typedef void (*p9_req_done_t)(struct p9_req_t *req, void *priv);
+
 /**
  * struct p9_req_t - request slots
  * @status: status of this request slot
@@ -72,6 +85,8 @@ enum p9_req_status_t {
  * @tc: the request fcall structure
  * @rc: the response fcall structure
  * @req_list: link for higher level objects to chain requests
+ * @done: completion callback for asynchronous requests, or %NULL
+ * @done_priv: argument passed to @done
  */
 struct p9_req_t {
 	int status;
@@ -81,18 +96,24 @@ struct p9_req_t {
 	struct p9_fcall tc;
 	struct p9_fcall rc;
 	struct list_head req_list;
+	p9_req_done_t done;
+	void *done_priv;
 };
 
 /**
  * struct p9_client - per client instance state
- * @lock: protect @fids and @reqs
+ * @lock: protect @fids
  * @msize: maximum data size negotiated by protocol
  * @proto_version: 9P protocol version to use
  * @trans_mod: module API instantiated with this client
  * @status: connection state
  * @trans: tranport instance state and API
  * @fids: All active FID handles
- * @reqs: All active requests.
+ * @tags: request tag allocator, with per-CPU allocation hints
+ * @tag_wait_index: spreads tag waiters over the @tags wait queues
+ * @reqs: All active requests, indexed by tag.
+ * @version_req: the active Tversion request, which always uses P9_NOTAG
+ * @no_readdirplus: the server has rejected Treaddirplus
  * @name: node name used as client id
  *
  * The client structure is used to keep track of various per-client
@@ -120,7 +141,11 @@ struct p9_client {
 	} trans_opts;
 
 	struct idr fids;
-	struct idr reqs;
+	struct sbitmap_queue tags;
+	atomic_t tag_wait_index;
+	struct p9_req_t __rcu **reqs;
+	struct p9_req_t __rcu *version_req;
+	bool no_readdirplus;
 
 	char name[__NEW_UTS_LEN + 1];
 };
@@ -205,10 +230,18 @@ int p9_client_unlinkat(struct p9_fid *dfid, const char *name, int flags);
 int p9_client_read(struct p9_fid *fid, u64 offset, struct iov_iter *to, int *err);
 int p9_client_read_once(struct p9_fid *fid, u64 offset, struct iov_iter *to,
 		int *err);
+int p9_client_read_async(struct p9_fid *fid, u64 offset, int count,
+		p9_req_done_t done, void *priv);
+int p9_client_read_async_end(struct p9_fid *fid, struct p9_req_t *req,
+		struct iov_iter *to, int *err);
 int p9_client_write(struct p9_fid *fid, u64 offset, struct iov_iter *from, int *err);
 int p9_client_readdir(struct p9_fid *fid, char *data, u32 count, u64 offset);
+int p9_client_readdirplus(struct p9_fid *fid, char *data, u32 count,
+			  u64 offset, u64 request_mask);
 int p9dirent_read(struct p9_client *clnt, char *buf, int len,
 		  struct p9_dirent *dirent);
+int p9dirent_read_plus(struct p9_client *clnt, char *buf, int len,
+		       struct p9_dirent *dirent, struct p9_stat_dotl *st);
 struct p9_wstat *p9_client_stat(struct p9_fid *fid);
 int p9_client_wstat(struct p9_fid *fid, struct p9_wstat *wst);
 int p9_client_setattr(struct p9_fid *fid, struct p9_iattr_dotl *attr);
@@ -0,0 +1,54 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/*
+ * Multipath TCP packet scheduler interface
+ */
+#ifndef __NET_MPTCP_SCHED_H
+#define __NET_MPTCP_SCHED_H
+
+#include <linux/list.h>
+#include <linux/types.h>
+
+#define MPTCP_SCHED_NAME_MAX	16
+#define MPTCP_SUBFLOWS_MAX	8
+
+struct module;
+struct mptcp_sock;
+struct mptcp_subflow_context;
+
+/* Per subflow transmit state, sampled right before ->get_subflow() */
+struct mptcp_sched_subflow {
+	struct mptcp_subflow_context *subflow;
+	u64	pacing_rate;	/* bytes per second */
+	u32	srtt_us;	/* smoothed RTT in usecs */
+	u32	snd_cwnd;
+	u32	packets_out;
+	u32	wmem_queued;	/* bytes queued on the subflow */
+	u8	backup:1;
+};
+
+struct mptcp_sched_data {
+	bool	reinject;	/* choosing a subflow for retransmission */
+	u8	subflows;	/* number of valid entries in contexts[] */
+	struct mptcp_sched_subflow contexts[MPTCP_SUBFLOWS_MAX];
+};
+
+struct mptcp_sched_ops {
+	/* return a bitmask of contexts[] entries: the lowest set bit selects
+	 * the subflow the data is pushed on, any other set bit requests a
+	 * redundant copy on that subflow (ignored when reinjecting)
+	 */
+	u32 (*get_subflow)(struct mptcp_sock *msk,
+			   const struct mptcp_sched_data *data);
+
+	char			name[MPTCP_SCHED_NAME_MAX];
+	struct module		*owner;
+	struct list_head	list;
+
+	void (*init)(struct mptcp_sock *msk);
+	void (*release)(struct mptcp_sock *msk);
+} ____cacheline_aligned_in_smp;
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched);
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched);
+
+#endif /* __NET_MPTCP_SCHED_H */
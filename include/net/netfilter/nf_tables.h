@@ -377,6 +377,8 @@ struct nft_set_ext;
  *	@remove: remove element from set
  *	@walk: iterate over all set elements
  *	@get: get set elements
+ *	@commit: update lookup data once elements were added or removed
+ *	@abort: undo lookup data changes made by an aborted transaction
  *	@privsize: function to return size of set private data
  *	@init: initialize private data of new set instance
  *	@destroy: destroy private data of set instance
@@ -425,6 +427,10 @@ struct nft_set_ops {
 					       const struct nft_set *set,
 					       const struct nft_set_elem *elem,
 					       unsigned int flags);
+	void				(*commit)(const struct net *net,
+						  struct nft_set *set);
+	void				(*abort)(const struct net *net,
+						 const struct nft_set *set);
 
 	u64				(*privsize)(const struct nlattr * const nla[],
 						    const struct nft_set_desc *desc);
@@ -491,6 +497,7 @@ struct nft_set_elem_expr {
  *	@policy: set parameterization (see enum nft_set_policies)
  *	@udlen: user data length
  *	@udata: user data
+ *	@pending_update: list of sets to be updated by the commit phase
  *	@expr: stateful expression
  * 	@ops: set ops
  * 	@flags: set flags
@@ -520,6 +527,7 @@ struct nft_set {
 	u16				policy;
 	u16				udlen;
 	unsigned char			*udata;
+	struct list_head		pending_update;
 	/* runtime data below here */
 	const struct nft_set_ops	*ops ____cacheline_aligned;
 	u16				flags:14,
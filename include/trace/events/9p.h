@@ -34,6 +34,8 @@
 		EM( P9_RXATTRCREATE,	"P9_RXATTRCREATE" )		\
 		EM( P9_TREADDIR,	"P9_TREADDIR" )			\
 		EM( P9_RREADDIR,	"P9_RREADDIR" )			\
+		EM( P9_TREADDIRPLUS,	"P9_TREADDIRPLUS" )		\
+		EM( P9_RREADDIRPLUS,	"P9_RREADDIRPLUS" )		\
 		EM( P9_TFSYNC,		"P9_TFSYNC" )			\
 		EM( P9_RFSYNC,		"P9_RFSYNC" )			\
 		EM( P9_TLOCK,		"P9_TLOCK" )			\
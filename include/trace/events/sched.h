@@ -735,6 +735,14 @@ DECLARE_TRACE(sched_update_nr_running_tp,
 	TP_PROTO(struct rq *rq, int change),
 	TP_ARGS(rq, change));
 
+DECLARE_TRACE(sched_asym_select_tp,
+	TP_PROTO(struct task_struct *p, int target, int cpu, unsigned long util),
+	TP_ARGS(p, target, cpu, util));
+
+DECLARE_TRACE(sched_misfit_lb_tp,
+	TP_PROTO(struct sched_domain *sd, int dst_cpu, unsigned long misfit_load),
+	TP_ARGS(sd, dst_cpu, misfit_load));
+
 #endif /* _TRACE_SCHED_H */
 
 /* This part must be outside protection */
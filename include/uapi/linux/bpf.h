@@ -909,6 +909,10 @@ enum bpf_map_type {
 	BPF_MAP_TYPE_INODE_STORAGE,
 	BPF_MAP_TYPE_TASK_STORAGE,
 	BPF_MAP_TYPE_BLOOM_FILTER,
+	BPF_MAP_TYPE_USER_RINGBUF,
+	BPF_MAP_TYPE_CGRP_STORAGE,
+	BPF_MAP_TYPE_ARENA,
+	BPF_MAP_TYPE_RHASH,
 };
 
 /* Note that tracing related programs such as
@@ -1226,6 +1230,13 @@ enum {
 
 /* Create a map that is suitable to be an inner map with dynamic max entries */
 	BPF_F_INNER_MAP		= (1U << 12),
+
+/* Give each possible CPU its own BPF_MAP_TYPE_RINGBUF ring of max_entries
+ * bytes. Producers only use the ring of the CPU they run on, the ring
+ * of CPU n is mmap()'ed at page offset n * (2 + 2 * max_entries / PAGE_SIZE)
+ * and the map fd is readable when any ring has data.
+ */
+	BPF_F_RINGBUF_PERCPU	= (1U << 24),
 };
 
 /* Flags for BPF_PROG_QUERY. */
@@ -1297,6 +1308,10 @@ union bpf_attr {
 		 * BPF_MAP_TYPE_BLOOM_FILTER - the lowest 4 bits indicate the
 		 * number of hash functions (if 0, the bloom filter will default
 		 * to using 5 hash functions).
+		 *
+		 * BPF_MAP_TYPE_LPM_TRIE - number of leading key bits (at most
+		 * 16) that lookups resolve through a direct index table before
+		 * walking the trie (if 0, no table is used).
 		 */
 		__u64	map_extra;
 	};
@@ -4230,6 +4245,9 @@ union bpf_attr {
  *		* **BPF_RB_CONS_POS**: Consumer position (can wrap around).
  *		* **BPF_RB_PROD_POS**: Producer(s) position (can wrap around).
  *
+ *		For a ring buffer created with **BPF_F_RINGBUF_PERCPU**, these
+ *		describe the ring of the current CPU.
+ *
  *		Data returned is just a momentary snapshot of actual values
  *		and could be inaccurate, so this facility should be used to
  *		power heuristics and for reporting, not to make 100% correct
@@ -65,4 +65,47 @@ struct cachefiles_read {
  */
 #define CACHEFILES_IOC_READ_COMPLETE	_IOW(0x98, 1, int)
 
+/*
+ * Reply for a batch of READ requests
+ * @ids		user pointer to an array of @nr __u32 READ request @id fields
+ * @nr		number of entries in @ids
+ *
+ * All known ids are completed; -EINVAL is returned if any of them is unknown.
+ * When issued through io_uring (IORING_OP_URING_CMD on the anon_fd, with this
+ * ioctl number as cmd_op), the structure is passed in the SQE command area.
+ * CACHEFILES_IOC_READ_COMPLETE can be issued the same way, with the @id as the
+ * first __u32 of the command area.
+ */
+struct cachefiles_cread_batch {
+	__u64 ids;
+	__u32 nr;
+	__u32 __reserved;
+};
+
+#define CACHEFILES_IOC_READ_COMPLETE_BATCH	\
+	_IOW(0x98, 2, struct cachefiles_cread_batch)
+
+/*
+ * Fetch requests through io_uring
+ *
+ * IORING_OP_URING_CMD on the /dev/cachefiles fd with cmd_op set to
+ * CACHEFILES_URING_CMD_READ and this structure in the SQE command area reads
+ * requests into the @len bytes at @buf, like read(2) on the fd does, except
+ * that the command waits for a request to arrive instead of returning 0.
+ *
+ * With CACHEFILES_URING_READ_BATCH set in @flags, further pending READ
+ * requests are appended to the buffer, each with its own message header,
+ * until the buffer is full.  The CQE result is the total number of bytes.
+ */
+struct cachefiles_uring_read {
+	__u64 buf;
+	__u32 len;
+	__u32 flags;
+};
+
+#define CACHEFILES_URING_READ_BATCH	0x1
+
+#define CACHEFILES_URING_CMD_READ	\
+	_IOR(0x98, 3, struct cachefiles_uring_read)
+
 #endif
@@ -353,6 +353,10 @@ struct fuse_file_lock {
  * FUSE_SECURITY_CTX:	add security context to create, mkdir, symlink, and
  *			mknod
  * FUSE_HAS_INODE_DAX:  use per inode DAX
+ * FUSE_WRITEBACK_NOCOPY: send page cache pages in writeback requests instead
+ *			of copies, writeback ends on reply (privileged only).
+ *			Not part of a protocol minor version, it uses the
+ *			top bit so it stays clear of upstream assignments
  */
 #define FUSE_ASYNC_READ		(1 << 0)
 #define FUSE_POSIX_LOCKS	(1 << 1)
@@ -389,6 +393,7 @@ struct fuse_file_lock {
 /* bits 32..63 get shifted down 32 bits into the flags2 field */
 #define FUSE_SECURITY_CTX	(1ULL << 32)
 #define FUSE_HAS_INODE_DAX	(1ULL << 33)
+#define FUSE_WRITEBACK_NOCOPY	(1ULL << 63)
 
 /**
  * CUSE INIT request/reply flags
@@ -954,6 +959,31 @@ struct fuse_notify_retrieve_in {
 #define FUSE_DEV_IOC_MAGIC		229
 #define FUSE_DEV_IOC_CLONE		_IOR(FUSE_DEV_IOC_MAGIC, 0, uint32_t)
 
+/*
+ * io_uring commands on /dev/fuse (IORING_OP_URING_CMD, IORING_SETUP_SQE128).
+ *
+ * FUSE_URING_CMD_FETCH parks a buffer of buf_len bytes at buf.  The command
+ * completes once a request has been copied into the buffer, with the result
+ * holding the number of bytes, exactly as read(2) on the device would have
+ * returned them.
+ *
+ * FUSE_URING_CMD_COMMIT_AND_FETCH first takes commit_len bytes at buf as a
+ * reply or notification, exactly as write(2) on the device would, and then
+ * parks the buffer for the next request.  A zero commit_len only fetches.
+ */
+enum fuse_uring_cmd {
+	FUSE_URING_CMD_INVALID = 0,
+	FUSE_URING_CMD_FETCH = 1,
+	FUSE_URING_CMD_COMMIT_AND_FETCH = 2,
+};
+
+struct fuse_uring_cmd_req {
+	uint64_t	buf;
+	uint32_t	buf_len;
+	uint32_t	commit_len;
+	uint64_t	flags;
+};
+
 struct fuse_lseek_in {
 	uint64_t	fh;
 	uint64_t	offset;
@@ -118,6 +118,7 @@ struct hv_vss_msg {
 
 #define FCOPY_VERSION_0 0
 #define FCOPY_VERSION_1 1
+#define FCOPY_VERSION_2 2 /* WRITE_TO_FILE streamed through hv_fcopy_ring */
 #define FCOPY_CURRENT_VERSION FCOPY_VERSION_1
 #define W_MAX_PATH 260
 
@@ -158,6 +159,32 @@ struct hv_do_fcopy {
 	__u8	data[DATA_FRAGMENT];
 } __attribute__((packed));
 
+/*
+ * Streaming mode (FCOPY_VERSION_2).
+ *
+ * After registering with FCOPY_VERSION_2, the daemon maps this ring from
+ * offset 0 of the device.  WRITE_TO_FILE fragments are then placed in the
+ * ring and acknowledged to the host right away instead of going through
+ * read()/write() one at a time; only when the ring is full does a fragment
+ * take the old path.  All other operations are still read() from the
+ * device, and the daemon must consume the ring up to @head before acting
+ * on any of them.  The device polls readable while the ring is not empty,
+ * read() honours O_NONBLOCK.
+ *
+ * A failed write is reported by setting @error, which the kernel then
+ * returns to the host for the next fragment, and in the reply to the next
+ * operation read() from the device.
+ */
+#define FCOPY_RING_SLOTS	64
+
+struct hv_fcopy_ring {
+	__u32 head;		/* next slot to fill, written by the kernel */
+	__u32 tail;		/* next slot to consume, written by the daemon */
+	__s32 error;		/* first failed write, written by the daemon */
+	__u32 reserved[13];
+	struct hv_do_fcopy slots[FCOPY_RING_SLOTS];
+};
+
 /*
  * An implementation of HyperV key value pair (KVP) functionality for Linux.
  *
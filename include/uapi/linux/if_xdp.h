@@ -25,6 +25,24 @@
  * application.
  */
 #define XDP_USE_NEED_WAKEUP (1 << 3)
+/* By setting this option, userspace application indicates that it can
+ * handle packets spanning multiple descriptors, chained with the
+ * XDP_PKT_CONTD option. Frames that don't fit a single chunk are then
+ * split over several Rx descriptors instead of being dropped, and Tx
+ * descriptors may be chained the same way. Only supported in copy mode.
+ */
+#define XDP_USE_SG	(1 << 4)
+/* Let sockets bound to other queues or devices draw frames from this
+ * socket's fill ring. Set it on the socket that owns the umem, and
+ * together with XDP_SHARED_UMEM, without a fill ring of their own, on
+ * the sockets sharing its umem. Each queue then keeps a small private
+ * cache that is refilled from the shared fill ring. Frames left in the
+ * cache of a socket that goes away are handed to the remaining ones; as
+ * with any socket, frames it already took for reception are not
+ * returned. With XDP_USE_NEED_WAKEUP, the flag on the shared fill ring
+ * means that at least one of these sockets needs to be woken up.
+ */
+#define XDP_SHARED_FILL	(1 << 5)
 
 /* Flags for xsk_umem_config flags */
 #define XDP_UMEM_UNALIGNED_CHUNK_FLAG (1 << 0)
@@ -106,6 +124,13 @@ struct xdp_desc {
 	__u32 options;
 };
 
+/* Flags for the options field of struct xdp_desc */
+
+/* The packet continues in the next descriptor. Set on all but the last
+ * descriptor of a packet, requires the socket to be bound with XDP_USE_SG.
+ */
+#define XDP_PKT_CONTD (1 << 0)
+
 /* UMEM descriptor is __u64 */
 
 #endif /* _LINUX_IF_XDP_H */
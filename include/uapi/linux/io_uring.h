@@ -49,6 +49,7 @@ struct io_uring_sqe {
 		__u32		hardlink_flags;
 		__u32		xattr_flags;
 		__u32		msg_ring_flags;
+		__u32		futex_flags;
 	};
 	__u64	user_data;	/* data to be passed back at completion time */
 	/* pack this to avoid bogus arm OABI complaints */
@@ -194,6 +195,9 @@ enum io_uring_op {
 	IORING_OP_GETXATTR,
 	IORING_OP_SOCKET,
 	IORING_OP_URING_CMD,
+	IORING_OP_FUTEX_WAIT,
+	IORING_OP_FUTEX_WAKE,
+	IORING_OP_FUTEX_WAITV,
 
 	/* this goes last, obviously */
 	IORING_OP_LAST,
@@ -260,8 +264,19 @@ enum io_uring_op {
  *				or receive and arm poll if that yields an
  *				-EAGAIN result, arm poll upfront and skip
  *				the initial transfer attempt.
+ *
+ * IORING_RECVSEND_BUNDLE	Used with IOSQE_BUFFER_SELECT and a provided
+ *				buffer ring. recv/recvmsg may fill several
+ *				buffers and send may gather several buffers
+ *				in one transfer. The CQE carries the buffer
+ *				ID of the first buffer, the buffers after it
+ *				are consumed in ring order until cqe->res
+ *				bytes are covered. Only valid for
+ *				IORING_OP_RECV, IORING_OP_RECVMSG and
+ *				IORING_OP_SEND, and not with MSG_WAITALL.
  */
 #define IORING_RECVSEND_POLL_FIRST	(1U << 0)
+#define IORING_RECVSEND_BUNDLE		(1U << 4)
 
 /*
  * accept flags stored in sqe->ioprio
@@ -274,6 +289,7 @@ enum io_uring_op {
 enum {
 	IORING_MSG_DATA,	/* pass sqe->len as 'res' and off as user_data */
 	IORING_MSG_SEND_FD,	/* send a registered fd to another ring */
+	IORING_MSG_SEND_BUF,	/* move a registered buffer to another ring */
 };
 
 /*
@@ -305,10 +321,13 @@ struct io_uring_cqe {
  * IORING_CQE_F_BUFFER	If set, the upper 16 bits are the buffer ID
  * IORING_CQE_F_MORE	If set, parent SQE will generate more CQE entries
  * IORING_CQE_F_SOCK_NONEMPTY	If set, more data to read after socket recv
+ * IORING_CQE_F_BUF_MORE	If set, the buffer ID is only partially consumed
+ *				and will be used again, see IOU_PBUF_RING_INC
  */
 #define IORING_CQE_F_BUFFER		(1U << 0)
 #define IORING_CQE_F_MORE		(1U << 1)
 #define IORING_CQE_F_SOCK_NONEMPTY	(1U << 2)
+#define IORING_CQE_F_BUF_MORE		(1U << 4)
 
 enum {
 	IORING_CQE_BUFFER_SHIFT		= 16,
@@ -446,6 +465,12 @@ enum {
 	/* sync cancelation API */
 	IORING_REGISTER_SYNC_CANCEL		= 24,
 
+	/* tune how a shared SQPOLL thread services this ring */
+	IORING_REGISTER_SQPOLL_TUNE		= 25,
+
+	/* start or reset per-opcode issue counters, shown in fdinfo */
+	IORING_REGISTER_OP_STATS		= 26,
+
 	/* this goes last */
 	IORING_REGISTER_LAST
 };
@@ -547,11 +572,25 @@ struct io_uring_buf_ring {
 };
 
 /* argument for IORING_(UN)REGISTER_PBUF_RING */
+/*
+ * io_uring_buf_reg->flags
+ *
+ * IOU_PBUF_RING_INC	Buffers are consumed incrementally. A completion only
+ *			uses as much of the head buffer as it transferred, and
+ *			the next one continues after that within the same
+ *			buffer ID. The kernel advances ->addr and ->len of the
+ *			ring entry, and IORING_CQE_F_BUF_MORE is set for as
+ *			long as the buffer has room left.
+ */
+enum {
+	IOU_PBUF_RING_INC	= 2,
+};
+
 struct io_uring_buf_reg {
 	__u64	ring_addr;
 	__u32	ring_entries;
 	__u16	bgid;
-	__u16	pad;
+	__u16	flags;
 	__u64	resv[3];
 };
 
@@ -592,4 +631,23 @@ struct io_uring_sync_cancel_reg {
 	__u64				pad[4];
 };
 
+/*
+ * Argument for IORING_REGISTER_SQPOLL_TUNE
+ *
+ * @weight: share of the SQPOLL thread this ring gets when the thread is
+ *	    shared, in units of the per-pass submission batch. 0 keeps the
+ *	    current weight, the default is 1.
+ * @flags: IORING_SQPOLL_ADAPTIVE_IDLE lets the thread spin for less than
+ *	   sq_thread_idle, based on the observed gap between submissions.
+ *	   It takes effect once all rings sharing the thread have set it.
+ */
+#define IORING_SQPOLL_MAX_WEIGHT	16
+#define IORING_SQPOLL_ADAPTIVE_IDLE	(1U << 0)
+
+struct io_uring_sqpoll_tune {
+	__u32	weight;
+	__u32	flags;
+	__u64	resv[3];
+};
+
 #endif
@@ -0,0 +1,62 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_KMSG_H
+#define _UAPI_LINUX_KMSG_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * Binary batched reads from /dev/kmsg.
+ *
+ * KMSG_IOC_READ_BATCH copies as many records as fit into the supplied
+ * buffer, starting at the file's current sequence number, without the
+ * text formatting done by read(2).  Each record starts with a struct
+ * kmsg_record, directly followed by text_len bytes of message text (not
+ * NUL terminated) and zero padding up to rec_len, which is a multiple of 8.
+ * The next record starts rec_len bytes after the current one.
+ *
+ * Blocks until at least one record is available unless the file was
+ * opened with O_NONBLOCK, in which case -EAGAIN is returned.  Records
+ * overwritten before they could be read are skipped and counted in @lost
+ * instead of failing with -EPIPE.  -EINVAL is returned if the buffer is
+ * too small for the first record.
+ */
+
+#define KMSG_SUBSYSTEM_LEN	16
+#define KMSG_DEVICE_LEN		48
+
+/* kmsg_record.flags */
+#define KMSG_RECORD_NEWLINE	0x01	/* text ended with a newline */
+#define KMSG_RECORD_CONT	0x02	/* fragment of a continuation line */
+
+struct kmsg_record {
+	__u64	seq;			/* sequence number */
+	__u64	ts_nsec;		/* local clock timestamp */
+	__u32	caller_id;		/* thread id or processor id */
+	__u16	rec_len;		/* size of the record incl. padding */
+	__u16	text_len;		/* length of text[] */
+	__u8	facility;		/* syslog facility */
+	__u8	level;			/* syslog level */
+	__u8	flags;			/* KMSG_RECORD_* */
+	__u8	__reserved1;
+	__u32	__reserved2;
+	char	subsystem[KMSG_SUBSYSTEM_LEN];	/* dev_printk() subsystem */
+	char	device[KMSG_DEVICE_LEN];	/* dev_printk() device */
+	char	text[];
+};
+
+struct kmsg_read_batch {
+	__u64	buf;			/* in: user buffer for the records */
+	__u32	len;			/* in: size of @buf */
+	__u32	flags;			/* in: must be 0 */
+	__u64	next_seq;		/* out: sequence number to read next */
+	__u64	lost;			/* out: records skipped as overwritten */
+	__u32	nr_records;		/* out: records copied to @buf */
+	__u32	used;			/* out: bytes used in @buf */
+};
+
+/* 'k' is shared with spidev (SPI_IOC_*, 0x00-0x05), kmsg uses 0x80-0x8F */
+#define KMSG_IOC_MAGIC		'k'
+#define KMSG_IOC_READ_BATCH	_IOWR(KMSG_IOC_MAGIC, 0x80, struct kmsg_read_batch)
+
+#endif /* _UAPI_LINUX_KMSG_H */
@@ -1166,6 +1166,9 @@ struct kvm_ppc_resize_hpt {
 #define KVM_CAP_S390_PROTECTED_DUMP 217
 #define KVM_CAP_X86_TRIPLE_FAULT_EVENT 218
 #define KVM_CAP_X86_NOTIFY_VMEXIT 219
+/* Capabilities not in mainline, numbered well clear of the upstream range */
+#define KVM_CAP_X86_EAGER_PAGE_SPLIT 1000
+#define KVM_CAP_COALESCED_MMIO_PERCPU 1001
 
 #ifdef KVM_CAP_IRQ_ROUTING
 
@@ -2185,4 +2188,9 @@ struct kvm_stats_desc {
 #define KVM_X86_NOTIFY_VMEXIT_ENABLED		(1ULL << 0)
 #define KVM_X86_NOTIFY_VMEXIT_USER		(1ULL << 1)
 
+/* Available with KVM_CAP_X86_EAGER_PAGE_SPLIT */
+#define KVM_X86_EAGER_PAGE_SPLIT_DEFAULT	0
+#define KVM_X86_EAGER_PAGE_SPLIT_ENABLE		1
+#define KVM_X86_EAGER_PAGE_SPLIT_DISABLE	2
+
 #endif /* __LINUX_KVM_H */
@@ -62,6 +62,8 @@ enum nfqnl_attr_type {
 	NFQA_VLAN,			/* nested attribute: packet vlan info */
 	NFQA_L2HDR,			/* full L2 header */
 	NFQA_PRIORITY,			/* skb->priority */
+	NFQA_CGROUP_CLASSID,		/* __u32 cgroup classid */
+	NFQA_VERDICT_LIST,		/* array of nfqnl_msg_verdict_hdr */
 
 	__NFQA_MAX
 };
@@ -76,6 +76,9 @@ enum ovs_datapath_cmd {
  * datapath.  Always present in notifications.
  * @OVS_DP_ATTR_MEGAFLOW_STATS: Statistics about mega flow masks usage for the
  * datapath. Always present in notifications.
+ * @OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL: Interval in milliseconds at which
+ * the masks are re-sorted by usage, so that the most hit ones are tried
+ * first. Always present in notifications.
  *
  * These attributes follow the &struct ovs_header within the Generic Netlink
  * payload for %OVS_DP_* commands.
@@ -92,6 +95,8 @@ enum ovs_datapath_attr {
 	OVS_DP_ATTR_PER_CPU_PIDS,   /* Netlink PIDS to receive upcalls in
 				     * per-cpu dispatch mode
 				     */
+	OVS_DP_ATTR_IFINDEX,
+	OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL, /* u32 msecs */
 	__OVS_DP_ATTR_MAX
 };
 
@@ -792,6 +797,10 @@ struct ovs_action_hash {
  * respectively.  Remaining bits control the changes for which an event is
  * delivered on the NFNLGRP_CONNTRACK_UPDATE group.
  * @OVS_CT_ATTR_TIMEOUT: Variable length string defining conntrack timeout.
+ * @OVS_CT_ATTR_FLOWTABLE: If present, established TCP and UDP connections
+ * seen by this action are added to a flow table shared by the actions of the
+ * same zone, and later packets of these connections are looked up there
+ * instead of being passed through conntrack.
  */
 enum ovs_ct_attr {
 	OVS_CT_ATTR_UNSPEC,
@@ -806,6 +815,7 @@ enum ovs_ct_attr {
 	OVS_CT_ATTR_EVENTMASK,  /* u32 mask of IPCT_* events. */
 	OVS_CT_ATTR_TIMEOUT,	/* Associate timeout with this connection for
 				 * fine-grain timeout tuning. */
+	OVS_CT_ATTR_FLOWTABLE,	/* No argument, use the zone's flow table. */
 	__OVS_CT_ATTR_MAX
 };
 
@@ -411,7 +411,12 @@ struct perf_event_attr {
 				inherit_thread :  1, /* children only inherit if cloned with CLONE_THREAD */
 				remove_on_exec :  1, /* event is removed from task on exec */
 				sigtrap        :  1, /* send synchronous SIGTRAP on event */
-				__reserved_1   : 26;
+				__reserved_1   : 24,
+				/*
+				 * Not in mainline: allocated from the top of
+				 * the reserved bits, well clear of upstream.
+				 */
+				aggregate_callchain :  1; /* count callchains, emit PERF_RECORD_CALLCHAIN_AGG */
 
 	union {
 		__u32		wakeup_events;	  /* wakeup every n events */
@@ -1160,6 +1165,27 @@ enum perf_event_type {
 	 */
 	PERF_RECORD_AUX_OUTPUT_HW_ID		= 21,
 
+	/*
+	 * Emitted instead of PERF_RECORD_SAMPLE by events with
+	 * attr.aggregate_callchain set.  Samples are counted per unique
+	 * (pid, tid, callchain) in the kernel and each record carries the
+	 * number of samples and their summed period since the last one for
+	 * the same key.  Records are written when the event's table fills,
+	 * about once a second, and when the event is disabled or exits.
+	 * Callchains are truncated to PERF_AGG_MAX_STACK entries.
+	 *
+	 * struct {
+	 *	struct perf_event_header	header;
+	 *	u32				pid, tid;
+	 *	u64				count;
+	 *	u64				period;
+	 *	u64				nr;
+	 *	u64				ips[nr];
+	 *	struct sample_id		sample_id;
+	 * };
+	 */
+	PERF_RECORD_CALLCHAIN_AGG		= 23,
+
 	PERF_RECORD_MAX,			/* non-ABI */
 };
 
@@ -1185,6 +1211,7 @@ enum perf_bpf_event_type {
 
 #define PERF_MAX_STACK_DEPTH		127
 #define PERF_MAX_CONTEXTS_PER_STACK	  8
+#define PERF_AGG_MAX_STACK		 64
 
 enum perf_callchain_context {
 	PERF_CONTEXT_HV			= (__u64)-32,
@@ -0,0 +1,108 @@
+/* SPDX-License-Identifier: GPL-2.0 WITH Linux-syscall-note */
+#ifndef _UAPI_LINUX_PROC_TASK_STAT_H
+#define _UAPI_LINUX_PROC_TASK_STAT_H
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/*
+ * /proc/task_stat: binary, batched process statistics.
+ *
+ * PROC_TASK_STAT_IOC_QUERY with a struct proc_task_stat_query selects the
+ * record version and the field groups the kernel should compute for the
+ * open file it is issued on; groups that are not requested are left zero
+ * and cost nothing. Each read(2) then returns as many struct proc_task_stat
+ * records as fit the buffer, one per thread group in increasing pid order.
+ * The file position is the next pid to report, so lseek(fd, 0, SEEK_SET)
+ * restarts a scan. A read returning 0 means that every visible thread
+ * group has been reported.
+ *
+ * Without a query, PROC_TASK_STAT_BASIC is reported.
+ */
+
+#define PROC_TASK_STAT_VERSION	1
+
+/* comm, state, ids and scheduling parameters, as in /proc/<pid>/stat */
+#define PROC_TASK_STAT_BASIC	(1ULL << 0)
+/* user, system and guest time of the group and its waited-for children */
+#define PROC_TASK_STAT_CPU	(1ULL << 1)
+/* minor and major page faults of the group and its children */
+#define PROC_TASK_STAT_FAULTS	(1ULL << 2)
+/* virtual size, resident set size and its limit */
+#define PROC_TASK_STAT_MEM	(1ULL << 3)
+/* real, effective, saved and fs ids, as in /proc/<pid>/status */
+#define PROC_TASK_STAT_CREDS	(1ULL << 4)
+/* I/O accounting as in /proc/<pid>/io, needs ptrace read access */
+#define PROC_TASK_STAT_IO	(1ULL << 5)
+#define PROC_TASK_STAT_ALL	((1ULL << 6) - 1)
+
+struct proc_task_stat_query {
+	__u32 version;		/* PROC_TASK_STAT_VERSION */
+	__u32 reserved;		/* must be zero */
+	__u64 mask;		/* PROC_TASK_STAT_* groups to compute */
+};
+
+#define PROC_TASK_STAT_IOC_QUERY	_IOW('f', 16, struct proc_task_stat_query)
+
+struct proc_task_stat {
+	__u32 size;		/* sizeof(struct proc_task_stat) */
+	__s32 pid;		/* thread group id in the reader's pid namespace */
+	__u64 mask;		/* PROC_TASK_STAT_* groups filled in */
+
+	/* PROC_TASK_STAT_BASIC */
+	char comm[16];
+	__u64 start_time_ns;	/* since boot, adjusted for time namespace */
+	__u32 flags;		/* PF_* flags of the group leader */
+	__s32 ppid;
+	__s32 pgid;
+	__s32 sid;
+	__s32 tty_nr;
+	__s32 nice;
+	__s32 prio;
+	__u32 policy;
+	__u32 rt_priority;
+	__u32 num_threads;
+	__s32 processor;	/* CPU the group leader last ran on */
+	__u8 state;		/* state letter as in /proc/<pid>/stat */
+	__u8 __pad[3];
+
+	/* PROC_TASK_STAT_CPU, in nanoseconds */
+	__u64 utime;
+	__u64 stime;
+	__u64 cutime;
+	__u64 cstime;
+	__u64 gtime;
+	__u64 cgtime;
+
+	/* PROC_TASK_STAT_FAULTS */
+	__u64 min_flt;
+	__u64 maj_flt;
+	__u64 cmin_flt;
+	__u64 cmaj_flt;
+
+	/* PROC_TASK_STAT_MEM, in bytes */
+	__u64 vsize;
+	__u64 rss;
+	__u64 rsslim;
+
+	/* PROC_TASK_STAT_CREDS, in the reader's user namespace */
+	__u32 uid;
+	__u32 euid;
+	__u32 suid;
+	__u32 fsuid;
+	__u32 gid;
+	__u32 egid;
+	__u32 sgid;
+	__u32 fsgid;
+
+	/* PROC_TASK_STAT_IO */
+	__u64 rchar;
+	__u64 wchar;
+	__u64 syscr;
+	__u64 syscw;
+	__u64 read_bytes;
+	__u64 write_bytes;
+	__u64 cancelled_write_bytes;
+};
+
+#endif /* _UAPI_LINUX_PROC_TASK_STAT_H */
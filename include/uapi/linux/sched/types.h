@@ -10,6 +10,7 @@ struct sched_param {
 
 #define SCHED_ATTR_SIZE_VER0	48	/* sizeof first published struct */
 #define SCHED_ATTR_SIZE_VER1	56	/* add: util_{min,max} */
+#define SCHED_ATTR_SIZE_VER2	60	/* add: latency_nice */
 
 /*
  * Extended scheduling parameters data structure.
@@ -98,6 +99,21 @@ struct sched_param {
  * scheduled on a CPU with no more capacity than the specified value.
  *
  * A task utilization boundary can be reset by setting the attribute to -1.
+ *
+ * Latency Attributes
+ * ==================
+ *
+ * SCHED_NORMAL and SCHED_BATCH tasks can tell the scheduler how sensitive
+ * they are to scheduling latency, independently of their CPU share:
+ *
+ *  @sched_latency_nice	task's latency_nice value
+ *
+ * The latency_nice of a task can have any value in a range of
+ * [MIN_LATENCY_NICE..MAX_LATENCY_NICE], i.e. [-20..19]. A negative value
+ * makes the task preempt the running task sooner on wakeup and run in
+ * shorter slices, a positive value the opposite. Like nice, lowering the
+ * value requires CAP_SYS_NICE. It is only updated when
+ * SCHED_FLAG_LATENCY_NICE is set.
  */
 struct sched_attr {
 	__u32 size;
@@ -120,6 +136,8 @@ struct sched_attr {
 	__u32 sched_util_min;
 	__u32 sched_util_max;
 
+	/* latency requirement hints */
+	__s32 sched_latency_nice;
 };
 
 #endif /* _UAPI_LINUX_SCHED_TYPES_H */
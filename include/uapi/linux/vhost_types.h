@@ -27,6 +27,29 @@ struct vhost_vring_file {
 
 };
 
+struct vhost_worker_state {
+	/*
+	 * For VHOST_NEW_WORKER the kernel returns the new worker's id here.
+	 * For VHOST_FREE_WORKER this must be set to the id of the worker to
+	 * free.
+	 */
+	unsigned int worker_id;
+};
+
+struct vhost_worker_cpu {
+	/* The id of the vhost_worker returned from VHOST_NEW_WORKER */
+	unsigned int worker_id;
+	/* CPU to run the worker on, or -1 for any. */
+	int cpu;
+};
+
+struct vhost_vring_worker {
+	/* vring index */
+	unsigned int index;
+	/* The id of the vhost_worker returned from VHOST_NEW_WORKER */
+	unsigned int worker_id;
+};
+
 struct vhost_vring_addr {
 	unsigned int index;
 	/* Option flags. */
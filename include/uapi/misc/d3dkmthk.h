@@ -1550,6 +1550,43 @@ struct d3dkmt_shareobjectwithhost {
 	__u64			object_vail_nt_handle;
 };
 
+#define D3DKMT_SUBMITBATCH_MAX			256
+
+enum d3dkmt_batchoperationtype {
+	_D3DKMT_BATCH_SUBMITCOMMAND		= 0,
+	_D3DKMT_BATCH_SIGNALSYNCOBJECTFROMGPU	= 1,
+	_D3DKMT_BATCH_WAITFORSYNCOBJECTFROMGPU	= 2,
+};
+
+/*
+ * A single operation of LX_DXSUBMITBATCH. args points to the argument
+ * structure of the corresponding ioctl:
+ *   _D3DKMT_BATCH_SUBMITCOMMAND		struct d3dkmt_submitcommand
+ *   _D3DKMT_BATCH_SIGNALSYNCOBJECTFROMGPU	struct
+ *					d3dkmt_signalsynchronizationobjectfromgpu
+ *   _D3DKMT_BATCH_WAITFORSYNCOBJECTFROMGPU	struct
+ *					d3dkmt_waitforsynchronizationobjectfromgpu
+ */
+struct d3dkmt_batchoperation {
+	enum d3dkmt_batchoperationtype	type;
+	__u32				reserved;
+#ifdef __KERNEL__
+	void				*args;
+#else
+	__u64				args;
+#endif
+};
+
+struct d3dkmt_submitbatch {
+	__u32				operation_count;
+	__u32				completed_count;
+#ifdef __KERNEL__
+	struct d3dkmt_batchoperation	*operations;
+#else
+	__u64				operations;
+#endif
+};
+
 /*
  * Dxgkrnl Graphics Port Driver ioctl definitions
  *
@@ -1673,7 +1710,9 @@ struct d3dkmt_shareobjectwithhost {
 	_IOWR(0x47, 0x43, struct d3dkmt_querystatistics)
 #define LX_DXSHAREOBJECTWITHHOST	\
 	_IOWR(0x47, 0x44, struct d3dkmt_shareobjectwithhost)
+#define LX_DXSUBMITBATCH	\
+	_IOWR(0x47, 0x45, struct d3dkmt_submitbatch)
 
-#define LX_IO_MAX 0x45
+#define LX_IO_MAX 0x46
 
 #endif /* _D3DKMTHK_H */
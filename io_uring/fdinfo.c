@@ -10,6 +10,7 @@
 #include <uapi/linux/io_uring.h>
 
 #include "io_uring.h"
+#include "opdef.h"
 #include "sqpoll.h"
 #include "fdinfo.h"
 #include "cancel.h"
@@ -53,6 +54,7 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 {
 	struct io_sq_data *sq = NULL;
 	struct io_overflow_cqe *ocqe;
+	struct io_op_stats *stats;
 	struct io_rings *r = ctx->rings;
 	unsigned int sq_mask = ctx->sq_entries - 1, cq_mask = ctx->cq_entries - 1;
 	unsigned int sq_head = READ_ONCE(r->sq.head);
@@ -157,6 +159,27 @@ static __cold void __io_uring_show_fdinfo(struct io_ring_ctx *ctx,
 	if (has_lock)
 		mutex_unlock(&ctx->uring_lock);
 
+	/* never freed before the ctx, no need for the lock */
+	stats = READ_ONCE(ctx->op_stats);
+	if (stats) {
+		seq_puts(m, "OpStats:\n");
+		for (i = 0; i < IORING_OP_LAST; i++) {
+			struct io_op_stats *st = &stats[i];
+
+			if (!atomic_long_read(&st->issued_inline) &&
+			    !atomic_long_read(&st->punted_iowq) &&
+			    !atomic_long_read(&st->poll_armed) &&
+			    !atomic_long_read(&st->eagain))
+				continue;
+			seq_printf(m, "  %s: inline=%ld iowq=%ld poll=%ld eagain=%ld\n",
+				   io_op_defs[i].name,
+				   atomic_long_read(&st->issued_inline),
+				   atomic_long_read(&st->punted_iowq),
+				   atomic_long_read(&st->poll_armed),
+				   atomic_long_read(&st->eagain));
+		}
+	}
+
 	seq_puts(m, "PollList:\n");
 	for (i = 0; i < (1U << ctx->cancel_table.hash_bits); i++) {
 		struct io_hash_bucket *hb = &ctx->cancel_table.hbs[i];
@@ -0,0 +1,327 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <linux/kernel.h>
+#include <linux/errno.h>
+#include <linux/fs.h>
+#include <linux/file.h>
+#include <linux/slab.h>
+#include <linux/io_uring.h>
+
+#include <uapi/linux/io_uring.h>
+
+#include "../kernel/futex/futex.h"
+#include "io_uring.h"
+#include "cancel.h"
+#include "futex.h"
+
+/* same per-futex flags as struct futex_waitv */
+#define IO_FUTEX_FLAGS	(FUTEX_32 | FUTEX_PRIVATE_FLAG)
+
+struct io_futex {
+	struct file	*file;
+	union {
+		u32 __user			*uaddr;
+		struct futex_waitv __user	*uwaitv;
+	};
+	unsigned long	futex_val;
+	unsigned long	futex_mask;
+	unsigned long	futexv_owned;
+	u32		futex_flags;
+	unsigned int	futex_nr;
+	bool		futexv_unqueued;
+};
+
+static void io_futex_complete(struct io_kiocb *req, bool *locked)
+{
+	io_tw_lock(req->ctx, locked);
+	hlist_del_init(&req->hash_node);
+	io_req_task_complete(req, locked);
+}
+
+static void io_futexv_complete(struct io_kiocb *req, bool *locked)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+	struct futex_vector *futexv = req->async_data;
+
+	io_tw_lock(req->ctx, locked);
+
+	if (!iof->futexv_unqueued) {
+		int res;
+
+		res = futex_unqueue_multiple(futexv, iof->futex_nr);
+		if (res != -1)
+			io_req_set_res(req, res, 0);
+	}
+
+	hlist_del_init(&req->hash_node);
+	io_req_task_complete(req, locked);
+}
+
+/*
+ * Only one wakeup or the cancelation path gets to complete a vectored wait,
+ * the others see the request as owned already.
+ */
+static bool io_futexv_claim(struct io_futex *iof)
+{
+	if (test_bit(0, &iof->futexv_owned) ||
+	    test_and_set_bit_lock(0, &iof->futexv_owned))
+		return false;
+	return true;
+}
+
+static bool __io_futex_cancel(struct io_ring_ctx *ctx, struct io_kiocb *req)
+{
+	/* futex wake already done or in progress */
+	if (req->opcode == IORING_OP_FUTEX_WAIT) {
+		struct futex_q *q = req->async_data;
+
+		if (!futex_unqueue(q))
+			return false;
+		req->io_task_work.func = io_futex_complete;
+	} else {
+		struct io_futex *iof = io_kiocb_to_cmd(req);
+
+		if (!io_futexv_claim(iof))
+			return false;
+		req->io_task_work.func = io_futexv_complete;
+	}
+
+	hlist_del_init(&req->hash_node);
+	io_req_set_res(req, -ECANCELED, 0);
+	io_req_task_work_add(req);
+	return true;
+}
+
+int io_futex_cancel(struct io_ring_ctx *ctx, struct io_cancel_data *cd,
+		    unsigned int issue_flags)
+{
+	struct hlist_node *tmp;
+	struct io_kiocb *req;
+	int ret = -ENOENT;
+
+	if (cd->flags & (IORING_ASYNC_CANCEL_FD|IORING_ASYNC_CANCEL_FD_FIXED))
+		return -ENOENT;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	hlist_for_each_entry_safe(req, tmp, &ctx->futex_list, hash_node) {
+		if (!(cd->flags & IORING_ASYNC_CANCEL_ANY) &&
+		    req->cqe.user_data != cd->data)
+			continue;
+		/* a canceled request leaves the list, one per call is enough */
+		if (__io_futex_cancel(ctx, req)) {
+			ret = 0;
+			break;
+		}
+	}
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+
+bool io_futex_remove_all(struct io_ring_ctx *ctx, struct task_struct *task,
+			 bool cancel_all)
+	__must_hold(&ctx->uring_lock)
+{
+	struct hlist_node *tmp;
+	struct io_kiocb *req;
+	bool found = false;
+
+	lockdep_assert_held(&ctx->uring_lock);
+
+	hlist_for_each_entry_safe(req, tmp, &ctx->futex_list, hash_node) {
+		if (!io_match_task_safe(req, task, cancel_all))
+			continue;
+		found |= __io_futex_cancel(ctx, req);
+	}
+
+	return found;
+}
+
+static int io_futex_parse_flags(struct io_futex *iof, u32 flags)
+{
+	if ((flags & ~IO_FUTEX_FLAGS) || !(flags & FUTEX_32))
+		return -EINVAL;
+	iof->futex_flags = (flags & FUTEX_PRIVATE_FLAG) ? 0 : FLAGS_SHARED;
+	return 0;
+}
+
+int io_futex_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+
+	if (unlikely(sqe->len || sqe->futex_flags || sqe->buf_index ||
+		     sqe->file_index))
+		return -EINVAL;
+
+	iof->uaddr = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	iof->futex_val = READ_ONCE(sqe->addr2);
+	iof->futex_mask = READ_ONCE(sqe->addr3);
+	if (iof->futex_val > U32_MAX || !iof->futex_mask ||
+	    iof->futex_mask > U32_MAX)
+		return -EINVAL;
+
+	return io_futex_parse_flags(iof, READ_ONCE(sqe->fd));
+}
+
+static void io_futex_wakev_fn(struct wake_q_head *wake_q, struct futex_q *q)
+{
+	struct io_kiocb *req = q->wake_data;
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+
+	if (!io_futexv_claim(iof))
+		return;
+
+	/* see futex_wake_mark(), the store to lock_ptr must come last */
+	__futex_unqueue(q);
+	smp_store_release(&q->lock_ptr, NULL);
+
+	io_req_set_res(req, 0, 0);
+	req->io_task_work.func = io_futexv_complete;
+	io_req_task_work_add(req);
+}
+
+int io_futexv_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+	struct futex_vector *futexv;
+	int ret, i;
+
+	/* No flags or mask supported for waitv */
+	if (unlikely(sqe->fd || sqe->buf_index || sqe->file_index ||
+		     sqe->addr2 || sqe->futex_flags || sqe->addr3))
+		return -EINVAL;
+
+	iof->uwaitv = u64_to_user_ptr(READ_ONCE(sqe->addr));
+	iof->futex_nr = READ_ONCE(sqe->len);
+	if (!iof->futex_nr || iof->futex_nr > FUTEX_WAITV_MAX)
+		return -EINVAL;
+
+	futexv = kcalloc(iof->futex_nr, sizeof(*futexv), GFP_KERNEL);
+	if (!futexv)
+		return -ENOMEM;
+
+	ret = futex_parse_waitv(futexv, iof->uwaitv, iof->futex_nr);
+	if (ret) {
+		kfree(futexv);
+		return ret;
+	}
+
+	for (i = 0; i < iof->futex_nr; i++) {
+		futexv[i].q.wake = io_futex_wakev_fn;
+		futexv[i].q.wake_data = req;
+	}
+
+	iof->futexv_owned = 0;
+	iof->futexv_unqueued = 0;
+	req->flags |= REQ_F_ASYNC_DATA;
+	req->async_data = futexv;
+	return 0;
+}
+
+static void io_futex_wake_fn(struct wake_q_head *wake_q, struct futex_q *q)
+{
+	struct io_kiocb *req = q->wake_data;
+
+	/* see futex_wake_mark(), the store to lock_ptr must come last */
+	__futex_unqueue(q);
+	smp_store_release(&q->lock_ptr, NULL);
+
+	io_req_set_res(req, 0, 0);
+	req->io_task_work.func = io_futex_complete;
+	io_req_task_work_add(req);
+}
+
+int io_futexv_wait(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+	struct futex_vector *futexv = req->async_data;
+	struct io_ring_ctx *ctx = req->ctx;
+	int ret, woken = -1;
+
+	io_ring_submit_lock(ctx, issue_flags);
+
+	ret = futex_wait_multiple_setup(futexv, iof->futex_nr, &woken);
+
+	/*
+	 * The setup leaves the task in TASK_INTERRUPTIBLE for a caller that
+	 * is going to sleep. We don't, the wakeup completes us through
+	 * task_work instead.
+	 */
+	__set_current_state(TASK_RUNNING);
+
+	if (unlikely(ret < 0)) {
+		io_ring_submit_unlock(ctx, issue_flags);
+		req_set_fail(req);
+		io_req_set_res(req, ret, 0);
+		return IOU_OK;
+	}
+
+	/*
+	 * 0 means that all futexes were queued and none was woken while we
+	 * did so, make us cancelable. 1 means one was woken during setup,
+	 * in which case futex_wait_multiple_setup() already unqueued them
+	 * all and the waker's task_work completes the request.
+	 */
+	if (!ret) {
+		hlist_add_head(&req->hash_node, &ctx->futex_list);
+	} else {
+		iof->futexv_unqueued = 1;
+		if (woken != -1)
+			io_req_set_res(req, woken, 0);
+	}
+
+	io_ring_submit_unlock(ctx, issue_flags);
+	return IOU_ISSUE_SKIP_COMPLETE;
+}
+
+int io_futex_wait(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+	struct io_ring_ctx *ctx = req->ctx;
+	struct futex_hash_bucket *hb;
+	struct futex_q *q;
+	int ret;
+
+	io_ring_submit_lock(ctx, issue_flags);
+	q = kmalloc(sizeof(*q), GFP_KERNEL);
+	if (!q) {
+		ret = -ENOMEM;
+		goto done_unlock;
+	}
+	req->flags |= REQ_F_ASYNC_DATA;
+	req->async_data = q;
+
+	*q = futex_q_init;
+	q->bitset = iof->futex_mask;
+	q->wake = io_futex_wake_fn;
+	q->wake_data = req;
+
+	ret = futex_wait_setup(iof->uaddr, iof->futex_val, iof->futex_flags,
+			       q, &hb);
+	if (!ret) {
+		hlist_add_head(&req->hash_node, &ctx->futex_list);
+		io_ring_submit_unlock(ctx, issue_flags);
+
+		futex_queue(q, hb);
+		return IOU_ISSUE_SKIP_COMPLETE;
+	}
+
+done_unlock:
+	io_ring_submit_unlock(ctx, issue_flags);
+	req_set_fail(req);
+	io_req_set_res(req, ret, 0);
+	return IOU_OK;
+}
+
+int io_futex_wake(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_futex *iof = io_kiocb_to_cmd(req);
+	int ret;
+
+	/* futex_val is the number of waiters to wake for FUTEX_WAKE */
+	ret = futex_wake(iof->uaddr, iof->futex_flags,
+			 min_t(unsigned long, iof->futex_val, INT_MAX),
+			 iof->futex_mask);
+	if (ret < 0)
+		req_set_fail(req);
+	io_req_set_res(req, ret, 0);
+	return IOU_OK;
+}
@@ -546,7 +546,49 @@ static void io_assign_current_work(struct io_worker *worker,
 
 static void io_wqe_enqueue(struct io_wqe *wqe, struct io_wq_work *work);
 
-static void io_worker_handle_work(struct io_worker *worker)
+/*
+ * Take the first pending work item from the pool of another node, if it
+ * can run right away and all workers of that node are busy. This is done
+ * by workers that ran out of local work, so queued work doesn't wait for a
+ * busy node while workers elsewhere are idle. Only unhashed work can be
+ * taken, hashed chains are tracked in the hash_tail[] of their node.
+ */
+static struct io_wq_work *io_wqe_steal_work(struct io_worker *worker)
+{
+	struct io_wqe *wqe = worker->wqe;
+	struct io_wq *wq = wqe->wq;
+	int index = io_wqe_get_acct(worker)->index;
+	int node;
+
+	for_each_node(node) {
+		struct io_wqe *other = wq->wqes[node];
+		struct io_wqe_acct *acct = &other->acct[index];
+		struct io_wq_work *work = NULL;
+
+		if (other == wqe || wq_list_empty(&acct->work_list))
+			continue;
+		if (atomic_read(&acct->nr_running) < READ_ONCE(acct->nr_workers))
+			continue;
+
+		raw_spin_lock(&acct->lock);
+		if (!wq_list_empty(&acct->work_list)) {
+			work = container_of(acct->work_list.first,
+					    struct io_wq_work, list);
+			if (!io_wq_is_hashed(work))
+				wq_list_del(&acct->work_list, &work->list, NULL);
+			else
+				work = NULL;
+		}
+		raw_spin_unlock(&acct->lock);
+		if (work)
+			return work;
+	}
+
+	return NULL;
+}
+
+static void io_worker_handle_work(struct io_worker *worker,
+				  struct io_wq_work *work)
 {
 	struct io_wqe_acct *acct = io_wqe_get_acct(worker);
 	struct io_wqe *wqe = worker->wqe;
@@ -554,8 +596,6 @@ static void io_worker_handle_work(struct io_worker *worker)
 	bool do_kill = test_bit(IO_WQ_BIT_EXIT, &wq->state);
 
 	do {
-		struct io_wq_work *work;
-
 		/*
 		 * If we got some work, mark us as busy. If we didn't, but
 		 * the list isn't empty, it means we stalled on hashed work.
@@ -563,9 +603,11 @@ static void io_worker_handle_work(struct io_worker *worker)
 		 * can't make progress, any work completion or insertion will
 		 * clear the stalled flag.
 		 */
-		raw_spin_lock(&acct->lock);
-		work = io_get_next_work(acct, worker);
-		raw_spin_unlock(&acct->lock);
+		if (!work) {
+			raw_spin_lock(&acct->lock);
+			work = io_get_next_work(acct, worker);
+			raw_spin_unlock(&acct->lock);
+		}
 		if (work) {
 			__io_worker_busy(wqe, worker);
 
@@ -637,11 +679,19 @@ static int io_wqe_worker(void *data)
 	audit_alloc_kernel(current);
 
 	while (!test_bit(IO_WQ_BIT_EXIT, &wq->state)) {
+		struct io_wq_work *work;
 		long ret;
 
 		set_current_state(TASK_INTERRUPTIBLE);
 		while (io_acct_run_queue(acct))
-			io_worker_handle_work(worker);
+			io_worker_handle_work(worker, NULL);
+
+		/* one item per pass, local work always goes first */
+		work = io_wqe_steal_work(worker);
+		if (work) {
+			io_worker_handle_work(worker, work);
+			continue;
+		}
 
 		raw_spin_lock(&wqe->lock);
 		/* timed out, exit unless we're the last worker */
@@ -668,7 +718,7 @@ static int io_wqe_worker(void *data)
 	}
 
 	if (test_bit(IO_WQ_BIT_EXIT, &wq->state))
-		io_worker_handle_work(worker);
+		io_worker_handle_work(worker, NULL);
 
 	audit_free(current);
 	io_worker_exit(worker);
@@ -92,6 +92,7 @@
 
 #include "timeout.h"
 #include "poll.h"
+#include "futex.h"
 
 #define IORING_MAX_ENTRIES	32768
 #define IORING_MAX_CQ_ENTRIES	(2 * IORING_MAX_ENTRIES)
@@ -293,6 +294,7 @@ static __cold struct io_ring_ctx *io_ring_ctx_alloc(struct io_uring_params *p)
 	ctx->flags = p->flags;
 	init_waitqueue_head(&ctx->sqo_sq_wait);
 	INIT_LIST_HEAD(&ctx->sqd_list);
+	INIT_HLIST_HEAD(&ctx->futex_list);
 	INIT_LIST_HEAD(&ctx->cq_overflow_list);
 	INIT_LIST_HEAD(&ctx->io_buffers_cache);
 	INIT_LIST_HEAD(&ctx->apoll_cache);
@@ -429,6 +431,14 @@ static void io_prep_async_link(struct io_kiocb *req)
 	}
 }
 
+#define io_op_stat_inc(req, field)					\
+do {									\
+	struct io_op_stats *__stats = READ_ONCE((req)->ctx->op_stats);	\
+									\
+	if (unlikely(__stats))						\
+		atomic_long_inc(&__stats[(req)->opcode].field);		\
+} while (0)
+
 void io_queue_iowq(struct io_kiocb *req, bool *dont_use)
 {
 	struct io_kiocb *link = io_prep_linked_timeout(req);
@@ -451,6 +461,7 @@ void io_queue_iowq(struct io_kiocb *req, bool *dont_use)
 		req->work.flags |= IO_WQ_WORK_CANCEL;
 
 	trace_io_uring_queue_async_work(req, io_wq_is_hashed(&req->work));
+	io_op_stat_inc(req, punted_iowq);
 	io_wq_enqueue(tctx->io_wq, &req->work);
 	if (link)
 		io_queue_linked_timeout(link);
@@ -735,8 +746,8 @@ struct io_uring_cqe *__io_get_cqe(struct io_ring_ctx *ctx)
 	return &rings->cqes[off];
 }
 
-static bool io_fill_cqe_aux(struct io_ring_ctx *ctx,
-			    u64 user_data, s32 res, u32 cflags)
+bool io_fill_cqe_aux(struct io_ring_ctx *ctx, u64 user_data, s32 res,
+		     u32 cflags)
 {
 	struct io_uring_cqe *cqe;
 
@@ -829,7 +840,7 @@ inline void __io_req_complete(struct io_kiocb *req, unsigned issue_flags)
 void io_req_complete_failed(struct io_kiocb *req, s32 res)
 {
 	req_set_fail(req);
-	io_req_set_res(req, res, io_put_kbuf(req, IO_URING_F_UNLOCKED));
+	io_req_set_res(req, res, io_put_kbuf(req, res, IO_URING_F_UNLOCKED));
 	io_req_complete_post(req);
 }
 
@@ -1376,7 +1387,7 @@ void io_req_task_complete(struct io_kiocb *req, bool *locked)
 	if (req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)) {
 		unsigned issue_flags = *locked ? 0 : IO_URING_F_UNLOCKED;
 
-		req->cqe.flags |= io_put_kbuf(req, issue_flags);
+		req->cqe.flags |= io_put_kbuf(req, req->cqe.res, issue_flags);
 	}
 
 	if (*locked)
@@ -1788,6 +1799,7 @@ static void io_queue_async(struct io_kiocb *req, int ret)
 		return;
 	}
 
+	io_op_stat_inc(req, eagain);
 	linked_timeout = io_prep_linked_timeout(req);
 
 	switch (io_arm_poll_handler(req, 0)) {
@@ -1803,6 +1815,7 @@ static void io_queue_async(struct io_kiocb *req, int ret)
 		io_queue_iowq(req, NULL);
 		break;
 	case IO_APOLL_OK:
+		io_op_stat_inc(req, poll_armed);
 		break;
 	}
 
@@ -1821,10 +1834,12 @@ static inline void io_queue_sqe(struct io_kiocb *req)
 	 * We async punt it if the file wasn't marked NOWAIT, or if the file
 	 * doesn't support non-blocking read/write attempts
 	 */
-	if (likely(!ret))
+	if (likely(!ret)) {
+		io_op_stat_inc(req, issued_inline);
 		io_arm_ltimeout(req);
-	else
+	} else {
 		io_queue_async(req, ret);
+	}
 }
 
 static void io_queue_sqe_fallback(struct io_kiocb *req)
@@ -2553,6 +2568,7 @@ static __cold void io_ring_ctx_free(struct io_ring_ctx *ctx)
 	kfree(ctx->cancel_table_locked.hbs);
 	kfree(ctx->dummy_ubuf);
 	kfree(ctx->io_bl);
+	kfree(ctx->op_stats);
 	xa_destroy(&ctx->io_bl_xa);
 	kfree(ctx);
 }
@@ -2714,8 +2730,10 @@ static __cold void io_ring_ctx_wait_and_kill(struct io_ring_ctx *ctx)
 		__io_cqring_overflow_flush(ctx, true);
 	xa_for_each(&ctx->personalities, index, creds)
 		io_unregister_personality(ctx, index);
-	if (ctx->rings)
+	if (ctx->rings) {
 		io_poll_remove_all(ctx, NULL, true);
+		io_futex_remove_all(ctx, NULL, true);
+	}
 	mutex_unlock(&ctx->uring_lock);
 
 	/* failed during ring init, it couldn't have issued any requests */
@@ -2845,6 +2863,7 @@ static __cold bool io_uring_try_cancel_requests(struct io_ring_ctx *ctx,
 	ret |= io_cancel_defer_files(ctx, task, cancel_all);
 	mutex_lock(&ctx->uring_lock);
 	ret |= io_poll_remove_all(ctx, task, cancel_all);
+	ret |= io_futex_remove_all(ctx, task, cancel_all);
 	mutex_unlock(&ctx->uring_lock);
 	ret |= io_kill_timeouts(ctx, task, cancel_all);
 	if (task)
@@ -3764,6 +3783,34 @@ static __cold int io_register_iowq_max_workers(struct io_ring_ctx *ctx,
 	return ret;
 }
 
+/*
+ * Counters are allocated on first use and stay around until the ring goes
+ * away, they can be bumped outside of ->uring_lock. Registering again
+ * resets them.
+ */
+static __cold int io_register_op_stats(struct io_ring_ctx *ctx)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_op_stats *stats = ctx->op_stats;
+	int i;
+
+	if (!stats) {
+		stats = kcalloc(IORING_OP_LAST, sizeof(*stats), GFP_KERNEL);
+		if (!stats)
+			return -ENOMEM;
+		smp_store_release(&ctx->op_stats, stats);
+		return 0;
+	}
+
+	for (i = 0; i < IORING_OP_LAST; i++) {
+		atomic_long_set(&stats[i].issued_inline, 0);
+		atomic_long_set(&stats[i].punted_iowq, 0);
+		atomic_long_set(&stats[i].poll_armed, 0);
+		atomic_long_set(&stats[i].eagain, 0);
+	}
+	return 0;
+}
+
 static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			       void __user *arg, unsigned nr_args)
 	__releases(ctx->uring_lock)
@@ -3916,6 +3963,18 @@ static int __io_uring_register(struct io_ring_ctx *ctx, unsigned opcode,
 			break;
 		ret = io_sync_cancel(ctx, arg);
 		break;
+	case IORING_REGISTER_SQPOLL_TUNE:
+		ret = -EINVAL;
+		if (!arg || nr_args != 1)
+			break;
+		ret = io_sqpoll_tune(ctx, arg);
+		break;
+	case IORING_REGISTER_OP_STATS:
+		ret = -EINVAL;
+		if (arg || nr_args)
+			break;
+		ret = io_register_op_stats(ctx);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
@@ -89,7 +89,8 @@ static int io_buffer_add_list(struct io_ring_ctx *ctx,
 	return xa_err(xa_store(&ctx->io_bl_xa, bgid, bl, GFP_KERNEL));
 }
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len,
+			   unsigned issue_flags)
 {
 	unsigned int cflags;
 
@@ -107,17 +108,18 @@ unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags)
 	 */
 	if (req->flags & REQ_F_BUFFER_RING) {
 		/* no buffers to recycle for this case */
-		cflags = __io_put_kbuf_list(req, NULL);
+		cflags = __io_put_kbuf_list(req, len, NULL);
 	} else if (issue_flags & IO_URING_F_UNLOCKED) {
 		struct io_ring_ctx *ctx = req->ctx;
 
 		spin_lock(&ctx->completion_lock);
-		cflags = __io_put_kbuf_list(req, &ctx->io_buffers_comp);
+		cflags = __io_put_kbuf_list(req, len, &ctx->io_buffers_comp);
 		spin_unlock(&ctx->completion_lock);
 	} else {
 		lockdep_assert_held(&req->ctx->uring_lock);
 
-		cflags = __io_put_kbuf_list(req, &req->ctx->io_buffers_cache);
+		cflags = __io_put_kbuf_list(req, len,
+					    &req->ctx->io_buffers_cache);
 	}
 	return cflags;
 }
@@ -140,28 +142,58 @@ static void __user *io_provided_buffer_select(struct io_kiocb *req, size_t *len,
 	return NULL;
 }
 
+static struct io_uring_buf *io_ring_head_to_buf(struct io_buffer_list *bl,
+						__u16 head)
+{
+	struct io_uring_buf *buf;
+
+	head &= bl->mask;
+	if (head < IO_BUFFER_LIST_BUF_PER_PAGE)
+		return &bl->buf_ring->bufs[head];
+
+	buf = page_address(bl->buf_pages[head / IO_BUFFER_LIST_BUF_PER_PAGE]);
+	return buf + (head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1));
+}
+
+/*
+ * For rings registered with IOU_PBUF_RING_INC, only consume as much of the
+ * head buffer as was transferred and leave the rest of it for the next
+ * request. The remaining range is written back to the ring entry, where the
+ * application can see it too.
+ */
+bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len)
+{
+	struct io_uring_buf *buf = io_ring_head_to_buf(bl, bl->head);
+	__u32 buf_len = READ_ONCE(buf->len);
+
+	/* nothing was transferred, the buffer stays at the head */
+	if (len <= 0)
+		return false;
+
+	if (len < buf_len) {
+		WRITE_ONCE(buf->addr, READ_ONCE(buf->addr) + len);
+		WRITE_ONCE(buf->len, buf_len - len);
+		return false;
+	}
+	bl->head++;
+	return true;
+}
+
 static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 					  struct io_buffer_list *bl,
 					  unsigned int issue_flags)
 {
 	struct io_uring_buf_ring *br = bl->buf_ring;
 	struct io_uring_buf *buf;
-	__u16 head = bl->head;
+	__u32 buf_len;
 
-	if (unlikely(smp_load_acquire(&br->tail) == head))
+	if (unlikely(smp_load_acquire(&br->tail) == bl->head))
 		return NULL;
 
-	head &= bl->mask;
-	if (head < IO_BUFFER_LIST_BUF_PER_PAGE) {
-		buf = &br->bufs[head];
-	} else {
-		int off = head & (IO_BUFFER_LIST_BUF_PER_PAGE - 1);
-		int index = head / IO_BUFFER_LIST_BUF_PER_PAGE;
-		buf = page_address(bl->buf_pages[index]);
-		buf += off;
-	}
-	if (*len > buf->len)
-		*len = buf->len;
+	buf = io_ring_head_to_buf(bl, bl->head);
+	buf_len = READ_ONCE(buf->len);
+	if (*len > buf_len)
+		*len = buf_len;
 	req->flags |= REQ_F_BUFFER_RING;
 	req->buf_list = bl;
 	req->buf_index = buf->bid;
@@ -176,11 +208,14 @@ static void __user *io_ring_buffer_select(struct io_kiocb *req, size_t *len,
 		 * mode. For the locked case, the caller must call commit when
 		 * the transfer completes (or if we get -EAGAIN and must poll of
 		 * retry).
+		 *
+		 * As the transfer size is not known yet, an incrementally
+		 * consumed buffer is used up as a whole as well.
 		 */
 		req->buf_list = NULL;
 		bl->head++;
 	}
-	return u64_to_user_ptr(buf->addr);
+	return u64_to_user_ptr(READ_ONCE(buf->addr));
 }
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
@@ -203,6 +238,80 @@ void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 	return ret;
 }
 
+static int io_ring_buffers_select(struct io_kiocb *req,
+				  struct io_buffer_list *bl,
+				  struct iovec *iovs, int nr_iovs,
+				  size_t max_len, unsigned int issue_flags)
+{
+	struct io_uring_buf_ring *br = bl->buf_ring;
+	struct io_uring_buf *buf;
+	__u16 nr_avail;
+	int i;
+
+	nr_avail = smp_load_acquire(&br->tail) - bl->head;
+	if (unlikely(!nr_avail))
+		return -ENOBUFS;
+
+	/*
+	 * See io_ring_buffer_select(), if the buffers have to be consumed
+	 * upfront we don't know yet how many of them the transfer will use.
+	 */
+	if (issue_flags & IO_URING_F_UNLOCKED || !file_can_poll(req->file))
+		nr_iovs = 1;
+	nr_iovs = min_t(int, nr_iovs, nr_avail);
+	if (!max_len || max_len > MAX_RW_COUNT)
+		max_len = MAX_RW_COUNT;
+
+	buf = io_ring_head_to_buf(bl, bl->head);
+	req->flags |= REQ_F_BUFFER_RING;
+	req->buf_list = bl;
+	req->buf_index = buf->bid;
+
+	i = 0;
+	do {
+		size_t len;
+
+		buf = io_ring_head_to_buf(bl, bl->head + i);
+		len = min_t(size_t, READ_ONCE(buf->len), max_len);
+		iovs[i].iov_base = u64_to_user_ptr(READ_ONCE(buf->addr));
+		iovs[i].iov_len = len;
+		max_len -= len;
+	} while (++i < nr_iovs && max_len);
+
+	if (issue_flags & IO_URING_F_UNLOCKED || !file_can_poll(req->file)) {
+		req->buf_list = NULL;
+		bl->head++;
+	}
+	return i;
+}
+
+/*
+ * Fill up to nr_iovs iovecs from consecutive buffers of a provided buffer
+ * ring, covering no more than max_len bytes (no limit if zero). Returns the
+ * number of iovecs filled. The buffers are released with io_put_kbufs().
+ */
+int io_buffers_select(struct io_kiocb *req, struct iovec *iovs, int nr_iovs,
+		      size_t max_len, unsigned int issue_flags)
+{
+	struct io_ring_ctx *ctx = req->ctx;
+	struct io_buffer_list *bl;
+	int ret = -ENOBUFS;
+
+	io_ring_submit_lock(ctx, issue_flags);
+
+	bl = io_buffer_get_list(ctx, req->buf_index);
+	if (likely(bl)) {
+		/* bundles only work with ring mapped, wholly consumed buffers */
+		if (bl->buf_nr_pages && !(bl->flags & IOU_PBUF_RING_INC))
+			ret = io_ring_buffers_select(req, bl, iovs, nr_iovs,
+						     max_len, issue_flags);
+		else
+			ret = -EINVAL;
+	}
+	io_ring_submit_unlock(ctx, issue_flags);
+	return ret;
+}
+
 static __cold int io_init_bl_list(struct io_ring_ctx *ctx)
 {
 	int i;
@@ -493,7 +602,9 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	if (copy_from_user(&reg, arg, sizeof(reg)))
 		return -EFAULT;
 
-	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+	if (reg.flags & ~IOU_PBUF_RING_INC)
+		return -EINVAL;
+	if (reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
 	if (!reg.ring_addr)
 		return -EFAULT;
@@ -537,6 +648,7 @@ int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 	bl->nr_entries = reg.ring_entries;
 	bl->buf_ring = br;
 	bl->mask = reg.ring_entries - 1;
+	bl->flags = reg.flags;
 	io_buffer_add_list(ctx, bl, reg.bgid);
 	return 0;
 }
@@ -548,7 +660,7 @@ int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg)
 
 	if (copy_from_user(&reg, arg, sizeof(reg)))
 		return -EFAULT;
-	if (reg.pad || reg.resv[0] || reg.resv[1] || reg.resv[2])
+	if (reg.flags || reg.resv[0] || reg.resv[1] || reg.resv[2])
 		return -EINVAL;
 
 	bl = io_buffer_get_list(ctx, reg.bgid);
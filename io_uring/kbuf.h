@@ -23,6 +23,8 @@ struct io_buffer_list {
 	__u16 nr_entries;
 	__u16 head;
 	__u16 mask;
+	/* IOU_PBUF_RING_* flags the ring was registered with */
+	__u16 flags;
 };
 
 struct io_buffer {
@@ -35,6 +37,8 @@ struct io_buffer {
 
 void __user *io_buffer_select(struct io_kiocb *req, size_t *len,
 			      unsigned int issue_flags);
+int io_buffers_select(struct io_kiocb *req, struct iovec *iovs, int nr_iovs,
+		      size_t max_len, unsigned int issue_flags);
 void __io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags);
 void io_destroy_buffers(struct io_ring_ctx *ctx);
 
@@ -47,7 +51,21 @@ int io_provide_buffers(struct io_kiocb *req, unsigned int issue_flags);
 int io_register_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 int io_unregister_pbuf_ring(struct io_ring_ctx *ctx, void __user *arg);
 
-unsigned int __io_put_kbuf(struct io_kiocb *req, unsigned issue_flags);
+unsigned int __io_put_kbuf(struct io_kiocb *req, int len,
+			   unsigned issue_flags);
+bool io_kbuf_inc_commit(struct io_buffer_list *bl, int len);
+
+/*
+ * Consume the head buffer of a ring after a transfer of len bytes. Returns
+ * false if the buffer is kept for further transfers.
+ */
+static inline bool io_kbuf_commit(struct io_buffer_list *bl, int len)
+{
+	if (bl->flags & IOU_PBUF_RING_INC)
+		return io_kbuf_inc_commit(bl, len);
+	bl->head++;
+	return true;
+}
 
 static inline bool io_do_buffer_select(struct io_kiocb *req)
 {
@@ -72,19 +90,22 @@ static inline void io_kbuf_recycle(struct io_kiocb *req, unsigned issue_flags)
 	__io_kbuf_recycle(req, issue_flags);
 }
 
-static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req,
+static inline unsigned int __io_put_kbuf_list(struct io_kiocb *req, int len,
 					      struct list_head *list)
 {
+	unsigned int cflags = IORING_CQE_F_BUFFER |
+			      (req->buf_index << IORING_CQE_BUFFER_SHIFT);
+
 	if (req->flags & REQ_F_BUFFER_RING) {
-		if (req->buf_list)
-			req->buf_list->head++;
+		if (req->buf_list && !io_kbuf_commit(req->buf_list, len))
+			cflags |= IORING_CQE_F_BUF_MORE;
 		req->flags &= ~REQ_F_BUFFER_RING;
 	} else {
 		list_add(&req->kbuf->list, list);
 		req->flags &= ~REQ_F_BUFFER_SELECTED;
 	}
 
-	return IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
+	return cflags;
 }
 
 static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
@@ -93,15 +114,31 @@ static inline unsigned int io_put_kbuf_comp(struct io_kiocb *req)
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf_list(req, &req->ctx->io_buffers_comp);
+	return __io_put_kbuf_list(req, req->cqe.res,
+				  &req->ctx->io_buffers_comp);
+}
+
+/*
+ * Release the nbufs ring buffers picked by io_buffers_select(), starting at
+ * the head. The CQE flags carry the buffer ID of the first one.
+ */
+static inline unsigned int io_put_kbufs(struct io_kiocb *req, int nbufs,
+					unsigned issue_flags)
+{
+	if (!(req->flags & REQ_F_BUFFER_RING))
+		return 0;
+	if (req->buf_list)
+		req->buf_list->head += nbufs;
+	req->flags &= ~REQ_F_BUFFER_RING;
+	return IORING_CQE_F_BUFFER | (req->buf_index << IORING_CQE_BUFFER_SHIFT);
 }
 
-static inline unsigned int io_put_kbuf(struct io_kiocb *req,
+static inline unsigned int io_put_kbuf(struct io_kiocb *req, int len,
 				       unsigned issue_flags)
 {
 
 	if (!(req->flags & (REQ_F_BUFFER_SELECTED|REQ_F_BUFFER_RING)))
 		return 0;
-	return __io_put_kbuf(req, issue_flags);
+	return __io_put_kbuf(req, len, issue_flags);
 }
 #endif
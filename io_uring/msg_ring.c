@@ -4,6 +4,7 @@
 #include <linux/file.h>
 #include <linux/slab.h>
 #include <linux/nospec.h>
+#include <linux/task_work.h>
 #include <linux/io_uring.h>
 
 #include <uapi/linux/io_uring.h>
@@ -15,6 +16,7 @@
 
 struct io_msg {
 	struct file			*file;
+	struct llist_node		node;
 	u64 user_data;
 	u32 len;
 	u32 cmd;
@@ -23,6 +25,78 @@ struct io_msg {
 	u32 flags;
 };
 
+static void io_msg_flush(struct io_ring_ctx *ctx)
+{
+	struct llist_node *node = llist_del_all(&ctx->msg_llist);
+	struct io_msg *msg, *tmp;
+	unsigned int nr = 0;
+
+	if (!node)
+		return;
+	node = llist_reverse_order(node);
+
+	io_cq_lock(ctx);
+	llist_for_each_entry(msg, node, node) {
+		struct io_kiocb *req = cmd_to_io_kiocb(msg);
+
+		if (!io_fill_cqe_aux(ctx, msg->user_data, msg->len, 0)) {
+			req_set_fail(req);
+			io_req_set_res(req, -EOVERFLOW, 0);
+		}
+		nr++;
+	}
+	io_cq_unlock_post(ctx);
+
+	llist_for_each_entry_safe(msg, tmp, node, node) {
+		struct io_kiocb *req = cmd_to_io_kiocb(msg);
+
+		req->io_task_work.func = io_req_task_complete;
+		io_req_task_work_add(req);
+	}
+	percpu_ref_put_many(&ctx->refs, nr);
+}
+
+static void io_msg_tw_flush(struct callback_head *cb)
+{
+	io_msg_flush(container_of(cb, struct io_ring_ctx, msg_work));
+}
+
+/*
+ * A SINGLE_ISSUER target ring gets its CQEs posted by its own submitter
+ * task: senders just add to the target's message list and, if it was empty,
+ * kick it with task_work. That keeps senders off the target's
+ * ->completion_lock and lets the target post a whole batch under one lock.
+ * The sender request is completed once its CQE has been posted, with
+ * -EOVERFLOW if the target CQ ring overflowed.
+ *
+ * Returns false if the target can't take remote CQEs, in which case the
+ * caller has to post it directly.
+ */
+static bool io_msg_post_remote(struct io_kiocb *req,
+			       struct io_ring_ctx *target_ctx)
+{
+	struct io_msg *msg = io_kiocb_to_cmd(req);
+	struct task_struct *task = READ_ONCE(target_ctx->submitter_task);
+
+	if (!(target_ctx->flags & IORING_SETUP_SINGLE_ISSUER) || !task)
+		return false;
+
+	/* the file pins target_ctx until now, and req may go away once added */
+	percpu_ref_get(&target_ctx->refs);
+	/* a fixed file is only borrowed from the file table */
+	if (!(req->flags & REQ_F_FIXED_FILE))
+		io_put_file(req->file);
+	req->file = NULL;
+	io_req_set_res(req, 0, 0);
+
+	if (llist_add(&msg->node, &target_ctx->msg_llist)) {
+		init_task_work(&target_ctx->msg_work, io_msg_tw_flush);
+		if (task_work_add(task, &target_ctx->msg_work, TWA_SIGNAL))
+			io_msg_flush(target_ctx);
+	}
+	return true;
+}
+
 static int io_msg_ring_data(struct io_kiocb *req)
 {
 	struct io_ring_ctx *target_ctx = req->file->private_data;
@@ -31,6 +105,8 @@ static int io_msg_ring_data(struct io_kiocb *req)
 	if (msg->src_fd || msg->dst_fd || msg->flags)
 		return -EINVAL;
 
+	if (io_msg_post_remote(req, target_ctx))
+		return IOU_ISSUE_SKIP_COMPLETE;
 	if (io_post_aux_cqe(target_ctx, msg->user_data, msg->len, 0))
 		return 0;
 
@@ -113,7 +189,41 @@ static int io_msg_send_fd(struct io_kiocb *req, unsigned int issue_flags)
 	 * completes with -EOVERFLOW, then the sender must ensure that a
 	 * later IORING_OP_MSG_RING delivers the message.
 	 */
-	if (!io_post_aux_cqe(target_ctx, msg->user_data, msg->len, 0))
+	if (io_msg_post_remote(req, target_ctx))
+		ret = IOU_ISSUE_SKIP_COMPLETE;
+	else if (!io_post_aux_cqe(target_ctx, msg->user_data, msg->len, 0))
+		ret = -EOVERFLOW;
+out_unlock:
+	io_double_unlock_ctx(ctx, target_ctx, issue_flags);
+	return ret;
+}
+
+/*
+ * Move registered buffer msg->src_fd of the source ring into the empty slot
+ * msg->dst_fd of the target ring. The same -EOVERFLOW caveat as for
+ * IORING_MSG_SEND_FD applies.
+ */
+static int io_msg_send_buf(struct io_kiocb *req, unsigned int issue_flags)
+{
+	struct io_ring_ctx *target_ctx = req->file->private_data;
+	struct io_msg *msg = io_kiocb_to_cmd(req);
+	struct io_ring_ctx *ctx = req->ctx;
+	int ret;
+
+	if (target_ctx == ctx)
+		return -EINVAL;
+
+	ret = io_double_lock_ctx(ctx, target_ctx, issue_flags);
+	if (unlikely(ret))
+		return ret;
+
+	ret = io_buffer_move(ctx, msg->src_fd, target_ctx, msg->dst_fd);
+	if (ret || (msg->flags & IORING_MSG_RING_CQE_SKIP))
+		goto out_unlock;
+
+	if (io_msg_post_remote(req, target_ctx))
+		ret = IOU_ISSUE_SKIP_COMPLETE;
+	else if (!io_post_aux_cqe(target_ctx, msg->user_data, msg->len, 0))
 		ret = -EOVERFLOW;
 out_unlock:
 	io_double_unlock_ctx(ctx, target_ctx, issue_flags);
@@ -155,11 +265,16 @@ int io_msg_ring(struct io_kiocb *req, unsigned int issue_flags)
 	case IORING_MSG_SEND_FD:
 		ret = io_msg_send_fd(req, issue_flags);
 		break;
+	case IORING_MSG_SEND_BUF:
+		ret = io_msg_send_buf(req, issue_flags);
+		break;
 	default:
 		ret = -EINVAL;
 		break;
 	}
 
+	if (ret == IOU_ISSUE_SKIP_COMPLETE)
+		return ret;
 done:
 	if (ret < 0)
 		req_set_fail(req);
@@ -56,10 +56,26 @@ struct io_sr_msg {
 	size_t				len;
 	size_t				done_io;
 	unsigned int			flags;
+	/* looked up on first issue, see io_sr_sock() */
+	struct socket			*sock;
 };
 
 #define IO_APOLL_MULTI_POLLED (REQ_F_APOLL_MULTISHOT | REQ_F_POLLED)
 
+/*
+ * The file of a request can't change once assigned, and fixed files aren't
+ * refcounted per request at all. Resolve the socket once and reuse it when
+ * the request is reissued after a poll wakeup or a partial transfer.
+ */
+static inline struct socket *io_sr_sock(struct io_kiocb *req)
+{
+	struct io_sr_msg *sr = io_kiocb_to_cmd(req);
+
+	if (!sr->sock)
+		sr->sock = sock_from_file(req->file);
+	return sr->sock;
+}
+
 int io_shutdown_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 {
 	struct io_shutdown *shutdown = io_kiocb_to_cmd(req);
@@ -97,6 +113,38 @@ static bool io_net_retry(struct socket *sock, int flags)
 	return sock->type == SOCK_STREAM || sock->type == SOCK_SEQPACKET;
 }
 
+static int io_sr_prep_bundle(struct io_kiocb *req)
+{
+	struct io_sr_msg *sr = io_kiocb_to_cmd(req);
+
+	if (!(sr->flags & IORING_RECVSEND_BUNDLE))
+		return 0;
+	if (req->opcode == IORING_OP_SENDMSG)
+		return -EINVAL;
+	if (!(req->flags & REQ_F_BUFFER_SELECT))
+		return -EINVAL;
+	/* a bundle can't be retried where the previous attempt stopped */
+	if (sr->msg_flags & MSG_WAITALL)
+		return -EINVAL;
+	return 0;
+}
+
+/*
+ * Number of bundle buffers that must be released for a transfer of ret
+ * bytes. Like a single provided buffer, the first one goes back to the
+ * application even if nothing was transferred.
+ */
+static int io_bundle_nbufs(struct iovec *iovs, int nr_iovs, int ret)
+{
+	int nbufs = 0;
+
+	do {
+		ret -= iovs[nbufs].iov_len;
+	} while (++nbufs < nr_iovs && ret > 0);
+
+	return nbufs;
+}
+
 static int io_setup_async_msg(struct io_kiocb *req,
 			      struct io_async_msghdr *kmsg)
 {
@@ -159,7 +207,7 @@ int io_sendmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	sr->umsg = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	sr->len = READ_ONCE(sqe->len);
 	sr->flags = READ_ONCE(sqe->addr2);
-	if (sr->flags & ~IORING_RECVSEND_POLL_FIRST)
+	if (sr->flags & ~(IORING_RECVSEND_POLL_FIRST | IORING_RECVSEND_BUNDLE))
 		return -EINVAL;
 	sr->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_NOSIGNAL;
 	if (sr->msg_flags & MSG_DONTWAIT)
@@ -170,7 +218,8 @@ int io_sendmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
 #endif
 	sr->done_io = 0;
-	return 0;
+	sr->sock = NULL;
+	return io_sr_prep_bundle(req);
 }
 
 int io_sendmsg(struct io_kiocb *req, unsigned int issue_flags)
@@ -182,7 +231,7 @@ int io_sendmsg(struct io_kiocb *req, unsigned int issue_flags)
 	int min_ret = 0;
 	int ret;
 
-	sock = sock_from_file(req->file);
+	sock = io_sr_sock(req);
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
@@ -234,10 +283,12 @@ int io_sendmsg(struct io_kiocb *req, unsigned int issue_flags)
 int io_send(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req);
+	struct iovec iovs[UIO_FASTIOV];
 	struct msghdr msg;
-	struct iovec iov;
 	struct socket *sock;
+	unsigned int cflags;
 	unsigned flags;
+	int nr_iovs = 0;
 	int min_ret = 0;
 	int ret;
 
@@ -245,13 +296,32 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 	    (sr->flags & IORING_RECVSEND_POLL_FIRST))
 		return -EAGAIN;
 
-	sock = sock_from_file(req->file);
+	sock = io_sr_sock(req);
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
-	ret = import_single_range(WRITE, sr->buf, sr->len, &iov, &msg.msg_iter);
-	if (unlikely(ret))
-		return ret;
+	if (io_do_buffer_select(req) && (sr->flags & IORING_RECVSEND_BUNDLE)) {
+		nr_iovs = io_buffers_select(req, iovs, UIO_FASTIOV, sr->len,
+					    issue_flags);
+		if (nr_iovs < 0)
+			return nr_iovs;
+		iov_iter_init(&msg.msg_iter, WRITE, iovs, nr_iovs,
+			      iov_length(iovs, nr_iovs));
+	} else {
+		if (io_do_buffer_select(req)) {
+			void __user *buf;
+
+			buf = io_buffer_select(req, &sr->len, issue_flags);
+			if (!buf)
+				return -ENOBUFS;
+			sr->buf = buf;
+		}
+
+		ret = import_single_range(WRITE, sr->buf, sr->len, &iovs[0],
+					  &msg.msg_iter);
+		if (unlikely(ret))
+			return ret;
+	}
 
 	msg.msg_name = NULL;
 	msg.msg_control = NULL;
@@ -284,7 +354,12 @@ int io_send(struct io_kiocb *req, unsigned int issue_flags)
 		ret += sr->done_io;
 	else if (sr->done_io)
 		ret = sr->done_io;
-	io_req_set_res(req, ret, 0);
+	if (nr_iovs)
+		cflags = io_put_kbufs(req, io_bundle_nbufs(iovs, nr_iovs, ret),
+				      issue_flags);
+	else
+		cflags = io_put_kbuf(req, ret, issue_flags);
+	io_req_set_res(req, ret, cflags);
 	return IOU_OK;
 }
 
@@ -397,7 +472,7 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 	sr->umsg = u64_to_user_ptr(READ_ONCE(sqe->addr));
 	sr->len = READ_ONCE(sqe->len);
 	sr->flags = READ_ONCE(sqe->addr2);
-	if (sr->flags & ~IORING_RECVSEND_POLL_FIRST)
+	if (sr->flags & ~(IORING_RECVSEND_POLL_FIRST | IORING_RECVSEND_BUNDLE))
 		return -EINVAL;
 	sr->msg_flags = READ_ONCE(sqe->msg_flags) | MSG_NOSIGNAL;
 	if (sr->msg_flags & MSG_DONTWAIT)
@@ -410,7 +485,8 @@ int io_recvmsg_prep(struct io_kiocb *req, const struct io_uring_sqe *sqe)
 		sr->msg_flags |= MSG_CMSG_COMPAT;
 #endif
 	sr->done_io = 0;
-	return 0;
+	sr->sock = NULL;
+	return io_sr_prep_bundle(req);
 }
 
 int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
@@ -421,9 +497,10 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	unsigned int cflags;
 	unsigned flags;
 	int ret, min_ret = 0;
+	int nr_iovs = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 
-	sock = sock_from_file(req->file);
+	sock = io_sr_sock(req);
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
@@ -440,7 +517,14 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 	    (sr->flags & IORING_RECVSEND_POLL_FIRST))
 		return io_setup_async_msg(req, kmsg);
 
-	if (io_do_buffer_select(req)) {
+	if (io_do_buffer_select(req) && (sr->flags & IORING_RECVSEND_BUNDLE)) {
+		nr_iovs = io_buffers_select(req, kmsg->fast_iov, UIO_FASTIOV,
+					    sr->len, issue_flags);
+		if (nr_iovs < 0)
+			return nr_iovs;
+		iov_iter_init(&kmsg->msg.msg_iter, READ, kmsg->fast_iov,
+			      nr_iovs, iov_length(kmsg->fast_iov, nr_iovs));
+	} else if (io_do_buffer_select(req)) {
 		void __user *buf;
 
 		buf = io_buffer_select(req, &sr->len, issue_flags);
@@ -483,7 +567,12 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 		ret += sr->done_io;
 	else if (sr->done_io)
 		ret = sr->done_io;
-	cflags = io_put_kbuf(req, issue_flags);
+	if (nr_iovs)
+		cflags = io_put_kbufs(req, io_bundle_nbufs(kmsg->fast_iov,
+							   nr_iovs, ret),
+				      issue_flags);
+	else
+		cflags = io_put_kbuf(req, ret, issue_flags);
 	if (kmsg->msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 	io_req_set_res(req, ret, cflags);
@@ -493,34 +582,45 @@ int io_recvmsg(struct io_kiocb *req, unsigned int issue_flags)
 int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 {
 	struct io_sr_msg *sr = io_kiocb_to_cmd(req);
+	struct iovec iovs[UIO_FASTIOV];
 	struct msghdr msg;
 	struct socket *sock;
-	struct iovec iov;
 	unsigned int cflags;
 	unsigned flags;
 	int ret, min_ret = 0;
+	int nr_iovs = 0;
 	bool force_nonblock = issue_flags & IO_URING_F_NONBLOCK;
 
 	if (!(req->flags & REQ_F_POLLED) &&
 	    (sr->flags & IORING_RECVSEND_POLL_FIRST))
 		return -EAGAIN;
 
-	sock = sock_from_file(req->file);
+	sock = io_sr_sock(req);
 	if (unlikely(!sock))
 		return -ENOTSOCK;
 
-	if (io_do_buffer_select(req)) {
-		void __user *buf;
+	if (io_do_buffer_select(req) && (sr->flags & IORING_RECVSEND_BUNDLE)) {
+		nr_iovs = io_buffers_select(req, iovs, UIO_FASTIOV, sr->len,
+					    issue_flags);
+		if (nr_iovs < 0)
+			return nr_iovs;
+		iov_iter_init(&msg.msg_iter, READ, iovs, nr_iovs,
+			      iov_length(iovs, nr_iovs));
+	} else {
+		if (io_do_buffer_select(req)) {
+			void __user *buf;
 
-		buf = io_buffer_select(req, &sr->len, issue_flags);
-		if (!buf)
-			return -ENOBUFS;
-		sr->buf = buf;
-	}
+			buf = io_buffer_select(req, &sr->len, issue_flags);
+			if (!buf)
+				return -ENOBUFS;
+			sr->buf = buf;
+		}
 
-	ret = import_single_range(READ, sr->buf, sr->len, &iov, &msg.msg_iter);
-	if (unlikely(ret))
-		goto out_free;
+		ret = import_single_range(READ, sr->buf, sr->len, &iovs[0],
+					  &msg.msg_iter);
+		if (unlikely(ret))
+			goto out_free;
+	}
 
 	msg.msg_name = NULL;
 	msg.msg_namelen = 0;
@@ -559,7 +659,11 @@ int io_recv(struct io_kiocb *req, unsigned int issue_flags)
 		ret += sr->done_io;
 	else if (sr->done_io)
 		ret = sr->done_io;
-	cflags = io_put_kbuf(req, issue_flags);
+	if (nr_iovs)
+		cflags = io_put_kbufs(req, io_bundle_nbufs(iovs, nr_iovs, ret),
+				      issue_flags);
+	else
+		cflags = io_put_kbuf(req, ret, issue_flags);
 	if (msg.msg_inq)
 		cflags |= IORING_CQE_F_SOCK_NONEMPTY;
 	io_req_set_res(req, ret, cflags);
@@ -1185,13 +1185,63 @@ struct page **io_pin_pages(unsigned long ubuf, unsigned long len, int *npages)
 	return pages;
 }
 
+/*
+ * If the buffer is backed by large folios of the same size, each one mapped
+ * in full except for the first and the last one, keep only the first page
+ * (and pin) of every folio. The buffer is then described by one bvec per
+ * folio instead of one per page, which keeps the bvec array short for huge
+ * page backed buffers. Returns the folio shift, or PAGE_SHIFT if the pages
+ * can't be coalesced.
+ */
+static unsigned int io_coalesce_buffer(struct page **pages, int *nr_pages)
+{
+	struct folio *folio = page_folio(pages[0]);
+	long nr_folio_pages = folio_nr_pages(folio);
+	unsigned int shift = folio_shift(folio);
+	long idx, first_idx;
+	int i, j, nr_folios = 1;
+
+	/* bv_len is an unsigned int */
+	if (!folio_test_large(folio) || *nr_pages == 1 || shift >= 32)
+		return PAGE_SHIFT;
+
+	first_idx = idx = folio_page_idx(folio, pages[0]);
+	for (i = 1; i < *nr_pages; i++) {
+		if (++idx == nr_folio_pages) {
+			folio = page_folio(pages[i]);
+			if (folio_nr_pages(folio) != nr_folio_pages ||
+			    folio_page_idx(folio, pages[i]) != 0)
+				return PAGE_SHIFT;
+			nr_folios++;
+			idx = 0;
+		} else if (pages[i] != folio_page(folio, idx)) {
+			return PAGE_SHIFT;
+		}
+	}
+
+	/* drop the pins of the pages we don't keep */
+	for (i = 0, j = 0; i < *nr_pages; j++) {
+		long nr = nr_folio_pages - (j ? 0 : first_idx);
+
+		nr = min_t(long, nr, *nr_pages - i);
+		pages[j] = pages[i];
+		if (nr > 1)
+			unpin_user_pages(&pages[i + 1], nr - 1);
+		i += nr;
+	}
+
+	*nr_pages = nr_folios;
+	return shift;
+}
+
 static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 				  struct io_mapped_ubuf **pimu,
 				  struct page **last_hpage)
 {
 	struct io_mapped_ubuf *imu = NULL;
 	struct page **pages = NULL;
-	unsigned long off;
+	unsigned long off, seg_off;
+	unsigned int folio_shift;
 	size_t size;
 	int ret, nr_pages, i;
 
@@ -1208,9 +1258,13 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 		goto done;
 	}
 
+	folio_shift = io_coalesce_buffer(pages, &nr_pages);
+
 	imu = kvmalloc(struct_size(imu, bvec, nr_pages), GFP_KERNEL);
-	if (!imu)
+	if (!imu) {
+		unpin_user_pages(pages, nr_pages);
 		goto done;
+	}
 
 	ret = io_buffer_account_pin(ctx, pages, nr_pages, imu, last_hpage);
 	if (ret) {
@@ -1219,21 +1273,28 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	}
 
 	off = (unsigned long) iov->iov_base & ~PAGE_MASK;
+	/* offset of the buffer start into the first folio */
+	seg_off = off;
+	if (folio_shift != PAGE_SHIFT)
+		seg_off += folio_page_idx(page_folio(pages[0]), pages[0]) <<
+			   PAGE_SHIFT;
 	size = iov->iov_len;
 	for (i = 0; i < nr_pages; i++) {
 		size_t vec_len;
 
-		vec_len = min_t(size_t, size, PAGE_SIZE - off);
+		vec_len = min_t(size_t, size, (1UL << folio_shift) - seg_off);
 		imu->bvec[i].bv_page = pages[i];
 		imu->bvec[i].bv_len = vec_len;
 		imu->bvec[i].bv_offset = off;
 		off = 0;
+		seg_off = 0;
 		size -= vec_len;
 	}
 	/* store original address for later verification */
 	imu->ubuf = (unsigned long) iov->iov_base;
 	imu->ubuf_end = imu->ubuf + iov->iov_len;
 	imu->nr_bvecs = nr_pages;
+	imu->folio_shift = folio_shift;
 	*pimu = imu;
 	ret = 0;
 done:
@@ -1243,6 +1304,67 @@ static int io_sqe_buffer_register(struct io_ring_ctx *ctx, struct iovec *iov,
 	return ret;
 }
 
+/*
+ * Move registered buffer @src_idx of @ctx into the empty slot @dst_idx of
+ * @dst. Requests in flight on @ctx may still use the buffer, so @dst gets a
+ * copy with its own pins and accounting, and the original is retired through
+ * the normal rsrc removal path. Called with both ->uring_lock's held.
+ */
+int io_buffer_move(struct io_ring_ctx *ctx, unsigned int src_idx,
+		   struct io_ring_ctx *dst, unsigned int dst_idx)
+{
+	struct io_mapped_ubuf *imu, *new;
+	unsigned int i;
+	int ret;
+
+	if (!ctx->buf_data || !dst->buf_data)
+		return -ENXIO;
+	if (src_idx >= ctx->nr_user_bufs || dst_idx >= dst->nr_user_bufs)
+		return -EINVAL;
+	src_idx = array_index_nospec(src_idx, ctx->nr_user_bufs);
+	dst_idx = array_index_nospec(dst_idx, dst->nr_user_bufs);
+
+	imu = ctx->user_bufs[src_idx];
+	if (imu == ctx->dummy_ubuf)
+		return -EFAULT;
+	if (dst->user_bufs[dst_idx] != dst->dummy_ubuf)
+		return -EBUSY;
+
+	ret = io_rsrc_node_switch_start(ctx);
+	if (ret)
+		return ret;
+	new = kvmalloc(struct_size(imu, bvec, imu->nr_bvecs), GFP_KERNEL);
+	if (!new)
+		return -ENOMEM;
+	memcpy(new, imu, struct_size(imu, bvec, imu->nr_bvecs));
+
+	for (i = 0; i < new->nr_bvecs; i++) {
+		if (!try_grab_page(new->bvec[i].bv_page, FOLL_PIN)) {
+			ret = -EOVERFLOW;
+			goto err;
+		}
+	}
+	ret = io_account_mem(dst, new->acct_pages);
+	if (ret)
+		goto err;
+
+	ret = io_queue_rsrc_removal(ctx->buf_data, src_idx, ctx->rsrc_node, imu);
+	if (ret) {
+		io_unaccount_mem(dst, new->acct_pages);
+		goto err;
+	}
+	ctx->user_bufs[src_idx] = ctx->dummy_ubuf;
+	io_rsrc_node_switch(ctx, ctx->buf_data);
+
+	dst->user_bufs[dst_idx] = new;
+	return 0;
+err:
+	while (i--)
+		unpin_user_page(new->bvec[i].bv_page);
+	kvfree(new);
+	return ret;
+}
+
 static int io_buffers_map_alloc(struct io_ring_ctx *ctx, unsigned int nr_args)
 {
 	ctx->user_bufs = kcalloc(nr_args, sizeof(*ctx->user_bufs), GFP_KERNEL);
@@ -1338,8 +1460,8 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 		 * we know that:
 		 *
 		 * 1) it's a BVEC iter, we set it up
-		 * 2) all bvecs are PAGE_SIZE in size, except potentially the
-		 *    first and last bvec
+		 * 2) all bvecs are 1 << imu->folio_shift in size, except
+		 *    potentially the first and last bvec
 		 *
 		 * So just find our index, and adjust the iterator afterwards.
 		 * If the offset is within the first bvec (or the whole first
@@ -1356,12 +1478,12 @@ int io_import_fixed(int ddir, struct iov_iter *iter,
 
 			/* skip first vec */
 			offset -= bvec->bv_len;
-			seg_skip = 1 + (offset >> PAGE_SHIFT);
+			seg_skip = 1 + (offset >> imu->folio_shift);
 
 			iter->bvec = bvec + seg_skip;
 			iter->nr_segs -= seg_skip;
 			iter->count -= bvec->bv_len + offset;
-			iter->iov_offset = offset & ~PAGE_MASK;
+			iter->iov_offset = offset & ((1UL << imu->folio_shift) - 1);
 		}
 	}
 
@@ -206,11 +206,32 @@ static bool __io_complete_rw_common(struct io_kiocb *req, long res)
 	return false;
 }
 
+static void io_req_rw_complete(struct io_kiocb *req, bool *locked)
+{
+	struct io_rw *rw = io_kiocb_to_cmd(req);
+	long res = rw->kiocb.dio_complete(rw->kiocb.private);
+
+	/* the I/O is long done, it is too late to reissue it from here */
+	if (__io_complete_rw_common(req, res)) {
+		req->flags &= ~REQ_F_REISSUE;
+		req_set_fail(req);
+	}
+	io_req_set_res(req, res, 0);
+	io_req_task_complete(req, locked);
+}
+
 static void io_complete_rw(struct kiocb *kiocb, long res)
 {
 	struct io_rw *rw = container_of(kiocb, struct io_rw, kiocb);
 	struct io_kiocb *req = cmd_to_io_kiocb(rw);
 
+	/* the filesystem handed us the rest of the completion */
+	if ((kiocb->ki_flags & IOCB_DIO_CALLER_COMP) && kiocb->dio_complete) {
+		req->io_task_work.func = io_req_rw_complete;
+		io_req_task_prio_work_add(req);
+		return;
+	}
+
 	if (__io_complete_rw_common(req, res))
 		return;
 	io_req_set_res(req, res, 0);
@@ -256,7 +277,8 @@ static int kiocb_done(struct io_kiocb *req, ssize_t ret,
 	if (ret >= 0 && (rw->kiocb.ki_complete == io_complete_rw)) {
 		if (!__io_complete_rw_common(req, ret)) {
 			io_req_set_res(req, req->cqe.res,
-				       io_put_kbuf(req, issue_flags));
+				       io_put_kbuf(req, req->cqe.res,
+						   issue_flags));
 			return IOU_OK;
 		}
 	} else {
@@ -906,6 +928,10 @@ int io_write(struct io_kiocb *req, unsigned int issue_flags)
 					SB_FREEZE_WRITE);
 	}
 	kiocb->ki_flags |= IOCB_WRITE;
+	if (!(req->ctx->flags & IORING_SETUP_IOPOLL)) {
+		kiocb->ki_flags |= IOCB_DIO_CALLER_COMP;
+		kiocb->dio_complete = NULL;
+	}
 
 	if (likely(req->file->f_op->write_iter))
 		ret2 = call_write_iter(req->file, kiocb, &s->iter);
@@ -1008,7 +1034,7 @@ int io_do_iopoll(struct io_ring_ctx *ctx, bool force_nonspin)
 		if (unlikely(req->flags & REQ_F_CQE_SKIP))
 			continue;
 
-		req->cqe.flags = io_put_kbuf(req, 0);
+		req->cqe.flags = io_put_kbuf(req, req->cqe.res, 0);
 		__io_fill_cqe_req(req->ctx, req);
 	}
 
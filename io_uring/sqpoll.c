@@ -78,10 +78,54 @@ static __cold void io_sqd_update_thread_idle(struct io_sq_data *sqd)
 {
 	struct io_ring_ctx *ctx;
 	unsigned sq_thread_idle = 0;
+	bool adaptive_idle = !list_empty(&sqd->ctx_list);
 
-	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list)
+	list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 		sq_thread_idle = max(sq_thread_idle, ctx->sq_thread_idle);
+		adaptive_idle &= ctx->sq_adaptive_idle;
+	}
 	sqd->sq_thread_idle = sq_thread_idle;
+	sqd->adaptive_idle = adaptive_idle;
+	sqd->last_submit_ns = 0;
+	sqd->avg_gap_ns = 0;
+}
+
+/*
+ * How long the thread keeps polling after the last submission. With
+ * adaptive idle, spin for twice the average gap between submissions, which
+ * catches the next one in the common case. If submissions come in slower
+ * than sq_thread_idle, spinning rarely pays off and the thread goes to
+ * sleep after a tick.
+ */
+static unsigned long io_sqd_idle(struct io_sq_data *sqd)
+{
+	unsigned long idle;
+
+	if (!sqd->adaptive_idle || !sqd->avg_gap_ns)
+		return sqd->sq_thread_idle;
+
+	idle = nsecs_to_jiffies(2 * sqd->avg_gap_ns) + 1;
+	if (idle > sqd->sq_thread_idle)
+		return 1;
+	return idle;
+}
+
+static void io_sqd_note_submit(struct io_sq_data *sqd)
+{
+	u64 now;
+
+	if (!sqd->adaptive_idle)
+		return;
+
+	/* EWMA with a weight of 1/8 for the new sample */
+	now = ktime_get_ns();
+	if (sqd->last_submit_ns) {
+		u64 gap = now - sqd->last_submit_ns;
+
+		sqd->avg_gap_ns = sqd->avg_gap_ns - (sqd->avg_gap_ns >> 3) +
+				  (gap >> 3);
+	}
+	sqd->last_submit_ns = now;
 }
 
 void io_sq_thread_finish(struct io_ring_ctx *ctx)
@@ -170,9 +214,16 @@ static int __io_sq_thread(struct io_ring_ctx *ctx, bool cap_entries)
 	int ret = 0;
 
 	to_submit = io_sqring_entries(ctx);
-	/* if we're handling multiple rings, cap submit size for fairness */
-	if (cap_entries && to_submit > IORING_SQPOLL_CAP_ENTRIES_VALUE)
-		to_submit = IORING_SQPOLL_CAP_ENTRIES_VALUE;
+	/*
+	 * If we're handling multiple rings, cap submit size for fairness.
+	 * Each ring gets as many batches per pass as its weight.
+	 */
+	if (cap_entries) {
+		unsigned int cap = IORING_SQPOLL_CAP_ENTRIES_VALUE * ctx->sq_weight;
+
+		if (to_submit > cap)
+			to_submit = cap;
+	}
 
 	if (!wq_list_empty(&ctx->iopoll_list) || to_submit) {
 		const struct cred *creds = NULL;
@@ -239,28 +290,32 @@ static int io_sq_thread(void *data)
 
 	mutex_lock(&sqd->lock);
 	while (1) {
-		bool cap_entries, sqt_spin = false;
+		bool cap_entries, sqt_spin = false, submitted = false;
 
 		if (io_sqd_events_pending(sqd) || signal_pending(current)) {
 			if (io_sqd_handle_event(sqd))
 				break;
-			timeout = jiffies + sqd->sq_thread_idle;
+			timeout = jiffies + io_sqd_idle(sqd);
 		}
 
 		cap_entries = !list_is_singular(&sqd->ctx_list);
 		list_for_each_entry(ctx, &sqd->ctx_list, sqd_list) {
 			int ret = __io_sq_thread(ctx, cap_entries);
 
+			if (ret > 0)
+				submitted = true;
 			if (!sqt_spin && (ret > 0 || !wq_list_empty(&ctx->iopoll_list)))
 				sqt_spin = true;
 		}
+		if (submitted)
+			io_sqd_note_submit(sqd);
 		if (io_run_task_work())
 			sqt_spin = true;
 
 		if (sqt_spin || !time_after(jiffies, timeout)) {
 			cond_resched();
 			if (sqt_spin)
-				timeout = jiffies + sqd->sq_thread_idle;
+				timeout = jiffies + io_sqd_idle(sqd);
 			continue;
 		}
 
@@ -300,7 +355,7 @@ static int io_sq_thread(void *data)
 		}
 
 		finish_wait(&sqd->wait, &wait);
-		timeout = jiffies + sqd->sq_thread_idle;
+		timeout = jiffies + io_sqd_idle(sqd);
 	}
 
 	io_uring_cancel_generic(true, sqd);
@@ -373,6 +428,7 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 		ctx->sq_thread_idle = msecs_to_jiffies(p->sq_thread_idle);
 		if (!ctx->sq_thread_idle)
 			ctx->sq_thread_idle = HZ;
+		ctx->sq_weight = 1;
 
 		io_sq_thread_park(sqd);
 		list_add(&ctx->sqd_list, &sqd->ctx_list);
@@ -423,3 +479,39 @@ __cold int io_sq_offload_create(struct io_ring_ctx *ctx,
 	io_sq_thread_finish(ctx);
 	return ret;
 }
+
+int io_sqpoll_tune(struct io_ring_ctx *ctx, void __user *arg)
+	__must_hold(&ctx->uring_lock)
+{
+	struct io_uring_sqpoll_tune tune;
+	struct io_sq_data *sqd = ctx->sq_data;
+
+	if (copy_from_user(&tune, arg, sizeof(tune)))
+		return -EFAULT;
+	if (tune.flags & ~IORING_SQPOLL_ADAPTIVE_IDLE)
+		return -EINVAL;
+	if (tune.weight > IORING_SQPOLL_MAX_WEIGHT)
+		return -EINVAL;
+	if (memchr_inv(tune.resv, 0, sizeof(tune.resv)))
+		return -EINVAL;
+	if (!(ctx->flags & IORING_SETUP_SQPOLL) || !sqd)
+		return -EINVAL;
+
+	/*
+	 * Observe the sqd->lock -> ctx->uring_lock ordering. Fine to drop
+	 * uring_lock here, we hold a ref to the ctx.
+	 */
+	refcount_inc(&sqd->refs);
+	mutex_unlock(&ctx->uring_lock);
+	io_sq_thread_park(sqd);
+	mutex_lock(&ctx->uring_lock);
+
+	if (tune.weight)
+		ctx->sq_weight = tune.weight;
+	ctx->sq_adaptive_idle = tune.flags & IORING_SQPOLL_ADAPTIVE_IDLE;
+	io_sqd_update_thread_idle(sqd);
+
+	io_sq_thread_unpark(sqd);
+	io_put_sq_data(sqd);
+	return 0;
+}
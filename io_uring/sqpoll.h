@@ -12,6 +12,10 @@ struct io_sq_data {
 	struct wait_queue_head	wait;
 
 	unsigned		sq_thread_idle;
+	/* adaptive idle state, see io_sqd_idle() */
+	bool			adaptive_idle;
+	u64			last_submit_ns;
+	u64			avg_gap_ns;
 	int			sq_cpu;
 	pid_t			task_pid;
 	pid_t			task_tgid;
@@ -27,3 +31,4 @@ void io_sq_thread_park(struct io_sq_data *sqd);
 void io_sq_thread_unpark(struct io_sq_data *sqd);
 void io_put_sq_data(struct io_sq_data *sqd);
 int io_sqpoll_wait_sq(struct io_ring_ctx *ctx);
+int io_sqpoll_tune(struct io_ring_ctx *ctx, void __user *arg);
@@ -141,6 +141,10 @@ struct mqueue_inode_info {
 	struct posix_msg_tree_node *node_cache;
 	struct mq_attr attr;
 
+	/* spare message buffers, see mqueue_load_msg() */
+	struct llist_head msg_cache;
+	spinlock_t msg_cache_lock;	/* serializes removal */
+
 	struct sigevent notify;
 	struct pid *notify_owner;
 	u32 notify_self_exec_id;
@@ -323,6 +327,8 @@ static struct inode *mqueue_get_inode(struct super_block *sb,
 		info->msg_tree = RB_ROOT;
 		info->msg_tree_rightmost = NULL;
 		info->node_cache = NULL;
+		init_llist_head(&info->msg_cache);
+		spin_lock_init(&info->msg_cache_lock);
 		memset(&info->attr, 0, sizeof(info->attr));
 		info->attr.mq_maxmsg = min(ipc_ns->mq_msg_max,
 					   ipc_ns->mq_msg_default);
@@ -533,6 +539,9 @@ static void mqueue_evict_inode(struct inode *inode)
 		list_del(&msg->m_list);
 		free_msg(msg);
 	}
+	llist_for_each_entry_safe(msg, nmsg, llist_del_all(&info->msg_cache),
+				  m_cache)
+		kfree(msg);
 
 	if (info->ucounts) {
 		unsigned long mq_bytes, mq_treesize;
@@ -1058,6 +1067,59 @@ static inline void pipelined_receive(struct wake_q_head *wake_q,
 	__pipelined_op(wake_q, info, sender);
 }
 
+/*
+ * Messages of queues whose mq_msgsize fits a single segment are loaded
+ * into buffers of exactly that size, which are recycled through
+ * info->msg_cache instead of being freed. Buffers are added without a
+ * lock by whoever is done with a message; only taking one out has to be
+ * serialized for llist_del_first().
+ */
+static inline bool mqueue_msg_cacheable(struct mqueue_inode_info *info)
+{
+	return info->attr.mq_msgsize <= PAGE_SIZE - sizeof(struct msg_msg);
+}
+
+static struct msg_msg *mqueue_load_msg(struct mqueue_inode_info *info,
+				       const char __user *src, size_t len)
+{
+	struct llist_node *node;
+	struct msg_msg *msg;
+	int err;
+
+	if (!mqueue_msg_cacheable(info))
+		return load_msg(src, len);
+
+	spin_lock(&info->msg_cache_lock);
+	node = llist_del_first(&info->msg_cache);
+	spin_unlock(&info->msg_cache_lock);
+
+	if (node)
+		msg = llist_entry(node, struct msg_msg, m_cache);
+	else
+		msg = alloc_msg_buf(info->attr.mq_msgsize);
+	if (!msg)
+		return ERR_PTR(-ENOMEM);
+
+	err = load_msg_buf(msg, src, len);
+	if (err) {
+		llist_add(&msg->m_cache, &info->msg_cache);
+		return ERR_PTR(err);
+	}
+	return msg;
+}
+
+static void mqueue_free_msg(struct mqueue_inode_info *info,
+			    struct msg_msg *msg)
+{
+	if (!mqueue_msg_cacheable(info)) {
+		free_msg(msg);
+		return;
+	}
+
+	release_msg_buf(msg);
+	llist_add(&msg->m_cache, &info->msg_cache);
+}
+
 static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 		size_t msg_len, unsigned int msg_prio,
 		struct timespec64 *ts)
@@ -1109,7 +1171,7 @@ static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 
 	/* First try to allocate memory, before doing anything with
 	 * existing queues. */
-	msg_ptr = load_msg(u_msg_ptr, msg_len);
+	msg_ptr = mqueue_load_msg(info, u_msg_ptr, msg_len);
 	if (IS_ERR(msg_ptr)) {
 		ret = PTR_ERR(msg_ptr);
 		goto out_fput;
@@ -1171,7 +1233,7 @@ static int do_mq_timedsend(mqd_t mqdes, const char __user *u_msg_ptr,
 	wake_up_q(&wake_q);
 out_free:
 	if (ret)
-		free_msg(msg_ptr);
+		mqueue_free_msg(info, msg_ptr);
 out_fput:
 	fdput(f);
 out:
@@ -1274,7 +1336,7 @@ static int do_mq_timedreceive(mqd_t mqdes, char __user *u_msg_ptr,
 			store_msg(u_msg_ptr, msg_ptr, msg_ptr->m_ts)) {
 			ret = -EFAULT;
 		}
-		free_msg(msg_ptr);
+		mqueue_free_msg(info, msg_ptr);
 	}
 out_fput:
 	fdput(f);
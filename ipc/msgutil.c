@@ -166,6 +166,33 @@ int store_msg(void __user *dest, struct msg_msg *msg, size_t len)
 	return 0;
 }
 
+/*
+ * Single segment buffers of a fixed size for callers that recycle them
+ * instead of allocating per message (see ipc/mqueue.c): load_msg_buf()
+ * refills one with up to @size bytes, release_msg_buf() drops what it
+ * had attached so it can be loaded again. Free them with kfree().
+ */
+struct msg_msg *alloc_msg_buf(size_t size)
+{
+	if (WARN_ON_ONCE(size > DATALEN_MSG))
+		return NULL;
+
+	return alloc_msg(size);
+}
+
+int load_msg_buf(struct msg_msg *msg, const void __user *src, size_t len)
+{
+	if (copy_from_user(msg + 1, src, len))
+		return -EFAULT;
+
+	return security_msg_msg_alloc(msg);
+}
+
+void release_msg_buf(struct msg_msg *msg)
+{
+	security_msg_msg_free(msg);
+}
+
 void free_msg(struct msg_msg *msg)
 {
 	struct msg_msgseg *seg;
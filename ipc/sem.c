@@ -469,6 +469,88 @@ static inline void sem_unlock(struct sem_array *sma, int locknum)
 	}
 }
 
+#define SEM_MULTI_LOCK	(-2)
+/* Each lock beyond the first needs its own lockdep subclass. */
+#define SEM_MULTI_LOCK_MAX	MAX_LOCKDEP_SUBCLASSES
+
+/*
+ * The semaphores touched by a multi-sop operation, sorted and without
+ * duplicates, for locking them individually instead of the whole array.
+ */
+struct sem_lockset {
+	int nr;
+	int idx[SEM_MULTI_LOCK_MAX];
+};
+
+static bool sem_lockset_init(struct sem_lockset *ls, struct sem_array *sma,
+			     struct sembuf *sops, int nsops)
+{
+	int i, j, idx;
+
+	ls->nr = 0;
+	for (i = 0; i < nsops; i++) {
+		idx = array_index_nospec(sops[i].sem_num, sma->sem_nsems);
+
+		for (j = ls->nr; j > 0 && ls->idx[j - 1] > idx; j--)
+			;
+		if (j > 0 && ls->idx[j - 1] == idx)
+			continue;
+		if (ls->nr == SEM_MULTI_LOCK_MAX)
+			return false;
+
+		memmove(&ls->idx[j + 1], &ls->idx[j],
+			(ls->nr - j) * sizeof(ls->idx[0]));
+		ls->idx[j] = idx;
+		ls->nr++;
+	}
+	return true;
+}
+
+static void sem_unlock_multi(struct sem_array *sma, struct sem_lockset *ls,
+			     int nr)
+{
+	while (nr--)
+		spin_unlock(&sma->sems[ls->idx[nr]].lock);
+}
+
+/*
+ * A multi-sop operation on a few semaphores that can complete right away
+ * does not need the global lock: with no complex operation pending or in
+ * progress (use_global_lock == 0), it only has to exclude simple ops on
+ * the semaphores it touches, exactly like a simple op does. The per
+ * semaphore locks are taken in ascending index order, complexmode_enter()
+ * takes them one at a time, so this cannot deadlock.
+ *
+ * Operations that have to sleep still go through the global lock, as the
+ * global pending queues are protected by it; see do_semtimedop().
+ */
+static bool sem_lock_multi(struct sem_array *sma, struct sem_lockset *ls)
+{
+	int i;
+
+	if (READ_ONCE(sma->use_global_lock))
+		return false;
+
+	for (i = 0; i < ls->nr; i++)
+		spin_lock_nested(&sma->sems[ls->idx[i]].lock, i);
+
+	/* see SEM_BARRIER_1 for purpose/pairing */
+	if (!smp_load_acquire(&sma->use_global_lock))
+		return true;
+
+	sem_unlock_multi(sma, ls, ls->nr);
+	return false;
+}
+
+static inline void sem_unlock_sops(struct sem_array *sma, int locknum,
+				   struct sem_lockset *ls)
+{
+	if (locknum == SEM_MULTI_LOCK)
+		sem_unlock_multi(sma, ls, ls->nr);
+	else
+		sem_unlock(sma, locknum);
+}
+
 /*
  * sem_lock_(check_) routines are called in the paths where the rwsem
  * is not held.
@@ -1992,6 +2074,7 @@ long __do_semtimedop(int semid, struct sembuf *sops,
 	struct sem_undo *un;
 	int max, locknum;
 	bool undos = false, alter = false, dupsop = false;
+	struct sem_lockset lockset;
 	struct sem_queue queue;
 	unsigned long dup = 0;
 	ktime_t expires, *exp = NULL;
@@ -2071,14 +2154,20 @@ long __do_semtimedop(int semid, struct sembuf *sops,
 		goto out;
 	}
 
+	if (nsops > 1 && sem_lockset_init(&lockset, sma, sops, nsops) &&
+	    sem_lock_multi(sma, &lockset))
+		locknum = SEM_MULTI_LOCK;
+	else
+		locknum = sem_lock(sma, sops, nsops);
+relock:
 	error = -EIDRM;
-	locknum = sem_lock(sma, sops, nsops);
 	/*
 	 * We eventually might perform the following check in a lockless
 	 * fashion, considering ipc_valid_object() locking constraints.
 	 * If nsops == 1 and there is no contention for sem_perm.lock, then
 	 * only a per-semaphore lock is held and it's OK to proceed with the
-	 * check below. More details on the fine grained locking scheme
+	 * check below. The same holds for the per-semaphore locks of
+	 * sem_lock_multi(). More details on the fine grained locking scheme
 	 * entangled here and why it's RMID race safe on comments at sem_lock()
 	 */
 	if (!ipc_valid_object(&sma->sem_perm))
@@ -2113,7 +2202,7 @@ long __do_semtimedop(int semid, struct sembuf *sops,
 		else
 			set_semotime(sma, sops);
 
-		sem_unlock(sma, locknum);
+		sem_unlock_sops(sma, locknum, &lockset);
 		rcu_read_unlock();
 		wake_up_q(&wake_q);
 
@@ -2122,6 +2211,13 @@ long __do_semtimedop(int semid, struct sembuf *sops,
 	if (error < 0) /* non-blocking error path */
 		goto out_unlock;
 
+	if (locknum == SEM_MULTI_LOCK) {
+		/* Queueing a complex operation requires the global lock. */
+		sem_unlock_multi(sma, &lockset, lockset.nr);
+		locknum = sem_lock(sma, sops, nsops);
+		goto relock;
+	}
+
 	/*
 	 * We need to sleep on this operation, so we put the current
 	 * task into the pending queue and go to sleep.
@@ -2214,7 +2310,7 @@ long __do_semtimedop(int semid, struct sembuf *sops,
 	unlink_queue(sma, &queue);
 
 out_unlock:
-	sem_unlock(sma, locknum);
+	sem_unlock_sops(sma, locknum, &lockset);
 	rcu_read_unlock();
 out:
 	return error;
@@ -200,6 +200,9 @@ extern void free_msg(struct msg_msg *msg);
 extern struct msg_msg *load_msg(const void __user *src, size_t len);
 extern struct msg_msg *copy_msg(struct msg_msg *src, struct msg_msg *dst);
 extern int store_msg(void __user *dest, struct msg_msg *msg, size_t len);
+extern struct msg_msg *alloc_msg_buf(size_t size);
+extern int load_msg_buf(struct msg_msg *msg, const void __user *src, size_t len);
+extern void release_msg_buf(struct msg_msg *msg);
 
 static inline int ipc_checkid(struct kern_ipc_perm *ipcp, int id)
 {
@@ -31,6 +31,7 @@
 
 #include <linux/netdevice.h>   /* netif_receive_skb_list */
 #include <linux/etherdevice.h> /* eth_type_trans */
+#include <net/gro.h>           /* gro_normal_list */
 
 /* General idea: XDP packets getting XDP redirected to another CPU,
  * will maximum be stored/queued for one driver ->poll() call.  It is
@@ -67,6 +68,12 @@ struct bpf_cpu_map_entry {
 	struct bpf_cpumap_val value;
 	struct bpf_prog *prog;
 
+	/* GRO context for the skbs built by the kthread. Never scheduled,
+	 * it only holds the GRO lists, hooked to a dummy netdev.
+	 */
+	struct napi_struct napi;
+	struct net_device *napi_dev;
+
 	atomic_t refcnt; /* Control when this struct can be free'ed */
 	struct rcu_head rcu;
 
@@ -166,6 +173,7 @@ static void put_cpu_map_entry(struct bpf_cpu_map_entry *rcpu)
 		__cpu_map_ring_cleanup(rcpu->queue);
 		ptr_ring_cleanup(rcpu->queue, NULL);
 		kfree(rcpu->queue);
+		kfree(rcpu->napi_dev);
 		kfree(rcpu);
 	}
 }
@@ -271,6 +279,25 @@ static int cpu_map_bpf_prog_run_xdp(struct bpf_cpu_map_entry *rcpu,
 
 #define CPUMAP_BATCH 8
 
+/* Approximate number of frames waiting in the consumer side of @r */
+static unsigned int __cpu_map_queue_len(struct ptr_ring *r)
+{
+	int len = READ_ONCE(r->producer) - r->consumer_head;
+
+	if (len < 0)
+		len += r->size;
+	else if (!len && !__ptr_ring_empty(r))
+		len = r->size;
+
+	return len;
+}
+
+static int cpu_map_napi_poll(struct napi_struct *napi, int budget)
+{
+	/* Never scheduled, see bpf_cpu_map_entry::napi */
+	return 0;
+}
+
 static int cpu_map_bpf_prog_run(struct bpf_cpu_map_entry *rcpu, void **frames,
 				int xdp_n, struct xdp_cpumap_stats *stats,
 				struct list_head *list)
@@ -309,7 +336,7 @@ static int cpu_map_kthread_run(void *data)
 	 */
 	while (!kthread_should_stop() || !__ptr_ring_empty(rcpu->queue)) {
 		struct xdp_cpumap_stats stats = {}; /* zero stats */
-		unsigned int kmem_alloc_drops = 0, sched = 0;
+		unsigned int kmem_alloc_drops = 0, sched = 0, qlen;
 		gfp_t gfp = __GFP_ZERO | GFP_ATOMIC;
 		int i, n, m, nframes, xdp_n;
 		void *frames[CPUMAP_BATCH];
@@ -337,6 +364,7 @@ static int cpu_map_kthread_run(void *data)
 		 */
 		n = __ptr_ring_consume_batched(rcpu->queue, frames,
 					       CPUMAP_BATCH);
+		qlen = __cpu_map_queue_len(rcpu->queue);
 		for (i = 0, xdp_n = 0; i < n; i++) {
 			void *f = frames[i];
 			struct page *page;
@@ -382,18 +410,29 @@ static int cpu_map_kthread_run(void *data)
 				continue;
 			}
 
-			list_add_tail(&skb->list, &list);
+			napi_gro_receive(&rcpu->napi, skb);
 		}
+		/* skbs queued by generic XDP already went through GRO */
 		netif_receive_skb_list(&list);
 
+		/* Keep aggregating across batches while more frames are
+		 * queued, only flushing what has been held for a jiffy.
+		 * The queue cannot refill from empty behind our back
+		 * without us being woken, so nothing stays held when the
+		 * kthread goes to sleep.
+		 */
+		napi_gro_flush(&rcpu->napi, qlen != 0);
+		gro_normal_list(&rcpu->napi);
+
 		/* Feedback loop via tracepoint */
 		trace_xdp_cpumap_kthread(rcpu->map_id, n, kmem_alloc_drops,
-					 sched, &stats);
+					 sched, &stats, qlen);
 
 		local_bh_enable(); /* resched point, may call do_softirq() */
 	}
 	__set_current_state(TASK_RUNNING);
 
+	netif_napi_del(&rcpu->napi);
 	put_cpu_map_entry(rcpu);
 	return 0;
 }
@@ -456,6 +495,12 @@ __cpu_map_entry_alloc(struct bpf_map *map, struct bpf_cpumap_val *value,
 	if (err)
 		goto free_queue;
 
+	rcpu->napi_dev = bpf_map_kmalloc_node(map, sizeof(*rcpu->napi_dev),
+					      gfp, numa);
+	if (!rcpu->napi_dev)
+		goto free_ptr_ring;
+	init_dummy_netdev(rcpu->napi_dev);
+
 	rcpu->cpu    = cpu;
 	rcpu->map_id = map->id;
 	rcpu->value.qsize  = value->qsize;
@@ -473,6 +518,11 @@ __cpu_map_entry_alloc(struct bpf_map *map, struct bpf_cpumap_val *value,
 	get_cpu_map_entry(rcpu); /* 1-refcnt for being in cmap->cpu_map[] */
 	get_cpu_map_entry(rcpu); /* 1-refcnt for kthread */
 
+	/* Not a real NAPI instance, keep it away from busy polling */
+	set_bit(NAPI_STATE_NO_BUSY_POLL, &rcpu->napi.state);
+	netif_napi_add_weight(rcpu->napi_dev, &rcpu->napi, cpu_map_napi_poll,
+			      CPUMAP_BATCH);
+
 	/* Make sure kthread runs on a single CPU */
 	kthread_bind(rcpu->kthread, cpu);
 	wake_up_process(rcpu->kthread);
@@ -483,6 +533,7 @@ __cpu_map_entry_alloc(struct bpf_map *map, struct bpf_cpumap_val *value,
 	if (rcpu->prog)
 		bpf_prog_put(rcpu->prog);
 free_ptr_ring:
+	kfree(rcpu->napi_dev);
 	ptr_ring_cleanup(rcpu->queue, NULL);
 free_queue:
 	kfree(rcpu->queue);
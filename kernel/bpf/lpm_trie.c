@@ -29,9 +29,20 @@ struct lpm_trie_node {
 	u8				data[];
 };
 
+/* Where the lookup of keys sharing the same leading stride_bits bits
+ * continues: @start is the first node on their path with a prefix of at
+ * least stride_bits, @best the last real node matched before it.
+ */
+struct lpm_trie_stride {
+	struct lpm_trie_node __rcu	*start;
+	struct lpm_trie_node __rcu	*best;
+};
+
 struct lpm_trie {
 	struct bpf_map			map;
 	struct lpm_trie_node __rcu	*root;
+	struct lpm_trie_stride		*stride_tbl;
+	u32				stride_bits;
 	size_t				n_entries;
 	size_t				max_prefixlen;
 	size_t				data_size;
@@ -147,6 +158,14 @@ struct lpm_trie {
  * is a child that can be used to become more specific, the trie is traversed
  * downwards. The last node in the traversal that is a non-intermediate one is
  * returned.
+ *
+ * If map_extra was set at map creation, the first map_extra (stride_bits)
+ * levels of that traversal are precomputed: stride_tbl has an entry for each
+ * value of the leading stride_bits key bits, recording the node the walk
+ * reaches first with a prefix of at least stride_bits and the best match
+ * seen on the way there. Lookups with a long enough prefix start from that
+ * entry instead of the root. Entries are recomputed under trie->lock for the
+ * key range below the slot an update or delete rewrote.
  */
 
 static inline int extract_bit(const u8 *data, size_t index)
@@ -154,6 +173,60 @@ static inline int extract_bit(const u8 *data, size_t index)
 	return !!(data[index / 8] & (1 << (7 - (index % 8))));
 }
 
+/* Leading stride_bits bits of @data */
+static u32 trie_stride_index(const struct lpm_trie *trie, const u8 *data)
+{
+	u32 nbytes = DIV_ROUND_UP(trie->stride_bits, 8);
+	u32 i, idx = 0;
+
+	for (i = 0; i < nbytes; i++)
+		idx = (idx << 8) | data[i];
+
+	return idx >> (nbytes * 8 - trie->stride_bits);
+}
+
+/* Recompute the stride table entries of all keys sharing the first @bits
+ * bits with @data.
+ */
+static void trie_stride_update(struct lpm_trie *trie, const u8 *data, u32 bits)
+{
+	u32 stride = trie->stride_bits;
+	u32 idx, first, last;
+
+	if (!trie->stride_tbl)
+		return;
+
+	bits = min(bits, stride);
+	first = trie_stride_index(trie, data) >> (stride - bits) << (stride - bits);
+	last = first + (1U << (stride - bits));
+
+	for (idx = first; idx < last; idx++) {
+		struct lpm_trie_node *node, *best = NULL;
+
+		node = rcu_dereference_protected(trie->root,
+						 lockdep_is_held(&trie->lock));
+		while (node && node->prefixlen < stride) {
+			u32 pl = node->prefixlen;
+
+			if ((trie_stride_index(trie, node->data) ^ idx) >>
+			    (stride - pl)) {
+				node = NULL;
+				break;
+			}
+
+			if (!(node->flags & LPM_TREE_NODE_FLAG_IM))
+				best = node;
+
+			node = rcu_dereference_protected(
+				node->child[(idx >> (stride - 1 - pl)) & 1],
+				lockdep_is_held(&trie->lock));
+		}
+
+		rcu_assign_pointer(trie->stride_tbl[idx].start, node);
+		rcu_assign_pointer(trie->stride_tbl[idx].best, best);
+	}
+}
+
 /**
  * longest_prefix_match() - determine the longest prefix
  * @trie:	The trie to get internal sizes from
@@ -231,10 +304,20 @@ static void *trie_lookup_elem(struct bpf_map *map, void *_key)
 	struct lpm_trie_node *node, *found = NULL;
 	struct bpf_lpm_trie_key *key = _key;
 
-	/* Start walking the trie from the root node ... */
+	/* Start walking the trie from the root node, or from where the
+	 * stride table entry for the leading key bits says the walk goes.
+	 */
+	if (trie->stride_tbl && key->prefixlen >= trie->stride_bits) {
+		struct lpm_trie_stride *ent;
 
-	for (node = rcu_dereference_check(trie->root, rcu_read_lock_bh_held());
-	     node;) {
+		ent = &trie->stride_tbl[trie_stride_index(trie, key->data)];
+		found = rcu_dereference_check(ent->best, rcu_read_lock_bh_held());
+		node = rcu_dereference_check(ent->start, rcu_read_lock_bh_held());
+	} else {
+		node = rcu_dereference_check(trie->root, rcu_read_lock_bh_held());
+	}
+
+	for (; node;) {
 		unsigned int next_bit;
 		size_t matchlen;
 
@@ -310,6 +393,7 @@ static int trie_update_elem(struct bpf_map *map,
 	unsigned long irq_flags;
 	unsigned int next_bit;
 	size_t matchlen = 0;
+	u32 slot_bits = 0;
 	int ret = 0;
 
 	if (unlikely(flags > BPF_EXIST))
@@ -358,6 +442,7 @@ static int trie_update_elem(struct bpf_map *map,
 
 		next_bit = extract_bit(key->data, node->prefixlen);
 		slot = &node->child[next_bit];
+		slot_bits = node->prefixlen + 1;
 	}
 
 	/* If the slot is empty (a free child pointer or an empty root),
@@ -423,6 +508,9 @@ static int trie_update_elem(struct bpf_map *map,
 
 		kfree(new_node);
 		kfree(im_node);
+	} else {
+		/* only keys whose walk passes through *slot are affected */
+		trie_stride_update(trie, key->data, slot_bits);
 	}
 
 	spin_unlock_irqrestore(&trie->lock, irq_flags);
@@ -437,6 +525,7 @@ static int trie_delete_elem(struct bpf_map *map, void *_key)
 	struct bpf_lpm_trie_key *key = _key;
 	struct lpm_trie_node __rcu **trim, **trim2;
 	struct lpm_trie_node *node, *parent;
+	u32 trim_bits = 0, trim2_bits = 0;
 	unsigned long irq_flags;
 	unsigned int next_bit;
 	size_t matchlen = 0;
@@ -466,8 +555,10 @@ static int trie_delete_elem(struct bpf_map *map, void *_key)
 
 		parent = node;
 		trim2 = trim;
+		trim2_bits = trim_bits;
 		next_bit = extract_bit(key->data, node->prefixlen);
 		trim = &node->child[next_bit];
+		trim_bits = node->prefixlen + 1;
 	}
 
 	if (!node || node->prefixlen != key->prefixlen ||
@@ -505,6 +596,7 @@ static int trie_delete_elem(struct bpf_map *map, void *_key)
 				*trim2, rcu_access_pointer(parent->child[0]));
 		kfree_rcu(parent, rcu);
 		kfree_rcu(node, rcu);
+		trim_bits = trim2_bits;
 		goto out;
 	}
 
@@ -521,6 +613,12 @@ static int trie_delete_elem(struct bpf_map *map, void *_key)
 	kfree_rcu(node, rcu);
 
 out:
+	/* only keys whose walk passes through the rewritten slot (or the
+	 * node now marked intermediate) are affected
+	 */
+	if (!ret)
+		trie_stride_update(trie, key->data, trim_bits);
+
 	spin_unlock_irqrestore(&trie->lock, irq_flags);
 
 	return ret;
@@ -540,6 +638,9 @@ static int trie_delete_elem(struct bpf_map *map, void *_key)
 #define LPM_CREATE_FLAG_MASK	(BPF_F_NO_PREALLOC | BPF_F_NUMA_NODE |	\
 				 BPF_F_ACCESS_MASK)
 
+/* stride table of 2^16 entries at most */
+#define LPM_STRIDE_BITS_MAX	16
+
 static struct bpf_map *trie_alloc(union bpf_attr *attr)
 {
 	struct lpm_trie *trie;
@@ -555,7 +656,10 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 	    attr->key_size < LPM_KEY_SIZE_MIN ||
 	    attr->key_size > LPM_KEY_SIZE_MAX ||
 	    attr->value_size < LPM_VAL_SIZE_MIN ||
-	    attr->value_size > LPM_VAL_SIZE_MAX)
+	    attr->value_size > LPM_VAL_SIZE_MAX ||
+	    attr->map_extra > LPM_STRIDE_BITS_MAX ||
+	    attr->map_extra > (attr->key_size -
+			       offsetof(struct bpf_lpm_trie_key, data)) * 8)
 		return ERR_PTR(-EINVAL);
 
 	trie = kzalloc(sizeof(*trie), GFP_USER | __GFP_NOWARN | __GFP_ACCOUNT);
@@ -568,6 +672,17 @@ static struct bpf_map *trie_alloc(union bpf_attr *attr)
 			  offsetof(struct bpf_lpm_trie_key, data);
 	trie->max_prefixlen = trie->data_size * 8;
 
+	trie->stride_bits = attr->map_extra;
+	if (trie->stride_bits) {
+		trie->stride_tbl = bpf_map_area_alloc(sizeof(*trie->stride_tbl) <<
+						      trie->stride_bits,
+						      trie->map.numa_node);
+		if (!trie->stride_tbl) {
+			kfree(trie);
+			return ERR_PTR(-ENOMEM);
+		}
+	}
+
 	spin_lock_init(&trie->lock);
 
 	return &trie->map;
@@ -609,6 +724,7 @@ static void trie_free(struct bpf_map *map)
 	}
 
 out:
+	bpf_map_area_free(trie->stride_tbl);
 	kfree(trie);
 }
 
@@ -0,0 +1,489 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* Resizable BPF hash map built on top of rhashtable.
+ *
+ * Unlike BPF_MAP_TYPE_HASH the number of buckets is not fixed at map
+ * creation time. The bucket table starts small and is grown (and shrunk)
+ * by the rhashtable deferred worker as elements come and go, so a map only
+ * needs max_entries to be the element limit and not a sizing hint.
+ *
+ * Lookups are lockless RCU walks of the bucket chain and may be done from
+ * any context, NMI included. Updates and deletes take the rhashtable bucket
+ * bit lock, which disables bottom halves, so they are refused with -EBUSY
+ * when interrupts are disabled (hardirq, NMI and irqs-off tracing) or when
+ * the map is already being updated on this CPU.
+ *
+ * Unless BPF_F_NO_PREALLOC is given, elements come from a preallocated
+ * pool and are recycled immediately on delete, like preallocated hash map
+ * elements are. Readers walking a recycled element detect the move to a
+ * different chain through the rhashtable nulls marker and restart.
+ */
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/rhashtable.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include "percpu_freelist.h"
+
+#define RHTAB_CREATE_FLAG_MASK						\
+	(BPF_F_NO_PREALLOC | BPF_F_NUMA_NODE | BPF_F_ACCESS_MASK)
+
+struct bpf_rhtab {
+	struct bpf_map map;
+	struct rhashtable ht;
+	struct rhashtable_params params;
+	void *elems;
+	struct pcpu_freelist freelist;
+	atomic_t count;	/* number of elements in this hashtable */
+	u32 elem_size;	/* size of each element in bytes */
+	int __percpu *map_locked;
+};
+
+/* each rhtab element is struct rhtab_elem + key + value */
+struct rhtab_elem {
+	/* node.next is kept intact while the element sits on the freelist
+	 * so that a lockless reader still walking it reaches a nulls marker.
+	 */
+	struct rhash_head node;
+	union {
+		struct pcpu_freelist_node fnode;
+		struct {
+			struct rcu_head rcu;
+			/* map to return a prealloc element to */
+			struct bpf_rhtab *rhtab;
+		};
+	};
+	char key[] __aligned(8);
+};
+
+static inline bool rhtab_is_prealloc(const struct bpf_rhtab *rhtab)
+{
+	return !(rhtab->map.map_flags & BPF_F_NO_PREALLOC);
+}
+
+static inline void *rhtab_elem_value(const struct bpf_rhtab *rhtab,
+				     struct rhtab_elem *l)
+{
+	return l->key + round_up(rhtab->map.key_size, 8);
+}
+
+static inline int rhtab_lock(struct bpf_rhtab *rhtab)
+{
+	/* rhashtable bucket locks use local_bh_disable() */
+	if (unlikely(irqs_disabled()))
+		return -EBUSY;
+
+	migrate_disable();
+	if (unlikely(__this_cpu_inc_return(*rhtab->map_locked) != 1)) {
+		__this_cpu_dec(*rhtab->map_locked);
+		migrate_enable();
+		return -EBUSY;
+	}
+
+	return 0;
+}
+
+static inline void rhtab_unlock(struct bpf_rhtab *rhtab)
+{
+	__this_cpu_dec(*rhtab->map_locked);
+	migrate_enable();
+}
+
+static struct rhtab_elem *rhtab_alloc_elem(struct bpf_rhtab *rhtab,
+					   void *key, void *value)
+{
+	struct pcpu_freelist_node *fnode;
+	struct rhtab_elem *l;
+
+	if (rhtab_is_prealloc(rhtab)) {
+		fnode = pcpu_freelist_pop(&rhtab->freelist);
+		if (!fnode)
+			return NULL;
+		l = container_of(fnode, struct rhtab_elem, fnode);
+	} else {
+		l = bpf_map_kmalloc_node(&rhtab->map, rhtab->elem_size,
+					 GFP_ATOMIC | __GFP_NOWARN,
+					 rhtab->map.numa_node);
+		if (!l)
+			return NULL;
+	}
+
+	memcpy(l->key, key, rhtab->map.key_size);
+	copy_map_value(&rhtab->map, rhtab_elem_value(rhtab, l), value);
+	return l;
+}
+
+static void rhtab_free_elem_rcu(struct rcu_head *head)
+{
+	struct rhtab_elem *l = container_of(head, struct rhtab_elem, rcu);
+
+	pcpu_freelist_push(&l->rhtab->freelist, &l->fnode);
+}
+
+/* Update and delete look the element up locklessly and hand the pointer to
+ * rhashtable_replace_fast() and rhashtable_remove_fast(), which match by
+ * pointer only. A prealloc element is therefore only reused after a grace
+ * period, so that it can't be holding another key by the time they run.
+ */
+static void rhtab_free_elem(struct bpf_rhtab *rhtab, struct rhtab_elem *l)
+{
+	if (rhtab_is_prealloc(rhtab)) {
+		l->rhtab = rhtab;
+		call_rcu(&l->rcu, rhtab_free_elem_rcu);
+	} else {
+		kfree_rcu(l, rcu);
+	}
+}
+
+/* Called from syscall */
+static int rhtab_map_alloc_check(union bpf_attr *attr)
+{
+	if (attr->map_flags & ~RHTAB_CREATE_FLAG_MASK ||
+	    !bpf_map_flags_access_ok(attr->map_flags))
+		return -EINVAL;
+
+	if (attr->max_entries == 0 || attr->key_size == 0 ||
+	    attr->value_size == 0)
+		return -EINVAL;
+
+	/* rhashtable keys are limited to U16_MAX bytes and its table size
+	 * to a power of two that fits an unsigned int.
+	 */
+	if (attr->key_size > U16_MAX || attr->max_entries > 1U << 31)
+		return -E2BIG;
+
+	if ((u64)attr->key_size + attr->value_size >= KMALLOC_MAX_SIZE -
+	    sizeof(struct rhtab_elem))
+		return -E2BIG;
+
+	return 0;
+}
+
+static int rhtab_prealloc_init(struct bpf_rhtab *rhtab)
+{
+	/* each CPU may hold one extra element while replacing a value */
+	u32 num_entries = rhtab->map.max_entries + num_possible_cpus();
+	int err;
+
+	rhtab->elems = bpf_map_area_alloc((u64)rhtab->elem_size * num_entries,
+					  rhtab->map.numa_node);
+	if (!rhtab->elems)
+		return -ENOMEM;
+
+	err = pcpu_freelist_init(&rhtab->freelist);
+	if (err) {
+		bpf_map_area_free(rhtab->elems);
+		return err;
+	}
+
+	pcpu_freelist_populate(&rhtab->freelist,
+			       rhtab->elems + offsetof(struct rhtab_elem, fnode),
+			       rhtab->elem_size, num_entries);
+	return 0;
+}
+
+static void rhtab_prealloc_destroy(struct bpf_rhtab *rhtab)
+{
+	pcpu_freelist_destroy(&rhtab->freelist);
+	bpf_map_area_free(rhtab->elems);
+}
+
+static struct bpf_map *rhtab_map_alloc(union bpf_attr *attr)
+{
+	struct bpf_rhtab *rhtab;
+	int err;
+
+	rhtab = kzalloc(sizeof(*rhtab), GFP_USER | __GFP_ACCOUNT);
+	if (!rhtab)
+		return ERR_PTR(-ENOMEM);
+
+	bpf_map_init_from_attr(&rhtab->map, attr);
+
+	rhtab->elem_size = sizeof(struct rhtab_elem) +
+			   round_up(rhtab->map.key_size, 8) +
+			   round_up(rhtab->map.value_size, 8);
+
+	rhtab->params.key_len = rhtab->map.key_size;
+	rhtab->params.key_offset = offsetof(struct rhtab_elem, key);
+	rhtab->params.head_offset = offsetof(struct rhtab_elem, node);
+	rhtab->params.max_size = roundup_pow_of_two(rhtab->map.max_entries);
+	rhtab->params.automatic_shrinking = true;
+
+	err = -ENOMEM;
+	rhtab->map_locked = bpf_map_alloc_percpu(&rhtab->map, sizeof(int),
+						 sizeof(int), GFP_USER);
+	if (!rhtab->map_locked)
+		goto free_rhtab;
+
+	err = rhashtable_init(&rhtab->ht, &rhtab->params);
+	if (err)
+		goto free_map_locked;
+
+	if (rhtab_is_prealloc(rhtab)) {
+		err = rhtab_prealloc_init(rhtab);
+		if (err)
+			goto free_ht;
+	}
+
+	return &rhtab->map;
+
+free_ht:
+	rhashtable_destroy(&rhtab->ht);
+free_map_locked:
+	free_percpu(rhtab->map_locked);
+free_rhtab:
+	kfree(rhtab);
+	return ERR_PTR(err);
+}
+
+static void rhtab_free_elem_cb(void *ptr, void *arg)
+{
+	kfree(ptr);
+}
+
+/* Called when map->refcnt goes to zero, either from workqueue or from syscall */
+static void rhtab_map_free(struct bpf_map *map)
+{
+	struct bpf_rhtab *rhtab = container_of(map, struct bpf_rhtab, map);
+
+	/* No BPF program uses the map anymore and the syscall side is gone,
+	 * so the elements can be released without waiting for readers.
+	 */
+	if (rhtab_is_prealloc(rhtab)) {
+		rhashtable_destroy(&rhtab->ht);
+		/* wait for elements still on their way back to the freelist */
+		rcu_barrier();
+		rhtab_prealloc_destroy(rhtab);
+	} else {
+		rhashtable_free_and_destroy(&rhtab->ht, rhtab_free_elem_cb,
+					    NULL);
+	}
+
+	free_percpu(rhtab->map_locked);
+	kfree(rhtab);
+}
+
+/* Called from syscall or from eBPF program */
+static void *rhtab_map_lookup_elem(struct bpf_map *map, void *key)
+{
+	struct bpf_rhtab *rhtab = container_of(map, struct bpf_rhtab, map);
+	struct rhtab_elem *l;
+
+	WARN_ON_ONCE(!rcu_read_lock_held() && !rcu_read_lock_bh_held());
+
+	l = rhashtable_lookup(&rhtab->ht, key, rhtab->params);
+	if (l)
+		return rhtab_elem_value(rhtab, l);
+
+	return NULL;
+}
+
+/* Find the element for 'key' together with the bucket table and the bucket
+ * it currently lives in, which may be a future table during a resize.
+ */
+static struct rhash_head *rhtab_find_elem(struct bpf_rhtab *rhtab,
+					  const void *key,
+					  struct bucket_table **ptbl,
+					  unsigned int *pidx)
+{
+	struct rhashtable *ht = &rhtab->ht;
+	struct bucket_table *tbl;
+	struct rhtab_elem *l;
+	struct rhash_head *he;
+	unsigned int hash;
+
+	for (tbl = rht_dereference_rcu(ht->tbl, ht); tbl;
+	     tbl = rht_dereference_rcu(tbl->future_tbl, ht)) {
+		hash = rht_key_hashfn(ht, tbl, key, rhtab->params);
+		rht_for_each_rcu(he, tbl, hash) {
+			l = container_of(he, struct rhtab_elem, node);
+			if (!memcmp(l->key, key, rhtab->map.key_size)) {
+				*ptbl = tbl;
+				*pidx = hash;
+				return he;
+			}
+		}
+	}
+
+	return NULL;
+}
+
+/* Called from syscall */
+static int rhtab_map_get_next_key(struct bpf_map *map, void *key,
+				  void *next_key)
+{
+	struct bpf_rhtab *rhtab = container_of(map, struct bpf_rhtab, map);
+	struct rhashtable *ht = &rhtab->ht;
+	struct rhash_head *he = NULL, *pos;
+	struct bucket_table *tbl;
+	struct rhtab_elem *l;
+	unsigned int i = 0;
+
+	WARN_ON_ONCE(!rcu_read_lock_held());
+
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	if (key)
+		he = rhtab_find_elem(rhtab, key, &tbl, &i);
+
+	if (he) {
+		/* key was found, get next key in the same bucket */
+		pos = rcu_dereference_raw(he->next);
+		if (!rht_is_a_nulls(pos))
+			goto found;
+
+		/* no more elements in this bucket, go to the next one */
+		i++;
+	}
+
+	/* iterate over the buckets of this and any future table */
+	for (; tbl; tbl = rht_dereference_rcu(tbl->future_tbl, ht), i = 0) {
+		for (; i < tbl->size; i++) {
+			pos = rht_ptr_rcu(rht_bucket(tbl, i));
+			if (!rht_is_a_nulls(pos))
+				goto found;
+		}
+	}
+
+	/* iterated over all buckets and all elements */
+	return -ENOENT;
+
+found:
+	l = container_of(pos, struct rhtab_elem, node);
+	memcpy(next_key, l->key, map->key_size);
+	return 0;
+}
+
+/* Called from syscall or from eBPF program */
+static int rhtab_map_update_elem(struct bpf_map *map, void *key, void *value,
+				 u64 map_flags)
+{
+	struct bpf_rhtab *rhtab = container_of(map, struct bpf_rhtab, map);
+	struct rhtab_elem *l_new, *l_old;
+	int ret;
+
+	if (unlikely(map_flags > BPF_EXIST))
+		/* unknown flags */
+		return -EINVAL;
+
+	WARN_ON_ONCE(!rcu_read_lock_held() && !rcu_read_lock_bh_held());
+
+	ret = rhtab_lock(rhtab);
+	if (ret)
+		return ret;
+
+	l_new = rhtab_alloc_elem(rhtab, key, value);
+	if (!l_new) {
+		ret = -ENOMEM;
+		goto unlock;
+	}
+
+again:
+	l_old = rhashtable_lookup(&rhtab->ht, key, rhtab->params);
+	if (l_old && map_flags == BPF_NOEXIST) {
+		ret = -EEXIST;
+		goto free_new;
+	}
+	if (!l_old && map_flags == BPF_EXIST) {
+		ret = -ENOENT;
+		goto free_new;
+	}
+
+	if (l_old) {
+		/* swap the elements so that readers never see a partially
+		 * updated value
+		 */
+		ret = rhashtable_replace_fast(&rhtab->ht, &l_old->node,
+					      &l_new->node, rhtab->params);
+		if (ret == -ENOENT)
+			/* l_old was deleted from another CPU */
+			goto again;
+		if (ret)
+			goto free_new;
+		rhtab_free_elem(rhtab, l_old);
+		goto unlock;
+	}
+
+	if (atomic_inc_return(&rhtab->count) > map->max_entries) {
+		atomic_dec(&rhtab->count);
+		ret = -E2BIG;
+		goto free_new;
+	}
+
+	ret = rhashtable_lookup_insert_fast(&rhtab->ht, &l_new->node,
+					    rhtab->params);
+	if (ret) {
+		atomic_dec(&rhtab->count);
+		if (ret == -EEXIST)
+			/* same key was inserted from another CPU */
+			goto again;
+		goto free_new;
+	}
+	goto unlock;
+
+free_new:
+	rhtab_free_elem(rhtab, l_new);
+unlock:
+	rhtab_unlock(rhtab);
+	return ret;
+}
+
+/* Called from syscall or from eBPF program */
+static int rhtab_map_delete_elem(struct bpf_map *map, void *key)
+{
+	struct bpf_rhtab *rhtab = container_of(map, struct bpf_rhtab, map);
+	struct rhtab_elem *l;
+	int ret;
+
+	WARN_ON_ONCE(!rcu_read_lock_held() && !rcu_read_lock_bh_held());
+
+	ret = rhtab_lock(rhtab);
+	if (ret)
+		return ret;
+
+	l = rhashtable_lookup(&rhtab->ht, key, rhtab->params);
+	if (!l || rhashtable_remove_fast(&rhtab->ht, &l->node, rhtab->params)) {
+		ret = -ENOENT;
+		goto unlock;
+	}
+
+	atomic_dec(&rhtab->count);
+	rhtab_free_elem(rhtab, l);
+unlock:
+	rhtab_unlock(rhtab);
+	return ret;
+}
+
+static void rhtab_map_seq_show_elem(struct bpf_map *map, void *key,
+				    struct seq_file *m)
+{
+	void *value;
+
+	rcu_read_lock();
+
+	value = rhtab_map_lookup_elem(map, key);
+	if (!value) {
+		rcu_read_unlock();
+		return;
+	}
+
+	btf_type_seq_show(map->btf, map->btf_key_type_id, key, m);
+	seq_puts(m, ": ");
+	btf_type_seq_show(map->btf, map->btf_value_type_id, value, m);
+	seq_puts(m, "\n");
+
+	rcu_read_unlock();
+}
+
+BTF_ID_LIST_SINGLE(rhtab_map_btf_ids, struct, bpf_rhtab)
+const struct bpf_map_ops rhtab_map_ops = {
+	.map_meta_equal = bpf_map_meta_equal,
+	.map_alloc_check = rhtab_map_alloc_check,
+	.map_alloc = rhtab_map_alloc,
+	.map_free = rhtab_map_free,
+	.map_get_next_key = rhtab_map_get_next_key,
+	.map_lookup_elem = rhtab_map_lookup_elem,
+	.map_update_elem = rhtab_map_update_elem,
+	.map_delete_elem = rhtab_map_delete_elem,
+	.map_seq_show_elem = rhtab_map_seq_show_elem,
+	.map_btf_id = &rhtab_map_btf_ids[0],
+};
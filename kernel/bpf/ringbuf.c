@@ -12,7 +12,7 @@
 #include <uapi/linux/btf.h>
 #include <linux/btf_ids.h>
 
-#define RINGBUF_CREATE_FLAG_MASK (BPF_F_NUMA_NODE)
+#define RINGBUF_CREATE_FLAG_MASK (BPF_F_NUMA_NODE | BPF_F_RINGBUF_PERCPU)
 
 /* non-mmap()'able part of bpf_ringbuf (everything up to consumer page) */
 #define RINGBUF_PGOFF \
@@ -51,6 +51,8 @@ struct bpf_ringbuf {
 struct bpf_ringbuf_map {
 	struct bpf_map map;
 	struct bpf_ringbuf *rb;
+	/* with BPF_F_RINGBUF_PERCPU, one ring per possible CPU instead of rb */
+	struct bpf_ringbuf **percpu_rb;
 };
 
 /* 8-byte ring buffer record header structure */
@@ -146,6 +148,37 @@ static struct bpf_ringbuf *bpf_ringbuf_alloc(size_t data_sz, int numa_node)
 	return rb;
 }
 
+static void bpf_ringbuf_free(struct bpf_ringbuf *rb);
+
+static int ringbuf_map_alloc_percpu(struct bpf_ringbuf_map *rb_map,
+				    size_t data_sz)
+{
+	int cpu;
+
+	rb_map->percpu_rb = kcalloc(nr_cpu_ids, sizeof(*rb_map->percpu_rb),
+				    GFP_USER | __GFP_ACCOUNT);
+	if (!rb_map->percpu_rb)
+		return -ENOMEM;
+
+	for_each_possible_cpu(cpu) {
+		rb_map->percpu_rb[cpu] = bpf_ringbuf_alloc(data_sz,
+							   cpu_to_node(cpu));
+		if (!rb_map->percpu_rb[cpu])
+			goto err_free;
+	}
+
+	return 0;
+
+err_free:
+	for_each_possible_cpu(cpu) {
+		if (!rb_map->percpu_rb[cpu])
+			break;
+		bpf_ringbuf_free(rb_map->percpu_rb[cpu]);
+	}
+	kfree(rb_map->percpu_rb);
+	return -ENOMEM;
+}
+
 static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 {
 	struct bpf_ringbuf_map *rb_map;
@@ -153,6 +186,11 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 	if (attr->map_flags & ~RINGBUF_CREATE_FLAG_MASK)
 		return ERR_PTR(-EINVAL);
 
+	/* per-CPU rings are allocated on their CPU's node */
+	if ((attr->map_flags & BPF_F_RINGBUF_PERCPU) &&
+	    (attr->map_flags & BPF_F_NUMA_NODE))
+		return ERR_PTR(-EINVAL);
+
 	if (attr->key_size || attr->value_size ||
 	    !is_power_of_2(attr->max_entries) ||
 	    !PAGE_ALIGNED(attr->max_entries))
@@ -170,6 +208,14 @@ static struct bpf_map *ringbuf_map_alloc(union bpf_attr *attr)
 
 	bpf_map_init_from_attr(&rb_map->map, attr);
 
+	if (attr->map_flags & BPF_F_RINGBUF_PERCPU) {
+		if (ringbuf_map_alloc_percpu(rb_map, attr->max_entries)) {
+			kfree(rb_map);
+			return ERR_PTR(-ENOMEM);
+		}
+		return &rb_map->map;
+	}
+
 	rb_map->rb = bpf_ringbuf_alloc(attr->max_entries, rb_map->map.numa_node);
 	if (!rb_map->rb) {
 		kfree(rb_map);
@@ -196,12 +242,30 @@ static void bpf_ringbuf_free(struct bpf_ringbuf *rb)
 static void ringbuf_map_free(struct bpf_map *map)
 {
 	struct bpf_ringbuf_map *rb_map;
+	int cpu;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	bpf_ringbuf_free(rb_map->rb);
+	if (rb_map->percpu_rb) {
+		for_each_possible_cpu(cpu)
+			bpf_ringbuf_free(rb_map->percpu_rb[cpu]);
+		kfree(rb_map->percpu_rb);
+	} else {
+		bpf_ringbuf_free(rb_map->rb);
+	}
 	kfree(rb_map);
 }
 
+/* Ring the BPF program running on this CPU produces into */
+static struct bpf_ringbuf *ringbuf_map_rb(struct bpf_map *map)
+{
+	struct bpf_ringbuf_map *rb_map;
+
+	rb_map = container_of(map, struct bpf_ringbuf_map, map);
+	if (rb_map->percpu_rb)
+		return rb_map->percpu_rb[smp_processor_id()];
+	return rb_map->rb;
+}
+
 static void *ringbuf_map_lookup_elem(struct bpf_map *map, void *key)
 {
 	return ERR_PTR(-ENOTSUPP);
@@ -227,19 +291,36 @@ static int ringbuf_map_get_next_key(struct bpf_map *map, void *key,
 static int ringbuf_map_mmap(struct bpf_map *map, struct vm_area_struct *vma)
 {
 	struct bpf_ringbuf_map *rb_map;
+	struct bpf_ringbuf *rb;
+	unsigned long pgoff;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
 
+	rb = rb_map->rb;
+	pgoff = vma->vm_pgoff;
+	if (rb_map->percpu_rb) {
+		/* consumer page, producer page and double-mapped data pages
+		 * of each CPU's ring follow each other
+		 */
+		unsigned long stride = RINGBUF_POS_PAGES +
+				       2 * (map->max_entries >> PAGE_SHIFT);
+		unsigned long cpu = pgoff / stride;
+
+		if (cpu >= nr_cpu_ids || !rb_map->percpu_rb[cpu])
+			return -EINVAL;
+		rb = rb_map->percpu_rb[cpu];
+		pgoff -= cpu * stride;
+	}
+
 	if (vma->vm_flags & VM_WRITE) {
 		/* allow writable mapping for the consumer_pos only */
-		if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
+		if (pgoff != 0 || vma->vm_end - vma->vm_start != PAGE_SIZE)
 			return -EPERM;
 	} else {
 		vma->vm_flags &= ~VM_MAYWRITE;
 	}
 	/* remap_vmalloc_range() checks size and offset constraints */
-	return remap_vmalloc_range(vma, rb_map->rb,
-				   vma->vm_pgoff + RINGBUF_PGOFF);
+	return remap_vmalloc_range(vma, rb, pgoff + RINGBUF_PGOFF);
 }
 
 static unsigned long ringbuf_avail_data_sz(struct bpf_ringbuf *rb)
@@ -255,13 +336,26 @@ static __poll_t ringbuf_map_poll(struct bpf_map *map, struct file *filp,
 				 struct poll_table_struct *pts)
 {
 	struct bpf_ringbuf_map *rb_map;
+	__poll_t mask = 0;
+	int cpu;
 
 	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	poll_wait(filp, &rb_map->rb->waitq, pts);
+	if (!rb_map->percpu_rb) {
+		poll_wait(filp, &rb_map->rb->waitq, pts);
 
-	if (ringbuf_avail_data_sz(rb_map->rb))
-		return EPOLLIN | EPOLLRDNORM;
-	return 0;
+		if (ringbuf_avail_data_sz(rb_map->rb))
+			return EPOLLIN | EPOLLRDNORM;
+		return 0;
+	}
+
+	for_each_possible_cpu(cpu) {
+		struct bpf_ringbuf *rb = rb_map->percpu_rb[cpu];
+
+		poll_wait(filp, &rb->waitq, pts);
+		if (ringbuf_avail_data_sz(rb))
+			mask = EPOLLIN | EPOLLRDNORM;
+	}
+	return mask;
 }
 
 BTF_ID_LIST_SINGLE(ringbuf_map_btf_ids, struct, bpf_ringbuf_map)
@@ -350,13 +444,10 @@ static void *__bpf_ringbuf_reserve(struct bpf_ringbuf *rb, u64 size)
 
 BPF_CALL_3(bpf_ringbuf_reserve, struct bpf_map *, map, u64, size, u64, flags)
 {
-	struct bpf_ringbuf_map *rb_map;
-
 	if (unlikely(flags))
 		return 0;
 
-	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	return (unsigned long)__bpf_ringbuf_reserve(rb_map->rb, size);
+	return (unsigned long)__bpf_ringbuf_reserve(ringbuf_map_rb(map), size);
 }
 
 const struct bpf_func_proto bpf_ringbuf_reserve_proto = {
@@ -424,14 +515,12 @@ const struct bpf_func_proto bpf_ringbuf_discard_proto = {
 BPF_CALL_4(bpf_ringbuf_output, struct bpf_map *, map, void *, data, u64, size,
 	   u64, flags)
 {
-	struct bpf_ringbuf_map *rb_map;
 	void *rec;
 
 	if (unlikely(flags & ~(BPF_RB_NO_WAKEUP | BPF_RB_FORCE_WAKEUP)))
 		return -EINVAL;
 
-	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-	rec = __bpf_ringbuf_reserve(rb_map->rb, size);
+	rec = __bpf_ringbuf_reserve(ringbuf_map_rb(map), size);
 	if (!rec)
 		return -EAGAIN;
 
@@ -453,7 +542,7 @@ BPF_CALL_2(bpf_ringbuf_query, struct bpf_map *, map, u64, flags)
 {
 	struct bpf_ringbuf *rb;
 
-	rb = container_of(map, struct bpf_ringbuf_map, map)->rb;
+	rb = ringbuf_map_rb(map);
 
 	switch (flags) {
 	case BPF_RB_AVAIL_DATA:
@@ -479,7 +568,6 @@ const struct bpf_func_proto bpf_ringbuf_query_proto = {
 BPF_CALL_4(bpf_ringbuf_reserve_dynptr, struct bpf_map *, map, u32, size, u64, flags,
 	   struct bpf_dynptr_kern *, ptr)
 {
-	struct bpf_ringbuf_map *rb_map;
 	void *sample;
 	int err;
 
@@ -494,9 +582,7 @@ BPF_CALL_4(bpf_ringbuf_reserve_dynptr, struct bpf_map *, map, u32, size, u64, fl
 		return err;
 	}
 
-	rb_map = container_of(map, struct bpf_ringbuf_map, map);
-
-	sample = __bpf_ringbuf_reserve(rb_map->rb, size);
+	sample = __bpf_ringbuf_reserve(ringbuf_map_rb(map), size);
 	if (!sample) {
 		bpf_dynptr_set_null(ptr);
 		return -EINVAL;
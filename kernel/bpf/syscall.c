@@ -1066,6 +1066,7 @@ static int map_create(union bpf_attr *attr)
 	}
 
 	if (attr->map_type != BPF_MAP_TYPE_BLOOM_FILTER &&
+	    attr->map_type != BPF_MAP_TYPE_LPM_TRIE &&
 	    attr->map_extra != 0)
 		return -EINVAL;
 
@@ -23,6 +23,7 @@
 #include <linux/error-injection.h>
 #include <linux/bpf_lsm.h>
 #include <linux/btf_ids.h>
+#include <linux/jhash.h>
 
 #include "disasm.h"
 
@@ -11556,7 +11557,12 @@ static bool func_states_equal(struct bpf_verifier_env *env, struct bpf_func_stat
 {
 	int i;
 
-	memset(env->idmap_scratch, 0, sizeof(env->idmap_scratch));
+	/* check_ids() fills the map from the start and stops at the first
+	 * empty slot, so only the used prefix has to be cleared
+	 */
+	for (i = 0; i < BPF_ID_MAP_SIZE && env->idmap_scratch[i].old; i++)
+		env->idmap_scratch[i].old = 0;
+
 	for (i = 0; i < MAX_BPF_REG; i++)
 		if (!regsafe(env, &old->regs[i], &cur->regs[i],
 			     env->idmap_scratch))
@@ -11601,6 +11607,28 @@ static bool states_equal(struct bpf_verifier_env *env,
 	return true;
 }
 
+/* Hash of the parts of a verifier state that states_equal() requires to be
+ * identical: frame depth and callsites, spin lock and acquired references.
+ * States with different hashes can never be equal, which lets
+ * is_state_visited() skip the full comparison.
+ */
+static u32 state_shape_hash(const struct bpf_verifier_state *st)
+{
+	u32 hash = jhash_2words(st->curframe, st->active_spin_lock, 0);
+	const struct bpf_func_state *frame;
+	int i;
+
+	for (i = 0; i <= st->curframe; i++) {
+		frame = st->frame[i];
+		hash = jhash_2words(frame->callsite, frame->acquired_refs, hash);
+		if (frame->acquired_refs)
+			hash = jhash(frame->refs,
+				     sizeof(*frame->refs) * frame->acquired_refs,
+				     hash);
+	}
+	return hash;
+}
+
 /* Return 0 if no propagation happened. Return negative error code if error
  * happened. Otherwise, return the propagated bit.
  */
@@ -11747,6 +11775,7 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 	struct bpf_verifier_state *cur = env->cur_state, *new;
 	int i, j, err, states_cnt = 0;
 	bool add_new_state = env->test_state_freq ? true : false;
+	u32 shape;
 
 	cur->last_insn_idx = env->prev_insn_idx;
 	if (!env->insn_aux_data[insn_idx].prune_point)
@@ -11771,12 +11800,17 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 	sl = *pprev;
 
 	clean_live_states(env, insn_idx, cur);
+	shape = state_shape_hash(cur);
 
 	while (sl) {
 		states_cnt++;
 		if (sl->state.insn_idx != insn_idx)
 			goto next;
 
+		env->states_checked++;
+		if (sl->shape != shape)
+			env->states_shape_miss++;
+
 		if (sl->state.branches) {
 			struct bpf_func_state *frame = sl->state.frame[sl->state.curframe];
 
@@ -11793,7 +11827,8 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 				 * Since the verifier still needs to catch infinite loops
 				 * inside async callbacks.
 				 */
-			} else if (states_maybe_looping(&sl->state, cur) &&
+			} else if (sl->shape == shape &&
+				   states_maybe_looping(&sl->state, cur) &&
 				   states_equal(env, &sl->state, cur)) {
 				verbose_linfo(env, insn_idx, "; ");
 				verbose(env, "infinite loop detected at insn %d\n", insn_idx);
@@ -11816,7 +11851,7 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 				add_new_state = false;
 			goto miss;
 		}
-		if (states_equal(env, &sl->state, cur)) {
+		if (sl->shape == shape && states_equal(env, &sl->state, cur)) {
 			sl->hit_cnt++;
 			/* reached equivalent register/stack state,
 			 * prune the search.
@@ -11906,6 +11941,7 @@ static int is_state_visited(struct bpf_verifier_env *env, int insn_idx)
 	new_sl = kzalloc(sizeof(struct bpf_verifier_state_list), GFP_KERNEL);
 	if (!new_sl)
 		return -ENOMEM;
+	new_sl->shape = shape;
 	env->total_states++;
 	env->peak_states++;
 	env->prev_jmps_processed = env->jmps_processed;
@@ -12496,7 +12532,8 @@ static int check_map_prealloc(struct bpf_map *map)
 {
 	return (map->map_type != BPF_MAP_TYPE_HASH &&
 		map->map_type != BPF_MAP_TYPE_PERCPU_HASH &&
-		map->map_type != BPF_MAP_TYPE_HASH_OF_MAPS) ||
+		map->map_type != BPF_MAP_TYPE_HASH_OF_MAPS &&
+		map->map_type != BPF_MAP_TYPE_RHASH) ||
 		!(map->map_flags & BPF_F_NO_PREALLOC);
 }
 
@@ -14494,6 +14531,8 @@ static void print_verification_stats(struct bpf_verifier_env *env)
 				verbose(env, "+");
 		}
 		verbose(env, "\n");
+		verbose(env, "states checked %u skipped by shape %u\n",
+			env->states_checked, env->states_shape_miss);
 	}
 	verbose(env, "processed %d insns (limit %d) max_states_per_insn %d "
 		"total_states %d peak_states %d mark_read %d\n",
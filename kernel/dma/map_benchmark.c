@@ -16,9 +16,19 @@
 #include <linux/module.h>
 #include <linux/pci.h>
 #include <linux/platform_device.h>
+#include <linux/scatterlist.h>
 #include <linux/slab.h>
 #include <linux/timekeeping.h>
 
+/*
+ * Latency histogram in 100ns units: exact buckets below
+ * 1 << DMA_MAP_HIST_SUB_BITS, then 1 << DMA_MAP_HIST_SUB_BITS linear
+ * buckets per power of two, which keeps percentiles within 12.5%.
+ */
+#define DMA_MAP_HIST_SUB_BITS	3
+#define DMA_MAP_HIST_SUB	(1U << DMA_MAP_HIST_SUB_BITS)
+#define DMA_MAP_HIST_BUCKETS	256
+
 struct map_benchmark_data {
 	struct map_benchmark bparam;
 	struct device *dev;
@@ -29,19 +39,271 @@ struct map_benchmark_data {
 	atomic64_t sum_sq_map;
 	atomic64_t sum_sq_unmap;
 	atomic64_t loops;
+	atomic64_t map_hist[DMA_MAP_HIST_BUCKETS];
+	atomic64_t unmap_hist[DMA_MAP_HIST_BUCKETS];
+};
+
+struct map_benchmark_ops {
+	void *(*prepare)(struct map_benchmark_data *map);
+	void (*unprepare)(void *mparam);
+	void (*initialize_data)(void *mparam);
+	int (*do_map)(void *mparam);
+	void (*do_unmap)(void *mparam);
+};
+
+struct dma_single_map_param {
+	struct device *dev;
+	dma_addr_t addr;
+	void *xbuf;
+	u32 npages;
+	enum dma_data_direction dir;
+};
+
+static void *dma_single_map_benchmark_prepare(struct map_benchmark_data *map)
+{
+	struct dma_single_map_param *params;
+
+	params = kzalloc(sizeof(*params), GFP_KERNEL);
+	if (!params)
+		return NULL;
+
+	params->npages = map->bparam.granule;
+	params->dir = map->dir;
+	params->dev = map->dev;
+	params->xbuf = alloc_pages_exact(params->npages * PAGE_SIZE,
+					 GFP_KERNEL);
+	if (!params->xbuf) {
+		kfree(params);
+		return NULL;
+	}
+
+	return params;
+}
+
+static void dma_single_map_benchmark_unprepare(void *mparam)
+{
+	struct dma_single_map_param *params = mparam;
+
+	free_pages_exact(params->xbuf, params->npages * PAGE_SIZE);
+	kfree(params);
+}
+
+static void dma_single_map_benchmark_initialize_data(void *mparam)
+{
+	struct dma_single_map_param *params = mparam;
+
+	memset(params->xbuf, 0x66, params->npages * PAGE_SIZE);
+}
+
+static int dma_single_map_benchmark_do_map(void *mparam)
+{
+	struct dma_single_map_param *params = mparam;
+
+	params->addr = dma_map_single(params->dev, params->xbuf,
+				      params->npages * PAGE_SIZE, params->dir);
+	if (unlikely(dma_mapping_error(params->dev, params->addr))) {
+		pr_err("dma_map_single failed on %s\n",
+			dev_name(params->dev));
+		return -ENOMEM;
+	}
+
+	return 0;
+}
+
+static void dma_single_map_benchmark_do_unmap(void *mparam)
+{
+	struct dma_single_map_param *params = mparam;
+
+	dma_unmap_single(params->dev, params->addr,
+			 params->npages * PAGE_SIZE, params->dir);
+}
+
+static const struct map_benchmark_ops dma_single_map_benchmark_ops = {
+	.prepare = dma_single_map_benchmark_prepare,
+	.unprepare = dma_single_map_benchmark_unprepare,
+	.initialize_data = dma_single_map_benchmark_initialize_data,
+	.do_map = dma_single_map_benchmark_do_map,
+	.do_unmap = dma_single_map_benchmark_do_unmap,
+};
+
+/*
+ * Each scatterlist entry gets its own buffer, so that with an IOMMU the
+ * entries are discontiguous in physical memory and have to be merged into
+ * one IOVA range, as they would be for a real block or network request.
+ */
+struct dma_sg_map_param {
+	struct sg_table sgt;
+	struct device *dev;
+	void **bufs;
+	u32 nents;
+	enum dma_data_direction dir;
+};
+
+static void dma_sg_map_benchmark_free_bufs(struct dma_sg_map_param *params)
+{
+	struct scatterlist *sg;
+	unsigned int i;
+
+	for_each_sgtable_sg(&params->sgt, sg, i) {
+		if (params->bufs[i])
+			free_pages_exact(params->bufs[i], sg->length);
+	}
+}
+
+static void *dma_sg_map_benchmark_prepare(struct map_benchmark_data *map)
+{
+	u32 npages = map->bparam.granule;
+	struct dma_sg_map_param *params;
+	struct scatterlist *sg;
+	unsigned int i;
+
+	params = kzalloc(sizeof(*params), GFP_KERNEL);
+	if (!params)
+		return NULL;
+
+	params->nents = map->bparam.nents ?: npages;
+	params->dir = map->dir;
+	params->dev = map->dev;
+
+	params->bufs = kcalloc(params->nents, sizeof(*params->bufs),
+			       GFP_KERNEL);
+	if (!params->bufs)
+		goto out_free_params;
+
+	if (sg_alloc_table(&params->sgt, params->nents, GFP_KERNEL))
+		goto out_free_bufs;
+
+	/* spread the granule over the entries, the first ones get the rest */
+	for_each_sgtable_sg(&params->sgt, sg, i) {
+		size_t len = (npages / params->nents +
+			      (i < npages % params->nents)) * PAGE_SIZE;
+
+		params->bufs[i] = alloc_pages_exact(len, GFP_KERNEL);
+		if (!params->bufs[i])
+			goto out_free_pages;
+		sg_set_buf(sg, params->bufs[i], len);
+	}
+
+	return params;
+
+out_free_pages:
+	dma_sg_map_benchmark_free_bufs(params);
+	sg_free_table(&params->sgt);
+out_free_bufs:
+	kfree(params->bufs);
+out_free_params:
+	kfree(params);
+	return NULL;
+}
+
+static void dma_sg_map_benchmark_unprepare(void *mparam)
+{
+	struct dma_sg_map_param *params = mparam;
+
+	dma_sg_map_benchmark_free_bufs(params);
+	sg_free_table(&params->sgt);
+	kfree(params->bufs);
+	kfree(params);
+}
+
+static void dma_sg_map_benchmark_initialize_data(void *mparam)
+{
+	struct dma_sg_map_param *params = mparam;
+	struct scatterlist *sg;
+	unsigned int i;
+
+	for_each_sgtable_sg(&params->sgt, sg, i)
+		memset(params->bufs[i], 0x66, sg->length);
+}
+
+static int dma_sg_map_benchmark_do_map(void *mparam)
+{
+	struct dma_sg_map_param *params = mparam;
+	int ret;
+
+	ret = dma_map_sgtable(params->dev, &params->sgt, params->dir, 0);
+	if (unlikely(ret)) {
+		pr_err("dma_map_sgtable failed on %s\n",
+			dev_name(params->dev));
+		return ret;
+	}
+
+	return 0;
+}
+
+static void dma_sg_map_benchmark_do_unmap(void *mparam)
+{
+	struct dma_sg_map_param *params = mparam;
+
+	dma_unmap_sgtable(params->dev, &params->sgt, params->dir, 0);
+}
+
+static const struct map_benchmark_ops dma_sg_map_benchmark_ops = {
+	.prepare = dma_sg_map_benchmark_prepare,
+	.unprepare = dma_sg_map_benchmark_unprepare,
+	.initialize_data = dma_sg_map_benchmark_initialize_data,
+	.do_map = dma_sg_map_benchmark_do_map,
+	.do_unmap = dma_sg_map_benchmark_do_unmap,
 };
 
+static const struct map_benchmark_ops *dma_map_benchmark_ops[] = {
+	[DMA_MAP_SINGLE_MODE] = &dma_single_map_benchmark_ops,
+	[DMA_MAP_SG_MODE] = &dma_sg_map_benchmark_ops,
+};
+
+static unsigned int map_benchmark_hist_bucket(u64 lat_100ns)
+{
+	unsigned int shift, bucket;
+
+	if (lat_100ns < DMA_MAP_HIST_SUB)
+		return lat_100ns;
+
+	shift = fls64(lat_100ns) - 1 - DMA_MAP_HIST_SUB_BITS;
+	bucket = (shift + 1) * DMA_MAP_HIST_SUB +
+		 ((lat_100ns >> shift) & (DMA_MAP_HIST_SUB - 1));
+
+	return min_t(unsigned int, bucket, DMA_MAP_HIST_BUCKETS - 1);
+}
+
+/* lower bound, in 100ns, of the latencies accounted to @bucket */
+static u64 map_benchmark_hist_value(unsigned int bucket)
+{
+	unsigned int shift;
+
+	if (bucket < DMA_MAP_HIST_SUB)
+		return bucket;
+
+	shift = bucket / DMA_MAP_HIST_SUB - 1;
+	return (u64)(DMA_MAP_HIST_SUB + bucket % DMA_MAP_HIST_SUB) << shift;
+}
+
+static u64 map_benchmark_percentile(atomic64_t *hist, u64 loops,
+				    unsigned int pct)
+{
+	u64 rank = div64_u64(loops * pct + 99, 100);
+	u64 seen = 0;
+	unsigned int i;
+
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		seen += atomic64_read(&hist[i]);
+		if (seen >= rank)
+			break;
+	}
+
+	return map_benchmark_hist_value(min_t(unsigned int, i,
+						 DMA_MAP_HIST_BUCKETS - 1));
+}
+
 static int map_benchmark_thread(void *data)
 {
-	void *buf;
-	dma_addr_t dma_addr;
 	struct map_benchmark_data *map = data;
-	int npages = map->bparam.granule;
-	u64 size = npages * PAGE_SIZE;
+	const struct map_benchmark_ops *ops =
+		dma_map_benchmark_ops[map->bparam.map_mode];
+	void *mparam;
 	int ret = 0;
 
-	buf = alloc_pages_exact(size, GFP_KERNEL);
-	if (!buf)
+	mparam = ops->prepare(map);
+	if (!mparam)
 		return -ENOMEM;
 
 	while (!kthread_should_stop())  {
@@ -56,16 +318,12 @@ static int map_benchmark_thread(void *data)
 		 * 66 means evertything goes well! 66 is lucky.
 		 */
 		if (map->dir != DMA_FROM_DEVICE)
-			memset(buf, 0x66, size);
+			ops->initialize_data(mparam);
 
 		map_stime = ktime_get();
-		dma_addr = dma_map_single(map->dev, buf, size, map->dir);
-		if (unlikely(dma_mapping_error(map->dev, dma_addr))) {
-			pr_err("dma_map_single failed on %s\n",
-				dev_name(map->dev));
-			ret = -ENOMEM;
+		ret = ops->do_map(mparam);
+		if (ret)
 			goto out;
-		}
 		map_etime = ktime_get();
 		map_delta = ktime_sub(map_etime, map_stime);
 
@@ -73,7 +331,7 @@ static int map_benchmark_thread(void *data)
 		ndelay(map->bparam.dma_trans_ns);
 
 		unmap_stime = ktime_get();
-		dma_unmap_single(map->dev, dma_addr, size, map->dir);
+		ops->do_unmap(mparam);
 		unmap_etime = ktime_get();
 		unmap_delta = ktime_sub(unmap_etime, unmap_stime);
 
@@ -88,11 +346,13 @@ static int map_benchmark_thread(void *data)
 		atomic64_add(unmap_100ns, &map->sum_unmap_100ns);
 		atomic64_add(map_sq, &map->sum_sq_map);
 		atomic64_add(unmap_sq, &map->sum_sq_unmap);
+		atomic64_inc(&map->map_hist[map_benchmark_hist_bucket(map_100ns)]);
+		atomic64_inc(&map->unmap_hist[map_benchmark_hist_bucket(unmap_100ns)]);
 		atomic64_inc(&map->loops);
 	}
 
 out:
-	free_pages_exact(buf, size);
+	ops->unprepare(mparam);
 	return ret;
 }
 
@@ -131,6 +391,10 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 	atomic64_set(&map->sum_sq_map, 0);
 	atomic64_set(&map->sum_sq_unmap, 0);
 	atomic64_set(&map->loops, 0);
+	for (i = 0; i < DMA_MAP_HIST_BUCKETS; i++) {
+		atomic64_set(&map->map_hist[i], 0);
+		atomic64_set(&map->unmap_hist[i], 0);
+	}
 
 	for (i = 0; i < threads; i++) {
 		get_task_struct(tsk[i]);
@@ -167,6 +431,20 @@ static int do_map_benchmark(struct map_benchmark_data *map)
 				map->bparam.avg_unmap_100ns;
 		map->bparam.map_stddev = int_sqrt64(map_variance);
 		map->bparam.unmap_stddev = int_sqrt64(unmap_variance);
+
+		/* latency percentiles */
+		map->bparam.map_p50_100ns =
+			map_benchmark_percentile(map->map_hist, loops, 50);
+		map->bparam.map_p90_100ns =
+			map_benchmark_percentile(map->map_hist, loops, 90);
+		map->bparam.map_p99_100ns =
+			map_benchmark_percentile(map->map_hist, loops, 99);
+		map->bparam.unmap_p50_100ns =
+			map_benchmark_percentile(map->unmap_hist, loops, 50);
+		map->bparam.unmap_p90_100ns =
+			map_benchmark_percentile(map->unmap_hist, loops, 90);
+		map->bparam.unmap_p99_100ns =
+			map_benchmark_percentile(map->unmap_hist, loops, 99);
 	}
 
 out:
@@ -218,6 +496,21 @@ static long map_benchmark_ioctl(struct file *file, unsigned int cmd,
 			return -EINVAL;
 		}
 
+		if (map->bparam.map_mode > DMA_MAP_MODE_MAX) {
+			pr_err("invalid map mode\n");
+			return -EINVAL;
+		}
+
+		if (map->bparam.nents > map->bparam.granule) {
+			pr_err("invalid number of sg entries\n");
+			return -EINVAL;
+		}
+
+		if (map->bparam.reserved) {
+			pr_err("reserved field must be zero\n");
+			return -EINVAL;
+		}
+
 		switch (map->bparam.dma_dir) {
 		case DMA_MAP_BIDIRECTIONAL:
 			map->dir = DMA_BIDIRECTIONAL;
@@ -54,6 +54,7 @@
 #include <linux/highmem.h>
 #include <linux/pgtable.h>
 #include <linux/buildid.h>
+#include <linux/jhash.h>
 
 #include "internal.h"
 
@@ -2386,6 +2387,8 @@ static void perf_remove_from_context(struct perf_event *event, unsigned long fla
 	event_function_call(event, __perf_remove_from_context, (void *)flags);
 }
 
+static void perf_callchain_agg_flush(struct perf_event *event);
+
 /*
  * Cross CPU call to disable a performance event
  */
@@ -2409,6 +2412,9 @@ static void __perf_event_disable(struct perf_event *event,
 
 	perf_event_set_state(event, PERF_EVENT_STATE_OFF);
 	perf_cgroup_event_disable(event, ctx);
+
+	/* Don't leave aggregated samples behind once disabled. */
+	perf_callchain_agg_flush(event);
 }
 
 /*
@@ -4953,6 +4959,9 @@ static void _free_event(struct perf_event *event)
 		if (event->attr.sample_type & PERF_SAMPLE_CALLCHAIN)
 			put_callchain_buffers();
 	}
+	/* Inherited events use the table of their parent. */
+	if (!event->parent)
+		kvfree(event->callchain_agg);
 
 	perf_event_free_bpf_prog(event);
 	perf_addr_filters_splice(event, NULL);
@@ -7282,6 +7291,179 @@ perf_callchain(struct perf_event *event, struct pt_regs *regs)
 	return callchain ?: &__empty_callchain;
 }
 
+/*
+ * Callchain aggregation (attr.aggregate_callchain).
+ *
+ * Instead of a PERF_RECORD_SAMPLE per overflow, samples are counted in a
+ * small open addressed table keyed by (pid, tid, callchain).  The table is
+ * written out as PERF_RECORD_CALLCHAIN_AGG records when it is full, once
+ * per PERF_AGG_FLUSH_NS, and when the event is disabled or exits, so the
+ * ring buffer (and whoever drains it) only sees each unique stack once per
+ * interval.
+ *
+ * Inherited events share the table of their parent, like they share its
+ * ring buffer.  Overflows of children on other CPUs and a flush from the
+ * disable IPI interrupted by an overflow NMI are serialized by ->busy; an
+ * overflow finding the table busy is written out as a regular sample
+ * instead.
+ */
+#define PERF_AGG_ENTRIES	128
+#define PERF_AGG_FLUSH_NS	NSEC_PER_SEC
+
+struct perf_callchain_agg_entry {
+	u32				hash;
+	u32				pid, tid;
+	u32				nr;
+	u64				count;
+	u64				period;
+	u64				ips[PERF_AGG_MAX_STACK];
+};
+
+struct perf_callchain_agg {
+	atomic_t			busy;
+	u64				last_flush;
+	struct perf_callchain_agg_entry	entries[PERF_AGG_ENTRIES];
+};
+
+struct perf_callchain_agg_event {
+	struct perf_event_header	header;
+	u32				pid, tid;
+	u64				count;
+	u64				period;
+	u64				nr;
+};
+
+static struct perf_callchain_agg *perf_callchain_agg_alloc(void)
+{
+	return kvzalloc(sizeof(struct perf_callchain_agg), GFP_KERNEL);
+}
+
+static void __perf_callchain_agg_flush(struct perf_event *event,
+				       struct perf_callchain_agg *agg)
+{
+	struct perf_callchain_agg_event rec;
+	struct perf_output_handle handle;
+	struct perf_sample_data sample;
+	int i;
+
+	for (i = 0; i < PERF_AGG_ENTRIES; i++) {
+		struct perf_callchain_agg_entry *e = &agg->entries[i];
+
+		if (!e->count)
+			continue;
+
+		rec.header.type = PERF_RECORD_CALLCHAIN_AGG;
+		rec.header.misc = 0;
+		rec.header.size = sizeof(rec) + e->nr * sizeof(u64);
+		rec.pid = e->pid;
+		rec.tid = e->tid;
+		rec.count = e->count;
+		rec.period = e->period;
+		rec.nr = e->nr;
+
+		/* Entries which don't fit are dropped, samples get lost too. */
+		perf_event_header__init_id(&rec.header, &sample, event);
+		if (!perf_output_begin(&handle, &sample, event,
+				       rec.header.size)) {
+			perf_output_put(&handle, rec);
+			__output_copy(&handle, e->ips, e->nr * sizeof(u64));
+			perf_event__output_id_sample(event, &handle, &sample);
+			perf_output_end(&handle);
+		}
+
+		e->count = 0;
+	}
+
+	agg->last_flush = perf_clock();
+}
+
+static void perf_callchain_agg_flush(struct perf_event *event)
+{
+	struct perf_callchain_agg *agg = event->callchain_agg;
+
+	if (!agg || atomic_cmpxchg(&agg->busy, 0, 1))
+		return;
+
+	rcu_read_lock();
+	__perf_callchain_agg_flush(event, agg);
+	rcu_read_unlock();
+
+	atomic_set_release(&agg->busy, 0);
+}
+
+static struct perf_callchain_agg_entry *
+perf_callchain_agg_lookup(struct perf_callchain_agg *agg, u32 hash, u32 pid,
+			  u32 tid, const u64 *ips, u32 nr)
+{
+	unsigned int i, idx = hash % PERF_AGG_ENTRIES;
+
+	for (i = 0; i < PERF_AGG_ENTRIES; i++) {
+		struct perf_callchain_agg_entry *e = &agg->entries[idx];
+
+		if (!e->count)
+			return e;
+		if (e->hash == hash && e->pid == pid && e->tid == tid &&
+		    e->nr == nr && !memcmp(e->ips, ips, nr * sizeof(u64)))
+			return e;
+
+		if (++idx == PERF_AGG_ENTRIES)
+			idx = 0;
+	}
+	return NULL;
+}
+
+static void perf_event_agg_output(struct perf_event *event,
+				  struct perf_sample_data *data,
+				  struct pt_regs *regs)
+{
+	struct perf_callchain_agg *agg = event->callchain_agg;
+	struct perf_callchain_agg_entry *e;
+	struct perf_callchain_entry *callchain;
+	u32 pid, tid, nr, hash;
+
+	if (atomic_cmpxchg(&agg->busy, 0, 1)) {
+		perf_event_output_forward(event, data, regs);
+		return;
+	}
+
+	/* protect the callchain buffers */
+	rcu_read_lock();
+
+	if (event->attr.sample_type & __PERF_SAMPLE_CALLCHAIN_EARLY)
+		callchain = data->callchain;
+	else
+		callchain = perf_callchain(event, regs);
+
+	pid = perf_event_pid(event, current);
+	tid = perf_event_tid(event, current);
+	nr = min_t(u32, callchain->nr, PERF_AGG_MAX_STACK);
+	hash = jhash2((u32 *)callchain->ip, nr * 2, jhash_2words(pid, tid, 0));
+
+	e = perf_callchain_agg_lookup(agg, hash, pid, tid, callchain->ip, nr);
+	if (!e) {
+		__perf_callchain_agg_flush(event, agg);
+		e = &agg->entries[hash % PERF_AGG_ENTRIES];
+	}
+
+	if (!e->count) {
+		e->hash = hash;
+		e->pid = pid;
+		e->tid = tid;
+		e->nr = nr;
+		e->period = 0;
+		memcpy(e->ips, callchain->ip, nr * sizeof(u64));
+	}
+	e->count++;
+	e->period += data->period;
+
+	if (perf_clock() - agg->last_flush >= PERF_AGG_FLUSH_NS)
+		__perf_callchain_agg_flush(event, agg);
+
+	rcu_read_unlock();
+
+	atomic_set_release(&agg->busy, 0);
+}
+
 void perf_prepare_sample(struct perf_event_header *header,
 			 struct perf_sample_data *data,
 			 struct perf_event *event,
@@ -11572,6 +11754,9 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 	if (overflow_handler) {
 		event->overflow_handler	= overflow_handler;
 		event->overflow_handler_context = context;
+	} else if (event->attr.aggregate_callchain) {
+		event->overflow_handler = perf_event_agg_output;
+		event->overflow_handler_context = NULL;
 	} else if (is_write_backward(event)){
 		event->overflow_handler = perf_event_output_backward;
 		event->overflow_handler_context = NULL;
@@ -11599,6 +11784,17 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 	if (attr->inherit && (attr->sample_type & PERF_SAMPLE_READ))
 		goto err_ns;
 
+	/*
+	 * Callchain aggregation replaces the sampling output of the event,
+	 * and its records can only be attributed to the event by sample_id.
+	 */
+	if (attr->aggregate_callchain &&
+	    (!is_sampling_event(event) || !attr->sample_id_all ||
+	     !(attr->sample_type & PERF_SAMPLE_CALLCHAIN) ||
+	     is_write_backward(event) ||
+	     (overflow_handler && !parent_event)))
+		goto err_ns;
+
 	if (!has_branch_stack(event))
 		event->attr.branch_sample_type = 0;
 
@@ -11668,6 +11864,16 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 		}
 	}
 
+	if (parent_event) {
+		event->callchain_agg = parent_event->callchain_agg;
+	} else if (attr->aggregate_callchain) {
+		event->callchain_agg = perf_callchain_agg_alloc();
+		if (!event->callchain_agg) {
+			err = -ENOMEM;
+			goto err_callchain_buffer;
+		}
+	}
+
 	err = security_perf_event_alloc(event);
 	if (err)
 		goto err_callchain_buffer;
@@ -11679,6 +11885,7 @@ perf_event_alloc(struct perf_event_attr *attr, int cpu,
 
 err_callchain_buffer:
 	if (!event->parent) {
+		kvfree(event->callchain_agg);
 		if (event->attr.sample_type & PERF_SAMPLE_CALLCHAIN)
 			put_callchain_buffers();
 	}
@@ -12679,6 +12886,9 @@ perf_event_exit_event(struct perf_event *event, struct perf_event_context *ctx)
 
 	perf_remove_from_context(event, detach_flags);
 
+	/* Write out what the exiting task left in the table. */
+	perf_callchain_agg_flush(event);
+
 	raw_spin_lock_irq(&ctx->lock);
 	if (event->state > PERF_EVENT_STATE_EXIT)
 		perf_event_set_state(event, PERF_EVENT_STATE_EXIT);
@@ -581,6 +581,7 @@ static __latent_entropy int dup_mmap(struct mm_struct *mm,
 	struct vm_area_struct *mpnt, *tmp;
 	int retval;
 	unsigned long charge = 0;
+	unsigned long dup_end = 0;
 	MA_STATE(old_mas, &oldmm->mm_mt, 0, 0);
 	MA_STATE(mas, &mm->mm_mt, 0, 0);
 	LIST_HEAD(uf);
@@ -610,7 +611,13 @@ static __latent_entropy int dup_mmap(struct mm_struct *mm,
 		goto out;
 	khugepaged_fork(mm, oldmm);
 
-	retval = mas_expected_entries(&mas, oldmm->map_count);
+	/*
+	 * Build an identical tree in one pass, so that linking each new vma
+	 * below replaces its parent's entry in place without any allocation.
+	 * Until then, entries at and above dup_end still point at the
+	 * parent's vmas.
+	 */
+	retval = __mt_dup(&oldmm->mm_mt, &mm->mm_mt, GFP_KERNEL);
 	if (retval)
 		goto out;
 
@@ -618,6 +625,11 @@ static __latent_entropy int dup_mmap(struct mm_struct *mm,
 		struct file *file;
 
 		if (mpnt->vm_flags & VM_DONTCOPY) {
+			mas_set_range(&mas, mpnt->vm_start, mpnt->vm_end - 1);
+			retval = mas_store_gfp(&mas, NULL, GFP_KERNEL);
+			if (retval)
+				goto loop_out;
+			dup_end = mpnt->vm_end;
 			vm_stat_account(mm, mpnt->vm_flags, -vma_pages(mpnt));
 			continue;
 		}
@@ -685,6 +697,7 @@ static __latent_entropy int dup_mmap(struct mm_struct *mm,
 		mas.index = tmp->vm_start;
 		mas.last = tmp->vm_end - 1;
 		mas_store(&mas, tmp);
+		dup_end = tmp->vm_end;
 
 		mm->map_count++;
 		if (!(tmp->vm_flags & VM_WIPEONFORK))
@@ -699,6 +712,11 @@ static __latent_entropy int dup_mmap(struct mm_struct *mm,
 	/* a new mm has just been created */
 	retval = arch_dup_mmap(oldmm, mm);
 loop_out:
+	if (retval && mpnt) {
+		/* Drop the entries still shared with the parent. */
+		mas_set_range(&mas, dup_end, ULONG_MAX);
+		mas_store_gfp(&mas, NULL, GFP_KERNEL | __GFP_NOFAIL);
+	}
 	mas_destroy(&mas);
 out:
 	mmap_write_unlock(mm);
@@ -1128,6 +1146,7 @@ static struct mm_struct *mm_init(struct mm_struct *mm, struct task_struct *p,
 	mm->pmd_huge_pte = NULL;
 #endif
 	mm_init_uprobes_state(mm);
+	futex_mm_init(mm);
 	hugetlb_count_init(mm);
 
 	if (current->mm) {
@@ -1174,6 +1193,7 @@ static inline void __mmput(struct mm_struct *mm)
 	VM_BUG_ON(atomic_read(&mm->mm_users));
 
 	uprobe_clear_state(mm);
+	futex_hash_free(mm);
 	exit_aio(mm);
 	ksm_exit(mm);
 	khugepaged_exit(mm); /* must run before exit_mmap */
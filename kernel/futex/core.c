@@ -37,6 +37,7 @@
 #include <linux/memblock.h>
 #include <linux/fault-inject.h>
 #include <linux/slab.h>
+#include <linux/prctl.h>
 
 #include "futex.h"
 #include "../locking/rtmutex_common.h"
@@ -53,6 +54,29 @@ static struct {
 #define futex_queues   (__futex_data.queues)
 #define futex_hashsize (__futex_data.hashsize)
 
+/*
+ * A process can opt in to hashing its private futexes into a table of its
+ * own (PR_FUTEX_HASH), so that its waiters neither collide with nor get
+ * slowed down by those of unrelated processes. The table can only be set
+ * up while the mm has a single user and stays until the mm is torn down,
+ * so no waiter ever has to move from one table to another.
+ */
+struct futex_private_hash {
+	unsigned int		hash_mask;
+	struct futex_hash_bucket queues[];
+};
+
+#define FUTEX_PRIVATE_HASH_MIN	16
+#define FUTEX_PRIVATE_HASH_MAX	(1U << 16)
+
+/*
+ * Node local tables for FUTEX_NUMA_FLAG futexes, so that their bucket
+ * locks and waiter lists sit next to the memory the futex word lives in.
+ * A node whose table could not be allocated uses the global hash.
+ */
+static struct futex_hash_bucket **futex_node_queues __read_mostly;
+static unsigned long futex_node_hashsize __read_mostly;
+
 
 /*
  * Fault injections for futexes.
@@ -116,6 +140,18 @@ struct futex_hash_bucket *futex_hash(union futex_key *key)
 {
 	u32 hash = jhash2((u32 *)key, offsetof(typeof(*key), both.offset) / 4,
 			  key->both.offset);
+	unsigned int node = key->both.offset >> FUT_OFF_NODE_SHIFT;
+
+	if (node)
+		return &futex_node_queues[node - 1][hash & (futex_node_hashsize - 1)];
+
+	if (!(key->both.offset & (FUT_OFF_INODE | FUT_OFF_MMSHARED))) {
+		struct futex_private_hash *fph;
+
+		fph = READ_ONCE(key->private.mm->futex_phash);
+		if (fph)
+			return &fph->queues[hash & fph->hash_mask];
+	}
 
 	return &futex_queues[hash & (futex_hashsize - 1)];
 }
@@ -190,10 +226,44 @@ static u64 get_inode_sequence_number(struct inode *inode)
 	}
 }
 
+/*
+ * Resolve the node of a FUTEX_NUMA_FLAG futex from the u32 following the
+ * futex word. The first user of an unassigned futex publishes @nid there,
+ * so every later waiter and waker agrees on the table even if the backing
+ * page migrates.
+ */
+static int futex_key_set_node(u32 __user *uaddr, union futex_key *key, int nid)
+{
+	u32 __user *naddr = uaddr + 1;
+	u32 node, curval;
+	int err;
+
+	if (get_user(node, naddr))
+		return -EFAULT;
+
+	while (node == (u32)FUTEX_NO_NODE) {
+		err = futex_cmpxchg_value_locked(&curval, naddr, node, nid);
+		if (!err) {
+			node = curval == (u32)FUTEX_NO_NODE ? nid : curval;
+			break;
+		}
+		if (err == -EFAULT && fault_in_user_writeable(naddr))
+			return -EFAULT;
+		cond_resched();
+	}
+
+	if (node >= nr_node_ids || !node_possible(node))
+		return -EINVAL;
+
+	if (futex_node_queues && futex_node_queues[node])
+		key->both.offset |= (node + 1) << FUT_OFF_NODE_SHIFT;
+	return 0;
+}
+
 /**
  * get_futex_key() - Get parameters which are the keys for a futex
  * @uaddr:	virtual address of the futex
- * @fshared:	false for a PROCESS_PRIVATE futex, true for PROCESS_SHARED
+ * @flags:	futex flags (FLAGS_SHARED for PROCESS_SHARED, FLAGS_NUMA, etc.)
  * @key:	address where result is stored.
  * @rw:		mapping needs to be read/write (values: FUTEX_READ,
  *              FUTEX_WRITE)
@@ -202,25 +272,31 @@ static u64 get_inode_sequence_number(struct inode *inode)
  *
  * The key words are stored in @key on success.
  *
- * For shared mappings (when @fshared), the key is:
+ * For shared mappings (when FLAGS_SHARED), the key is:
  *
  *   ( inode->i_sequence, page->index, offset_within_page )
  *
  * [ also see get_inode_sequence_number() ]
  *
- * For private mappings (or when !@fshared), the key is:
+ * For private mappings (or when !FLAGS_SHARED), the key is:
  *
  *   ( current->mm, address, 0 )
  *
  * This allows (cross process, where applicable) identification of the futex
  * without keeping the page pinned for the duration of the FUTEX_WAIT.
  *
+ * With FLAGS_NUMA the node of the backing page (the local node for private
+ * futexes, whose page is not looked up) is recorded on first use, see
+ * futex_key_set_node().
+ *
  * lock_page() might sleep, the caller should not hold a spinlock.
  */
-int get_futex_key(u32 __user *uaddr, bool fshared, union futex_key *key,
+int get_futex_key(u32 __user *uaddr, unsigned int flags, union futex_key *key,
 		  enum futex_access rw)
 {
 	unsigned long address = (unsigned long)uaddr;
+	bool fshared = flags & FLAGS_SHARED;
+	size_t size = flags & FLAGS_NUMA ? 2 * sizeof(u32) : sizeof(u32);
 	struct mm_struct *mm = current->mm;
 	struct page *page, *tail;
 	struct address_space *mapping;
@@ -230,11 +306,11 @@ int get_futex_key(u32 __user *uaddr, bool fshared, union futex_key *key,
 	 * The futex address must be "naturally" aligned.
 	 */
 	key->both.offset = address % PAGE_SIZE;
-	if (unlikely((address % sizeof(u32)) != 0))
+	if (unlikely((address % size) != 0))
 		return -EINVAL;
 	address -= key->both.offset;
 
-	if (unlikely(!access_ok(uaddr, sizeof(u32))))
+	if (unlikely(!access_ok(uaddr, size)))
 		return -EFAULT;
 
 	if (unlikely(should_fail_futex(fshared)))
@@ -250,6 +326,8 @@ int get_futex_key(u32 __user *uaddr, bool fshared, union futex_key *key,
 	if (!fshared) {
 		key->private.mm = mm;
 		key->private.address = address;
+		if (flags & FLAGS_NUMA)
+			return futex_key_set_node(uaddr, key, numa_node_id());
 		return 0;
 	}
 
@@ -389,6 +467,9 @@ int get_futex_key(u32 __user *uaddr, bool fshared, union futex_key *key,
 		rcu_read_unlock();
 	}
 
+	if (flags & FLAGS_NUMA)
+		err = futex_key_set_node(uaddr, key, page_to_nid(tail));
+
 out:
 	put_page(page);
 	return err;
@@ -1112,6 +1193,111 @@ void futex_exit_release(struct task_struct *tsk)
 	futex_cleanup_end(tsk, FUTEX_STATE_DEAD);
 }
 
+static void futex_hash_bucket_init(struct futex_hash_bucket *hb)
+{
+	atomic_set(&hb->waiters, 0);
+	plist_head_init(&hb->chain);
+	spin_lock_init(&hb->lock);
+#ifdef CONFIG_LOCK_SPIN_ON_OWNER
+	osq_lock_init(&hb->osq);
+#endif
+}
+
+void futex_hash_free(struct mm_struct *mm)
+{
+	kvfree(mm->futex_phash);
+	mm->futex_phash = NULL;
+}
+
+static int futex_hash_allocate(unsigned long slots)
+{
+	struct mm_struct *mm = current->mm;
+	struct futex_private_hash *fph;
+	unsigned int i;
+
+	if (!slots)
+		slots = 4 * num_online_cpus();
+	else if (slots > FUTEX_PRIVATE_HASH_MAX)
+		return -EINVAL;
+
+	slots = roundup_pow_of_two(slots);
+	slots = clamp_t(unsigned long, slots, FUTEX_PRIVATE_HASH_MIN,
+			min_t(unsigned long, futex_hashsize,
+			      FUTEX_PRIVATE_HASH_MAX));
+
+	/*
+	 * Other users of the mm could have waiters queued in the global
+	 * hash which would become unreachable once private keys hash
+	 * elsewhere.
+	 */
+	if (atomic_read(&mm->mm_users) != 1 || mm->futex_phash)
+		return -EBUSY;
+
+	fph = kvzalloc(struct_size(fph, queues, slots), GFP_KERNEL_ACCOUNT);
+	if (!fph)
+		return -ENOMEM;
+
+	fph->hash_mask = slots - 1;
+	for (i = 0; i < slots; i++)
+		futex_hash_bucket_init(&fph->queues[i]);
+
+	WRITE_ONCE(mm->futex_phash, fph);
+	return 0;
+}
+
+int futex_hash_prctl(unsigned long arg2, unsigned long arg3,
+		     unsigned long arg4, unsigned long arg5)
+{
+	struct futex_private_hash *fph;
+
+	if (!current->mm || arg4 || arg5)
+		return -EINVAL;
+
+	switch (arg2) {
+	case PR_FUTEX_HASH_SET_SLOTS:
+		return futex_hash_allocate(arg3);
+	case PR_FUTEX_HASH_GET_SLOTS:
+		if (arg3)
+			return -EINVAL;
+		fph = READ_ONCE(current->mm->futex_phash);
+		return fph ? fph->hash_mask + 1 : 0;
+	default:
+		return -EINVAL;
+	}
+}
+
+#ifdef CONFIG_NUMA
+static void __init futex_node_init(void)
+{
+	unsigned long i;
+	int node;
+
+	futex_node_queues = kcalloc(nr_node_ids, sizeof(*futex_node_queues),
+				    GFP_KERNEL);
+	if (!futex_node_queues)
+		return;
+
+	futex_node_hashsize = roundup_pow_of_two(max(16UL,
+				futex_hashsize / num_possible_nodes()));
+
+	for_each_node(node) {
+		struct futex_hash_bucket *queues;
+
+		queues = kvmalloc_node(array_size(futex_node_hashsize,
+						  sizeof(*queues)),
+				       GFP_KERNEL, node);
+		if (!queues)
+			continue;
+
+		for (i = 0; i < futex_node_hashsize; i++)
+			futex_hash_bucket_init(&queues[i]);
+		futex_node_queues[node] = queues;
+	}
+}
+#else
+static inline void futex_node_init(void) { }
+#endif
+
 static int __init futex_init(void)
 {
 	unsigned int futex_shift;
@@ -1130,11 +1316,12 @@ static int __init futex_init(void)
 					       futex_hashsize, futex_hashsize);
 	futex_hashsize = 1UL << futex_shift;
 
-	for (i = 0; i < futex_hashsize; i++) {
-		atomic_set(&futex_queues[i].waiters, 0);
-		plist_head_init(&futex_queues[i].chain);
-		spin_lock_init(&futex_queues[i].lock);
-	}
+	for (i = 0; i < futex_hashsize; i++)
+		futex_hash_bucket_init(&futex_queues[i]);
+
+	BUILD_BUG_ON(PAGE_SHIFT > FUT_OFF_NODE_SHIFT);
+	BUILD_BUG_ON(MAX_NUMNODES >= (1U << (32 - FUT_OFF_NODE_SHIFT)));
+	futex_node_init();
 
 	return 0;
 }
@@ -1,6 +1,7 @@
 // SPDX-License-Identifier: GPL-2.0-or-later
 
 #include <linux/slab.h>
+#include <linux/sched/signal.h>
 #include <linux/sched/task.h>
 
 #include "futex.h"
@@ -918,6 +919,83 @@ int fixup_pi_owner(u32 __user *uaddr, struct futex_q *q, int locked)
 	return 0;
 }
 
+#ifdef CONFIG_LOCK_SPIN_ON_OWNER
+/*
+ * Optimistically spin while the owner of an uncontended PI futex is running,
+ * in the hope that it releases the futex from user space shortly. This takes
+ * the lock without setting FUTEX_WAITERS, so neither this task nor the owner
+ * (whose unlock would otherwise have to enter the kernel) has to schedule.
+ *
+ * Only a single task per hash bucket spins on an owner, the others queue on
+ * the bucket's osq like mutex spinners do. Spinning ends as soon as a waiter
+ * is queued in the kernel, the owner is preempted or we have to reschedule.
+ *
+ * Returns true when the futex was acquired.
+ */
+static bool futex_pi_spin_on_owner(u32 __user *uaddr, struct futex_hash_bucket *hb)
+{
+	u32 uval, curval, vpid = task_pid_vnr(current);
+	struct task_struct *owner = NULL;
+	pid_t owner_pid = 0;
+	bool locked = false;
+
+	/* The osq node is per CPU, stay on it until osq_unlock(). */
+	preempt_disable();
+	if (!osq_lock(&hb->osq)) {
+		preempt_enable();
+		return false;
+	}
+
+	rcu_read_lock();
+	for (;;) {
+		if (futex_get_value_locked(&uval, uaddr))
+			break;
+
+		/* Queued waiters or a dead owner need the slow path. */
+		if (uval & ~FUTEX_TID_MASK)
+			break;
+
+		if (!uval) {
+			if (futex_cmpxchg_value_locked(&curval, uaddr, 0, vpid))
+				break;
+			if (!curval) {
+				locked = true;
+				break;
+			}
+			continue;
+		}
+
+		if (uval != owner_pid) {
+			owner_pid = uval;
+			owner = find_task_by_vpid(owner_pid);
+			if (!owner || owner == current)
+				break;
+		}
+
+		/*
+		 * @owner stays valid under rcu_read_lock() even if it exits;
+		 * the TID in the futex word is checked again above.
+		 */
+		if (!owner_on_cpu(owner) || need_resched() ||
+		    signal_pending(current))
+			break;
+
+		cpu_relax();
+	}
+	rcu_read_unlock();
+
+	osq_unlock(&hb->osq);
+	preempt_enable();
+	return locked;
+}
+#else
+static inline bool futex_pi_spin_on_owner(u32 __user *uaddr,
+					  struct futex_hash_bucket *hb)
+{
+	return false;
+}
+#endif
+
 /*
  * Userspace tried a 0 -> TID atomic transition of the futex value
  * and failed. The kernel side here does the whole locking operation:
@@ -945,10 +1023,13 @@ int futex_lock_pi(u32 __user *uaddr, unsigned int flags, ktime_t *time, int tryl
 	to = futex_setup_timer(time, &timeout, flags, 0);
 
 retry:
-	ret = get_futex_key(uaddr, flags & FLAGS_SHARED, &q.key, FUTEX_WRITE);
+	ret = get_futex_key(uaddr, flags, &q.key, FUTEX_WRITE);
 	if (unlikely(ret != 0))
 		goto out;
 
+	if (!trylock && futex_pi_spin_on_owner(uaddr, futex_hash(&q.key)))
+		goto out;
+
 retry_private:
 	hb = futex_q_lock(&q);
 
@@ -1117,7 +1198,7 @@ int futex_unlock_pi(u32 __user *uaddr, unsigned int flags)
 	if ((uval & FUTEX_TID_MASK) != vpid)
 		return -EPERM;
 
-	ret = get_futex_key(uaddr, flags & FLAGS_SHARED, &key, FUTEX_WRITE);
+	ret = get_futex_key(uaddr, flags, &key, FUTEX_WRITE);
 	if (ret)
 		return ret;
 
@@ -9,6 +9,56 @@
 #include <linux/cpu.h>
 #include <linux/sort.h>
 
+/*
+ * How managed vectors of a node are spread over its CPUs:
+ *
+ * IRQ_SPREAD_NODE:	plain CPU order within the node (historic default)
+ * IRQ_SPREAD_LLC:	balance over the last level cache groups the
+ *			scheduler's MC domain is built from
+ * IRQ_SPREAD_CLUSTER:	balance over the scheduler's cluster groups
+ *
+ * The topology aware modes also hand out whole cores to a vector as long
+ * as there are at least as many cores as vectors, so that two vectors do
+ * not end up on SMT siblings of the same core.
+ */
+enum {
+	IRQ_SPREAD_NODE,
+	IRQ_SPREAD_LLC,
+	IRQ_SPREAD_CLUSTER,
+};
+
+static unsigned int irq_spread_mode __ro_after_init = IRQ_SPREAD_NODE;
+
+static int __init irq_spread_setup(char *str)
+{
+	if (!strcmp(str, "node"))
+		irq_spread_mode = IRQ_SPREAD_NODE;
+	else if (!strcmp(str, "llc"))
+		irq_spread_mode = IRQ_SPREAD_LLC;
+	else if (!strcmp(str, "cluster"))
+		irq_spread_mode = IRQ_SPREAD_CLUSTER;
+	else
+		pr_warn("irqaffinity_spread: unknown mode '%s'\n", str);
+	return 1;
+}
+__setup("irqaffinity_spread=", irq_spread_setup);
+
+static const struct cpumask *irq_spread_group_mask(int cpu)
+{
+	switch (irq_spread_mode) {
+#ifdef CONFIG_SCHED_MC
+	case IRQ_SPREAD_LLC:
+		return cpu_coregroup_mask(cpu);
+#endif
+#ifdef CONFIG_SCHED_CLUSTER
+	case IRQ_SPREAD_CLUSTER:
+		return cpu_clustergroup_mask(cpu);
+#endif
+	default:
+		return NULL;
+	}
+}
+
 static void irq_spread_init_one(struct cpumask *irqmsk, struct cpumask *nmsk,
 				unsigned int cpus_per_vec)
 {
@@ -40,6 +90,39 @@ static void irq_spread_init_one(struct cpumask *irqmsk, struct cpumask *nmsk,
 	}
 }
 
+/* Move @ncores whole cores from @nmsk to @irqmsk */
+static void irq_spread_init_cores(struct cpumask *irqmsk, struct cpumask *nmsk,
+				  unsigned int ncores)
+{
+	int cpu, sibl;
+
+	for ( ; ncores > 0; ncores--) {
+		cpu = cpumask_first(nmsk);
+		if (cpu >= nr_cpu_ids)
+			return;
+
+		for_each_cpu_and(sibl, topology_sibling_cpumask(cpu), nmsk) {
+			cpumask_clear_cpu(sibl, nmsk);
+			cpumask_set_cpu(sibl, irqmsk);
+		}
+		/* Make sure @cpu itself moves even with odd sibling masks */
+		cpumask_clear_cpu(cpu, nmsk);
+		cpumask_set_cpu(cpu, irqmsk);
+	}
+}
+
+static unsigned int irq_count_cores(const struct cpumask *msk)
+{
+	unsigned int ncores = 0;
+	int cpu;
+
+	for_each_cpu(cpu, msk) {
+		if (cpumask_first_and(topology_sibling_cpumask(cpu), msk) >= cpu)
+			ncores++;
+	}
+	return ncores;
+}
+
 static cpumask_var_t *alloc_node_to_cpumask(void)
 {
 	cpumask_var_t *masks;
@@ -113,47 +196,29 @@ static int ncpus_cmp_func(const void *l, const void *r)
 }
 
 /*
- * Allocate vector number for each node, so that for each node:
+ * Allocate vector number for each group (NUMA node or cache group within
+ * a node) whose ncpus is not UINT_MAX, so that for each group:
  *
  * 1) the allocated number is >= 1
  *
- * 2) the allocated numbver is <= active CPU number of this node
+ * 2) the allocated numbver is <= active CPU number of this group
  *
  * The actual allocated total vectors may be less than @numvecs when
  * active total CPU number is less than @numvecs.
- *
- * Active CPUs means the CPUs in '@cpu_mask AND @node_to_cpumask[]'
- * for each node.
  */
-static void alloc_nodes_vectors(unsigned int numvecs,
-				cpumask_var_t *node_to_cpumask,
-				const struct cpumask *cpu_mask,
-				const nodemask_t nodemsk,
-				struct cpumask *nmsk,
-				struct node_vectors *node_vectors)
+static void alloc_groups_vectors(unsigned int numvecs, unsigned int ngroups,
+				 struct node_vectors *node_vectors)
 {
 	unsigned n, remaining_ncpus = 0;
 
-	for (n = 0; n < nr_node_ids; n++) {
-		node_vectors[n].id = n;
-		node_vectors[n].ncpus = UINT_MAX;
-	}
-
-	for_each_node_mask(n, nodemsk) {
-		unsigned ncpus;
-
-		cpumask_and(nmsk, cpu_mask, node_to_cpumask[n]);
-		ncpus = cpumask_weight(nmsk);
-
-		if (!ncpus)
-			continue;
-		remaining_ncpus += ncpus;
-		node_vectors[n].ncpus = ncpus;
+	for (n = 0; n < ngroups; n++) {
+		if (node_vectors[n].ncpus != UINT_MAX)
+			remaining_ncpus += node_vectors[n].ncpus;
 	}
 
 	numvecs = min_t(unsigned, remaining_ncpus, numvecs);
 
-	sort(node_vectors, nr_node_ids, sizeof(node_vectors[0]),
+	sort(node_vectors, ngroups, sizeof(node_vectors[0]),
 	     ncpus_cmp_func, NULL);
 
 	/*
@@ -224,7 +289,7 @@ static void alloc_nodes_vectors(unsigned int numvecs,
 	 * finally for each node X: vecs(X) <= ncpu(X).
 	 *
 	 */
-	for (n = 0; n < nr_node_ids; n++) {
+	for (n = 0; n < ngroups; n++) {
 		unsigned nvectors, ncpus;
 
 		if (node_vectors[n].ncpus == UINT_MAX)
@@ -244,6 +309,156 @@ static void alloc_nodes_vectors(unsigned int numvecs,
 	}
 }
 
+/*
+ * Allocate vector number for each node. Active CPUs means the CPUs in
+ * '@cpu_mask AND @node_to_cpumask[]' for each node.
+ */
+static void alloc_nodes_vectors(unsigned int numvecs,
+				cpumask_var_t *node_to_cpumask,
+				const struct cpumask *cpu_mask,
+				const nodemask_t nodemsk,
+				struct cpumask *nmsk,
+				struct node_vectors *node_vectors)
+{
+	unsigned n;
+
+	for (n = 0; n < nr_node_ids; n++) {
+		node_vectors[n].id = n;
+		node_vectors[n].ncpus = UINT_MAX;
+	}
+
+	for_each_node_mask(n, nodemsk) {
+		unsigned ncpus;
+
+		cpumask_and(nmsk, cpu_mask, node_to_cpumask[n]);
+		ncpus = cpumask_weight(nmsk);
+
+		if (!ncpus)
+			continue;
+		node_vectors[n].ncpus = ncpus;
+	}
+
+	alloc_groups_vectors(numvecs, nr_node_ids, node_vectors);
+}
+
+/*
+ * Spread @nvectors vectors over the CPUs of one cache group in @gmsk.
+ * Whole cores are handed out when the group has enough of them, otherwise
+ * fall back to splitting by CPU, keeping siblings in the same vector.
+ */
+static void irq_spread_group(unsigned int nvectors, struct cpumask *gmsk,
+			     unsigned int *curvec, unsigned int firstvec,
+			     unsigned int last_affv,
+			     struct irq_affinity_desc *masks)
+{
+	unsigned int ncpus = cpumask_weight(gmsk);
+	unsigned int ncores = irq_count_cores(gmsk);
+	unsigned int units = nvectors <= ncores ? ncores : ncpus;
+	unsigned int v, per_vec, extra_vecs;
+
+	if (!nvectors)
+		return;
+
+	per_vec = units / nvectors;
+	extra_vecs = units - nvectors * per_vec;
+
+	for (v = 0; v < nvectors; v++, (*curvec)++) {
+		unsigned int n = per_vec;
+
+		if (extra_vecs) {
+			n++;
+			--extra_vecs;
+		}
+
+		if (*curvec >= last_affv)
+			*curvec = firstvec;
+		if (units == ncores)
+			irq_spread_init_cores(&masks[*curvec].mask, gmsk, n);
+		else
+			irq_spread_init_one(&masks[*curvec].mask, gmsk, n);
+	}
+}
+
+/*
+ * Spread @nvectors vectors over the CPUs of one node in @nmsk, balancing
+ * them over the node's cache groups first. @nmsk is consumed.
+ */
+static int irq_spread_node_groups(unsigned int nvectors, struct cpumask *nmsk,
+				  unsigned int *curvec, unsigned int firstvec,
+				  unsigned int last_affv,
+				  struct irq_affinity_desc *masks)
+{
+	struct node_vectors *group_vectors;
+	unsigned int g, ngroups = 0;
+	cpumask_var_t rest, gmsk;
+	int cpu, ret = -ENOMEM;
+
+	if (!zalloc_cpumask_var(&rest, GFP_KERNEL))
+		return ret;
+	if (!zalloc_cpumask_var(&gmsk, GFP_KERNEL))
+		goto fail_rest;
+	group_vectors = kcalloc(cpumask_weight(nmsk), sizeof(*group_vectors),
+				GFP_KERNEL);
+	if (!group_vectors)
+		goto fail_gmsk;
+
+	/* Each group is identified by its first CPU in @nmsk */
+	cpumask_copy(rest, nmsk);
+	while ((cpu = cpumask_first(rest)) < nr_cpu_ids) {
+		cpumask_and(gmsk, rest, irq_spread_group_mask(cpu));
+		cpumask_set_cpu(cpu, gmsk);
+		cpumask_andnot(rest, rest, gmsk);
+
+		group_vectors[ngroups].id = cpu;
+		group_vectors[ngroups].ncpus = cpumask_weight(gmsk);
+		ngroups++;
+	}
+
+	/*
+	 * Fewer vectors than groups: like the numvecs <= nodes case, give
+	 * each vector whole groups in round robin order.
+	 */
+	if (nvectors <= ngroups) {
+		for (g = 0; g < ngroups; g++) {
+			unsigned int v = *curvec + g % nvectors;
+
+			if (v >= last_affv)
+				v -= last_affv - firstvec;
+			cpu = group_vectors[g].id;
+			cpumask_and(gmsk, nmsk, irq_spread_group_mask(cpu));
+			cpumask_set_cpu(cpu, gmsk);
+			cpumask_andnot(nmsk, nmsk, gmsk);
+			cpumask_or(&masks[v].mask, &masks[v].mask, gmsk);
+		}
+		*curvec += nvectors;
+		ret = 0;
+		goto out;
+	}
+
+	alloc_groups_vectors(nvectors, ngroups, group_vectors);
+
+	for (g = 0; g < ngroups; g++) {
+		struct node_vectors *gv = &group_vectors[g];
+
+		cpumask_and(gmsk, nmsk, irq_spread_group_mask(gv->id));
+		cpumask_set_cpu(gv->id, gmsk);
+		cpumask_andnot(nmsk, nmsk, gmsk);
+
+		if (WARN_ON_ONCE(gv->nvectors > cpumask_weight(gmsk)))
+			gv->nvectors = cpumask_weight(gmsk);
+		irq_spread_group(gv->nvectors, gmsk, curvec, firstvec,
+				 last_affv, masks);
+	}
+	ret = 0;
+ out:
+	kfree(group_vectors);
+ fail_gmsk:
+	free_cpumask_var(gmsk);
+ fail_rest:
+	free_cpumask_var(rest);
+	return ret;
+}
+
 static int __irq_build_affinity_masks(unsigned int startvec,
 				      unsigned int numvecs,
 				      unsigned int firstvec,
@@ -303,6 +518,20 @@ static int __irq_build_affinity_masks(unsigned int startvec,
 
 		WARN_ON_ONCE(nv->nvectors > ncpus);
 
+		/* A non NULL group mask means a topology aware mode is on */
+		if (nv->nvectors > 1 && irq_spread_group_mask(cpumask_first(nmsk))) {
+			int ret;
+
+			ret = irq_spread_node_groups(nv->nvectors, nmsk, &curvec,
+						     firstvec, last_affv, masks);
+			if (ret) {
+				kfree(node_vectors);
+				return ret;
+			}
+			done += nv->nvectors;
+			continue;
+		}
+
 		/* Account for rounding errors */
 		extra_vecs = ncpus - nv->nvectors * (ncpus / nv->nvectors);
 
@@ -0,0 +1,311 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * Sampled lock contention records
+ *
+ * While enabled, the contention_begin/contention_end tracepoints are hooked
+ * and every Nth contended acquisition is recorded into a per-CPU ring: the
+ * lock, the first caller outside the locking code, the wait time and, where
+ * the lock type tracks it, the holder at the time we started waiting.
+ *
+ * Only the outermost contended lock of a context is sampled. A task keeps
+ * its pending sample in task_struct because sleeping locks may finish on
+ * another CPU, interrupt contexts use a per-CPU one.
+ *
+ * Writing N to /proc/lock_contention samples every Nth contention, 0 turns
+ * sampling off. Reading it drains the rings of all online CPUs.
+ */
+#include <linux/kernel.h>
+#include <linux/mutex.h>
+#include <linux/percpu.h>
+#include <linux/proc_fs.h>
+#include <linux/rwsem.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+#include <linux/sched/debug.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/stacktrace.h>
+#include <linux/uaccess.h>
+#include <trace/events/lock.h>
+
+#include "lock_contention.h"
+
+#define LC_RECORDS	256
+#define LC_STACK_DEPTH	12
+
+struct lock_contention_record {
+	void			*lock;
+	unsigned long		callsite;
+	u64			wait_ns;
+	pid_t			holder;
+	unsigned int		flags;
+};
+
+struct lock_contention_cpu {
+	struct lock_contention_frame	frame;	/* non-task contexts */
+	unsigned int			skipped;
+	unsigned int			head;
+	unsigned int			count;
+	bool				busy;
+	struct lock_contention_record	records[LC_RECORDS];
+};
+
+struct lock_contention_snapshot {
+	unsigned int			nr;
+	struct {
+		int				cpu;
+		struct lock_contention_record	rec;
+	} entries[];
+};
+
+static struct lock_contention_cpu __percpu *lc_cpu;
+static DEFINE_MUTEX(lc_mutex);
+static unsigned int lc_period __read_mostly;
+static unsigned int lc_gen __read_mostly;
+
+static inline struct lock_contention_frame *
+lc_frame(struct lock_contention_cpu *lcc)
+{
+	return in_task() ? &current->lock_contention : &lcc->frame;
+}
+
+/* The first return address outside of the lock and scheduler functions. */
+static unsigned long lc_callsite(void)
+{
+	unsigned long entries[LC_STACK_DEPTH];
+	unsigned int i, nr;
+	bool in_lock = false;
+
+	nr = stack_trace_save(entries, ARRAY_SIZE(entries), 0);
+	for (i = 0; i < nr; i++) {
+		if (in_sched_functions(entries[i]))
+			in_lock = true;
+		else if (in_lock)
+			return entries[i];
+	}
+	return 0;
+}
+
+/*
+ * Called with preemption disabled, so a task_struct found through the owner
+ * field stays valid until we have read its pid.
+ */
+static pid_t lc_holder(void *lock, unsigned int flags)
+{
+	struct task_struct *owner = NULL;
+
+	if (flags & LCB_F_MUTEX)
+		owner = mutex_contention_holder(lock);
+	else if ((flags & (LCB_F_READ | LCB_F_WRITE)) &&
+		 !(flags & (LCB_F_SPIN | LCB_F_RT | LCB_F_PERCPU)))
+		owner = rwsem_contention_holder(lock);
+
+	return owner ? task_pid_nr(owner) : 0;
+}
+
+static void lc_contention_begin(void *data, void *lock, unsigned int flags)
+{
+	struct lock_contention_frame *frame;
+	struct lock_contention_cpu *lcc;
+	unsigned int gen = READ_ONCE(lc_gen);
+	unsigned long irqflags;
+
+	local_irq_save(irqflags);
+	lcc = this_cpu_ptr(lc_cpu);
+	if (lcc->busy)
+		goto out;
+
+	frame = lc_frame(lcc);
+	if (frame->lock && frame->gen == gen) {
+		/* e.g. a mutex that stopped spinning and goes to sleep */
+		if (frame->lock == lock)
+			frame->flags = flags;
+		goto out;
+	}
+	frame->lock = NULL;
+
+	if (++lcc->skipped < READ_ONCE(lc_period))
+		goto out;
+	lcc->skipped = 0;
+
+	lcc->busy = true;
+	frame->callsite = lc_callsite();
+	frame->holder = lc_holder(lock, flags);
+	frame->flags = flags;
+	frame->gen = gen;
+	frame->lock = lock;
+	frame->start = local_clock();
+	lcc->busy = false;
+out:
+	local_irq_restore(irqflags);
+}
+
+static void lc_contention_end(void *data, void *lock, int ret)
+{
+	struct lock_contention_record *rec;
+	struct lock_contention_frame *frame;
+	struct lock_contention_cpu *lcc;
+	unsigned long irqflags;
+	u64 now = local_clock();
+
+	local_irq_save(irqflags);
+	lcc = this_cpu_ptr(lc_cpu);
+	if (lcc->busy)
+		goto out;
+
+	frame = lc_frame(lcc);
+	if (frame->lock != lock || frame->gen != READ_ONCE(lc_gen))
+		goto out;
+	frame->lock = NULL;
+
+	rec = &lcc->records[lcc->head];
+	rec->lock = lock;
+	rec->callsite = frame->callsite;
+	/* local_clock() of another CPU, if we slept and migrated */
+	rec->wait_ns = (s64)(now - frame->start) > 0 ? now - frame->start : 0;
+	rec->holder = frame->holder;
+	rec->flags = frame->flags;
+
+	lcc->head = (lcc->head + 1) % LC_RECORDS;
+	if (lcc->count < LC_RECORDS)
+		lcc->count++;
+out:
+	local_irq_restore(irqflags);
+}
+
+/* Runs on the CPU whose ring is drained, with interrupts disabled. */
+static void lc_drain_cpu(void *info)
+{
+	struct lock_contention_snapshot *snap = info;
+	struct lock_contention_cpu *lcc = this_cpu_ptr(lc_cpu);
+	unsigned int i, idx;
+
+	idx = (lcc->head + LC_RECORDS - lcc->count) % LC_RECORDS;
+	for (i = 0; i < lcc->count; i++) {
+		snap->entries[snap->nr].cpu = smp_processor_id();
+		snap->entries[snap->nr].rec = lcc->records[idx];
+		snap->nr++;
+		idx = (idx + 1) % LC_RECORDS;
+	}
+	lcc->count = 0;
+}
+
+static int lc_show(struct seq_file *m, void *v)
+{
+	struct lock_contention_snapshot *snap = m->private;
+	unsigned int i;
+
+	seq_puts(m, "# cpu lock flags wait_ns holder callsite\n");
+	for (i = 0; i < snap->nr; i++) {
+		struct lock_contention_record *rec = &snap->entries[i].rec;
+
+		seq_printf(m, "%d %p %#x %llu %d %pS\n", snap->entries[i].cpu,
+			   rec->lock, rec->flags, rec->wait_ns, rec->holder,
+			   (void *)rec->callsite);
+	}
+	return 0;
+}
+
+static int lc_open(struct inode *inode, struct file *file)
+{
+	struct lock_contention_snapshot *snap;
+	int cpu, ret;
+
+	snap = kvzalloc(struct_size(snap, entries, num_possible_cpus() * LC_RECORDS),
+			GFP_KERNEL);
+	if (!snap)
+		return -ENOMEM;
+
+	mutex_lock(&lc_mutex);
+	if (lc_cpu) {
+		cpus_read_lock();
+		for_each_online_cpu(cpu)
+			smp_call_function_single(cpu, lc_drain_cpu, snap, 1);
+		cpus_read_unlock();
+	}
+	mutex_unlock(&lc_mutex);
+
+	ret = single_open(file, lc_show, snap);
+	if (ret)
+		kvfree(snap);
+	return ret;
+}
+
+static int lc_release(struct inode *inode, struct file *file)
+{
+	struct seq_file *m = file->private_data;
+
+	kvfree(m->private);
+	return single_release(inode, file);
+}
+
+static int lc_set_period(unsigned int period)
+{
+	int ret = 0;
+
+	mutex_lock(&lc_mutex);
+	if (period && !lc_cpu) {
+		lc_cpu = alloc_percpu(struct lock_contention_cpu);
+		if (!lc_cpu) {
+			ret = -ENOMEM;
+			goto out;
+		}
+	}
+
+	if (period && !lc_period) {
+		/* Pending frames from an earlier session are stale now. */
+		WRITE_ONCE(lc_gen, lc_gen + 1);
+		WRITE_ONCE(lc_period, period);
+		ret = register_trace_contention_begin(lc_contention_begin, NULL);
+		if (!ret) {
+			ret = register_trace_contention_end(lc_contention_end, NULL);
+			if (ret)
+				unregister_trace_contention_begin(lc_contention_begin,
+								  NULL);
+		}
+		if (ret) {
+			tracepoint_synchronize_unregister();
+			WRITE_ONCE(lc_period, 0);
+		}
+	} else if (!period && lc_period) {
+		unregister_trace_contention_begin(lc_contention_begin, NULL);
+		unregister_trace_contention_end(lc_contention_end, NULL);
+		tracepoint_synchronize_unregister();
+		WRITE_ONCE(lc_period, 0);
+	} else {
+		WRITE_ONCE(lc_period, period);
+	}
+out:
+	mutex_unlock(&lc_mutex);
+	return ret;
+}
+
+static ssize_t lc_write(struct file *file, const char __user *buf,
+			size_t count, loff_t *ppos)
+{
+	unsigned int period;
+	int ret;
+
+	ret = kstrtouint_from_user(buf, count, 0, &period);
+	if (ret)
+		return ret;
+
+	ret = lc_set_period(period);
+	return ret ? ret : count;
+}
+
+static const struct proc_ops lc_proc_ops = {
+	.proc_open	= lc_open,
+	.proc_read	= seq_read,
+	.proc_write	= lc_write,
+	.proc_lseek	= seq_lseek,
+	.proc_release	= lc_release,
+};
+
+static int __init lock_contention_init(void)
+{
+	proc_create("lock_contention", 0600, NULL, &lc_proc_ops);
+	return 0;
+}
+device_initcall(lock_contention_init);
@@ -0,0 +1,23 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+#ifndef __LOCKING_LOCK_CONTENTION_H
+#define __LOCKING_LOCK_CONTENTION_H
+
+struct mutex;
+struct rw_semaphore;
+struct task_struct;
+
+#if defined(CONFIG_LOCK_CONTENTION_SAMPLER) && !defined(CONFIG_PREEMPT_RT)
+extern struct task_struct *mutex_contention_holder(struct mutex *lock);
+extern struct task_struct *rwsem_contention_holder(struct rw_semaphore *sem);
+#else
+static inline struct task_struct *mutex_contention_holder(struct mutex *lock)
+{
+	return NULL;
+}
+static inline struct task_struct *rwsem_contention_holder(struct rw_semaphore *sem)
+{
+	return NULL;
+}
+#endif
+
+#endif /* __LOCKING_LOCK_CONTENTION_H */
@@ -33,6 +33,8 @@
 #define CREATE_TRACE_POINTS
 #include <trace/events/lock.h>
 
+#include "lock_contention.h"
+
 #ifndef CONFIG_PREEMPT_RT
 #include "mutex.h"
 
@@ -86,6 +88,13 @@ static inline struct task_struct *__owner_task(unsigned long owner)
 	return (struct task_struct *)(owner & ~MUTEX_FLAGS);
 }
 
+#ifdef CONFIG_LOCK_CONTENTION_SAMPLER
+struct task_struct *mutex_contention_holder(struct mutex *lock)
+{
+	return __mutex_owner(lock);
+}
+#endif
+
 bool mutex_is_locked(struct mutex *lock)
 {
 	return __mutex_owner(lock) != NULL;
@@ -0,0 +1,156 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Reader biased rw_semaphore, after "BRAVO - Biased Locking for Reader-Writer
+ * Locks" (Dice, Kogan; USENIX ATC 2019).
+ *
+ * A biased reader claims the slot that (lock, task) hashes to in the global
+ * visible readers table and then re-checks the bias; a writer clears the bias
+ * and then scans the table. The two sides order their store-then-load with a
+ * full barrier, so either the reader sees the bias gone and backs off to the
+ * rwsem, or the writer sees the reader's slot and waits for it.
+ */
+#include <linux/atomic.h>
+#include <linux/cache.h>
+#include <linux/export.h>
+#include <linux/hash.h>
+#include <linux/lockdep.h>
+#include <linux/rbias-rwsem.h>
+#include <linux/sched.h>
+#include <linux/sched/clock.h>
+
+#define RBIAS_SLOT_BITS		11
+#define RBIAS_SLOTS		(1U << RBIAS_SLOT_BITS)
+/* Keep the bias off for this many times the last revocation took. */
+#define RBIAS_INHIBIT_MULT	9
+/* Spin this long on a visible reader before sleeping on it. */
+#define RBIAS_SPINS		1000
+
+struct rbias_reader {
+	struct rbias_rw_semaphore	*sem;
+	struct task_struct		*task;
+};
+
+static struct rbias_reader rbias_readers[RBIAS_SLOTS] __cacheline_aligned;
+
+static inline struct rbias_reader *rbias_slot(struct rbias_rw_semaphore *sem)
+{
+	return &rbias_readers[hash_long((unsigned long)sem ^
+					(unsigned long)current,
+					RBIAS_SLOT_BITS)];
+}
+
+static inline void rbias_slot_clear(struct rbias_reader *slot)
+{
+	WRITE_ONCE(slot->task, NULL);
+	smp_store_release(&slot->sem, NULL);
+}
+
+static bool rbias_read_fast(struct rbias_rw_semaphore *sem)
+{
+	struct rbias_reader *slot;
+
+	if (!READ_ONCE(sem->rbias))
+		return false;
+
+	slot = rbias_slot(sem);
+	if (cmpxchg(&slot->sem, NULL, sem))
+		return false;
+	WRITE_ONCE(slot->task, current);
+
+	/*
+	 * The successful cmpxchg() is fully ordered, pairs with the smp_mb()
+	 * in rbias_revoke().
+	 */
+	if (likely(READ_ONCE(sem->rbias)))
+		return true;
+
+	rbias_slot_clear(slot);
+	return false;
+}
+
+/* Called with the rwsem read locked, so no writer can be revoking. */
+static void rbias_maybe_enable(struct rbias_rw_semaphore *sem)
+{
+	if (!READ_ONCE(sem->rbias) && local_clock() >= sem->inhibit_until)
+		WRITE_ONCE(sem->rbias, true);
+}
+
+void rbias_down_read(struct rbias_rw_semaphore *sem)
+{
+	might_sleep();
+
+	if (rbias_read_fast(sem)) {
+		rwsem_acquire_read(&sem->rwsem.dep_map, 0, 0, _RET_IP_);
+		return;
+	}
+
+	down_read(&sem->rwsem);
+	rbias_maybe_enable(sem);
+}
+EXPORT_SYMBOL_GPL(rbias_down_read);
+
+int rbias_down_read_trylock(struct rbias_rw_semaphore *sem)
+{
+	if (rbias_read_fast(sem)) {
+		rwsem_acquire_read(&sem->rwsem.dep_map, 0, 1, _RET_IP_);
+		return 1;
+	}
+
+	if (!down_read_trylock(&sem->rwsem))
+		return 0;
+	rbias_maybe_enable(sem);
+	return 1;
+}
+EXPORT_SYMBOL_GPL(rbias_down_read_trylock);
+
+void rbias_up_read(struct rbias_rw_semaphore *sem)
+{
+	struct rbias_reader *slot = rbias_slot(sem);
+
+	/* Only we can have published ourselves for @sem in this slot. */
+	if (READ_ONCE(slot->sem) == sem && READ_ONCE(slot->task) == current) {
+		rwsem_release(&sem->rwsem.dep_map, _RET_IP_);
+		rbias_slot_clear(slot);
+		return;
+	}
+
+	up_read(&sem->rwsem);
+}
+EXPORT_SYMBOL_GPL(rbias_up_read);
+
+static void rbias_revoke(struct rbias_rw_semaphore *sem)
+{
+	u64 start = local_clock();
+	unsigned int i, spins;
+
+	WRITE_ONCE(sem->rbias, false);
+	/* Pairs with the cmpxchg() in rbias_read_fast(). */
+	smp_mb();
+
+	for (i = 0; i < RBIAS_SLOTS; i++) {
+		for (spins = 0; smp_load_acquire(&rbias_readers[i].sem) == sem;
+		     spins++) {
+			if (spins < RBIAS_SPINS)
+				cpu_relax();
+			else
+				schedule_timeout_uninterruptible(1);
+		}
+	}
+
+	sem->inhibit_until = local_clock() +
+			     (local_clock() - start) * RBIAS_INHIBIT_MULT;
+}
+
+void rbias_down_write(struct rbias_rw_semaphore *sem)
+{
+	down_write(&sem->rwsem);
+	if (READ_ONCE(sem->rbias))
+		rbias_revoke(sem);
+}
+EXPORT_SYMBOL_GPL(rbias_down_write);
+
+void rbias_up_write(struct rbias_rw_semaphore *sem)
+{
+	up_write(&sem->rwsem);
+}
+EXPORT_SYMBOL_GPL(rbias_up_write);
@@ -31,6 +31,7 @@
 
 #ifndef CONFIG_PREEMPT_RT
 #include "lock_events.h"
+#include "lock_contention.h"
 
 /*
  * The least significant 2 bits of the owner value has the following
@@ -282,6 +283,20 @@ rwsem_owner_flags(struct rw_semaphore *sem, unsigned long *pflags)
 	return (struct task_struct *)(owner & ~RWSEM_OWNER_FLAGS_MASK);
 }
 
+#ifdef CONFIG_LOCK_CONTENTION_SAMPLER
+/*
+ * Only a writer owner is exact, the owner field of a reader owned rwsem just
+ * names the last reader that took it.
+ */
+struct task_struct *rwsem_contention_holder(struct rw_semaphore *sem)
+{
+	unsigned long flags;
+	struct task_struct *owner = rwsem_owner_flags(sem, &flags);
+
+	return flags & RWSEM_READER_OWNED ? NULL : owner;
+}
+#endif
+
 /*
  * Guide to the rw_semaphore's count field.
  *
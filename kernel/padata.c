@@ -41,11 +41,10 @@ struct padata_mt_job_state {
 	struct padata_mt_job	*job;
 	int			nworks;
 	int			nworks_fini;
-	unsigned long		chunk_size;
 };
 
 static void padata_free_pd(struct parallel_data *pd);
-static void __init padata_mt_helper(struct work_struct *work);
+static void padata_mt_helper(struct work_struct *work);
 
 static int padata_index_to_cpu(struct parallel_data *pd, int cpu_index)
 {
@@ -93,12 +92,13 @@ static void padata_work_init(struct padata_work *pw, work_func_t work_fn,
 	pw->pw_data = data;
 }
 
-static int __init padata_work_alloc_mt(int nworks, void *data,
-				       struct list_head *head)
+static int padata_work_alloc_mt(int nworks, void *data,
+				struct list_head *head)
 {
 	int i;
 
-	spin_lock(&padata_works_lock);
+	/* padata_do_parallel() takes the lock from softirq context. */
+	spin_lock_bh(&padata_works_lock);
 	/* Start at 1 because the current task participates in the job. */
 	for (i = 1; i < nworks; ++i) {
 		struct padata_work *pw = padata_work_alloc();
@@ -108,7 +108,7 @@ static int __init padata_work_alloc_mt(int nworks, void *data,
 		padata_work_init(pw, padata_mt_helper, data, 0);
 		list_add(&pw->pw_list, head);
 	}
-	spin_unlock(&padata_works_lock);
+	spin_unlock_bh(&padata_works_lock);
 
 	return i;
 }
@@ -119,14 +119,14 @@ static void padata_work_free(struct padata_work *pw)
 	list_add(&pw->pw_list, &padata_free_works);
 }
 
-static void __init padata_works_free(struct list_head *works)
+static void padata_works_free(struct list_head *works)
 {
 	struct padata_work *cur, *next;
 
 	if (list_empty(works))
 		return;
 
-	spin_lock(&padata_works_lock);
+	spin_lock_bh(&padata_works_lock);
 	list_for_each_entry_safe(cur, next, works, pw_list) {
 		list_del(&cur->pw_list);
 		padata_work_free(cur);
@@ -425,7 +425,32 @@ static int padata_setup_cpumasks(struct padata_instance *pinst)
 	return err;
 }
 
-static void __init padata_mt_helper(struct work_struct *w)
+/* In case threads finish at different times. */
+#define PADATA_MT_LOAD_BALANCE_FACTOR	4
+
+/*
+ * Size of the next chunk a helper takes, called with ps->lock held.
+ *
+ * Chunks are handed out guided-self-scheduling style: each one is a share
+ * of the work that is still left rather than of the whole job.  Early
+ * chunks are large, which keeps ps->lock traffic low, and they shrink
+ * towards the caller's minimum as the job drains.  A helper which is slow
+ * (a busy or less capable CPU) is then holding a small chunk when the
+ * others run out of work, instead of a full fixed size one everybody has
+ * to wait for.  Idle helpers keep pulling from the shared remainder, so
+ * no work is ever stuck behind a particular helper.
+ */
+static unsigned long padata_mt_chunk_size(struct padata_mt_job_state *ps)
+{
+	struct padata_mt_job *job = ps->job;
+	unsigned long chunk_size;
+
+	chunk_size = job->size / (ps->nworks * PADATA_MT_LOAD_BALANCE_FACTOR);
+	chunk_size = max(chunk_size, job->min_chunk);
+	return roundup(chunk_size, job->align);
+}
+
+static void padata_mt_helper(struct work_struct *w)
 {
 	struct padata_work *pw = container_of(w, struct padata_work, pw_work);
 	struct padata_mt_job_state *ps = pw->pw_data;
@@ -438,8 +463,9 @@ static void __init padata_mt_helper(struct work_struct *w)
 		unsigned long start, size, end;
 
 		start = job->start;
-		/* So end is chunk size aligned if enough work remains. */
-		size = roundup(start + 1, ps->chunk_size) - start;
+		/* So end is align aligned if enough work remains. */
+		size = roundup(start + padata_mt_chunk_size(ps),
+			       job->align) - start;
 		size = min(size, job->size);
 		end = start + size;
 
@@ -464,16 +490,19 @@ static void __init padata_mt_helper(struct work_struct *w)
  * @job: Description of the job.
  *
  * See the definition of struct padata_mt_job for more details.
+ *
+ * May be called once the system is up as well as during boot.  The calling
+ * task takes part in the job, so this sleeps until all chunks are done.
  */
-void __init padata_do_multithreaded(struct padata_mt_job *job)
+void padata_do_multithreaded(struct padata_mt_job *job)
 {
-	/* In case threads finish at different times. */
-	static const unsigned long load_balance_factor = 4;
 	struct padata_work my_work, *pw;
 	struct padata_mt_job_state ps;
 	LIST_HEAD(works);
 	int nworks;
 
+	might_sleep();
+
 	if (job->size == 0)
 		return;
 
@@ -493,16 +522,6 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	ps.nworks      = padata_work_alloc_mt(nworks, &ps, &works);
 	ps.nworks_fini = 0;
 
-	/*
-	 * Chunk size is the amount of work a helper does per call to the
-	 * thread function.  Load balance large jobs between threads by
-	 * increasing the number of chunks, guarantee at least the minimum
-	 * chunk size from the caller, and honor the caller's alignment.
-	 */
-	ps.chunk_size = job->size / (ps.nworks * load_balance_factor);
-	ps.chunk_size = max(ps.chunk_size, job->min_chunk);
-	ps.chunk_size = roundup(ps.chunk_size, job->align);
-
 	list_for_each_entry(pw, &works, pw_list)
 		queue_work(system_unbound_wq, &pw->pw_work);
 
@@ -516,6 +535,7 @@ void __init padata_do_multithreaded(struct padata_mt_job *job)
 	destroy_work_on_stack(&my_work.pw_work);
 	padata_works_free(&works);
 }
+EXPORT_SYMBOL_GPL(padata_do_multithreaded);
 
 static void __padata_list_init(struct padata_list *pd_list)
 {
@@ -47,6 +47,7 @@
 #include <linux/sched/clock.h>
 #include <linux/sched/debug.h>
 #include <linux/sched/task_stack.h>
+#include <linux/kmsg.h>
 
 #include <linux/uaccess.h>
 #include <asm/sections.h>
@@ -850,26 +851,17 @@ static ssize_t devkmsg_write(struct kiocb *iocb, struct iov_iter *from)
 	return ret;
 }
 
-static ssize_t devkmsg_read(struct file *file, char __user *buf,
-			    size_t count, loff_t *ppos)
+/*
+ * Read the record at @user->seq into @user->record, waiting for it unless
+ * the file is non-blocking.  Called with @user->lock held.
+ */
+static int devkmsg_wait_record(struct file *file, struct devkmsg_user *user)
 {
-	struct devkmsg_user *user = file->private_data;
 	struct printk_record *r = &user->record;
-	size_t len;
-	ssize_t ret;
-
-	if (!user)
-		return -EBADF;
-
-	ret = mutex_lock_interruptible(&user->lock);
-	if (ret)
-		return ret;
 
 	if (!prb_read_valid(prb, atomic64_read(&user->seq), r)) {
-		if (file->f_flags & O_NONBLOCK) {
-			ret = -EAGAIN;
-			goto out;
-		}
+		if (file->f_flags & O_NONBLOCK)
+			return -EAGAIN;
 
 		/*
 		 * Guarantee this task is visible on the waitqueue before
@@ -881,12 +873,31 @@ static ssize_t devkmsg_read(struct file *file, char __user *buf,
 		 *
 		 * This pairs with __wake_up_klogd:A.
 		 */
-		ret = wait_event_interruptible(log_wait,
+		return wait_event_interruptible(log_wait,
 				prb_read_valid(prb,
 					atomic64_read(&user->seq), r)); /* LMM(devkmsg_read:A) */
-		if (ret)
-			goto out;
 	}
+	return 0;
+}
+
+static ssize_t devkmsg_read(struct file *file, char __user *buf,
+			    size_t count, loff_t *ppos)
+{
+	struct devkmsg_user *user = file->private_data;
+	struct printk_record *r = &user->record;
+	size_t len;
+	ssize_t ret;
+
+	if (!user)
+		return -EBADF;
+
+	ret = mutex_lock_interruptible(&user->lock);
+	if (ret)
+		return ret;
+
+	ret = devkmsg_wait_record(file, user);
+	if (ret)
+		goto out;
 
 	if (r->info->seq != atomic64_read(&user->seq)) {
 		/* our last seen message is gone, return error and reset */
@@ -917,6 +928,127 @@ static ssize_t devkmsg_read(struct file *file, char __user *buf,
 	return ret;
 }
 
+/* Copy the record in @user->record to @ubuf as a struct kmsg_record. */
+static int devkmsg_copy_record(struct devkmsg_user *user, char __user *ubuf,
+			       unsigned int rec_len, unsigned int text_len)
+{
+	struct printk_info *info = user->record.info;
+	struct kmsg_record hdr = {
+		.seq		= info->seq,
+		.ts_nsec	= info->ts_nsec,
+		.caller_id	= info->caller_id,
+		.rec_len	= rec_len,
+		.text_len	= text_len,
+		.facility	= info->facility,
+		.level		= info->level,
+	};
+	unsigned int len = sizeof(hdr) + text_len;
+
+	BUILD_BUG_ON(KMSG_SUBSYSTEM_LEN != PRINTK_INFO_SUBSYSTEM_LEN);
+	BUILD_BUG_ON(KMSG_DEVICE_LEN != PRINTK_INFO_DEVICE_LEN);
+
+	if (info->flags & LOG_NEWLINE)
+		hdr.flags |= KMSG_RECORD_NEWLINE;
+	if (info->flags & LOG_CONT)
+		hdr.flags |= KMSG_RECORD_CONT;
+	memcpy(hdr.subsystem, info->dev_info.subsystem, sizeof(hdr.subsystem));
+	memcpy(hdr.device, info->dev_info.device, sizeof(hdr.device));
+
+	if (copy_to_user(ubuf, &hdr, sizeof(hdr)) ||
+	    copy_to_user(ubuf + sizeof(hdr), &user->text_buf[0], text_len) ||
+	    clear_user(ubuf + len, rec_len - len))
+		return -EFAULT;
+	return 0;
+}
+
+/*
+ * Copy as many records as fit into the buffer described by @batch. Unlike
+ * read(), one call returns many records, skips the text formatting and
+ * reports overwritten records in @batch->lost rather than with -EPIPE.
+ */
+static int devkmsg_read_batch(struct file *file, struct devkmsg_user *user,
+			      struct kmsg_read_batch *batch)
+{
+	char __user *ubuf = u64_to_user_ptr(batch->buf);
+	struct printk_record *r = &user->record;
+	u64 seq;
+	int ret;
+
+	ret = mutex_lock_interruptible(&user->lock);
+	if (ret)
+		return ret;
+
+	ret = devkmsg_wait_record(file, user);
+	if (ret)
+		goto out;
+
+	batch->nr_records = 0;
+	batch->used = 0;
+	batch->lost = 0;
+
+	seq = atomic64_read(&user->seq);
+	while (prb_read_valid(prb, seq, r)) {
+		unsigned int text_len, rec_len;
+
+		if (r->info->seq != seq) {
+			batch->lost += r->info->seq - seq;
+			seq = r->info->seq;
+		}
+
+		text_len = min_t(unsigned int, r->info->text_len,
+				 sizeof(user->text_buf));
+		rec_len = ALIGN(sizeof(struct kmsg_record) + text_len, 8);
+		if (rec_len > batch->len - batch->used) {
+			if (!batch->nr_records)
+				ret = -EINVAL;
+			break;
+		}
+
+		ret = devkmsg_copy_record(user, ubuf + batch->used, rec_len,
+					  text_len);
+		if (ret)
+			break;
+
+		batch->used += rec_len;
+		batch->nr_records++;
+		seq = r->info->seq + 1;
+	}
+
+	atomic64_set(&user->seq, seq);
+	batch->next_seq = seq;
+out:
+	mutex_unlock(&user->lock);
+	return ret;
+}
+
+static long devkmsg_ioctl(struct file *file, unsigned int cmd,
+			  unsigned long arg)
+{
+	struct devkmsg_user *user = file->private_data;
+	void __user *argp = (void __user *)arg;
+	struct kmsg_read_batch batch;
+	int ret;
+
+	/* write-only opens skip the syslog permission checks */
+	if (!user || !(file->f_mode & FMODE_READ))
+		return -EBADF;
+	if (cmd != KMSG_IOC_READ_BATCH)
+		return -ENOTTY;
+
+	if (copy_from_user(&batch, argp, sizeof(batch)))
+		return -EFAULT;
+	if (batch.flags)
+		return -EINVAL;
+
+	ret = devkmsg_read_batch(file, user, &batch);
+	if (ret)
+		return ret;
+
+	if (copy_to_user(argp, &batch, sizeof(batch)))
+		return -EFAULT;
+	return 0;
+}
+
 /*
  * Be careful when modifying this function!!!
  *
@@ -1034,6 +1166,8 @@ const struct file_operations kmsg_fops = {
 	.write_iter = devkmsg_write,
 	.llseek = devkmsg_llseek,
 	.poll = devkmsg_poll,
+	.unlocked_ioctl = devkmsg_ioctl,
+	.compat_ioctl = compat_ptr_ioctl,
 	.release = devkmsg_release,
 };
 
@@ -109,6 +109,8 @@ EXPORT_TRACEPOINT_SYMBOL_GPL(sched_overutilized_tp);
 EXPORT_TRACEPOINT_SYMBOL_GPL(sched_util_est_cfs_tp);
 EXPORT_TRACEPOINT_SYMBOL_GPL(sched_util_est_se_tp);
 EXPORT_TRACEPOINT_SYMBOL_GPL(sched_update_nr_running_tp);
+EXPORT_TRACEPOINT_SYMBOL_GPL(sched_asym_select_tp);
+EXPORT_TRACEPOINT_SYMBOL_GPL(sched_misfit_lb_tp);
 
 DEFINE_PER_CPU_SHARED_ALIGNED(struct rq, runqueues);
 
@@ -4565,6 +4567,7 @@ int sched_fork(unsigned long clone_flags, struct task_struct *p)
 
 		p->prio = p->normal_prio = p->static_prio;
 		set_load_weight(p, false);
+		p->latency_nice = DEFAULT_LATENCY_NICE;
 
 		/*
 		 * We don't need the reset flag anymore after the fork. It has
@@ -6086,7 +6089,8 @@ pick_next_task(struct rq *rq, struct task_struct *prev, struct rq_flags *rf)
 out_set_next:
 	set_next_task(rq, next);
 out:
-	if (rq->core->core_forceidle_count && next == rq->idle)
+	if (next == rq->idle &&
+	    (rq->core->core_forceidle_count || sched_feat(CORE_STEAL_IDLE)))
 		queue_core_balance(rq);
 
 	return next;
@@ -6191,7 +6195,12 @@ static void queue_core_balance(struct rq *rq)
 	if (!rq->core->core_cookie)
 		return;
 
-	if (!rq->nr_running) /* not forced idle */
+	/*
+	 * Forced idle CPUs always try to steal a compatible task, plain idle
+	 * ones only with CORE_STEAL_IDLE: pairing up compatible tasks on
+	 * otherwise idle siblings helps both throughput and forced idle.
+	 */
+	if (!rq->nr_running && !sched_feat(CORE_STEAL_IDLE))
 		return;
 
 	queue_balance_callback(rq, &per_cpu(core_balance_head, rq->cpu), sched_core_balance);
@@ -7366,6 +7375,12 @@ static int __sched_setscheduler(struct task_struct *p,
 	    (rt_policy(policy) != (attr->sched_priority != 0)))
 		return -EINVAL;
 
+	if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE) {
+		if (attr->sched_latency_nice > MAX_LATENCY_NICE ||
+		    attr->sched_latency_nice < MIN_LATENCY_NICE)
+			return -EINVAL;
+	}
+
 	/*
 	 * Allow unprivileged RT tasks to decrease priority:
 	 */
@@ -7376,6 +7391,11 @@ static int __sched_setscheduler(struct task_struct *p,
 				return -EPERM;
 		}
 
+		/* Like nice, lowering latency_nice is privileged: */
+		if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+		    attr->sched_latency_nice < p->latency_nice)
+			return -EPERM;
+
 		if (rt_policy(policy)) {
 			unsigned long rlim_rtprio =
 					task_rlimit(p, RLIMIT_RTPRIO);
@@ -7467,6 +7487,9 @@ static int __sched_setscheduler(struct task_struct *p,
 			goto change;
 		if (attr->sched_flags & SCHED_FLAG_UTIL_CLAMP)
 			goto change;
+		if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE &&
+		    attr->sched_latency_nice != p->latency_nice)
+			goto change;
 
 		p->sched_reset_on_fork = reset_on_fork;
 		retval = 0;
@@ -7556,6 +7579,8 @@ static int __sched_setscheduler(struct task_struct *p,
 		__setscheduler_prio(p, newprio);
 	}
 	__setscheduler_uclamp(p, attr);
+	if (attr->sched_flags & SCHED_FLAG_LATENCY_NICE)
+		p->latency_nice = attr->sched_latency_nice;
 
 	if (queued) {
 		/*
@@ -7765,6 +7790,10 @@ static int sched_copy_attr(struct sched_attr __user *uattr, struct sched_attr *a
 	    size < SCHED_ATTR_SIZE_VER1)
 		return -EINVAL;
 
+	if ((attr->sched_flags & SCHED_FLAG_LATENCY_NICE) &&
+	    size < SCHED_ATTR_SIZE_VER2)
+		return -EINVAL;
+
 	/*
 	 * XXX: Do we want to be lenient like existing syscalls; or do we want
 	 * to be strict and return an error on out-of-bounds values?
@@ -8001,6 +8030,7 @@ SYSCALL_DEFINE4(sched_getattr, pid_t, pid, struct sched_attr __user *, uattr,
 		kattr.sched_flags |= SCHED_FLAG_RESET_ON_FORK;
 	get_params(p, &kattr);
 	kattr.sched_flags &= SCHED_FLAG_ALL;
+	kattr.sched_latency_nice = p->latency_nice;
 
 #ifdef CONFIG_UCLAMP_TASK
 	/*
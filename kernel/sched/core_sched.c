@@ -277,7 +277,7 @@ void __sched_core_account_forceidle(struct rq *rq)
 		if (p == rq_i->idle)
 			continue;
 
-		__schedstat_add(p->stats.core_forceidle_sum, delta);
+		__account_forceidle_time(p, delta);
 	}
 }
 
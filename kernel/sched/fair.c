@@ -754,6 +754,13 @@ static u64 sched_slice(struct cfs_rq *cfs_rq, struct sched_entity *se)
 		slice = __calc_delta(slice, se->load.weight, load);
 	}
 
+	/*
+	 * Latency sensitive tasks run in shorter slices, down to half of their
+	 * fair slice, without affecting their share of the CPU.
+	 */
+	if (entity_is_task(init_se) && task_of(init_se)->latency_nice < 0)
+		slice -= slice * -task_of(init_se)->latency_nice / LATENCY_NICE_WIDTH;
+
 	if (sched_feat(BASE_SLICE)) {
 		if (se_is_idle(init_se) && !sched_idle_cfs_rq(cfs_rq))
 			min_gran = sysctl_sched_idle_min_granularity;
@@ -4213,6 +4220,19 @@ static inline int task_fits_capacity(struct task_struct *p,
 	return fits_capacity(uclamp_task_util(p), capacity);
 }
 
+/*
+ * Does @p keep its CPU, which isn't one of the biggest, at least half busy?
+ * See ASYM_UPMIGRATE.
+ */
+static inline bool task_wants_upmigrate(struct task_struct *p, struct rq *rq)
+{
+	int cpu = cpu_of(rq);
+
+	return sched_feat(ASYM_UPMIGRATE) &&
+	       capacity_orig_of(cpu) < READ_ONCE(rq->rd->max_cpu_capacity) &&
+	       task_util_est(p) * 2 >= capacity_of(cpu);
+}
+
 static inline void update_misfit_status(struct task_struct *p, struct rq *rq)
 {
 	if (!static_branch_unlikely(&sched_asym_cpucapacity))
@@ -4223,7 +4243,8 @@ static inline void update_misfit_status(struct task_struct *p, struct rq *rq)
 		return;
 	}
 
-	if (task_fits_capacity(p, capacity_of(cpu_of(rq)))) {
+	if (task_fits_capacity(p, capacity_of(cpu_of(rq))) &&
+	    !task_wants_upmigrate(p, rq)) {
 		rq->misfit_task_load = 0;
 		return;
 	}
@@ -5931,15 +5952,32 @@ static void record_wakee(struct task_struct *p)
 	 */
 	if (time_after(jiffies, current->wakee_flip_decay_ts + HZ)) {
 		current->wakee_flips >>= 1;
+		current->wakee_repeats >>= 1;
 		current->wakee_flip_decay_ts = jiffies;
 	}
 
 	if (current->last_wakee != p) {
 		current->last_wakee = p;
 		current->wakee_flips++;
+		current->wakee_repeats = 0;
+	} else if (current->wakee_repeats < UINT_MAX) {
+		current->wakee_repeats++;
 	}
 }
 
+/*
+ * Number of back to back wakeups of the same task, within the decay period
+ * of record_wakee(), after which waker and wakee are considered a pair that
+ * should share a LLC.
+ */
+#define WAKE_PAIR_REPEATS	8
+
+static inline bool wake_pair(struct task_struct *p)
+{
+	return current->last_wakee == p &&
+	       current->wakee_repeats >= WAKE_PAIR_REPEATS;
+}
+
 /*
  * Detect M:N waker/wakee relationships via a switching-frequency heuristic.
  *
@@ -6064,8 +6102,18 @@ static int wake_affine(struct sched_domain *sd, struct task_struct *p,
 		target = wake_affine_weight(sd, p, this_cpu, prev_cpu, sync);
 
 	schedstat_inc(p->stats.nr_wakeups_affine_attempts);
-	if (target == nr_cpumask_bits)
+	if (target == nr_cpumask_bits) {
+		/*
+		 * Rather than leaving a pair split across LLCs, let
+		 * select_idle_sibling() look for an idle CPU next to the waker.
+		 */
+		if (sched_feat(WA_PAIR) && wake_pair(p) &&
+		    !cpus_share_cache(this_cpu, prev_cpu)) {
+			schedstat_inc(p->stats.nr_wakeups_pair_affine);
+			return this_cpu;
+		}
 		return prev_cpu;
+	}
 
 	schedstat_inc(sd->ttwu_move_affine);
 	schedstat_inc(p->stats.nr_wakeups_affine);
@@ -6327,6 +6375,29 @@ static inline int select_idle_smt(struct task_struct *p, struct sched_domain *sd
 
 #endif /* CONFIG_SCHED_SMT */
 
+/*
+ * Track which CPUs of the LLC run their idle task, so select_idle_cpu() only
+ * has to look at those rather than the whole LLC. Called on idle entry and
+ * exit; the mask is only written when the state changes, to keep the shared
+ * cacheline from bouncing. The result is a hint, callers still have to check
+ * the CPU.
+ */
+void update_idle_cpus(struct rq *rq, bool idle)
+{
+	struct sched_domain_shared *sds;
+	int cpu = cpu_of(rq);
+
+	rcu_read_lock();
+	sds = rcu_dereference(per_cpu(sd_llc_shared, cpu));
+	if (sds && cpumask_test_cpu(cpu, sds_idle_cpus(sds)) != idle) {
+		if (idle)
+			cpumask_set_cpu(cpu, sds_idle_cpus(sds));
+		else
+			cpumask_clear_cpu(cpu, sds_idle_cpus(sds));
+	}
+	rcu_read_unlock();
+}
+
 /*
  * Scan the LLC domain for idle CPUs; this is dynamically regulated by
  * comparing the average scan cost (tracked in sd->avg_scan_cost) against the
@@ -6346,6 +6417,8 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 		return -1;
 
 	cpumask_and(cpus, sched_domain_span(sd), p->cpus_ptr);
+	if (sched_feat(SIS_FILTER) && sd->shared)
+		cpumask_and(cpus, cpus, sds_idle_cpus(sd->shared));
 
 	if (sched_feat(SIS_PROP) && !has_idle_core) {
 		u64 avg_cost, avg_idle, span_avg;
@@ -6416,8 +6489,9 @@ static int select_idle_cpu(struct task_struct *p, struct sched_domain *sd, bool
 static int
 select_idle_capacity(struct task_struct *p, struct sched_domain *sd, int target)
 {
-	unsigned long task_util, best_cap = 0;
-	int cpu, best_cpu = -1;
+	unsigned long task_util, best_cap = 0, fit_cap = 0;
+	bool upmigrate = sched_feat(ASYM_UPMIGRATE);
+	int cpu, best_cpu = -1, fit_cpu = -1;
 	struct cpumask *cpus;
 
 	cpus = this_cpu_cpumask_var_ptr(select_idle_mask);
@@ -6430,8 +6504,19 @@ select_idle_capacity(struct task_struct *p, struct sched_domain *sd, int target)
 
 		if (!available_idle_cpu(cpu) && !sched_idle_cpu(cpu))
 			continue;
-		if (fits_capacity(task_util, cpu_cap))
-			return cpu;
+		if (fits_capacity(task_util, cpu_cap)) {
+			if (!upmigrate ||
+			    capacity_orig_of(cpu) == READ_ONCE(cpu_rq(cpu)->rd->max_cpu_capacity)) {
+				fit_cpu = cpu;
+				break;
+			}
+			/* keep looking for a bigger CPU that fits */
+			if (cpu_cap > fit_cap) {
+				fit_cap = cpu_cap;
+				fit_cpu = cpu;
+			}
+			continue;
+		}
 
 		if (cpu_cap > best_cap) {
 			best_cap = cpu_cap;
@@ -6439,6 +6524,9 @@ select_idle_capacity(struct task_struct *p, struct sched_domain *sd, int target)
 		}
 	}
 
+	if (fit_cpu >= 0)
+		best_cpu = fit_cpu;
+	trace_sched_asym_select_tp(p, target, best_cpu, task_util);
 	return best_cpu;
 }
 
@@ -7041,6 +7129,20 @@ static unsigned long wakeup_gran(struct sched_entity *se)
 	return calc_delta_fair(gran, se);
 }
 
+/*
+ * Wakeup preemption bias for a task's latency_nice: a latency_nice of -20
+ * acts as if the task had run half a scheduling latency less, 19 as if it
+ * had run 19/40th of it more. Group entities carry no bias.
+ */
+static s64 wakeup_latency_offset(struct sched_entity *se)
+{
+	if (!entity_is_task(se))
+		return 0;
+
+	return -(s64)task_of(se)->latency_nice * sysctl_sched_latency /
+	       LATENCY_NICE_WIDTH;
+}
+
 /*
  * Should 'se' preempt 'curr'.
  *
@@ -7060,6 +7162,9 @@ wakeup_preempt_entity(struct sched_entity *curr, struct sched_entity *se)
 {
 	s64 gran, vdiff = curr->vruntime - se->vruntime;
 
+	/* bias the comparison by the latency_nice of both tasks */
+	vdiff += wakeup_latency_offset(se) - wakeup_latency_offset(curr);
+
 	if (vdiff <= 0)
 		return -1;
 
@@ -9316,6 +9421,8 @@ static inline void calculate_imbalance(struct lb_env *env, struct sd_lb_stats *s
 		/* Set imbalance to allow misfit tasks to be balanced. */
 		env->migration_type = migrate_misfit;
 		env->imbalance = 1;
+		trace_sched_misfit_lb_tp(env->sd, env->dst_cpu,
+					 busiest->group_misfit_task_load);
 		return;
 	}
 
@@ -62,6 +62,12 @@ SCHED_FEAT(TTWU_QUEUE, true)
  */
 SCHED_FEAT(SIS_PROP, true)
 
+/*
+ * Only scan the CPUs of the LLC that were idle last we looked, as tracked in
+ * sd_llc_shared->idle_cpus_span.
+ */
+SCHED_FEAT(SIS_FILTER, true)
+
 /*
  * Issue a WARN when we do multiple update_rq_clock() calls
  * in a single rq->lock section. Default disabled because the
@@ -90,6 +96,30 @@ SCHED_FEAT(WA_IDLE, true)
 SCHED_FEAT(WA_WEIGHT, true)
 SCHED_FEAT(WA_BIAS, true)
 
+/*
+ * Keep a wakee in the waker's LLC when the waker keeps waking that same
+ * task, e.g. stages of a pipeline handing off work through a queue, even
+ * if wake_affine() would have left it in another LLC.
+ */
+SCHED_FEAT(WA_PAIR, false)
+
+/*
+ * On asymmetric CPU capacity systems, favour the biggest CPUs for tasks that
+ * can use them: wakeups pick the idle CPU with the most capacity rather than
+ * the first one that fits, and a task keeping a smaller CPU at least half
+ * busy counts as misfit so it gets pulled up when a bigger CPU has spare
+ * capacity.
+ */
+SCHED_FEAT(ASYM_UPMIGRATE, false)
+
+#ifdef CONFIG_SCHED_CORE
+/*
+ * Let a CPU that goes idle next to a cookied task also try to pull a task
+ * with a matching cookie, not only forced idle CPUs.
+ */
+SCHED_FEAT(CORE_STEAL_IDLE, true)
+#endif
+
 /*
  * UtilEstimation. Use estimated CPU utilization.
  */
@@ -160,7 +160,7 @@ __setup("psi=", setup_psi);
 #define EXP_300s	2034		/* 1/exp(2s/300s) */
 
 /* PSI trigger definitions */
-#define WINDOW_MIN_US 500000	/* Min window size is 500ms */
+#define WINDOW_MIN_US 50000	/* Min window size is 50ms */
 #define WINDOW_MAX_US 10000000	/* Max window size is 10s */
 #define UPDATES_PER_WINDOW 10	/* 10 updates per window */
 
@@ -176,6 +176,15 @@ struct psi_group psi_system = {
 static void psi_avgs_work(struct work_struct *work);
 
 static void poll_timer_fn(struct timer_list *t);
+static void psi_poll_work_fn(struct kthread_work *work);
+
+/*
+ * All groups with triggers share one monitor worker, created on demand for
+ * the first trigger in the system. Polling many groups thus costs neither a
+ * kthread per group, nor a wakeup per group when their updates line up.
+ */
+static struct kthread_worker *psi_poll_kworker;
+static DEFINE_MUTEX(psi_poll_kworker_lock);
 
 static void group_init(struct psi_group *group)
 {
@@ -196,9 +205,9 @@ static void group_init(struct psi_group *group)
 	memset(group->polling_total, 0, sizeof(group->polling_total));
 	group->polling_next_update = ULLONG_MAX;
 	group->polling_until = 0;
-	init_waitqueue_head(&group->poll_wait);
+	kthread_init_work(&group->poll_work, psi_poll_work_fn);
 	timer_setup(&group->poll_timer, poll_timer_fn, 0);
-	rcu_assign_pointer(group->poll_task, NULL);
+	rcu_assign_pointer(group->poll_worker, NULL);
 }
 
 void __init psi_init(void)
@@ -568,7 +577,7 @@ static u64 update_triggers(struct psi_group *group, u64 now)
 /* Schedule polling if it's not already scheduled. */
 static void psi_schedule_poll_work(struct psi_group *group, unsigned long delay)
 {
-	struct task_struct *task;
+	struct kthread_worker *worker;
 
 	/*
 	 * Do not reschedule if already scheduled.
@@ -581,12 +590,12 @@ static void psi_schedule_poll_work(struct psi_group *group, unsigned long delay)
 
 	rcu_read_lock();
 
-	task = rcu_dereference(group->poll_task);
+	worker = rcu_dereference(group->poll_worker);
 	/*
-	 * kworker might be NULL in case psi_trigger_destroy races with
+	 * worker might be NULL in case psi_trigger_destroy races with
 	 * psi_task_change (hotpath) which can't use locks
 	 */
-	if (likely(task))
+	if (likely(worker))
 		mod_timer(&group->poll_timer, jiffies + delay);
 
 	rcu_read_unlock();
@@ -632,30 +641,39 @@ static void psi_poll_work(struct psi_group *group)
 	mutex_unlock(&group->trigger_lock);
 }
 
-static int psi_poll_worker(void *data)
+static void psi_poll_work_fn(struct kthread_work *work)
 {
-	struct psi_group *group = (struct psi_group *)data;
-
-	sched_set_fifo_low(current);
-
-	while (true) {
-		wait_event_interruptible(group->poll_wait,
-				atomic_cmpxchg(&group->poll_wakeup, 1, 0) ||
-				kthread_should_stop());
-		if (kthread_should_stop())
-			break;
-
-		psi_poll_work(group);
-	}
-	return 0;
+	psi_poll_work(container_of(work, struct psi_group, poll_work));
 }
 
 static void poll_timer_fn(struct timer_list *t)
 {
 	struct psi_group *group = from_timer(group, t, poll_timer);
+	struct kthread_worker *worker;
+
+	rcu_read_lock();
+	worker = rcu_dereference(group->poll_worker);
+	if (likely(worker))
+		kthread_queue_work(worker, &group->poll_work);
+	rcu_read_unlock();
+}
+
+static struct kthread_worker *psi_poll_kworker_get(void)
+{
+	struct kthread_worker *worker;
+
+	mutex_lock(&psi_poll_kworker_lock);
+	worker = psi_poll_kworker;
+	if (!worker) {
+		worker = kthread_create_worker(0, "psimon");
+		if (!IS_ERR(worker)) {
+			sched_set_fifo_low(worker->task);
+			psi_poll_kworker = worker;
+		}
+	}
+	mutex_unlock(&psi_poll_kworker_lock);
 
-	atomic_set(&group->poll_wakeup, 1);
-	wake_up_interruptible(&group->poll_wait);
+	return worker;
 }
 
 static void record_times(struct psi_group_cpu *groupc, u64 now)
@@ -1137,18 +1155,16 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 
 	mutex_lock(&group->trigger_lock);
 
-	if (!rcu_access_pointer(group->poll_task)) {
-		struct task_struct *task;
+	if (!rcu_access_pointer(group->poll_worker)) {
+		struct kthread_worker *worker;
 
-		task = kthread_create(psi_poll_worker, group, "psimon");
-		if (IS_ERR(task)) {
+		worker = psi_poll_kworker_get();
+		if (IS_ERR(worker)) {
 			kfree(t);
 			mutex_unlock(&group->trigger_lock);
-			return ERR_CAST(task);
+			return ERR_CAST(worker);
 		}
-		atomic_set(&group->poll_wakeup, 0);
-		wake_up_process(task);
-		rcu_assign_pointer(group->poll_task, task);
+		rcu_assign_pointer(group->poll_worker, worker);
 	}
 
 	list_add(&t->node, &group->triggers);
@@ -1165,7 +1181,7 @@ struct psi_trigger *psi_trigger_create(struct psi_group *group,
 void psi_trigger_destroy(struct psi_trigger *t)
 {
 	struct psi_group *group;
-	struct task_struct *task_to_destroy = NULL;
+	bool stop_polling = false;
 
 	/*
 	 * We do not check psi_disabled since it might have been disabled after
@@ -1196,13 +1212,11 @@ void psi_trigger_destroy(struct psi_trigger *t)
 			period = min(period, div_u64(tmp->win.size,
 					UPDATES_PER_WINDOW));
 		group->poll_min_period = period;
-		/* Destroy poll_task when the last trigger is destroyed */
+		/* Stop polling when the last trigger is destroyed */
 		if (group->poll_states == 0) {
 			group->polling_until = 0;
-			task_to_destroy = rcu_dereference_protected(
-					group->poll_task,
-					lockdep_is_held(&group->trigger_lock));
-			rcu_assign_pointer(group->poll_task, NULL);
+			stop_polling = true;
+			rcu_assign_pointer(group->poll_worker, NULL);
 			del_timer(&group->poll_timer);
 		}
 	}
@@ -1211,20 +1225,22 @@ void psi_trigger_destroy(struct psi_trigger *t)
 
 	/*
 	 * Wait for psi_schedule_poll_work RCU to complete its read-side
-	 * critical section before destroying the trigger and optionally the
-	 * poll_task.
+	 * critical section before destroying the trigger and optionally
+	 * stopping the group's polling.
 	 */
 	synchronize_rcu();
 	/*
-	 * Stop kthread 'psimon' after releasing trigger_lock to prevent a
+	 * Flush the poll work after releasing trigger_lock to prevent a
 	 * deadlock while waiting for psi_poll_work to acquire trigger_lock
 	 */
-	if (task_to_destroy) {
+	if (stop_polling) {
 		/*
-		 * After the RCU grace period has expired, the worker
-		 * can no longer be found through group->poll_task.
+		 * After the RCU grace period has expired, the timer can no
+		 * longer be armed and the work no longer be queued through
+		 * group->poll_worker.
 		 */
-		kthread_stop(task_to_destroy);
+		del_timer_sync(&group->poll_timer);
+		kthread_cancel_work_sync(&group->poll_work);
 	}
 	kfree(t);
 }
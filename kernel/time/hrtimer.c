@@ -1746,6 +1746,10 @@ static void __hrtimer_run_queues(struct hrtimer_cpu_base *cpu_base, ktime_t now,
 			if (basenow < hrtimer_get_softexpires_tv64(timer))
 				break;
 
+#ifdef CONFIG_HIGH_RES_TIMERS
+			if (basenow < hrtimer_get_expires_tv64(timer))
+				cpu_base->nr_coalesced++;
+#endif
 			__run_hrtimer(cpu_base, base, timer, &basenow, flags);
 			if (active_mask == HRTIMER_ACTIVE_SOFT)
 				hrtimer_sync_wait_running(cpu_base, flags);
@@ -1941,6 +1945,69 @@ static enum hrtimer_restart hrtimer_wakeup(struct hrtimer *timer)
 	return HRTIMER_NORESTART;
 }
 
+/*
+ * Coalescing grid for the timeouts of non realtime sleepers: the hard expiry
+ * of a sleeper is pushed out to the first multiple of hrtimer_coalesce_ns at
+ * or after its soft expiry, so that timeouts of unrelated tasks whose slack
+ * windows overlap share one expiry point instead of each programming its own
+ * event. The soft expiry is left alone, no timeout fires early. 0 disables.
+ */
+static unsigned int hrtimer_coalesce_ns __read_mostly;
+
+static void hrtimer_sleeper_coalesce(struct hrtimer *timer,
+				     enum hrtimer_mode *mode)
+{
+	unsigned int grid = READ_ONCE(hrtimer_coalesce_ns);
+	ktime_t soft, point;
+	s32 rem;
+
+	if (!grid || rt_task(current))
+		return;
+
+	soft = hrtimer_get_softexpires(timer);
+	if (*mode & HRTIMER_MODE_REL) {
+		ktime_t now = hrtimer_cb_get_time(timer);
+
+		hrtimer_set_expires_range(timer, ktime_add_safe(soft, now),
+					  ktime_sub(hrtimer_get_expires(timer),
+						    soft));
+		soft = hrtimer_get_softexpires(timer);
+		*mode &= ~HRTIMER_MODE_REL;
+	}
+
+	div_s64_rem(soft, grid, &rem);
+	if (rem < 0)
+		rem += grid;
+	point = rem ? ktime_add_ns(soft, grid - rem) : soft;
+
+	if (point > hrtimer_get_expires(timer))
+		hrtimer_set_expires_range(timer, soft, ktime_sub(point, soft));
+}
+
+#ifdef CONFIG_SYSCTL
+static unsigned int hrtimer_coalesce_max = 100 * NSEC_PER_MSEC;
+
+static struct ctl_table hrtimer_sysctl[] = {
+	{
+		.procname	= "hrtimer_coalesce_ns",
+		.data		= &hrtimer_coalesce_ns,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= SYSCTL_ZERO,
+		.extra2		= &hrtimer_coalesce_max,
+	},
+	{}
+};
+
+static int __init hrtimer_sysctl_init(void)
+{
+	register_sysctl("kernel", hrtimer_sysctl);
+	return 0;
+}
+device_initcall(hrtimer_sysctl_init);
+#endif /* CONFIG_SYSCTL */
+
 /**
  * hrtimer_sleeper_start_expires - Start a hrtimer sleeper timer
  * @sl:		sleeper to be started
@@ -1962,6 +2029,7 @@ void hrtimer_sleeper_start_expires(struct hrtimer_sleeper *sl,
 	if (IS_ENABLED(CONFIG_PREEMPT_RT) && sl->timer.is_hard)
 		mode |= HRTIMER_MODE_HARD;
 
+	hrtimer_sleeper_coalesce(&sl->timer, &mode);
 	hrtimer_start_expires(&sl->timer, mode);
 }
 EXPORT_SYMBOL_GPL(hrtimer_sleeper_start_expires);
@@ -37,6 +37,7 @@
 #include <linux/tick.h>
 #include <linux/kallsyms.h>
 #include <linux/irq_work.h>
+#include <linux/llist.h>
 #include <linux/sched/signal.h>
 #include <linux/sched/sysctl.h>
 #include <linux/sched/nohz.h>
@@ -211,6 +212,7 @@ struct timer_base {
 	bool			timers_pending;
 	DECLARE_BITMAP(pending_map, WHEEL_SIZE);
 	struct hlist_head	vectors[WHEEL_SIZE];
+	struct llist_head	deferred;
 } ____cacheline_aligned;
 
 static DEFINE_PER_CPU(struct timer_base, timer_bases[NR_BASES]);
@@ -968,6 +970,95 @@ static inline void forward_timer_base(struct timer_base *base)
 }
 
 
+/*
+ * Remote enqueue. A CPU which wants to start a timer on another CPU's
+ * base does not take that base's lock. It pushes the timer onto the
+ * lockless base::deferred list instead and the owner merges the list
+ * into the wheel the next time the base lock is taken: on the next
+ * tick, when going idle, or when somebody else operates on one of the
+ * deferred timers.
+ *
+ * While a timer sits on the deferred list it has TIMER_MIGRATING set,
+ * the CPU bits in timer::flags name the target base and timer::entry
+ * is reused: entry.next links the llist and entry.pprev points to
+ * timer_deferred_pprev, so timer_pending() stays true. A
+ * lock_timer_base() which observes this state merges the target list
+ * itself instead of waiting for the owner.
+ */
+static struct hlist_node *timer_deferred_pprev;
+
+static inline struct llist_node *timer_llist_node(struct timer_list *timer)
+{
+	BUILD_BUG_ON(offsetof(struct hlist_node, next) != 0);
+	return (struct llist_node *)&timer->entry;
+}
+
+static inline bool timer_is_deferred(struct timer_list *timer)
+{
+	return READ_ONCE(timer->entry.pprev) == &timer_deferred_pprev;
+}
+
+/*
+ * Move the timers on @list onto @base. Called with @base->lock held.
+ */
+static void __merge_deferred_timers(struct timer_base *base,
+				    struct llist_node *list)
+{
+	struct llist_node *node, *next;
+	struct timer_list *timer;
+
+	if (!list)
+		return;
+
+	forward_timer_base(base);
+	llist_for_each_safe(node, next, list) {
+		timer = container_of((struct hlist_node *)node,
+				     struct timer_list, entry);
+		timer->entry.pprev = NULL;
+		WRITE_ONCE(timer->flags,
+			   (timer->flags & ~TIMER_BASEMASK) | base->cpu);
+		internal_add_timer(base, timer);
+	}
+}
+
+static inline void merge_deferred_timers(struct timer_base *base)
+{
+	if (!llist_empty(&base->deferred))
+		__merge_deferred_timers(base, llist_del_all(&base->deferred));
+}
+
+/*
+ * Push @timer onto the deferred list of @base. Called with the lock of
+ * the timer's current base held, the timer detached, TIMER_MIGRATING
+ * set and timer::expires updated.
+ */
+static void defer_timer(struct timer_base *base, struct timer_list *timer)
+{
+	WRITE_ONCE(timer->flags, (timer->flags & ~TIMER_BASEMASK) |
+		   base->cpu | TIMER_MIGRATING);
+	WRITE_ONCE(timer->entry.pprev, &timer_deferred_pprev);
+
+	/*
+	 * llist_add() implies a full barrier which pairs with the one in
+	 * get_next_timer_interrupt(): either the target observes the
+	 * timer on its list before stopping the tick or we observe the
+	 * base idle here and kick it.
+	 */
+	llist_add(timer_llist_node(timer), &base->deferred);
+
+	if (!is_timers_nohz_active())
+		return;
+
+	if (timer->flags & TIMER_DEFERRABLE) {
+		if (tick_nohz_full_cpu(base->cpu))
+			wake_up_nohz_cpu(base->cpu);
+		return;
+	}
+
+	if (READ_ONCE(base->is_idle))
+		wake_up_nohz_cpu(base->cpu);
+}
+
 /*
  * We are using hashed locking: Holding per_cpu(timer_bases[x]).lock means
  * that all timers which are tied to this base are locked, and the base itself
@@ -1000,6 +1091,18 @@ static struct timer_base *lock_timer_base(struct timer_list *timer,
 			if (timer->flags == tf)
 				return base;
 			raw_spin_unlock_irqrestore(&base->lock, *flags);
+		} else if (timer_is_deferred(timer)) {
+			/*
+			 * The timer waits on the deferred list of its target
+			 * base. Merge that list rather than waiting for the
+			 * target CPU to get around to it.
+			 */
+			base = get_timer_base(tf);
+			raw_spin_lock_irqsave(&base->lock, *flags);
+			merge_deferred_timers(base);
+			if (timer->flags == (tf & ~TIMER_MIGRATING))
+				return base;
+			raw_spin_unlock_irqrestore(&base->lock, *flags);
 		}
 		cpu_relax();
 	}
@@ -1091,6 +1194,17 @@ __mod_timer(struct timer_list *timer, unsigned long expires, unsigned int option
 			/* See the comment in lock_timer_base() */
 			timer->flags |= TIMER_MIGRATING;
 
+			/*
+			 * Don't touch the lock of a remote base, hand the
+			 * timer over through its deferred list instead.
+			 */
+			if (new_base->cpu != smp_processor_id()) {
+				debug_timer_activate(timer);
+				timer->expires = expires;
+				defer_timer(new_base, timer);
+				goto out_unlock;
+			}
+
 			raw_spin_unlock(&base->lock);
 			base = new_base;
 			raw_spin_lock(&base->lock);
@@ -1223,6 +1337,13 @@ void add_timer_on(struct timer_list *timer, int cpu)
 	if (base != new_base) {
 		timer->flags |= TIMER_MIGRATING;
 
+		if (cpu != smp_processor_id()) {
+			debug_timer_activate(timer);
+			defer_timer(new_base, timer);
+			raw_spin_unlock_irqrestore(&base->lock, flags);
+			return;
+		}
+
 		raw_spin_unlock(&base->lock);
 		base = new_base;
 		raw_spin_lock(&base->lock);
@@ -1700,6 +1821,7 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 		return expires;
 
 	raw_spin_lock(&base->lock);
+	merge_deferred_timers(base);
 	if (base->next_expiry_recalc)
 		base->next_expiry = __next_timer_interrupt(base);
 	nextevt = base->next_expiry;
@@ -1729,8 +1851,19 @@ u64 get_next_timer_interrupt(unsigned long basej, u64 basem)
 		 * logic is only maintained for the BASE_STD base, deferrable
 		 * timers may still see large granularity skew (by design).
 		 */
-		if ((expires - basem) > TICK_NSEC)
+		if ((expires - basem) > TICK_NSEC) {
 			base->is_idle = true;
+			/*
+			 * Pairs with the barrier in defer_timer(). A timer
+			 * which was pushed after the merge above must not
+			 * wait for the next wakeup.
+			 */
+			smp_mb();
+			if (!llist_empty(&base->deferred)) {
+				base->is_idle = false;
+				expires = basem;
+			}
+		}
 	}
 	raw_spin_unlock(&base->lock);
 
@@ -1765,11 +1898,13 @@ static inline void __run_timers(struct timer_base *base)
 	struct hlist_head heads[LVL_DEPTH];
 	int levels;
 
-	if (time_before(jiffies, base->next_expiry))
+	if (time_before(jiffies, base->next_expiry) &&
+	    llist_empty(&base->deferred))
 		return;
 
 	timer_base_lock_expiry(base);
 	raw_spin_lock_irq(&base->lock);
+	merge_deferred_timers(base);
 
 	while (time_after_eq(jiffies, base->clk) &&
 	       time_after_eq(jiffies, base->next_expiry)) {
@@ -1814,12 +1949,14 @@ static void run_local_timers(void)
 
 	hrtimer_run_queues();
 	/* Raise the softirq only if required. */
-	if (time_before(jiffies, base->next_expiry)) {
+	if (time_before(jiffies, base->next_expiry) &&
+	    llist_empty(&base->deferred)) {
 		if (!IS_ENABLED(CONFIG_NO_HZ_COMMON))
 			return;
 		/* CPU is awake, so check the deferrable base. */
 		base++;
-		if (time_before(jiffies, base->next_expiry))
+		if (time_before(jiffies, base->next_expiry) &&
+		    llist_empty(&base->deferred))
 			return;
 	}
 	raise_softirq(TIMER_SOFTIRQ);
@@ -2037,6 +2174,8 @@ int timers_dead_cpu(unsigned int cpu)
 
 		BUG_ON(old_base->running_timer);
 
+		__merge_deferred_timers(new_base,
+					llist_del_all(&old_base->deferred));
 		for (i = 0; i < WHEEL_SIZE; i++)
 			migrate_timer_list(new_base, old_base->vectors + i);
 
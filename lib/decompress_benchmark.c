@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Throughput benchmark for the LZ4 and zstd decompressors.
+ *
+ * Both decompressors sit on hot read paths (zram, squashfs, EROFS, btrfs),
+ * so this measures them on page sized and larger buffers filled with data of
+ * a few different compressibilities. Correctness is covered by the users and
+ * by checking that each buffer round-trips once.
+ */
+
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/lz4.h>
+#include <linux/module.h>
+#include <linux/printk.h>
+#include <linux/random.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+#include <linux/zstd.h>
+
+#define BENCH_MAX_LEN	(128 * 1024)
+#define BENCH_BYTES	(64UL << 20)
+
+static unsigned int zstd_level = 3;
+module_param(zstd_level, uint, 0444);
+MODULE_PARM_DESC(zstd_level, "zstd compression level of the input (default 3)");
+
+static void *src, *dst, *out, *wrkmem;
+
+/* Fill with runs of random words from a small alphabet to tune the ratio. */
+static void __init fill_buffer(u8 *buf, size_t len, unsigned int alphabet)
+{
+	size_t i = 0;
+
+	while (i < len) {
+		size_t run = min_t(size_t, len - i, 4 + prandom_u32_max(28));
+		u8 c = 'a' + prandom_u32_max(alphabet);
+
+		memset(buf + i, c, run);
+		i += run;
+	}
+}
+
+static void __init report(const char *name, size_t len, size_t clen,
+			  unsigned long iters, ktime_t time)
+{
+	u64 mbps = div64_u64((u64)len * iters * NSEC_PER_SEC,
+			     max_t(u64, time, 1) * 1024 * 1024);
+
+	pr_err("%-5s %7zu -> %7zu bytes: %18llu ns, %6lu iterations, %6llu MB/s\n",
+	       name, len, clen, time, iters, mbps);
+}
+
+static void __init bench_lz4(size_t len)
+{
+	unsigned long i, iters = BENCH_BYTES / len;
+	ktime_t time;
+	int clen;
+
+	clen = LZ4_compress_default(src, dst, len, LZ4_compressBound(len), wrkmem);
+	if (clen <= 0 || LZ4_decompress_safe(dst, out, clen, len) != len ||
+	    memcmp(src, out, len)) {
+		pr_err("lz4: round trip of %zu bytes failed\n", len);
+		return;
+	}
+
+	time = ktime_get();
+	for (i = 0; i < iters; i++)
+		LZ4_decompress_safe(dst, out, clen, len);
+	time = ktime_get() - time;
+
+	report("lz4", len, clen, iters, time);
+}
+
+static void __init bench_zstd(size_t len)
+{
+	zstd_parameters params = zstd_get_params(zstd_level, len);
+	unsigned long i, iters = BENCH_BYTES / len;
+	size_t cwksp = zstd_cctx_workspace_bound(&params.cParams);
+	size_t dwksp = zstd_dctx_workspace_bound();
+	void *wksp;
+	zstd_cctx *cctx;
+	zstd_dctx *dctx;
+	ktime_t time;
+	size_t clen;
+
+	wksp = vmalloc(max(cwksp, dwksp));
+	if (!wksp)
+		return;
+
+	cctx = zstd_init_cctx(wksp, cwksp);
+	clen = cctx ? zstd_compress_cctx(cctx, dst, zstd_compress_bound(len),
+					 src, len, &params) : 0;
+	if (!cctx || zstd_is_error(clen))
+		goto fail;
+
+	dctx = zstd_init_dctx(wksp, dwksp);
+	if (!dctx || zstd_decompress_dctx(dctx, out, len, dst, clen) != len ||
+	    memcmp(src, out, len))
+		goto fail;
+
+	time = ktime_get();
+	for (i = 0; i < iters; i++)
+		zstd_decompress_dctx(dctx, out, len, dst, clen);
+	time = ktime_get() - time;
+
+	report("zstd", len, clen, iters, time);
+	vfree(wksp);
+	return;
+fail:
+	pr_err("zstd: round trip of %zu bytes failed\n", len);
+	vfree(wksp);
+}
+
+static int __init decompress_benchmark_init(void)
+{
+	static const unsigned int alphabets[] __initconst = { 4, 16, 64 };
+	static const size_t lens[] __initconst = { PAGE_SIZE, 4 * PAGE_SIZE,
+						   BENCH_MAX_LEN };
+	int i, j;
+
+	src = vmalloc(BENCH_MAX_LEN);
+	out = vmalloc(BENCH_MAX_LEN);
+	dst = vmalloc(max_t(size_t, LZ4_compressBound(BENCH_MAX_LEN),
+			    zstd_compress_bound(BENCH_MAX_LEN)));
+	wrkmem = vmalloc(LZ4_MEM_COMPRESS);
+	if (!src || !out || !dst || !wrkmem)
+		goto out;
+
+	for (i = 0; i < ARRAY_SIZE(alphabets); i++) {
+		pr_err("\nStart decompression benchmark, alphabet of %u\n",
+		       alphabets[i]);
+		fill_buffer(src, BENCH_MAX_LEN, alphabets[i]);
+
+		for (j = 0; j < ARRAY_SIZE(lens); j++) {
+			bench_lz4(lens[j]);
+			bench_zstd(lens[j]);
+			cond_resched();
+		}
+	}
+
+out:
+	vfree(wrkmem);
+	vfree(dst);
+	vfree(out);
+	vfree(src);
+
+	/*
+	 * Everything is OK. Return error just to let user run benchmark
+	 * again without annoying rmmod.
+	 */
+	return -EINVAL;
+}
+module_init(decompress_benchmark_init);
+
+MODULE_DESCRIPTION("LZ4 and zstd decompression benchmark");
+MODULE_LICENSE("GPL");
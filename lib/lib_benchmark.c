@@ -0,0 +1,454 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Micro-benchmarks for lib/ data structures.
+ *
+ * Every case is run with 1, 2, 4, ... up to all online CPUs, one bound
+ * kthread per CPU. Each thread times its operations in batches, and the
+ * per-batch cost is used for the percentiles. Results are printed one line
+ * per case and thread count as key=value pairs, e.g.
+ *
+ *   lib_bench: case=xarray_load threads=4 ops=262144 ns_op=12 p50=11 p90=14 p99=30
+ *
+ * so that runs on different kernels and machines can be compared by a
+ * script. Correctness is left to the selftests of each data structure.
+ */
+
+#define pr_fmt(fmt) "lib_bench: " fmt
+
+#include <linux/atomic.h>
+#include <linux/completion.h>
+#include <linux/cpumask.h>
+#include <linux/kernel.h>
+#include <linux/kthread.h>
+#include <linux/ktime.h>
+#include <linux/list.h>
+#include <linux/list_sort.h>
+#include <linux/maple_tree.h>
+#include <linux/module.h>
+#include <linux/rhashtable.h>
+#include <linux/sbitmap.h>
+#include <linux/slab.h>
+#include <linux/sort.h>
+#include <linux/vmalloc.h>
+#include <linux/xarray.h>
+
+#define BENCH_BATCH		64
+#define BENCH_KEYS		(1U << 16)
+#define BENCH_SORT_LEN		256
+
+static unsigned int samples = 256;
+module_param(samples, uint, 0444);
+MODULE_PARM_DESC(samples, "Timed batches of 64 operations per thread (default 256)");
+
+static unsigned int max_threads;
+module_param(max_threads, uint, 0444);
+MODULE_PARM_DESC(max_threads, "Maximum number of threads, 0 for all online CPUs");
+
+static char *filter;
+module_param(filter, charp, 0444);
+MODULE_PARM_DESC(filter, "Only run cases whose name contains this string");
+
+struct bench_thread {
+	const struct bench_case *bc;
+	struct task_struct *task;
+	void *scratch;
+	u32 rnd;
+	u64 *lat;
+};
+
+/**
+ * struct bench_case - A benchmark case.
+ * @name: Name printed in the results.
+ * @init: Set up the shared state, called once per run.
+ * @exit: Tear down the shared state.
+ * @scratch_size: Size of the private buffer each thread gets.
+ * @op: One timed operation, @i counts the operations of the thread.
+ */
+struct bench_case {
+	const char *name;
+	int (*init)(void);
+	void (*exit)(void);
+	size_t scratch_size;
+	void (*op)(struct bench_thread *t, unsigned long i);
+};
+
+static inline u32 bench_rand(struct bench_thread *t)
+{
+	/* xorshift32, cheap enough not to dominate the operations. */
+	t->rnd ^= t->rnd << 13;
+	t->rnd ^= t->rnd >> 17;
+	t->rnd ^= t->rnd << 5;
+	return t->rnd;
+}
+
+/* === rhashtable ======================================================== */
+
+struct bench_obj {
+	u32 key;
+	struct rhash_head node;
+};
+
+static const struct rhashtable_params bench_rht_params = {
+	.key_len = sizeof(u32),
+	.key_offset = offsetof(struct bench_obj, key),
+	.head_offset = offsetof(struct bench_obj, node),
+	.automatic_shrinking = true,
+};
+
+static struct rhashtable bench_rht;
+static struct bench_obj *bench_objs;
+
+static int rht_init(void)
+{
+	unsigned int i;
+	int err;
+
+	bench_objs = vmalloc(array_size(BENCH_KEYS, sizeof(*bench_objs)));
+	if (!bench_objs)
+		return -ENOMEM;
+
+	err = rhashtable_init(&bench_rht, &bench_rht_params);
+	if (err)
+		goto free;
+
+	for (i = 0; i < BENCH_KEYS; i++) {
+		bench_objs[i].key = i;
+		err = rhashtable_insert_fast(&bench_rht, &bench_objs[i].node,
+					     bench_rht_params);
+		if (err) {
+			rhashtable_destroy(&bench_rht);
+			goto free;
+		}
+	}
+	return 0;
+free:
+	vfree(bench_objs);
+	return err;
+}
+
+static void rht_exit(void)
+{
+	rhashtable_destroy(&bench_rht);
+	vfree(bench_objs);
+}
+
+static void rht_lookup_op(struct bench_thread *t, unsigned long i)
+{
+	u32 key = bench_rand(t) % BENCH_KEYS;
+
+	rcu_read_lock();
+	WARN_ON_ONCE(!rhashtable_lookup(&bench_rht, &key, bench_rht_params));
+	rcu_read_unlock();
+}
+
+/* === xarray ============================================================ */
+
+static DEFINE_XARRAY(bench_xa);
+
+static int xa_bench_init(void)
+{
+	unsigned int i;
+
+	for (i = 0; i < BENCH_KEYS; i++) {
+		if (xa_is_err(xa_store(&bench_xa, i, xa_mk_value(i), GFP_KERNEL))) {
+			xa_destroy(&bench_xa);
+			return -ENOMEM;
+		}
+	}
+	return 0;
+}
+
+static void xa_bench_exit(void)
+{
+	xa_destroy(&bench_xa);
+}
+
+static void xa_load_op(struct bench_thread *t, unsigned long i)
+{
+	WARN_ON_ONCE(!xa_load(&bench_xa, bench_rand(t) % BENCH_KEYS));
+}
+
+/* === maple tree ======================================================== */
+
+static DEFINE_MTREE(bench_mt);
+
+static int mt_bench_init(void)
+{
+	unsigned long i;
+	int err;
+
+	/* Ranges of 16 with a gap of 16 in between, like a VMA tree. */
+	for (i = 0; i < BENCH_KEYS; i++) {
+		err = mtree_store_range(&bench_mt, i * 32, i * 32 + 15,
+					xa_mk_value(i), GFP_KERNEL);
+		if (err) {
+			mtree_destroy(&bench_mt);
+			return err;
+		}
+	}
+	return 0;
+}
+
+static void mt_bench_exit(void)
+{
+	mtree_destroy(&bench_mt);
+}
+
+static void mt_load_op(struct bench_thread *t, unsigned long i)
+{
+	unsigned long index = (bench_rand(t) % BENCH_KEYS) * 32 + 8;
+
+	WARN_ON_ONCE(!mtree_load(&bench_mt, index));
+}
+
+/* === sbitmap =========================================================== */
+
+static struct sbitmap bench_sb;
+
+static int sb_bench_init(void)
+{
+	return sbitmap_init_node(&bench_sb, 1024, -1, GFP_KERNEL, NUMA_NO_NODE,
+				 false, true);
+}
+
+static void sb_bench_exit(void)
+{
+	sbitmap_free(&bench_sb);
+}
+
+static void sb_get_clear_op(struct bench_thread *t, unsigned long i)
+{
+	int nr = sbitmap_get(&bench_sb);
+
+	if (nr >= 0)
+		sbitmap_clear_bit(&bench_sb, nr);
+}
+
+/* === sort and list_sort ================================================ */
+
+static int cmp_u32(const void *a, const void *b)
+{
+	u32 x = *(const u32 *)a, y = *(const u32 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static void sort_op(struct bench_thread *t, unsigned long i)
+{
+	u32 *v = t->scratch;
+	unsigned int j;
+
+	for (j = 0; j < BENCH_SORT_LEN; j++)
+		v[j] = bench_rand(t);
+	sort(v, BENCH_SORT_LEN, sizeof(*v), cmp_u32, NULL);
+}
+
+struct bench_node {
+	struct list_head list;
+	u32 val;
+};
+
+static int cmp_node(void *priv, const struct list_head *a,
+		    const struct list_head *b)
+{
+	return list_entry(a, struct bench_node, list)->val >
+	       list_entry(b, struct bench_node, list)->val;
+}
+
+static void list_sort_op(struct bench_thread *t, unsigned long i)
+{
+	struct bench_node *nodes = t->scratch;
+	unsigned int j;
+	LIST_HEAD(head);
+
+	for (j = 0; j < BENCH_SORT_LEN; j++) {
+		nodes[j].val = bench_rand(t);
+		list_add_tail(&nodes[j].list, &head);
+	}
+	list_sort(NULL, &head, cmp_node);
+}
+
+static const struct bench_case bench_cases[] = {
+	{ "rhashtable_lookup", rht_init, rht_exit, 0, rht_lookup_op },
+	{ "xarray_load", xa_bench_init, xa_bench_exit, 0, xa_load_op },
+	{ "maple_tree_load", mt_bench_init, mt_bench_exit, 0, mt_load_op },
+	{ "sbitmap_get_clear", sb_bench_init, sb_bench_exit, 0, sb_get_clear_op },
+	{ "sort_256", NULL, NULL, BENCH_SORT_LEN * sizeof(u32), sort_op },
+	{ "list_sort_256", NULL, NULL, BENCH_SORT_LEN * sizeof(struct bench_node),
+	  list_sort_op },
+};
+
+/* === Harness =========================================================== */
+
+static atomic_t bench_ready;
+static DECLARE_COMPLETION(bench_go);
+static atomic_t bench_running;
+static DECLARE_COMPLETION(bench_done);
+
+static int bench_thread_fn(void *data)
+{
+	struct bench_thread *t = data;
+	unsigned long i = 0;
+	unsigned int s, j;
+	ktime_t start;
+
+	atomic_inc(&bench_ready);
+	wait_for_completion(&bench_go);
+
+	for (s = 0; s < samples; s++) {
+		start = ktime_get();
+		for (j = 0; j < BENCH_BATCH; j++)
+			t->bc->op(t, i++);
+		t->lat[s] = ktime_get() - start;
+		cond_resched();
+	}
+
+	if (atomic_dec_and_test(&bench_running))
+		complete(&bench_done);
+
+	/* Stay around until the results have been collected. */
+	while (!kthread_should_stop())
+		schedule_timeout_interruptible(HZ);
+	return 0;
+}
+
+static int cmp_u64(const void *a, const void *b)
+{
+	u64 x = *(const u64 *)a, y = *(const u64 *)b;
+
+	return x < y ? -1 : x > y;
+}
+
+static int __init bench_run(const struct bench_case *bc, unsigned int nr)
+{
+	struct bench_thread *threads;
+	unsigned int i, cpu, n = 0;
+	u64 *lat, total = 0;
+	ktime_t start, time;
+	int err = 0;
+
+	threads = kcalloc(nr, sizeof(*threads), GFP_KERNEL);
+	lat = vmalloc(array_size(nr * samples, sizeof(*lat)));
+	if (!threads || !lat) {
+		err = -ENOMEM;
+		goto free;
+	}
+
+	atomic_set(&bench_ready, 0);
+	atomic_set(&bench_running, nr);
+	reinit_completion(&bench_go);
+	reinit_completion(&bench_done);
+
+	for_each_online_cpu(cpu) {
+		struct bench_thread *t = &threads[n];
+
+		if (n == nr)
+			break;
+		t->bc = bc;
+		t->rnd = cpu * 2654435761U + 1;
+		t->lat = lat + n * samples;
+		if (bc->scratch_size) {
+			t->scratch = kmalloc(bc->scratch_size, GFP_KERNEL);
+			if (!t->scratch) {
+				err = -ENOMEM;
+				break;
+			}
+		}
+		t->task = kthread_create_on_cpu(bench_thread_fn, t, cpu,
+						"lib_bench/%u");
+		if (IS_ERR(t->task)) {
+			err = PTR_ERR(t->task);
+			t->task = NULL;
+			break;
+		}
+		wake_up_process(t->task);
+		n++;
+	}
+
+	if (err) {
+		/* Release the threads we did start, and don't report. */
+		atomic_sub(nr - n, &bench_running);
+		complete_all(&bench_go);
+		if (n)
+			wait_for_completion(&bench_done);
+		goto stop;
+	}
+
+	while (atomic_read(&bench_ready) < nr)
+		schedule_timeout_uninterruptible(1);
+
+	start = ktime_get();
+	complete_all(&bench_go);
+	wait_for_completion(&bench_done);
+	time = ktime_get() - start;
+
+	for (i = 0; i < nr * samples; i++)
+		total += lat[i];
+	sort(lat, nr * samples, sizeof(*lat), cmp_u64, NULL);
+
+	pr_info("case=%s threads=%u ops=%lu ns_op=%llu p50=%llu p90=%llu p99=%llu wall_ns=%llu\n",
+		bc->name, nr, (unsigned long)nr * samples * BENCH_BATCH,
+		div64_u64(total, (u64)nr * samples * BENCH_BATCH),
+		div_u64(lat[nr * samples / 2], BENCH_BATCH),
+		div_u64(lat[nr * samples * 9 / 10], BENCH_BATCH),
+		div_u64(lat[nr * samples * 99 / 100], BENCH_BATCH),
+		(u64)time);
+stop:
+	for (i = 0; i < n; i++)
+		kthread_stop(threads[i].task);
+	for (i = 0; i < nr; i++)
+		kfree(threads[i].scratch);
+free:
+	vfree(lat);
+	kfree(threads);
+	return err;
+}
+
+static int __init lib_benchmark_init(void)
+{
+	unsigned int cpus = num_online_cpus();
+	unsigned int i, nr;
+	int err;
+
+	if (!samples)
+		return -EINVAL;
+	if (max_threads && max_threads < cpus)
+		cpus = max_threads;
+
+	for (i = 0; i < ARRAY_SIZE(bench_cases); i++) {
+		const struct bench_case *bc = &bench_cases[i];
+
+		if (filter && !strstr(bc->name, filter))
+			continue;
+
+		err = bc->init ? bc->init() : 0;
+		if (err) {
+			pr_err("case=%s init failed: %d\n", bc->name, err);
+			continue;
+		}
+
+		for (nr = 1; nr <= cpus; nr = nr < cpus && nr * 2 > cpus ? cpus : nr * 2) {
+			err = bench_run(bc, nr);
+			if (err) {
+				pr_err("case=%s threads=%u failed: %d\n",
+				       bc->name, nr, err);
+				break;
+			}
+			if (nr == cpus)
+				break;
+		}
+
+		if (bc->exit)
+			bc->exit();
+	}
+
+	/*
+	 * Everything is OK. Return error just to let user run benchmark
+	 * again without annoying rmmod.
+	 */
+	return -EINVAL;
+}
+module_init(lib_benchmark_init);
+
+MODULE_DESCRIPTION("Micro-benchmarks for lib/ data structures");
+MODULE_LICENSE("GPL");
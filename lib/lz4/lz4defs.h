@@ -176,6 +176,17 @@ static FORCE_INLINE void LZ4_wildCopy(void *dstPtr,
 	const BYTE *s = (const BYTE *)srcPtr;
 	BYTE *const e = (BYTE *)dstEnd;
 
+	/*
+	 * Long copies go two words per iteration; the tail still steps by 8,
+	 * so at most WILDCOPYLENGTH - 1 bytes are written beyond dstEnd.
+	 */
+	while (e - d > 16) {
+		LZ4_copy8(d, s);
+		LZ4_copy8(d + 8, s + 8);
+		d += 16;
+		s += 16;
+	}
+
 	do {
 		LZ4_copy8(d, s);
 		d += 8;
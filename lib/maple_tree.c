@@ -157,6 +157,11 @@ static inline void mt_free_bulk(size_t size, void __rcu **nodes)
 	kmem_cache_free_bulk(maple_node_cache, size, (void **)nodes);
 }
 
+static inline void mt_free_one(struct maple_node *node)
+{
+	kmem_cache_free(maple_node_cache, node);
+}
+
 static void mt_free_rcu(struct rcu_head *head)
 {
 	struct maple_node *node = container_of(head, struct maple_node, rcu);
@@ -6327,6 +6332,255 @@ void __mt_destroy(struct maple_tree *mt)
 }
 EXPORT_SYMBOL_GPL(__mt_destroy);
 
+/* The tree attributes which have to match for a duplicate. */
+static inline unsigned int mt_attr(struct maple_tree *mt)
+{
+	return mt->ma_flags & ~MT_FLAGS_HEIGHT_MASK;
+}
+
+/*
+ * mas_dup_free() - Free an incomplete duplication of a tree.
+ * @mas: The maple state of the incomplete tree, pointing at the node whose
+ * children could not be allocated.
+ *
+ * Nodes to the left of @mas are complete copies and nodes to the right have
+ * only been allocated, so free the tree bottom up from right to left without
+ * descending into anything right of @mas.
+ */
+static void mas_dup_free(struct ma_state *mas)
+{
+	struct maple_node *node;
+	enum maple_type type;
+	void __rcu **slots;
+	unsigned char count, i;
+
+	/* Maybe the first node allocation failed. */
+	if (mas_is_none(mas))
+		return;
+
+	while (!mte_is_root(mas->node)) {
+		mas_ascend(mas);
+		if (mas->offset) {
+			mas->offset--;
+			do {
+				mas_descend(mas);
+				mas->offset = mas_data_end(mas);
+			} while (!mte_is_leaf(mas->node));
+
+			mas_ascend(mas);
+		}
+
+		node = mte_to_node(mas->node);
+		type = mte_node_type(mas->node);
+		slots = ma_slots(node, type);
+		count = mas_data_end(mas) + 1;
+		for (i = 0; i < count; i++)
+			((unsigned long *)slots)[i] &= ~MAPLE_NODE_MASK;
+		mt_free_bulk(count, slots);
+	}
+
+	node = mte_to_node(mas->node);
+	mt_free_one(node);
+}
+
+/*
+ * mas_copy_node() - Copy a maple node and replace the parent.
+ * @mas: The maple state of the source tree.
+ * @new_mas: The maple state of the new tree.
+ * @parent: The parent of the new node.
+ */
+static inline void mas_copy_node(struct ma_state *mas, struct ma_state *new_mas,
+		struct maple_pnode *parent)
+{
+	struct maple_node *node = mte_to_node(mas->node);
+	struct maple_node *new_node = mte_to_node(new_mas->node);
+	unsigned long val;
+
+	/* Copy the node completely, keeping the slot and type of the parent. */
+	memcpy(new_node, node, sizeof(struct maple_node));
+	val = (unsigned long)node->parent & MAPLE_NODE_MASK;
+	new_node->parent = ma_parent_ptr(val | (unsigned long)parent);
+}
+
+/*
+ * mas_dup_alloc() - Allocate the child nodes of a copied node.
+ * @mas: The maple state of the source tree.
+ * @new_mas: The maple state of the new tree.
+ * @gfp: The GFP_FLAGS to use for allocations.
+ *
+ * Sets an error in @mas if the nodes cannot be allocated.
+ */
+static inline void mas_dup_alloc(struct ma_state *mas, struct ma_state *new_mas,
+		gfp_t gfp)
+{
+	struct maple_node *node = mte_to_node(mas->node);
+	struct maple_node *new_node = mte_to_node(new_mas->node);
+	enum maple_type type;
+	unsigned char request, count, i;
+	void __rcu **slots;
+	void __rcu **new_slots;
+	unsigned long val;
+
+	type = mte_node_type(mas->node);
+	new_slots = ma_slots(new_node, type);
+	request = mas_data_end(mas) + 1;
+	count = mt_alloc_bulk(gfp, request, (void **)new_slots);
+	if (unlikely(count < request)) {
+		memset(new_slots, 0, request * sizeof(void *));
+		mas_set_err(mas, -ENOMEM);
+		return;
+	}
+
+	/* Restore the node type information of each child. */
+	slots = ma_slots(node, type);
+	for (i = 0; i < count; i++) {
+		val = (unsigned long)mas_slot_locked(mas, slots, i);
+		val &= MAPLE_NODE_MASK;
+		((unsigned long *)new_slots)[i] |= val;
+	}
+}
+
+/*
+ * mas_dup_build() - Build a new maple tree from a source tree.
+ * @mas: The maple state of the source tree, must be at the root.
+ * @new_mas: The maple state of the new tree, which must be empty.
+ * @gfp: The GFP_FLAGS to use for allocations.
+ *
+ * Copies the tree node by node in pre-order, allocating the children of each
+ * node in bulk.  There is no splitting or rebalancing: the copy has the same
+ * shape, pivots and gaps as the source.  On failure an error is set in @mas
+ * and @new_mas points at the node which could not be completed.
+ */
+static inline void mas_dup_build(struct ma_state *mas, struct ma_state *new_mas,
+		gfp_t gfp)
+{
+	struct maple_node *node;
+	struct maple_pnode *parent = NULL;
+	struct maple_enode *root;
+	enum maple_type type;
+
+	if (unlikely(mt_attr(mas->tree) != mt_attr(new_mas->tree)) ||
+	    unlikely(!mtree_empty(new_mas->tree))) {
+		mas_set_err(mas, -EINVAL);
+		return;
+	}
+
+	root = mas_start(mas);
+	if (mas_is_ptr(mas) || mas_is_none(mas))
+		goto set_new_tree;
+
+	node = mt_alloc_one(gfp);
+	if (!node) {
+		new_mas->node = MAS_NONE;
+		mas_set_err(mas, -ENOMEM);
+		return;
+	}
+
+	type = mte_node_type(mas->node);
+	root = mt_mk_node(node, type);
+	new_mas->node = root;
+	new_mas->min = 0;
+	new_mas->max = ULONG_MAX;
+	root = mte_mk_root(root);
+	while (1) {
+		mas_copy_node(mas, new_mas, parent);
+		if (!mte_is_leaf(mas->node)) {
+			/* Only allocate child nodes for non-leaf nodes. */
+			mas_dup_alloc(mas, new_mas, gfp);
+			if (unlikely(mas_is_err(mas)))
+				return;
+		} else {
+			/* The last leaf completes the copy. */
+			if (mas->max == ULONG_MAX)
+				goto done;
+
+			/* Go up to the next subtree. */
+			do {
+				mas_ascend(mas);
+				mas_ascend(new_mas);
+			} while (mas->offset == mas_data_end(mas));
+
+			mas->offset++;
+			new_mas->offset++;
+		}
+
+		mas_descend(mas);
+		parent = ma_parent_ptr(mte_to_node(new_mas->node));
+		mas_descend(new_mas);
+		mas->offset = 0;
+		new_mas->offset = 0;
+	}
+done:
+	/* The copy of the root still points at the source tree. */
+	mte_to_node(root)->parent =
+		ma_parent_ptr(((unsigned long)new_mas->tree | MA_ROOT_PARENT));
+set_new_tree:
+	/* Make them the same height. */
+	new_mas->tree->ma_flags = mas->tree->ma_flags;
+	rcu_assign_pointer(new_mas->tree->ma_root, root);
+}
+
+/**
+ * __mt_dup() - Duplicate an entire maple tree
+ * @mt: The source maple tree
+ * @new: The new maple tree, which must be empty and initialised with the same
+ * flags as @mt
+ * @gfp: The GFP_FLAGS to use for allocations
+ *
+ * Builds @new as a node by node copy of @mt in a single pass, which is much
+ * faster than inserting every entry: no node is split, rebalanced or
+ * allocated more than once.  The entries themselves are shared with @mt, the
+ * caller would typically replace each of them in place afterwards.
+ *
+ * Note: Does not handle locking.  The caller must hold the write lock of @new
+ * and the lock of @mt, and @gfp must be valid under those locks.
+ *
+ * Return: 0 on success, -ENOMEM if memory could not be allocated, -EINVAL if
+ * @new is not empty or the flags of the trees differ.
+ */
+int __mt_dup(struct maple_tree *mt, struct maple_tree *new, gfp_t gfp)
+{
+	int ret = 0;
+	MA_STATE(mas, mt, 0, 0);
+	MA_STATE(new_mas, new, 0, 0);
+
+	mas_dup_build(&mas, &new_mas, gfp);
+	if (unlikely(mas_is_err(&mas))) {
+		ret = xa_err(mas.node);
+		if (ret == -ENOMEM)
+			mas_dup_free(&new_mas);
+	}
+
+	return ret;
+}
+EXPORT_SYMBOL(__mt_dup);
+
+/**
+ * mtree_dup() - Duplicate an entire maple tree
+ * @mt: The source maple tree
+ * @new: The new maple tree
+ * @gfp: The GFP_FLAGS to use for allocations, which must not sleep as the
+ * tree locks are held
+ *
+ * Like __mt_dup(), but takes the locks of both trees.
+ *
+ * Return: 0 on success, -ENOMEM if memory could not be allocated, -EINVAL if
+ * @new is not empty or the flags of the trees differ.
+ */
+int mtree_dup(struct maple_tree *mt, struct maple_tree *new, gfp_t gfp)
+{
+	int ret;
+
+	mtree_lock(new);
+	spin_lock_nested(&mt->ma_lock, SINGLE_DEPTH_NESTING);
+	ret = __mt_dup(mt, new, gfp);
+	mtree_unlock(mt);
+	mtree_unlock(new);
+
+	return ret;
+}
+EXPORT_SYMBOL(mtree_dup);
+
 /**
  * mtree_destroy() - Destroy a maple tree
  * @mt: The maple tree
@@ -25,10 +25,15 @@
 #include <linux/rhashtable.h>
 #include <linux/err.h>
 #include <linux/export.h>
+#include <linux/workqueue.h>
 
 #define HASH_DEFAULT_SIZE	64UL
 #define HASH_MIN_SIZE		4U
 
+/* Tables with at least this many buckets are rehashed by several workers. */
+#define RHT_REHASH_PARALLEL_MIN	(1U << 14)
+#define RHT_REHASH_MAX_WORKERS	8
+
 union nested_table {
 	union nested_table __rcu *table;
 	struct rhash_lock_head __rcu *bucket;
@@ -222,10 +227,10 @@ static struct bucket_table *rhashtable_last_table(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_one(struct rhashtable *ht,
+				 struct bucket_table *old_tbl,
 				 struct rhash_lock_head __rcu **bkt,
 				 unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct bucket_table *new_tbl = rhashtable_last_table(ht, old_tbl);
 	int err = -EAGAIN;
 	struct rhash_head *head, *next, *entry;
@@ -272,9 +277,9 @@ static int rhashtable_rehash_one(struct rhashtable *ht,
 }
 
 static int rhashtable_rehash_chain(struct rhashtable *ht,
-				    unsigned int old_hash)
+				   struct bucket_table *old_tbl,
+				   unsigned int old_hash)
 {
-	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
 	struct rhash_lock_head __rcu **bkt = rht_bucket_var(old_tbl, old_hash);
 	int err;
 
@@ -282,7 +287,7 @@ static int rhashtable_rehash_chain(struct rhashtable *ht,
 		return 0;
 	rht_lock(old_tbl, bkt);
 
-	while (!(err = rhashtable_rehash_one(ht, bkt, old_hash)))
+	while (!(err = rhashtable_rehash_one(ht, old_tbl, bkt, old_hash)))
 		;
 
 	if (err == -ENOENT)
@@ -309,6 +314,69 @@ static int rhashtable_rehash_attach(struct rhashtable *ht,
 	return 0;
 }
 
+struct rhashtable_rehash_work {
+	struct work_struct work;
+	struct rhashtable *ht;
+	struct bucket_table *old_tbl;
+	unsigned int start;
+	unsigned int end;
+	int err;
+};
+
+static void rhashtable_rehash_range_fn(struct work_struct *work)
+{
+	struct rhashtable_rehash_work *rw =
+		container_of(work, struct rhashtable_rehash_work, work);
+	unsigned int old_hash;
+
+	/*
+	 * ht->mutex is held by the thread waiting for us rather than by this
+	 * worker, so walk the future_tbl chain under RCU instead.
+	 */
+	for (old_hash = rw->start; old_hash < rw->end; old_hash++) {
+		rcu_read_lock();
+		rw->err = rhashtable_rehash_chain(rw->ht, rw->old_tbl, old_hash);
+		rcu_read_unlock();
+		if (rw->err)
+			break;
+		cond_resched();
+	}
+}
+
+/*
+ * Migrate the bucket chains of a large table from several workers. Each
+ * chain is moved under its own bucket lock exactly as in the serial case, so
+ * concurrent RCU lookups still find every entry in one of the two tables.
+ */
+static int rhashtable_rehash_parallel(struct rhashtable *ht,
+				      struct bucket_table *old_tbl)
+{
+	struct rhashtable_rehash_work works[RHT_REHASH_MAX_WORKERS];
+	unsigned int nr, chunk, i;
+	int err = 0;
+
+	nr = min_t(unsigned int, num_online_cpus(), RHT_REHASH_MAX_WORKERS);
+	chunk = DIV_ROUND_UP(old_tbl->size, nr);
+
+	for (i = 0; i < nr; i++) {
+		works[i].ht = ht;
+		works[i].old_tbl = old_tbl;
+		works[i].start = i * chunk;
+		works[i].end = min(old_tbl->size, (i + 1) * chunk);
+		works[i].err = 0;
+		INIT_WORK_ONSTACK(&works[i].work, rhashtable_rehash_range_fn);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+
+	for (i = 0; i < nr; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+		err = err ?: works[i].err;
+	}
+
+	return err;
+}
+
 static int rhashtable_rehash_table(struct rhashtable *ht)
 {
 	struct bucket_table *old_tbl = rht_dereference(ht->tbl, ht);
@@ -321,11 +389,17 @@ static int rhashtable_rehash_table(struct rhashtable *ht)
 	if (!new_tbl)
 		return 0;
 
-	for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
-		err = rhashtable_rehash_chain(ht, old_hash);
+	if (old_tbl->size >= RHT_REHASH_PARALLEL_MIN && num_online_cpus() > 1) {
+		err = rhashtable_rehash_parallel(ht, old_tbl);
 		if (err)
 			return err;
-		cond_resched();
+	} else {
+		for (old_hash = 0; old_hash < old_tbl->size; old_hash++) {
+			err = rhashtable_rehash_chain(ht, old_tbl, old_hash);
+			if (err)
+				return err;
+			cond_resched();
+		}
 	}
 
 	/* Publish the new table pointer. */
@@ -436,6 +510,59 @@ static void rht_deferred_worker(struct work_struct *work)
 		schedule_work(&ht->run_work);
 }
 
+/**
+ * rhashtable_reserve - Pre-size a hash table ahead of a bulk insert
+ * @ht:		hash table
+ * @nelems:	number of elements the table is expected to hold
+ *
+ * Grows the table in one step so that @nelems elements fit below the 75%
+ * load factor, instead of doubling repeatedly while a large batch of
+ * elements is inserted. Concurrent lookups, insertions and removals remain
+ * valid while the table is migrated. The table may still shrink again
+ * later if automatic_shrinking is set and the elements never arrive.
+ *
+ * Must be called from process context.
+ *
+ * Returns zero on success, -ENOMEM if the new table cannot be allocated.
+ */
+int rhashtable_reserve(struct rhashtable *ht, unsigned int nelems)
+{
+	struct bucket_table *tbl;
+	unsigned int size;
+	int err = 0;
+
+	might_sleep();
+
+	size = roundup_pow_of_two(min_t(u64, (u64)nelems * 4 / 3 + 1, 1U << 30));
+	if (ht->p.max_size)
+		size = min_t(unsigned int, size, ht->p.max_size);
+
+	mutex_lock(&ht->mutex);
+
+	tbl = rhashtable_last_table(ht, rht_dereference(ht->tbl, ht));
+	if (tbl->size < size)
+		err = rhashtable_rehash_alloc(ht, tbl, size);
+
+	/*
+	 * Finish our rehash, and any one that was already pending, before
+	 * returning so that the caller's inserts land in the final table.
+	 * Leave anything that needs another pass, e.g. a nested table
+	 * attached under memory pressure, to the deferred worker.
+	 */
+	if (!err || err == -EEXIST) {
+		err = rhashtable_rehash_table(ht);
+		if (err == -EAGAIN) {
+			schedule_work(&ht->run_work);
+			err = 0;
+		}
+	}
+
+	mutex_unlock(&ht->mutex);
+
+	return err;
+}
+EXPORT_SYMBOL_GPL(rhashtable_reserve);
+
 static int rhashtable_insert_rehash(struct rhashtable *ht,
 				    struct bucket_table *tbl)
 {
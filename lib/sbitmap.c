@@ -9,6 +9,30 @@
 #include <linux/sbitmap.h>
 #include <linux/seq_file.h>
 
+/*
+ * Pick a random hint, within the words of @node's range if the map is NUMA
+ * partitioned. Searches starting there only move on to the words of the
+ * following nodes once the local range is exhausted.
+ */
+static unsigned int sbitmap_node_hint(struct sbitmap *sb, unsigned int depth,
+				      int node)
+{
+	unsigned int nr_words, start, end;
+
+	if (!depth)
+		return 0;
+	if (!sb->numa || node == NUMA_NO_NODE)
+		return prandom_u32() % depth;
+
+	nr_words = DIV_ROUND_UP(depth, 1U << sb->shift);
+	start = (nr_words * node / nr_node_ids) << sb->shift;
+	end = min(depth, (nr_words * (node + 1) / nr_node_ids) << sb->shift);
+	if (start >= end)
+		return prandom_u32() % depth;
+
+	return start + prandom_u32() % (end - start);
+}
+
 static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 {
 	unsigned depth = sb->depth;
@@ -21,7 +45,8 @@ static int init_alloc_hint(struct sbitmap *sb, gfp_t flags)
 		int i;
 
 		for_each_possible_cpu(i)
-			*per_cpu_ptr(sb->alloc_hint, i) = prandom_u32() % depth;
+			*per_cpu_ptr(sb->alloc_hint, i) =
+				sbitmap_node_hint(sb, depth, cpu_to_node(i));
 	}
 	return 0;
 }
@@ -33,7 +58,7 @@ static inline unsigned update_alloc_hint_before_get(struct sbitmap *sb,
 
 	hint = this_cpu_read(*sb->alloc_hint);
 	if (unlikely(hint >= depth)) {
-		hint = depth ? prandom_u32() % depth : 0;
+		hint = sbitmap_node_hint(sb, depth, numa_node_id());
 		this_cpu_write(*sb->alloc_hint, hint);
 	}
 
@@ -47,7 +72,8 @@ static inline void update_alloc_hint_after_get(struct sbitmap *sb,
 {
 	if (nr == -1) {
 		/* If the map is full, a hint won't do us much good. */
-		this_cpu_write(*sb->alloc_hint, 0);
+		this_cpu_write(*sb->alloc_hint,
+			       sb->numa ? sbitmap_node_hint(sb, depth, numa_node_id()) : 0);
 	} else if (nr == hint || unlikely(sb->round_robin)) {
 		/* Only update the hint if we used it. */
 		hint = nr + 1;
@@ -97,6 +123,13 @@ int sbitmap_init_node(struct sbitmap *sb, unsigned int depth, int shift,
 	sb->depth = depth;
 	sb->map_nr = DIV_ROUND_UP(sb->depth, bits_per_word);
 	sb->round_robin = round_robin;
+	/*
+	 * Give every node its own range of words, so that CPUs on different
+	 * nodes don't bounce the same cache lines until the map fills up.
+	 * Only worth it with a few words per node.
+	 */
+	sb->numa = !round_robin && alloc_hint && nr_node_ids > 1 &&
+		   sb->map_nr >= 2 * nr_node_ids;
 
 	if (depth == 0) {
 		sb->map = NULL;
@@ -766,6 +799,7 @@ void sbitmap_queue_show(struct sbitmap_queue *sbq, struct seq_file *m)
 	seq_puts(m, "}\n");
 
 	seq_printf(m, "round_robin=%d\n", sbq->sb.round_robin);
+	seq_printf(m, "numa=%d\n", sbq->sb.numa);
 	seq_printf(m, "min_shallow_depth=%u\n", sbq->min_shallow_depth);
 }
 EXPORT_SYMBOL_GPL(sbitmap_queue_show);
@@ -13,8 +13,16 @@
 #define pr_fmt(fmt) KBUILD_MODNAME ": " fmt
 
 #include <linux/types.h>
+#include <linux/cpumask.h>
 #include <linux/export.h>
+#include <linux/log2.h>
+#include <linux/minmax.h>
+#include <linux/overflow.h>
+#include <linux/sched.h>
+#include <linux/slab.h>
 #include <linux/sort.h>
+#include <linux/string.h>
+#include <linux/workqueue.h>
 
 /**
  * is_aligned - is this pointer & size okay for word-wide copying?
@@ -139,7 +147,7 @@ struct wrapper {
 static void do_swap(void *a, void *b, size_t size, swap_r_func_t swap_func, const void *priv)
 {
 	if (swap_func == SWAP_WRAPPER) {
-		((const struct wrapper *)priv)->swap(a, b, (int)size);
+		(((const struct wrapper *)priv)->swap)(a, b, (int)size);
 		return;
 	}
 
@@ -290,3 +298,227 @@ void sort(void *base, size_t num, size_t size,
 	return sort_r(base, num, size, _CMP_WRAPPER, SWAP_WRAPPER, &w);
 }
 EXPORT_SYMBOL(sort);
+
+static u64 radix_key(const void *elem, size_t key_size)
+{
+	u8 k8;
+	u16 k16;
+	u32 k32;
+	u64 k64;
+
+	switch (key_size) {
+	case 1:
+		memcpy(&k8, elem, 1);
+		return k8;
+	case 2:
+		memcpy(&k16, elem, 2);
+		return k16;
+	case 4:
+		memcpy(&k32, elem, 4);
+		return k32;
+	default:
+		memcpy(&k64, elem, 8);
+		return k64;
+	}
+}
+
+/**
+ * sort_radix - sort an array of elements by an unsigned integer key
+ * @base: pointer to data to sort
+ * @num: number of elements
+ * @size: size of each element
+ * @key_offset: offset of the key within each element
+ * @key_size: size of the key: 1, 2, 4 or 8 bytes, in CPU byte order
+ * @gfp: flags for the temporary buffer of @num elements
+ *
+ * This does a stable least-significant-digit radix sort, one byte of the
+ * key per pass. Passes in which every key has the same byte are skipped,
+ * so small keys in wide fields cost less. Sorting time is O(n) in the
+ * number of key bytes, which beats sort() for large arrays of integer keyed
+ * elements. Elements are moved with memcpy(), so they must not need a
+ * custom swap function.
+ *
+ * Return: 0 on success, -EINVAL for a bad key, or -ENOMEM if the temporary
+ * buffer could not be allocated; the array is left unchanged on error.
+ */
+int sort_radix(void *base, size_t num, size_t size, size_t key_offset,
+	       size_t key_size, gfp_t gfp)
+{
+	void *src = base, *dst, *tmp;
+	size_t *count, count_off;
+	unsigned int pass;
+	size_t i, sum;
+
+	if ((key_size != 1 && key_size != 2 && key_size != 4 && key_size != 8) ||
+	    key_offset + key_size > size)
+		return -EINVAL;
+	if (num < 2)
+		return 0;
+
+	/* The counts follow the elements, aligned for size_t. */
+	count_off = ALIGN_DOWN(size_add(array_size(num, size),
+					sizeof(*count) - 1), sizeof(*count));
+	tmp = kvmalloc(size_add(count_off, array_size(256, sizeof(*count))),
+		       gfp);
+	if (!tmp)
+		return -ENOMEM;
+	count = tmp + count_off;
+	dst = tmp;
+
+	for (pass = 0; pass < key_size; pass++) {
+		unsigned int shift = pass * 8;
+
+		memset(count, 0, 256 * sizeof(*count));
+		for (i = 0; i < num; i++)
+			count[(radix_key(src + i * size + key_offset, key_size) >> shift) & 0xff]++;
+
+		/* All keys share this byte, nothing to do. */
+		if (count[(radix_key(src + key_offset, key_size) >> shift) & 0xff] == num)
+			continue;
+
+		for (i = 0, sum = 0; i < 256; i++) {
+			size_t c = count[i];
+
+			count[i] = sum;
+			sum += c;
+		}
+
+		for (i = 0; i < num; i++) {
+			const void *elem = src + i * size;
+			unsigned int digit = (radix_key(elem + key_offset, key_size) >> shift) & 0xff;
+
+			memcpy(dst + count[digit]++ * size, elem, size);
+		}
+
+		swap(src, dst);
+		cond_resched();
+	}
+
+	if (src != base)
+		memcpy(base, src, num * size);
+	kvfree(tmp);
+	return 0;
+}
+EXPORT_SYMBOL(sort_radix);
+
+/* Inputs smaller than this are not worth spreading over several CPUs. */
+#define SORT_PARALLEL_MIN	(1UL << 16)
+#define SORT_PARALLEL_CHUNKS	8
+
+struct sort_work {
+	struct work_struct work;
+	void *src;
+	void *dst;
+	size_t lo, mid, hi;
+	size_t size;
+	cmp_func_t cmp;
+};
+
+static void sort_chunk_fn(struct work_struct *work)
+{
+	struct sort_work *sw = container_of(work, struct sort_work, work);
+
+	sort(sw->src + sw->lo * sw->size, sw->hi - sw->lo, sw->size, sw->cmp, NULL);
+}
+
+/* Merge [lo, mid) and [mid, hi) of src into dst; stable. */
+static void sort_merge_fn(struct work_struct *work)
+{
+	struct sort_work *sw = container_of(work, struct sort_work, work);
+	size_t size = sw->size, a = sw->lo, b = sw->mid, o = sw->lo;
+
+	while (a < sw->mid && b < sw->hi) {
+		if (sw->cmp(sw->src + b * size, sw->src + a * size) < 0)
+			memcpy(sw->dst + o++ * size, sw->src + b++ * size, size);
+		else
+			memcpy(sw->dst + o++ * size, sw->src + a++ * size, size);
+		if (!(o & 4095))
+			cond_resched();
+	}
+	memcpy(sw->dst + o * size, sw->src + a * size, (sw->mid - a) * size);
+	o += sw->mid - a;
+	memcpy(sw->dst + o * size, sw->src + b * size, (sw->hi - b) * size);
+}
+
+/**
+ * sort_parallel - sort a large array of elements on several CPUs
+ * @base: pointer to data to sort
+ * @num: number of elements
+ * @size: size of each element
+ * @cmp_func: pointer to comparison function
+ * @gfp: flags for the temporary buffer of @num elements
+ *
+ * For large arrays, this sorts up to eight chunks concurrently with sort()
+ * on the unbound workqueue and then merges them pairwise, again in
+ * parallel. Smaller arrays, or a failure to allocate the temporary buffer,
+ * fall back to sort() in the calling context. The result is the same as
+ * from sort(), except that elements comparing equal may be ordered
+ * differently. Elements are moved with memcpy(), so they must not need a
+ * custom swap function.
+ *
+ * Context: Process context, may sleep.
+ */
+void sort_parallel(void *base, size_t num, size_t size, cmp_func_t cmp_func,
+		   gfp_t gfp)
+{
+	struct sort_work works[SORT_PARALLEL_CHUNKS];
+	size_t bound[SORT_PARALLEL_CHUNKS + 1];
+	unsigned int nr, width, i, n;
+	void *src = base, *dst;
+
+	might_sleep();
+
+	nr = min_t(unsigned int, num_online_cpus(), SORT_PARALLEL_CHUNKS);
+	if (num < SORT_PARALLEL_MIN || nr < 2)
+		goto fallback;
+	nr = rounddown_pow_of_two(nr);
+
+	dst = kvmalloc_array(num, size, gfp);
+	if (!dst)
+		goto fallback;
+
+	for (i = 0; i <= nr; i++)
+		bound[i] = num * i / nr;
+
+	for (i = 0; i < nr; i++) {
+		works[i] = (struct sort_work) {
+			.src = base, .lo = bound[i], .hi = bound[i + 1],
+			.size = size, .cmp = cmp_func,
+		};
+		INIT_WORK_ONSTACK(&works[i].work, sort_chunk_fn);
+		queue_work(system_unbound_wq, &works[i].work);
+	}
+	for (i = 0; i < nr; i++) {
+		flush_work(&works[i].work);
+		destroy_work_on_stack(&works[i].work);
+	}
+
+	for (width = 1; width < nr; width *= 2) {
+		for (i = 0, n = 0; i < nr; i += 2 * width, n++) {
+			works[n] = (struct sort_work) {
+				.src = src, .dst = dst, .lo = bound[i],
+				.mid = bound[i + width], .hi = bound[i + 2 * width],
+				.size = size, .cmp = cmp_func,
+			};
+			INIT_WORK_ONSTACK(&works[n].work, sort_merge_fn);
+			queue_work(system_unbound_wq, &works[n].work);
+		}
+		for (i = 0; i < n; i++) {
+			flush_work(&works[i].work);
+			destroy_work_on_stack(&works[i].work);
+		}
+		swap(src, dst);
+	}
+
+	if (src != base) {
+		memcpy(base, src, num * size);
+		kvfree(src);
+	} else {
+		kvfree(dst);
+	}
+	return;
+
+fallback:
+	sort(base, num, size, cmp_func, NULL);
+}
+EXPORT_SYMBOL(sort_parallel);
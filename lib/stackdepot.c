@@ -19,6 +19,7 @@
  * Based on code by Dmitry Chernenkov.
  */
 
+#include <linux/debugfs.h>
 #include <linux/gfp.h>
 #include <linux/jhash.h>
 #include <linux/kernel.h>
@@ -26,6 +27,7 @@
 #include <linux/mutex.h>
 #include <linux/percpu.h>
 #include <linux/printk.h>
+#include <linux/seq_file.h>
 #include <linux/slab.h>
 #include <linux/stacktrace.h>
 #include <linux/stackdepot.h>
@@ -76,6 +78,38 @@ static int next_slab_inited;
 static size_t depot_offset;
 static DEFINE_RAW_SPINLOCK(depot_lock);
 
+/*
+ * Per-CPU direct-mapped cache of recently saved stacks, indexed by hash. Stack
+ * records are never freed, so a stale or racing entry is always safe to
+ * dereference; a cache hit still compares the full trace.
+ */
+#define DEPOT_PCP_CACHE_BITS 6
+#define DEPOT_PCP_CACHE_SIZE (1 << DEPOT_PCP_CACHE_BITS)
+static DEFINE_PER_CPU(struct stack_record *[DEPOT_PCP_CACHE_SIZE], depot_pcp_cache);
+
+enum depot_counter_id {
+	DEPOT_COUNTER_LOOKUPS,
+	DEPOT_COUNTER_PCP_HITS,
+	DEPOT_COUNTER_TABLE_HITS,
+	DEPOT_COUNTER_STACKS,
+	DEPOT_COUNTER_FAILS,
+	DEPOT_COUNTER_COUNT,
+};
+static DEFINE_PER_CPU(unsigned long [DEPOT_COUNTER_COUNT], depot_counters);
+static const char *const depot_counter_names[] = {
+	[DEPOT_COUNTER_LOOKUPS]		= "lookups",
+	[DEPOT_COUNTER_PCP_HITS]	= "percpu_cache_hits",
+	[DEPOT_COUNTER_TABLE_HITS]	= "table_hits",
+	[DEPOT_COUNTER_STACKS]		= "unique_stacks",
+	[DEPOT_COUNTER_FAILS]		= "failures",
+};
+static_assert(ARRAY_SIZE(depot_counter_names) == DEPOT_COUNTER_COUNT);
+
+static inline void depot_count(enum depot_counter_id id)
+{
+	raw_cpu_inc(depot_counters[id]);
+}
+
 static bool init_stack_slab(void **prealloc)
 {
 	if (!*prealloc)
@@ -259,6 +293,25 @@ static inline struct stack_record *find_stack(struct stack_record *bucket,
 	return NULL;
 }
 
+/* Look the stack trace up in this CPU's cache of recently saved stacks. */
+static inline struct stack_record *find_stack_pcp(unsigned long *entries,
+						  int size, u32 hash)
+{
+	struct stack_record *found;
+
+	found = READ_ONCE(raw_cpu_ptr(depot_pcp_cache)[hash & (DEPOT_PCP_CACHE_SIZE - 1)]);
+	if (found && found->hash == hash && found->size == size &&
+	    !stackdepot_memcmp(entries, found->entries, size))
+		return found;
+	return NULL;
+}
+
+static inline void update_stack_pcp(struct stack_record *stack)
+{
+	WRITE_ONCE(raw_cpu_ptr(depot_pcp_cache)[stack->hash & (DEPOT_PCP_CACHE_SIZE - 1)],
+		   stack);
+}
+
 /**
  * stack_depot_snprint - print stack entries from a depot into a buffer
  *
@@ -386,6 +439,16 @@ depot_stack_handle_t __stack_depot_save(unsigned long *entries,
 		goto fast_exit;
 
 	hash = hash_stack(entries, nr_entries);
+	depot_count(DEPOT_COUNTER_LOOKUPS);
+
+	/* Repeated call sites are usually served from the per-CPU cache. */
+	found = find_stack_pcp(entries, nr_entries, hash);
+	if (found) {
+		depot_count(DEPOT_COUNTER_PCP_HITS);
+		retval = found->handle.handle;
+		goto fast_exit;
+	}
+
 	bucket = &stack_table[hash & STACK_HASH_MASK];
 
 	/*
@@ -395,8 +458,10 @@ depot_stack_handle_t __stack_depot_save(unsigned long *entries,
 	 */
 	found = find_stack(smp_load_acquire(bucket), entries,
 			   nr_entries, hash);
-	if (found)
+	if (found) {
+		depot_count(DEPOT_COUNTER_TABLE_HITS);
 		goto exit;
+	}
 
 	/*
 	 * Check if the current or the next stack slab need to be initialized.
@@ -434,6 +499,7 @@ depot_stack_handle_t __stack_depot_save(unsigned long *entries,
 			 */
 			smp_store_release(bucket, new);
 			found = new;
+			depot_count(DEPOT_COUNTER_STACKS);
 		}
 	} else if (prealloc) {
 		/*
@@ -449,8 +515,12 @@ depot_stack_handle_t __stack_depot_save(unsigned long *entries,
 		/* Nobody used this memory, ok to free it. */
 		free_pages((unsigned long)prealloc, STACK_ALLOC_ORDER);
 	}
-	if (found)
+	if (found) {
+		update_stack_pcp(found);
 		retval = found->handle.handle;
+	} else {
+		depot_count(DEPOT_COUNTER_FAILS);
+	}
 fast_exit:
 	return retval;
 }
@@ -475,3 +545,35 @@ depot_stack_handle_t stack_depot_save(unsigned long *entries,
 	return __stack_depot_save(entries, nr_entries, alloc_flags, true);
 }
 EXPORT_SYMBOL_GPL(stack_depot_save);
+
+static int stats_show(struct seq_file *seq, void *v)
+{
+	unsigned long sums[DEPOT_COUNTER_COUNT] = {};
+	int cpu, i;
+
+	for_each_possible_cpu(cpu) {
+		for (i = 0; i < DEPOT_COUNTER_COUNT; i++)
+			sums[i] += per_cpu(depot_counters, cpu)[i];
+	}
+
+	for (i = 0; i < DEPOT_COUNTER_COUNT; i++)
+		seq_printf(seq, "%s: %lu\n", depot_counter_names[i], sums[i]);
+	seq_printf(seq, "slabs: %d\n", READ_ONCE(depot_index) + 1);
+	seq_printf(seq, "slab_offset: %zu\n", READ_ONCE(depot_offset));
+
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(stats);
+
+static int __init stack_depot_debugfs_init(void)
+{
+	struct dentry *dir;
+
+	if (stack_depot_disable)
+		return 0;
+
+	dir = debugfs_create_dir("stackdepot", NULL);
+	debugfs_create_file("stats", 0444, dir, NULL, &stats_fops);
+	return 0;
+}
+late_initcall(stack_depot_debugfs_init);
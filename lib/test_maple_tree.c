@@ -36305,6 +36305,111 @@ static noinline void check_mas_store_gfp(struct maple_tree *mt)
 	mtree_destroy(&newmt);
 }
 
+/* Check that @new has the same shape and entries as @mt. */
+static noinline void check_dup_tree(struct maple_tree *mt,
+				    struct maple_tree *new)
+{
+	void *val;
+	MA_STATE(mas, mt, 0, 0);
+	MA_STATE(new_mas, new, 0, 0);
+
+	MT_BUG_ON(new, mt_height(new) != mt_height(mt));
+	mt_validate(new);
+
+	mas_for_each(&mas, val, ULONG_MAX) {
+		MT_BUG_ON(new, mas_find(&new_mas, ULONG_MAX) != val);
+		MT_BUG_ON(new, new_mas.index != mas.index);
+		MT_BUG_ON(new, new_mas.last != mas.last);
+	}
+	MT_BUG_ON(new, mas_find(&new_mas, ULONG_MAX) != NULL);
+}
+
+static noinline void check_mtree_dup(struct maple_tree *mt)
+{
+	struct maple_tree new;
+	unsigned long i, nr_entries;
+	int ret;
+
+	/* Duplicating an empty tree. */
+	mt_init_flags(&new, MT_FLAGS_ALLOC_RANGE);
+	ret = mtree_dup(mt, &new, GFP_NOWAIT);
+	MT_BUG_ON(&new, ret);
+	MT_BUG_ON(&new, !mtree_empty(&new));
+	mtree_destroy(&new);
+
+	/* A tree with a single entry at 0 has no node. */
+	mtree_store_range(mt, 0, 0, xa_mk_value(0), GFP_KERNEL);
+	mt_init_flags(&new, MT_FLAGS_ALLOC_RANGE);
+	ret = mtree_dup(mt, &new, GFP_NOWAIT);
+	MT_BUG_ON(&new, ret);
+	check_dup_tree(mt, &new);
+	mtree_destroy(&new);
+	mtree_destroy(mt);
+
+	/* Trees of increasing height, with gaps between the ranges. */
+	for (nr_entries = 1; nr_entries <= 3000; nr_entries *= 3) {
+		mt_init_flags(mt, MT_FLAGS_ALLOC_RANGE);
+		for (i = 0; i <= nr_entries; i++)
+			mtree_store_range(mt, i * 10, i * 10 + 5,
+					  xa_mk_value(i), GFP_KERNEL);
+
+		mt_init_flags(&new, MT_FLAGS_ALLOC_RANGE);
+		mt_set_non_kernel(99999);
+		ret = mtree_dup(mt, &new, GFP_NOWAIT);
+		mt_set_non_kernel(0);
+		MT_BUG_ON(&new, ret);
+		check_dup_tree(mt, &new);
+		mtree_destroy(&new);
+		mtree_destroy(mt);
+	}
+
+	/* The flags of the trees have to match. */
+	mt_init_flags(mt, MT_FLAGS_ALLOC_RANGE);
+	for (i = 0; i <= 100; i++)
+		mtree_store_range(mt, i * 10, i * 10 + 5, xa_mk_value(i),
+				  GFP_KERNEL);
+	mt_init_flags(&new, 0);
+	ret = mtree_dup(mt, &new, GFP_NOWAIT);
+	MT_BUG_ON(&new, ret != -EINVAL);
+	MT_BUG_ON(&new, !mtree_empty(&new));
+	mtree_destroy(&new);
+
+	/* The new tree has to be empty. */
+	mt_init_flags(&new, MT_FLAGS_ALLOC_RANGE);
+	mtree_store_range(&new, 5, 10, xa_mk_value(5), GFP_KERNEL);
+	ret = mtree_dup(mt, &new, GFP_NOWAIT);
+	MT_BUG_ON(&new, ret != -EINVAL);
+	MT_BUG_ON(&new, mtree_load(&new, 5) != xa_mk_value(5));
+	mtree_destroy(&new);
+	mtree_destroy(mt);
+
+	/*
+	 * Fail the allocations at every point of the copy: the partial copy
+	 * has to be freed and the new tree left empty, which also checks that
+	 * mas_dup_free() does not leak nodes.
+	 */
+	mt_init_flags(mt, MT_FLAGS_ALLOC_RANGE);
+	for (i = 0; i <= 1000; i++)
+		mtree_store_range(mt, i * 10, i * 10 + 5, xa_mk_value(i),
+				  GFP_KERNEL);
+
+	for (i = 0; ; i++) {
+		mt_init_flags(&new, MT_FLAGS_ALLOC_RANGE);
+		mt_set_non_kernel(i);
+		ret = mtree_dup(mt, &new, GFP_NOWAIT);
+		mt_set_non_kernel(0);
+		if (!ret)
+			break;
+
+		MT_BUG_ON(&new, ret != -ENOMEM);
+		MT_BUG_ON(&new, !mtree_empty(&new));
+		mtree_destroy(&new);
+	}
+	MT_BUG_ON(&new, !i);
+	check_dup_tree(mt, &new);
+	mtree_destroy(&new);
+}
+
 #if defined(BENCH_FORK)
 static noinline void bench_forking(struct maple_tree *mt)
 {
@@ -37971,6 +38076,10 @@ static int maple_tree_seed(void)
 	check_mas_store_gfp(&tree);
 	mtree_destroy(&tree);
 
+	mt_init_flags(&tree, MT_FLAGS_ALLOC_RANGE);
+	check_mtree_dup(&tree);
+	mtree_destroy(&tree);
+
 	/* Test ranges (store and insert) */
 	mt_init_flags(&tree, 0);
 	check_ranges(&tree);
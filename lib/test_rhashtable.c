@@ -482,6 +482,106 @@ static int __init test_rhashtable_max(struct test_obj *array,
 	return err;
 }
 
+/* Checks that @ht holds @nelems below the 75% load factor, not rehashing. */
+static int __init test_rht_reserved(struct rhashtable *ht, unsigned int nelems,
+				    unsigned int *size)
+{
+	struct bucket_table *tbl;
+	bool rehashing;
+
+	rcu_read_lock();
+	tbl = rht_dereference_rcu(ht->tbl, ht);
+	*size = tbl->size;
+	rehashing = rcu_access_pointer(tbl->future_tbl);
+	rcu_read_unlock();
+
+	if (rehashing || nelems > *size / 4 * 3) {
+		pr_warn("Test failed: %u buckets%s for %u reserved elements\n",
+			*size, rehashing ? " still rehashing" : "", nelems);
+		return -EINVAL;
+	}
+
+	return 0;
+}
+
+static int __init test_rht_reserve_insert(struct test_obj *array,
+					  unsigned int start, unsigned int end,
+					  unsigned int size)
+{
+	unsigned int i, new_size;
+	int err;
+
+	for (i = start; i < end; i++) {
+		struct test_obj *obj = &array[i];
+
+		obj->value.id = i * 2;
+		err = insert_retry(&ht, obj, test_rht_params);
+		if (err < 0)
+			return err;
+	}
+
+	err = test_rht_reserved(&ht, end, &new_size);
+	if (!err && new_size != size) {
+		pr_warn("Test failed: table resized from %u to %u buckets after reserve\n",
+			size, new_size);
+		err = -EINVAL;
+	}
+
+	return err;
+}
+
+/*
+ * Reserve for half of the entries on an empty table, then for all of them
+ * once the first half is in, so that the second reserve migrates a table
+ * big enough to be rehashed by several workers. Neither load may resize
+ * the table.
+ */
+static int __init test_rhashtable_reserve(struct test_obj *array,
+					  unsigned int entries)
+{
+	unsigned int i, half = entries / 2, size;
+	int err;
+
+	memset(array, 0, entries * sizeof(struct test_obj));
+	test_rht_params.max_size = 0;
+	err = rhashtable_init(&ht, &test_rht_params);
+	if (err)
+		return err;
+
+	err = rhashtable_reserve(&ht, half);
+	if (!err)
+		err = test_rht_reserved(&ht, half, &size);
+	if (!err)
+		err = test_rht_reserve_insert(array, 0, half, size);
+	if (err)
+		goto out;
+
+	err = rhashtable_reserve(&ht, entries);
+	if (!err)
+		err = test_rht_reserved(&ht, entries, &size);
+	if (err)
+		goto out;
+
+	for (i = 0; i < half; i++) {
+		struct test_obj_val key = {
+			.id = i * 2,
+		};
+
+		if (!rhashtable_lookup_fast(&ht, &key, test_rht_params)) {
+			pr_warn("Test failed: key %u lost by rhashtable_reserve\n",
+				key.id);
+			err = -ENOENT;
+			goto out;
+		}
+	}
+
+	err = test_rht_reserve_insert(array, half, entries, size);
+out:
+	rhashtable_destroy(&ht);
+
+	return err;
+}
+
 static unsigned int __init print_ht(struct rhltable *rhlt)
 {
 	struct rhashtable *ht;
@@ -746,6 +846,8 @@ static int __init test_rht_init(void)
 	pr_info("test if its possible to exceed max_size %d: %s\n",
 			test_rht_params.max_size, test_rhashtable_max(objs, entries) == 0 ?
 			"no, ok" : "YES, failed");
+	pr_info("test rhashtable_reserve with %u entries: %s\n", entries,
+		test_rhashtable_reserve(objs, entries) == 0 ? "ok" : "failed");
 	vfree(objs);
 
 	do_div(total_time, runs);
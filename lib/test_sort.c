@@ -33,8 +33,61 @@ static void test_sort(struct kunit *test)
 		KUNIT_ASSERT_LE(test, a[i], a[i + 1]);
 }
 
+struct radix_elem {
+	u32 key;
+	u32 idx;
+};
+
+static void test_sort_radix(struct kunit *test)
+{
+	struct radix_elem *a;
+	int i, r = 1;
+
+	a = kunit_kmalloc_array(test, TEST_LEN, sizeof(*a), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, a);
+
+	for (i = 0; i < TEST_LEN; i++) {
+		r = (r * 725861) % 6599;
+		a[i].key = r % 512;
+		a[i].idx = i;
+	}
+
+	KUNIT_ASSERT_EQ(test, sort_radix(a, TEST_LEN, sizeof(*a),
+					 offsetof(struct radix_elem, key),
+					 sizeof(a->key), GFP_KERNEL), 0);
+
+	/* Sorted by key, and stable. */
+	for (i = 0; i < TEST_LEN-1; i++) {
+		KUNIT_ASSERT_LE(test, a[i].key, a[i + 1].key);
+		if (a[i].key == a[i + 1].key)
+			KUNIT_ASSERT_LT(test, a[i].idx, a[i + 1].idx);
+	}
+}
+
+#define TEST_PARALLEL_LEN 100000
+
+static void test_sort_parallel(struct kunit *test)
+{
+	int *a, i, r = 1;
+
+	a = kunit_kmalloc_array(test, TEST_PARALLEL_LEN, sizeof(*a), GFP_KERNEL);
+	KUNIT_ASSERT_NOT_ERR_OR_NULL(test, a);
+
+	for (i = 0; i < TEST_PARALLEL_LEN; i++) {
+		r = (r * 725861) % 6599;
+		a[i] = r;
+	}
+
+	sort_parallel(a, TEST_PARALLEL_LEN, sizeof(*a), cmpint, GFP_KERNEL);
+
+	for (i = 0; i < TEST_PARALLEL_LEN-1; i++)
+		KUNIT_ASSERT_LE(test, a[i], a[i + 1]);
+}
+
 static struct kunit_case sort_test_cases[] = {
 	KUNIT_CASE(test_sort),
+	KUNIT_CASE(test_sort_radix),
+	KUNIT_CASE(test_sort_parallel),
 	{}
 };
 
@@ -1550,6 +1550,46 @@ static noinline void check_store_range(struct xarray *xa)
 	}
 }
 
+static noinline void check_store_bulk(struct xarray *xa)
+{
+	unsigned long indices[16];
+	void *entries[16];
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(entries); i++)
+		entries[i] = xa_mk_index(4090 + i);
+	XA_BUG_ON(xa, xa_store_bulk(xa, 4090, entries, ARRAY_SIZE(entries),
+				GFP_KERNEL) != 0);
+	for (i = 0; i < ARRAY_SIZE(entries); i++)
+		XA_BUG_ON(xa, xa_load(xa, 4090 + i) != xa_mk_index(4090 + i));
+	XA_BUG_ON(xa, xa_load(xa, 4089) != NULL);
+	XA_BUG_ON(xa, xa_load(xa, 4090 + ARRAY_SIZE(entries)) != NULL);
+
+	for (i = 0; i < ARRAY_SIZE(entries); i++)
+		entries[i] = NULL;
+	XA_BUG_ON(xa, xa_store_bulk(xa, 4090, entries, ARRAY_SIZE(entries),
+				GFP_KERNEL) != 0);
+	XA_BUG_ON(xa, !xa_empty(xa));
+
+	for (i = 0; i < ARRAY_SIZE(indices); i++) {
+		indices[i] = i * i * 1000;
+		entries[i] = xa_mk_index(indices[i]);
+	}
+	XA_BUG_ON(xa, xa_store_many(xa, indices, entries, ARRAY_SIZE(indices),
+				GFP_KERNEL) != 0);
+	memset(entries, 0, sizeof(entries));
+	XA_BUG_ON(xa, xa_load_bulk(xa, indices, entries, ARRAY_SIZE(indices)) !=
+			ARRAY_SIZE(indices));
+	for (i = 0; i < ARRAY_SIZE(indices); i++)
+		XA_BUG_ON(xa, entries[i] != xa_mk_index(indices[i]));
+
+	indices[0] = 1;
+	XA_BUG_ON(xa, xa_load_bulk(xa, indices, entries, 1) != 0);
+	XA_BUG_ON(xa, entries[0] != NULL);
+
+	xa_destroy(xa);
+}
+
 #ifdef CONFIG_XARRAY_MULTI
 static void check_split_1(struct xarray *xa, unsigned long index,
 				unsigned int order, unsigned int new_order)
@@ -1814,6 +1854,7 @@ static int xarray_checks(void)
 	check_move(&array);
 	check_create_range(&array);
 	check_store_range(&array);
+	check_store_bulk(&array);
 	check_store_iter(&array);
 	check_align(&xa0);
 	check_split(&array);
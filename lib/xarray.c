@@ -1470,6 +1470,45 @@ void *xa_load(struct xarray *xa, unsigned long index)
 }
 EXPORT_SYMBOL(xa_load);
 
+/**
+ * xa_load_bulk() - Load entries at several indices from an XArray.
+ * @xa: XArray.
+ * @indices: Indices to look up, preferably in ascending order.
+ * @entries: Array receiving the entry found at each index.
+ * @n: Number of indices.
+ *
+ * Equivalent to calling xa_load() for each index, but takes the RCU lock
+ * only once.  Indices with no entry are returned as %NULL.  To copy out all
+ * entries in a range instead, use xa_extract().
+ *
+ * Context: Any context.  Takes and releases the RCU lock.
+ * Return: The number of indices at which an entry was found.
+ */
+unsigned int xa_load_bulk(struct xarray *xa, const unsigned long *indices,
+		void **entries, unsigned int n)
+{
+	XA_STATE(xas, xa, 0);
+	unsigned int i, found = 0;
+	void *entry;
+
+	rcu_read_lock();
+	for (i = 0; i < n; i++) {
+		xas_set(&xas, indices[i]);
+		do {
+			entry = xas_load(&xas);
+			if (xa_is_zero(entry))
+				entry = NULL;
+		} while (xas_retry(&xas, entry));
+		entries[i] = entry;
+		if (entry)
+			found++;
+	}
+	rcu_read_unlock();
+
+	return found;
+}
+EXPORT_SYMBOL(xa_load_bulk);
+
 static void *xas_result(struct xa_state *xas, void *curr)
 {
 	if (xa_is_zero(curr))
@@ -1697,6 +1736,101 @@ static void xas_set_range(struct xa_state *xas, unsigned long first,
 	xas->xa_sibs = sibs;
 }
 
+static int __xa_store_bulk(struct xarray *xa, unsigned long first,
+		const unsigned long *indices, void **entries, unsigned int n,
+		gfp_t gfp)
+{
+	XA_STATE(xas, xa, first);
+	unsigned int i;
+
+	for (i = 0; i < n; i++) {
+		void *entry = entries[i];
+
+		if (WARN_ON_ONCE(xa_is_advanced(entry)))
+			return -EINVAL;
+		if (xa_track_free(xa) && !entry)
+			entry = XA_ZERO_ENTRY;
+
+		xas_set(&xas, indices ? indices[i] : first + i);
+		do {
+			xas_store(&xas, entry);
+			if (xa_track_free(xa))
+				xas_clear_mark(&xas, XA_FREE_MARK);
+		} while (__xas_nomem(&xas, gfp));
+
+		if (xas_error(&xas))
+			return xas_error(&xas);
+	}
+
+	return 0;
+}
+
+/**
+ * xa_store_bulk() - Store entries at consecutive indices in the XArray.
+ * @xa: XArray.
+ * @first: Index of the first entry.
+ * @entries: Entries to store.
+ * @n: Number of entries.
+ * @gfp: Memory allocation flags.
+ *
+ * Stores @entries[i] at index @first + i, taking the xa_lock only once for
+ * the whole batch.  The lock is only dropped if memory has to be allocated
+ * for a new node.  This is not atomic: if an error is returned, the entries
+ * before the one that failed have already been stored.  Previous entries at
+ * these indices are overwritten.
+ *
+ * Context: Any context.  Takes and releases the xa_lock.
+ * May sleep if the @gfp flags permit.
+ * Return: 0 on success, -EINVAL if an entry cannot be stored in an XArray
+ * or the range wraps, or -ENOMEM if memory allocation failed.
+ */
+int xa_store_bulk(struct xarray *xa, unsigned long first, void **entries,
+		unsigned int n, gfp_t gfp)
+{
+	int err;
+
+	if (!n)
+		return 0;
+	if (WARN_ON_ONCE(first + n - 1 < first))
+		return -EINVAL;
+
+	xa_lock(xa);
+	err = __xa_store_bulk(xa, first, NULL, entries, n, gfp);
+	xa_unlock(xa);
+
+	return err;
+}
+EXPORT_SYMBOL(xa_store_bulk);
+
+/**
+ * xa_store_many() - Store entries at several indices in the XArray.
+ * @xa: XArray.
+ * @indices: Indices to store at, preferably in ascending order.
+ * @entries: Entries to store; @entries[i] is stored at @indices[i].
+ * @n: Number of entries.
+ * @gfp: Memory allocation flags.
+ *
+ * Like xa_store_bulk(), but for indices which need not be consecutive.
+ * Sorted indices keep successive stores within the same nodes.
+ *
+ * Context: Any context.  Takes and releases the xa_lock.
+ * May sleep if the @gfp flags permit.
+ * Return: 0 on success, -EINVAL if an entry cannot be stored in an XArray,
+ * or -ENOMEM if memory allocation failed.
+ */
+int xa_store_many(struct xarray *xa, const unsigned long *indices,
+		void **entries, unsigned int n, gfp_t gfp)
+{
+	int err;
+
+	xa_lock(xa);
+	err = __xa_store_bulk(xa, 0, indices, entries, n, gfp);
+	xa_unlock(xa);
+
+	return err;
+}
+EXPORT_SYMBOL(xa_store_many);
+
 /**
  * xa_store_range() - Store this entry at a range of indices in the XArray.
  * @xa: XArray.
@@ -7,6 +7,8 @@
 
 #define pr_fmt(fmt) "damon-pa: " fmt
 
+#include <linux/migrate.h>
+#include <linux/mm_inline.h>
 #include <linux/mmu_notifier.h>
 #include <linux/page_idle.h>
 #include <linux/pagemap.h>
@@ -265,6 +267,73 @@ static unsigned long damon_pa_deactivate_pages(struct damon_region *r)
 	return applied * PAGE_SIZE;
 }
 
+/* Number of pages isolated at once for a migration batch */
+#define DAMON_PA_MIGRATE_BATCH	512
+
+static unsigned int damon_pa_migrate_list(struct list_head *page_list,
+		struct migration_target_control *mtc, int reason)
+{
+	unsigned int nr_succeeded = 0;
+
+	if (list_empty(page_list))
+		return 0;
+
+	migrate_pages(page_list, alloc_migration_target, NULL,
+			(unsigned long)mtc, MIGRATE_ASYNC, reason,
+			&nr_succeeded);
+	putback_movable_pages(page_list);
+	cond_resched();
+	return nr_succeeded;
+}
+
+static unsigned long damon_pa_migrate(struct damon_region *r,
+		struct damos *s)
+{
+	struct migration_target_control mtc = {
+		.nid = s->target_nid,
+		/* Like demotion, don't reclaim on the target to make room */
+		.gfp_mask = (GFP_HIGHUSER_MOVABLE & ~__GFP_RECLAIM) |
+			__GFP_THISNODE | __GFP_NOWARN | __GFP_NOMEMALLOC |
+			GFP_NOWAIT,
+	};
+	int reason = s->action == DAMOS_MIGRATE_HOT ?
+		MR_NUMA_MISPLACED : MR_DEMOTION;
+	unsigned long addr, applied = 0;
+	unsigned int nr_isolated = 0;
+	LIST_HEAD(page_list);
+
+	if (s->target_nid == NUMA_NO_NODE ||
+	    !node_state(s->target_nid, N_MEMORY))
+		return 0;
+
+	for (addr = r->ar.start; addr < r->ar.end; addr += PAGE_SIZE) {
+		struct page *page = damon_get_page(PHYS_PFN(addr));
+
+		if (!page)
+			continue;
+
+		if (page_to_nid(page) == s->target_nid ||
+		    isolate_lru_page(page)) {
+			put_page(page);
+			continue;
+		}
+		mod_node_page_state(page_pgdat(page),
+				NR_ISOLATED_ANON + page_is_file_lru(page),
+				thp_nr_pages(page));
+		list_add(&page->lru, &page_list);
+		put_page(page);
+
+		if (++nr_isolated == DAMON_PA_MIGRATE_BATCH) {
+			applied += damon_pa_migrate_list(&page_list, &mtc,
+					reason);
+			nr_isolated = 0;
+		}
+	}
+	applied += damon_pa_migrate_list(&page_list, &mtc, reason);
+
+	return applied * PAGE_SIZE;
+}
+
 static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
@@ -276,6 +345,9 @@ static unsigned long damon_pa_apply_scheme(struct damon_ctx *ctx,
 		return damon_pa_mark_accessed(r);
 	case DAMOS_LRU_DEPRIO:
 		return damon_pa_deactivate_pages(r);
+	case DAMOS_MIGRATE_HOT:
+	case DAMOS_MIGRATE_COLD:
+		return damon_pa_migrate(r, scheme);
 	default:
 		break;
 	}
@@ -293,6 +365,10 @@ static int damon_pa_scheme_score(struct damon_ctx *context,
 		return damon_hot_score(context, r, scheme);
 	case DAMOS_LRU_DEPRIO:
 		return damon_pageout_score(context, r, scheme);
+	case DAMOS_MIGRATE_HOT:
+		return damon_hot_score(context, r, scheme);
+	case DAMOS_MIGRATE_COLD:
+		return damon_pageout_score(context, r, scheme);
 	default:
 		break;
 	}
@@ -14,6 +14,7 @@
 #include <linux/page_idle.h>
 #include <linux/pagewalk.h>
 #include <linux/sched/mm.h>
+#include <linux/workqueue.h>
 
 #include "ops-common.h"
 
@@ -401,20 +402,101 @@ static void __damon_va_prepare_access_check(struct damon_ctx *ctx,
 	damon_va_mkold(mm, r->sampling_addr);
 }
 
-static void damon_va_prepare_access_checks(struct damon_ctx *ctx)
+/*
+ * Sampling of different targets is independent, so contexts monitoring many
+ * processes spread it over up to DAMON_VA_MAX_WORKERS workers, one per
+ * DAMON_VA_TARGETS_PER_WORKER targets.  kdamond runs one share itself and
+ * waits for the others, so aggregation still happens on sampled data only.
+ */
+#define DAMON_VA_TARGETS_PER_WORKER	16
+#define DAMON_VA_MAX_WORKERS		8
+
+struct damon_va_worker {
+	struct work_struct work;
+	struct damon_ctx *ctx;
+	unsigned int id;
+	unsigned int nr_workers;
+	bool check;
+	unsigned int max_nr_accesses;
+};
+
+static void damon_va_prepare_target(struct damon_ctx *ctx,
+		struct damon_target *t)
 {
-	struct damon_target *t;
 	struct mm_struct *mm;
 	struct damon_region *r;
 
-	damon_for_each_target(t, ctx) {
-		mm = damon_get_mm(t);
-		if (!mm)
+	mm = damon_get_mm(t);
+	if (!mm)
+		return;
+	damon_for_each_region(r, t)
+		__damon_va_prepare_access_check(ctx, mm, r);
+	mmput(mm);
+}
+
+static unsigned int damon_va_check_target(struct damon_ctx *ctx,
+		struct damon_target *t);
+
+static void damon_va_worker_fn(struct work_struct *work)
+{
+	struct damon_va_worker *w =
+		container_of(work, struct damon_va_worker, work);
+	struct damon_target *t;
+	unsigned int i = 0;
+
+	damon_for_each_target(t, w->ctx) {
+		if (i++ % w->nr_workers != w->id)
 			continue;
-		damon_for_each_region(r, t)
-			__damon_va_prepare_access_check(ctx, mm, r);
-		mmput(mm);
+		if (w->check)
+			w->max_nr_accesses = max(w->max_nr_accesses,
+					damon_va_check_target(w->ctx, t));
+		else
+			damon_va_prepare_target(w->ctx, t);
+	}
+}
+
+static unsigned int damon_va_sample_targets(struct damon_ctx *ctx, bool check)
+{
+	struct damon_va_worker workers[DAMON_VA_MAX_WORKERS];
+	unsigned int nr_targets = 0, nr_workers, max_nr_accesses = 0, i;
+	struct damon_target *t;
+
+	damon_for_each_target(t, ctx)
+		nr_targets++;
+
+	nr_workers = min3(DIV_ROUND_UP(nr_targets, DAMON_VA_TARGETS_PER_WORKER),
+			num_online_cpus(), (unsigned int)DAMON_VA_MAX_WORKERS);
+	if (!nr_workers)
+		return 0;
+
+	for (i = 0; i < nr_workers; i++) {
+		workers[i] = (struct damon_va_worker){
+			.ctx = ctx,
+			.id = i,
+			.nr_workers = nr_workers,
+			.check = check,
+		};
+		INIT_WORK_ONSTACK(&workers[i].work, damon_va_worker_fn);
+		if (i)
+			queue_work(system_unbound_wq, &workers[i].work);
+	}
+
+	damon_va_worker_fn(&workers[0].work);
+
+	for (i = 0; i < nr_workers; i++) {
+		if (i)
+			flush_work(&workers[i].work);
+		max_nr_accesses = max(max_nr_accesses,
+				workers[i].max_nr_accesses);
+		destroy_work_on_stack(&workers[i].work);
 	}
+
+	return max_nr_accesses;
+}
+
+static void damon_va_prepare_access_checks(struct damon_ctx *ctx)
+{
+	damon_va_sample_targets(ctx, false);
 }
 
 struct damon_young_walk_private {
@@ -528,57 +610,65 @@ static bool damon_va_young(struct mm_struct *mm, unsigned long addr,
 	return arg.young;
 }
 
+/* Result of the last page checked while walking a target's regions */
+struct damon_va_last_check {
+	unsigned long addr;
+	unsigned long page_sz;
+	bool accessed;
+};
+
 /*
  * Check whether the region was accessed after the last preparation
  *
  * mm	'mm_struct' for the given virtual address space
  * r	the region to be checked
+ * last	result of the previous check in the same address space, if any
  */
 static void __damon_va_check_access(struct damon_ctx *ctx,
-			       struct mm_struct *mm, struct damon_region *r)
+			       struct mm_struct *mm, struct damon_region *r,
+			       struct damon_va_last_check *last)
 {
-	static struct mm_struct *last_mm;
-	static unsigned long last_addr;
-	static unsigned long last_page_sz = PAGE_SIZE;
-	static bool last_accessed;
-
 	/* If the region is in the last checked page, reuse the result */
-	if (mm == last_mm && (ALIGN_DOWN(last_addr, last_page_sz) ==
-				ALIGN_DOWN(r->sampling_addr, last_page_sz))) {
-		if (last_accessed)
+	if (last->page_sz && (ALIGN_DOWN(last->addr, last->page_sz) ==
+				ALIGN_DOWN(r->sampling_addr, last->page_sz))) {
+		if (last->accessed)
 			r->nr_accesses++;
 		return;
 	}
 
-	last_accessed = damon_va_young(mm, r->sampling_addr, &last_page_sz);
-	if (last_accessed)
+	last->page_sz = PAGE_SIZE;
+	last->accessed = damon_va_young(mm, r->sampling_addr, &last->page_sz);
+	if (last->accessed)
 		r->nr_accesses++;
 
-	last_mm = mm;
-	last_addr = r->sampling_addr;
+	last->addr = r->sampling_addr;
 }
 
-static unsigned int damon_va_check_accesses(struct damon_ctx *ctx)
+static unsigned int damon_va_check_target(struct damon_ctx *ctx,
+		struct damon_target *t)
 {
-	struct damon_target *t;
+	struct damon_va_last_check last = {};
 	struct mm_struct *mm;
 	struct damon_region *r;
 	unsigned int max_nr_accesses = 0;
 
-	damon_for_each_target(t, ctx) {
-		mm = damon_get_mm(t);
-		if (!mm)
-			continue;
-		damon_for_each_region(r, t) {
-			__damon_va_check_access(ctx, mm, r);
-			max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
-		}
-		mmput(mm);
+	mm = damon_get_mm(t);
+	if (!mm)
+		return 0;
+	damon_for_each_region(r, t) {
+		__damon_va_check_access(ctx, mm, r, &last);
+		max_nr_accesses = max(r->nr_accesses, max_nr_accesses);
 	}
+	mmput(mm);
 
 	return max_nr_accesses;
 }
 
+static unsigned int damon_va_check_accesses(struct damon_ctx *ctx)
+{
+	return damon_va_sample_targets(ctx, true);
+}
+
 /*
  * Functions for the target validity check and cleanup
  */
@@ -598,18 +688,16 @@ static bool damon_va_target_valid(void *target)
 }
 
 #ifndef CONFIG_ADVISE_SYSCALLS
-static unsigned long damos_madvise(struct damon_target *target,
-		struct damon_region *r, int behavior)
+static unsigned long damos_madvise_range(struct damon_target *target,
+		unsigned long start, unsigned long len, int behavior)
 {
 	return 0;
 }
 #else
-static unsigned long damos_madvise(struct damon_target *target,
-		struct damon_region *r, int behavior)
+static unsigned long damos_madvise_range(struct damon_target *target,
+		unsigned long start, unsigned long len, int behavior)
 {
 	struct mm_struct *mm;
-	unsigned long start = PAGE_ALIGN(r->ar.start);
-	unsigned long len = PAGE_ALIGN(r->ar.end - r->ar.start);
 	unsigned long applied;
 
 	mm = damon_get_mm(target);
@@ -623,6 +711,34 @@ static unsigned long damos_madvise(struct damon_target *target,
 }
 #endif	/* CONFIG_ADVISE_SYSCALLS */
 
+static unsigned long damos_madvise(struct damon_target *target,
+		struct damon_region *r, int behavior)
+{
+	return damos_madvise_range(target, PAGE_ALIGN(r->ar.start),
+			PAGE_ALIGN(r->ar.end - r->ar.start), behavior);
+}
+
+/*
+ * Only whole PMD-sized ranges can be collapsed, and advising the rest of the
+ * region would just split its VMA for nothing.  Marking the range eligible
+ * also queues the mm to khugepaged, which does the actual collapse.
+ */
+static unsigned long damos_va_collapse(struct damon_target *target,
+		struct damon_region *r)
+{
+#ifdef CONFIG_TRANSPARENT_HUGEPAGE
+	unsigned long start = ALIGN(r->ar.start, HPAGE_PMD_SIZE);
+	unsigned long end = ALIGN_DOWN(r->ar.end, HPAGE_PMD_SIZE);
+
+	if (start >= end)
+		return 0;
+
+	return damos_madvise_range(target, start, end - start, MADV_HUGEPAGE);
+#else
+	return 0;
+#endif
+}
+
 static unsigned long damon_va_apply_scheme(struct damon_ctx *ctx,
 		struct damon_target *t, struct damon_region *r,
 		struct damos *scheme)
@@ -645,6 +761,8 @@ static unsigned long damon_va_apply_scheme(struct damon_ctx *ctx,
 	case DAMOS_NOHUGEPAGE:
 		madv_action = MADV_NOHUGEPAGE;
 		break;
+	case DAMOS_COLLAPSE:
+		return damos_va_collapse(t, r);
 	case DAMOS_STAT:
 		return 0;
 	default:
@@ -662,6 +780,8 @@ static int damon_va_scheme_score(struct damon_ctx *context,
 	switch (scheme->action) {
 	case DAMOS_PAGEOUT:
 		return damon_pageout_score(context, r, scheme);
+	case DAMOS_COLLAPSE:
+		return damon_hot_score(context, r, scheme);
 	default:
 		break;
 	}
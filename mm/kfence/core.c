@@ -100,6 +100,52 @@ module_param_cb(sample_interval, &sample_interval_param_ops, &kfence_sample_inte
 static unsigned long kfence_skip_covered_thresh __read_mostly = 75;
 module_param_named(skip_covered_thresh, kfence_skip_covered_thresh, ulong, 0644);
 
+/*
+ * Pool usage% threshold above which the sample interval is stretched, up to
+ * 1 << KFENCE_BACKOFF_MAX_SHIFT times at a full pool; 100 disables backoff.
+ */
+#define KFENCE_BACKOFF_MAX_SHIFT 4
+static unsigned long kfence_backoff_thresh __read_mostly = 50;
+module_param_named(backoff_thresh, kfence_backoff_thresh, ulong, 0644);
+
+/*
+ * Name of a slab cache to sample preferentially: of every target_weight sample
+ * windows, all but one only accept allocations from that cache.
+ */
+#define KFENCE_TARGET_CACHE_LEN 32
+static char kfence_target_cache[KFENCE_TARGET_CACHE_LEN];
+
+static int param_set_target_cache(const char *val, const struct kernel_param *kp)
+{
+	size_t len = strcspn(val, "\n");
+
+	if (len >= KFENCE_TARGET_CACHE_LEN)
+		return -ENOSPC;
+
+	memcpy(kp->arg, val, len);
+	((char *)kp->arg)[len] = '\0';
+	return 0;
+}
+
+static int param_get_target_cache(char *buffer, const struct kernel_param *kp)
+{
+	return sprintf(buffer, "%s\n", (char *)kp->arg);
+}
+
+static const struct kernel_param_ops target_cache_param_ops = {
+	.set = param_set_target_cache,
+	.get = param_get_target_cache,
+};
+module_param_cb(target_cache, &target_cache_param_ops, kfence_target_cache, 0644);
+static unsigned long kfence_target_weight __read_mostly = 4;
+module_param_named(target_weight, kfence_target_weight, ulong, 0644);
+
+/*
+ * The cache the current sample window is reserved for, NULL if any cache may
+ * be sampled. Only compared against, never dereferenced.
+ */
+static struct kmem_cache *kfence_window_target;
+
 /* If true, use a deferrable timer. */
 static bool kfence_deferrable __read_mostly = IS_ENABLED(CONFIG_KFENCE_DEFERRABLE);
 module_param_named(deferrable, kfence_deferrable, bool, 0444);
@@ -168,6 +214,7 @@ enum kfence_counter_id {
 	KFENCE_COUNTER_SKIP_INCOMPAT,
 	KFENCE_COUNTER_SKIP_CAPACITY,
 	KFENCE_COUNTER_SKIP_COVERED,
+	KFENCE_COUNTER_TARGET_EXPIRED,
 	KFENCE_COUNTER_COUNT,
 };
 static atomic_long_t counters[KFENCE_COUNTER_COUNT];
@@ -180,6 +227,7 @@ static const char *const counter_names[] = {
 	[KFENCE_COUNTER_SKIP_INCOMPAT]	= "skipped allocations (incompatible)",
 	[KFENCE_COUNTER_SKIP_CAPACITY]	= "skipped allocations (capacity)",
 	[KFENCE_COUNTER_SKIP_COVERED]	= "skipped allocations (covered)",
+	[KFENCE_COUNTER_TARGET_EXPIRED]	= "expired sample windows (targeted)",
 };
 static_assert(ARRAY_SIZE(counter_names) == KFENCE_COUNTER_COUNT);
 
@@ -192,6 +240,52 @@ static inline bool should_skip_covered(void)
 	return atomic_long_read(&counters[KFENCE_COUNTER_ALLOCATED]) > thresh;
 }
 
+/*
+ * Back off sampling as the pool fills up, so that a short sample interval does
+ * not exhaust the pool: the interval is doubled for every step of usage above
+ * kfence_backoff_thresh.
+ */
+static unsigned long kfence_next_interval(void)
+{
+	unsigned long interval = READ_ONCE(kfence_sample_interval);
+	unsigned long thresh = READ_ONCE(kfence_backoff_thresh);
+	unsigned long usage;
+
+	if (thresh >= 100)
+		return interval;
+
+	usage = atomic_long_read(&counters[KFENCE_COUNTER_ALLOCATED]) * 100 /
+		CONFIG_KFENCE_NUM_OBJECTS;
+	if (usage <= thresh)
+		return interval;
+
+	return interval << min_t(unsigned long, KFENCE_BACKOFF_MAX_SHIFT,
+				 (usage - thresh) * (KFENCE_BACKOFF_MAX_SHIFT + 1) /
+				 (100 - thresh));
+}
+
+/* Look up the target cache by name, once per sample window. */
+static struct kmem_cache *kfence_find_target_cache(void)
+{
+	struct kmem_cache *s, *target = NULL;
+
+	kernel_param_lock(THIS_MODULE);
+	if (!kfence_target_cache[0])
+		goto out;
+
+	mutex_lock(&slab_mutex);
+	list_for_each_entry(s, &slab_caches, list) {
+		if (!strcmp(s->name, kfence_target_cache)) {
+			target = s;
+			break;
+		}
+	}
+	mutex_unlock(&slab_mutex);
+out:
+	kernel_param_unlock(THIS_MODULE);
+	return target;
+}
+
 static u32 get_alloc_stack_hash(unsigned long *stack_entries, size_t num_entries)
 {
 	num_entries = min(num_entries, UNIQUE_ALLOC_STACK_DEPTH);
@@ -778,8 +872,10 @@ static struct notifier_block kfence_check_canary_notifier = {
 
 static struct delayed_work kfence_timer;
 
-#ifdef CONFIG_KFENCE_STATIC_KEYS
-/* Wait queue to wake up allocation-gate timer task. */
+/*
+ * Wait queue to wake up allocation-gate timer task. Without static keys, it is
+ * only waited on during a window reserved for the target cache.
+ */
 static DECLARE_WAIT_QUEUE_HEAD(allocation_wait);
 
 static void wake_up_kfence_timer(struct irq_work *work)
@@ -787,7 +883,6 @@ static void wake_up_kfence_timer(struct irq_work *work)
 	wake_up(&allocation_wait);
 }
 static DEFINE_IRQ_WORK(wake_up_kfence_timer_work, wake_up_kfence_timer);
-#endif
 
 /*
  * Set up delayed work, which will enable and disable the static key. We need to
@@ -802,14 +897,36 @@ static DEFINE_IRQ_WORK(wake_up_kfence_timer_work, wake_up_kfence_timer);
  */
 static void toggle_allocation_gate(struct work_struct *work)
 {
+	static unsigned long window;
+	unsigned long weight = READ_ONCE(kfence_target_weight);
+	struct kmem_cache *target = NULL;
+
 	if (!READ_ONCE(kfence_enabled))
 		return;
 
+	if (weight > 1 && ++window % weight)
+		target = kfence_find_target_cache();
+	WRITE_ONCE(kfence_window_target, target);
+
 	atomic_set(&kfence_allocation_gate, 0);
 #ifdef CONFIG_KFENCE_STATIC_KEYS
 	/* Enable static key, and await allocation to happen. */
 	static_branch_enable(&kfence_allocation_key);
+#endif
+
+	if (target) {
+		/*
+		 * Every allocation takes the slow path while the gate is open,
+		 * so don't wait for the target cache longer than one interval.
+		 */
+		wait_event_idle_timeout(allocation_wait, atomic_read(&kfence_allocation_gate),
+					msecs_to_jiffies(kfence_sample_interval));
+		if (atomic_cmpxchg(&kfence_allocation_gate, 0, 1) == 0)
+			atomic_long_inc(&counters[KFENCE_COUNTER_TARGET_EXPIRED]);
+		WRITE_ONCE(kfence_window_target, NULL);
+	}
 
+#ifdef CONFIG_KFENCE_STATIC_KEYS
 	if (sysctl_hung_task_timeout_secs) {
 		/*
 		 * During low activity with no allocations we might wait a
@@ -825,7 +942,7 @@ static void toggle_allocation_gate(struct work_struct *work)
 	static_branch_disable(&kfence_allocation_key);
 #endif
 	queue_delayed_work(system_unbound_wq, &kfence_timer,
-			   msecs_to_jiffies(kfence_sample_interval));
+			   msecs_to_jiffies(kfence_next_interval()));
 }
 
 /* === Public interface ===================================================== */
@@ -981,6 +1098,7 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 {
 	unsigned long stack_entries[KFENCE_STACK_DEPTH];
 	size_t num_stack_entries;
+	struct kmem_cache *target;
 	u32 alloc_stack_hash;
 
 	/*
@@ -1003,9 +1121,16 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 		return NULL;
 	}
 
+	/*
+	 * Leave the gate open for the target cache if this window is reserved
+	 * for it.
+	 */
+	target = READ_ONCE(kfence_window_target);
+	if (unlikely(target) && target != s)
+		return NULL;
+
 	if (atomic_inc_return(&kfence_allocation_gate) > 1)
 		return NULL;
-#ifdef CONFIG_KFENCE_STATIC_KEYS
 	/*
 	 * waitqueue_active() is fully ordered after the update of
 	 * kfence_allocation_gate per atomic_inc_return().
@@ -1017,7 +1142,6 @@ void *__kfence_alloc(struct kmem_cache *s, size_t size, gfp_t flags)
 		 */
 		irq_work_queue(&wake_up_kfence_timer_work);
 	}
-#endif
 
 	if (!READ_ONCE(kfence_enabled))
 		return NULL;
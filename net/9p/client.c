@@ -251,6 +251,43 @@ EXPORT_SYMBOL(p9_fcall_fini);
 
 static struct kmem_cache *p9_req_cache;
 
+static struct p9_req_t __rcu **p9_tag_slot(struct p9_client *c, u16 tag)
+{
+	if (tag == P9_NOTAG)
+		return &c->version_req;
+	return &c->reqs[tag];
+}
+
+/*
+ * Tags come from a sbitmap so that concurrent requests allocate and free
+ * them from per-CPU hints instead of serialising on the client lock.
+ */
+static int p9_tag_get(struct p9_client *c)
+{
+	struct sbq_wait_state *ws;
+	DEFINE_SBQ_WAIT(wait);
+	int tag;
+
+	tag = __sbitmap_queue_get(&c->tags);
+	if (tag >= 0)
+		return tag;
+
+	ws = sbq_wait_ptr(&c->tags, &c->tag_wait_index);
+	for (;;) {
+		sbitmap_prepare_to_wait(&c->tags, ws, &wait, TASK_KILLABLE);
+		tag = __sbitmap_queue_get(&c->tags);
+		if (tag >= 0)
+			break;
+		if (fatal_signal_pending(current)) {
+			tag = -ERESTARTSYS;
+			break;
+		}
+		io_schedule();
+	}
+	sbitmap_finish_wait(&c->tags, ws, &wait);
+	return tag;
+}
+
 /**
  * p9_tag_alloc - Allocate a new request.
  * @c: Client session.
@@ -265,6 +302,7 @@ p9_tag_alloc(struct p9_client *c, int8_t type, unsigned int max_size)
 {
 	struct p9_req_t *req = kmem_cache_alloc(p9_req_cache, GFP_NOFS);
 	int alloc_msize = min(c->msize, max_size);
+	int err = -ENOMEM;
 	int tag;
 
 	if (!req)
@@ -279,21 +317,20 @@ p9_tag_alloc(struct p9_client *c, int8_t type, unsigned int max_size)
 	p9pdu_reset(&req->rc);
 	req->t_err = 0;
 	req->status = REQ_STATUS_ALLOC;
+	req->done = NULL;
+	req->done_priv = NULL;
 	init_waitqueue_head(&req->wq);
 	INIT_LIST_HEAD(&req->req_list);
 
-	idr_preload(GFP_NOFS);
-	spin_lock_irq(&c->lock);
 	if (type == P9_TVERSION)
-		tag = idr_alloc(&c->reqs, req, P9_NOTAG, P9_NOTAG + 1,
-				GFP_NOWAIT);
+		tag = P9_NOTAG;
 	else
-		tag = idr_alloc(&c->reqs, req, 0, P9_NOTAG, GFP_NOWAIT);
-	req->tc.tag = tag;
-	spin_unlock_irq(&c->lock);
-	idr_preload_end();
-	if (tag < 0)
+		tag = p9_tag_get(c);
+	if (tag < 0) {
+		err = tag;
 		goto free;
+	}
+	req->tc.tag = tag;
 
 	/* Init ref to two because in the general case there is one ref
 	 * that is put asynchronously by a writer thread, one ref
@@ -307,6 +344,7 @@ p9_tag_alloc(struct p9_client *c, int8_t type, unsigned int max_size)
 	 */
 	refcount_set(&req->refcount.refcount, 2);
 
+	rcu_assign_pointer(*p9_tag_slot(c, tag), req);
 	return req;
 
 free:
@@ -314,7 +352,7 @@ p9_tag_alloc(struct p9_client *c, int8_t type, unsigned int max_size)
 	p9_fcall_fini(&req->rc);
 free_req:
 	kmem_cache_free(p9_req_cache, req);
-	return ERR_PTR(-ENOMEM);
+	return ERR_PTR(err);
 }
 
 /**
@@ -329,9 +367,12 @@ struct p9_req_t *p9_tag_lookup(struct p9_client *c, u16 tag)
 {
 	struct p9_req_t *req;
 
+	if (tag != P9_NOTAG && tag >= P9_MAX_TAGS)
+		return NULL;
+
 	rcu_read_lock();
 again:
-	req = idr_find(&c->reqs, tag);
+	req = rcu_dereference(*p9_tag_slot(c, tag));
 	if (req) {
 		/* We have to be careful with the req found under rcu_read_lock
 		 * Thanks to SLAB_TYPESAFE_BY_RCU we can safely try to get the
@@ -360,13 +401,12 @@ EXPORT_SYMBOL(p9_tag_lookup);
  */
 static int p9_tag_remove(struct p9_client *c, struct p9_req_t *r)
 {
-	unsigned long flags;
 	u16 tag = r->tc.tag;
 
 	p9_debug(P9_DEBUG_MUX, "clnt %p req %p tag: %d\n", c, r, tag);
-	spin_lock_irqsave(&c->lock, flags);
-	idr_remove(&c->reqs, tag);
-	spin_unlock_irqrestore(&c->lock, flags);
+	RCU_INIT_POINTER(*p9_tag_slot(c, tag), NULL);
+	if (tag != P9_NOTAG)
+		sbitmap_queue_clear(&c->tags, tag, raw_smp_processor_id());
 	return p9_req_put(r);
 }
 
@@ -398,8 +438,13 @@ static void p9_tag_cleanup(struct p9_client *c)
 	int id;
 
 	rcu_read_lock();
-	idr_for_each_entry(&c->reqs, req, id) {
-		pr_info("Tag %d still in use\n", id);
+	for (id = 0; id <= P9_MAX_TAGS; id++) {
+		u16 tag = id < P9_MAX_TAGS ? id : P9_NOTAG;
+
+		req = rcu_dereference(*p9_tag_slot(c, tag));
+		if (!req)
+			continue;
+		pr_info("Tag %d still in use\n", tag);
 		if (p9_tag_remove(c, req) == 0)
 			pr_warn("Packet with tag %d has still references",
 				req->tc.tag);
@@ -413,6 +458,8 @@ static void p9_tag_cleanup(struct p9_client *c)
  * @req: request received
  * @status: request status, one of REQ_STATUS_*
  *
+ * Asynchronous requests have their completion callback run from here,
+ * before the transport's reference is dropped.
  */
 void p9_client_cb(struct p9_client *c, struct p9_req_t *req, int status)
 {
@@ -426,6 +473,8 @@ void p9_client_cb(struct p9_client *c, struct p9_req_t *req, int status)
 
 	wake_up(&req->wq);
 	p9_debug(P9_DEBUG_MUX, "wakeup: %d\n", req->tc.tag);
+	if (req->done)
+		req->done(req, req->done_priv);
 	p9_req_put(req);
 }
 EXPORT_SYMBOL(p9_client_cb);
@@ -801,6 +850,74 @@ p9_client_rpc(struct p9_client *c, int8_t type, const char *fmt, ...)
 	return ERR_PTR(safe_errno(err));
 }
 
+/**
+ * p9_client_rpc_async - issue a request without waiting for the response
+ * @c: client session
+ * @type: type of request
+ * @done: called from p9_client_cb() once the request has completed
+ * @priv: argument for @done
+ * @fmt: protocol format string (see protocol.c)
+ *
+ * On success @done is called exactly once, possibly before this function
+ * returns.  The request it is handed must be finished with
+ * p9_client_async_result() and released with p9_tag_remove().  As nobody
+ * waits on the request there is no flush on signals.
+ *
+ * Returns 0 if the request was handed to the transport.
+ */
+static int p9_client_rpc_async(struct p9_client *c, int8_t type,
+			       p9_req_done_t done, void *priv,
+			       const char *fmt, ...)
+{
+	va_list ap;
+	int err;
+	struct p9_req_t *req;
+
+	va_start(ap, fmt);
+	req = p9_client_prepare_req(c, type, c->msize, fmt, ap);
+	va_end(ap);
+	if (IS_ERR(req))
+		return PTR_ERR(req);
+
+	req->done = done;
+	req->done_priv = priv;
+
+	err = c->trans_mod->request(c, req);
+	if (err < 0) {
+		/* write won't happen */
+		p9_req_put(req);
+		if (err != -ERESTARTSYS && err != -EFAULT)
+			c->status = Disconnected;
+		p9_tag_remove(c, req);
+		return safe_errno(err);
+	}
+	return 0;
+}
+
+/**
+ * p9_client_async_result - check the outcome of an asynchronous request
+ * @c: client session
+ * @req: request handed to the completion callback
+ *
+ * Returns 0 if the server replied without error.
+ */
+static int p9_client_async_result(struct p9_client *c, struct p9_req_t *req)
+{
+	int err;
+
+	/* Echoes the wmb() in p9_client_cb() */
+	smp_rmb();
+
+	if (req->status == REQ_STATUS_ERROR) {
+		p9_debug(P9_DEBUG_ERROR, "req_status error %d\n", req->t_err);
+		return safe_errno(req->t_err ?: -EIO);
+	}
+
+	err = p9_check_errors(c, req);
+	trace_9p_client_res(c, req->tc.id, req->rc.tag, err);
+	return safe_errno(err);
+}
+
 /**
  * p9_client_zc_rpc - issue a request and wait for a response
  * @c: client session
@@ -1009,17 +1126,28 @@ struct p9_client *p9_client_create(const char *dev_name, char *options)
 	clnt->trans_mod = NULL;
 	clnt->trans = NULL;
 	clnt->fcall_cache = NULL;
+	clnt->no_readdirplus = false;
 
 	client_id = utsname()->nodename;
 	memcpy(clnt->name, client_id, strlen(client_id) + 1);
 
 	spin_lock_init(&clnt->lock);
 	idr_init(&clnt->fids);
-	idr_init(&clnt->reqs);
+	RCU_INIT_POINTER(clnt->version_req, NULL);
+	atomic_set(&clnt->tag_wait_index, 0);
+	clnt->reqs = kvcalloc(P9_MAX_TAGS, sizeof(*clnt->reqs), GFP_KERNEL);
+	if (!clnt->reqs) {
+		err = -ENOMEM;
+		goto free_client;
+	}
+	err = sbitmap_queue_init_node(&clnt->tags, P9_MAX_TAGS, -1, false,
+				      GFP_KERNEL, NUMA_NO_NODE);
+	if (err)
+		goto free_reqs;
 
 	err = parse_opts(options, clnt);
 	if (err < 0)
-		goto free_client;
+		goto free_tags;
 
 	if (!clnt->trans_mod)
 		clnt->trans_mod = v9fs_get_default_trans();
@@ -1028,7 +1156,7 @@ struct p9_client *p9_client_create(const char *dev_name, char *options)
 		err = -EPROTONOSUPPORT;
 		p9_debug(P9_DEBUG_ERROR,
 			 "No transport defined or default transport\n");
-		goto free_client;
+		goto free_tags;
 	}
 
 	p9_debug(P9_DEBUG_MUX, "clnt %p trans %p msize %d protocol %d\n",
@@ -1072,6 +1200,10 @@ struct p9_client *p9_client_create(const char *dev_name, char *options)
 	clnt->trans_mod->close(clnt);
 put_trans:
 	v9fs_put_trans(clnt->trans_mod);
+free_tags:
+	sbitmap_queue_free(&clnt->tags);
+free_reqs:
+	kvfree(clnt->reqs);
 free_client:
 	kfree(clnt);
 	return ERR_PTR(err);
@@ -1097,6 +1229,8 @@ void p9_client_destroy(struct p9_client *clnt)
 
 	p9_tag_cleanup(clnt);
 
+	sbitmap_queue_free(&clnt->tags);
+	kvfree(clnt->reqs);
 	kmem_cache_destroy(clnt->fcall_cache);
 	kfree(clnt);
 }
@@ -1637,6 +1771,87 @@ p9_client_read_once(struct p9_fid *fid, u64 offset, struct iov_iter *to,
 }
 EXPORT_SYMBOL(p9_client_read_once);
 
+/**
+ * p9_client_read_async - issue a TREAD without waiting for the reply
+ * @fid: fid to read from
+ * @offset: file offset to read at
+ * @count: number of bytes to read, at most one RPC worth
+ * @done: completion callback, see p9_client_rpc_async()
+ * @priv: argument for @done
+ *
+ * The reply is received into the request buffer rather than with zero
+ * copy, as zero copy transports wait for the reply while the pages are
+ * pinned.  This allows a caller to keep several reads in flight at once.
+ * The request passed to @done must be handed to p9_client_read_async_end().
+ */
+int p9_client_read_async(struct p9_fid *fid, u64 offset, int count,
+			 p9_req_done_t done, void *priv)
+{
+	struct p9_client *clnt = fid->clnt;
+	int rsize;
+
+	p9_debug(P9_DEBUG_9P, ">>> TREAD fid %d offset %llu %d (async)\n",
+		 fid->fid, offset, count);
+
+	rsize = fid->iounit;
+	if (!rsize || rsize > clnt->msize - P9_IOHDRSZ)
+		rsize = clnt->msize - P9_IOHDRSZ;
+
+	if (count < rsize)
+		rsize = count;
+
+	return p9_client_rpc_async(clnt, P9_TREAD, done, priv, "dqd",
+				   fid->fid, offset, rsize);
+}
+EXPORT_SYMBOL(p9_client_read_async);
+
+/**
+ * p9_client_read_async_end - complete a read issued with p9_client_read_async()
+ * @fid: fid the read was issued on
+ * @req: request handed to the completion callback
+ * @to: destination for the data, sized as requested
+ * @err: set to the error, if any
+ *
+ * Must be called from process context.  Releases @req.
+ *
+ * Returns the number of bytes copied to @to.
+ */
+int p9_client_read_async_end(struct p9_fid *fid, struct p9_req_t *req,
+			     struct iov_iter *to, int *err)
+{
+	struct p9_client *clnt = fid->clnt;
+	int rsize = iov_iter_count(to);
+	int count, n;
+	char *dataptr;
+
+	*err = p9_client_async_result(clnt, req);
+	if (*err) {
+		p9_tag_remove(clnt, req);
+		return 0;
+	}
+
+	*err = p9pdu_readf(&req->rc, clnt->proto_version,
+			   "D", &count, &dataptr);
+	if (*err) {
+		trace_9p_protocol_dump(clnt, &req->rc);
+		p9_tag_remove(clnt, req);
+		return 0;
+	}
+	if (rsize < count) {
+		pr_err("bogus RREAD count (%d > %d)\n", count, rsize);
+		count = rsize;
+	}
+
+	p9_debug(P9_DEBUG_9P, "<<< RREAD count %d (async)\n", count);
+
+	n = copy_to_iter(dataptr, count, to);
+	if (n != count)
+		*err = -EFAULT;
+	p9_tag_remove(clnt, req);
+	return n;
+}
+EXPORT_SYMBOL(p9_client_read_async_end);
+
 int
 p9_client_write(struct p9_fid *fid, u64 offset, struct iov_iter *from, int *err)
 {
@@ -2077,18 +2292,25 @@ int p9_client_xattrcreate(struct p9_fid *fid, const char *name,
 }
 EXPORT_SYMBOL_GPL(p9_client_xattrcreate);
 
-int p9_client_readdir(struct p9_fid *fid, char *data, u32 count, u64 offset)
+/*
+ * Treaddirplus carries an additional request_mask[8] after the Treaddir
+ * fields, the "dqd" format simply ignores it for Treaddir.
+ */
+static int p9_client_do_readdir(struct p9_fid *fid, int8_t type, char *data,
+				u32 count, u64 offset, u64 request_mask)
 {
 	int err, rsize, non_zc = 0;
 	struct p9_client *clnt;
 	struct p9_req_t *req;
 	char *dataptr;
+	const char *fmt = type == P9_TREADDIRPLUS ? "dqdq" : "dqd";
 	struct kvec kv = {.iov_base = data, .iov_len = count};
 	struct iov_iter to;
 
 	iov_iter_kvec(&to, READ, &kv, 1, count);
 
-	p9_debug(P9_DEBUG_9P, ">>> TREADDIR fid %d offset %llu count %d\n",
+	p9_debug(P9_DEBUG_9P, ">>> %s fid %d offset %llu count %d\n",
+		 type == P9_TREADDIRPLUS ? "TREADDIRPLUS" : "TREADDIR",
 		 fid->fid, offset, count);
 
 	err = 0;
@@ -2106,12 +2328,13 @@ int p9_client_readdir(struct p9_fid *fid, char *data, u32 count, u64 offset)
 		/* response header len is 11
 		 * PDU Header(7) + IO Size (4)
 		 */
-		req = p9_client_zc_rpc(clnt, P9_TREADDIR, &to, NULL, rsize, 0,
-				       11, "dqd", fid->fid, offset, rsize);
+		req = p9_client_zc_rpc(clnt, type, &to, NULL, rsize, 0,
+				       11, fmt, fid->fid, offset, rsize,
+				       request_mask);
 	} else {
 		non_zc = 1;
-		req = p9_client_rpc(clnt, P9_TREADDIR, "dqd", fid->fid,
-				    offset, rsize);
+		req = p9_client_rpc(clnt, type, fmt, fid->fid,
+				    offset, rsize, request_mask);
 	}
 	if (IS_ERR(req)) {
 		err = PTR_ERR(req);
@@ -2124,11 +2347,14 @@ int p9_client_readdir(struct p9_fid *fid, char *data, u32 count, u64 offset)
 		goto free_and_error;
 	}
 	if (rsize < count) {
-		pr_err("bogus RREADDIR count (%d > %d)\n", count, rsize);
+		pr_err("bogus R%s count (%d > %d)\n",
+		       type == P9_TREADDIRPLUS ? "READDIRPLUS" : "READDIR",
+		       count, rsize);
 		count = rsize;
 	}
 
-	p9_debug(P9_DEBUG_9P, "<<< RREADDIR count %d\n", count);
+	p9_debug(P9_DEBUG_9P, "<<< %s count %d\n",
+		 type == P9_TREADDIRPLUS ? "RREADDIRPLUS" : "RREADDIR", count);
 
 	if (non_zc)
 		memmove(data, dataptr, count);
@@ -2141,8 +2367,45 @@ int p9_client_readdir(struct p9_fid *fid, char *data, u32 count, u64 offset)
 error:
 	return err;
 }
+
+int p9_client_readdir(struct p9_fid *fid, char *data, u32 count, u64 offset)
+{
+	return p9_client_do_readdir(fid, P9_TREADDIR, data, count, offset, 0);
+}
 EXPORT_SYMBOL(p9_client_readdir);
 
+/**
+ * p9_client_readdirplus - read directory entries along with their attributes
+ * @fid: directory to read
+ * @data: buffer for the entries, to be parsed with p9dirent_read_plus()
+ * @count: size of @data
+ * @offset: directory offset to read from
+ * @request_mask: P9_STATS_* attributes wanted for each entry
+ *
+ * This is an extension to 9P2000.L.  Servers that don't know about it
+ * reject it, after which -EOPNOTSUPP is returned without asking again and
+ * callers are expected to fall back to p9_client_readdir().
+ */
+int p9_client_readdirplus(struct p9_fid *fid, char *data, u32 count,
+			  u64 offset, u64 request_mask)
+{
+	struct p9_client *clnt = fid->clnt;
+	int err;
+
+	if (!p9_is_proto_dotl(clnt) || READ_ONCE(clnt->no_readdirplus))
+		return -EOPNOTSUPP;
+
+	err = p9_client_do_readdir(fid, P9_TREADDIRPLUS, data, count, offset,
+				   request_mask);
+	if (err == -EOPNOTSUPP || err == -ENOSYS) {
+		p9_debug(P9_DEBUG_9P, "server does not support TREADDIRPLUS\n");
+		WRITE_ONCE(clnt->no_readdirplus, true);
+		err = -EOPNOTSUPP;
+	}
+	return err;
+}
+EXPORT_SYMBOL(p9_client_readdirplus);
+
 int p9_client_mknod_dotl(struct p9_fid *fid, const char *name, int mode,
 			 dev_t rdev, kgid_t gid, struct p9_qid *qid)
 {
@@ -591,8 +591,12 @@ void p9pdu_reset(struct p9_fcall *pdu)
 	pdu->size = 0;
 }
 
-int p9dirent_read(struct p9_client *clnt, char *buf, int len,
-		  struct p9_dirent *dirent)
+/*
+ * Rreaddirplus entries are Rreaddir entries followed by the Rgetattr
+ * encoding of the entry's attributes.
+ */
+static int __p9dirent_read(struct p9_client *clnt, char *buf, int len,
+			   struct p9_dirent *dirent, struct p9_stat_dotl *st)
 {
 	struct p9_fcall fake_pdu;
 	int ret;
@@ -603,8 +607,9 @@ int p9dirent_read(struct p9_client *clnt, char *buf, int len,
 	fake_pdu.sdata = buf;
 	fake_pdu.offset = 0;
 
-	ret = p9pdu_readf(&fake_pdu, clnt->proto_version, "Qqbs", &dirent->qid,
-			  &dirent->d_off, &dirent->d_type, &nameptr);
+	ret = p9pdu_readf(&fake_pdu, clnt->proto_version,
+			  st ? "QqbsA" : "Qqbs", &dirent->qid,
+			  &dirent->d_off, &dirent->d_type, &nameptr, st);
 	if (ret) {
 		p9_debug(P9_DEBUG_9P, "<<< p9dirent_read failed: %d\n", ret);
 		trace_9p_protocol_dump(clnt, &fake_pdu);
@@ -623,4 +628,17 @@ int p9dirent_read(struct p9_client *clnt, char *buf, int len,
 
 	return fake_pdu.offset;
 }
+
+int p9dirent_read(struct p9_client *clnt, char *buf, int len,
+		  struct p9_dirent *dirent)
+{
+	return __p9dirent_read(clnt, buf, len, dirent, NULL);
+}
 EXPORT_SYMBOL(p9dirent_read);
+
+int p9dirent_read_plus(struct p9_client *clnt, char *buf, int len,
+		       struct p9_dirent *dirent, struct p9_stat_dotl *st)
+{
+	return __p9dirent_read(clnt, buf, len, dirent, st);
+}
+EXPORT_SYMBOL(p9dirent_read_plus);
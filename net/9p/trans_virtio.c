@@ -34,10 +34,29 @@
 #include <linux/swap.h>
 #include <linux/virtio.h>
 #include <linux/virtio_9p.h>
+#include <linux/virtio_ring.h>
 #include "trans_common.h"
 
 #define VIRTQUEUE_NUM	128
 
+/*
+ * With indirect descriptors a request occupies a single ring slot no matter
+ * how many segments it carries, so we allow much longer chains than the
+ * ring itself would hold.  1024 is the longest descriptor chain accepted by
+ * common device implementations.
+ */
+#define VIRTQUEUE_SG_MAX	1024
+
+/* Usable entries per scatterlist chunk, the last one links to the next. */
+#define SG_USER_PER_LIST	(SG_MAX_SINGLE_ALLOC - 1)
+
+/* Leave room for the request and response headers and an unaligned page. */
+#define VIRTQUEUE_SG_HDRS	3
+
+#define P9_VIRTIO_MAXSIZE(nsg)						\
+	(PAGE_SIZE * ((nsg) - VIRTQUEUE_SG_HDRS) > KMALLOC_MAX_SIZE ?	\
+	 KMALLOC_MAX_SIZE : PAGE_SIZE * ((nsg) - VIRTQUEUE_SG_HDRS))
+
 /* a single mutex to manage channel initialization and attachment */
 static DEFINE_MUTEX(virtio_9p_lock);
 static DECLARE_WAIT_QUEUE_HEAD(vp_wq);
@@ -53,7 +72,10 @@ static atomic_t vp_pinned = ATOMIC_INIT(0);
  * @ring_bufs_avail: flag to indicate there is some available in the ring buf
  * @vc_wq: wait queue for waiting for thing to be added to ring buf
  * @p9_max_pages: maximum number of pinned pages
- * @sg: scatter gather list which is used to pack a request (protected?)
+ * @nsg: number of scatter gather entries usable for a single request
+ * @nsgl: number of chained scatterlist chunks in @sgl
+ * @sgl: chained scatter gather lists used to pack a request
+ * @maxsize: largest msize this channel can carry in a single request
  * @chan_list: linked list of channels
  *
  * We keep all per-channel information in a structure.
@@ -76,8 +98,11 @@ struct virtio_chan {
 	 * will be placing it in each channel.
 	 */
 	unsigned long p9_max_pages;
-	/* Scatterlist: can be too big for stack. */
-	struct scatterlist sg[VIRTQUEUE_NUM];
+	/* Scatterlist: can be too big for stack, protected by @lock. */
+	unsigned int nsg;
+	unsigned int nsgl;
+	struct scatterlist **sgl;
+	unsigned int maxsize;
 	/**
 	 * @tag: name to identify a mount null terminated
 	 */
@@ -94,6 +119,59 @@ static unsigned int rest_of_page(void *data)
 	return PAGE_SIZE - offset_in_page(data);
 }
 
+/* Return the @index'th usable entry of the channel's chained sg lists. */
+static struct scatterlist *vq_sg(struct virtio_chan *chan, unsigned int index)
+{
+	return &chan->sgl[index / SG_USER_PER_LIST][index % SG_USER_PER_LIST];
+}
+
+static void vq_sg_free(struct virtio_chan *chan)
+{
+	unsigned int i;
+
+	if (!chan->sgl)
+		return;
+	for (i = 0; i < chan->nsgl; i++)
+		kfree(chan->sgl[i]);
+	kfree(chan->sgl);
+	chan->sgl = NULL;
+}
+
+/**
+ * vq_sg_alloc - allocate the chained scatterlists of a channel
+ * @chan: channel to allocate for
+ * @nsg: number of usable entries a single request may need
+ *
+ * Each chunk is one page worth of scatterlist entries whose last entry
+ * chains to the next chunk, so that an arbitrarily long request can be
+ * handed to virtqueue_add_sgs() without a high order allocation.
+ */
+static int vq_sg_alloc(struct virtio_chan *chan, unsigned int nsg)
+{
+	unsigned int i;
+
+	chan->nsg = nsg;
+	chan->nsgl = DIV_ROUND_UP(nsg, SG_USER_PER_LIST);
+	chan->sgl = kcalloc(chan->nsgl, sizeof(*chan->sgl), GFP_KERNEL);
+	if (!chan->sgl)
+		return -ENOMEM;
+
+	for (i = 0; i < chan->nsgl; i++) {
+		chan->sgl[i] = kmalloc_array(SG_MAX_SINGLE_ALLOC,
+					     sizeof(struct scatterlist),
+					     GFP_KERNEL);
+		if (!chan->sgl[i]) {
+			vq_sg_free(chan);
+			return -ENOMEM;
+		}
+		sg_init_table(chan->sgl[i], SG_MAX_SINGLE_ALLOC);
+		if (i)
+			sg_chain(chan->sgl[i - 1], SG_MAX_SINGLE_ALLOC,
+				 chan->sgl[i]);
+	}
+	return 0;
+}
+
 /**
  * p9_virtio_close - reclaim resources of a channel
  * @client: client instance
@@ -156,7 +234,7 @@ static void req_done(struct virtqueue *vq)
 
 /**
  * pack_sg_list - pack a scatter gather list from a linear buffer
- * @sg: scatter/gather list to pack into
+ * @chan: channel whose scatter/gather lists to pack into
  * @start: which segment of the sg_list to start at
  * @limit: maximum segment to pack data to
  * @data: data to pack into scatter/gather list
@@ -168,7 +246,7 @@ static void req_done(struct virtqueue *vq)
  *
  */
 
-static int pack_sg_list(struct scatterlist *sg, int start,
+static int pack_sg_list(struct virtio_chan *chan, int start,
 			int limit, char *data, int count)
 {
 	int s;
@@ -180,13 +258,13 @@ static int pack_sg_list(struct scatterlist *sg, int start,
 			s = count;
 		BUG_ON(index >= limit);
 		/* Make sure we don't terminate early. */
-		sg_unmark_end(&sg[index]);
-		sg_set_buf(&sg[index++], data, s);
+		sg_unmark_end(vq_sg(chan, index));
+		sg_set_buf(vq_sg(chan, index++), data, s);
 		count -= s;
 		data += s;
 	}
 	if (index-start)
-		sg_mark_end(&sg[index - 1]);
+		sg_mark_end(vq_sg(chan, index - 1));
 	return index-start;
 }
 
@@ -206,7 +284,7 @@ static int p9_virtio_cancelled(struct p9_client *client, struct p9_req_t *req)
 /**
  * pack_sg_list_p - Just like pack_sg_list. Instead of taking a buffer,
  * this takes a list of pages.
- * @sg: scatter/gather list to pack into
+ * @chan: channel whose scatter/gather lists to pack into
  * @start: which segment of the sg_list to start at
  * @limit: maximum number of pages in sg list.
  * @pdata: a list of pages to add into sg.
@@ -215,7 +293,7 @@ static int p9_virtio_cancelled(struct p9_client *client, struct p9_req_t *req)
  * @count: amount of data to pack into the scatter/gather list
  */
 static int
-pack_sg_list_p(struct scatterlist *sg, int start, int limit,
+pack_sg_list_p(struct virtio_chan *chan, int start, int limit,
 	       struct page **pdata, int nr_pages, size_t offs, int count)
 {
 	int i = 0, s;
@@ -233,15 +311,15 @@ pack_sg_list_p(struct scatterlist *sg, int start, int limit,
 			s = count;
 		BUG_ON(index >= limit);
 		/* Make sure we don't terminate early. */
-		sg_unmark_end(&sg[index]);
-		sg_set_page(&sg[index++], pdata[i++], s, data_off);
+		sg_unmark_end(vq_sg(chan, index));
+		sg_set_page(vq_sg(chan, index++), pdata[i++], s, data_off);
 		data_off = 0;
 		count -= s;
 		nr_pages--;
 	}
 
 	if (index-start)
-		sg_mark_end(&sg[index - 1]);
+		sg_mark_end(vq_sg(chan, index - 1));
 	return index - start;
 }
 
@@ -269,15 +347,15 @@ p9_virtio_request(struct p9_client *client, struct p9_req_t *req)
 
 	out_sgs = in_sgs = 0;
 	/* Handle out VirtIO ring buffers */
-	out = pack_sg_list(chan->sg, 0,
-			   VIRTQUEUE_NUM, req->tc.sdata, req->tc.size);
+	out = pack_sg_list(chan, 0,
+			   chan->nsg, req->tc.sdata, req->tc.size);
 	if (out)
-		sgs[out_sgs++] = chan->sg;
+		sgs[out_sgs++] = vq_sg(chan, 0);
 
-	in = pack_sg_list(chan->sg, out,
-			  VIRTQUEUE_NUM, req->rc.sdata, req->rc.capacity);
+	in = pack_sg_list(chan, out,
+			  chan->nsg, req->rc.sdata, req->rc.capacity);
 	if (in)
-		sgs[out_sgs + in_sgs++] = chan->sg + out;
+		sgs[out_sgs + in_sgs++] = vq_sg(chan, out);
 
 	err = virtqueue_add_sgs(chan->vq, sgs, out_sgs, in_sgs, req,
 				GFP_ATOMIC);
@@ -446,15 +524,15 @@ p9_virtio_zc_request(struct p9_client *client, struct p9_req_t *req,
 	out_sgs = in_sgs = 0;
 
 	/* out data */
-	out = pack_sg_list(chan->sg, 0,
-			   VIRTQUEUE_NUM, req->tc.sdata, req->tc.size);
+	out = pack_sg_list(chan, 0,
+			   chan->nsg, req->tc.sdata, req->tc.size);
 
 	if (out)
-		sgs[out_sgs++] = chan->sg;
+		sgs[out_sgs++] = vq_sg(chan, 0);
 
 	if (out_pages) {
-		sgs[out_sgs++] = chan->sg + out;
-		out += pack_sg_list_p(chan->sg, out, VIRTQUEUE_NUM,
+		sgs[out_sgs++] = vq_sg(chan, out);
+		out += pack_sg_list_p(chan, out, chan->nsg,
 				      out_pages, out_nr_pages, offs, outlen);
 	}
 
@@ -465,14 +543,14 @@ p9_virtio_zc_request(struct p9_client *client, struct p9_req_t *req,
 	 * Arrange in such a way that server places header in the
 	 * allocated memory and payload onto the user buffer.
 	 */
-	in = pack_sg_list(chan->sg, out,
-			  VIRTQUEUE_NUM, req->rc.sdata, in_hdr_len);
+	in = pack_sg_list(chan, out,
+			  chan->nsg, req->rc.sdata, in_hdr_len);
 	if (in)
-		sgs[out_sgs + in_sgs++] = chan->sg + out;
+		sgs[out_sgs + in_sgs++] = vq_sg(chan, out);
 
 	if (in_pages) {
-		sgs[out_sgs + in_sgs++] = chan->sg + out + in;
-		in += pack_sg_list_p(chan->sg, out + in, VIRTQUEUE_NUM,
+		sgs[out_sgs + in_sgs++] = vq_sg(chan, out + in);
+		in += pack_sg_list_p(chan, out + in, chan->nsg,
 				     in_pages, in_nr_pages, offs, inlen);
 	}
 
@@ -559,6 +637,7 @@ static int p9_virtio_probe(struct virtio_device *vdev)
 	__u16 tag_len;
 	char *tag;
 	int err;
+	unsigned int nsg;
 	struct virtio_chan *chan;
 
 	if (!vdev->config->get) {
@@ -585,19 +664,30 @@ static int p9_virtio_probe(struct virtio_device *vdev)
 	chan->vq->vdev->priv = chan;
 	spin_lock_init(&chan->lock);
 
-	sg_init_table(chan->sg, VIRTQUEUE_NUM);
+	/*
+	 * Without indirect descriptors every segment takes a ring slot, so
+	 * stick to the historical limit.  With them a request only consumes
+	 * one slot and we can chain enough segments for multi-megabyte msize.
+	 */
+	nsg = VIRTQUEUE_NUM;
+	if (virtio_has_feature(vdev, VIRTIO_RING_F_INDIRECT_DESC))
+		nsg = VIRTQUEUE_SG_MAX;
+	err = vq_sg_alloc(chan, nsg);
+	if (err)
+		goto out_free_vq;
+	chan->maxsize = P9_VIRTIO_MAXSIZE(nsg);
 
 	chan->inuse = false;
 	if (virtio_has_feature(vdev, VIRTIO_9P_MOUNT_TAG)) {
 		virtio_cread(vdev, struct virtio_9p_config, tag_len, &tag_len);
 	} else {
 		err = -EINVAL;
-		goto out_free_vq;
+		goto out_free_sg;
 	}
 	tag = kzalloc(tag_len + 1, GFP_KERNEL);
 	if (!tag) {
 		err = -ENOMEM;
-		goto out_free_vq;
+		goto out_free_sg;
 	}
 
 	virtio_cread_bytes(vdev, offsetof(struct virtio_9p_config, tag),
@@ -632,6 +722,8 @@ static int p9_virtio_probe(struct virtio_device *vdev)
 	sysfs_remove_file(&vdev->dev.kobj, &dev_attr_mount_tag.attr);
 out_free_tag:
 	kfree(tag);
+out_free_sg:
+	vq_sg_free(chan);
 out_free_vq:
 	vdev->config->del_vqs(vdev);
 out_free_chan:
@@ -683,6 +775,12 @@ p9_virtio_create(struct p9_client *client, const char *devname, char *args)
 		return ret;
 	}
 
+	if (client->msize > chan->maxsize) {
+		client->msize = chan->maxsize;
+		pr_info("Limiting 'msize' to %d as this is the maximum supported by channel %s\n",
+			client->msize, devname);
+	}
+
 	client->trans = (void *)chan;
 	client->status = Connected;
 	chan->client = client;
@@ -728,6 +826,7 @@ static void p9_virtio_remove(struct virtio_device *vdev)
 	kobject_uevent(&(vdev->dev.kobj), KOBJ_CHANGE);
 	kfree(chan->tag);
 	kfree(chan->vc_wq);
+	vq_sg_free(chan);
 	kfree(chan);
 
 }
@@ -764,9 +863,10 @@ static struct p9_trans_module p9_virtio_trans = {
 	 * We leave one entry for input and one entry for response
 	 * headers. We also skip one more entry to accommodate, address
 	 * that are not at page boundary, that can result in an extra
-	 * page in zero copy.
+	 * page in zero copy.  Channels without indirect descriptors
+	 * lower this further in p9_virtio_create().
 	 */
-	.maxsize = PAGE_SIZE * (VIRTQUEUE_NUM - 3),
+	.maxsize = P9_VIRTIO_MAXSIZE(VIRTQUEUE_SG_MAX),
 	.def = 1,
 	.owner = THIS_MODULE,
 };
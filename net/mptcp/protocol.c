@@ -1446,6 +1446,12 @@ static struct sock *mptcp_subflow_get_send(struct mptcp_sock *msk)
 		return sk_stream_memory_free(msk->first) ? msk->first : NULL;
 	}
 
+	if (msk->sched) {
+		ssk = mptcp_sched_get_send(msk);
+		mptcp_set_timeout(sk);
+		return ssk;
+	}
+
 	/* re-use last subflow, if the burst allow that */
 	if (msk->last_snd && msk->snd_burst > 0 &&
 	    sk_stream_memory_free(msk->last_snd) &&
@@ -1526,6 +1532,44 @@ static void mptcp_push_release(struct sock *ssk, struct mptcp_sendmsg_info *info
 	release_sock(ssk);
 }
 
+/* Copy the @len bytes of @dfrag starting at @sent, just pushed on @ssk,
+ * to every other subflow picked by the scheduler. Releases @ssk.
+ */
+static void mptcp_push_redundant(struct sock *sk, struct sock *ssk,
+				 struct mptcp_data_frag *dfrag, u16 sent,
+				 int len, struct mptcp_sendmsg_info *info)
+{
+	struct mptcp_sock *msk = mptcp_sk(sk);
+	struct mptcp_subflow_context *subflow;
+
+	msk->sched_redundant = 0;
+	mptcp_push_release(ssk, info);
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *copy_ssk = mptcp_subflow_tcp_sock(subflow);
+		struct mptcp_sendmsg_info copy_info = {
+			.flags = info->flags,
+			.sent = sent,
+			.limit = sent + len,
+		};
+		int ret;
+
+		if (!subflow->scheduled)
+			continue;
+
+		subflow->scheduled = 0;
+		lock_sock(copy_ssk);
+		while (copy_info.sent < copy_info.limit) {
+			ret = mptcp_sendmsg_frag(sk, copy_ssk, dfrag, &copy_info);
+			if (ret <= 0)
+				break;
+
+			copy_info.sent += ret;
+		}
+		mptcp_push_release(copy_ssk, &copy_info);
+	}
+}
+
 static void mptcp_update_post_push(struct mptcp_sock *msk,
 				   struct mptcp_data_frag *dfrag,
 				   u32 sent)
@@ -1603,6 +1647,12 @@ void __mptcp_push_pending(struct sock *sk, unsigned int flags)
 			len -= ret;
 
 			mptcp_update_post_push(msk, dfrag, ret);
+
+			if (unlikely(msk->sched_redundant)) {
+				mptcp_push_redundant(sk, ssk, dfrag,
+						     info.sent - ret, ret, &info);
+				ssk = NULL;
+			}
 		}
 		WRITE_ONCE(msk->first_pending, mptcp_send_next(sk));
 	}
@@ -2214,6 +2264,9 @@ static struct sock *mptcp_subflow_get_retrans(struct mptcp_sock *msk)
 	if (__mptcp_check_fallback(msk))
 		return NULL;
 
+	if (msk->sched)
+		return mptcp_sched_get_retrans(msk);
+
 	mptcp_for_each_subflow(msk, subflow) {
 		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
 
@@ -2643,6 +2696,13 @@ static int mptcp_init_sock(struct sock *sk)
 	if (ret)
 		return ret;
 
+	rcu_read_lock();
+	ret = mptcp_init_sched(mptcp_sk(sk),
+			       mptcp_sched_find(mptcp_get_scheduler(net)));
+	rcu_read_unlock();
+	if (ret)
+		return ret;
+
 	/* fetch the ca name; do it outside __mptcp_init_sock(), so that clone will
 	 * propagate the correct value
 	 */
@@ -2972,6 +3032,12 @@ struct sock *mptcp_sk_clone(const struct sock *sk,
 	msk->wnd_end = msk->snd_nxt + req->rsk_rcv_wnd;
 	msk->setsockopt_seq = mptcp_sk(sk)->setsockopt_seq;
 
+	/* the clone shares the listener's scheduler; fall back to the
+	 * built-in one if that is going away
+	 */
+	msk->sched = NULL;
+	mptcp_init_sched(msk, mptcp_sk(sk)->sched);
+
 	if (mp_opt->suboptions & OPTIONS_MPTCP_MPC) {
 		msk->can_ack = true;
 		msk->remote_key = mp_opt->sndr_key;
@@ -3087,6 +3153,7 @@ static void mptcp_destroy(struct sock *sk)
 	struct mptcp_sock *msk = mptcp_sk(sk);
 
 	mptcp_destroy_common(msk);
+	mptcp_release_sched(msk);
 	sk_sockets_allocated_dec(sk);
 }
 
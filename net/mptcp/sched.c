@@ -0,0 +1,205 @@
+// SPDX-License-Identifier: GPL-2.0
+/* Multipath TCP
+ *
+ * Pluggable packet schedulers.
+ */
+
+#define pr_fmt(fmt) "MPTCP: " fmt
+
+#include <linux/bitmap.h>
+#include <linux/bpf.h>
+#include <linux/kernel.h>
+#include <linux/list.h>
+#include <linux/module.h>
+#include <linux/rculist.h>
+#include <linux/spinlock.h>
+#include "protocol.h"
+
+static DEFINE_SPINLOCK(mptcp_sched_list_lock);
+static LIST_HEAD(mptcp_sched_list);
+
+/* Must be called with rcu read lock held */
+struct mptcp_sched_ops *mptcp_sched_find(const char *name)
+{
+	struct mptcp_sched_ops *sched;
+
+	list_for_each_entry_rcu(sched, &mptcp_sched_list, list) {
+		if (!strcmp(sched->name, name))
+			return sched;
+	}
+
+	return NULL;
+}
+
+int mptcp_register_scheduler(struct mptcp_sched_ops *sched)
+{
+	if (!sched->get_subflow)
+		return -EINVAL;
+
+	spin_lock(&mptcp_sched_list_lock);
+	if (mptcp_sched_find(sched->name)) {
+		spin_unlock(&mptcp_sched_list_lock);
+		return -EEXIST;
+	}
+	list_add_tail_rcu(&sched->list, &mptcp_sched_list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	pr_debug("%s registered", sched->name);
+	return 0;
+}
+EXPORT_SYMBOL_GPL(mptcp_register_scheduler);
+
+void mptcp_unregister_scheduler(struct mptcp_sched_ops *sched)
+{
+	spin_lock(&mptcp_sched_list_lock);
+	list_del_rcu(&sched->list);
+	spin_unlock(&mptcp_sched_list_lock);
+
+	/* Wait for concurrent lookups by name, sockets already using the
+	 * scheduler keep a reference to its owner.
+	 */
+	synchronize_rcu();
+}
+EXPORT_SYMBOL_GPL(mptcp_unregister_scheduler);
+
+/* A NULL @sched selects the built-in scheduler */
+int mptcp_init_sched(struct mptcp_sock *msk, struct mptcp_sched_ops *sched)
+{
+	if (!sched)
+		return 0;
+
+	if (!bpf_try_module_get(sched, sched->owner))
+		return -EBUSY;
+
+	msk->sched = sched;
+	if (sched->init)
+		sched->init(msk);
+
+	pr_debug("msk=%p sched=%s", msk, sched->name);
+	return 0;
+}
+
+void mptcp_release_sched(struct mptcp_sock *msk)
+{
+	struct mptcp_sched_ops *sched = msk->sched;
+
+	if (!sched)
+		return;
+
+	msk->sched = NULL;
+	if (sched->release)
+		sched->release(msk);
+
+	bpf_module_put(sched, sched->owner);
+}
+
+static void mptcp_sched_data_add(struct mptcp_sched_data *data,
+				 struct mptcp_subflow_context *subflow)
+{
+	struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+	struct mptcp_sched_subflow *ctx;
+	const struct tcp_sock *tp = tcp_sk(ssk);
+
+	ctx = &data->contexts[data->subflows++];
+	ctx->subflow = subflow;
+	ctx->pacing_rate = READ_ONCE(ssk->sk_pacing_rate);
+	ctx->srtt_us = tp->srtt_us >> 3;
+	ctx->snd_cwnd = tcp_snd_cwnd(tp);
+	ctx->packets_out = tp->packets_out;
+	ctx->wmem_queued = READ_ONCE(ssk->sk_wmem_queued);
+	ctx->backup = subflow->backup;
+}
+
+static void mptcp_sched_data_init(struct mptcp_sock *msk, bool reinject,
+				  struct mptcp_sched_data *data)
+{
+	struct mptcp_subflow_context *subflow;
+
+	data->reinject = reinject;
+	data->subflows = 0;
+
+	mptcp_for_each_subflow(msk, subflow) {
+		struct sock *ssk = mptcp_subflow_tcp_sock(subflow);
+
+		subflow->scheduled = 0;
+		if (data->subflows == MPTCP_SUBFLOWS_MAX)
+			continue;
+
+		if (!reinject) {
+			if (!mptcp_subflow_active(subflow))
+				continue;
+		} else {
+			if (!__mptcp_subflow_active(subflow))
+				continue;
+
+			/* same as the built-in scheduler: only reinject on
+			 * subflows with no data outstanding at TCP level
+			 */
+			if (!tcp_rtx_and_write_queues_empty(ssk)) {
+				mptcp_pm_subflow_chk_stale(msk, ssk);
+				continue;
+			}
+		}
+
+		mptcp_sched_data_add(data, subflow);
+	}
+}
+
+static struct mptcp_subflow_context *mptcp_sched_pick(struct mptcp_sock *msk,
+						      bool reinject)
+{
+	struct mptcp_subflow_context *subflow, *pick = NULL;
+	struct mptcp_sched_data data;
+	unsigned long mask;
+	int i;
+
+	mptcp_sched_data_init(msk, reinject, &data);
+	if (!data.subflows)
+		return NULL;
+
+	mask = msk->sched->get_subflow(msk, &data);
+	mask &= GENMASK(data.subflows - 1, 0);
+	for_each_set_bit(i, &mask, data.subflows) {
+		subflow = data.contexts[i].subflow;
+		if (!pick) {
+			pick = subflow;
+			continue;
+		}
+
+		if (reinject)
+			break;
+
+		subflow->scheduled = 1;
+		msk->sched_redundant = 1;
+	}
+
+	return pick;
+}
+
+struct sock *mptcp_sched_get_send(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+	struct sock *ssk;
+
+	msk->sched_redundant = 0;
+	subflow = mptcp_sched_pick(msk, false);
+	if (!subflow)
+		return NULL;
+
+	ssk = mptcp_subflow_tcp_sock(subflow);
+	if (!sk_stream_memory_free(ssk)) {
+		msk->sched_redundant = 0;
+		return NULL;
+	}
+
+	msk->last_snd = ssk;
+	return ssk;
+}
+
+struct sock *mptcp_sched_get_retrans(struct mptcp_sock *msk)
+{
+	struct mptcp_subflow_context *subflow;
+
+	subflow = mptcp_sched_pick(msk, true);
+	return subflow ? mptcp_subflow_tcp_sock(subflow) : NULL;
+}
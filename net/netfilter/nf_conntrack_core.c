@@ -810,6 +810,102 @@ __nf_conntrack_find_get(struct net *net, const struct nf_conntrack_zone *zone,
 	return h;
 }
 
+/* Small direct-mapped per-cpu cache of recent lookup results, consulted
+ * before walking the hash table.  Each entry holds a reference on its
+ * conntrack; a hit is only used after the usual post-refcount checks, so
+ * a recycled, killed or expired entry simply misses.
+ */
+#define NF_CT_FLOW_CACHE_SIZE	64
+
+struct nf_ct_flow_cache_entry {
+	u32				hash;
+	struct nf_conntrack_tuple_hash	*h;
+};
+
+struct nf_ct_flow_cache {
+	struct nf_ct_flow_cache_entry	ent[NF_CT_FLOW_CACHE_SIZE];
+};
+
+static DEFINE_PER_CPU(struct nf_ct_flow_cache, nf_ct_flow_cache);
+
+/* Entries are only ever swapped with xchg() and validated on use, so
+ * these may run preemptible and touch another cpu's cache.
+ */
+static struct nf_ct_flow_cache_entry *nf_ct_flow_cache_entry(u32 hash)
+{
+	struct nf_ct_flow_cache *cache = raw_cpu_ptr(&nf_ct_flow_cache);
+
+	return &cache->ent[hash % NF_CT_FLOW_CACHE_SIZE];
+}
+
+static struct nf_conntrack_tuple_hash *
+nf_ct_flow_cache_get(struct net *net, const struct nf_conntrack_zone *zone,
+		     const struct nf_conntrack_tuple *tuple, u32 hash)
+{
+	struct nf_ct_flow_cache_entry *e = nf_ct_flow_cache_entry(hash);
+	struct nf_conntrack_tuple_hash *h;
+	struct nf_conn *ct;
+
+	if (READ_ONCE(e->hash) != hash)
+		return NULL;
+
+	rcu_read_lock();
+	h = READ_ONCE(e->h);
+	if (!h)
+		goto miss;
+
+	ct = nf_ct_tuplehash_to_ctrack(h);
+	if (unlikely(!refcount_inc_not_zero(&ct->ct_general.use)))
+		goto miss;
+
+	/* re-check key after refcount */
+	smp_acquire__after_ctrl_dep();
+
+	if (likely(nf_ct_key_equal(h, tuple, zone, net) &&
+		   !nf_ct_is_dying(ct) && !nf_ct_is_expired(ct))) {
+		rcu_read_unlock();
+		return h;
+	}
+
+	/* Stale entry, don't keep a dead conntrack pinned in the cache. */
+	if (cmpxchg(&e->h, h, NULL) == h)
+		nf_ct_put(ct);
+	nf_ct_put(ct);
+miss:
+	rcu_read_unlock();
+	return NULL;
+}
+
+static void nf_ct_flow_cache_put(u32 hash, struct nf_conntrack_tuple_hash *h)
+{
+	struct nf_ct_flow_cache_entry *e = nf_ct_flow_cache_entry(hash);
+	struct nf_conntrack_tuple_hash *old;
+
+	nf_conntrack_get(&nf_ct_tuplehash_to_ctrack(h)->ct_general);
+	WRITE_ONCE(e->hash, hash);
+	old = xchg(&e->h, h);
+	if (old)
+		nf_ct_put(nf_ct_tuplehash_to_ctrack(old));
+}
+
+/* Drop the references held by every cpu's cache. */
+static void nf_ct_flow_cache_flush(void)
+{
+	struct nf_conntrack_tuple_hash *old;
+	unsigned int i;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		struct nf_ct_flow_cache *cache = per_cpu_ptr(&nf_ct_flow_cache, cpu);
+
+		for (i = 0; i < NF_CT_FLOW_CACHE_SIZE; i++) {
+			old = xchg(&cache->ent[i].h, NULL);
+			if (old)
+				nf_ct_put(nf_ct_tuplehash_to_ctrack(old));
+		}
+	}
+}
+
 struct nf_conntrack_tuple_hash *
 nf_conntrack_find_get(struct net *net, const struct nf_conntrack_zone *zone,
 		      const struct nf_conntrack_tuple *tuple)
@@ -1815,7 +1911,12 @@ resolve_normal_ct(struct nf_conn *tmpl,
 
 	zone_id = nf_ct_zone_id(zone, IP_CT_DIR_ORIGINAL);
 	hash = hash_conntrack_raw(&tuple, zone_id, state->net);
-	h = __nf_conntrack_find_get(state->net, zone, &tuple, hash);
+	h = nf_ct_flow_cache_get(state->net, zone, &tuple, hash);
+	if (!h) {
+		h = __nf_conntrack_find_get(state->net, zone, &tuple, hash);
+		if (h)
+			nf_ct_flow_cache_put(hash, h);
+	}
 
 	if (!h) {
 		rid = nf_ct_zone_id(zone, IP_CT_DIR_REPLY);
@@ -2472,6 +2573,7 @@ nf_ct_iterate_destroy(int (*iter)(struct nf_conn *i, void *data), void *data)
 	synchronize_net();
 
 	nf_ct_ext_bump_genid();
+	nf_ct_flow_cache_flush();
 	iter_data.data = data;
 	nf_ct_iterate_cleanup(iter, &iter_data);
 
@@ -2534,6 +2636,8 @@ void nf_conntrack_cleanup_net_list(struct list_head *net_exit_list)
 	synchronize_net();
 i_see_dead_people:
 	busy = 0;
+	/* Cached entries would otherwise keep the count from reaching 0. */
+	nf_ct_flow_cache_flush();
 	list_for_each_entry(net, net_exit_list, exit_list) {
 		struct nf_conntrack_net *cnet = nf_ct_pernet(net);
 
@@ -0,0 +1,146 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/* Unstable Flow Table Helpers for XDP hook
+ *
+ * These are called from the XDP programs.
+ * Note that it is allowed to break compatibility for these functions since
+ * the interface they are exposed through to BPF programs is explicitly
+ * unstable.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/netfilter.h>
+#include <linux/bpf.h>
+#include <linux/btf.h>
+#include <linux/btf_ids.h>
+#include <linux/netdevice.h>
+#include <net/xdp.h>
+#include <net/netfilter/nf_flow_table.h>
+
+/* bpf_flowtable_opts - options for bpf flowtable helpers
+ * @error: out parameter, set for any encountered error
+ */
+struct bpf_flowtable_opts {
+	s32 error;
+};
+
+enum {
+	NF_BPF_FLOWTABLE_OPTS_SZ = 4,
+};
+
+__diag_push();
+__diag_ignore_all("-Wmissing-prototypes",
+		  "Global functions as their definitions will be in nf_flow_table BTF");
+
+static struct flow_offload_tuple_rhash *
+bpf_xdp_flow_tuple_lookup(struct net_device *dev,
+			  struct flow_offload_tuple *tuple)
+{
+	struct flow_offload_tuple_rhash *tuplehash;
+	struct nf_flowtable *nf_flow_table;
+	struct flow_offload *nf_flow;
+
+	nf_flow_table = nf_flowtable_by_dev(dev);
+	if (!nf_flow_table)
+		return ERR_PTR(-ENOENT);
+
+	tuplehash = flow_offload_lookup(nf_flow_table, tuple);
+	if (!tuplehash)
+		return ERR_PTR(-ENOENT);
+
+	nf_flow = container_of(tuplehash, struct flow_offload,
+			       tuplehash[tuplehash->tuple.dir]);
+	flow_offload_refresh(nf_flow_table, nf_flow);
+
+	return tuplehash;
+}
+
+/* bpf_xdp_flow_lookup - Look up the flowtable entry for a packet
+ *
+ * Looks the tuple up in the software flowtable bound to the device the
+ * packet arrived on.  The returned entry carries the transmit type, MTU,
+ * the output device and MAC addresses for direct transmit, and the
+ * NAT-translated tuple of the other direction; the program does the rewrite
+ * and redirect itself, resolving neighbours with bpf_fib_lookup() if need
+ * be.  TCP FIN/RST and MTU handling are left to the program, which should
+ * pass such packets up the stack so the flow is torn down there.
+ *
+ * Parameters:
+ * @ctx		- Pointer to ctx (xdp_md) in XDP program
+ *		    Cannot be NULL
+ * @fib_tuple	- Pointer to the packet tuple, in bpf_fib_lookup layout
+ *		    (family, l4_protocol, sport, dport, ifindex and addresses)
+ *		    Cannot be NULL
+ * @opts	- Additional options for lookup (documented above)
+ *		    Cannot be NULL
+ * @opts__sz	- Length of the bpf_flowtable_opts structure
+ *		    Must be NF_BPF_FLOWTABLE_OPTS_SZ (4)
+ */
+struct flow_offload_tuple_rhash *
+bpf_xdp_flow_lookup(struct xdp_md *ctx, struct bpf_fib_lookup *fib_tuple,
+		    struct bpf_flowtable_opts *opts, u32 opts__sz)
+{
+	struct xdp_buff *xdp = (struct xdp_buff *)ctx;
+	struct flow_offload_tuple tuple = {};
+	struct flow_offload_tuple_rhash *tuplehash;
+
+	BUILD_BUG_ON(sizeof(struct bpf_flowtable_opts) != NF_BPF_FLOWTABLE_OPTS_SZ);
+
+	if (!opts)
+		return NULL;
+	if (!fib_tuple || opts__sz != NF_BPF_FLOWTABLE_OPTS_SZ) {
+		opts->error = -EINVAL;
+		return NULL;
+	}
+
+	tuple.iifidx = fib_tuple->ifindex;
+	tuple.l3proto = fib_tuple->family;
+	tuple.l4proto = fib_tuple->l4_protocol;
+	tuple.src_port = fib_tuple->sport;
+	tuple.dst_port = fib_tuple->dport;
+
+	switch (fib_tuple->family) {
+	case AF_INET:
+		tuple.src_v4.s_addr = fib_tuple->ipv4_src;
+		tuple.dst_v4.s_addr = fib_tuple->ipv4_dst;
+		break;
+	case AF_INET6:
+		memcpy(&tuple.src_v6, fib_tuple->ipv6_src, sizeof(tuple.src_v6));
+		memcpy(&tuple.dst_v6, fib_tuple->ipv6_dst, sizeof(tuple.dst_v6));
+		break;
+	default:
+		opts->error = -EAFNOSUPPORT;
+		return NULL;
+	}
+
+	tuplehash = bpf_xdp_flow_tuple_lookup(xdp->rxq->dev, &tuple);
+	if (IS_ERR(tuplehash)) {
+		opts->error = PTR_ERR(tuplehash);
+		return NULL;
+	}
+
+	return tuplehash;
+}
+
+__diag_pop()
+
+BTF_SET_START(nf_ft_xdp_check_kfunc_ids)
+BTF_ID(func, bpf_xdp_flow_lookup)
+BTF_SET_END(nf_ft_xdp_check_kfunc_ids)
+
+BTF_SET_START(nf_ft_ret_null_kfunc_ids)
+BTF_ID(func, bpf_xdp_flow_lookup)
+BTF_SET_END(nf_ft_ret_null_kfunc_ids)
+
+static const struct btf_kfunc_id_set nf_flow_table_xdp_kfunc_set = {
+	.owner        = THIS_MODULE,
+	.check_set    = &nf_ft_xdp_check_kfunc_ids,
+	.ret_null_set = &nf_ft_ret_null_kfunc_ids,
+};
+
+int nf_flow_register_bpf(void)
+{
+	return register_btf_kfunc_id_set(BPF_PROG_TYPE_XDP,
+					 &nf_flow_table_xdp_kfunc_set);
+}
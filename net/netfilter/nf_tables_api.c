@@ -3697,6 +3697,9 @@ static const struct nft_set_type *nft_set_types[] = {
 	&nft_set_rbtree_type,
 #if defined(CONFIG_X86_64) && !defined(CONFIG_UML)
 	&nft_set_pipapo_avx2_type,
+#endif
+#if defined(CONFIG_ARM64) && defined(CONFIG_KERNEL_MODE_NEON)
+	&nft_set_pipapo_neon_type,
 #endif
 	&nft_set_pipapo_type,
 };
@@ -4512,6 +4515,7 @@ static int nf_tables_newset(struct sk_buff *skb, const struct nfnl_info *info,
 
 	INIT_LIST_HEAD(&set->bindings);
 	INIT_LIST_HEAD(&set->catchall_list);
+	INIT_LIST_HEAD(&set->pending_update);
 	set->table = table;
 	write_pnet(&set->net, net);
 	set->ops = ops;
@@ -8391,8 +8395,24 @@ static bool nft_expr_reduce(struct nft_regs_track *track,
 	return false;
 }
 
+static const struct nft_rule_dp *
+nf_tables_chain_rules_cur(const struct net *net, const struct nft_chain *chain)
+{
+	const struct nft_rule_blob *blob;
+
+	if (net->nft.gencursor)
+		blob = rcu_dereference_protected(chain->blob_gen_1,
+						 lockdep_commit_lock_is_held(net));
+	else
+		blob = rcu_dereference_protected(chain->blob_gen_0,
+						 lockdep_commit_lock_is_held(net));
+
+	return (const struct nft_rule_dp *)blob->data;
+}
+
 static int nf_tables_commit_chain_prepare(struct net *net, struct nft_chain *chain)
 {
+	const struct nft_rule_dp *prule_cur, *copy;
 	const struct nft_expr *expr, *last;
 	struct nft_regs_track track = {};
 	unsigned int size, data_size;
@@ -8422,10 +8442,44 @@ static int nf_tables_commit_chain_prepare(struct net *net, struct nft_chain *cha
 	data_boundary = data + data_size;
 	size = 0;
 
+	/* Rules that stay in place are already laid out in the blob the
+	 * packet path uses for the current generation, in the same order as
+	 * in the rule list: copy them over rather than building them again
+	 * from their expressions, so that appending or deleting a few rules
+	 * only pays for the rules that changed. If the blob doesn't match the
+	 * rule list, build the remaining rules from scratch.
+	 */
+	prule_cur = nf_tables_chain_rules_cur(net, chain);
+
 	list_for_each_entry(rule, &chain->rules, list) {
+		copy = NULL;
+		if (prule_cur && nft_is_active(net, rule)) {
+			if (!prule_cur->is_last &&
+			    prule_cur->handle == rule->handle) {
+				copy = prule_cur;
+				prule_cur = (void *)prule_cur +
+					    offsetof(struct nft_rule_dp, data) +
+					    prule_cur->dlen;
+			} else {
+				prule_cur = NULL;
+			}
+		}
+
 		if (!nft_is_active_next(net, rule))
 			continue;
 
+		if (copy) {
+			size = offsetof(struct nft_rule_dp, data) + copy->dlen;
+			if (WARN_ON_ONCE(data + size > data_boundary))
+				return -ENOMEM;
+
+			memcpy(data, copy, size);
+			data += size;
+			chain->blob_next->size += size;
+			size = 0;
+			continue;
+		}
+
 		prule = (struct nft_rule_dp *)data;
 		data += offsetof(struct nft_rule_dp, data);
 		if (WARN_ON_ONCE(data > data_boundary))
@@ -8710,10 +8764,29 @@ static void nf_tables_commit_audit_log(struct list_head *adl, u32 generation)
 	}
 }
 
+static void nft_set_commit_update_add(struct nft_set *set,
+				      struct list_head *set_update_list)
+{
+	if (set->ops->commit && list_empty(&set->pending_update))
+		list_add_tail(&set->pending_update, set_update_list);
+}
+
+static void nft_set_commit_update(struct net *net,
+				  struct list_head *set_update_list)
+{
+	struct nft_set *set, *next;
+
+	list_for_each_entry_safe(set, next, set_update_list, pending_update) {
+		list_del_init(&set->pending_update);
+		set->ops->commit(net, set);
+	}
+}
+
 static int nf_tables_commit(struct net *net, struct sk_buff *skb)
 {
 	struct nftables_pernet *nft_net = nft_pernet(net);
 	struct nft_trans *trans, *next;
+	LIST_HEAD(set_update_list);
 	struct nft_trans_elem *te;
 	struct nft_chain *chain;
 	struct nft_table *table;
@@ -8859,6 +8932,7 @@ static int nf_tables_commit(struct net *net, struct sk_buff *skb)
 			nf_tables_setelem_notify(&trans->ctx, te->set,
 						 &te->elem,
 						 NFT_MSG_NEWSETELEM);
+			nft_set_commit_update_add(te->set, &set_update_list);
 			nft_trans_destroy(trans);
 			break;
 		case NFT_MSG_DELSETELEM:
@@ -8872,6 +8946,7 @@ static int nf_tables_commit(struct net *net, struct sk_buff *skb)
 				atomic_dec(&te->set->nelems);
 				te->set->ndeact--;
 			}
+			nft_set_commit_update_add(te->set, &set_update_list);
 			break;
 		case NFT_MSG_NEWOBJ:
 			if (nft_trans_obj_update(trans)) {
@@ -8932,6 +9007,8 @@ static int nf_tables_commit(struct net *net, struct sk_buff *skb)
 		}
 	}
 
+	nft_set_commit_update(net, &set_update_list);
+
 	nft_commit_notify(net, NETLINK_CB(skb).portid);
 	nf_tables_gen_notify(net, skb, NFT_MSG_NEWGEN);
 	nf_tables_commit_audit_log(&adl, nft_net->base_seq);
@@ -8988,6 +9065,25 @@ static void nf_tables_abort_release(struct nft_trans *trans)
 	kfree(trans);
 }
 
+/* Set backends may have dropped the lookup data they keep for the current
+ * generation as soon as the batch started to modify them. Walk all the sets
+ * that remain linked once the transaction has been undone and let them
+ * restore it, elements of sets created by this batch don't need it.
+ */
+static void nft_set_abort_update(struct net *net)
+{
+	struct nftables_pernet *nft_net = nft_pernet(net);
+	struct nft_table *table;
+	struct nft_set *set;
+
+	list_for_each_entry(table, &nft_net->tables, list) {
+		list_for_each_entry(set, &table->sets, list) {
+			if (set->ops->abort)
+				set->ops->abort(net, set);
+		}
+	}
+}
+
 static int __nf_tables_abort(struct net *net, enum nfnl_abort_action action)
 {
 	struct nftables_pernet *nft_net = nft_pernet(net);
@@ -9134,6 +9230,8 @@ static int __nf_tables_abort(struct net *net, enum nfnl_abort_action action)
 		}
 	}
 
+	nft_set_abort_update(net);
+
 	synchronize_rcu();
 
 	list_for_each_entry_safe_reverse(trans, next,
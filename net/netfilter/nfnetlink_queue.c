@@ -202,19 +202,29 @@ __dequeue_entry(struct nfqnl_instance *queue, struct nf_queue_entry *entry)
 }
 
 static struct nf_queue_entry *
-find_dequeue_entry(struct nfqnl_instance *queue, unsigned int id)
+__find_entry(struct nfqnl_instance *queue, unsigned int id)
 {
-	struct nf_queue_entry *entry = NULL, *i;
-
-	spin_lock_bh(&queue->lock);
+	struct nf_queue_entry *i;
 
+	/* Verdicts usually come in queueing order, so this tends to
+	 * terminate on the first entry.
+	 */
 	list_for_each_entry(i, &queue->queue_list, list) {
-		if (i->id == id) {
-			entry = i;
-			break;
-		}
+		if (i->id == id)
+			return i;
 	}
 
+	return NULL;
+}
+
+static struct nf_queue_entry *
+find_dequeue_entry(struct nfqnl_instance *queue, unsigned int id)
+{
+	struct nf_queue_entry *entry;
+
+	spin_lock_bh(&queue->lock);
+
+	entry = __find_entry(queue, id);
 	if (entry)
 		__dequeue_entry(queue, entry);
 
@@ -1034,6 +1044,7 @@ static const struct nla_policy nfqa_verdict_batch_policy[NFQA_MAX+1] = {
 	[NFQA_VERDICT_HDR]	= { .len = sizeof(struct nfqnl_msg_verdict_hdr) },
 	[NFQA_MARK]		= { .type = NLA_U32 },
 	[NFQA_PRIORITY]		= { .type = NLA_U32 },
+	[NFQA_VERDICT_LIST]	= { .type = NLA_BINARY },
 };
 
 static struct nfqnl_instance *
@@ -1072,6 +1083,77 @@ static int nfq_id_after(unsigned int id, unsigned int max)
 	return (int)(id - max) > 0;
 }
 
+static void nfqnl_verdict_apply(struct nf_queue_entry *entry,
+				const struct nlattr * const nfqa[],
+				unsigned int verdict)
+{
+	if (nfqa[NFQA_MARK])
+		entry->skb->mark = ntohl(nla_get_be32(nfqa[NFQA_MARK]));
+
+	if (nfqa[NFQA_PRIORITY])
+		entry->skb->priority = ntohl(nla_get_be32(nfqa[NFQA_PRIORITY]));
+
+	nfqnl_reinject(entry, verdict);
+}
+
+#define NFQNL_VERDICT_LIST_CHUNK	16
+
+/* Each element of NFQA_VERDICT_LIST carries its own packet id and verdict,
+ * so that a single message can carry the verdicts for many packets that
+ * are not contiguous in the queue. Entries are dequeued a chunk at a time
+ * and reinjected with the queue lock released.
+ */
+static int nfqnl_recv_verdict_list(struct nfqnl_instance *queue,
+				   const struct nlattr * const nfqa[])
+{
+	const struct nlattr *attr = nfqa[NFQA_VERDICT_LIST];
+	struct {
+		struct nf_queue_entry	*entry;
+		unsigned int		verdict;
+	} batch[NFQNL_VERDICT_LIST_CHUNK];
+	const struct nfqnl_msg_verdict_hdr *vhdr;
+	unsigned int i, j, n, last, count, found = 0;
+	struct nf_queue_entry *entry;
+	unsigned int verdict;
+
+	if (nla_len(attr) == 0 || nla_len(attr) % sizeof(*vhdr))
+		return -EINVAL;
+
+	vhdr = nla_data(attr);
+	count = nla_len(attr) / sizeof(*vhdr);
+
+	for (i = 0; i < count; i++) {
+		verdict = ntohl(vhdr[i].verdict) & NF_VERDICT_MASK;
+		if (verdict > NF_MAX_VERDICT || verdict == NF_STOLEN)
+			return -EINVAL;
+	}
+
+	for (i = 0; i < count; i = last) {
+		last = min(count, i + NFQNL_VERDICT_LIST_CHUNK);
+		n = 0;
+
+		spin_lock_bh(&queue->lock);
+		for (j = i; j < last; j++) {
+			entry = __find_entry(queue, ntohl(vhdr[j].id));
+			if (!entry)
+				continue;
+
+			__dequeue_entry(queue, entry);
+			batch[n].entry = entry;
+			batch[n].verdict = ntohl(vhdr[j].verdict);
+			n++;
+		}
+		spin_unlock_bh(&queue->lock);
+
+		for (j = 0; j < n; j++)
+			nfqnl_verdict_apply(batch[j].entry, nfqa,
+					    batch[j].verdict);
+		found += n;
+	}
+
+	return found ? 0 : -ENOENT;
+}
+
 static int nfqnl_recv_verdict_batch(struct sk_buff *skb,
 				    const struct nfnl_info *info,
 				    const struct nlattr * const nfqa[])
@@ -1089,6 +1171,9 @@ static int nfqnl_recv_verdict_batch(struct sk_buff *skb,
 	if (IS_ERR(queue))
 		return PTR_ERR(queue);
 
+	if (nfqa[NFQA_VERDICT_LIST])
+		return nfqnl_recv_verdict_list(queue, nfqa);
+
 	vhdr = verdicthdr_get(nfqa);
 	if (!vhdr)
 		return -EINVAL;
@@ -1110,15 +1195,8 @@ static int nfqnl_recv_verdict_batch(struct sk_buff *skb,
 	if (list_empty(&batch_list))
 		return -ENOENT;
 
-	list_for_each_entry_safe(entry, tmp, &batch_list, list) {
-		if (nfqa[NFQA_MARK])
-			entry->skb->mark = ntohl(nla_get_be32(nfqa[NFQA_MARK]));
-
-		if (nfqa[NFQA_PRIORITY])
-			entry->skb->priority = ntohl(nla_get_be32(nfqa[NFQA_PRIORITY]));
-
-		nfqnl_reinject(entry, verdict);
-	}
+	list_for_each_entry_safe(entry, tmp, &batch_list, list)
+		nfqnl_verdict_apply(entry, nfqa, verdict);
 	return 0;
 }
 
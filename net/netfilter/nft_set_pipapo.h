@@ -68,7 +68,8 @@
 /* Definitions for vectorised implementations */
 #ifdef NFT_PIPAPO_ALIGN
 #define NFT_PIPAPO_ALIGN_HEADROOM					\
-	(NFT_PIPAPO_ALIGN - ARCH_KMALLOC_MINALIGN)
+	(NFT_PIPAPO_ALIGN > ARCH_KMALLOC_MINALIGN ?			\
+	 NFT_PIPAPO_ALIGN - ARCH_KMALLOC_MINALIGN : 0)
 #define NFT_PIPAPO_LT_ALIGN(lt)		(PTR_ALIGN((lt), NFT_PIPAPO_ALIGN))
 #define NFT_PIPAPO_LT_ASSIGN(field, x)					\
 	do {								\
@@ -0,0 +1,352 @@
+// SPDX-License-Identifier: GPL-2.0-only
+
+/* PIPAPO: PIle PAcket POlicies: NEON packet lookup routines
+ *
+ * Same algorithm and bitmap handling as the AVX2 implementation in
+ * nft_set_pipapo_avx2.c, on 128-bit vectors.
+ */
+
+#include <linux/kernel.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/netlink.h>
+#include <linux/netfilter.h>
+#include <linux/netfilter/nf_tables.h>
+#include <net/netfilter/nf_tables_core.h>
+#include <uapi/linux/netfilter/nf_tables.h>
+#include <linux/bitmap.h>
+#include <linux/bitops.h>
+
+#include <linux/compiler.h>
+#include <asm/cpufeature.h>
+#include <asm/neon.h>
+#include <asm/neon-intrinsics.h>
+#include <asm/simd.h>
+
+#include "nft_set_pipapo_neon.h"
+#include "nft_set_pipapo.h"
+
+#define NFT_PIPAPO_M128_BITS		128
+#define NFT_PIPAPO_LONGS_PER_M128	(NFT_PIPAPO_M128_BITS / BITS_PER_LONG)
+
+/* Current working bitmap index, toggled between field matches */
+static DEFINE_PER_CPU(bool, nft_pipapo_neon_scratch_index);
+
+/* Load 128 bits of a single lookup table bucket given lookup table (already
+ * offset to the current chunk), group index, value of packet bits, bucket
+ * size and bucket bits.
+ */
+static __always_inline uint64x2_t
+nft_pipapo_neon_bucket_load(const unsigned long *lt, int group, u8 v,
+			    unsigned long bsize, int bb)
+{
+	return vld1q_u64((const u64 *)&lt[(group * NFT_PIPAPO_BUCKETS(bb) + v) *
+					  bsize]);
+}
+
+static __always_inline bool nft_pipapo_neon_empty(uint64x2_t r)
+{
+	return !(vgetq_lane_u64(r, 0) | vgetq_lane_u64(r, 1));
+}
+
+/**
+ * nft_pipapo_neon_refill() - Scan bitmap, select mapping table item, set bits
+ * @offset:	Start from given bitmap (equivalent to bucket) offset, in longs
+ * @map:	Bitmap to be scanned for set bits
+ * @dst:	Destination bitmap
+ * @mt:		Mapping table containing bit set specifiers
+ * @last:	Return index of first set bit, if this is the last field
+ *
+ * Same as nft_pipapo_avx2_refill(), for the two words covered by one vector.
+ *
+ * Return: first set bit index if @last, index of first filled word otherwise.
+ */
+static int nft_pipapo_neon_refill(int offset, unsigned long *map,
+				  unsigned long *dst,
+				  union nft_pipapo_map_bucket *mt, bool last)
+{
+	int ret = -1, x;
+
+	for (x = 0; x < NFT_PIPAPO_LONGS_PER_M128; x++) {
+		while (map[x]) {
+			int r = __builtin_ctzl(map[x]);
+			int i = (offset + x) * BITS_PER_LONG + r;
+
+			if (last)
+				return i;
+
+			bitmap_set(dst, mt[i].to, mt[i].n);
+
+			if (ret == -1)
+				ret = mt[i].to;
+
+			map[x] &= ~(1UL << r);
+		}
+	}
+
+	return ret;
+}
+
+/**
+ * nft_pipapo_neon_lookup_field() - NEON-based lookup for one field
+ * @map:	Previous match result, used as initial bitmap
+ * @fill:	Destination bitmap to be filled with current match result
+ * @f:		Field, containing lookup and mapping tables
+ * @offset:	Ignore buckets before the given index, no bits are filled there
+ * @pkt:	Packet data, pointer to input nftables register
+ * @first:	If this is the first field, don't source previous result
+ * @last:	Last field: stop at the first match and return bit index
+ * @bb:		Bucket bits, 4 or 8
+ * @groups:	Number of groups in the field
+ *
+ * See nft_pipapo_avx2_lookup_4b_2() for the algorithm. This is always
+ * inlined with constant @bb and @groups from the specialised wrappers below,
+ * so that the compiler fully unrolls the group loop for the common field
+ * sizes.
+ *
+ * Return: -1 on no match, rule index of match if @last, otherwise first
+ * 128-bit word index to be checked next (i.e. first filled word).
+ */
+static __always_inline int
+nft_pipapo_neon_lookup_field(unsigned long *map, unsigned long *fill,
+			     struct nft_pipapo_field *f, int offset,
+			     const u8 *pkt, bool first, bool last,
+			     int bb, int groups)
+{
+	unsigned long *lt = NFT_PIPAPO_LT_ALIGN(f->lt), bsize = f->bsize;
+	int i, g, ret = -1, m128_size = bsize / NFT_PIPAPO_LONGS_PER_M128, b;
+	u8 pg[NFT_PIPAPO_MAX_BITS / 4];
+
+	for (g = 0; g < groups; g++) {
+		if (bb == 8)
+			pg[g] = pkt[g];
+		else
+			pg[g] = (g % 2) ? pkt[g / 2] & 0xf : pkt[g / 2] >> 4;
+	}
+
+	lt += offset * NFT_PIPAPO_LONGS_PER_M128;
+	for (i = offset; i < m128_size; i++, lt += NFT_PIPAPO_LONGS_PER_M128) {
+		int i_ul = i * NFT_PIPAPO_LONGS_PER_M128;
+		uint64x2_t r;
+
+		if (first) {
+			r = nft_pipapo_neon_bucket_load(lt, 0, pg[0], bsize, bb);
+		} else {
+			r = vld1q_u64((const u64 *)&map[i_ul]);
+			if (nft_pipapo_neon_empty(r))
+				continue;
+			r = vandq_u64(r, nft_pipapo_neon_bucket_load(lt, 0, pg[0],
+								     bsize, bb));
+		}
+
+		for (g = 1; g < groups; g++)
+			r = vandq_u64(r, nft_pipapo_neon_bucket_load(lt, g, pg[g],
+								     bsize, bb));
+
+		vst1q_u64((u64 *)&map[i_ul], r);
+		if (nft_pipapo_neon_empty(r))
+			continue;
+
+		b = nft_pipapo_neon_refill(i_ul, &map[i_ul], fill, f->mt, last);
+		if (last)
+			return b;
+
+		if (unlikely(ret == -1))
+			ret = b / NFT_PIPAPO_M128_BITS;
+	}
+
+	return ret;
+}
+
+#define NFT_PIPAPO_NEON_LOOKUP_FN(b, n)					\
+static int nft_pipapo_neon_lookup_##b##b_##n(unsigned long *map,		\
+					     unsigned long *fill,	\
+					     struct nft_pipapo_field *f, \
+					     int offset, const u8 *pkt,	\
+					     bool first, bool last)	\
+{									\
+	return nft_pipapo_neon_lookup_field(map, fill, f, offset, pkt,	\
+					    first, last, b, n);		\
+}
+
+/* 8-bit fields, 16-bit fields, 32-bit fields, MAC addresses, IPv6 addresses */
+NFT_PIPAPO_NEON_LOOKUP_FN(4, 2)
+NFT_PIPAPO_NEON_LOOKUP_FN(4, 4)
+NFT_PIPAPO_NEON_LOOKUP_FN(4, 8)
+NFT_PIPAPO_NEON_LOOKUP_FN(4, 12)
+NFT_PIPAPO_NEON_LOOKUP_FN(4, 32)
+
+NFT_PIPAPO_NEON_LOOKUP_FN(8, 1)
+NFT_PIPAPO_NEON_LOOKUP_FN(8, 2)
+NFT_PIPAPO_NEON_LOOKUP_FN(8, 4)
+NFT_PIPAPO_NEON_LOOKUP_FN(8, 6)
+NFT_PIPAPO_NEON_LOOKUP_FN(8, 16)
+
+#undef NFT_PIPAPO_NEON_LOOKUP_FN
+
+/**
+ * nft_pipapo_neon_lookup_slow() - Fallback for field sizes without wrapper
+ * @map:	Previous match result, used as initial bitmap
+ * @fill:	Destination bitmap to be filled with current match result
+ * @f:		Field, containing lookup and mapping tables
+ * @offset:	Ignore buckets before the given index, no bits are filled there
+ * @pkt:	Packet data, pointer to input nftables register
+ * @first:	If this is the first field, don't source previous result
+ * @last:	Last field: stop at the first match and return bit index
+ *
+ * Return: -1 on no match, rule index of match if @last, otherwise first
+ * 128-bit word index to be checked next (i.e. first filled word).
+ */
+static noinline int nft_pipapo_neon_lookup_slow(unsigned long *map,
+						unsigned long *fill,
+						struct nft_pipapo_field *f,
+						int offset, const u8 *pkt,
+						bool first, bool last)
+{
+	return nft_pipapo_neon_lookup_field(map, fill, f, offset, pkt,
+					    first, last, f->bb, f->groups);
+}
+
+/**
+ * nft_pipapo_neon_estimate() - Set size, space and lookup complexity
+ * @desc:	Set description, element count and field description used
+ * @features:	Flags: NFT_SET_INTERVAL needs to be there
+ * @est:	Storage for estimation data
+ *
+ * Return: true if set is compatible and NEON available, false otherwise.
+ */
+bool nft_pipapo_neon_estimate(const struct nft_set_desc *desc, u32 features,
+			      struct nft_set_estimate *est)
+{
+	if (!(features & NFT_SET_INTERVAL) ||
+	    desc->field_count < NFT_PIPAPO_MIN_FIELDS)
+		return false;
+
+	if (!cpu_have_named_feature(ASIMD))
+		return false;
+
+	est->size = pipapo_estimate_size(desc);
+	if (!est->size)
+		return false;
+
+	est->lookup = NFT_SET_CLASS_O_LOG_N;
+
+	est->space = NFT_SET_CLASS_O_N;
+
+	return true;
+}
+
+/**
+ * nft_pipapo_neon_lookup() - Lookup function for NEON implementation
+ * @net:	Network namespace
+ * @set:	nftables API set representation
+ * @key:	nftables API element representation containing key data
+ * @ext:	nftables API extension pointer, filled with matching reference
+ *
+ * For more details, see DOC: Theory of Operation in nft_set_pipapo.c.
+ *
+ * Return: true on match, false otherwise.
+ */
+bool nft_pipapo_neon_lookup(const struct net *net, const struct nft_set *set,
+			    const u32 *key, const struct nft_set_ext **ext)
+{
+	struct nft_pipapo *priv = nft_set_priv(set);
+	unsigned long *res, *fill, *scratch;
+	u8 genmask = nft_genmask_cur(net);
+	const u8 *rp = (const u8 *)key;
+	struct nft_pipapo_match *m;
+	struct nft_pipapo_field *f;
+	bool map_index;
+	int i, ret = 0;
+
+	if (unlikely(!may_use_simd()))
+		return nft_pipapo_lookup(net, set, key, ext);
+
+	m = rcu_dereference(priv->match);
+
+	/* This also protects access to all data related to scratch maps */
+	kernel_neon_begin();
+
+	scratch = *raw_cpu_ptr(m->scratch_aligned);
+	if (unlikely(!scratch)) {
+		kernel_neon_end();
+		return false;
+	}
+	map_index = raw_cpu_read(nft_pipapo_neon_scratch_index);
+
+	res  = scratch + (map_index ? m->bsize_max : 0);
+	fill = scratch + (map_index ? 0 : m->bsize_max);
+
+	/* Starting map doesn't need to be set for this implementation */
+
+next_match:
+	nft_pipapo_for_each_field(f, i, m) {
+		bool last = i == m->field_count - 1, first = !i;
+
+#define NFT_SET_PIPAPO_NEON_LOOKUP(b, n)				\
+		(ret = nft_pipapo_neon_lookup_##b##b_##n(res, fill, f,	\
+							 ret, rp,	\
+							 first, last))
+
+		if (likely(f->bb == 8)) {
+			if (f->groups == 1) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(8, 1);
+			} else if (f->groups == 2) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(8, 2);
+			} else if (f->groups == 4) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(8, 4);
+			} else if (f->groups == 6) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(8, 6);
+			} else if (f->groups == 16) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(8, 16);
+			} else {
+				ret = nft_pipapo_neon_lookup_slow(res, fill, f,
+								  ret, rp,
+								  first, last);
+			}
+		} else {
+			if (f->groups == 2) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(4, 2);
+			} else if (f->groups == 4) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(4, 4);
+			} else if (f->groups == 8) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(4, 8);
+			} else if (f->groups == 12) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(4, 12);
+			} else if (f->groups == 32) {
+				NFT_SET_PIPAPO_NEON_LOOKUP(4, 32);
+			} else {
+				ret = nft_pipapo_neon_lookup_slow(res, fill, f,
+								  ret, rp,
+								  first, last);
+			}
+		}
+		NFT_PIPAPO_GROUP_BITS_ARE_8_OR_4;
+
+#undef NFT_SET_PIPAPO_NEON_LOOKUP
+
+		if (ret < 0)
+			goto out;
+
+		if (last) {
+			*ext = &f->mt[ret].e->ext;
+			if (unlikely(nft_set_elem_expired(*ext) ||
+				     !nft_set_elem_active(*ext, genmask))) {
+				ret = 0;
+				goto next_match;
+			}
+
+			goto out;
+		}
+
+		swap(res, fill);
+		rp += NFT_PIPAPO_GROUPS_PADDED_SIZE(f);
+	}
+
+out:
+	if (i % 2)
+		raw_cpu_write(nft_pipapo_neon_scratch_index, !map_index);
+	kernel_neon_end();
+
+	return ret >= 0;
+}
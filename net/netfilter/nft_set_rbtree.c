@@ -10,16 +10,29 @@
 #include <linux/module.h>
 #include <linux/list.h>
 #include <linux/rbtree.h>
+#include <linux/maple_tree.h>
 #include <linux/netlink.h>
 #include <linux/netfilter.h>
 #include <linux/netfilter/nf_tables.h>
 #include <net/netfilter/nf_tables_core.h>
 
+/* Read-only interval index built from the tree on commit: maps each range
+ * of keys covered by an interval to its start element. @genmask holds the
+ * generations this snapshot is valid for.
+ */
+struct nft_rbtree_index {
+	struct maple_tree	mt;
+	u8			genmask;
+};
+
 struct nft_rbtree {
 	struct rb_root		root;
 	rwlock_t		lock;
 	seqcount_rwlock_t	count;
 	struct delayed_work	gc_work;
+	struct nft_rbtree_index __rcu *index;
+	struct nft_rbtree_index	*stale;
+	unsigned long		stale_seq;
 };
 
 struct nft_rbtree_elem {
@@ -107,14 +120,59 @@ static bool __nft_rbtree_lookup(const struct net *net, const struct nft_set *set
 	return false;
 }
 
+/* The index is only kept for interval sets whose keys fit an unsigned long,
+ * so that memcmp() ordering can be preserved by loading keys as big endian
+ * numbers. Sets with timeouts are left out: the index would otherwise keep
+ * referencing elements released by garbage collection.
+ */
+static bool nft_rbtree_index_usable(const struct nft_set *set)
+{
+	return (set->flags & NFT_SET_INTERVAL) &&
+	       !(set->flags & NFT_SET_TIMEOUT) &&
+	       set->klen <= sizeof(unsigned long);
+}
+
+static unsigned long nft_rbtree_index_key(const struct nft_set *set,
+					  const void *key)
+{
+	const u8 *p = key;
+	unsigned long k = 0;
+	unsigned int i;
+
+	for (i = 0; i < set->klen; i++)
+		k = (k << BITS_PER_BYTE) | p[i];
+
+	return k;
+}
+
+static bool nft_rbtree_index_lookup(struct nft_rbtree_index *index,
+				    const struct nft_set *set, const u32 *key,
+				    const struct nft_set_ext **ext)
+{
+	struct nft_rbtree_elem *rbe;
+
+	rbe = mtree_load(&index->mt, nft_rbtree_index_key(set, key));
+	if (!rbe)
+		return false;
+
+	*ext = &rbe->ext;
+	return true;
+}
+
 INDIRECT_CALLABLE_SCOPE
 bool nft_rbtree_lookup(const struct net *net, const struct nft_set *set,
 		       const u32 *key, const struct nft_set_ext **ext)
 {
 	struct nft_rbtree *priv = nft_set_priv(set);
-	unsigned int seq = read_seqcount_begin(&priv->count);
+	struct nft_rbtree_index *index;
+	unsigned int seq;
 	bool ret;
 
+	index = rcu_dereference(priv->index);
+	if (index && (READ_ONCE(index->genmask) & nft_genmask_cur(net)))
+		return nft_rbtree_index_lookup(index, set, key, ext);
+
+	seq = read_seqcount_begin(&priv->count);
 	ret = __nft_rbtree_lookup(net, set, key, ext, seq);
 	if (ret || !read_seqcount_retry(&priv->count, seq))
 		return ret;
@@ -215,6 +273,149 @@ static void *nft_rbtree_get(const struct net *net, const struct nft_set *set,
 	return rbe;
 }
 
+static void nft_rbtree_index_free(struct nft_rbtree_index *index)
+{
+	mtree_destroy(&index->mt);
+	kfree(index);
+}
+
+/* Release the index replaced by the previous commit, readers may still walk
+ * it until a grace period elapses. This is usually the case by the time the
+ * set is updated again.
+ */
+static void nft_rbtree_index_reap(struct nft_rbtree *priv)
+{
+	if (!priv->stale)
+		return;
+
+	cond_synchronize_rcu(priv->stale_seq);
+	nft_rbtree_index_free(priv->stale);
+	priv->stale = NULL;
+}
+
+/* Called with the commit mutex held, once the new generation is current and
+ * elements removed by the transaction are unlinked from the tree: the walk
+ * can't race with any writer, and no garbage collection runs for these sets.
+ */
+static int nft_rbtree_index_load(struct nft_rbtree_index *index,
+				 const struct net *net,
+				 const struct nft_set *set)
+{
+	struct nft_rbtree_elem *rbe, *start = NULL;
+	struct nft_rbtree *priv = nft_set_priv(set);
+	MA_STATE(mas, &index->mt, 0, 0);
+	u8 genmask = nft_genmask_cur(net);
+	unsigned long key, first = 0;
+	struct rb_node *node;
+	int err;
+
+	mtree_lock(&index->mt);
+	err = mas_expected_entries(&mas, atomic_read(&set->nelems));
+	if (err)
+		goto out;
+
+	/* Walk from the lowest key up: each start element covers the range
+	 * up to the next active element, if any. Start elements sort after
+	 * end elements with the same key and win over them, as lookups do.
+	 */
+	for (node = rb_last(&priv->root); node; node = rb_prev(node)) {
+		rbe = rb_entry(node, struct nft_rbtree_elem, node);
+
+		if (!nft_set_elem_active(&rbe->ext, genmask))
+			continue;
+
+		key = nft_rbtree_index_key(set, nft_set_ext_key(&rbe->ext));
+		if (start) {
+			if (key == first && nft_rbtree_interval_end(rbe))
+				continue;
+
+			if (key > first) {
+				mas.index = first;
+				mas.last = key - 1;
+				err = mas_store_gfp(&mas, start, GFP_KERNEL);
+				if (err)
+					goto out;
+			}
+		}
+
+		start = nft_rbtree_interval_start(rbe) ? rbe : NULL;
+		first = key;
+	}
+
+	if (start) {
+		mas.index = first;
+		mas.last = set->klen < sizeof(unsigned long) ?
+			   BIT(set->klen * BITS_PER_BYTE) - 1 : ULONG_MAX;
+		err = mas_store_gfp(&mas, start, GFP_KERNEL);
+	}
+out:
+	mas_destroy(&mas);
+	mtree_unlock(&index->mt);
+
+	return err;
+}
+
+static struct nft_rbtree_index *
+nft_rbtree_index_build(const struct net *net, const struct nft_set *set)
+{
+	struct nft_rbtree_index *index;
+
+	index = kzalloc(sizeof(*index), GFP_KERNEL_ACCOUNT);
+	if (!index)
+		return NULL;
+
+	mt_init(&index->mt);
+	index->genmask = NFT_GENMASK_ANY;
+
+	if (nft_rbtree_index_load(index, net, set) < 0) {
+		nft_rbtree_index_free(index);
+		return NULL;
+	}
+
+	return index;
+}
+
+static void nft_rbtree_index_stale(const struct net *net,
+				   const struct nft_set *set)
+{
+	struct nft_rbtree *priv = nft_set_priv(set);
+	struct nft_rbtree_index *index;
+
+	/* Contents of the next generation are changing, keep the index for
+	 * the current one only, until the transaction is committed or aborted.
+	 */
+	index = rcu_dereference_protected(priv->index, true);
+	if (index)
+		WRITE_ONCE(index->genmask, nft_genmask_cur(net));
+}
+
+static void nft_rbtree_commit(const struct net *net, struct nft_set *set)
+{
+	struct nft_rbtree *priv = nft_set_priv(set);
+	struct nft_rbtree_index *index;
+
+	if (!nft_rbtree_index_usable(set))
+		return;
+
+	nft_rbtree_index_reap(priv);
+
+	/* On allocation failure, lookups fall back to the tree. */
+	index = nft_rbtree_index_build(net, set);
+
+	priv->stale = rcu_replace_pointer(priv->index, index, true);
+	priv->stale_seq = get_state_synchronize_rcu();
+}
+
+static void nft_rbtree_abort(const struct net *net, const struct nft_set *set)
+{
+	struct nft_rbtree *priv = nft_set_priv(set);
+	struct nft_rbtree_index *index;
+
+	index = rcu_dereference_protected(priv->index, true);
+	if (index)
+		WRITE_ONCE(index->genmask, NFT_GENMASK_ANY);
+}
+
 static int __nft_rbtree_insert(const struct net *net, const struct nft_set *set,
 			       struct nft_rbtree_elem *new,
 			       struct nft_set_ext **ext)
@@ -382,6 +583,9 @@ static int nft_rbtree_insert(const struct net *net, const struct nft_set *set,
 	write_seqcount_end(&priv->count);
 	write_unlock_bh(&priv->lock);
 
+	if (!err)
+		nft_rbtree_index_stale(net, set);
+
 	return err;
 }
 
@@ -417,6 +621,7 @@ static bool nft_rbtree_flush(const struct net *net,
 	if (!nft_set_elem_mark_busy(&rbe->ext) ||
 	    !nft_is_active(net, &rbe->ext)) {
 		nft_set_elem_change_active(net, set, &rbe->ext);
+		nft_rbtree_index_stale(net, set);
 		return true;
 	}
 	return false;
@@ -585,11 +790,18 @@ static int nft_rbtree_init(const struct nft_set *set,
 static void nft_rbtree_destroy(const struct nft_set *set)
 {
 	struct nft_rbtree *priv = nft_set_priv(set);
+	struct nft_rbtree_index *index;
 	struct nft_rbtree_elem *rbe;
 	struct rb_node *node;
 
 	cancel_delayed_work_sync(&priv->gc_work);
 	rcu_barrier();
+
+	nft_rbtree_index_reap(priv);
+	index = rcu_dereference_protected(priv->index, true);
+	if (index)
+		nft_rbtree_index_free(index);
+
 	while ((node = priv->root.rb_node) != NULL) {
 		rb_erase(node, &priv->root);
 		rbe = rb_entry(node, struct nft_rbtree_elem, node);
@@ -631,5 +843,7 @@ const struct nft_set_type nft_set_rbtree_type = {
 		.lookup		= nft_rbtree_lookup,
 		.walk		= nft_rbtree_walk,
 		.get		= nft_rbtree_get,
+		.commit		= nft_rbtree_commit,
+		.abort		= nft_rbtree_abort,
 	},
 };
@@ -25,6 +25,11 @@
 #include <net/netfilter/nf_nat.h>
 #endif
 
+#if IS_ENABLED(CONFIG_NF_FLOW_TABLE)
+#include <net/netfilter/nf_conntrack_l4proto.h>
+#include <net/netfilter/nf_flow_table.h>
+#endif
+
 #include <net/netfilter/nf_conntrack_act_ct.h>
 
 #include "datapath.h"
@@ -70,6 +75,7 @@ struct ovs_conntrack_info {
 	struct md_labels labels;
 	char timeout[CTNL_TIMEOUT_NAME_MAX];
 	struct nf_ct_timeout *nf_ct_timeout;
+	struct ovs_ct_flowtable *ct_ft;
 #if IS_ENABLED(CONFIG_NF_NAT)
 	struct nf_nat_range2 range;  /* Only present for SRC NAT and DST NAT. */
 #endif
@@ -939,6 +945,329 @@ static int ovs_ct_nat(struct net *net, struct sw_flow_key *key,
 }
 #endif
 
+#if IS_ENABLED(CONFIG_NF_FLOW_TABLE)
+/* Flow table shared by the ct() actions of one zone that carry
+ * OVS_CT_ATTR_FLOWTABLE.  Established connections are added to it, and
+ * their later packets are matched there without nf_conntrack_in().
+ * Only the software flow table is used, there is no hardware offload.
+ */
+struct ovs_ct_flowtable {
+	struct hlist_node node;
+	refcount_t ref;
+	u16 zone;
+	struct nf_flowtable nf_ft;
+	struct work_struct free_work;
+};
+
+static DEFINE_SPINLOCK(ovs_ct_ft_lock);	/* Protects ovs_ct_ft_list. */
+static HLIST_HEAD(ovs_ct_ft_list);
+static struct workqueue_struct *ovs_ct_ft_wq;
+
+static struct nf_flowtable_type ovs_ct_flowtable_type = {
+	.owner = THIS_MODULE,
+};
+
+static struct ovs_ct_flowtable *__ovs_ct_ft_find(struct net *net, u16 zone)
+{
+	struct ovs_ct_flowtable *ct_ft;
+
+	hlist_for_each_entry(ct_ft, &ovs_ct_ft_list, node) {
+		if (ct_ft->zone == zone &&
+		    net_eq(read_pnet(&ct_ft->nf_ft.net), net) &&
+		    refcount_inc_not_zero(&ct_ft->ref))
+			return ct_ft;
+	}
+	return NULL;
+}
+
+static void ovs_ct_ft_free_work(struct work_struct *work)
+{
+	struct ovs_ct_flowtable *ct_ft;
+
+	ct_ft = container_of(work, struct ovs_ct_flowtable, free_work);
+	nf_flow_table_free(&ct_ft->nf_ft);
+	kfree(ct_ft);
+}
+
+static struct ovs_ct_flowtable *ovs_ct_ft_get(struct net *net, u16 zone)
+{
+	struct ovs_ct_flowtable *ct_ft, *new;
+	int err;
+
+	spin_lock_bh(&ovs_ct_ft_lock);
+	ct_ft = __ovs_ct_ft_find(net, zone);
+	spin_unlock_bh(&ovs_ct_ft_lock);
+	if (ct_ft)
+		return ct_ft;
+
+	new = kzalloc(sizeof(*new), GFP_KERNEL);
+	if (!new)
+		return ERR_PTR(-ENOMEM);
+
+	refcount_set(&new->ref, 1);
+	new->zone = zone;
+	new->nf_ft.type = &ovs_ct_flowtable_type;
+	write_pnet(&new->nf_ft.net, net);
+	INIT_WORK(&new->free_work, ovs_ct_ft_free_work);
+	err = nf_flow_table_init(&new->nf_ft);
+	if (err) {
+		kfree(new);
+		return ERR_PTR(err);
+	}
+
+	/* Actions are parsed outside of ovs_mutex, recheck for a table
+	 * added in the meantime.
+	 */
+	spin_lock_bh(&ovs_ct_ft_lock);
+	ct_ft = __ovs_ct_ft_find(net, zone);
+	if (!ct_ft)
+		hlist_add_head(&new->node, &ovs_ct_ft_list);
+	spin_unlock_bh(&ovs_ct_ft_lock);
+
+	if (ct_ft) {
+		nf_flow_table_free(&new->nf_ft);
+		kfree(new);
+		return ct_ft;
+	}
+	return new;
+}
+
+/* May be called from RCU callbacks, the table is freed from a work item. */
+static void ovs_ct_ft_put(struct ovs_ct_flowtable *ct_ft)
+{
+	unsigned long flags;
+
+	if (!refcount_dec_and_lock_irqsave(&ct_ft->ref, &ovs_ct_ft_lock,
+					   &flags))
+		return;
+
+	hlist_del(&ct_ft->node);
+	spin_unlock_irqrestore(&ovs_ct_ft_lock, flags);
+	queue_work(ovs_ct_ft_wq, &ct_ft->free_work);
+}
+
+static bool ovs_ct_ft_fill_tuple_ipv4(struct sk_buff *skb,
+				      struct flow_offload_tuple *tuple,
+				      struct tcphdr **tcph)
+{
+	struct flow_ports *ports;
+	unsigned int thoff;
+	struct iphdr *iph;
+	size_t hdrsize;
+
+	if (!pskb_network_may_pull(skb, sizeof(*iph)))
+		return false;
+
+	iph = ip_hdr(skb);
+	thoff = iph->ihl * 4;
+	if (ip_is_fragment(iph) || unlikely(thoff != sizeof(struct iphdr)))
+		return false;
+
+	switch (iph->protocol) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(*ports);
+		break;
+	default:
+		return false;
+	}
+
+	if (!pskb_network_may_pull(skb, thoff + hdrsize))
+		return false;
+
+	iph = ip_hdr(skb);
+	if (iph->protocol == IPPROTO_TCP)
+		*tcph = (void *)(skb_network_header(skb) + thoff);
+
+	ports = (struct flow_ports *)(skb_network_header(skb) + thoff);
+	tuple->src_port = ports->source;
+	tuple->dst_port = ports->dest;
+	tuple->src_v4.s_addr = iph->saddr;
+	tuple->dst_v4.s_addr = iph->daddr;
+	tuple->l3proto = AF_INET;
+	tuple->l4proto = iph->protocol;
+
+	return true;
+}
+
+static bool ovs_ct_ft_fill_tuple_ipv6(struct sk_buff *skb,
+				      struct flow_offload_tuple *tuple,
+				      struct tcphdr **tcph)
+{
+	const unsigned int thoff = sizeof(struct ipv6hdr);
+	struct flow_ports *ports;
+	struct ipv6hdr *ip6h;
+	size_t hdrsize;
+
+	if (!pskb_network_may_pull(skb, sizeof(*ip6h)))
+		return false;
+
+	ip6h = ipv6_hdr(skb);
+	switch (ip6h->nexthdr) {
+	case IPPROTO_TCP:
+		hdrsize = sizeof(struct tcphdr);
+		break;
+	case IPPROTO_UDP:
+		hdrsize = sizeof(*ports);
+		break;
+	default:
+		return false;
+	}
+
+	if (!pskb_network_may_pull(skb, thoff + hdrsize))
+		return false;
+
+	ip6h = ipv6_hdr(skb);
+	if (ip6h->nexthdr == IPPROTO_TCP)
+		*tcph = (void *)(skb_network_header(skb) + thoff);
+
+	ports = (struct flow_ports *)(skb_network_header(skb) + thoff);
+	tuple->src_port = ports->source;
+	tuple->dst_port = ports->dest;
+	tuple->src_v6 = ip6h->saddr;
+	tuple->dst_v6 = ip6h->daddr;
+	tuple->l3proto = AF_INET6;
+	tuple->l4proto = ip6h->nexthdr;
+
+	return true;
+}
+
+/* Attach the conntrack entry of a connection found in the flow table to
+ * 'skb'.  Returns false if 'skb' has to go through nf_conntrack_in().
+ */
+static bool ovs_ct_ft_lookup(struct ovs_ct_flowtable *ct_ft,
+			     struct sk_buff *skb, u16 family)
+{
+	struct nf_flowtable *nf_ft = &ct_ft->nf_ft;
+	struct flow_offload_tuple_rhash *tuplehash;
+	struct flow_offload_tuple tuple = {};
+	enum ip_conntrack_info ctinfo;
+	struct tcphdr *tcph = NULL;
+	struct flow_offload *flow;
+	struct nf_conn *ct;
+	u8 dir;
+
+	switch (family) {
+	case NFPROTO_IPV4:
+		if (!ovs_ct_ft_fill_tuple_ipv4(skb, &tuple, &tcph))
+			return false;
+		break;
+	case NFPROTO_IPV6:
+		if (!ovs_ct_ft_fill_tuple_ipv6(skb, &tuple, &tcph))
+			return false;
+		break;
+	default:
+		return false;
+	}
+
+	tuplehash = flow_offload_lookup(nf_ft, &tuple);
+	if (!tuplehash)
+		return false;
+
+	dir = tuplehash->tuple.dir;
+	flow = container_of(tuplehash, struct flow_offload, tuplehash[dir]);
+	ct = flow->ct;
+
+	/* let conntrack see the connection going away */
+	if (tcph && unlikely(tcph->fin || tcph->rst)) {
+		flow_offload_teardown(flow);
+		return false;
+	}
+
+	ctinfo = dir == FLOW_OFFLOAD_DIR_ORIGINAL ? IP_CT_ESTABLISHED :
+						    IP_CT_ESTABLISHED_REPLY;
+
+	flow_offload_refresh(nf_ft, flow);
+	nf_conntrack_put(skb_nfct(skb));
+	nf_conntrack_get(&ct->ct_general);
+	nf_ct_set(skb, ct, ctinfo);
+
+	return true;
+}
+
+static void ovs_ct_ft_add(struct ovs_ct_flowtable *ct_ft, struct nf_conn *ct,
+			  enum ip_conntrack_info ctinfo)
+{
+	struct flow_offload *entry;
+
+	if ((ctinfo != IP_CT_ESTABLISHED &&
+	     ctinfo != IP_CT_ESTABLISHED_REPLY) ||
+	    !test_bit(IPS_ASSURED_BIT, &ct->status))
+		return;
+
+	switch (nf_ct_protonum(ct)) {
+	case IPPROTO_TCP:
+		if (ct->proto.tcp.state != TCP_CONNTRACK_ESTABLISHED)
+			return;
+		break;
+	case IPPROTO_UDP:
+		break;
+	default:
+		return;
+	}
+
+	if (nfct_help(ct) || ct->status & IPS_SEQ_ADJUST)
+		return;
+
+	if (test_and_set_bit(IPS_OFFLOAD_BIT, &ct->status))
+		return;
+
+	entry = flow_offload_alloc(ct);
+	if (!entry)
+		goto err_alloc;
+
+	/* the flow table does not track TCP windows */
+	if (nf_ct_protonum(ct) == IPPROTO_TCP)
+		nf_ct_set_tcp_be_liberal(ct);
+
+	if (flow_offload_add(&ct_ft->nf_ft, entry))
+		goto err_add;
+	return;
+
+err_add:
+	flow_offload_free(entry);
+err_alloc:
+	clear_bit(IPS_OFFLOAD_BIT, &ct->status);
+}
+
+int ovs_ct_flowtable_init(void)
+{
+	ovs_ct_ft_wq = alloc_workqueue("ovs_ct_ft", WQ_UNBOUND, 0);
+	return ovs_ct_ft_wq ? 0 : -ENOMEM;
+}
+
+void ovs_ct_flowtable_exit(void)
+{
+	destroy_workqueue(ovs_ct_ft_wq);
+}
+#else
+static bool ovs_ct_ft_lookup(struct ovs_ct_flowtable *ct_ft,
+			     struct sk_buff *skb, u16 family)
+{
+	return false;
+}
+
+static void ovs_ct_ft_add(struct ovs_ct_flowtable *ct_ft, struct nf_conn *ct,
+			  enum ip_conntrack_info ctinfo)
+{
+}
+
+static void ovs_ct_ft_put(struct ovs_ct_flowtable *ct_ft)
+{
+}
+
+int ovs_ct_flowtable_init(void)
+{
+	return 0;
+}
+
+void ovs_ct_flowtable_exit(void)
+{
+}
+#endif /* CONFIG_NF_FLOW_TABLE */
+
 /* Pass 'skb' through conntrack in 'net', using zone configured in 'info', if
  * not done already.  Update key with new CT state after passing the packet
  * through conntrack.
@@ -956,9 +1285,19 @@ static int __ovs_ct_lookup(struct net *net, struct sw_flow_key *key,
 	 */
 	bool cached = skb_nfct_cached(net, key, info, skb);
 	enum ip_conntrack_info ctinfo;
+	bool ft_hit = false;
 	struct nf_conn *ct;
 
-	if (!cached) {
+	/* The flow table fast path is not used where the direction of the
+	 * packet may have to replace the connection.
+	 */
+	if (!cached && info->ct_ft && !info->force)
+		ft_hit = ovs_ct_ft_lookup(info->ct_ft, skb, info->family);
+
+	if (ft_hit) {
+		key->ct_state = 0;
+		ovs_ct_update_key(skb, info, key, true, true);
+	} else if (!cached) {
 		struct nf_hook_state state = {
 			.hook = NF_INET_PRE_ROUTING,
 			.pf = info->family,
@@ -1050,6 +1389,9 @@ static int __ovs_ct_lookup(struct net *net, struct sw_flow_key *key,
 		}
 
 		nf_conn_act_ct_ext_fill(skb, ct, ctinfo);
+
+		if (info->ct_ft && !ft_hit)
+			ovs_ct_ft_add(info->ct_ft, ct, ctinfo);
 	}
 
 	return 0;
@@ -1531,10 +1873,11 @@ static const struct ovs_ct_len_tbl ovs_ct_attr_lens[OVS_CT_ATTR_MAX + 1] = {
 				    .maxlen = sizeof(u32) },
 	[OVS_CT_ATTR_TIMEOUT] = { .minlen = 1,
 				  .maxlen = CTNL_TIMEOUT_NAME_MAX },
+	[OVS_CT_ATTR_FLOWTABLE]	= { .minlen = 0, .maxlen = 0 },
 };
 
 static int parse_ct(const struct nlattr *attr, struct ovs_conntrack_info *info,
-		    const char **helper, bool log)
+		    const char **helper, bool *flowtable, bool log)
 {
 	struct nlattr *a;
 	int rem;
@@ -1625,6 +1968,11 @@ static int parse_ct(const struct nlattr *attr, struct ovs_conntrack_info *info,
 			}
 			break;
 #endif
+#if IS_ENABLED(CONFIG_NF_FLOW_TABLE)
+		case OVS_CT_ATTR_FLOWTABLE:
+			*flowtable = true;
+			break;
+#endif
 
 		default:
 			OVS_NLERR(log, "Unknown conntrack attr (%d)",
@@ -1681,6 +2029,7 @@ int ovs_ct_copy_action(struct net *net, const struct nlattr *attr,
 {
 	struct ovs_conntrack_info ct_info;
 	const char *helper = NULL;
+	bool flowtable = false;
 	u16 family;
 	int err;
 
@@ -1696,7 +2045,7 @@ int ovs_ct_copy_action(struct net *net, const struct nlattr *attr,
 	nf_ct_zone_init(&ct_info.zone, NF_CT_DEFAULT_ZONE_ID,
 			NF_CT_DEFAULT_ZONE_DIR, 0);
 
-	err = parse_ct(attr, &ct_info, &helper, log);
+	err = parse_ct(attr, &ct_info, &helper, &flowtable, log);
 	if (err)
 		return err;
 
@@ -1724,6 +2073,20 @@ int ovs_ct_copy_action(struct net *net, const struct nlattr *attr,
 			goto err_free_ct;
 	}
 
+#if IS_ENABLED(CONFIG_NF_FLOW_TABLE)
+	if (flowtable) {
+		struct ovs_ct_flowtable *ct_ft;
+
+		ct_ft = ovs_ct_ft_get(net, ct_info.zone.id);
+		if (IS_ERR(ct_ft)) {
+			OVS_NLERR(log, "Failed to get conntrack flow table");
+			err = PTR_ERR(ct_ft);
+			goto err_free_ct;
+		}
+		ct_info.ct_ft = ct_ft;
+	}
+#endif
+
 	err = ovs_nla_add_action(sfa, OVS_ACTION_ATTR_CT, &ct_info,
 				 sizeof(ct_info), log);
 	if (err)
@@ -1841,6 +2204,8 @@ int ovs_ct_action_to_attr(const struct ovs_conntrack_info *ct_info,
 		if (nla_put_string(skb, OVS_CT_ATTR_TIMEOUT, ct_info->timeout))
 			return -EMSGSIZE;
 	}
+	if (ct_info->ct_ft && nla_put_flag(skb, OVS_CT_ATTR_FLOWTABLE))
+		return -EMSGSIZE;
 
 #if IS_ENABLED(CONFIG_NF_NAT)
 	if (ct_info->nat && !ovs_ct_nat_to_attr(ct_info, skb))
@@ -1872,6 +2237,8 @@ static void __ovs_ct_free_action(struct ovs_conntrack_info *ct_info)
 			nf_ct_destroy_timeout(ct_info->ct);
 		nf_ct_tmpl_free(ct_info->ct);
 	}
+	if (ct_info->ct_ft)
+		ovs_ct_ft_put(ct_info->ct_ft);
 }
 
 #if	IS_ENABLED(CONFIG_NETFILTER_CONNCOUNT)
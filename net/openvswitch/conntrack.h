@@ -15,6 +15,8 @@ enum ovs_key_attr;
 #if IS_ENABLED(CONFIG_NF_CONNTRACK)
 int ovs_ct_init(struct net *);
 void ovs_ct_exit(struct net *);
+int ovs_ct_flowtable_init(void);
+void ovs_ct_flowtable_exit(void);
 bool ovs_ct_verify(struct net *, enum ovs_key_attr attr);
 int ovs_ct_copy_action(struct net *, const struct nlattr *,
 		       const struct sw_flow_key *, struct sw_flow_actions **,
@@ -42,6 +44,10 @@ static inline int ovs_ct_init(struct net *net) { return 0; }
 
 static inline void ovs_ct_exit(struct net *net) { }
 
+static inline int ovs_ct_flowtable_init(void) { return 0; }
+
+static inline void ovs_ct_flowtable_exit(void) { }
+
 static inline bool ovs_ct_verify(struct net *net, int attr)
 {
 	return false;
@@ -1515,6 +1515,7 @@ static size_t ovs_dp_cmd_msg_size(void)
 	msgsize += nla_total_size_64bit(sizeof(struct ovs_dp_megaflow_stats));
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_USER_FEATURES */
 	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_MASKS_CACHE_SIZE */
+	msgsize += nla_total_size(sizeof(u32)); /* OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL */
 
 	return msgsize;
 }
@@ -1556,6 +1557,10 @@ static int ovs_dp_cmd_fill_info(struct datapath *dp, struct sk_buff *skb,
 			ovs_flow_tbl_masks_cache_size(&dp->table)))
 		goto nla_put_failure;
 
+	if (nla_put_u32(skb, OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL,
+			dp->table.rebalance_interval))
+		goto nla_put_failure;
+
 	genlmsg_end(skb, ovs_header);
 	return 0;
 
@@ -1684,6 +1689,19 @@ static int ovs_dp_change(struct datapath *dp, struct nlattr *a[])
 			return err;
 	}
 
+	if (a[OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL]) {
+		struct ovs_net *ovs_net;
+		u32 interval;
+
+		interval = nla_get_u32(a[OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL]);
+		dp->table.rebalance_interval = interval;
+		dp->table.next_rebalance = jiffies + msecs_to_jiffies(interval);
+
+		/* let the rebalance work recompute its next run */
+		ovs_net = net_generic(ovs_dp_get_net(dp), ovs_net_id);
+		mod_delayed_work(system_wq, &ovs_net->masks_rebalance, 0);
+	}
+
 	dp->user_features = user_features;
 
 	if (dp->user_features & OVS_DP_F_DISPATCH_UPCALL_PER_CPU &&
@@ -1996,6 +2014,9 @@ static const struct nla_policy datapath_policy[OVS_DP_ATTR_MAX + 1] = {
 	[OVS_DP_ATTR_USER_FEATURES] = { .type = NLA_U32 },
 	[OVS_DP_ATTR_MASKS_CACHE_SIZE] =  NLA_POLICY_RANGE(NLA_U32, 0,
 		PCPU_MIN_UNIT_SIZE / sizeof(struct mask_cache_entry)),
+	[OVS_DP_ATTR_MASKS_REBALANCE_INTERVAL] = NLA_POLICY_RANGE(NLA_U32,
+		DP_MASKS_REBALANCE_INTERVAL_MIN,
+		DP_MASKS_REBALANCE_INTERVAL_MAX),
 };
 
 static const struct genl_small_ops dp_datapath_genl_ops[] = {
@@ -2457,17 +2478,26 @@ static void ovs_dp_masks_rebalance(struct work_struct *work)
 {
 	struct ovs_net *ovs_net = container_of(work, struct ovs_net,
 					       masks_rebalance.work);
+	unsigned long delay = msecs_to_jiffies(DP_MASKS_REBALANCE_INTERVAL);
+	unsigned long now = jiffies;
 	struct datapath *dp;
 
 	ovs_lock();
 
-	list_for_each_entry(dp, &ovs_net->dps, list_node)
-		ovs_flow_masks_rebalance(&dp->table);
+	list_for_each_entry(dp, &ovs_net->dps, list_node) {
+		struct flow_table *table = &dp->table;
+
+		if (time_after_eq(now, table->next_rebalance)) {
+			ovs_flow_masks_rebalance(table);
+			table->next_rebalance = now +
+				msecs_to_jiffies(table->rebalance_interval);
+		}
+		delay = min(delay, table->next_rebalance - now);
+	}
 
 	ovs_unlock();
 
-	schedule_delayed_work(&ovs_net->masks_rebalance,
-			      msecs_to_jiffies(DP_MASKS_REBALANCE_INTERVAL));
+	schedule_delayed_work(&ovs_net->masks_rebalance, delay);
 }
 
 static const struct nla_policy vport_policy[OVS_VPORT_ATTR_MAX + 1] = {
@@ -2651,10 +2681,14 @@ static int __init dp_init(void)
 	if (err)
 		goto error;
 
-	err = ovs_internal_dev_rtnl_link_register();
+	err = ovs_ct_flowtable_init();
 	if (err)
 		goto error_action_fifos_exit;
 
+	err = ovs_internal_dev_rtnl_link_register();
+	if (err)
+		goto error_ct_flowtable_exit;
+
 	err = ovs_flow_init();
 	if (err)
 		goto error_unreg_rtnl_link;
@@ -2693,6 +2727,8 @@ static int __init dp_init(void)
 	ovs_flow_exit();
 error_unreg_rtnl_link:
 	ovs_internal_dev_rtnl_link_unregister();
+error_ct_flowtable_exit:
+	ovs_ct_flowtable_exit();
 error_action_fifos_exit:
 	action_fifos_exit();
 error:
@@ -2709,6 +2745,7 @@ static void dp_cleanup(void)
 	ovs_vport_exit();
 	ovs_flow_exit();
 	ovs_internal_dev_rtnl_link_unregister();
+	ovs_ct_flowtable_exit();
 	action_fifos_exit();
 }
 
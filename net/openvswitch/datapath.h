@@ -23,6 +23,8 @@
 #define DP_MAX_PORTS                USHRT_MAX
 #define DP_VPORT_HASH_BUCKETS       1024
 #define DP_MASKS_REBALANCE_INTERVAL 4000
+#define DP_MASKS_REBALANCE_INTERVAL_MIN 100
+#define DP_MASKS_REBALANCE_INTERVAL_MAX 3600000
 
 /**
  * struct dp_stats_percpu - per-cpu packet processing statistics for a given
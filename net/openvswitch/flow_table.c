@@ -437,6 +437,9 @@ int ovs_flow_tbl_init(struct flow_table *table)
 	rcu_assign_pointer(table->mask_array, ma);
 	rcu_assign_pointer(table->mask_cache, mc);
 	table->last_rehash = jiffies;
+	table->rebalance_interval = DP_MASKS_REBALANCE_INTERVAL;
+	table->next_rebalance = jiffies +
+				msecs_to_jiffies(DP_MASKS_REBALANCE_INTERVAL);
 	table->count = 0;
 	table->ufid_count = 0;
 	return 0;
@@ -753,16 +756,25 @@ static struct sw_flow *flow_lookup(struct flow_table *tbl,
 		}
 	}
 
+	mask = ma->max ? rcu_dereference_ovsl(ma->masks[0]) : NULL;
 	for (i = 0; i < ma->max; i++)  {
+		struct sw_flow_mask *cur = mask;
+
+		/* Bring in the next mask while this one is being hashed
+		 * and its bucket walked.
+		 */
+		mask = i + 1 < ma->max ?
+		       rcu_dereference_ovsl(ma->masks[i + 1]) : NULL;
+		if (mask)
+			prefetch(mask);
 
 		if (i == *index)
 			continue;
 
-		mask = rcu_dereference_ovsl(ma->masks[i]);
-		if (unlikely(!mask))
+		if (unlikely(!cur))
 			break;
 
-		flow = masked_flow_lookup(ti, key, mask, n_mask_hit);
+		flow = masked_flow_lookup(ti, key, cur, n_mask_hit);
 		if (flow) { /* Found */
 			*index = i;
 			u64_stats_update_begin(&stats->syncp);
@@ -65,6 +65,8 @@ struct flow_table {
 	struct mask_cache __rcu *mask_cache;
 	struct mask_array __rcu *mask_array;
 	unsigned long last_rehash;
+	unsigned long next_rebalance;
+	unsigned int rebalance_interval;	/* msecs */
 	unsigned int count;
 	unsigned int ufid_count;
 };
@@ -30,6 +30,7 @@
 					 * devices
 					 */
 #define SMC_AUTOCORKING_DEFAULT_SIZE	0x10000	/* 64K by default */
+#define SMC_WND_UPDATE_RATIO_DEFAULT	10	/* % of RMB, cf. RFC7609 */
 
 extern struct proto smc_proto;
 extern struct proto smc_proto6;
@@ -106,9 +106,10 @@ static inline void smc_cdc_add_pending_send(struct smc_connection *conn,
 	pend->ctrl_seq = conn->tx_cdc_seq;
 }
 
-int smc_cdc_msg_send(struct smc_connection *conn,
-		     struct smc_wr_buf *wr_buf,
-		     struct smc_cdc_tx_pend *pend)
+static int __smc_cdc_msg_send(struct smc_connection *conn,
+			      struct smc_wr_buf *wr_buf,
+			      struct smc_rdma_wr *wr_rdma_buf,
+			      struct smc_cdc_tx_pend *pend)
 {
 	struct smc_link *link = conn->lnk;
 	union smc_host_cursor cfed;
@@ -123,7 +124,12 @@ int smc_cdc_msg_send(struct smc_connection *conn,
 	atomic_inc(&conn->cdc_pend_tx_wr);
 	smp_mb__after_atomic(); /* Make sure cdc_pend_tx_wr added before post */
 
-	rc = smc_wr_tx_send(link, (struct smc_wr_tx_pend_priv *)pend);
+	if (wr_rdma_buf)
+		rc = smc_wr_tx_send_rdma(link,
+					 (struct smc_wr_tx_pend_priv *)pend,
+					 wr_rdma_buf);
+	else
+		rc = smc_wr_tx_send(link, (struct smc_wr_tx_pend_priv *)pend);
 	if (!rc) {
 		smc_curs_copy(&conn->rx_curs_confirmed, &cfed, conn);
 		conn->local_rx_ctrl.prod_flags.cons_curs_upd_req = 0;
@@ -136,6 +142,22 @@ int smc_cdc_msg_send(struct smc_connection *conn,
 	return rc;
 }
 
+int smc_cdc_msg_send(struct smc_connection *conn,
+		     struct smc_wr_buf *wr_buf,
+		     struct smc_cdc_tx_pend *pend)
+{
+	return __smc_cdc_msg_send(conn, wr_buf, NULL, pend);
+}
+
+/* send a CDC msg preceded by the RDMA writes prepared in @wr_rdma_buf */
+int smc_cdc_msg_send_rdma(struct smc_connection *conn,
+			  struct smc_wr_buf *wr_buf,
+			  struct smc_rdma_wr *wr_rdma_buf,
+			  struct smc_cdc_tx_pend *pend)
+{
+	return __smc_cdc_msg_send(conn, wr_buf, wr_rdma_buf, pend);
+}
+
 /* send a validation msg indicating the move of a conn to an other QP link */
 int smcr_cdc_msg_send_validation(struct smc_connection *conn,
 				 struct smc_cdc_tx_pend *pend,
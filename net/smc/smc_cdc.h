@@ -294,6 +294,10 @@ int smc_cdc_get_free_slot(struct smc_connection *conn,
 void smc_cdc_wait_pend_tx_wr(struct smc_connection *conn);
 int smc_cdc_msg_send(struct smc_connection *conn, struct smc_wr_buf *wr_buf,
 		     struct smc_cdc_tx_pend *pend);
+int smc_cdc_msg_send_rdma(struct smc_connection *conn,
+			  struct smc_wr_buf *wr_buf,
+			  struct smc_rdma_wr *wr_rdma_buf,
+			  struct smc_cdc_tx_pend *pend);
 int smc_cdc_get_slot_and_msg_send(struct smc_connection *conn);
 int smcd_cdc_msg_send(struct smc_connection *conn);
 int smcr_cdc_msg_send_validation(struct smc_connection *conn,
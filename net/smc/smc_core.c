@@ -1985,11 +1985,14 @@ static struct smc_buf_desc *smc_buf_get_slot(int compressed_bufsize,
 
 /* one of the conditions for announcing a receiver's current window size is
  * that it "results in a minimum increase in the window size of 10% of the
- * receive buffer space" [RFC7609]
+ * receive buffer space" [RFC7609]; a larger ratio coalesces the CDC msgs
+ * carrying consumer cursor updates
  */
-static inline int smc_rmb_wnd_update_limit(int rmbe_size)
+static inline int smc_rmb_wnd_update_limit(struct net *net, int rmbe_size)
 {
-	return max_t(int, rmbe_size / 10, SOCK_MIN_SNDBUF / 2);
+	unsigned int ratio = READ_ONCE(net->smc.sysctl_wnd_update_ratio);
+
+	return max_t(int, rmbe_size / 100 * ratio, SOCK_MIN_SNDBUF / 2);
 }
 
 /* map an rmb buf to a link */
@@ -2279,7 +2282,8 @@ static int __smc_buf_create(struct smc_sock *smc, bool is_smcd, bool is_rmb)
 		smc->sk.sk_rcvbuf = bufsize * 2;
 		atomic_set(&conn->bytes_to_rcv, 0);
 		conn->rmbe_update_limit =
-			smc_rmb_wnd_update_limit(buf_desc->len);
+			smc_rmb_wnd_update_limit(sock_net(&smc->sk),
+						 buf_desc->len);
 		if (is_smcd)
 			smc_ism_set_conn(conn); /* map RMB/smcd_dev to conn */
 	} else {
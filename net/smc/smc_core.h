@@ -76,6 +76,9 @@ struct smc_rdma_wr {				/* work requests per message
 						 * send
 						 */
 	struct ib_rdma_wr	wr_tx_rdma[SMC_MAX_RDMA_WRITES];
+	int			num_wrs;	/* prepared, posted
+						 * ahead of the CDC msg
+						 */
 };
 
 #define SMC_LGR_ID_SIZE		4
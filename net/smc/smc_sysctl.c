@@ -17,6 +17,9 @@
 #include "smc.h"
 #include "smc_sysctl.h"
 
+static unsigned int wnd_update_ratio_min = 1;
+static unsigned int wnd_update_ratio_max = 50;
+
 static struct ctl_table smc_table[] = {
 	{
 		.procname       = "autocorking_size",
@@ -25,6 +28,15 @@ static struct ctl_table smc_table[] = {
 		.mode           = 0644,
 		.proc_handler	= proc_douintvec,
 	},
+	{
+		.procname	= "wnd_update_ratio",
+		.data		= &init_net.smc.sysctl_wnd_update_ratio,
+		.maxlen		= sizeof(unsigned int),
+		.mode		= 0644,
+		.proc_handler	= proc_douintvec_minmax,
+		.extra1		= &wnd_update_ratio_min,
+		.extra2		= &wnd_update_ratio_max,
+	},
 	{  }
 };
 
@@ -49,6 +61,7 @@ int __net_init smc_sysctl_net_init(struct net *net)
 		goto err_reg;
 
 	net->smc.sysctl_autocorking_size = SMC_AUTOCORKING_DEFAULT_SIZE;
+	net->smc.sysctl_wnd_update_ratio = SMC_WND_UPDATE_RATIO_DEFAULT;
 
 	return 0;
 
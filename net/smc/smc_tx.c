@@ -335,13 +335,14 @@ int smcd_tx_ism_write(struct smc_connection *conn, void *data, size_t len,
 	return rc;
 }
 
-/* sndbuf consumer: actual data transfer of one target chunk with RDMA write */
-static int smc_tx_rdma_write(struct smc_connection *conn, int peer_rmbe_offset,
-			     int num_sges, struct ib_rdma_wr *rdma_wr)
+/* sndbuf consumer: prepare the RDMA write of one target chunk; it is posted
+ * together with the CDC msg announcing it
+ */
+static void smc_tx_rdma_write(struct smc_connection *conn, int peer_rmbe_offset,
+			      int num_sges, struct ib_rdma_wr *rdma_wr)
 {
 	struct smc_link_group *lgr = conn->lgr;
 	struct smc_link *link = conn->lnk;
-	int rc;
 
 	rdma_wr->wr.wr_id = smc_wr_tx_get_next_wr_id(link);
 	rdma_wr->wr.num_sge = num_sges;
@@ -352,10 +353,6 @@ static int smc_tx_rdma_write(struct smc_connection *conn, int peer_rmbe_offset,
 		/* offset within RMBE */
 		peer_rmbe_offset;
 	rdma_wr->rkey = lgr->rtokens[conn->rtoken_idx][link->link_idx].rkey;
-	rc = ib_post_send(link->roce_qp, &rdma_wr->wr, NULL);
-	if (rc)
-		smcr_link_down_cond_sched(link);
-	return rc;
 }
 
 /* sndbuf consumer */
@@ -375,10 +372,10 @@ static inline void smc_tx_advance_cursors(struct smc_connection *conn,
 }
 
 /* SMC-R helper for smc_tx_rdma_writes() */
-static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
-			       size_t src_off, size_t src_len,
-			       size_t dst_off, size_t dst_len,
-			       struct smc_rdma_wr *wr_rdma_buf)
+static void smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
+				size_t src_off, size_t src_len,
+				size_t dst_off, size_t dst_len,
+				struct smc_rdma_wr *wr_rdma_buf)
 {
 	struct smc_link *link = conn->lnk;
 
@@ -388,7 +385,6 @@ static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
 	int sent_count = src_off;
 	int srcchunk, dstchunk;
 	int num_sges;
-	int rc;
 
 	for (dstchunk = 0; dstchunk < 2; dstchunk++) {
 		struct ib_rdma_wr *wr = &wr_rdma_buf->wr_tx_rdma[dstchunk];
@@ -418,9 +414,8 @@ static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
 			src_len = dst_len - src_len; /* remainder */
 			src_len_sum += src_len;
 		}
-		rc = smc_tx_rdma_write(conn, dst_off, num_sges, wr);
-		if (rc)
-			return rc;
+		smc_tx_rdma_write(conn, dst_off, num_sges, wr);
+		wr_rdma_buf->num_wrs++;
 		if (dst_len_sum == len)
 			break; /* either on 1st or 2nd iteration */
 		/* prepare next (== 2nd) iteration */
@@ -431,7 +426,6 @@ static int smcr_tx_rdma_writes(struct smc_connection *conn, size_t len,
 				sent_count);
 		src_len_sum = src_len;
 	}
-	return 0;
 }
 
 /* SMC-D helper for smc_tx_rdma_writes() */
@@ -538,14 +532,15 @@ static int smc_tx_rdma_writes(struct smc_connection *conn,
 		src_len = conn->sndbuf_desc->len - sent.count;
 	}
 
-	if (conn->lgr->is_smcd)
+	if (conn->lgr->is_smcd) {
 		rc = smcd_tx_rdma_writes(conn, len, sent.count, src_len,
 					 dst_off, dst_len);
-	else
-		rc = smcr_tx_rdma_writes(conn, len, sent.count, src_len,
-					 dst_off, dst_len, wr_rdma_buf);
-	if (rc)
-		return rc;
+		if (rc)
+			return rc;
+	} else {
+		smcr_tx_rdma_writes(conn, len, sent.count, src_len,
+				    dst_off, dst_len, wr_rdma_buf);
+	}
 
 	if (conn->urg_tx_pend && len == to_send)
 		pflags->urg_data_present = 1;
@@ -598,6 +593,7 @@ static int smcr_tx_sndbuf_nonempty(struct smc_connection *conn)
 		rc = -ENOLINK;
 		goto out_unlock;
 	}
+	wr_rdma_buf->num_wrs = 0;
 	if (!pflags->urg_data_present) {
 		rc = smc_tx_rdma_writes(conn, wr_rdma_buf);
 		if (rc) {
@@ -607,7 +603,8 @@ static int smcr_tx_sndbuf_nonempty(struct smc_connection *conn)
 		}
 	}
 
-	rc = smc_cdc_msg_send(conn, wr_buf, pend);
+	/* one post for the RDMA writes and the CDC msg announcing them */
+	rc = smc_cdc_msg_send_rdma(conn, wr_buf, wr_rdma_buf, pend);
 	if (!rc && pflags->urg_data_present) {
 		pflags->urg_data_pending = 0;
 		pflags->urg_data_present = 0;
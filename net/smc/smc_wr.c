@@ -317,6 +317,39 @@ int smc_wr_tx_send(struct smc_link *link, struct smc_wr_tx_pend_priv *priv)
 	return rc;
 }
 
+/* Post the prepared RDMA writes of @wr_rdma_buf and the send WR of @priv
+ * with a single ib_post_send(), the RDMA writes chained ahead of the send.
+ */
+int smc_wr_tx_send_rdma(struct smc_link *link, struct smc_wr_tx_pend_priv *priv,
+			struct smc_rdma_wr *wr_rdma_buf)
+{
+	struct ib_rdma_wr *rdma_wr = wr_rdma_buf->wr_tx_rdma;
+	int num_wrs = wr_rdma_buf->num_wrs;
+	struct smc_wr_tx_pend *pend;
+	int i, rc;
+
+	if (!num_wrs)
+		return smc_wr_tx_send(link, priv);
+
+	pend = container_of(priv, struct smc_wr_tx_pend, priv);
+	for (i = 0; i < num_wrs - 1; i++)
+		rdma_wr[i].wr.next = &rdma_wr[i + 1].wr;
+	rdma_wr[num_wrs - 1].wr.next = &link->wr_tx_ibs[pend->idx];
+
+	ib_req_notify_cq(link->smcibdev->roce_cq_send,
+			 IB_CQ_NEXT_COMP | IB_CQ_REPORT_MISSED_EVENTS);
+	rc = ib_post_send(link->roce_qp, &rdma_wr[0].wr, NULL);
+
+	for (i = 0; i < num_wrs; i++)
+		rdma_wr[i].wr.next = NULL;
+	wr_rdma_buf->num_wrs = 0;
+	if (rc) {
+		smc_wr_tx_put_slot(link, priv);
+		smcr_link_down_cond_sched(link);
+	}
+	return rc;
+}
+
 int smc_wr_tx_v2_send(struct smc_link *link, struct smc_wr_tx_pend_priv *priv,
 		      int len)
 {
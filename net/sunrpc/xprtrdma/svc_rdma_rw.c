@@ -50,12 +50,75 @@ svc_rdma_next_ctxt(struct list_head *list)
 					rw_list);
 }
 
+/* A few free R/W contexts are kept per CPU in front of sc_rw_ctxts,
+ * so that most get/put pairs neither take sc_rw_ctxt_lock nor bounce
+ * the list head between nfsd threads and the completion handlers.
+ */
+#define SVC_RDMA_RW_CACHE_SIZE	(8)
+
+struct svc_rdma_rw_cache {
+	unsigned int		count;
+	struct svc_rdma_rw_ctxt	*ctxts[SVC_RDMA_RW_CACHE_SIZE];
+};
+
+/**
+ * svc_rdma_rw_cache_init - Set up the per-CPU R/W context cache
+ * @rdma: transport being created
+ *
+ * The cache is optional: if it cannot be allocated, R/W contexts
+ * are only kept on sc_rw_ctxts.
+ */
+void svc_rdma_rw_cache_init(struct svcxprt_rdma *rdma)
+{
+	rdma->sc_rw_cache = alloc_percpu(struct svc_rdma_rw_cache);
+}
+
+static struct svc_rdma_rw_ctxt *
+svc_rdma_rw_cache_get(struct svcxprt_rdma *rdma)
+{
+	struct svc_rdma_rw_ctxt *ctxt = NULL;
+	struct svc_rdma_rw_cache *cache;
+
+	if (!rdma->sc_rw_cache)
+		return NULL;
+
+	local_bh_disable();
+	cache = this_cpu_ptr(rdma->sc_rw_cache);
+	if (cache->count)
+		ctxt = cache->ctxts[--cache->count];
+	local_bh_enable();
+	return ctxt;
+}
+
+static bool svc_rdma_rw_cache_put(struct svcxprt_rdma *rdma,
+				  struct svc_rdma_rw_ctxt *ctxt)
+{
+	struct svc_rdma_rw_cache *cache;
+	bool ret = false;
+
+	if (!rdma->sc_rw_cache)
+		return false;
+
+	local_bh_disable();
+	cache = this_cpu_ptr(rdma->sc_rw_cache);
+	if (cache->count < SVC_RDMA_RW_CACHE_SIZE) {
+		cache->ctxts[cache->count++] = ctxt;
+		ret = true;
+	}
+	local_bh_enable();
+	return ret;
+}
+
 static struct svc_rdma_rw_ctxt *
 svc_rdma_get_rw_ctxt(struct svcxprt_rdma *rdma, unsigned int sges)
 {
 	struct svc_rdma_rw_ctxt *ctxt;
 	struct llist_node *node;
 
+	ctxt = svc_rdma_rw_cache_get(rdma);
+	if (ctxt)
+		goto out_init;
+
 	spin_lock(&rdma->sc_rw_ctxt_lock);
 	node = llist_del_first(&rdma->sc_rw_ctxts);
 	spin_unlock(&rdma->sc_rw_ctxt_lock);
@@ -70,6 +133,7 @@ svc_rdma_get_rw_ctxt(struct svcxprt_rdma *rdma, unsigned int sges)
 		INIT_LIST_HEAD(&ctxt->rw_list);
 	}
 
+out_init:
 	ctxt->rw_sg_table.sgl = ctxt->rw_first_sgl;
 	if (sg_alloc_table_chained(&ctxt->rw_sg_table, sges,
 				   ctxt->rw_sg_table.sgl,
@@ -84,12 +148,16 @@ svc_rdma_get_rw_ctxt(struct svcxprt_rdma *rdma, unsigned int sges)
 	return NULL;
 }
 
-static void __svc_rdma_put_rw_ctxt(struct svcxprt_rdma *rdma,
+/* Returns true if @ctxt was added to @list, false if it was cached */
+static bool __svc_rdma_put_rw_ctxt(struct svcxprt_rdma *rdma,
 				   struct svc_rdma_rw_ctxt *ctxt,
 				   struct llist_head *list)
 {
 	sg_free_table_chained(&ctxt->rw_sg_table, SG_CHUNK_SIZE);
+	if (svc_rdma_rw_cache_put(rdma, ctxt))
+		return false;
 	llist_add(&ctxt->rw_node, list);
+	return true;
 }
 
 static void svc_rdma_put_rw_ctxt(struct svcxprt_rdma *rdma,
@@ -107,11 +175,24 @@ void svc_rdma_destroy_rw_ctxts(struct svcxprt_rdma *rdma)
 {
 	struct svc_rdma_rw_ctxt *ctxt;
 	struct llist_node *node;
+	int cpu;
 
 	while ((node = llist_del_first(&rdma->sc_rw_ctxts)) != NULL) {
 		ctxt = llist_entry(node, struct svc_rdma_rw_ctxt, rw_node);
 		kfree(ctxt);
 	}
+
+	if (!rdma->sc_rw_cache)
+		return;
+	for_each_possible_cpu(cpu) {
+		struct svc_rdma_rw_cache *cache;
+
+		cache = per_cpu_ptr(rdma->sc_rw_cache, cpu);
+		while (cache->count)
+			kfree(cache->ctxts[--cache->count]);
+	}
+	free_percpu(rdma->sc_rw_cache);
+	rdma->sc_rw_cache = NULL;
 }
 
 /**
@@ -198,7 +279,8 @@ static void svc_rdma_cc_release(struct svc_rdma_chunk_ctxt *cc,
 		rdma_rw_ctx_destroy(&ctxt->rw_ctx, rdma->sc_qp,
 				    rdma->sc_port_num, ctxt->rw_sg_table.sgl,
 				    ctxt->rw_nents, dir);
-		__svc_rdma_put_rw_ctxt(rdma, ctxt, &free);
+		if (!__svc_rdma_put_rw_ctxt(rdma, ctxt, &free))
+			continue;
 
 		ctxt->rw_node.next = first;
 		first = &ctxt->rw_node;
@@ -200,6 +200,8 @@ static void handle_connect_req(struct rdma_cm_id *new_cma_id,
 				       listen_xprt->sc_xprt.xpt_net);
 	if (!newxprt)
 		return;
+	/* Only connected transports move data with R/W contexts */
+	svc_rdma_rw_cache_init(newxprt);
 	newxprt->sc_cm_id = new_cma_id;
 	new_cma_id->context = newxprt;
 	svc_rdma_parse_connect_private(newxprt, param);
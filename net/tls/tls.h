@@ -0,0 +1,14 @@
+/* SPDX-License-Identifier: GPL-2.0 */
+/* Interfaces between the TLS ULP core and its software record layer
+ * that are not needed outside of net/tls.
+ */
+
+#ifndef _TLS_INT_H
+#define _TLS_INT_H
+
+#include <net/tls.h>
+
+bool tls_sw_rx_expect_no_pad(struct tls_context *tls_ctx);
+int tls_sw_set_rx_expect_no_pad(struct tls_context *tls_ctx, bool value);
+
+#endif
@@ -44,11 +44,42 @@
 #include <net/strparser.h>
 #include <net/tls.h>
 
+#include "tls.h"
+
 struct tls_decrypt_arg {
 	bool zc;
 	bool async;
+	u8 tail;
+};
+
+/* Rx context of sockets using TLS_SW, with the state that only the
+ * software record layer cares about.
+ */
+struct tls_sw_rx {
+	struct tls_sw_context_rx ctx;
+	bool expect_no_pad;
 };
 
+static struct tls_sw_rx *tls_sw_rx(struct tls_context *tls_ctx)
+{
+	return container_of(tls_sw_ctx_rx(tls_ctx), struct tls_sw_rx, ctx);
+}
+
+bool tls_sw_rx_expect_no_pad(struct tls_context *tls_ctx)
+{
+	return tls_ctx->rx_conf == TLS_SW &&
+	       READ_ONCE(tls_sw_rx(tls_ctx)->expect_no_pad);
+}
+
+int tls_sw_set_rx_expect_no_pad(struct tls_context *tls_ctx, bool value)
+{
+	if (tls_ctx->rx_conf != TLS_SW)
+		return -EINVAL;
+
+	WRITE_ONCE(tls_sw_rx(tls_ctx)->expect_no_pad, value);
+	return 0;
+}
+
 noinline void tls_err_abort(struct sock *sk, int err)
 {
 	WARN_ON_ONCE(err >= 0);
@@ -1428,9 +1459,13 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 	int iv_offset = 0;
 
 	if (darg->zc && (out_iov || out_sg)) {
+		/* The TLS 1.3 content type goes to darg->tail, it tells
+		 * whether the record could be left in the user buffer.
+		 */
 		if (out_iov)
-			n_sgout = 1 +
-				iov_iter_npages_cap(out_iov, INT_MAX, data_len);
+			n_sgout = 1 + !!prot->tail_size +
+				iov_iter_npages_cap(out_iov, INT_MAX,
+						    data_len - prot->tail_size);
 		else
 			n_sgout = sg_nents(out_sg);
 		n_sgin = skb_nsg(skb, rxm->offset + prot->prepend_size,
@@ -1519,11 +1554,19 @@ static int decrypt_internal(struct sock *sk, struct sk_buff *skb,
 			sg_init_table(sgout, n_sgout);
 			sg_set_buf(&sgout[0], aad, prot->aad_size);
 
-			err = tls_setup_from_iter(out_iov, data_len,
+			err = tls_setup_from_iter(out_iov,
+						  data_len - prot->tail_size,
 						  &pages, &sgout[1],
-						  (n_sgout - 1));
+						  n_sgout - 1 - !!prot->tail_size);
 			if (err < 0)
 				goto fallback_to_reg_recv;
+
+			if (prot->tail_size) {
+				sg_unmark_end(&sgout[pages]);
+				sg_set_buf(&sgout[pages + 1], &darg->tail,
+					   prot->tail_size);
+				sg_mark_end(&sgout[pages + 1]);
+			}
 		} else if (out_sg) {
 			memcpy(sgout, out_sg, n_sgout * sizeof(*sgout));
 		} else {
@@ -1584,10 +1627,30 @@ static int decrypt_skb_update(struct sock *sk, struct sk_buff *skb,
 	if (darg->async)
 		goto decrypt_next;
 
+	/* A TLS 1.3 record decrypted straight to user memory turned out
+	 * not to be unpadded data. The skb is still intact, so decrypt it
+	 * again in place and take the regular path. The user buffer past
+	 * the returned data may have been overwritten.
+	 */
+	if (unlikely(darg->zc && prot->tail_size &&
+		     darg->tail != TLS_RECORD_TYPE_DATA)) {
+		iov_iter_revert(dest, rxm->full_len - prot->overhead_size);
+		darg->zc = false;
+		err = decrypt_internal(sk, skb, dest, NULL, darg);
+		if (err < 0)
+			return err;
+	}
+
 decrypt_done:
-	pad = padding_length(prot, skb);
-	if (pad < 0)
-		return pad;
+	if (darg->zc && prot->tail_size) {
+		/* Content type was checked above, data has no padding */
+		tlm->control = darg->tail;
+		pad = 0;
+	} else {
+		pad = padding_length(prot, skb);
+		if (pad < 0)
+			return pad;
+	}
 
 	rxm->full_len -= pad;
 	rxm->offset += prot->prepend_size;
@@ -1767,7 +1830,8 @@ int tls_sw_recvmsg(struct sock *sk,
 	timeo = sock_rcvtimeo(sk, flags & MSG_DONTWAIT);
 
 	zc_capable = !bpf_strp_enabled && !is_kvec && !is_peek &&
-		     prot->version != TLS_1_3_VERSION;
+		     (prot->version != TLS_1_3_VERSION ||
+		      tls_sw_rx_expect_no_pad(tls_ctx));
 	decrypted = 0;
 	while (len && (decrypted + copied < target || ctx->recv_pkt)) {
 		struct tls_decrypt_arg darg = {};
@@ -2284,11 +2348,14 @@ int tls_set_sw_offload(struct sock *sk, struct tls_context *ctx, int tx)
 		}
 	} else {
 		if (!ctx->priv_ctx_rx) {
-			sw_ctx_rx = kzalloc(sizeof(*sw_ctx_rx), GFP_KERNEL);
-			if (!sw_ctx_rx) {
+			struct tls_sw_rx *sw_rx;
+
+			sw_rx = kzalloc(sizeof(*sw_rx), GFP_KERNEL);
+			if (!sw_rx) {
 				rc = -ENOMEM;
 				goto out;
 			}
+			sw_ctx_rx = &sw_rx->ctx;
 			ctx->priv_ctx_rx = sw_ctx_rx;
 		} else {
 			sw_ctx_rx =
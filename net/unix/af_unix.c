@@ -547,6 +547,7 @@ static void unix_sock_destructor(struct sock *sk)
 	struct unix_sock *u = unix_sk(sk);
 
 	skb_queue_purge(&sk->sk_receive_queue);
+	skb_queue_purge(&sk->sk_error_queue);
 
 #if IS_ENABLED(CONFIG_AF_UNIX_OOB)
 	if (u->oob_skb) {
@@ -1850,11 +1851,12 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
 	int data_len = 0;
 	int sk_locked;
 
-	wait_for_unix_gc();
 	err = scm_send(sock, msg, &scm, false);
 	if (err < 0)
 		return err;
 
+	unix_wait_for_gc(scm.fp);
+
 	err = -EOPNOTSUPP;
 	if (msg->msg_flags&MSG_OOB)
 		goto out;
@@ -2046,6 +2048,9 @@ static int unix_dgram_sendmsg(struct socket *sock, struct msghdr *msg,
  */
 #define UNIX_SKB_FRAGS_SZ (PAGE_SIZE << get_order(32768))
 
+/* Below this, pinning the sender's pages costs more than copying them. */
+#define UNIX_ZEROCOPY_MIN	(16 * 1024)
+
 #if IS_ENABLED(CONFIG_AF_UNIX_OOB)
 static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other)
 {
@@ -2093,10 +2098,50 @@ static int queue_oob(struct socket *sock, struct msghdr *msg, struct sock *other
 }
 #endif
 
+/* Build an skb that references up to @size bytes of the sender's pages
+ * instead of copying them. The pages are charged to the sender and
+ * released, completing @uarg, once the receiver consumed the skb.
+ */
+static struct sk_buff *unix_stream_zerocopy_skb(struct sock *sk,
+						struct msghdr *msg,
+						struct scm_cookie *scm,
+						bool send_fds,
+						struct ubuf_info *uarg,
+						int *size, int *err)
+{
+	struct sk_buff *skb;
+
+	skb = sock_alloc_send_pskb(sk, 0, 0, msg->msg_flags & MSG_DONTWAIT,
+				   err, 0);
+	if (!skb)
+		return NULL;
+
+	*err = unix_scm_to_skb(scm, skb, send_fds);
+	if (*err < 0)
+		goto free;
+
+	/* Charged to skb->sk rather than as TCP queued memory. */
+	*err = __zerocopy_sg_from_iter(NULL, skb, &msg->msg_iter, *size);
+	if (*err == -EFAULT || (*err == -EMSGSIZE && !skb->len)) {
+		iov_iter_revert(&msg->msg_iter, skb->len);
+		goto free;
+	}
+
+	skb_zcopy_set(skb, uarg, NULL);
+	*size = skb->len;
+	*err = 0;
+	return skb;
+
+free:
+	kfree_skb(skb);
+	return NULL;
+}
+
 static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			       size_t len)
 {
 	struct sock *sk = sock->sk;
+	struct ubuf_info *uarg = NULL;
 	struct sock *other = NULL;
 	int err, size;
 	struct sk_buff *skb;
@@ -2105,11 +2150,12 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	bool fds_sent = false;
 	int data_len;
 
-	wait_for_unix_gc();
 	err = scm_send(sock, msg, &scm, false);
 	if (err < 0)
 		return err;
 
+	unix_wait_for_gc(scm.fp);
+
 	err = -EOPNOTSUPP;
 	if (msg->msg_flags & MSG_OOB) {
 #if IS_ENABLED(CONFIG_AF_UNIX_OOB)
@@ -2133,12 +2179,33 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	if (sk->sk_shutdown & SEND_SHUTDOWN)
 		goto pipe_err;
 
+	if ((msg->msg_flags & MSG_ZEROCOPY) && len &&
+	    sock_flag(sk, SOCK_ZEROCOPY)) {
+		uarg = msg_zerocopy_realloc(sk, len, NULL);
+		if (!uarg) {
+			err = -ENOBUFS;
+			goto out_err;
+		}
+		/* Still report a completion, flagged as copied. */
+		if (len < UNIX_ZEROCOPY_MIN)
+			uarg->zerocopy = 0;
+	}
+
 	while (sent < len) {
 		size = len - sent;
 
 		/* Keep two messages in the pipe so it schedules better */
 		size = min_t(int, size, (sk->sk_sndbuf >> 1) - 64);
 
+		if (uarg && uarg->zerocopy) {
+			skb = unix_stream_zerocopy_skb(sk, msg, &scm, !fds_sent,
+						       uarg, &size, &err);
+			if (!skb)
+				goto out_err;
+			fds_sent = true;
+			goto queue;
+		}
+
 		/* allow fallback to order-0 allocations */
 		size = min_t(int, size, SKB_MAX_HEAD(0) + UNIX_SKB_FRAGS_SZ);
 
@@ -2169,6 +2236,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 			goto out_err;
 		}
 
+queue:
 		unix_state_lock(other);
 
 		if (sock_flag(other, SOCK_DEAD) ||
@@ -2192,6 +2260,7 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 	}
 #endif
 
+	net_zcopy_put(uarg);
 	scm_destroy(&scm);
 
 	return sent;
@@ -2204,6 +2273,10 @@ static int unix_stream_sendmsg(struct socket *sock, struct msghdr *msg,
 		send_sig(SIGPIPE, current, 0);
 	err = -EPIPE;
 out_err:
+	if (sent)
+		net_zcopy_put(uarg);
+	else
+		net_zcopy_put_abort(uarg, true);
 	scm_destroy(&scm);
 	return sent ? : err;
 }
@@ -2791,6 +2864,15 @@ static int unix_stream_read_generic(struct unix_stream_read_state *state,
 			sunaddr = NULL;
 		}
 
+		/* A pipe must not keep the sender's pages past their
+		 * MSG_ZEROCOPY completion, give it a private copy.
+		 */
+		if (state->pipe && skb_orphan_frags_rx(skb, GFP_KERNEL)) {
+			if (copied == 0)
+				copied = -ENOMEM;
+			break;
+		}
+
 		chunk = min_t(unsigned int, unix_skb_len(skb) - skip, size);
 		skb_get(skb);
 		chunk = state->recv_actor(skb, skip, chunk, state);
@@ -2903,11 +2985,17 @@ static int unix_stream_recvmsg(struct socket *sock, struct msghdr *msg,
 		.size = size,
 		.flags = flags
 	};
-
 #ifdef CONFIG_BPF_SYSCALL
 	struct sock *sk = sock->sk;
 	const struct proto *prot = READ_ONCE(sk->sk_prot);
+#endif
+
+	/* MSG_ZEROCOPY completions, reported like IPv4 TCP ones. */
+	if (unlikely(flags & MSG_ERRQUEUE))
+		return sock_recv_errqueue(sock->sk, msg, size, SOL_IP,
+					  IP_RECVERR);
 
+#ifdef CONFIG_BPF_SYSCALL
 	if (prot != &unix_stream_proto)
 		return prot->recvmsg(sk, msg, size, flags, NULL);
 #endif
@@ -3117,7 +3205,7 @@ static __poll_t unix_poll(struct file *file, struct socket *sock, poll_table *wa
 	mask = 0;
 
 	/* exceptional events? */
-	if (sk->sk_err)
+	if (sk->sk_err || !skb_queue_empty_lockless(&sk->sk_error_queue))
 		mask |= EPOLLERR;
 	if (sk->sk_shutdown == SHUTDOWN_MASK)
 		mask |= EPOLLHUP;
@@ -60,7 +60,7 @@ void unix_inflight(struct user_struct *user, struct file *fp)
 		} else {
 			BUG_ON(list_empty(&u->link));
 		}
-		/* Paired with READ_ONCE() in wait_for_unix_gc() */
+		/* Paired with READ_ONCE() in unix_wait_for_gc() */
 		WRITE_ONCE(unix_tot_inflight, unix_tot_inflight + 1);
 	}
 	user->unix_inflight++;
@@ -81,7 +81,7 @@ void unix_notinflight(struct user_struct *user, struct file *fp)
 
 		if (atomic_long_dec_and_test(&u->inflight))
 			list_del_init(&u->link);
-		/* Paired with READ_ONCE() in wait_for_unix_gc() */
+		/* Paired with READ_ONCE() in unix_wait_for_gc() */
 		WRITE_ONCE(unix_tot_inflight, unix_tot_inflight - 1);
 	}
 	user->unix_inflight--;
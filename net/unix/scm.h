@@ -6,5 +6,6 @@ extern spinlock_t unix_gc_lock;
 
 int unix_attach_fds(struct scm_cookie *scm, struct sk_buff *skb);
 void unix_detach_fds(struct scm_cookie *scm, struct sk_buff *skb);
+void unix_wait_for_gc(struct scm_fp_list *fpl);
 
 #endif
@@ -22,7 +22,7 @@
  */
 #define RINGBUFFER_HVS_RCV_SIZE (HV_HYP_PAGE_SIZE * 6)
 #define RINGBUFFER_HVS_SND_SIZE (HV_HYP_PAGE_SIZE * 6)
-#define RINGBUFFER_HVS_MAX_SIZE (HV_HYP_PAGE_SIZE * 64)
+#define RINGBUFFER_HVS_MAX_SIZE (HV_HYP_PAGE_SIZE * 256)
 
 /* The MTU is 16KB per the host side's design */
 #define HVS_MTU_SIZE		(1024 * 16)
@@ -66,6 +66,11 @@ struct hvs_send_buf {
 	u8 data[HVS_SEND_BUF_SIZE];
 };
 
+/* Up to this many packets are written to the ring, with a single signal to
+ * the host, in one hvs_stream_enqueue() iteration.
+ */
+#define HVS_SEND_BATCH	4
+
 #define HVS_HEADER_LEN	(sizeof(struct vmpacket_descriptor) + \
 			 sizeof(struct vmpipe_proto_header))
 
@@ -105,6 +110,13 @@ struct hvsock {
 	/* The offset of the payload */
 	u32 recv_data_off;
 
+	/* Data held back by MSG_MORE writes, to be sent with the next write.
+	 * It never exceeds hvs_channel_writable_bytes(), so it can always be
+	 * flushed: see hvs_stream_enqueue() and hvs_shutdown_lock_held().
+	 */
+	struct hvs_send_buf *send_pending;
+	u32 send_pending_len;
+
 	/* Have we sent the zero-length packet (FIN)? */
 	bool fin_sent;
 };
@@ -211,9 +223,8 @@ static int hvs_channel_readable_payload(struct vmbus_channel *chan)
 	return -1;
 }
 
-static size_t hvs_channel_writable_bytes(struct vmbus_channel *chan)
+static size_t hvs_writable_bytes(u32 writeable)
 {
-	u32 writeable = hv_get_bytes_to_write(&chan->outbound);
 	size_t ret;
 
 	/* The ringbuffer mustn't be 100% full, and we should reserve a
@@ -228,6 +239,11 @@ static size_t hvs_channel_writable_bytes(struct vmbus_channel *chan)
 	return round_down(ret, 8);
 }
 
+static size_t hvs_channel_writable_bytes(struct vmbus_channel *chan)
+{
+	return hvs_writable_bytes(hv_get_bytes_to_write(&chan->outbound));
+}
+
 static int __hvs_send_data(struct vmbus_channel *chan,
 			   struct vmpipe_proto_header *hdr,
 			   size_t to_write)
@@ -238,10 +254,17 @@ static int __hvs_send_data(struct vmbus_channel *chan,
 				0, VM_PKT_DATA_INBAND, 0);
 }
 
-static int hvs_send_data(struct vmbus_channel *chan,
-			 struct hvs_send_buf *send_buf, size_t to_write)
+static void hvs_fill_send_pkt(struct vmbus_batch_packet *pkt,
+			      struct hvs_send_buf *send_buf, size_t to_write)
 {
-	return __hvs_send_data(chan, &send_buf->hdr, to_write);
+	send_buf->hdr.pkt_type = 1;
+	send_buf->hdr.data_size = to_write;
+
+	pkt->buffer = &send_buf->hdr;
+	pkt->bufferlen = sizeof(send_buf->hdr) + to_write;
+	pkt->requestid = 0;
+	pkt->type = VM_PKT_DATA_INBAND;
+	pkt->flags = 0;
 }
 
 static void hvs_channel_cb(void *ctx)
@@ -364,7 +387,8 @@ static void hvs_open_connection(struct vmbus_channel *chan)
 	 * For the max, the socket core library will limit the socket buffer
 	 * size that can be set by the user, but, since currently, the hv_sock
 	 * VMBUS ring buffer is physically contiguous allocation, restrict it
-	 * further.
+	 * further, and fall back to the default sizes below if the bigger
+	 * rings cannot be allocated.
 	 * Older versions of hv_sock host side code cannot handle bigger VMBUS
 	 * ring buffer size. Use the version number to limit the change to newer
 	 * versions.
@@ -385,6 +409,11 @@ static void hvs_open_connection(struct vmbus_channel *chan)
 
 	ret = vmbus_open(chan, sndbuf, rcvbuf, NULL, 0, hvs_channel_cb,
 			 conn_from_host ? new : sk);
+	if (ret == -ENOMEM && (sndbuf > RINGBUFFER_HVS_SND_SIZE ||
+			       rcvbuf > RINGBUFFER_HVS_RCV_SIZE))
+		ret = vmbus_open(chan, RINGBUFFER_HVS_SND_SIZE,
+				 RINGBUFFER_HVS_RCV_SIZE, NULL, 0,
+				 hvs_channel_cb, conn_from_host ? new : sk);
 	if (ret != 0) {
 		if (conn_from_host) {
 			hvs_new->chan = NULL;
@@ -478,6 +507,13 @@ static void hvs_shutdown_lock_held(struct hvsock *hvs, int mode)
 	if (hvs->fin_sent || !hvs->chan)
 		return;
 
+	/* The data held back by MSG_MORE must go out ahead of the FIN */
+	if (hvs->send_pending_len) {
+		(void)__hvs_send_data(hvs->chan, &hvs->send_pending->hdr,
+				      hvs->send_pending_len);
+		hvs->send_pending_len = 0;
+	}
+
 	/* It can't fail: see hvs_channel_writable_bytes(). */
 	(void)__hvs_send_data(hvs->chan, &hdr, 0);
 	hvs->fin_sent = true;
@@ -548,6 +584,7 @@ static void hvs_destruct(struct vsock_sock *vsk)
 	if (chan)
 		vmbus_hvsock_device_unregister(chan);
 
+	kfree(hvs->send_pending);
 	kfree(hvs);
 }
 
@@ -606,6 +643,8 @@ static ssize_t hvs_stream_dequeue(struct vsock_sock *vsk, struct msghdr *msg,
 	struct hvsock *hvs = vsk->trans;
 	bool need_refill = !hvs->recv_desc;
 	struct hvs_recv_buf *recv_buf;
+	bool consumed = false;
+	size_t copied = 0;
 	u32 to_read;
 	int ret;
 
@@ -621,25 +660,80 @@ static ssize_t hvs_stream_dequeue(struct vsock_sock *vsk, struct msghdr *msg,
 			return ret;
 	}
 
-	recv_buf = (struct hvs_recv_buf *)(hvs->recv_desc + 1);
-	to_read = min_t(u32, len, hvs->recv_data_len);
-	ret = memcpy_to_msg(msg, recv_buf->data + hvs->recv_data_off, to_read);
-	if (ret != 0)
-		return ret;
-
-	hvs->recv_data_len -= to_read;
-	if (hvs->recv_data_len == 0) {
-		hvs->recv_desc = hv_pkt_iter_next(hvs->chan, hvs->recv_desc);
-		if (hvs->recv_desc) {
+	/* Copy from as many packets in the ring as fit in the buffer */
+	do {
+		recv_buf = (struct hvs_recv_buf *)(hvs->recv_desc + 1);
+		to_read = min_t(size_t, len - copied, hvs->recv_data_len);
+		ret = memcpy_to_msg(msg, recv_buf->data + hvs->recv_data_off,
+				    to_read);
+		if (ret != 0)
+			return copied ? copied : ret;
+
+		copied += to_read;
+		hvs->recv_data_len -= to_read;
+		if (hvs->recv_data_len == 0) {
+			consumed = true;
+			hvs->recv_desc = hv_pkt_iter_next(hvs->chan,
+							  hvs->recv_desc);
+			if (!hvs->recv_desc)
+				return copied;
 			ret = hvs_update_recv_data(hvs);
-			if (ret)
-				return ret;
+			if (ret) {
+				if (!copied)
+					return ret;
+				/* Report the bad packet on the next read */
+				hvs->recv_desc = NULL;
+				break;
+			}
+		} else {
+			hvs->recv_data_off += to_read;
 		}
-	} else {
-		hvs->recv_data_off += to_read;
+	} while (copied < len && hvs->recv_data_len);
+
+	/*
+	 * hv_pkt_iter_next() only publishes the read index when the ring is
+	 * empty. Release the consumed packets now, so that the host can refill
+	 * a big ring while the reader processes the data.
+	 */
+	if (consumed)
+		hv_pkt_iter_close(hvs->chan);
+
+	return copied;
+}
+
+/* Hold back up to @len bytes of a MSG_MORE write, or top up the data already
+ * held back, so that it goes out in one packet with the next write. Returns
+ * the number of bytes held back or a negative error.
+ */
+static ssize_t hvs_hold_send_data(struct hvsock *hvs, struct msghdr *msg,
+				  size_t len)
+{
+	ssize_t held = hvs->send_pending_len;
+	ssize_t to_write;
+	int ret;
+
+	/* Never hold back more than the ring can take right now, so that the
+	 * data can be flushed without waiting for the host.
+	 */
+	to_write = min_t(ssize_t, len, HVS_SEND_BUF_SIZE - held);
+	to_write = min_t(ssize_t, to_write,
+			 hvs_channel_writable_bytes(hvs->chan) - held);
+	if (to_write <= 0)
+		return 0;
+
+	if (!hvs->send_pending) {
+		hvs->send_pending = kmalloc(sizeof(*hvs->send_pending),
+					    GFP_KERNEL);
+		if (!hvs->send_pending)
+			return -ENOMEM;
 	}
 
-	return to_read;
+	ret = memcpy_from_msg(hvs->send_pending->data + held, msg, to_write);
+	if (ret < 0)
+		return ret;
+
+	hvs->send_pending_len += to_write;
+	return to_write;
 }
 
 static ssize_t hvs_stream_enqueue(struct vsock_sock *vsk, struct msghdr *msg,
@@ -647,46 +741,129 @@ static ssize_t hvs_stream_enqueue(struct vsock_sock *vsk, struct msghdr *msg,
 {
 	struct hvsock *hvs = vsk->trans;
 	struct vmbus_channel *chan = hvs->chan;
-	struct hvs_send_buf *send_buf;
+	struct vmbus_batch_packet pkts[HVS_SEND_BATCH];
+	bool more = msg->msg_flags & MSG_MORE;
+	struct hvs_send_buf *send_bufs = NULL;
 	ssize_t to_write, max_writable;
 	ssize_t ret = 0;
 	ssize_t bytes_written = 0;
+	size_t batch_bytes;
+	u32 nbufs, count, first, i;
+	u32 writeable;
+	int sent;
 
-	BUILD_BUG_ON(sizeof(*send_buf) != HV_HYP_PAGE_SIZE);
+	BUILD_BUG_ON(sizeof(*send_bufs) != HV_HYP_PAGE_SIZE);
 
-	send_buf = kmalloc(sizeof(*send_buf), GFP_KERNEL);
-	if (!send_buf)
-		return -ENOMEM;
+	/* Small writes flagged with MSG_MORE are coalesced into one packet and
+	 * sent with the next write without MSG_MORE, or once a packet is full.
+	 */
+	if (hvs->send_pending_len || (more && len < HVS_SEND_BUF_SIZE)) {
+		ret = hvs_hold_send_data(hvs, msg, len);
+		if (ret < 0)
+			return ret;
+		bytes_written += ret;
+		len -= ret;
+
+		if (more && !len &&
+		    hvs->send_pending_len < HVS_SEND_BUF_SIZE)
+			return bytes_written;
+	}
+
+	nbufs = min_t(size_t, DIV_ROUND_UP(len, HVS_SEND_BUF_SIZE),
+		      HVS_SEND_BATCH);
+	if (nbufs > 1)
+		send_bufs = kmalloc_array(nbufs, sizeof(*send_bufs),
+					  GFP_KERNEL | __GFP_NOWARN);
+	if (!send_bufs && nbufs) {
+		nbufs = 1;
+		send_bufs = kmalloc(sizeof(*send_bufs), GFP_KERNEL);
+		if (!send_bufs) {
+			/* Still flush the held back data below */
+			nbufs = 0;
+			ret = -ENOMEM;
+		}
+	}
 
 	/* Reader(s) could be draining data from the channel as we write.
 	 * Maximize bandwidth, by iterating until the channel is found to be
-	 * full.
+	 * full. Each iteration writes a batch of packets to the ring and
+	 * signals the host at most once.
 	 */
-	while (len) {
-		max_writable = hvs_channel_writable_bytes(chan);
-		if (!max_writable)
+	while (hvs->send_pending_len || (len && nbufs)) {
+		writeable = hv_get_bytes_to_write(&chan->outbound);
+		batch_bytes = 0;
+		count = 0;
+
+		/* It fits: see hvs_hold_send_data() */
+		if (hvs->send_pending_len) {
+			hvs_fill_send_pkt(&pkts[count++], hvs->send_pending,
+					  hvs->send_pending_len);
+			writeable -= HVS_PKT_LEN(hvs->send_pending_len);
+		}
+		first = count;
+
+		for (i = 0; i < nbufs && count < HVS_SEND_BATCH && len; i++) {
+			/* Leave a short tail to coalesce with the next write */
+			if (more && len < HVS_SEND_BUF_SIZE)
+				break;
+
+			max_writable = hvs_writable_bytes(writeable);
+			if (!max_writable)
+				break;
+			to_write = min_t(ssize_t, len, max_writable);
+			to_write = min_t(ssize_t, to_write, HVS_SEND_BUF_SIZE);
+			/* memcpy_from_msg is safe for loop as it advances the
+			 * offsets within the message iterator.
+			 */
+			ret = memcpy_from_msg(send_bufs[i].data, msg, to_write);
+			if (ret < 0)
+				break;
+
+			hvs_fill_send_pkt(&pkts[count++], &send_bufs[i],
+					  to_write);
+			writeable -= HVS_PKT_LEN(to_write);
+			batch_bytes += to_write;
+			len -= to_write;
+		}
+
+		if (!count)
 			break;
-		to_write = min_t(ssize_t, len, max_writable);
-		to_write = min_t(ssize_t, to_write, HVS_SEND_BUF_SIZE);
-		/* memcpy_from_msg is safe for loop as it advances the offsets
-		 * within the message iterator.
+
+		sent = vmbus_sendpacket_batch(chan, pkts, count);
+		if (sent < 0) {
+			ret = sent;
+			sent = 0;
+		}
+
+		/* Give the data of the packets that were not queued back to
+		 * the message. Held back data stays held back.
 		 */
-		ret = memcpy_from_msg(send_buf->data, msg, to_write);
-		if (ret < 0)
-			goto out;
+		for (i = max_t(u32, sent, first); i < count; i++) {
+			to_write = pkts[i].bufferlen -
+				   sizeof(struct vmpipe_proto_header);
+			iov_iter_revert(&msg->msg_iter, to_write);
+			batch_bytes -= to_write;
+			len += to_write;
+		}
 
-		ret = hvs_send_data(hvs->chan, send_buf, to_write);
-		if (ret < 0)
+		if (sent) {
+			hvs->send_pending_len = 0;
+			bytes_written += batch_bytes;
+		}
+		if (ret < 0 || sent < count)
 			goto out;
+	}
 
-		bytes_written += to_write;
-		len -= to_write;
+	if (more && len && len < HVS_SEND_BUF_SIZE && ret >= 0) {
+		ret = hvs_hold_send_data(hvs, msg, len);
+		if (ret > 0)
+			bytes_written += ret;
 	}
 out:
 	/* If any data has been sent, return that */
 	if (bytes_written)
 		ret = bytes_written;
-	kfree(send_buf);
+	kfree(send_bufs);
 	return ret;
 }
 
@@ -718,7 +895,8 @@ static s64 hvs_stream_has_space(struct vsock_sock *vsk)
 {
 	struct hvsock *hvs = vsk->trans;
 
-	return hvs_channel_writable_bytes(hvs->chan);
+	/* The data held back by MSG_MORE has a claim on the ring space */
+	return hvs_channel_writable_bytes(hvs->chan) - hvs->send_pending_len;
 }
 
 static u64 hvs_stream_rcvhiwat(struct vsock_sock *vsk)
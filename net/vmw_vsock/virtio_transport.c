@@ -26,6 +26,15 @@ static struct virtio_vsock __rcu *the_virtio_vsock;
 static DEFINE_MUTEX(the_virtio_vsock_mutex); /* protects the_virtio_vsock */
 static struct virtio_transport virtio_transport; /* forward declaration */
 
+/* Larger receive buffers let the host deliver bulk data in fewer, bigger
+ * packets instead of splitting it into VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE
+ * pieces, each with its own header and used ring entry.
+ */
+static unsigned int rx_buf_size = VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE;
+module_param(rx_buf_size, uint, 0444);
+MODULE_PARM_DESC(rx_buf_size,
+		 "Size of each receive buffer posted to the host (4K-64K)");
+
 struct virtio_vsock {
 	struct virtio_device *vdev;
 	struct virtqueue *vqs[VSOCK_VQ_MAX];
@@ -246,10 +255,13 @@ virtio_transport_cancel_pkt(struct vsock_sock *vsk)
 
 static void virtio_vsock_rx_fill(struct virtio_vsock *vsock)
 {
-	int buf_len = VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE;
+	int max_len = clamp_t(unsigned int, rx_buf_size,
+			      VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE,
+			      VIRTIO_VSOCK_MAX_PKT_BUF_SIZE);
 	struct virtio_vsock_pkt *pkt;
 	struct scatterlist hdr, buf, *sgs[2];
 	struct virtqueue *vq;
+	int buf_len;
 	int ret;
 
 	vq = vsock->vqs[VSOCK_VQ_RX];
@@ -259,7 +271,16 @@ static void virtio_vsock_rx_fill(struct virtio_vsock *vsock)
 		if (!pkt)
 			break;
 
-		pkt->buf = kmalloc(buf_len, GFP_KERNEL);
+		buf_len = max_len;
+		if (buf_len > VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE) {
+			pkt->buf = kmalloc(buf_len, GFP_KERNEL | __GFP_NOWARN |
+					   __GFP_NORETRY);
+			/* Fall back to the default size under fragmentation */
+			if (!pkt->buf)
+				buf_len = VIRTIO_VSOCK_DEFAULT_RX_BUF_SIZE;
+		}
+		if (!pkt->buf)
+			pkt->buf = kmalloc(buf_len, GFP_KERNEL);
 		if (!pkt->buf) {
 			virtio_transport_free_pkt(pkt);
 			break;
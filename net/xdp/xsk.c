@@ -34,12 +34,32 @@
 
 static DEFINE_PER_CPU(struct list_head, xskmap_flush_list);
 
+/* A fill ring shared with XDP_SHARED_FILL needs a wakeup as long as any
+ * of the pools drawing from it does. Only the first set and the last
+ * clear touch the flag, under the ring's lock so that a racing pair of
+ * them cannot leave it in the wrong state.
+ */
+static void xsk_shared_fq_update_need_wakeup(struct xsk_queue *src)
+{
+	spin_lock_bh(&src->lock);
+	if (atomic_read(&src->nr_need_wakeup))
+		src->ring->flags |= XDP_RING_NEED_WAKEUP;
+	else
+		src->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	spin_unlock_bh(&src->lock);
+}
+
 void xsk_set_rx_need_wakeup(struct xsk_buff_pool *pool)
 {
+	struct xsk_queue *src = pool->fq->fill_src;
+
 	if (pool->cached_need_wakeup & XDP_WAKEUP_RX)
 		return;
 
-	pool->fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+	if (!src)
+		pool->fq->ring->flags |= XDP_RING_NEED_WAKEUP;
+	else if (atomic_inc_return(&src->nr_need_wakeup) == 1)
+		xsk_shared_fq_update_need_wakeup(src);
 	pool->cached_need_wakeup |= XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_set_rx_need_wakeup);
@@ -63,10 +83,15 @@ EXPORT_SYMBOL(xsk_set_tx_need_wakeup);
 
 void xsk_clear_rx_need_wakeup(struct xsk_buff_pool *pool)
 {
+	struct xsk_queue *src = pool->fq->fill_src;
+
 	if (!(pool->cached_need_wakeup & XDP_WAKEUP_RX))
 		return;
 
-	pool->fq->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	if (!src)
+		pool->fq->ring->flags &= ~XDP_RING_NEED_WAKEUP;
+	else if (atomic_dec_and_test(&src->nr_need_wakeup))
+		xsk_shared_fq_update_need_wakeup(src);
 	pool->cached_need_wakeup &= ~XDP_WAKEUP_RX;
 }
 EXPORT_SYMBOL(xsk_clear_rx_need_wakeup);
@@ -134,14 +159,15 @@ int xsk_reg_pool_at_qid(struct net_device *dev, struct xsk_buff_pool *pool,
 	return 0;
 }
 
-static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len)
+static int __xsk_rcv_zc(struct xdp_sock *xs, struct xdp_buff *xdp, u32 len,
+			u32 flags)
 {
 	struct xdp_buff_xsk *xskb = container_of(xdp, struct xdp_buff_xsk, xdp);
 	u64 addr;
 	int err;
 
 	addr = xp_get_handle(xskb);
-	err = xskq_prod_reserve_desc(xs->rx, addr, len);
+	err = xskq_prod_reserve_desc(xs->rx, addr, len, flags);
 	if (err) {
 		xs->rx_queue_full++;
 		return err;
@@ -169,14 +195,100 @@ static void xsk_copy_xdp(struct xdp_buff *to, struct xdp_buff *from, u32 len)
 	memcpy(to_buf, from_buf, len + metalen);
 }
 
+static bool xsk_pool_sg(struct xsk_buff_pool *pool)
+{
+	return pool->umem->flags & XDP_UMEM_SG_FLAG;
+}
+
+/* Copy a frame that doesn't fit a single chunk, either because it has
+ * fragments or because its linear part is too large, into as many chunks
+ * as needed. All descriptors but the last one carry XDP_PKT_CONTD. Room in
+ * the Rx and fill rings is checked upfront, so that userspace never sees a
+ * partial packet.
+ */
+static int __xsk_rcv_mb(struct xdp_sock *xs, struct xdp_buff *xdp,
+			u32 frame_size)
+{
+	u32 total, nr_descs, copied, copy, len, metalen, src_len, frag = 0;
+	struct skb_shared_info *sinfo = NULL;
+	struct xdp_buff *xsk_xdp;
+	void *src, *dst;
+	int err;
+
+	total = xdp_get_buff_len(xdp);
+	nr_descs = DIV_ROUND_UP(total, frame_size);
+
+	if (xskq_prod_nb_free(xs->rx, nr_descs) < nr_descs) {
+		xs->rx_queue_full++;
+		return -ENOBUFS;
+	}
+
+	if (!xsk_buff_can_alloc(xs->pool, nr_descs)) {
+		xs->rx_dropped++;
+		return -ENOMEM;
+	}
+
+	if (xdp_buff_has_frags(xdp))
+		sinfo = xdp_get_shared_info_from_buff(xdp);
+
+	src = xdp->data;
+	src_len = xdp->data_end - xdp->data;
+
+	for (copied = 0; copied < total; copied += len) {
+		xsk_xdp = xsk_buff_alloc(xs->pool);
+		if (unlikely(!xsk_xdp)) {
+			xs->rx_dropped++;
+			return -ENOMEM;
+		}
+
+		if (!copied && !xdp_data_meta_unsupported(xdp)) {
+			metalen = xdp->data - xdp->data_meta;
+			memcpy(xsk_xdp->data - metalen, xdp->data_meta, metalen);
+		}
+
+		dst = xsk_xdp->data;
+		len = min(total - copied, frame_size);
+		for (copy = 0; copy < len; ) {
+			u32 n;
+
+			if (!src_len) {
+				skb_frag_t *f = &sinfo->frags[frag++];
+
+				src = skb_frag_address(f);
+				src_len = skb_frag_size(f);
+				continue;
+			}
+
+			n = min(len - copy, src_len);
+			memcpy(dst + copy, src, n);
+			copy += n;
+			src += n;
+			src_len -= n;
+		}
+
+		err = __xsk_rcv_zc(xs, xsk_xdp, len,
+				   copied + len < total ? XDP_PKT_CONTD : 0);
+		if (unlikely(err)) {
+			xsk_buff_free(xsk_xdp);
+			return err;
+		}
+	}
+
+	return 0;
+}
+
 static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 {
+	u32 frame_size = xsk_pool_get_rx_frame_size(xs->pool);
 	struct xdp_buff *xsk_xdp;
 	int err;
 	u32 len;
 
 	len = xdp->data_end - xdp->data;
-	if (len > xsk_pool_get_rx_frame_size(xs->pool)) {
+	if (unlikely(len > frame_size || xdp_buff_has_frags(xdp))) {
+		if (xsk_pool_sg(xs->pool))
+			return __xsk_rcv_mb(xs, xdp, frame_size);
+
 		xs->rx_dropped++;
 		return -ENOSPC;
 	}
@@ -188,7 +300,7 @@ static int __xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 	}
 
 	xsk_copy_xdp(xsk_xdp, xdp, len);
-	err = __xsk_rcv_zc(xs, xsk_xdp, len);
+	err = __xsk_rcv_zc(xs, xsk_xdp, len, 0);
 	if (err) {
 		xsk_buff_free(xsk_xdp);
 		return err;
@@ -258,7 +370,7 @@ static int xsk_rcv(struct xdp_sock *xs, struct xdp_buff *xdp)
 
 	if (xdp->rxq->mem.type == MEM_TYPE_XSK_BUFF_POOL) {
 		len = xdp->data_end - xdp->data;
-		return __xsk_rcv_zc(xs, xdp, len);
+		return __xsk_rcv_zc(xs, xdp, len, 0);
 	}
 
 	err = __xsk_rcv(xs, xdp);
@@ -420,15 +532,40 @@ static void xsk_destruct_skb(struct sk_buff *skb)
 	sock_wfree(skb);
 }
 
+/* Addresses to complete once an skb built from several descriptors is
+ * released, in the order they were read from the Tx ring.
+ */
+struct xsk_tx_addrs {
+	u32 nr;
+	u64 addrs[];
+};
+
+static void xsk_destruct_skb_mb(struct sk_buff *skb)
+{
+	struct xsk_tx_addrs *addrs = skb_shinfo(skb)->destructor_arg;
+	struct xdp_sock *xs = xdp_sk(skb->sk);
+	unsigned long flags;
+	u32 i;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	for (i = 0; i < addrs->nr; i++)
+		xskq_prod_submit_addr(xs->pool->cq, addrs->addrs[i]);
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+
+	kfree(addrs);
+	sock_wfree(skb);
+}
+
 static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
-					      struct xdp_desc *desc)
+					      struct xdp_desc *descs,
+					      u32 nr_descs)
 {
 	struct xsk_buff_pool *pool = xs->pool;
 	u32 hr, len, ts, offset, copy, copied;
 	struct sk_buff *skb;
 	struct page *page;
 	void *buffer;
-	int err, i;
+	int err, i, d;
 	u64 addr;
 
 	hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(xs->dev->needed_headroom));
@@ -439,87 +576,257 @@ static struct sk_buff *xsk_build_skb_zerocopy(struct xdp_sock *xs,
 
 	skb_reserve(skb, hr);
 
-	addr = desc->addr;
-	len = desc->len;
-	ts = pool->unaligned ? len : pool->chunk_size;
+	for (d = 0, i = 0; d < nr_descs; d++) {
+		addr = descs[d].addr;
+		len = descs[d].len;
+		ts = pool->unaligned ? len : pool->chunk_size;
 
-	buffer = xsk_buff_raw_get_data(pool, addr);
-	offset = offset_in_page(buffer);
-	addr = buffer - pool->addrs;
+		buffer = xsk_buff_raw_get_data(pool, addr);
+		offset = offset_in_page(buffer);
+		addr = buffer - pool->addrs;
 
-	for (copied = 0, i = 0; copied < len; i++) {
-		page = pool->umem->pgs[addr >> PAGE_SHIFT];
-		get_page(page);
+		for (copied = 0; copied < len; i++) {
+			if (unlikely(i == MAX_SKB_FRAGS)) {
+				kfree_skb(skb);
+				return ERR_PTR(-EOVERFLOW);
+			}
 
-		copy = min_t(u32, PAGE_SIZE - offset, len - copied);
-		skb_fill_page_desc(skb, i, page, offset, copy);
+			page = pool->umem->pgs[addr >> PAGE_SHIFT];
+			get_page(page);
 
-		copied += copy;
-		addr += copy;
-		offset = 0;
-	}
+			copy = min_t(u32, PAGE_SIZE - offset, len - copied);
+			skb_fill_page_desc(skb, i, page, offset, copy);
 
-	skb->len += len;
-	skb->data_len += len;
-	skb->truesize += ts;
+			copied += copy;
+			addr += copy;
+			offset = 0;
+		}
+
+		skb->len += len;
+		skb->data_len += len;
+		skb->truesize += ts;
 
-	refcount_add(ts, &xs->sk.sk_wmem_alloc);
+		refcount_add(ts, &xs->sk.sk_wmem_alloc);
+	}
 
 	return skb;
 }
 
 static struct sk_buff *xsk_build_skb(struct xdp_sock *xs,
-				     struct xdp_desc *desc)
+				     struct xdp_desc *descs, u32 nr_descs)
 {
 	struct net_device *dev = xs->dev;
+	struct xsk_tx_addrs *addrs;
 	struct sk_buff *skb;
+	u32 i;
 
 	if (dev->priv_flags & IFF_TX_SKB_NO_LINEAR) {
-		skb = xsk_build_skb_zerocopy(xs, desc);
+		skb = xsk_build_skb_zerocopy(xs, descs, nr_descs);
 		if (IS_ERR(skb))
 			return skb;
 	} else {
-		u32 hr, tr, len;
+		u32 hr, tr, len, total, offset;
 		void *buffer;
 		int err;
 
 		hr = max(NET_SKB_PAD, L1_CACHE_ALIGN(dev->needed_headroom));
 		tr = dev->needed_tailroom;
-		len = desc->len;
+		len = descs[0].len;
 
-		skb = sock_alloc_send_skb(&xs->sk, hr + len + tr, 1, &err);
+		for (i = 0, total = 0; i < nr_descs; i++)
+			total += descs[i].len;
+
+		/* The first descriptor goes to the linear part, the rest of
+		 * the packet to page fragments.
+		 */
+		skb = sock_alloc_send_pskb(&xs->sk, hr + len + tr, total - len,
+					   1, &err, 0);
 		if (unlikely(!skb))
 			return ERR_PTR(err);
 
 		skb_reserve(skb, hr);
 		skb_put(skb, len);
-
-		buffer = xsk_buff_raw_get_data(xs->pool, desc->addr);
-		err = skb_store_bits(skb, 0, buffer, len);
-		if (unlikely(err)) {
-			kfree_skb(skb);
-			return ERR_PTR(err);
+		skb->data_len = total - len;
+		skb->len += total - len;
+
+		for (i = 0, offset = 0; i < nr_descs; i++) {
+			buffer = xsk_buff_raw_get_data(xs->pool, descs[i].addr);
+			err = skb_store_bits(skb, offset, buffer, descs[i].len);
+			if (unlikely(err)) {
+				kfree_skb(skb);
+				return ERR_PTR(err);
+			}
+			offset += descs[i].len;
 		}
 	}
 
 	skb->dev = dev;
 	skb->priority = xs->sk.sk_priority;
 	skb->mark = xs->sk.sk_mark;
-	skb_shinfo(skb)->destructor_arg = (void *)(long)desc->addr;
-	skb->destructor = xsk_destruct_skb;
+
+	if (nr_descs == 1) {
+		skb_shinfo(skb)->destructor_arg = (void *)(long)descs[0].addr;
+		skb->destructor = xsk_destruct_skb;
+		return skb;
+	}
+
+	addrs = kmalloc(struct_size(addrs, addrs, nr_descs), GFP_KERNEL);
+	if (unlikely(!addrs)) {
+		kfree_skb(skb);
+		return ERR_PTR(-ENOMEM);
+	}
+
+	addrs->nr = nr_descs;
+	for (i = 0; i < nr_descs; i++)
+		addrs->addrs[i] = descs[i].addr;
+
+	skb_shinfo(skb)->destructor_arg = addrs;
+	skb->destructor = xsk_destruct_skb_mb;
 
 	return skb;
 }
 
+#define XSK_GENERIC_XMIT_BATCH	16
+
+/* An skb built from the Tx ring, or a packet that had to be dropped
+ * before reaching the driver (skb == NULL, destructor_arg kept in arg).
+ */
+struct xsk_xmit_entry {
+	struct sk_buff *skb;
+	void *arg;
+	u32 nr_descs;
+	u32 cons;
+};
+
+static void xsk_drop_unsent_skb(struct sk_buff *skb, u32 nr_descs)
+{
+	if (nr_descs > 1)
+		kfree(skb_shinfo(skb)->destructor_arg);
+	skb->destructor = sock_wfree;
+	/* Free skb without triggering the perf drop trace */
+	consume_skb(skb);
+}
+
+static void xsk_complete_dropped(struct xdp_sock *xs,
+				 struct xsk_xmit_entry *entry)
+{
+	struct xsk_tx_addrs *addrs = entry->arg;
+	unsigned long flags;
+	u32 i;
+
+	spin_lock_irqsave(&xs->pool->cq_lock, flags);
+	if (entry->nr_descs == 1) {
+		xskq_prod_submit_addr(xs->pool->cq, (u64)(long)entry->arg);
+	} else {
+		for (i = 0; i < addrs->nr; i++)
+			xskq_prod_submit_addr(xs->pool->cq, addrs->addrs[i]);
+	}
+	spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+
+	if (entry->nr_descs > 1)
+		kfree(addrs);
+}
+
+/* Run the skb through the device's software fallbacks. The completion
+ * is held back if the skb has to be dropped, as the packet may still be
+ * rewound to the Tx ring if an earlier skb of the batch is not sent.
+ */
+static bool xsk_validate_skb(struct xdp_sock *xs, struct xsk_xmit_entry *entry)
+{
+	struct sk_buff *skb = entry->skb, *nskb;
+	struct net_device *dev = xs->dev;
+	void (*destructor)(struct sk_buff *skb);
+	bool again = false;
+
+	destructor = skb->destructor;
+	entry->arg = skb_shinfo(skb)->destructor_arg;
+	skb->destructor = sock_wfree;
+
+	nskb = skb;
+	if (likely(netif_running(dev) && netif_carrier_ok(dev))) {
+		nskb = validate_xmit_skb_list(skb, dev, &again);
+		if (likely(nskb == skb)) {
+			skb->destructor = destructor;
+			skb_set_queue_mapping(skb, xs->queue_id);
+			return true;
+		}
+	}
+
+	kfree_skb_list(nskb);
+	dev_core_stats_tx_dropped_inc(dev);
+	entry->skb = NULL;
+	return false;
+}
+
+/* Hand the skbs over to the driver under a single Tx lock, letting it
+ * defer the doorbell to the last one. Returns the number of entries
+ * consumed, either sent or dropped, with the last driver status in @ret.
+ */
+static u32 xsk_direct_xmit_batch(struct xdp_sock *xs,
+				 struct xsk_xmit_entry *entries, u32 nb_entries,
+				 int *ret)
+{
+	struct net_device *dev = xs->dev;
+	struct netdev_queue *txq;
+	u32 i, nb_skbs = nb_entries;
+
+	*ret = NETDEV_TX_OK;
+	if (!entries[nb_entries - 1].skb)
+		nb_skbs--;
+
+	if (nb_skbs) {
+		txq = netdev_get_tx_queue(dev, xs->queue_id);
+
+		local_bh_disable();
+		dev_xmit_recursion_inc();
+		HARD_TX_LOCK(dev, txq, smp_processor_id());
+		for (i = 0; i < nb_skbs; i++) {
+			if (netif_xmit_frozen_or_drv_stopped(txq)) {
+				*ret = NETDEV_TX_BUSY;
+				break;
+			}
+
+			*ret = netdev_start_xmit(entries[i].skb, dev, txq,
+						 i + 1 < nb_skbs);
+			if (*ret == NETDEV_TX_BUSY)
+				break;
+			/* Ignore NET_XMIT_CN as packet might have been sent */
+			if (*ret == NET_XMIT_DROP) {
+				i++;
+				break;
+			}
+		}
+		HARD_TX_UNLOCK(dev, txq);
+		dev_xmit_recursion_dec();
+		local_bh_enable();
+
+		if (i < nb_skbs || *ret == NET_XMIT_DROP)
+			return i;
+	}
+
+	if (nb_skbs < nb_entries) {
+		xsk_complete_dropped(xs, &entries[nb_skbs]);
+		*ret = NET_XMIT_DROP;
+	}
+
+	return nb_entries;
+}
+
 static int xsk_generic_xmit(struct sock *sk)
 {
+	struct xsk_xmit_entry entries[XSK_GENERIC_XMIT_BATCH];
+	struct xdp_desc descs[XSK_TX_MAX_DESCS];
 	struct xdp_sock *xs = xdp_sk(sk);
+	u32 nb_entries, nb_sent, reserved, used, i;
 	u32 max_batch = TX_BATCH_SIZE;
+	struct xsk_xmit_entry *entry;
 	bool sent_frame = false;
-	struct xdp_desc desc;
+	bool stop = false;
 	struct sk_buff *skb;
 	unsigned long flags;
+	u32 nr_descs;
 	int err = 0;
+	int ret;
 
 	mutex_lock(&xs->mutex);
 
@@ -532,59 +839,134 @@ static int xsk_generic_xmit(struct sock *sk)
 	if (xs->queue_id >= xs->dev->real_num_tx_queues)
 		goto out;
 
-	while (xskq_cons_peek_desc(xs->tx, &desc, xs->pool)) {
-		if (max_batch-- == 0) {
-			err = -EAGAIN;
-			goto out;
-		}
+	while (!stop) {
+		nb_entries = 0;
+		reserved = 0;
+		used = 0;
 
-		/* This is the backpressure mechanism for the Tx path.
-		 * Reserve space in the completion queue and only proceed
-		 * if there is space in it. This avoids having to implement
-		 * any buffering in the Tx path.
-		 */
-		spin_lock_irqsave(&xs->pool->cq_lock, flags);
-		if (xskq_prod_reserve(xs->pool->cq)) {
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+		while (nb_entries < XSK_GENERIC_XMIT_BATCH) {
+			/* Only the first read of a batch may publish the
+			 * consumer, so that the batch can be rewound.
+			 */
+			if (nb_entries ?
+			    !xskq_cons_read_desc(xs->tx, &descs[0], xs->pool) :
+			    !xskq_cons_peek_desc(xs->tx, &descs[0], xs->pool)) {
+				if (!nb_entries) {
+					xs->tx->queue_empty_descs++;
+					stop = true;
+				}
+				break;
+			}
+
+			if (max_batch-- == 0) {
+				err = -EAGAIN;
+				stop = true;
+				break;
+			}
+
+			nr_descs = 1;
+			if (xp_mb_desc(&descs[0])) {
+				ret = xskq_cons_read_pkt_descs(xs->tx, xs->pool,
+							       descs,
+							       XSK_TX_MAX_DESCS);
+				if (ret < 0)
+					continue;
+				/* Wait for the rest of the packet. */
+				if (!ret) {
+					stop = true;
+					break;
+				}
+				nr_descs = ret;
+			}
+
+			/* This is the backpressure mechanism for the Tx path.
+			 * Reserve space in the completion queue and only proceed
+			 * if there is space in it. This avoids having to implement
+			 * any buffering in the Tx path. Space is reserved for the
+			 * rest of the batch at once to keep the lock out of the
+			 * per packet path.
+			 */
+			if (used + nr_descs > reserved) {
+				spin_lock_irqsave(&xs->pool->cq_lock, flags);
+				reserved += xskq_prod_reserve_upto(xs->pool->cq,
+					used + nr_descs - reserved +
+					XSK_GENERIC_XMIT_BATCH - nb_entries - 1);
+				spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
+				if (used + nr_descs > reserved) {
+					stop = true;
+					break;
+				}
+			}
+
+			entry = &entries[nb_entries];
+			entry->cons = xs->tx->cached_cons;
+			entry->nr_descs = nr_descs;
+
+			skb = xsk_build_skb(xs, descs, nr_descs);
+			if (IS_ERR(skb)) {
+				err = PTR_ERR(skb);
+				if (err != -EOVERFLOW) {
+					stop = true;
+					break;
+				}
+
+				/* Too many fragments, this packet can never be sent. */
+				xs->tx->invalid_descs++;
+				xskq_cons_release_n(xs->tx, nr_descs);
+				err = 0;
+				continue;
+			}
+
+			xskq_cons_release_n(xs->tx, nr_descs);
+			used += nr_descs;
+			nb_entries++;
+
+			entry->skb = skb;
+			if (!xsk_validate_skb(xs, entry))
+				break;
 		}
-		spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
 
-		skb = xsk_build_skb(xs, &desc);
-		if (IS_ERR(skb)) {
-			err = PTR_ERR(skb);
-			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
-			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			goto out;
+		nb_sent = 0;
+		if (nb_entries) {
+			nb_sent = xsk_direct_xmit_batch(xs, entries, nb_entries,
+							&ret);
+			if (nb_sent)
+				sent_frame = true;
+
+			if (nb_sent < nb_entries) {
+				/* Put the packets the driver did not take back
+				 * on the Tx ring.
+				 */
+				xs->tx->cached_cons = entries[nb_sent].cons;
+				for (i = nb_sent; i < nb_entries; i++) {
+					entry = &entries[i];
+					used -= entry->nr_descs;
+					if (entry->skb)
+						xsk_drop_unsent_skb(entry->skb,
+								    entry->nr_descs);
+					else if (entry->nr_descs > 1)
+						kfree(entry->arg);
+				}
+			}
+
+			if (ret == NETDEV_TX_BUSY) {
+				/* Tell user-space to retry the send */
+				err = -EAGAIN;
+				stop = true;
+			} else if (ret == NET_XMIT_DROP) {
+				/* SKB completed but not sent */
+				err = -EBUSY;
+				stop = true;
+			}
 		}
 
-		err = __dev_direct_xmit(skb, xs->queue_id);
-		if  (err == NETDEV_TX_BUSY) {
-			/* Tell user-space to retry the send */
-			skb->destructor = sock_wfree;
+		if (reserved > used) {
 			spin_lock_irqsave(&xs->pool->cq_lock, flags);
-			xskq_prod_cancel(xs->pool->cq);
+			xskq_prod_cancel_n(xs->pool->cq, reserved - used);
 			spin_unlock_irqrestore(&xs->pool->cq_lock, flags);
-			/* Free skb without triggering the perf drop trace */
-			consume_skb(skb);
-			err = -EAGAIN;
-			goto out;
-		}
-
-		xskq_cons_release(xs->tx);
-		/* Ignore NET_XMIT_CN as packet might have been sent */
-		if (err == NET_XMIT_DROP) {
-			/* SKB completed but not sent */
-			err = -EBUSY;
-			goto out;
 		}
-
-		sent_frame = true;
 	}
 
-	xs->tx->queue_empty_descs++;
-
 out:
 	if (sent_frame)
 		if (xsk_tx_writeable(xs))
@@ -870,6 +1252,30 @@ static bool xsk_validate_queues(struct xdp_sock *xs)
 	return xs->fq_tmp && xs->cq_tmp;
 }
 
+/* Draw the pool's frames from the fill ring @fq through a private cache,
+ * so that pools on other queues can share the same fill ring.
+ */
+static int xsk_share_fq(struct xsk_buff_pool *pool, struct xsk_queue *fq)
+{
+	struct xsk_queue *cache;
+
+	cache = xskq_create_fill_cache(fq);
+	if (!cache)
+		return -ENOMEM;
+
+	pool->fq = cache;
+	return 0;
+}
+
+static void xsk_destroy_pool(struct xdp_sock *xs)
+{
+	/* Only a fill cache belongs to the pool before the bind succeeded. */
+	if (xs->pool->fq != xs->fq_tmp)
+		xskq_destroy(xs->pool->fq);
+	xp_destroy(xs->pool);
+	xs->pool = NULL;
+}
+
 static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 {
 	struct sockaddr_xdp *sxdp = (struct sockaddr_xdp *)addr;
@@ -886,7 +1292,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 
 	flags = sxdp->sxdp_flags;
 	if (flags & ~(XDP_SHARED_UMEM | XDP_COPY | XDP_ZEROCOPY |
-		      XDP_USE_NEED_WAKEUP))
+		      XDP_USE_NEED_WAKEUP | XDP_USE_SG | XDP_SHARED_FILL))
 		return -EINVAL;
 
 	rtnl_lock();
@@ -914,7 +1320,7 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 		struct socket *sock;
 
 		if ((flags & XDP_COPY) || (flags & XDP_ZEROCOPY) ||
-		    (flags & XDP_USE_NEED_WAKEUP)) {
+		    (flags & XDP_USE_NEED_WAKEUP) || (flags & XDP_USE_SG)) {
 			/* Cannot specify flags for shared sockets. */
 			err = -EINVAL;
 			goto out_unlock;
@@ -943,6 +1349,14 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			/* Share the umem with another socket on another qid
 			 * and/or device.
 			 */
+			if ((flags & XDP_SHARED_FILL) &&
+			    (xs->fq_tmp || !umem_xs->pool->fq->fill_src)) {
+				/* The fill ring comes from the umem owner. */
+				err = -EINVAL;
+				sockfd_put(sock);
+				goto out_unlock;
+			}
+
 			xs->pool = xp_create_and_assign_umem(xs,
 							     umem_xs->umem);
 			if (!xs->pool) {
@@ -951,11 +1365,16 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 				goto out_unlock;
 			}
 
-			err = xp_assign_dev_shared(xs->pool, umem_xs->umem,
-						   dev, qid);
+			err = 0;
+			if (flags & XDP_SHARED_FILL)
+				err = xsk_share_fq(xs->pool,
+						   umem_xs->pool->fq->fill_src);
+			if (!err)
+				err = xp_assign_dev_shared(xs->pool,
+							   umem_xs->umem,
+							   dev, qid);
 			if (err) {
-				xp_destroy(xs->pool);
-				xs->pool = NULL;
+				xsk_destroy_pool(xs);
 				sockfd_put(sock);
 				goto out_unlock;
 			}
@@ -999,15 +1418,26 @@ static int xsk_bind(struct socket *sock, struct sockaddr *addr, int addr_len)
 			goto out_unlock;
 		}
 
-		err = xp_assign_dev(xs->pool, dev, qid, flags);
+		err = 0;
+		if (flags & XDP_SHARED_FILL)
+			err = xsk_share_fq(xs->pool, xs->pool->fq);
+		if (!err)
+			err = xp_assign_dev(xs->pool, dev, qid, flags);
 		if (err) {
-			xp_destroy(xs->pool);
-			xs->pool = NULL;
+			xsk_destroy_pool(xs);
 			goto out_unlock;
 		}
+
+		/* Sockets sharing this umem inherit multi-buffer support. */
+		if (flags & XDP_USE_SG)
+			xs->umem->flags |= XDP_UMEM_SG_FLAG;
 	}
 
-	/* FQ and CQ are now owned by the buffer pool and cleaned up with it. */
+	/* FQ and CQ are now owned by the buffer pool and cleaned up with it.
+	 * A fill cache holds its own reference to the fill ring.
+	 */
+	if (xs->pool->fq != xs->fq_tmp)
+		xskq_destroy(xs->fq_tmp);
 	xs->fq_tmp = NULL;
 	xs->cq_tmp = NULL;
 
@@ -1305,7 +1735,11 @@ static int xsk_mmap(struct file *file, struct socket *sock,
 	} else {
 		/* Matches the smp_wmb() in XDP_UMEM_REG */
 		smp_rmb();
-		if (offset == XDP_UMEM_PGOFF_FILL_RING)
+		/* Once bind has handed the fill ring to a pool, which may
+		 * share it with other queues through XDP_SHARED_FILL, it
+		 * can no longer be mapped.
+		 */
+		if (offset == XDP_UMEM_PGOFF_FILL_RING && !READ_ONCE(xs->pool))
 			q = READ_ONCE(xs->fq_tmp);
 		else if (offset == XDP_UMEM_PGOFF_COMPLETION_RING)
 			q = READ_ONCE(xs->cq_tmp);
@@ -11,6 +11,14 @@
 #define XSK_NEXT_PG_CONTIG_SHIFT 0
 #define XSK_NEXT_PG_CONTIG_MASK BIT_ULL(XSK_NEXT_PG_CONTIG_SHIFT)
 
+/* Kernel internal umem flag, set when the umem is bound with XDP_USE_SG.
+ * Not accepted from userspace at XDP_UMEM_REG time.
+ */
+#define XDP_UMEM_SG_FLAG (1 << 1)
+
+/* A packet spans at most one descriptor per skb fragment plus the head. */
+#define XSK_TX_MAX_DESCS (MAX_SKB_FRAGS + 1)
+
 struct xdp_ring_offset_v1 {
 	__u64 producer;
 	__u64 consumer;
@@ -178,6 +178,12 @@ int xp_assign_dev(struct xsk_buff_pool *pool,
 		/* For copy-mode, we are done. */
 		return 0;
 
+	if (flags & XDP_USE_SG) {
+		/* Drivers can't chain zero-copy descriptors yet. */
+		err = -EOPNOTSUPP;
+		goto err_unreg_pool;
+	}
+
 	if (!netdev->netdev_ops->ndo_bpf ||
 	    !netdev->netdev_ops->ndo_xsk_wakeup) {
 		err = -EOPNOTSUPP;
@@ -224,6 +230,8 @@ int xp_assign_dev_shared(struct xsk_buff_pool *pool, struct xdp_umem *umem,
 	flags = umem->zc ? XDP_ZEROCOPY : XDP_COPY;
 	if (pool->uses_need_wakeup)
 		flags |= XDP_USE_NEED_WAKEUP;
+	if (umem->flags & XDP_UMEM_SG_FLAG)
+		flags |= XDP_USE_SG;
 
 	return xp_assign_dev(pool, dev, queue_id, flags);
 }
@@ -249,6 +257,9 @@ static void xp_release_deferred(struct work_struct *work)
 	rtnl_unlock();
 
 	if (pool->fq) {
+		/* Give up this pool's share of a shared fill ring wakeup. */
+		if (pool->fq->fill_src)
+			xsk_clear_rx_need_wakeup(pool);
 		xskq_destroy(pool->fq);
 		pool->fq = NULL;
 	}
@@ -68,7 +68,7 @@ static int xsk_diag_put_umem(const struct xdp_sock *xs, struct sk_buff *nlskb)
 
 	err = nla_put(nlskb, XDP_DIAG_UMEM, sizeof(du), &du);
 	if (!err && pool && pool->fq)
-		err = xsk_diag_put_ring(pool->fq,
+		err = xsk_diag_put_ring(pool->fq->fill_src ?: pool->fq,
 					XDP_DIAG_UMEM_FILL_RING, nlskb);
 	if (!err && pool && pool->cq)
 		err = xsk_diag_put_ring(pool->cq,
@@ -10,6 +10,9 @@
 
 #include "xsk_queue.h"
 
+#define XSK_FILL_CACHE_SIZE	256
+#define XSK_FILL_CACHE_BATCH	64
+
 static size_t xskq_get_ring_size(struct xsk_queue *q, bool umem_queue)
 {
 	struct xdp_umem_ring *umem_ring;
@@ -20,6 +23,12 @@ static size_t xskq_get_ring_size(struct xsk_queue *q, bool umem_queue)
 	return struct_size(rxtx_ring, desc, q->nentries);
 }
 
+static void xskq_free(struct xsk_queue *q)
+{
+	page_frag_free(q->ring);
+	kfree(q);
+}
+
 struct xsk_queue *xskq_create(u32 nentries, bool umem_queue)
 {
 	struct xsk_queue *q;
@@ -44,14 +53,115 @@ struct xsk_queue *xskq_create(u32 nentries, bool umem_queue)
 		return NULL;
 	}
 
+	spin_lock_init(&q->lock);
+	refcount_set(&q->users, 1);
+
 	return q;
 }
 
-void xskq_destroy(struct xsk_queue *q)
+/* Create a private cache of the fill ring @src for one buffer pool. The
+ * cache is only ever seen by the kernel, which acts as both producer,
+ * when refilling it from @src, and consumer, from the same context.
+ */
+struct xsk_queue *xskq_create_fill_cache(struct xsk_queue *src)
 {
+	struct xsk_queue *q;
+
+	q = xskq_create(min_t(u32, src->nentries, XSK_FILL_CACHE_SIZE), true);
 	if (!q)
+		return NULL;
+
+	refcount_inc(&src->users);
+	q->fill_src = src;
+
+	return q;
+}
+
+/* Move up to *@nb_entries addresses left by the orphaned caches of @src
+ * into @q, producing at @prod. Returns the new producer index and
+ * lowers *@nb_entries by the number of addresses moved. Called under
+ * src->lock.
+ */
+static u32 xskq_fill_cache_adopt(struct xsk_queue *q, struct xsk_queue *src,
+				 u32 prod, u32 *nb_entries)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+	struct xdp_umem_ring *oring;
+	struct xsk_queue *orphan;
+	u32 idx;
+
+	while (*nb_entries && (orphan = src->fill_orphans)) {
+		oring = (struct xdp_umem_ring *)orphan->ring;
+		while (*nb_entries &&
+		       orphan->cached_cons != orphan->ring->producer) {
+			idx = orphan->cached_cons++ & orphan->ring_mask;
+			ring->desc[prod++ & q->ring_mask] = oring->desc[idx];
+			(*nb_entries)--;
+		}
+		if (orphan->cached_cons != orphan->ring->producer)
+			break;
+
+		src->fill_orphans = orphan->fill_orphans;
+		xskq_free(orphan);
+	}
+
+	return prod;
+}
+
+void xskq_fill_cache_refill(struct xsk_queue *q)
+{
+	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
+	struct xsk_queue *src = q->fill_src;
+	u32 prod = q->ring->producer;
+	u32 i, nb_entries;
+	u64 addr;
+
+	nb_entries = min_t(u32, q->nentries - (prod - q->cached_cons),
+			   XSK_FILL_CACHE_BATCH);
+	if (!nb_entries)
 		return;
 
-	page_frag_free(q->ring);
-	kfree(q);
+	spin_lock_bh(&src->lock);
+	if (unlikely(src->fill_orphans))
+		prod = xskq_fill_cache_adopt(q, src, prod, &nb_entries);
+
+	nb_entries = xskq_cons_nb_entries(src, nb_entries);
+	for (i = 0; i < nb_entries; i++) {
+		__xskq_cons_read_addr_unchecked(src, src->cached_cons++, &addr);
+		ring->desc[prod++ & q->ring_mask] = addr;
+	}
+	__xskq_cons_release(src);
+	spin_unlock_bh(&src->lock);
+
+	smp_store_release(&q->ring->producer, prod);
+}
+
+void xskq_destroy(struct xsk_queue *q)
+{
+	struct xsk_queue *src, *orphan;
+
+	if (!q || !refcount_dec_and_test(&q->users))
+		return;
+
+	src = q->fill_src;
+	if (src && q->ring->producer != q->cached_cons) {
+		/* Leave the addresses that the pool did not take to the
+		 * other caches of the shared fill ring. If this was the last
+		 * user of the ring, the loop below frees it again.
+		 */
+		spin_lock_bh(&src->lock);
+		q->fill_orphans = src->fill_orphans;
+		src->fill_orphans = q;
+		spin_unlock_bh(&src->lock);
+		xskq_destroy(src);
+		return;
+	}
+
+	while ((orphan = q->fill_orphans)) {
+		q->fill_orphans = orphan->fill_orphans;
+		xskq_free(orphan);
+	}
+
+	xskq_destroy(src);
+	xskq_free(q);
 }
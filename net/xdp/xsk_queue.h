@@ -8,6 +8,8 @@
 
 #include <linux/types.h>
 #include <linux/if_xdp.h>
+#include <linux/refcount.h>
+#include <linux/spinlock.h>
 #include <net/xdp_sock.h>
 #include <net/xsk_buff_pool.h>
 
@@ -45,6 +47,19 @@ struct xsk_queue {
 	struct xdp_ring *ring;
 	u64 invalid_descs;
 	u64 queue_empty_descs;
+	/* Fill ring shared with XDP_SHARED_FILL, this queue is then a
+	 * kernel private cache of it, refilled under fill_src->lock.
+	 */
+	struct xsk_queue *fill_src;
+	/* On a shared fill ring, the caches whose pool went away while they
+	 * still held addresses, linked through this same field. Refills take
+	 * from them first, so those frames are not lost to user space.
+	 */
+	struct xsk_queue *fill_orphans;
+	spinlock_t lock;
+	refcount_t users;
+	/* Pools drawing from this shared fill ring that need a wakeup. */
+	atomic_t nr_need_wakeup;
 };
 
 /* The structure of the shared state of the rings are a simple
@@ -129,6 +144,21 @@ static inline bool xskq_cons_read_addr_unchecked(struct xsk_queue *q, u64 *addr)
 	return false;
 }
 
+static inline bool xp_mb_desc(struct xdp_desc *desc)
+{
+	return desc->options & XDP_PKT_CONTD;
+}
+
+static inline bool xp_validate_desc_options(struct xsk_buff_pool *pool,
+					    struct xdp_desc *desc)
+{
+	if (likely(!desc->options))
+		return true;
+
+	return desc->options == XDP_PKT_CONTD &&
+	       (pool->umem->flags & XDP_UMEM_SG_FLAG);
+}
+
 static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 					    struct xdp_desc *desc)
 {
@@ -144,9 +174,7 @@ static inline bool xp_aligned_validate_desc(struct xsk_buff_pool *pool,
 	if (chunk >= pool->addrs_cnt)
 		return false;
 
-	if (desc->options)
-		return false;
-	return true;
+	return xp_validate_desc_options(pool, desc);
 }
 
 static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
@@ -164,9 +192,7 @@ static inline bool xp_unaligned_validate_desc(struct xsk_buff_pool *pool,
 	    xp_desc_crosses_non_contig_pg(pool, addr, desc->len))
 		return false;
 
-	if (desc->options)
-		return false;
-	return true;
+	return xp_validate_desc_options(pool, desc);
 }
 
 static inline bool xp_validate_desc(struct xsk_buff_pool *pool,
@@ -236,8 +262,13 @@ static inline void __xskq_cons_release(struct xsk_queue *q)
 	smp_store_release(&q->ring->consumer, q->cached_cons); /* D, matchees A */
 }
 
+void xskq_fill_cache_refill(struct xsk_queue *q);
+
 static inline void __xskq_cons_peek(struct xsk_queue *q)
 {
+	if (unlikely(q->fill_src))
+		xskq_fill_cache_refill(q);
+
 	/* Refresh the local pointer */
 	q->cached_prod = smp_load_acquire(&q->ring->producer);  /* C, matches B */
 }
@@ -266,6 +297,45 @@ static inline bool xskq_cons_has_entries(struct xsk_queue *q, u32 cnt)
 	return xskq_cons_nb_entries(q, cnt) >= cnt;
 }
 
+/* Read all the descriptors of a packet chained with XDP_PKT_CONTD,
+ * starting at the head of the ring. Returns the number of descriptors, 0
+ * if the last one hasn't been produced yet, or -EINVAL if any of them is
+ * invalid or the chain is too long, in which case the whole packet is
+ * consumed.
+ */
+static inline int xskq_cons_read_pkt_descs(struct xsk_queue *q,
+					   struct xsk_buff_pool *pool,
+					   struct xdp_desc *descs, u32 max)
+{
+	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
+	u32 cached_cons = q->cached_cons, nb_entries = 0;
+	struct xdp_desc desc;
+	bool valid = true;
+
+	do {
+		if (cached_cons == q->cached_prod) {
+			__xskq_cons_peek(q);
+			if (cached_cons == q->cached_prod)
+				return 0;
+		}
+
+		desc = ring->desc[cached_cons++ & q->ring_mask];
+		if (nb_entries < max && xp_validate_desc(pool, &desc))
+			descs[nb_entries] = desc;
+		else
+			valid = false;
+		nb_entries++;
+	} while (xp_mb_desc(&desc));
+
+	if (unlikely(!valid)) {
+		q->invalid_descs++;
+		q->cached_cons = cached_cons;
+		return -EINVAL;
+	}
+
+	return nb_entries;
+}
+
 static inline bool xskq_cons_peek_addr_unchecked(struct xsk_queue *q, u64 *addr)
 {
 	if (q->cached_prod == q->cached_cons)
@@ -338,6 +408,30 @@ static inline int xskq_prod_reserve(struct xsk_queue *q)
 	return 0;
 }
 
+static inline void xskq_prod_cancel_n(struct xsk_queue *q, u32 cnt)
+{
+	q->cached_prod -= cnt;
+}
+
+static inline int xskq_prod_reserve_n(struct xsk_queue *q, u32 cnt)
+{
+	if (xskq_prod_nb_free(q, cnt) < cnt)
+		return -ENOSPC;
+
+	/* A, matches D */
+	q->cached_prod += cnt;
+	return 0;
+}
+
+static inline u32 xskq_prod_reserve_upto(struct xsk_queue *q, u32 max)
+{
+	u32 cnt = xskq_prod_nb_free(q, max);
+
+	/* A, matches D */
+	q->cached_prod += cnt;
+	return cnt;
+}
+
 static inline int xskq_prod_reserve_addr(struct xsk_queue *q, u64 addr)
 {
 	struct xdp_umem_ring *ring = (struct xdp_umem_ring *)q->ring;
@@ -368,7 +462,7 @@ static inline u32 xskq_prod_reserve_addr_batch(struct xsk_queue *q, struct xdp_d
 }
 
 static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
-					 u64 addr, u32 len)
+					 u64 addr, u32 len, u32 options)
 {
 	struct xdp_rxtx_ring *ring = (struct xdp_rxtx_ring *)q->ring;
 	u32 idx;
@@ -380,6 +474,7 @@ static inline int xskq_prod_reserve_desc(struct xsk_queue *q,
 	idx = q->cached_prod++ & q->ring_mask;
 	ring->desc[idx].addr = addr;
 	ring->desc[idx].len = len;
+	ring->desc[idx].options = options;
 
 	return 0;
 }
@@ -428,6 +523,7 @@ static inline u64 xskq_nb_queue_empty_descs(struct xsk_queue *q)
 }
 
 struct xsk_queue *xskq_create(u32 nentries, bool umem_queue);
+struct xsk_queue *xskq_create_fill_cache(struct xsk_queue *src);
 void xskq_destroy(struct xsk_queue *q_ops);
 
 #endif /* _LINUX_XSK_QUEUE_H */
@@ -420,6 +420,22 @@ do {							\
 	break;						\
 } while (1)
 
+/*
+ * match_char_nodiff - single transition for dfas without diff encoding
+ *
+ * When the dfa header does not carry YYTH_FLAG_DIFF_ENCODE no state can
+ * chain through its default state (verify_dfa() rejects that), so every
+ * input character costs exactly one base/check lookup.  Dropping the retry
+ * loop lets the compiler keep the whole transition branch free, which is
+ * what dominates matching long path names.
+ */
+#define match_char_nodiff(state, def, base, next, check, C)	\
+do {								\
+	unsigned int pos = base_idx((base)[(state)]) + (C);	\
+	(state) = (check)[pos] == (state) ? (next)[pos] :	\
+					    (def)[(state)];	\
+} while (0)
+
 /**
  * aa_dfa_match_len - traverse @dfa to find state @str stops at
  * @dfa: the dfa to match @str against  (NOT NULL)
@@ -448,6 +464,21 @@ unsigned int aa_dfa_match_len(struct aa_dfa *dfa, unsigned int start,
 	if (state == 0)
 		return 0;
 
+	if (!(dfa->flags & YYTH_FLAG_DIFF_ENCODE)) {
+		if (dfa->tables[YYTD_ID_EC]) {
+			u8 *equiv = EQUIV_TABLE(dfa);
+
+			for (; len; len--)
+				match_char_nodiff(state, def, base, next,
+						  check, equiv[(u8) *str++]);
+		} else {
+			for (; len; len--)
+				match_char_nodiff(state, def, base, next,
+						  check, (u8) *str++);
+		}
+		return state;
+	}
+
 	/* current state is <state>, matching character *str */
 	if (dfa->tables[YYTD_ID_EC]) {
 		/* Equivalence class table defined */
@@ -488,6 +519,21 @@ unsigned int aa_dfa_match(struct aa_dfa *dfa, unsigned int start,
 	if (state == 0)
 		return 0;
 
+	if (!(dfa->flags & YYTH_FLAG_DIFF_ENCODE)) {
+		if (dfa->tables[YYTD_ID_EC]) {
+			u8 *equiv = EQUIV_TABLE(dfa);
+
+			while (*str)
+				match_char_nodiff(state, def, base, next,
+						  check, equiv[(u8) *str++]);
+		} else {
+			while (*str)
+				match_char_nodiff(state, def, base, next,
+						  check, (u8) *str++);
+		}
+		return state;
+	}
+
 	/* current state is <state>, matching character *str */
 	if (dfa->tables[YYTD_ID_EC]) {
 		/* Equivalence class table defined */
@@ -19,6 +19,7 @@
 #include <linux/init.h>
 #include <linux/skbuff.h>
 #include <linux/percpu.h>
+#include <linux/log2.h>
 #include <linux/list.h>
 #include <net/sock.h>
 #include <linux/un.h>
@@ -34,10 +35,19 @@
 #define CREATE_TRACE_POINTS
 #include <trace/events/avc.h>
 
-#define AVC_CACHE_SLOTS			512
-#define AVC_DEF_CACHE_THRESHOLD		512
+/*
+ * The global cache is sized at boot from the number of possible CPUs, as
+ * more CPUs mean more concurrently active domains; the default reclaim
+ * threshold follows the number of slots.
+ */
+#define AVC_MIN_CACHE_SLOTS		512
+#define AVC_MAX_CACHE_SLOTS		16384
+#define AVC_CACHE_SLOTS_PER_CPU		64
 #define AVC_CACHE_RECLAIM		16
 
+/* per-CPU front cache of recent decisions, direct mapped */
+#define AVC_PCPU_SLOTS			64
+
 #ifdef CONFIG_SECURITY_SELINUX_AVC_STATS
 #define avc_cache_stats_incr(field)	this_cpu_inc(avc_cache_stats.field)
 #else
@@ -69,13 +79,34 @@ struct avc_xperms_node {
 };
 
 struct avc_cache {
-	struct hlist_head	slots[AVC_CACHE_SLOTS]; /* head for avc_node->list */
-	spinlock_t		slots_lock[AVC_CACHE_SLOTS]; /* lock for writes */
+	struct hlist_head	*slots; /* head for avc_node->list */
+	spinlock_t		*slots_lock; /* lock for writes */
+	unsigned int		nslots;	/* power of two */
 	atomic_t		lru_hint;	/* LRU hint for reclaim scan */
 	atomic_t		active_nodes;
+	atomic_t		gen;	/* bumped when a cached decision changes */
 	u32			latest_notif;	/* latest revocation notification */
 };
 
+/*
+ * A copy of a decision taken from the global cache while avc_cache.gen was
+ * @gen; it is only used while the generation is unchanged. @seq is odd
+ * while the entry is being rewritten, which may happen from an interrupt
+ * on the same CPU.
+ */
+struct avc_pcpu_entry {
+	u32			seq;
+	u32			gen;
+	u32			ssid;
+	u32			tsid;
+	u16			tclass;
+	struct av_decision	avd;
+};
+
+struct avc_pcpu_cache {
+	struct avc_pcpu_entry	entries[AVC_PCPU_SLOTS];
+};
+
 struct avc_callback_node {
 	int (*callback) (u32 event);
 	u32 events;
@@ -89,21 +120,41 @@ DEFINE_PER_CPU(struct avc_cache_stats, avc_cache_stats) = { 0 };
 struct selinux_avc {
 	unsigned int avc_cache_threshold;
 	struct avc_cache avc_cache;
+	struct avc_pcpu_cache __percpu *pcpu;
 };
 
 static struct selinux_avc selinux_avc;
 
 void selinux_avc_init(struct selinux_avc **avc)
 {
+	struct avc_cache *cache = &selinux_avc.avc_cache;
+	unsigned int nslots;
 	int i;
 
-	selinux_avc.avc_cache_threshold = AVC_DEF_CACHE_THRESHOLD;
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
-		INIT_HLIST_HEAD(&selinux_avc.avc_cache.slots[i]);
-		spin_lock_init(&selinux_avc.avc_cache.slots_lock[i]);
+	nslots = roundup_pow_of_two(num_possible_cpus() *
+				    AVC_CACHE_SLOTS_PER_CPU);
+	nslots = clamp_t(unsigned int, nslots, AVC_MIN_CACHE_SLOTS,
+			 AVC_MAX_CACHE_SLOTS);
+
+	cache->slots = kcalloc(nslots, sizeof(*cache->slots), GFP_KERNEL);
+	cache->slots_lock = kcalloc(nslots, sizeof(*cache->slots_lock),
+				    GFP_KERNEL);
+	if (!cache->slots || !cache->slots_lock)
+		panic("SELinux: unable to allocate the AVC\n");
+	cache->nslots = nslots;
+
+	selinux_avc.avc_cache_threshold = nslots;
+	for (i = 0; i < nslots; i++) {
+		INIT_HLIST_HEAD(&cache->slots[i]);
+		spin_lock_init(&cache->slots_lock[i]);
 	}
-	atomic_set(&selinux_avc.avc_cache.active_nodes, 0);
-	atomic_set(&selinux_avc.avc_cache.lru_hint, 0);
+	atomic_set(&cache->active_nodes, 0);
+	atomic_set(&cache->lru_hint, 0);
+	/* never matches a zeroed front cache entry */
+	atomic_set(&cache->gen, 1);
+
+	/* the front cache is an optimisation, run without it if need be */
+	selinux_avc.pcpu = alloc_percpu(struct avc_pcpu_cache);
 	*avc = &selinux_avc;
 }
 
@@ -124,9 +175,91 @@ static struct kmem_cache *avc_xperms_data_cachep __ro_after_init;
 static struct kmem_cache *avc_xperms_decision_cachep __ro_after_init;
 static struct kmem_cache *avc_xperms_cachep __ro_after_init;
 
-static inline int avc_hash(u32 ssid, u32 tsid, u16 tclass)
+static inline int avc_hash(struct selinux_avc *avc,
+			   u32 ssid, u32 tsid, u16 tclass)
+{
+	return (ssid ^ (tsid<<2) ^ (tclass<<4)) &
+		(avc->avc_cache.nslots - 1);
+}
+
+static inline unsigned int avc_pcpu_hash(u32 ssid, u32 tsid, u16 tclass)
+{
+	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_PCPU_SLOTS - 1);
+}
+
+/*
+ * Sample the generation before looking at the global cache, so that any
+ * change made to it afterwards invalidates what gets copied to the front.
+ */
+static inline u32 avc_pcpu_gen(struct selinux_avc *avc)
 {
-	return (ssid ^ (tsid<<2) ^ (tclass<<4)) & (AVC_CACHE_SLOTS - 1);
+	u32 gen = atomic_read(&avc->avc_cache.gen);
+
+	smp_rmb();
+	return gen;
+}
+
+/* Called after a change to a node in the global cache is visible. */
+static inline void avc_pcpu_invalidate(struct selinux_avc *avc)
+{
+	smp_mb__before_atomic();
+	atomic_inc(&avc->avc_cache.gen);
+}
+
+static bool avc_pcpu_lookup(struct selinux_avc *avc, u32 gen,
+			    u32 ssid, u32 tsid, u16 tclass,
+			    struct av_decision *avd)
+{
+	struct avc_pcpu_cache *pc;
+	struct avc_pcpu_entry *e;
+	bool hit = false;
+	u32 seq;
+
+	if (!avc->pcpu)
+		return false;
+
+	pc = get_cpu_ptr(avc->pcpu);
+	e = &pc->entries[avc_pcpu_hash(ssid, tsid, tclass)];
+	seq = READ_ONCE(e->seq);
+	barrier();
+	if (!(seq & 1) && e->gen == gen && e->ssid == ssid &&
+	    e->tsid == tsid && e->tclass == tclass) {
+		memcpy(avd, &e->avd, sizeof(*avd));
+		barrier();
+		hit = READ_ONCE(e->seq) == seq;
+	}
+	put_cpu_ptr(avc->pcpu);
+
+	return hit;
+}
+
+static void avc_pcpu_fill(struct selinux_avc *avc, u32 gen,
+			  u32 ssid, u32 tsid, u16 tclass,
+			  struct av_decision *avd)
+{
+	struct avc_pcpu_cache *pc;
+	struct avc_pcpu_entry *e;
+	u32 seq;
+
+	if (!avc->pcpu)
+		return;
+
+	pc = get_cpu_ptr(avc->pcpu);
+	e = &pc->entries[avc_pcpu_hash(ssid, tsid, tclass)];
+	seq = READ_ONCE(e->seq);
+	/* an interrupted writer on this CPU owns the entry */
+	if (!(seq & 1)) {
+		WRITE_ONCE(e->seq, seq + 1);
+		barrier();
+		e->gen = gen;
+		e->ssid = ssid;
+		e->tsid = tsid;
+		e->tclass = tclass;
+		memcpy(&e->avd, avd, sizeof(e->avd));
+		barrier();
+		WRITE_ONCE(e->seq, seq + 2);
+	}
+	put_cpu_ptr(avc->pcpu);
 }
 
 /**
@@ -160,7 +293,7 @@ int avc_get_hash_stats(struct selinux_avc *avc, char *page)
 
 	slots_used = 0;
 	max_chain_len = 0;
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	for (i = 0; i < avc->avc_cache.nslots; i++) {
 		head = &avc->avc_cache.slots[i];
 		if (!hlist_empty(head)) {
 			slots_used++;
@@ -177,7 +310,7 @@ int avc_get_hash_stats(struct selinux_avc *avc, char *page)
 	return scnprintf(page, PAGE_SIZE, "entries: %d\nbuckets used: %d/%d\n"
 			 "longest chain: %d\n",
 			 atomic_read(&avc->avc_cache.active_nodes),
-			 slots_used, AVC_CACHE_SLOTS, max_chain_len);
+			 slots_used, avc->avc_cache.nslots, max_chain_len);
 }
 
 /*
@@ -460,6 +593,7 @@ static void avc_node_replace(struct selinux_avc *avc,
 	hlist_replace_rcu(&old->list, &new->list);
 	call_rcu(&old->rhead, avc_node_free);
 	atomic_dec(&avc->avc_cache.active_nodes);
+	avc_pcpu_invalidate(avc);
 }
 
 static inline int avc_reclaim_node(struct selinux_avc *avc)
@@ -470,9 +604,9 @@ static inline int avc_reclaim_node(struct selinux_avc *avc)
 	struct hlist_head *head;
 	spinlock_t *lock;
 
-	for (try = 0, ecx = 0; try < AVC_CACHE_SLOTS; try++) {
+	for (try = 0, ecx = 0; try < avc->avc_cache.nslots; try++) {
 		hvalue = atomic_inc_return(&avc->avc_cache.lru_hint) &
-			(AVC_CACHE_SLOTS - 1);
+			(avc->avc_cache.nslots - 1);
 		head = &avc->avc_cache.slots[hvalue];
 		lock = &avc->avc_cache.slots_lock[hvalue];
 
@@ -531,7 +665,7 @@ static inline struct avc_node *avc_search_node(struct selinux_avc *avc,
 	int hvalue;
 	struct hlist_head *head;
 
-	hvalue = avc_hash(ssid, tsid, tclass);
+	hvalue = avc_hash(avc, ssid, tsid, tclass);
 	head = &avc->avc_cache.slots[hvalue];
 	hlist_for_each_entry_rcu(node, head, list) {
 		if (ssid == node->ae.ssid &&
@@ -639,7 +773,7 @@ static struct avc_node *avc_insert(struct selinux_avc *avc,
 		return NULL;
 	}
 
-	hvalue = avc_hash(ssid, tsid, tclass);
+	hvalue = avc_hash(avc, ssid, tsid, tclass);
 	head = &avc->avc_cache.slots[hvalue];
 	lock = &avc->avc_cache.slots_lock[hvalue];
 	spin_lock_irqsave(lock, flag);
@@ -863,7 +997,7 @@ static int avc_update_node(struct selinux_avc *avc,
 	}
 
 	/* Lock the target slot */
-	hvalue = avc_hash(ssid, tsid, tclass);
+	hvalue = avc_hash(avc, ssid, tsid, tclass);
 
 	head = &avc->avc_cache.slots[hvalue];
 	lock = &avc->avc_cache.slots_lock[hvalue];
@@ -945,7 +1079,7 @@ static void avc_flush(struct selinux_avc *avc)
 	unsigned long flag;
 	int i;
 
-	for (i = 0; i < AVC_CACHE_SLOTS; i++) {
+	for (i = 0; i < avc->avc_cache.nslots; i++) {
 		head = &avc->avc_cache.slots[i];
 		lock = &avc->avc_cache.slots_lock[i];
 
@@ -960,6 +1094,7 @@ static void avc_flush(struct selinux_avc *avc)
 		rcu_read_unlock();
 		spin_unlock_irqrestore(lock, flag);
 	}
+	avc_pcpu_invalidate(avc);
 }
 
 /**
@@ -1139,22 +1274,34 @@ inline int avc_has_perm_noaudit(struct selinux_state *state,
 				unsigned int flags,
 				struct av_decision *avd)
 {
+	struct selinux_avc *avc = state->avc;
 	struct avc_node *node;
 	struct avc_xperms_node xp_node;
 	int rc = 0;
-	u32 denied;
+	u32 denied, gen;
 
 	if (WARN_ON(!requested))
 		return -EACCES;
 
 	rcu_read_lock();
 
-	node = avc_lookup(state->avc, ssid, tsid, tclass);
+	gen = avc_pcpu_gen(avc);
+	if (avc_pcpu_lookup(avc, gen, ssid, tsid, tclass, avd)) {
+		avc_cache_stats_incr(lookups);
+		goto decision;
+	}
+
+	node = avc_lookup(avc, ssid, tsid, tclass);
 	if (unlikely(!node))
-		avc_compute_av(state, ssid, tsid, tclass, avd, &xp_node);
+		node = avc_compute_av(state, ssid, tsid, tclass, avd, &xp_node);
 	else
 		memcpy(avd, &node->ae.avd, sizeof(*avd));
 
+	/* only decisions the global cache holds can be cached in front */
+	if (node)
+		avc_pcpu_fill(avc, gen, ssid, tsid, tclass, avd);
+
+decision:
 	denied = requested & ~(avd->allowed);
 	if (unlikely(denied))
 		rc = avc_denied(state, ssid, tsid, tclass, requested, 0, 0,
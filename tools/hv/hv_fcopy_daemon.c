@@ -20,11 +20,17 @@
 #include <sys/stat.h>
 #include <fcntl.h>
 #include <getopt.h>
+#include <poll.h>
+#include <sys/mman.h>
 
 static int target_fd;
 static char target_fname[PATH_MAX];
 static unsigned long long filesize;
 
+/* FCOPY_VERSION_2 only */
+static struct hv_fcopy_ring *ring;
+static int stream_error;
+
 static int hv_start_fcopy(struct hv_start_fcopy *smsg)
 {
 	int error = HV_E_FAIL;
@@ -137,6 +143,45 @@ static int hv_copy_cancel(void)
 
 }
 
+/*
+ * Write out the fragments the kernel has queued in the ring.  After a failed
+ * write the remaining fragments are dropped, the error is reported through
+ * the ring and in the reply to the next message read from the device.
+ */
+static void hv_copy_drain_ring(void)
+{
+	__u32 head, tail;
+	int error;
+
+	if (!ring)
+		return;
+
+	head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+	for (tail = ring->tail; tail != head; tail++) {
+		if (stream_error)
+			continue;
+
+		error = hv_copy_data(&ring->slots[tail % FCOPY_RING_SLOTS]);
+		if (error) {
+			stream_error = error;
+			__atomic_store_n(&ring->error, error, __ATOMIC_RELAXED);
+		}
+	}
+	__atomic_store_n(&ring->tail, tail, __ATOMIC_RELEASE);
+}
+
+static void hv_copy_reset_stream(void)
+{
+	stream_error = 0;
+	if (ring)
+		__atomic_store_n(&ring->error, 0, __ATOMIC_RELAXED);
+}
+
+static int hv_register(int fcopy_fd, int version)
+{
+	return write(fcopy_fd, &version, sizeof(int)) == sizeof(int) ? 0 : -1;
+}
+
 void print_usage(char *argv[])
 {
 	fprintf(stderr, "Usage: %s [options]\n"
@@ -150,7 +195,7 @@ int main(int argc, char *argv[])
 	int fcopy_fd = -1;
 	int error;
 	int daemonize = 1, long_index = 0, opt;
-	int version = FCOPY_CURRENT_VERSION;
+	int version = FCOPY_VERSION_2;
 	union {
 		struct hv_fcopy_hdr hdr;
 		struct hv_start_fcopy start;
@@ -187,6 +232,10 @@ int main(int argc, char *argv[])
 	syslog(LOG_INFO, "starting; pid is:%d", getpid());
 
 reopen_fcopy_fd:
+	if (ring) {
+		munmap(ring, sizeof(*ring));
+		ring = NULL;
+	}
 	if (fcopy_fd != -1)
 		close(fcopy_fd);
 	/* Remove any possible partially-copied file on error */
@@ -201,9 +250,14 @@ int main(int argc, char *argv[])
 	}
 
 	/*
-	 * Register with the kernel.
+	 * Register with the kernel, falling back to one fragment per
+	 * round trip on kernels without streaming support.
 	 */
-	if ((write(fcopy_fd, &version, sizeof(int))) != sizeof(int)) {
+	if (version == FCOPY_VERSION_2 && hv_register(fcopy_fd, version)) {
+		syslog(LOG_INFO, "streaming not supported: %s", strerror(errno));
+		version = FCOPY_VERSION_1;
+	}
+	if (version != FCOPY_VERSION_2 && hv_register(fcopy_fd, version)) {
 		syslog(LOG_ERR, "Registration failed: %s", strerror(errno));
 		exit(EXIT_FAILURE);
 	}
@@ -215,7 +269,24 @@ int main(int argc, char *argv[])
 		 */
 		ssize_t len;
 
+		if (ring) {
+			struct pollfd pfd = {
+				.fd	= fcopy_fd,
+				.events	= POLLIN,
+			};
+
+			if (poll(&pfd, 1, -1) < 0 && errno != EINTR) {
+				syslog(LOG_ERR, "poll failed: %s",
+				       strerror(errno));
+				goto reopen_fcopy_fd;
+			}
+			/* Everything queued before a message comes first. */
+			hv_copy_drain_ring();
+		}
+
 		len = pread(fcopy_fd, &buffer, sizeof(buffer), 0);
+		if (len < 0 && ring && (errno == EAGAIN || errno == EINTR))
+			continue;
 		if (len < 0) {
 			syslog(LOG_ERR, "pread failed: %s", strerror(errno));
 			goto reopen_fcopy_fd;
@@ -229,21 +300,36 @@ int main(int argc, char *argv[])
 			in_handshake = 0;
 			syslog(LOG_INFO, "kernel module version: %u",
 			       buffer.kernel_modver);
+
+			if (version == FCOPY_VERSION_2) {
+				ring = mmap(NULL, sizeof(*ring),
+					    PROT_READ | PROT_WRITE, MAP_SHARED,
+					    fcopy_fd, 0);
+				if (ring == MAP_FAILED) {
+					syslog(LOG_ERR, "mmap failed: %s",
+					       strerror(errno));
+					exit(EXIT_FAILURE);
+				}
+				fcntl(fcopy_fd, F_SETFL, O_NONBLOCK);
+			}
 			continue;
 		}
 
 		switch (buffer.hdr.operation) {
 		case START_FILE_COPY:
+			hv_copy_reset_stream();
 			error = hv_start_fcopy(&buffer.start);
 			break;
 		case WRITE_TO_FILE:
-			error = hv_copy_data(&buffer.copy);
+			error = stream_error ? : hv_copy_data(&buffer.copy);
 			break;
 		case COMPLETE_FCOPY:
 			error = hv_copy_finished();
+			error = stream_error ? : error;
 			break;
 		case CANCEL_FCOPY:
 			error = hv_copy_cancel();
+			hv_copy_reset_stream();
 			break;
 
 		default:
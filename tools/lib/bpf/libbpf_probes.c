@@ -301,6 +301,7 @@ static int probe_map_create(enum bpf_map_type map_type, __u32 ifindex)
 		max_entries = 1;
 		break;
 	case BPF_MAP_TYPE_HASH:
+	case BPF_MAP_TYPE_RHASH:
 	case BPF_MAP_TYPE_ARRAY:
 	case BPF_MAP_TYPE_PROG_ARRAY:
 	case BPF_MAP_TYPE_PERF_EVENT_ARRAY:
@@ -29,6 +29,10 @@ struct ring {
 	unsigned long *producer_pos;
 	unsigned long mask;
 	int map_fd;
+	/* number of rings of map_fd starting with this one, which are
+	 * processed together when map_fd polls readable
+	 */
+	int nr_rings;
 };
 
 struct ring_buffer {
@@ -51,14 +55,52 @@ static void ringbuf_unmap_ring(struct ring_buffer *rb, struct ring *r)
 	}
 }
 
+static int ringbuf_map_ring(struct ring_buffer *rb, struct ring *r, off_t off)
+{
+	void *tmp;
+	int err;
+
+	/* Map writable consumer page */
+	tmp = mmap(NULL, rb->page_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+		   r->map_fd, off);
+	if (tmp == MAP_FAILED) {
+		err = -errno;
+		pr_warn("ringbuf: failed to mmap consumer page for map fd=%d: %d\n",
+			r->map_fd, err);
+		return err;
+	}
+	r->consumer_pos = tmp;
+
+	/* Map read-only producer page and data pages. We map twice as big
+	 * data size to allow simple reading of samples that wrap around the
+	 * end of a ring buffer. See kernel implementation for details.
+	 * */
+	tmp = mmap(NULL, rb->page_size + 2 * (r->mask + 1), PROT_READ,
+		   MAP_SHARED, r->map_fd, off + rb->page_size);
+	if (tmp == MAP_FAILED) {
+		err = -errno;
+		ringbuf_unmap_ring(rb, r);
+		pr_warn("ringbuf: failed to mmap data pages for map fd=%d: %d\n",
+			r->map_fd, err);
+		return err;
+	}
+	r->producer_pos = tmp;
+	r->data = tmp + rb->page_size;
+
+	return 0;
+}
+
 /* Add extra RINGBUF maps to this ring buffer manager */
 int ring_buffer__add(struct ring_buffer *rb, int map_fd,
 		     ring_buffer_sample_fn sample_cb, void *ctx)
 {
+	int i, nr_cpus = 1, nr_rings = 0, first = rb->ring_cnt;
 	struct bpf_map_info info;
 	__u32 len = sizeof(info);
 	struct epoll_event *e;
+	bool *cpus = NULL;
 	struct ring *r;
+	off_t stride;
 	void *tmp;
 	int err;
 
@@ -78,66 +120,73 @@ int ring_buffer__add(struct ring_buffer *rb, int map_fd,
 		return libbpf_err(-EINVAL);
 	}
 
-	tmp = libbpf_reallocarray(rb->rings, rb->ring_cnt + 1, sizeof(*rb->rings));
-	if (!tmp)
-		return libbpf_err(-ENOMEM);
+	/* per-CPU ring buffer maps hold one ring per possible CPU, all
+	 * consumed through the same map fd
+	 */
+	if (info.map_flags & BPF_F_RINGBUF_PERCPU) {
+		err = parse_cpu_mask_file("/sys/devices/system/cpu/possible",
+					  &cpus, &nr_cpus);
+		if (err)
+			return libbpf_err(err);
+	}
+
+	tmp = libbpf_reallocarray(rb->rings, rb->ring_cnt + nr_cpus, sizeof(*rb->rings));
+	if (!tmp) {
+		err = -ENOMEM;
+		goto err_out;
+	}
 	rb->rings = tmp;
 
-	tmp = libbpf_reallocarray(rb->events, rb->ring_cnt + 1, sizeof(*rb->events));
-	if (!tmp)
-		return libbpf_err(-ENOMEM);
+	tmp = libbpf_reallocarray(rb->events, rb->ring_cnt + nr_cpus, sizeof(*rb->events));
+	if (!tmp) {
+		err = -ENOMEM;
+		goto err_out;
+	}
 	rb->events = tmp;
 
-	r = &rb->rings[rb->ring_cnt];
-	memset(r, 0, sizeof(*r));
+	/* consumer page, producer page and double-mapped data of each ring */
+	stride = 2 * rb->page_size + 2 * (off_t)info.max_entries;
+	for (i = 0; i < nr_cpus; i++) {
+		if (cpus && !cpus[i])
+			continue;
 
-	r->map_fd = map_fd;
-	r->sample_cb = sample_cb;
-	r->ctx = ctx;
-	r->mask = info.max_entries - 1;
+		r = &rb->rings[first + nr_rings];
+		memset(r, 0, sizeof(*r));
 
-	/* Map writable consumer page */
-	tmp = mmap(NULL, rb->page_size, PROT_READ | PROT_WRITE, MAP_SHARED,
-		   map_fd, 0);
-	if (tmp == MAP_FAILED) {
-		err = -errno;
-		pr_warn("ringbuf: failed to mmap consumer page for map fd=%d: %d\n",
-			map_fd, err);
-		return libbpf_err(err);
-	}
-	r->consumer_pos = tmp;
+		r->map_fd = map_fd;
+		r->sample_cb = sample_cb;
+		r->ctx = ctx;
+		r->mask = info.max_entries - 1;
 
-	/* Map read-only producer page and data pages. We map twice as big
-	 * data size to allow simple reading of samples that wrap around the
-	 * end of a ring buffer. See kernel implementation for details.
-	 * */
-	tmp = mmap(NULL, rb->page_size + 2 * info.max_entries, PROT_READ,
-		   MAP_SHARED, map_fd, rb->page_size);
-	if (tmp == MAP_FAILED) {
-		err = -errno;
-		ringbuf_unmap_ring(rb, r);
-		pr_warn("ringbuf: failed to mmap data pages for map fd=%d: %d\n",
-			map_fd, err);
-		return libbpf_err(err);
+		err = ringbuf_map_ring(rb, r, i * stride);
+		if (err)
+			goto err_unmap;
+		nr_rings++;
 	}
-	r->producer_pos = tmp;
-	r->data = tmp + rb->page_size;
+	rb->rings[first].nr_rings = nr_rings;
 
 	e = &rb->events[rb->ring_cnt];
 	memset(e, 0, sizeof(*e));
 
 	e->events = EPOLLIN;
-	e->data.fd = rb->ring_cnt;
+	e->data.fd = first;
 	if (epoll_ctl(rb->epoll_fd, EPOLL_CTL_ADD, map_fd, e) < 0) {
 		err = -errno;
-		ringbuf_unmap_ring(rb, r);
 		pr_warn("ringbuf: failed to epoll add map fd=%d: %d\n",
 			map_fd, err);
-		return libbpf_err(err);
+		goto err_unmap;
 	}
 
-	rb->ring_cnt++;
+	rb->ring_cnt += nr_rings;
+	free(cpus);
 	return 0;
+
+err_unmap:
+	for (i = 0; i < nr_rings; i++)
+		ringbuf_unmap_ring(rb, &rb->rings[first + i]);
+err_out:
+	free(cpus);
+	return libbpf_err(err);
 }
 
 void ring_buffer__free(struct ring_buffer *rb)
@@ -284,11 +333,14 @@ int ring_buffer__poll(struct ring_buffer *rb, int timeout_ms)
 	for (i = 0; i < cnt; i++) {
 		__u32 ring_id = rb->events[i].data.fd;
 		struct ring *ring = &rb->rings[ring_id];
+		int j;
 
-		err = ringbuf_process_ring(ring);
-		if (err < 0)
-			return libbpf_err(err);
-		res += err;
+		for (j = 0; j < ring->nr_rings; j++) {
+			err = ringbuf_process_ring(&ring[j]);
+			if (err < 0)
+				return libbpf_err(err);
+			res += err;
+		}
 	}
 	if (res > INT_MAX)
 		return INT_MAX;
@@ -51,6 +51,10 @@ int bench_inject_build_id(int argc, const char **argv);
 int bench_evlist_open_close(int argc, const char **argv);
 int bench_breakpoint_thread(int argc, const char **argv);
 int bench_breakpoint_enable(int argc, const char **argv);
+int bench_virt_vsock_lat(int argc, const char **argv);
+int bench_virt_vsock_bw(int argc, const char **argv);
+int bench_virt_dxg(int argc, const char **argv);
+int bench_virt_fsmeta(int argc, const char **argv);
 
 #define BENCH_FORMAT_DEFAULT_STR	"default"
 #define BENCH_FORMAT_DEFAULT		0
@@ -0,0 +1,189 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * virt-dxg.c
+ *
+ * dxg: round trip cost of /dev/dxg (dxgkrnl) ioctls
+ *
+ * Two ioctls are timed: LX_DXENUMADAPTERS3 querying the adapter count,
+ * which the guest driver answers from its own adapter list, and
+ * LX_DXQUERYADAPTERINFO, which is forwarded to the host over the
+ * adapter's VMBus channel and so measures a full ring buffer
+ * request/response.
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+#include "../util/stat.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/time.h>
+#include <linux/time64.h>
+#include <linux/types.h>
+
+/*
+ * The few definitions needed from include/uapi/misc/d3dkmthk.h, which is
+ * not part of the tools uapi headers.
+ */
+struct dxg_adapterinfo {
+	__u32	adapter_handle;
+	__u32	luid_a;
+	__u32	luid_b;
+	__u32	num_sources;
+	__u32	present_move_regions_preferred;
+};
+
+struct dxg_enumadapters3 {
+	__u64	filter;
+	__u32	adapter_count;
+	__u32	reserved;
+	__u64	adapters;
+};
+
+struct dxg_queryadapterinfo {
+	__u32	adapter;
+	__u32	type;
+	__u64	private_data;
+	__u32	private_data_size;
+};
+
+#define DXG_QAITYPE_ADAPTERTYPE	15
+#define DXG_MAX_ADAPTERS	16
+
+#define LX_DXQUERYADAPTERINFO	_IOWR(0x47, 0x09, struct dxg_queryadapterinfo)
+#define LX_DXENUMADAPTERS3	_IOWR(0x47, 0x3e, struct dxg_enumadapters3)
+
+#define LOOPS_DEFAULT		100000
+
+static unsigned int	loops = LOOPS_DEFAULT;
+static const char	*dev_path = "/dev/dxg";
+
+static const struct option options[] = {
+	OPT_UINTEGER('l', "loop",	&loops,		"Specify number of loops"),
+	OPT_STRING('d', "device",	&dev_path,	"path", "Specify the dxgkrnl device"),
+	OPT_END()
+};
+
+static const char * const bench_dxg_usage[] = {
+	"perf bench virt dxg <options>",
+	NULL
+};
+
+static u64 timespec_diff_nsec(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * NSEC_PER_SEC +
+		end->tv_nsec - start->tv_nsec;
+}
+
+static void time_ioctl(int fd, unsigned long cmd, void *arg, size_t size,
+		       struct stats *stats)
+{
+	struct timespec t0, t1;
+	char saved[64];
+	unsigned int i;
+
+	/* The driver writes results back into the arguments. */
+	if (size > sizeof(saved))
+		errx(EXIT_FAILURE, "ioctl(%#lx): arguments too large", cmd);
+	memcpy(saved, arg, size);
+
+	for (i = 0; i < loops; i++) {
+		memcpy(arg, saved, size);
+
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		if (ioctl(fd, cmd, arg))
+			err(EXIT_FAILURE, "ioctl(%#lx)", cmd);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		update_stats(stats, timespec_diff_nsec(&t0, &t1));
+	}
+}
+
+static void print_result(const char *name, struct stats *stats)
+{
+	double avg = avg_stats(stats) / NSEC_PER_USEC;
+	double stddev = stddev_stats(stats) / NSEC_PER_USEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf(" %14s: %14lf usecs/op ( +- %.2f%% )\n", name, avg,
+		       rel_stddev_stats(stddev, avg));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* <ioctl> <usecs/op> <stddev usecs> */
+		printf("%s %lf %lf\n", name, avg, stddev);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+}
+
+int bench_virt_dxg(int argc, const char **argv)
+{
+	struct dxg_adapterinfo adapters[DXG_MAX_ADAPTERS];
+	struct dxg_enumadapters3 enum_args, count_args;
+	struct dxg_queryadapterinfo query;
+	struct stats enum_stats, query_stats;
+	__u32 adapter_type;
+	int fd;
+
+	argc = parse_options(argc, argv, options, bench_dxg_usage, 0);
+	if (!loops)
+		usage_with_options(bench_dxg_usage, options);
+
+	/* Don't fail 'perf bench all' outside of WSL2. */
+	fd = open(dev_path, O_RDWR);
+	if (fd < 0) {
+		warn("open %s", dev_path);
+		return 1;
+	}
+
+	memset(&enum_args, 0, sizeof(enum_args));
+	enum_args.adapter_count = DXG_MAX_ADAPTERS;
+	enum_args.adapters = (__u64)(unsigned long)adapters;
+	if (ioctl(fd, LX_DXENUMADAPTERS3, &enum_args))
+		err(EXIT_FAILURE, "LX_DXENUMADAPTERS3");
+	if (!enum_args.adapter_count)
+		errx(EXIT_FAILURE, "%s: no adapters", dev_path);
+
+	/*
+	 * Enumerating into a buffer opens new adapter handles each time, so
+	 * only time the count query, which the guest answers on its own.
+	 */
+	memset(&count_args, 0, sizeof(count_args));
+	init_stats(&enum_stats);
+	time_ioctl(fd, LX_DXENUMADAPTERS3, &count_args, sizeof(count_args),
+		   &enum_stats);
+
+	memset(&query, 0, sizeof(query));
+	query.adapter = adapters[0].adapter_handle;
+	query.type = DXG_QAITYPE_ADAPTERTYPE;
+	query.private_data = (__u64)(unsigned long)&adapter_type;
+	query.private_data_size = sizeof(adapter_type);
+
+	init_stats(&query_stats);
+	time_ioctl(fd, LX_DXQUERYADAPTERINFO, &query, sizeof(query),
+		   &query_stats);
+
+	close(fd);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# Executed %u calls of each ioctl on %s (%u adapters)\n\n",
+		       loops, dev_path, enum_args.adapter_count);
+
+	print_result("enumadapters3", &enum_stats);
+	print_result("queryadapterinfo", &query_stats);
+
+	return 0;
+}
@@ -0,0 +1,157 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * virt-fsmeta.c
+ *
+ * fs-meta: metadata operations per second on a (shared) file system
+ *
+ * Meant to be pointed at a 9p mount such as the WSL2 drvfs shares or a
+ * virtio-9p export, where every lookup, create or unlink is a request to
+ * the host.  Files are created, stat()ed, renamed and unlinked in a
+ * scratch directory below --dir, and each phase is timed separately.
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+
+#include <err.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/types.h>
+#include <linux/kernel.h>
+#include <linux/time64.h>
+
+#define NR_FILES_DEFAULT	1000
+
+static unsigned int	nr_files = NR_FILES_DEFAULT;
+static const char	*dir_path = ".";
+
+static const struct option options[] = {
+	OPT_UINTEGER('n', "nr-files",	&nr_files,	"Specify number of files per phase"),
+	OPT_STRING('d', "dir",		&dir_path,	"path", "Specify the directory to work in"),
+	OPT_END()
+};
+
+static const char * const bench_fsmeta_usage[] = {
+	"perf bench virt fs-meta <options>",
+	NULL
+};
+
+enum fsmeta_op {
+	FSMETA_CREATE,
+	FSMETA_STAT,
+	FSMETA_RENAME,
+	FSMETA_UNLINK,
+	FSMETA_NR_OPS,
+};
+
+static const char * const fsmeta_op_names[FSMETA_NR_OPS] = {
+	[FSMETA_CREATE]	= "create",
+	[FSMETA_STAT]	= "stat",
+	[FSMETA_RENAME]	= "rename",
+	[FSMETA_UNLINK]	= "unlink",
+};
+
+static char scratch[PATH_MAX];
+
+static void file_name(char *buf, unsigned int i, bool renamed)
+{
+	snprintf(buf, PATH_MAX, "%s/%s%u", scratch, renamed ? "r" : "f", i);
+}
+
+static void fsmeta_do(enum fsmeta_op op, unsigned int i)
+{
+	char path[PATH_MAX], new_path[PATH_MAX];
+	struct stat st;
+	int fd;
+
+	file_name(path, i, op == FSMETA_UNLINK);
+
+	switch (op) {
+	case FSMETA_CREATE:
+		fd = open(path, O_CREAT | O_EXCL | O_WRONLY, 0644);
+		if (fd < 0)
+			err(EXIT_FAILURE, "create %s", path);
+		close(fd);
+		break;
+	case FSMETA_STAT:
+		if (stat(path, &st))
+			err(EXIT_FAILURE, "stat %s", path);
+		break;
+	case FSMETA_RENAME:
+		file_name(new_path, i, true);
+		if (rename(path, new_path))
+			err(EXIT_FAILURE, "rename %s", path);
+		break;
+	case FSMETA_UNLINK:
+		if (unlink(path))
+			err(EXIT_FAILURE, "unlink %s", path);
+		break;
+	default:
+		BUG_ON(1);
+	}
+}
+
+int bench_virt_fsmeta(int argc, const char **argv)
+{
+	struct timeval start, stop, diff[FSMETA_NR_OPS];
+	unsigned long long result_usec;
+	unsigned int i;
+	int op;
+
+	argc = parse_options(argc, argv, options, bench_fsmeta_usage, 0);
+	if (!nr_files)
+		usage_with_options(bench_fsmeta_usage, options);
+
+	snprintf(scratch, sizeof(scratch), "%s/perf-bench-fsmeta.XXXXXX",
+		 dir_path);
+	if (!mkdtemp(scratch))
+		err(EXIT_FAILURE, "mkdtemp in %s", dir_path);
+
+	for (op = 0; op < FSMETA_NR_OPS; op++) {
+		gettimeofday(&start, NULL);
+		for (i = 0; i < nr_files; i++)
+			fsmeta_do(op, i);
+		gettimeofday(&stop, NULL);
+		timersub(&stop, &start, &diff[op]);
+	}
+
+	if (rmdir(scratch))
+		warn("rmdir %s", scratch);
+
+	if (bench_format == BENCH_FORMAT_DEFAULT)
+		printf("# %u files in %s\n\n", nr_files, dir_path);
+
+	for (op = 0; op < FSMETA_NR_OPS; op++) {
+		result_usec = diff[op].tv_sec * USEC_PER_SEC + diff[op].tv_usec;
+
+		switch (bench_format) {
+		case BENCH_FORMAT_DEFAULT:
+			printf(" %14s: %14lf usecs/op %'14d ops/sec\n",
+			       fsmeta_op_names[op],
+			       (double)result_usec / nr_files,
+			       (int)((double)nr_files * USEC_PER_SEC /
+				     (result_usec ?: 1)));
+			break;
+
+		case BENCH_FORMAT_SIMPLE:
+			/* <operation> <usecs/op> */
+			printf("%s %lf\n", fsmeta_op_names[op],
+			       (double)result_usec / nr_files);
+			break;
+
+		default:
+			/* reaching here is something disaster */
+			fprintf(stderr, "Unknown format:%d\n", bench_format);
+			exit(1);
+			break;
+		}
+	}
+
+	return 0;
+}
@@ -0,0 +1,355 @@
+// SPDX-License-Identifier: GPL-2.0
+/*
+ * virt-vsock.c
+ *
+ * vsock-lat: round trip latency of AF_VSOCK stream sockets
+ * vsock-bw:  AF_VSOCK stream throughput
+ *
+ * By default a server thread is started in the same process and the
+ * benchmark runs over the vsock loopback transport.  With --no-server it
+ * connects to a peer given by --cid instead, e.g. the Hyper-V host
+ * through hv_sock.  That peer has to echo every message back (vsock-lat)
+ * or consume the stream and answer its end with a single byte (vsock-bw).
+ */
+#include <subcmd/parse-options.h>
+#include "bench.h"
+#include "../util/stat.h"
+
+#include <err.h>
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <linux/time64.h>
+#include <linux/vm_sockets.h>
+
+#ifndef AF_VSOCK
+#define AF_VSOCK		40
+#endif
+
+#ifndef VMADDR_CID_LOCAL
+#define VMADDR_CID_LOCAL	1
+#endif
+
+#define PORT_DEFAULT		0x5042
+#define LAT_LOOPS_DEFAULT	100000
+#define LAT_SIZE_DEFAULT	64
+#define BW_LOOPS_DEFAULT	16384
+#define BW_SIZE_DEFAULT		65536
+
+static unsigned int	loops;
+static unsigned int	msg_size;
+static unsigned int	cid = VMADDR_CID_LOCAL;
+static unsigned int	port = PORT_DEFAULT;
+static bool		no_server;
+
+static const struct option options[] = {
+	OPT_UINTEGER('l', "loop",	&loops,		"Specify number of messages"),
+	OPT_UINTEGER('s', "size",	&msg_size,	"Specify message size in bytes"),
+	OPT_UINTEGER('c', "cid",	&cid,		"Specify the CID to connect to"),
+	OPT_UINTEGER('p', "port",	&port,		"Specify the vsock port"),
+	OPT_BOOLEAN('n', "no-server",	&no_server,	"Don't start a local server, use the peer at --cid"),
+	OPT_END()
+};
+
+static const char * const bench_vsock_lat_usage[] = {
+	"perf bench virt vsock-lat <options>",
+	NULL
+};
+
+static const char * const bench_vsock_bw_usage[] = {
+	"perf bench virt vsock-bw <options>",
+	NULL
+};
+
+struct vsock_server {
+	int			fd;
+	bool			echo;
+	pthread_t		thread;
+};
+
+/* Don't fail 'perf bench all' on kernels without vsock. */
+static bool vsock_available(void)
+{
+	int fd = socket(AF_VSOCK, SOCK_STREAM, 0);
+
+	if (fd < 0) {
+		warn("socket(AF_VSOCK)");
+		return false;
+	}
+	close(fd);
+	return true;
+}
+
+static void xfer_full(int fd, void *buf, size_t len, bool out)
+{
+	ssize_t ret;
+
+	while (len) {
+		ret = out ? write(fd, buf, len) : read(fd, buf, len);
+		if (ret < 0 && errno == EINTR)
+			continue;
+		if (ret <= 0)
+			err(EXIT_FAILURE, out ? "write" : "read");
+		buf += ret;
+		len -= ret;
+	}
+}
+
+static void *server_thread(void *arg)
+{
+	struct vsock_server *srv = arg;
+	char *buf;
+	ssize_t ret;
+	int fd;
+
+	buf = malloc(msg_size);
+	if (!buf)
+		err(EXIT_FAILURE, "malloc");
+
+	fd = accept(srv->fd, NULL, NULL);
+	if (fd < 0)
+		err(EXIT_FAILURE, "accept");
+
+	while ((ret = read(fd, buf, msg_size)) != 0) {
+		if (ret < 0) {
+			if (errno == EINTR)
+				continue;
+			err(EXIT_FAILURE, "read");
+		}
+		if (srv->echo)
+			xfer_full(fd, buf, ret, true);
+	}
+
+	/* The sink acknowledges the end of the stream. */
+	if (!srv->echo)
+		xfer_full(fd, buf, 1, true);
+
+	close(fd);
+	free(buf);
+	return NULL;
+}
+
+static void server_start(struct vsock_server *srv, bool echo)
+{
+	struct sockaddr_vm addr = {
+		.svm_family	= AF_VSOCK,
+		.svm_cid	= VMADDR_CID_ANY,
+		.svm_port	= port,
+	};
+
+	srv->echo = echo;
+	srv->fd = socket(AF_VSOCK, SOCK_STREAM, 0);
+	if (srv->fd < 0)
+		err(EXIT_FAILURE, "socket(AF_VSOCK)");
+
+	if (bind(srv->fd, (struct sockaddr *)&addr, sizeof(addr)))
+		err(EXIT_FAILURE, "bind");
+	if (listen(srv->fd, 1))
+		err(EXIT_FAILURE, "listen");
+
+	if (pthread_create(&srv->thread, NULL, server_thread, srv))
+		err(EXIT_FAILURE, "pthread_create");
+}
+
+static void server_stop(struct vsock_server *srv)
+{
+	pthread_join(srv->thread, NULL);
+	close(srv->fd);
+}
+
+static int client_connect(void)
+{
+	struct sockaddr_vm addr = {
+		.svm_family	= AF_VSOCK,
+		.svm_cid	= cid,
+		.svm_port	= port,
+	};
+	int fd;
+
+	fd = socket(AF_VSOCK, SOCK_STREAM, 0);
+	if (fd < 0)
+		err(EXIT_FAILURE, "socket(AF_VSOCK)");
+
+	if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)))
+		err(EXIT_FAILURE, "connect to CID %u port %u", cid, port);
+
+	return fd;
+}
+
+static u64 timespec_diff_nsec(struct timespec *start, struct timespec *end)
+{
+	return (end->tv_sec - start->tv_sec) * NSEC_PER_SEC +
+		end->tv_nsec - start->tv_nsec;
+}
+
+int bench_virt_vsock_lat(int argc, const char **argv)
+{
+	struct vsock_server srv;
+	struct timeval start, stop, diff;
+	struct timespec t0, t1;
+	struct stats lat_stats;
+	double avg, stddev;
+	unsigned int i;
+	char *buf;
+	int fd;
+
+	loops = LAT_LOOPS_DEFAULT;
+	msg_size = LAT_SIZE_DEFAULT;
+
+	argc = parse_options(argc, argv, options, bench_vsock_lat_usage, 0);
+	if (!loops || !msg_size)
+		usage_with_options(bench_vsock_lat_usage, options);
+
+	if (!vsock_available())
+		return 1;
+
+	buf = calloc(1, msg_size);
+	if (!buf)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!no_server)
+		server_start(&srv, true);
+
+	fd = client_connect();
+	init_stats(&lat_stats);
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < loops; i++) {
+		clock_gettime(CLOCK_MONOTONIC, &t0);
+		xfer_full(fd, buf, msg_size, true);
+		xfer_full(fd, buf, msg_size, false);
+		clock_gettime(CLOCK_MONOTONIC, &t1);
+
+		update_stats(&lat_stats, timespec_diff_nsec(&t0, &t1));
+	}
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	close(fd);
+	if (!no_server)
+		server_stop(&srv);
+	free(buf);
+
+	avg = avg_stats(&lat_stats) / NSEC_PER_USEC;
+	stddev = stddev_stats(&lat_stats) / NSEC_PER_USEC;
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Executed %u round trips of %u bytes to CID %u port %u\n\n",
+		       loops, msg_size, cid, port);
+
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long) diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / USEC_PER_MSEC));
+
+		printf(" %14lf usecs/op ( +- %.2f%% )\n", avg,
+		       rel_stddev_stats(stddev, avg));
+		printf(" %14d ops/sec\n", (int)(USEC_PER_SEC / avg));
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* <total seconds> <usecs/op> <stddev usecs> */
+		printf("%lu.%03lu %lf %lf\n",
+		       (unsigned long) diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / USEC_PER_MSEC),
+		       avg, stddev);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
+
+int bench_virt_vsock_bw(int argc, const char **argv)
+{
+	struct vsock_server srv;
+	struct timeval start, stop, diff;
+	unsigned long long result_usec;
+	double total_mb, mb_sec;
+	unsigned int i;
+	char *buf;
+	int fd;
+
+	loops = BW_LOOPS_DEFAULT;
+	msg_size = BW_SIZE_DEFAULT;
+
+	argc = parse_options(argc, argv, options, bench_vsock_bw_usage, 0);
+	if (!loops || !msg_size)
+		usage_with_options(bench_vsock_bw_usage, options);
+
+	if (!vsock_available())
+		return 1;
+
+	buf = calloc(1, msg_size);
+	if (!buf)
+		err(EXIT_FAILURE, "calloc");
+
+	if (!no_server)
+		server_start(&srv, false);
+
+	fd = client_connect();
+
+	gettimeofday(&start, NULL);
+
+	for (i = 0; i < loops; i++)
+		xfer_full(fd, buf, msg_size, true);
+
+	/* Only stop the clock once the peer has seen everything. */
+	if (shutdown(fd, SHUT_WR))
+		err(EXIT_FAILURE, "shutdown");
+	xfer_full(fd, buf, 1, false);
+
+	gettimeofday(&stop, NULL);
+	timersub(&stop, &start, &diff);
+
+	close(fd);
+	if (!no_server)
+		server_stop(&srv);
+	free(buf);
+
+	result_usec = diff.tv_sec * USEC_PER_SEC + diff.tv_usec;
+	total_mb = (double)loops * msg_size / (1024 * 1024);
+	mb_sec = total_mb / ((double)result_usec / USEC_PER_SEC);
+
+	switch (bench_format) {
+	case BENCH_FORMAT_DEFAULT:
+		printf("# Sent %.1f MB in %u byte writes to CID %u port %u\n\n",
+		       total_mb, msg_size, cid, port);
+
+		printf(" %14s: %lu.%03lu [sec]\n\n", "Total time",
+		       (unsigned long) diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / USEC_PER_MSEC));
+
+		printf(" %14lf MB/sec\n", mb_sec);
+		break;
+
+	case BENCH_FORMAT_SIMPLE:
+		/* <total seconds> <MB/sec> */
+		printf("%lu.%03lu %lf\n",
+		       (unsigned long) diff.tv_sec,
+		       (unsigned long) (diff.tv_usec / USEC_PER_MSEC),
+		       mb_sec);
+		break;
+
+	default:
+		/* reaching here is something disaster */
+		fprintf(stderr, "Unknown format:%d\n", bench_format);
+		exit(1);
+		break;
+	}
+
+	return 0;
+}
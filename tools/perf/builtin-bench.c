@@ -16,6 +16,7 @@
  *  numa  ... NUMA scheduling and MM performance
  *  futex ... Futex performance
  *  epoll ... Event poll performance
+ *  virt  ... Virtualization (vsock, dxgkrnl, 9p) performance
  */
 #include <subcmd/parse-options.h>
 #include "builtin.h"
@@ -99,6 +100,15 @@ static struct bench breakpoint_benchmarks[] = {
 	{ NULL,	NULL, NULL },
 };
 
+static struct bench virt_benchmarks[] = {
+	{ "vsock-lat",	"Benchmark AF_VSOCK round trip latency",	bench_virt_vsock_lat	},
+	{ "vsock-bw",	"Benchmark AF_VSOCK stream throughput",		bench_virt_vsock_bw	},
+	{ "dxg",	"Benchmark /dev/dxg ioctl round trips",		bench_virt_dxg		},
+	{ "fs-meta",	"Benchmark file system metadata operations",	bench_virt_fsmeta	},
+	{ "all",	"Run all virtualization benchmarks",		NULL			},
+	{ NULL,		NULL,						NULL			}
+};
+
 struct collection {
 	const char	*name;
 	const char	*summary;
@@ -118,6 +128,7 @@ static struct collection collections[] = {
 #endif
 	{ "internals",	"Perf-internals benchmarks",			internals_benchmarks	},
 	{ "breakpoint",	"Breakpoint benchmarks",			breakpoint_benchmarks	},
+	{ "virt",	"Virtualization benchmarks",			virt_benchmarks		},
 	{ "all",	"All benchmarks",				NULL			},
 	{ NULL,		NULL,						NULL			}
 };
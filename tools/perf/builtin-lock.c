@@ -19,6 +19,8 @@
 #include "util/tool.h"
 #include "util/data.h"
 #include "util/string2.h"
+#include "util/target.h"
+#include "util/lock-contention.h"
 
 #include <sys/types.h>
 #include <sys/prctl.h>
@@ -26,6 +28,8 @@
 #include <pthread.h>
 #include <math.h>
 #include <limits.h>
+#include <signal.h>
+#include <unistd.h>
 
 #include <linux/list.h>
 #include <linux/hash.h>
@@ -44,31 +48,6 @@ static struct hlist_head lockhash_table[LOCKHASH_SIZE];
 #define __lockhashfn(key)	hash_long((unsigned long)key, LOCKHASH_BITS)
 #define lockhashentry(key)	(lockhash_table + __lockhashfn((key)))
 
-struct lock_stat {
-	struct hlist_node	hash_entry;
-	struct rb_node		rb;		/* used for sorting */
-
-	u64			addr;		/* address of lockdep_map, used as ID */
-	char			*name;		/* for strcpy(), we cannot use const */
-
-	unsigned int		nr_acquire;
-	unsigned int		nr_acquired;
-	unsigned int		nr_contended;
-	unsigned int		nr_release;
-
-	unsigned int		nr_readlock;
-	unsigned int		nr_trylock;
-
-	/* these times are in nano sec. */
-	u64                     avg_wait_time;
-	u64			wait_time_total;
-	u64			wait_time_min;
-	u64			wait_time_max;
-
-	int			broken; /* flag of blacklist */
-	int			combined;
-};
-
 /*
  * States of lock_seq_stat
  *
@@ -119,6 +98,10 @@ static struct rb_root		thread_stats;
 
 static bool combine_locks;
 static bool show_thread_stats;
+static bool show_lock_addrs;
+static int bpf_map_entries = 10240;
+
+static struct target target;
 
 static struct thread_stat *thread_stat_find(u32 tid)
 {
@@ -1023,6 +1006,80 @@ static const struct evsel_str_handler lock_tracepoints[] = {
 	{ "lock:lock_release",	 evsel__process_lock_release,   }, /* CONFIG_LOCKDEP */
 };
 
+/* flags for lock:contention_begin, from include/trace/events/lock.h */
+#define LCB_F_SPIN	(1U << 0)
+#define LCB_F_READ	(1U << 1)
+#define LCB_F_WRITE	(1U << 2)
+#define LCB_F_RT	(1U << 3)
+#define LCB_F_PERCPU	(1U << 4)
+#define LCB_F_MUTEX	(1U << 5)
+
+static const struct {
+	unsigned int flags;
+	const char *name;
+} lock_type_table[] = {
+	{ 0,				"semaphore" },
+	{ LCB_F_SPIN,			"spinlock" },
+	{ LCB_F_SPIN | LCB_F_READ,	"rwlock:R" },
+	{ LCB_F_SPIN | LCB_F_WRITE,	"rwlock:W"},
+	{ LCB_F_READ,			"rwsem:R" },
+	{ LCB_F_WRITE,			"rwsem:W" },
+	{ LCB_F_RT,			"rtmutex" },
+	{ LCB_F_RT | LCB_F_READ,	"rwlock-rt:R" },
+	{ LCB_F_RT | LCB_F_WRITE,	"rwlock-rt:W"},
+	{ LCB_F_PERCPU | LCB_F_READ,	"pcpu-sem:R" },
+	{ LCB_F_PERCPU | LCB_F_WRITE,	"pcpu-sem:W" },
+	{ LCB_F_MUTEX,			"mutex" },
+	{ LCB_F_MUTEX | LCB_F_SPIN,	"mutex" },
+};
+
+static const char *get_type_str(struct lock_stat *st)
+{
+	unsigned int i;
+
+	for (i = 0; i < ARRAY_SIZE(lock_type_table); i++) {
+		if (lock_type_table[i].flags == st->flags)
+			return lock_type_table[i].name;
+	}
+	return "unknown";
+}
+
+static void print_contention_result(struct lock_contention *con)
+{
+	struct lock_stat *st;
+	struct lock_key *key;
+	int total = 0;
+
+	list_for_each_entry(key, &lock_keys, list)
+		pr_info("%*s ", key->len, key->header);
+
+	if (show_lock_addrs)
+		pr_info("  %16s   %10s   %s\n\n", "address", "type", "symbol");
+	else
+		pr_info("  %10s   %s\n\n", "type", "caller");
+
+	while ((st = pop_from_result())) {
+		total++;
+
+		list_for_each_entry(key, &lock_keys, list) {
+			key->print(key, st);
+			pr_info(" ");
+		}
+
+		if (show_lock_addrs)
+			pr_info("  %016llx   %10s   %s\n",
+				(unsigned long long)st->addr,
+				get_type_str(st), st->name);
+		else
+			pr_info("  %10s   %s\n", get_type_str(st), st->name);
+	}
+
+	if (con->lost) {
+		pr_info("\n=== output for debug===\n\n");
+		pr_info("total: %d, lost: %d\n", total, con->lost);
+	}
+}
+
 static bool force;
 
 static int __cmd_report(bool display_info)
@@ -1080,6 +1137,113 @@ static int __cmd_report(bool display_info)
 	return err;
 }
 
+static void sighandler(int sig __maybe_unused)
+{
+}
+
+/*
+ * Contention is collected with BPF programs on the lock:contention_begin
+ * and lock:contention_end tracepoints, which don't need lockdep, and the
+ * wait times are aggregated in the kernel until the workload exits or
+ * perf is interrupted.
+ */
+static int __cmd_contention(int argc, const char **argv)
+{
+	int err = -EINVAL;
+	struct perf_tool eops = {
+		.ordered_events	 = true,
+	};
+	struct lock_contention con = {
+		.target = &target,
+		.result = &lockhash_table[0],
+		.map_nr_entries = bpf_map_entries,
+		.aggr_mode = show_lock_addrs ? LOCK_AGGR_ADDR : LOCK_AGGR_CALLER,
+	};
+
+#ifndef HAVE_BPF_SKEL
+	pr_err("perf lock contention needs BPF support, rebuild with BUILD_BPF_SKEL=1\n");
+	return -EOPNOTSUPP;
+#endif
+
+	session = perf_session__new(NULL, &eops);
+	if (IS_ERR(session)) {
+		pr_err("Initializing perf session failed\n");
+		return PTR_ERR(session);
+	}
+
+	con.machine = &session->machines.host;
+
+	/* for lock function check */
+	symbol_conf.sort_by_name = true;
+	symbol__init(&session->header.env);
+
+	err = target__validate(&target);
+	if (err) {
+		char errbuf[512];
+
+		target__strerror(&target, err, errbuf, 512);
+		pr_err("%s\n", errbuf);
+		goto out_delete;
+	}
+
+	signal(SIGINT, sighandler);
+	signal(SIGCHLD, sighandler);
+	signal(SIGTERM, sighandler);
+
+	con.evlist = evlist__new();
+	if (con.evlist == NULL) {
+		err = -ENOMEM;
+		goto out_delete;
+	}
+
+	err = evlist__create_maps(con.evlist, &target);
+	if (err < 0)
+		goto out_delete;
+
+	if (argc) {
+		err = evlist__prepare_workload(con.evlist, &target,
+					       argv, false, NULL);
+		if (err < 0)
+			goto out_delete;
+	}
+
+	err = lock_contention_prepare(&con);
+	if (err < 0) {
+		pr_err("lock contention BPF setup failed\n");
+		goto out_delete;
+	}
+
+	err = setup_output_field(output_fields);
+	if (err)
+		goto out_delete;
+
+	err = select_key();
+	if (err)
+		goto out_delete;
+
+	lock_contention_start();
+	if (argc)
+		evlist__start_workload(con.evlist);
+
+	/* wait for signal */
+	pause();
+
+	lock_contention_stop();
+	err = lock_contention_read(&con);
+	if (err)
+		goto out_delete;
+
+	setup_pager();
+	sort_result();
+	print_contention_result(&con);
+
+out_delete:
+	evlist__delete(con.evlist);
+	lock_contention_finish();
+	perf_session__delete(session);
+	return err;
+}
+
 static int __cmd_record(int argc, const char **argv)
 {
 	const char *record_args[] = {
@@ -1154,12 +1318,32 @@ int cmd_lock(int argc, const char **argv)
 	OPT_PARENT(lock_options)
 	};
 
+	const struct option contention_options[] = {
+	OPT_STRING('k', "key", &sort_key, "wait_total",
+		    "key for sorting (contended / wait_total / wait_max / wait_min / avg_wait)"),
+	OPT_STRING('F', "field", &output_fields, "contended,wait_total,wait_max,avg_wait",
+		    "output fields (contended / wait_total / wait_max / wait_min / avg_wait)"),
+	OPT_BOOLEAN('a', "all-cpus", &target.system_wide,
+		    "System-wide collection from all CPUs"),
+	OPT_STRING('C', "cpu", &target.cpu_list, "cpu",
+		    "List of cpus to monitor"),
+	OPT_STRING('p', "pid", &target.pid, "pid",
+		   "Trace on existing process id"),
+	OPT_STRING(0, "tid", &target.tid, "tid",
+		   "Trace on existing thread id (exclusive to --pid)"),
+	OPT_INTEGER('M', "map-nr-entries", &bpf_map_entries,
+		    "Max number of BPF map entries"),
+	OPT_BOOLEAN('l', "lock-addr", &show_lock_addrs,
+		    "aggregate and show contention by lock address"),
+	OPT_PARENT(lock_options)
+	};
+
 	const char * const info_usage[] = {
 		"perf lock info [<options>]",
 		NULL
 	};
 	const char *const lock_subcommands[] = { "record", "report", "script",
-						 "info", NULL };
+						 "info", "contention", NULL };
 	const char *lock_usage[] = {
 		NULL,
 		NULL
@@ -1168,6 +1352,10 @@ int cmd_lock(int argc, const char **argv)
 		"perf lock report [<options>]",
 		NULL
 	};
+	const char * const contention_usage[] = {
+		"perf lock contention [<options>]",
+		NULL
+	};
 	unsigned int i;
 	int rc = 0;
 
@@ -1203,6 +1391,16 @@ int cmd_lock(int argc, const char **argv)
 		/* recycling report_lock_ops */
 		trace_handler = &report_lock_ops;
 		rc = __cmd_report(true);
+	} else if (strlen(argv[0]) > 2 && strstarts("contention", argv[0])) {
+		sort_key = "wait_total";
+		output_fields = "contended,wait_total,wait_max,avg_wait";
+
+		argc = parse_options(argc, argv, contention_options,
+				     contention_usage, PARSE_OPT_STOP_AT_NON_OPTION);
+		if (bpf_map_entries <= 0)
+			usage_with_options(contention_usage, contention_options);
+
+		rc = __cmd_contention(argc, argv);
 	} else {
 		usage_with_options(lock_usage, lock_options);
 	}
@@ -3262,6 +3262,8 @@ static struct option __record_options[] = {
 		    "collect kernel callchains"),
 	OPT_BOOLEAN(0, "user-callchains", &record.opts.user_callchains,
 		    "collect user callchains"),
+	OPT_BOOLEAN(0, "aggregate-callchain", &record.opts.aggregate_callchain,
+		    "count callchains in the kernel instead of recording each sample"),
 	OPT_STRING(0, "clang-path", &llvm_param.clang_path, "clang path",
 		   "clang binary to use for compiling BPF scriptlets"),
 	OPT_STRING(0, "clang-opt", &llvm_param.clang_opt, "clang options",
@@ -3916,6 +3918,13 @@ int cmd_record(int argc, const char **argv)
 	if (record.opts.overwrite)
 		record.opts.tail_synthesize = true;
 
+	if (record.opts.aggregate_callchain &&
+	    (!callchain_param.enabled || record.opts.overwrite)) {
+		pr_err("--aggregate-callchain needs -g and can't be used with --overwrite.\n");
+		err = -EINVAL;
+		goto out;
+	}
+
 	if (rec->evlist->core.nr_entries == 0) {
 		if (perf_pmu__has_hybrid()) {
 			err = evlist__add_default_hybrid(rec->evlist,
@@ -324,6 +324,45 @@ static int process_sample_event(struct perf_tool *tool,
 	return ret;
 }
 
+/*
+ * A PERF_RECORD_CALLCHAIN_AGG record stands for all the samples of one
+ * task with the same callchain since the previous record.  Feed it to the
+ * histograms as a single sample carrying their summed period.
+ */
+static int process_callchain_agg_event(struct perf_tool *tool,
+				       union perf_event *event,
+				       struct perf_sample *sample,
+				       struct evsel *evsel,
+				       struct machine *machine)
+{
+	struct perf_record_callchain_agg *agg = &event->callchain_agg;
+	struct perf_sample agg_sample = *sample;
+	u64 i, ip;
+
+	if (!agg->nr)
+		return 0;
+
+	agg_sample.pid	     = agg->pid;
+	agg_sample.tid	     = agg->tid;
+	agg_sample.period    = agg->period;
+	agg_sample.callchain = (struct ip_callchain *)&agg->nr;
+
+	/* The sampled ip is the first entry after the context markers. */
+	for (i = 0; i < agg->nr; i++) {
+		ip = agg->ips[i];
+		if (ip == PERF_CONTEXT_KERNEL)
+			agg_sample.cpumode = PERF_RECORD_MISC_KERNEL;
+		else if (ip == PERF_CONTEXT_USER)
+			agg_sample.cpumode = PERF_RECORD_MISC_USER;
+		if (ip < PERF_CONTEXT_MAX) {
+			agg_sample.ip = ip;
+			break;
+		}
+	}
+
+	return process_sample_event(tool, event, &agg_sample, evsel, machine);
+}
+
 static int process_read_event(struct perf_tool *tool,
 			      union perf_event *event,
 			      struct perf_sample *sample __maybe_unused,
@@ -1170,6 +1209,7 @@ int cmd_report(int argc, const char **argv)
 	struct report report = {
 		.tool = {
 			.sample		 = process_sample_event,
+			.callchain_agg	 = process_callchain_agg_event,
 			.mmap		 = perf_event__process_mmap,
 			.mmap2		 = perf_event__process_mmap2,
 			.comm		 = perf_event__process_comm,
@@ -0,0 +1,264 @@
+// SPDX-License-Identifier: GPL-2.0
+#include "util/bpf_counter.h"
+#include "util/debug.h"
+#include "util/evsel.h"
+#include "util/evlist.h"
+#include "util/lock-contention.h"
+#include "util/machine.h"
+#include "util/map.h"
+#include "util/symbol.h"
+#include "util/target.h"
+#include "util/thread_map.h"
+#include "util/cpumap.h"
+#include <linux/zalloc.h>
+#include <bpf/bpf.h>
+
+#include "bpf_skel/lock_contention.skel.h"
+#include "bpf_skel/lock_data.h"
+
+/* the first frames are the tracepoint and the BPF helpers */
+#define CONTENTION_STACK_SKIP  3
+
+static struct lock_contention_bpf *skel;
+
+int lock_contention_prepare(struct lock_contention *con)
+{
+	int i, fd;
+	int ncpus = 1, ntasks = 1;
+	struct evlist *evlist = con->evlist;
+	struct target *target = con->target;
+
+	skel = lock_contention_bpf__open();
+	if (!skel) {
+		pr_err("Failed to open lock-contention BPF skeleton\n");
+		return -1;
+	}
+
+	bpf_map__set_max_entries(skel->maps.stacks, con->map_nr_entries);
+	bpf_map__set_max_entries(skel->maps.tstamp, con->map_nr_entries);
+	bpf_map__set_max_entries(skel->maps.lock_stat, con->map_nr_entries);
+
+	if (target__has_cpu(target))
+		ncpus = perf_cpu_map__nr(evlist->core.user_requested_cpus);
+	if (target__has_task(target))
+		ntasks = perf_thread_map__nr(evlist->core.threads);
+
+	bpf_map__set_max_entries(skel->maps.cpu_filter, ncpus);
+	bpf_map__set_max_entries(skel->maps.task_filter, ntasks);
+
+	set_max_rlimit();
+
+	if (lock_contention_bpf__load(skel) < 0) {
+		pr_err("Failed to load lock-contention BPF skeleton\n");
+		return -1;
+	}
+
+	if (target__has_cpu(target)) {
+		u32 cpu;
+		u8 val = 1;
+
+		skel->bss->has_cpu = 1;
+		fd = bpf_map__fd(skel->maps.cpu_filter);
+
+		for (i = 0; i < ncpus; i++) {
+			cpu = perf_cpu_map__cpu(evlist->core.user_requested_cpus, i).cpu;
+			bpf_map_update_elem(fd, &cpu, &val, BPF_ANY);
+		}
+	}
+
+	if (target__has_task(target)) {
+		u32 pid;
+		u8 val = 1;
+
+		skel->bss->has_task = 1;
+		fd = bpf_map__fd(skel->maps.task_filter);
+
+		for (i = 0; i < ntasks; i++) {
+			pid = perf_thread_map__pid(evlist->core.threads, i);
+			bpf_map_update_elem(fd, &pid, &val, BPF_ANY);
+		}
+	}
+
+	if (target__none(target) && evlist->workload.pid > 0) {
+		u32 pid = evlist->workload.pid;
+		u8 val = 1;
+
+		skel->bss->has_task = 1;
+		fd = bpf_map__fd(skel->maps.task_filter);
+		bpf_map_update_elem(fd, &pid, &val, BPF_ANY);
+	}
+
+	skel->bss->aggr_by_addr = con->aggr_mode == LOCK_AGGR_ADDR;
+
+	lock_contention_bpf__attach(skel);
+	return 0;
+}
+
+int lock_contention_start(void)
+{
+	skel->bss->enabled = 1;
+	return 0;
+}
+
+int lock_contention_stop(void)
+{
+	skel->bss->enabled = 0;
+	return 0;
+}
+
+struct text_range {
+	u64	start, end;
+};
+
+static void find_text_range(struct machine *machine, const char *start,
+			    const char *end, struct text_range *range)
+{
+	struct symbol *sym;
+	struct map *kmap;
+
+	sym = machine__find_kernel_symbol_by_name(machine, start, &kmap);
+	if (sym)
+		range->start = kmap->unmap_ip(kmap, sym->start);
+
+	sym = machine__find_kernel_symbol_by_name(machine, end, &kmap);
+	if (sym)
+		range->end = kmap->unmap_ip(kmap, sym->start);
+}
+
+/* lock functions and the scheduler live in their own text sections */
+static bool is_lock_function(struct machine *machine, u64 addr)
+{
+	static struct text_range lock_text, sched_text;
+	static bool initialized;
+
+	if (!initialized) {
+		find_text_range(machine, "__lock_text_start",
+				"__lock_text_end", &lock_text);
+		find_text_range(machine, "__sched_text_start",
+				"__sched_text_end", &sched_text);
+		initialized = true;
+	}
+
+	return (lock_text.start <= addr && addr < lock_text.end) ||
+	       (sched_text.start <= addr && addr < sched_text.end);
+}
+
+static const char *lock_class_names[] = {
+	[LOCK_CLASS_RQLOCK]	= "rq_lock",
+	[LOCK_CLASS_MMAP_LOCK]	= "mmap_lock",
+	[LOCK_CLASS_SIGHAND]	= "siglock",
+};
+
+static char *symbolize(struct machine *machine, u64 addr)
+{
+	struct symbol *sym;
+	struct map *kmap;
+	unsigned long offset;
+	char *name = NULL;
+
+	sym = machine__find_kernel_symbol(machine, addr, &kmap);
+	if (!sym) {
+		if (asprintf(&name, "%#lx", (unsigned long)addr) < 0)
+			return NULL;
+		return name;
+	}
+
+	offset = kmap->map_ip(kmap, addr) - sym->start;
+	if (!offset)
+		return strdup(sym->name);
+
+	if (asprintf(&name, "%s+%#lx", sym->name, offset) < 0)
+		return NULL;
+	return name;
+}
+
+static char *lock_contention_name(struct lock_contention *con,
+				  struct contention_key *key,
+				  struct contention_data *data,
+				  u64 *stack_trace, u64 *addr)
+{
+	int idx;
+
+	if (con->aggr_mode == LOCK_AGGR_ADDR) {
+		*addr = key->lock_addr;
+
+		if (data->lock_class != LOCK_CLASS_NONE &&
+		    data->lock_class < ARRAY_SIZE(lock_class_names))
+			return strdup(lock_class_names[data->lock_class]);
+
+		/* static locks resolve to their (containing) data symbol */
+		return symbolize(con->machine, *addr);
+	}
+
+	/* skip BPF + lock internal functions */
+	idx = CONTENTION_STACK_SKIP;
+	while (idx < CONTENTION_STACK_DEPTH - 1 &&
+	       is_lock_function(con->machine, stack_trace[idx]))
+		idx++;
+
+	*addr = stack_trace[idx];
+	return symbolize(con->machine, *addr);
+}
+
+int lock_contention_read(struct lock_contention *con)
+{
+	int fd, stack;
+	struct contention_key prev_key, key, *prev = NULL;
+	struct contention_data data;
+	struct lock_stat *st;
+	u64 stack_trace[CONTENTION_STACK_DEPTH];
+
+	fd = bpf_map__fd(skel->maps.lock_stat);
+	stack = bpf_map__fd(skel->maps.stacks);
+
+	con->lost = skel->bss->lost;
+
+	while (!bpf_map_get_next_key(fd, prev, &key)) {
+		prev_key = key;
+		prev = &prev_key;
+
+		if (bpf_map_lookup_elem(fd, &key, &data))
+			continue;
+
+		/* callstacks which couldn't be saved are counted as lost */
+		memset(stack_trace, 0, sizeof(stack_trace));
+		if (con->aggr_mode == LOCK_AGGR_CALLER &&
+		    (key.stack_id < 0 ||
+		     bpf_map_lookup_elem(stack, &key.stack_id, stack_trace)))
+			continue;
+
+		st = zalloc(sizeof(*st));
+		if (st == NULL)
+			return -1;
+
+		st->nr_contended = data.count;
+		st->wait_time_total = data.total_time;
+		st->wait_time_max = data.max_time;
+		st->wait_time_min = data.min_time;
+		st->flags = data.flags;
+
+		if (data.count)
+			st->avg_wait_time = data.total_time / data.count;
+
+		st->name = lock_contention_name(con, &key, &data, stack_trace,
+						&st->addr);
+		if (st->name == NULL) {
+			free(st);
+			return -1;
+		}
+
+		hlist_add_head(&st->hash_entry, con->result);
+	}
+
+	return 0;
+}
+
+int lock_contention_finish(void)
+{
+	if (skel) {
+		skel->bss->enabled = 0;
+		lock_contention_bpf__destroy(skel);
+	}
+
+	return 0;
+}
@@ -0,0 +1,248 @@
+// SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause)
+#include "vmlinux.h"
+#include <bpf/bpf_helpers.h>
+#include <bpf/bpf_tracing.h>
+#include <bpf/bpf_core_read.h>
+
+#include "lock_data.h"
+
+/* default buffer size */
+#define MAX_ENTRIES  10240
+
+/* bound the compare-and-swap loops for the verifier */
+#define MAX_CAS_RETRIES  8
+
+struct tstamp_data {
+	__u64 timestamp;
+	__u64 lock;
+	__u32 flags;
+	__s32 stack_id;
+};
+
+/* callstack storage */
+struct {
+	__uint(type, BPF_MAP_TYPE_STACK_TRACE);
+	__uint(key_size, sizeof(__u32));
+	__uint(value_size, CONTENTION_STACK_DEPTH * sizeof(__u64));
+	__uint(max_entries, MAX_ENTRIES);
+} stacks SEC(".maps");
+
+/* maintain timestamp at the beginning of contention */
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__type(key, __u32);
+	__type(value, struct tstamp_data);
+	__uint(max_entries, MAX_ENTRIES);
+} tstamp SEC(".maps");
+
+/* actual lock contention statistics */
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(key_size, sizeof(struct contention_key));
+	__uint(value_size, sizeof(struct contention_data));
+	__uint(max_entries, MAX_ENTRIES);
+} lock_stat SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(key_size, sizeof(__u32));
+	__uint(value_size, sizeof(__u8));
+	__uint(max_entries, 1);
+} cpu_filter SEC(".maps");
+
+struct {
+	__uint(type, BPF_MAP_TYPE_HASH);
+	__uint(key_size, sizeof(__u32));
+	__uint(value_size, sizeof(__u8));
+	__uint(max_entries, 1);
+} task_filter SEC(".maps");
+
+extern struct rq runqueues __ksym;
+
+/* control flags */
+int enabled;
+int has_cpu;
+int has_task;
+int aggr_by_addr;
+
+/* error stat */
+int lost;
+
+static inline int can_record(void)
+{
+	if (has_cpu) {
+		__u32 cpu = bpf_get_smp_processor_id();
+		__u8 *ok;
+
+		ok = bpf_map_lookup_elem(&cpu_filter, &cpu);
+		if (!ok)
+			return 0;
+	}
+
+	if (has_task) {
+		__u8 *ok;
+		__u32 pid = bpf_get_current_pid_tgid();
+
+		ok = bpf_map_lookup_elem(&task_filter, &pid);
+		if (!ok)
+			return 0;
+	}
+
+	return 1;
+}
+
+/*
+ * Name the few dynamically allocated locks which can be found from the
+ * current task, the rest is left to the kernel symbols in userspace.
+ */
+static inline __u32 lock_class(__u64 lock)
+{
+	struct task_struct *curr;
+	struct mm_struct *mm;
+	struct sighand_struct *sighand;
+	struct rq *rq;
+
+	rq = bpf_this_cpu_ptr(&runqueues);
+	if (lock == (__u64)&rq->__lock)
+		return LOCK_CLASS_RQLOCK;
+
+	curr = bpf_get_current_task_btf();
+
+	mm = BPF_CORE_READ(curr, mm);
+	if (mm && lock == (__u64)&mm->mmap_lock)
+		return LOCK_CLASS_MMAP_LOCK;
+
+	sighand = BPF_CORE_READ(curr, sighand);
+	if (sighand && lock == (__u64)&sighand->siglock)
+		return LOCK_CLASS_SIGHAND;
+
+	return LOCK_CLASS_NONE;
+}
+
+/*
+ * Update the maximum or minimum with compare-and-swap, as other CPUs may
+ * end a contention on the same lock at the same time.  Losing the race
+ * MAX_CAS_RETRIES times in a row means the value keeps moving, then just
+ * give up on this sample.
+ */
+static inline void update_max(__u64 *time, __u64 duration)
+{
+	__u64 old;
+	int i;
+
+	for (i = 0; i < MAX_CAS_RETRIES; i++) {
+		old = *time;
+		if (old >= duration)
+			break;
+		if (__sync_val_compare_and_swap(time, old, duration) == old)
+			break;
+	}
+}
+
+static inline void update_min(__u64 *time, __u64 duration)
+{
+	__u64 old;
+	int i;
+
+	for (i = 0; i < MAX_CAS_RETRIES; i++) {
+		old = *time;
+		if (old <= duration)
+			break;
+		if (__sync_val_compare_and_swap(time, old, duration) == old)
+			break;
+	}
+}
+
+SEC("tp_btf/contention_begin")
+int contention_begin(u64 *ctx)
+{
+	__u32 pid;
+	struct tstamp_data *pelem;
+
+	if (!enabled || !can_record())
+		return 0;
+
+	pid = bpf_get_current_pid_tgid();
+	pelem = bpf_map_lookup_elem(&tstamp, &pid);
+	if (pelem && pelem->lock)
+		return 0;
+
+	if (pelem == NULL) {
+		struct tstamp_data zero = {};
+
+		bpf_map_update_elem(&tstamp, &pid, &zero, BPF_ANY);
+		pelem = bpf_map_lookup_elem(&tstamp, &pid);
+		if (pelem == NULL) {
+			lost++;
+			return 0;
+		}
+	}
+
+	pelem->timestamp = bpf_ktime_get_ns();
+	pelem->lock = (__u64)ctx[0];
+	pelem->flags = (__u32)ctx[1];
+
+	/* the callstack is only needed to find the caller */
+	if (aggr_by_addr) {
+		pelem->stack_id = -1;
+		return 0;
+	}
+
+	pelem->stack_id = bpf_get_stackid(ctx, &stacks, BPF_F_FAST_STACK_CMP);
+	if (pelem->stack_id < 0)
+		lost++;
+	return 0;
+}
+
+SEC("tp_btf/contention_end")
+int contention_end(u64 *ctx)
+{
+	__u32 pid;
+	struct tstamp_data *pelem;
+	struct contention_key key = {};
+	struct contention_data *data;
+	__u64 duration;
+
+	if (!enabled)
+		return 0;
+
+	pid = bpf_get_current_pid_tgid();
+	pelem = bpf_map_lookup_elem(&tstamp, &pid);
+	if (!pelem || pelem->lock != ctx[0])
+		return 0;
+
+	duration = bpf_ktime_get_ns() - pelem->timestamp;
+
+	key.stack_id = pelem->stack_id;
+	if (aggr_by_addr)
+		key.lock_addr = pelem->lock;
+
+	data = bpf_map_lookup_elem(&lock_stat, &key);
+	if (!data) {
+		struct contention_data first = {
+			.total_time = duration,
+			.max_time = duration,
+			.min_time = duration,
+			.count = 1,
+			.flags = pelem->flags,
+		};
+
+		if (aggr_by_addr)
+			first.lock_class = lock_class(pelem->lock);
+
+		bpf_map_update_elem(&lock_stat, &key, &first, BPF_NOEXIST);
+		pelem->lock = 0;
+		return 0;
+	}
+
+	__sync_fetch_and_add(&data->total_time, duration);
+	__sync_fetch_and_add(&data->count, 1);
+
+	update_max(&data->max_time, duration);
+	update_min(&data->min_time, duration);
+
+	pelem->lock = 0;
+	return 0;
+}
+
+char LICENSE[] SEC("license") = "Dual BSD/GPL";
@@ -0,0 +1,32 @@
+/* SPDX-License-Identifier: (GPL-2.0-only OR BSD-2-Clause) */
+/* Data structures shared between BPF and tools. */
+#ifndef UTIL_BPF_SKEL_LOCK_DATA_H
+#define UTIL_BPF_SKEL_LOCK_DATA_H
+
+struct contention_key {
+	__s32 stack_id;		/* LOCK_AGGR_CALLER, -1 otherwise */
+	__u32 pad;
+	__u64 lock_addr;	/* LOCK_AGGR_ADDR, 0 otherwise */
+};
+
+#define CONTENTION_STACK_DEPTH  8
+
+/* lock instances the BPF program can tell apart, for LOCK_AGGR_ADDR */
+enum lock_class_sym {
+	LOCK_CLASS_NONE,
+	LOCK_CLASS_RQLOCK,
+	LOCK_CLASS_MMAP_LOCK,
+	LOCK_CLASS_SIGHAND,
+};
+
+struct contention_data {
+	__u64 total_time;
+	__u64 min_time;
+	__u64 max_time;
+	__u32 count;
+	__u32 flags;		/* LCB_F_* of the first contention */
+	__u32 lock_class;	/* enum lock_class_sym */
+	__u32 pad;
+};
+
+#endif /* UTIL_BPF_SKEL_LOCK_DATA_H */
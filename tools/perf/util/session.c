@@ -520,6 +520,8 @@ void perf_tool__fill_defaults(struct perf_tool *tool)
 		tool->aux_output_hw_id = perf_event__process_aux_output_hw_id;
 	if (tool->read == NULL)
 		tool->read = process_event_sample_stub;
+	if (tool->callchain_agg == NULL)
+		tool->callchain_agg = process_event_sample_stub;
 	if (tool->throttle == NULL)
 		tool->throttle = process_event_stub;
 	if (tool->unthrottle == NULL)
@@ -678,6 +680,25 @@ static void perf_event__itrace_start_swap(union perf_event *event,
 		swap_sample_id_all(event, &event->itrace_start + 1);
 }
 
+static void perf_event__callchain_agg_swap(union perf_event *event,
+					   bool sample_id_all)
+{
+	struct perf_record_callchain_agg *agg = &event->callchain_agg;
+	u64 i;
+
+	agg->pid    = bswap_32(agg->pid);
+	agg->tid    = bswap_32(agg->tid);
+	agg->count  = bswap_64(agg->count);
+	agg->period = bswap_64(agg->period);
+	agg->nr     = bswap_64(agg->nr);
+
+	for (i = 0; i < agg->nr; i++)
+		agg->ips[i] = bswap_64(agg->ips[i]);
+
+	if (sample_id_all)
+		swap_sample_id_all(event, &agg->ips[agg->nr]);
+}
+
 static void perf_event__switch_swap(union perf_event *event, bool sample_id_all)
 {
 	if (event->header.type == PERF_RECORD_SWITCH_CPU_WIDE) {
@@ -1010,6 +1031,7 @@ static perf_event__swap_op perf_event__swap_ops[] = {
 	[PERF_RECORD_CGROUP]		  = perf_event__cgroup_swap,
 	[PERF_RECORD_TEXT_POKE]		  = perf_event__text_poke_swap,
 	[PERF_RECORD_AUX_OUTPUT_HW_ID]	  = perf_event__all64_swap,
+	[PERF_RECORD_CALLCHAIN_AGG]	  = perf_event__callchain_agg_swap,
 	[PERF_RECORD_HEADER_ATTR]	  = perf_event__hdr_attr_swap,
 	[PERF_RECORD_HEADER_EVENT_TYPE]	  = perf_event__event_type_swap,
 	[PERF_RECORD_HEADER_TRACING_DATA] = perf_event__tracing_data_swap,
@@ -1595,6 +1617,16 @@ static int machines__deliver_event(struct machines *machines,
 		return tool->text_poke(tool, event, sample, machine);
 	case PERF_RECORD_AUX_OUTPUT_HW_ID:
 		return tool->aux_output_hw_id(tool, event, sample, machine);
+	case PERF_RECORD_CALLCHAIN_AGG:
+		if (evsel == NULL) {
+			++evlist->stats.nr_unknown_id;
+			return 0;
+		}
+		if (machine == NULL) {
+			++evlist->stats.nr_unprocessable_samples;
+			return 0;
+		}
+		return tool->callchain_agg(tool, event, sample, evsel, machine);
 	default:
 		++evlist->stats.nr_unknown_events;
 		return -1;
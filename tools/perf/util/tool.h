@@ -42,7 +42,8 @@ enum show_feature_header {
 
 struct perf_tool {
 	event_sample	sample,
-			read;
+			read,
+			callchain_agg;
 	event_op	mmap,
 			mmap2,
 			comm,
@@ -0,0 +1,79 @@
+// SPDX-License-Identifier: GPL-2.0-only
+/*
+ * Test /proc/task_stat: scan all thread groups in small batches and check
+ * that they come back in increasing pid order and that our own record
+ * matches what the process knows about itself.
+ */
+#undef NDEBUG
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/prctl.h>
+#include <linux/proc_task_stat.h>
+
+int main(void)
+{
+	struct proc_task_stat_query q = {
+		.version = PROC_TASK_STAT_VERSION,
+		.mask = PROC_TASK_STAT_BASIC | PROC_TASK_STAT_CREDS,
+	};
+	struct proc_task_stat st[2];
+	int found = 0, prev = 0;
+	ssize_t rv;
+	int fd, i;
+
+	prctl(PR_SET_NAME, "task-stat-test");
+
+	fd = open("/proc/task_stat", O_RDONLY);
+	if (fd == -1) {
+		if (errno == ENOENT)
+			return 4;
+		return 1;
+	}
+
+	/* unknown groups are rejected */
+	q.mask |= 1ULL << 63;
+	assert(ioctl(fd, PROC_TASK_STAT_IOC_QUERY, &q) == -1 && errno == EINVAL);
+	q.mask &= ~(1ULL << 63);
+	assert(ioctl(fd, PROC_TASK_STAT_IOC_QUERY, &q) == 0);
+
+	/* the file can't be written to */
+	assert(write(fd, &q, sizeof(q)) == -1);
+
+	/* a buffer that cannot hold one record is rejected */
+	assert(read(fd, st, sizeof(st[0]) - 1) == -1 && errno == EINVAL);
+
+	while ((rv = read(fd, st, sizeof(st))) > 0) {
+		assert(rv % sizeof(st[0]) == 0);
+		for (i = 0; i < rv / sizeof(st[0]); i++) {
+			assert(st[i].size == sizeof(st[0]));
+			assert(st[i].pid > prev);
+			assert(!(st[i].mask & ~q.mask));
+			prev = st[i].pid;
+
+			if (st[i].pid != getpid())
+				continue;
+			assert(st[i].mask == q.mask);
+			assert(strcmp(st[i].comm, "task-stat-test") == 0);
+			assert(st[i].state == 'R');
+			assert(st[i].ppid == getppid());
+			assert(st[i].num_threads == 1);
+			assert(st[i].uid == getuid());
+			assert(st[i].egid == getegid());
+			/* not requested */
+			assert(st[i].vsize == 0);
+			found++;
+		}
+	}
+	assert(rv == 0);
+	assert(found == 1);
+
+	/* rewinding restarts the scan */
+	assert(lseek(fd, 0, SEEK_SET) == 0);
+	assert(read(fd, st, sizeof(st)) > 0);
+
+	return 0;
+}
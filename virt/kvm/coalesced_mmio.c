@@ -14,6 +14,7 @@
 #include <linux/kvm_host.h>
 #include <linux/slab.h>
 #include <linux/kvm.h>
+#include <linux/eventfd.h>
 
 #include "coalesced_mmio.h"
 
@@ -40,9 +41,8 @@ static int coalesced_mmio_in_range(struct kvm_coalesced_mmio_dev *dev,
 	return 1;
 }
 
-static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
+static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_ring *ring, u32 last)
 {
-	struct kvm_coalesced_mmio_ring *ring;
 	unsigned avail;
 
 	/* Are we able to batch it ? */
@@ -51,8 +51,7 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	 * check if we don't meet the first used entry
 	 * there is always one unused entry in the buffer
 	 */
-	ring = dev->kvm->coalesced_mmio_ring;
-	avail = (ring->first - last - 1) % KVM_COALESCED_MMIO_MAX;
+	avail = (READ_ONCE(ring->first) - last - 1) % KVM_COALESCED_MMIO_MAX;
 	if (avail == 0) {
 		/* full */
 		return 0;
@@ -61,25 +60,18 @@ static int coalesced_mmio_has_room(struct kvm_coalesced_mmio_dev *dev, u32 last)
 	return 1;
 }
 
-static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
-				struct kvm_io_device *this, gpa_t addr,
-				int len, const void *val)
+/* Called with the ring's producer side serialized */
+static int coalesced_mmio_insert(struct kvm_coalesced_mmio_dev *dev,
+				 struct kvm_coalesced_mmio_ring *ring,
+				 gpa_t addr, int len, const void *val)
 {
-	struct kvm_coalesced_mmio_dev *dev = to_mmio(this);
-	struct kvm_coalesced_mmio_ring *ring = dev->kvm->coalesced_mmio_ring;
+	struct kvm *kvm = dev->kvm;
 	__u32 insert;
 
-	if (!coalesced_mmio_in_range(dev, addr, len))
-		return -EOPNOTSUPP;
-
-	spin_lock(&dev->kvm->ring_lock);
-
 	insert = READ_ONCE(ring->last);
-	if (!coalesced_mmio_has_room(dev, insert) ||
-	    insert >= KVM_COALESCED_MMIO_MAX) {
-		spin_unlock(&dev->kvm->ring_lock);
+	if (!coalesced_mmio_has_room(ring, insert) ||
+	    insert >= KVM_COALESCED_MMIO_MAX)
 		return -EOPNOTSUPP;
-	}
 
 	/* copy data in first free entry of the ring */
 
@@ -89,10 +81,38 @@ static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
 	ring->coalesced_mmio[insert].pio = dev->zone.pio;
 	smp_wmb();
 	ring->last = (insert + 1) % KVM_COALESCED_MMIO_MAX;
-	spin_unlock(&dev->kvm->ring_lock);
+
+	/* Tell userspace once the ring crosses the watermark */
+	if (kvm->coalesced_mmio_eventfd &&
+	    (ring->last + KVM_COALESCED_MMIO_MAX - READ_ONCE(ring->first)) %
+	    KVM_COALESCED_MMIO_MAX == kvm->coalesced_mmio_watermark)
+		eventfd_signal(kvm->coalesced_mmio_eventfd, 1);
+
 	return 0;
 }
 
+static int coalesced_mmio_write(struct kvm_vcpu *vcpu,
+				struct kvm_io_device *this, gpa_t addr,
+				int len, const void *val)
+{
+	struct kvm_coalesced_mmio_dev *dev = to_mmio(this);
+	int ret;
+
+	if (!coalesced_mmio_in_range(dev, addr, len))
+		return -EOPNOTSUPP;
+
+	/* A vCPU is the only producer of its own ring, no locking needed */
+	if (vcpu && vcpu->coalesced_mmio_ring)
+		return coalesced_mmio_insert(dev, vcpu->coalesced_mmio_ring,
+					     addr, len, val);
+
+	spin_lock(&dev->kvm->ring_lock);
+	ret = coalesced_mmio_insert(dev, dev->kvm->coalesced_mmio_ring,
+				    addr, len, val);
+	spin_unlock(&dev->kvm->ring_lock);
+	return ret;
+}
+
 static void coalesced_mmio_destructor(struct kvm_io_device *this)
 {
 	struct kvm_coalesced_mmio_dev *dev = to_mmio(this);
@@ -132,6 +152,71 @@ void kvm_coalesced_mmio_free(struct kvm *kvm)
 {
 	if (kvm->coalesced_mmio_ring)
 		free_page((unsigned long)kvm->coalesced_mmio_ring);
+	if (kvm->coalesced_mmio_eventfd)
+		eventfd_ctx_put(kvm->coalesced_mmio_eventfd);
+}
+
+int kvm_coalesced_mmio_vcpu_init(struct kvm_vcpu *vcpu)
+{
+	struct page *page;
+
+	if (!vcpu->kvm->coalesced_mmio_percpu)
+		return 0;
+
+	page = alloc_page(GFP_KERNEL_ACCOUNT | __GFP_ZERO);
+	if (!page)
+		return -ENOMEM;
+
+	vcpu->coalesced_mmio_ring = page_address(page);
+	return 0;
+}
+
+void kvm_coalesced_mmio_vcpu_free(struct kvm_vcpu *vcpu)
+{
+	if (vcpu->coalesced_mmio_ring)
+		free_page((unsigned long)vcpu->coalesced_mmio_ring);
+	vcpu->coalesced_mmio_ring = NULL;
+}
+
+/*
+ * Give each vCPU created from now on its own coalesced ring, mapped at
+ * KVM_COALESCED_MMIO_PAGE_OFFSET of the vCPU fd instead of the VM-wide one.
+ * Writes are only ordered within a vCPU's ring.  If args[0] is non-zero,
+ * the eventfd in args[1] is signalled whenever a ring fills up to args[0]
+ * entries, so userspace can drain it without waiting for an exit.
+ */
+int kvm_vm_ioctl_enable_coalesced_mmio_percpu(struct kvm *kvm,
+					      struct kvm_enable_cap *cap)
+{
+	struct eventfd_ctx *eventfd = NULL;
+	u64 watermark = cap->args[0];
+	int r;
+
+	if (cap->flags || watermark >= KVM_COALESCED_MMIO_MAX)
+		return -EINVAL;
+
+	if (watermark) {
+		eventfd = eventfd_ctx_fdget(cap->args[1]);
+		if (IS_ERR(eventfd))
+			return PTR_ERR(eventfd);
+	}
+
+	mutex_lock(&kvm->lock);
+	r = -EINVAL;
+	if (kvm->created_vcpus || kvm->coalesced_mmio_percpu)
+		goto out_unlock;
+
+	kvm->coalesced_mmio_watermark = watermark;
+	kvm->coalesced_mmio_eventfd = eventfd;
+	kvm->coalesced_mmio_percpu = true;
+	eventfd = NULL;
+	r = 0;
+
+out_unlock:
+	mutex_unlock(&kvm->lock);
+	if (eventfd)
+		eventfd_ctx_put(eventfd);
+	return r;
 }
 
 int kvm_vm_ioctl_register_coalesced_mmio(struct kvm *kvm,
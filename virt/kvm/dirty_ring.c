@@ -36,11 +36,26 @@ static bool kvm_dirty_ring_full(struct kvm_dirty_ring *ring)
 	return kvm_dirty_ring_used(ring) >= ring->size;
 }
 
-static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
+/*
+ * Number of coalesced masks re-protected per mmu_lock hold when resetting
+ * a ring, so that a large harvest neither bounces the lock for every mask
+ * nor holds it long enough to starve vCPU page faults.
+ */
+#define KVM_DIRTY_RING_RESET_BATCH	64
+
+/*
+ * *batch counts the masks re-protected since mmu_lock was taken; the lock
+ * is held on return iff *batch is non-zero.
+ */
+static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask,
+				unsigned int *batch)
 {
 	struct kvm_memory_slot *memslot;
 	int as_id, id;
 
+	if (!mask)
+		return;
+
 	as_id = slot >> 16;
 	id = (u16)slot;
 
@@ -52,9 +67,16 @@ static void kvm_reset_dirty_gfn(struct kvm *kvm, u32 slot, u64 offset, u64 mask)
 	if (!memslot || (offset + __fls(mask)) >= memslot->npages)
 		return;
 
-	KVM_MMU_LOCK(kvm);
+	if (!(*batch)++)
+		KVM_MMU_LOCK(kvm);
+
 	kvm_arch_mmu_enable_log_dirty_pt_masked(kvm, memslot, offset, mask);
-	KVM_MMU_UNLOCK(kvm);
+
+	if (*batch == KVM_DIRTY_RING_RESET_BATCH) {
+		KVM_MMU_UNLOCK(kvm);
+		*batch = 0;
+		cond_resched();
+	}
 }
 
 int kvm_dirty_ring_alloc(struct kvm_dirty_ring *ring, int index, u32 size)
@@ -91,6 +113,7 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 {
 	u32 cur_slot, next_slot;
 	u64 cur_offset, next_offset;
+	unsigned int batch = 0;
 	unsigned long mask;
 	int count = 0;
 	struct kvm_dirty_gfn *entry;
@@ -133,14 +156,16 @@ int kvm_dirty_ring_reset(struct kvm *kvm, struct kvm_dirty_ring *ring)
 				continue;
 			}
 		}
-		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+		kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask, &batch);
 		cur_slot = next_slot;
 		cur_offset = next_offset;
 		mask = 1;
 		first_round = false;
 	}
 
-	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask);
+	kvm_reset_dirty_gfn(kvm, cur_slot, cur_offset, mask, &batch);
+	if (batch)
+		KVM_MMU_UNLOCK(kvm);
 
 	trace_kvm_dirty_ring_reset(ring);
 
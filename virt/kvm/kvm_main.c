@@ -463,6 +463,7 @@ static void kvm_vcpu_destroy(struct kvm_vcpu *vcpu)
 {
 	kvm_arch_vcpu_destroy(vcpu);
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
+	kvm_coalesced_mmio_vcpu_free(vcpu);
 
 	/*
 	 * No need for rcu_read_lock as VCPU_RUN is the only place that changes
@@ -1114,7 +1115,7 @@ static struct kvm *kvm_create_vm(unsigned long type)
 	rcuwait_init(&kvm->mn_memslots_update_rcuwait);
 	xa_init(&kvm->vcpu_array);
 
-	INIT_LIST_HEAD(&kvm->gpc_list);
+	kvm->gpc_tree = RB_ROOT_CACHED;
 	spin_lock_init(&kvm->gpc_lock);
 
 	INIT_LIST_HEAD(&kvm->devices);
@@ -3737,7 +3738,8 @@ static vm_fault_t kvm_vcpu_fault(struct vm_fault *vmf)
 #endif
 #ifdef CONFIG_KVM_MMIO
 	else if (vmf->pgoff == KVM_COALESCED_MMIO_PAGE_OFFSET)
-		page = virt_to_page(vcpu->kvm->coalesced_mmio_ring);
+		page = virt_to_page(vcpu->coalesced_mmio_ring ?:
+				    vcpu->kvm->coalesced_mmio_ring);
 #endif
 	else if (kvm_page_in_dirty_ring(vcpu->kvm, vmf->pgoff))
 		page = kvm_dirty_ring_get_page(
@@ -3859,11 +3861,15 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 	if (r)
 		goto vcpu_free_run_page;
 
+	r = kvm_coalesced_mmio_vcpu_init(vcpu);
+	if (r)
+		goto arch_vcpu_destroy;
+
 	if (kvm->dirty_ring_size) {
 		r = kvm_dirty_ring_alloc(&vcpu->dirty_ring,
 					 id, kvm->dirty_ring_size);
 		if (r)
-			goto arch_vcpu_destroy;
+			goto vcpu_free_coalesced_mmio;
 	}
 
 	mutex_lock(&kvm->lock);
@@ -3906,6 +3912,8 @@ static int kvm_vm_ioctl_create_vcpu(struct kvm *kvm, u32 id)
 unlock_vcpu_destroy:
 	mutex_unlock(&kvm->lock);
 	kvm_dirty_ring_free(&vcpu->dirty_ring);
+vcpu_free_coalesced_mmio:
+	kvm_coalesced_mmio_vcpu_free(vcpu);
 arch_vcpu_destroy:
 	kvm_arch_vcpu_destroy(vcpu);
 vcpu_free_run_page:
@@ -4408,6 +4416,7 @@ static long kvm_vm_ioctl_check_extension_generic(struct kvm *kvm, long arg)
 	case KVM_CAP_COALESCED_MMIO:
 		return KVM_COALESCED_MMIO_PAGE_OFFSET;
 	case KVM_CAP_COALESCED_PIO:
+	case KVM_CAP_COALESCED_MMIO_PERCPU:
 		return 1;
 #endif
 #ifdef CONFIG_KVM_GENERIC_DIRTYLOG_READ_PROTECT
@@ -4531,6 +4540,10 @@ static int kvm_vm_ioctl_enable_cap_generic(struct kvm *kvm,
 	}
 	case KVM_CAP_DIRTY_LOG_RING:
 		return kvm_vm_ioctl_enable_dirty_log_ring(kvm, cap->args[0]);
+#ifdef CONFIG_KVM_MMIO
+	case KVM_CAP_COALESCED_MMIO_PERCPU:
+		return kvm_vm_ioctl_enable_coalesced_mmio_percpu(kvm, cap);
+#endif
 	default:
 		return kvm_vm_ioctl_enable_cap(kvm, cap);
 	}
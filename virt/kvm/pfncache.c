@@ -26,11 +26,15 @@ void gfn_to_pfn_cache_invalidate_start(struct kvm *kvm, unsigned long start,
 				       unsigned long end, bool may_block)
 {
 	DECLARE_BITMAP(vcpu_bitmap, KVM_MAX_VCPUS);
+	struct interval_tree_node *node;
 	struct gfn_to_pfn_cache *gpc;
 	bool evict_vcpus = false;
 
+	/* Only visit the caches whose uhva falls in the range */
 	spin_lock(&kvm->gpc_lock);
-	list_for_each_entry(gpc, &kvm->gpc_list, list) {
+	for (node = interval_tree_iter_first(&kvm->gpc_tree, start, end - 1);
+	     node; node = interval_tree_iter_next(node, start, end - 1)) {
+		gpc = container_of(node, struct gfn_to_pfn_cache, hva_node);
 		write_lock_irq(&gpc->lock);
 
 		/* Only a single page so no need to care about length */
@@ -95,6 +99,27 @@ bool kvm_gfn_to_pfn_cache_check(struct kvm *kvm, struct gfn_to_pfn_cache *gpc,
 }
 EXPORT_SYMBOL_GPL(kvm_gfn_to_pfn_cache_check);
 
+static void gpc_tree_remove(struct kvm *kvm, struct gfn_to_pfn_cache *gpc)
+{
+	lockdep_assert_held(&kvm->gpc_lock);
+
+	if (RB_EMPTY_NODE(&gpc->hva_node.rb))
+		return;
+
+	interval_tree_remove(&gpc->hva_node, &kvm->gpc_tree);
+	RB_CLEAR_NODE(&gpc->hva_node.rb);
+}
+
+static void gpc_tree_insert(struct kvm *kvm, struct gfn_to_pfn_cache *gpc)
+{
+	lockdep_assert_held(&kvm->gpc_lock);
+
+	/* Only a single page so no need to care about length */
+	gpc->hva_node.start = gpc->uhva;
+	gpc->hva_node.last = gpc->uhva;
+	interval_tree_insert(&gpc->hva_node, &kvm->gpc_tree);
+}
+
 static void gpc_unmap_khva(struct kvm *kvm, kvm_pfn_t pfn, void *khva)
 {
 	/* Unmap the old pfn/page if it was mapped before. */
@@ -242,6 +267,7 @@ int kvm_gfn_to_pfn_cache_refresh(struct kvm *kvm, struct gfn_to_pfn_cache *gpc,
 	kvm_pfn_t old_pfn, new_pfn;
 	unsigned long old_uhva;
 	void *old_khva;
+	bool rekey;
 	int ret = 0;
 
 	/*
@@ -258,6 +284,17 @@ int kvm_gfn_to_pfn_cache_refresh(struct kvm *kvm, struct gfn_to_pfn_cache *gpc,
 	 */
 	mutex_lock(&gpc->refresh_lock);
 
+	/*
+	 * gpa, generation and uhva only change under refresh_lock, so they can
+	 * be checked before taking gpc->lock.  If the uhva may change, the
+	 * cache must be moved in kvm->gpc_tree, which needs gpc_lock and that
+	 * nests outside gpc->lock.
+	 */
+	rekey = gpc->gpa != gpa || gpc->generation != slots->generation ||
+		kvm_is_error_hva(gpc->uhva);
+	if (rekey)
+		spin_lock(&kvm->gpc_lock);
+
 	write_lock_irq(&gpc->lock);
 
 	old_pfn = gpc->pfn;
@@ -265,15 +302,21 @@ int kvm_gfn_to_pfn_cache_refresh(struct kvm *kvm, struct gfn_to_pfn_cache *gpc,
 	old_uhva = gpc->uhva;
 
 	/* If the userspace HVA is invalid, refresh that first */
-	if (gpc->gpa != gpa || gpc->generation != slots->generation ||
-	    kvm_is_error_hva(gpc->uhva)) {
+	if (rekey) {
 		gfn_t gfn = gpa_to_gfn(gpa);
 
+		gpc_tree_remove(kvm, gpc);
+
 		gpc->gpa = gpa;
 		gpc->generation = slots->generation;
 		gpc->memslot = __gfn_to_memslot(slots, gfn);
 		gpc->uhva = gfn_to_hva_memslot(gpc->memslot, gfn);
 
+		if (!kvm_is_error_hva(gpc->uhva) && gpc->active)
+			gpc_tree_insert(kvm, gpc);
+
+		spin_unlock(&kvm->gpc_lock);
+
 		if (kvm_is_error_hva(gpc->uhva)) {
 			ret = -EFAULT;
 			goto out;
@@ -364,9 +407,8 @@ int kvm_gfn_to_pfn_cache_init(struct kvm *kvm, struct gfn_to_pfn_cache *gpc,
 		gpc->valid = false;
 		gpc->active = true;
 
-		spin_lock(&kvm->gpc_lock);
-		list_add(&gpc->list, &kvm->gpc_list);
-		spin_unlock(&kvm->gpc_lock);
+		/* Added to kvm->gpc_tree by the refresh, once uhva is known */
+		RB_CLEAR_NODE(&gpc->hva_node.rb);
 	}
 	return kvm_gfn_to_pfn_cache_refresh(kvm, gpc, gpa, len);
 }
@@ -376,7 +418,7 @@ void kvm_gfn_to_pfn_cache_destroy(struct kvm *kvm, struct gfn_to_pfn_cache *gpc)
 {
 	if (gpc->active) {
 		spin_lock(&kvm->gpc_lock);
-		list_del(&gpc->list);
+		gpc_tree_remove(kvm, gpc);
 		spin_unlock(&kvm->gpc_lock);
 
 		kvm_gfn_to_pfn_cache_unmap(kvm, gpc);